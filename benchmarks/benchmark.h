@@ -0,0 +1,121 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+
+/*
+ * Minimal benchmark harness. Each case is repeated until it ran for at least
+ * min_duration_ms, then its mean time per iteration is reported, along with
+ * its throughput when the case processes a known amount of bytes.
+ */
+class BenchmarkRunner
+{
+  public:
+    BenchmarkRunner(const std::string& filter,
+                    std::size_t max_bytes,
+                    double min_duration_ms)
+        : filter_(filter)
+        , max_bytes_(max_bytes)
+        , min_duration_ms_(min_duration_ms)
+    {
+    }
+
+    // Cases not matching the filter given on the command line are skipped
+    bool selected(const std::string& name) const
+    {
+        return name.find(filter_) != std::string::npos;
+    }
+
+    // Cases needing more memory than this are skipped
+    std::size_t max_bytes() const
+    {
+        return max_bytes_;
+    }
+
+    /**
+     * Run iteration repeatedly, if the case is selected. bytes is the amount
+     * of data processed by each iteration, or 0 if that doesn't apply.
+     */
+    void run(const std::string& name,
+             std::size_t bytes,
+             const std::function<void()>& iteration) const
+    {
+        using Clock = std::chrono::steady_clock;
+
+        if (!selected(name)) {
+            return;
+        }
+
+        // Warm up caches and thread pools, and learn about how long one
+        // iteration takes
+        iteration();
+
+        long long iterations = 0;
+        double elapsed_ms    = 0.0;
+        const Clock::time_point start = Clock::now();
+        do {
+            iteration();
+            ++iterations;
+            elapsed_ms = std::chrono::duration<double, std::milli>(
+                             Clock::now() - start)
+                             .count();
+        } while (elapsed_ms < min_duration_ms_);
+
+        const double ns_per_iteration = elapsed_ms * 1e6 / iterations;
+
+        if (bytes > 0) {
+            const double mb_per_s =
+                static_cast<double>(bytes) / (1 << 20) /
+                (ns_per_iteration * 1e-9);
+            std::printf("%-56s %14.0f ns %10.1f MB/s %8lld iterations\n",
+                        name.c_str(),
+                        ns_per_iteration,
+                        mb_per_s,
+                        iterations);
+        } else {
+            std::printf("%-56s %14.0f ns %15s %8lld iterations\n",
+                        name.c_str(),
+                        ns_per_iteration,
+                        "",
+                        iterations);
+        }
+        std::fflush(stdout);
+    }
+
+  private:
+    std::string filter_;
+    std::size_t max_bytes_;
+    double min_duration_ms_;
+};
+
+#endif // BENCHMARK_H_
@@ -0,0 +1,467 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * End to end benchmark of plotting buffers. It plays the part of the bridge
+ * for a real window, started with --report-frames, sends it synthetic
+ * buffers one at a time and reports as JSON how long they took to be on
+ * screen. Run with --help for the options.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QProcess>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#include "ipc/message_exchange.h"
+#include "ipc/raw_data_decode.h"
+#include "ipc/row_packer.h"
+#include "synthetic_buffers.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// As in the bridge, large buffers are preceded by a downsampled preview of
+// at most max_preview_area pixels
+const size_t progressive_transfer_threshold = 32 << 20;
+const size_t max_preview_area               = 1 << 20;
+
+// Time the window has to start, and to display each buffer
+const int window_timeout_ms = 60000;
+
+const char plotted_buffer_name[] = "benchmark_buffer";
+
+
+struct Options
+{
+    string window_path;
+    int width          = 4096;
+    int height         = 4096;
+    int channels       = 3;
+    BufferType type    = BufferType::UnsignedByte;
+    int count          = 20;
+    string compression = "none";
+    string output_path;
+
+    // Fail if the window takes longer to show its first buffer, if positive
+    double max_startup_ms = 0.0;
+};
+
+
+// Latencies of a series of plots, in ms
+struct LatencyStatistics
+{
+    double p50;
+    double p99;
+    double max;
+};
+
+
+long long steady_now_ns()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+
+// Largest resident memory of this process so far, in bytes, or 0 if unknown
+long long peak_resident_memory()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+#if defined(Q_OS_MACOS)
+    return static_cast<long long>(usage.ru_maxrss);
+#else
+    return static_cast<long long>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+
+LatencyStatistics latency_statistics(vector<double> latencies)
+{
+    sort(latencies.begin(), latencies.end());
+
+    // Nearest rank percentiles
+    const auto percentile = [&](double fraction) {
+        const size_t rank = static_cast<size_t>(
+            ceil(fraction * static_cast<double>(latencies.size())));
+        return latencies[max<size_t>(rank, 1) - 1];
+    };
+
+    return LatencyStatistics{percentile(0.5), percentile(0.99),
+                             latencies.back()};
+}
+
+
+CompressionMode compression_mode(const string& compression)
+{
+    if (compression == "fast") {
+        return CompressionMode::Fast;
+    } else if (compression == "best") {
+        return CompressionMode::Best;
+    }
+
+    return CompressionMode::None;
+}
+
+
+// Messages sent by the bridge to plot contents, preview included
+void compose_plot(const Options& options,
+                  vector<uint8_t>& contents,
+                  MessageComposer& message_composer)
+{
+    const string variable_name = plotted_buffer_name;
+    const string pixel_layout  = "rgba";
+    const bool transpose       = false;
+
+    message_composer.set_compression(compression_mode(options.compression));
+
+    if (contents.size() >= progressive_transfer_threshold) {
+        int factor = 2;
+        while (static_cast<size_t>(options.width / factor) *
+                   static_cast<size_t>(options.height / factor) >
+               max_preview_area) {
+            factor *= 2;
+        }
+
+        vector<uint8_t> preview;
+        pack_preview(contents.data(),
+                     options.width,
+                     options.height,
+                     options.width,
+                     options.channels * typesize(options.type),
+                     factor,
+                     preview);
+
+        message_composer.push(MessageType::PlotBufferPreview)
+            .push(variable_name)
+            .push(variable_name)
+            .push(pixel_layout)
+            .push(transpose)
+            .push(options.width)
+            .push(options.height)
+            .push(options.channels)
+            .push(options.type)
+            .push(factor)
+            .push_owned(std::move(preview));
+    }
+
+    message_composer.push(MessageType::PlotBufferContents)
+        .push(variable_name)
+        .push(variable_name)
+        .push(pixel_layout)
+        .push(transpose)
+        .push(options.width)
+        .push(options.height)
+        .push(options.channels)
+        .push(options.width)
+        .push(options.type)
+        .push(contents.data(), contents.size());
+}
+
+
+/*
+ * Wait for the window to print a line starting with the given tag, e.g.
+ * "[frame] complete", and return its first value. What the window sends to
+ * the bridge in the meantime is discarded, so that it never waits for it to
+ * be read.
+ */
+bool wait_for_window_line(QProcess& window,
+                          QTcpSocket* socket,
+                          const string& tag,
+                          long long& value)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while (true) {
+        while (window.canReadLine()) {
+            const string line = window.readLine().trimmed().toStdString();
+            if (line.compare(0, tag.size(), tag) == 0) {
+                istringstream(line.substr(tag.size())) >> value;
+                return true;
+            }
+        }
+
+        if (socket != nullptr) {
+            socket->waitForReadyRead(0);
+            socket->readAll();
+        }
+
+        if (window.state() == QProcess::NotRunning ||
+            timer.elapsed() > window_timeout_ms) {
+            return false;
+        }
+
+        window.waitForReadyRead(10);
+    }
+}
+
+
+void write_statistics(ostream& report,
+                      const char* name,
+                      const LatencyStatistics& statistics)
+{
+    report << "  \"" << name << "\": {\"p50\": " << statistics.p50
+           << ", \"p99\": " << statistics.p99
+           << ", \"max\": " << statistics.max << "},\n";
+}
+
+
+void print_usage(const char* program)
+{
+    cout << "Usage: " << program << " --window=/path/to/oidwindow [options]"
+         << endl
+         << endl
+         << "  --width=N          width of the plotted buffers (default 4096)"
+         << endl
+         << "  --height=N         height of the plotted buffers (default 4096)"
+         << endl
+         << "  --channels=N       channels of the plotted buffers (default 3)"
+         << endl
+         << "  --type=NAME        uint8, int8, uint16, int16, int32, uint32,"
+            " int64, float16,"
+         << endl
+         << "                     float32 or float64 (default uint8)" << endl
+         << "  --count=N          number of plots (default 20)" << endl
+         << "  --compression=M    none, fast or best (default none)" << endl
+         << "  --output=PATH      write the JSON report to PATH instead of"
+            " the standard output"
+         << endl
+         << "  --max-startup-ms=N fail if the window takes longer than N ms"
+            " from its launch"
+         << endl
+         << "                     to show the first buffer" << endl;
+}
+
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const string arg   = argv[i];
+        const size_t equal = arg.find('=');
+        const string name  = arg.substr(0, equal);
+        const string value =
+            equal != string::npos ? arg.substr(equal + 1) : string();
+
+        if (name == "--window") {
+            options.window_path = value;
+        } else if (name == "--width") {
+            options.width = stoi(value);
+        } else if (name == "--height") {
+            options.height = stoi(value);
+        } else if (name == "--channels") {
+            options.channels = stoi(value);
+        } else if (name == "--type") {
+            if (!type_from_name(value, options.type)) {
+                cerr << "[error] Unknown buffer type " << value << endl;
+                return false;
+            }
+        } else if (name == "--count") {
+            options.count = stoi(value);
+        } else if (name == "--compression") {
+            options.compression = value;
+        } else if (name == "--output") {
+            options.output_path = value;
+        } else if (name == "--max-startup-ms") {
+            options.max_startup_ms = stod(value);
+        } else {
+            if (name != "--help" && name != "-h") {
+                cerr << "[error] Unknown option " << arg << endl;
+            }
+            return false;
+        }
+    }
+
+    return !options.window_path.empty() && options.width > 0 &&
+           options.height > 0 && options.channels >= 1 &&
+           options.channels <= 4 && options.count > 0;
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    QTcpServer server;
+    if (!server.listen(QHostAddress::LocalHost)) {
+        cerr << "[error] Could not start the benchmark server" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // The timestamps are read from the standard output of the window, whose
+    // errors are shown as they are
+    QProcess window;
+    window.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+
+    const long long launch_ns = steady_now_ns();
+    window.start(QString::fromStdString(options.window_path),
+                 QStringList() << "-style"
+                               << "fusion"
+                               << "-p" << QString::number(server.serverPort())
+                               << "-c"
+                               << QString::fromStdString(options.compression)
+                               << "--report-frames");
+
+    if (!window.waitForStarted(window_timeout_ms) ||
+        !server.waitForNewConnection(window_timeout_ms)) {
+        cerr << "[error] The window did not connect" << endl;
+        window.kill();
+        return EXIT_FAILURE;
+    }
+
+    QTcpSocket* socket = server.nextPendingConnection();
+
+    const double connect_ms = (steady_now_ns() - launch_ns) * 1e-6;
+    double first_buffer_ms  = 0.0;
+
+    const size_t pixels =
+        static_cast<size_t>(options.width) * options.height;
+    vector<uint8_t> contents =
+        make_buffer(options.type, pixels * options.channels);
+
+    vector<double> first_frame_ms;
+    vector<double> complete_frame_ms;
+
+    for (int plot = 0; plot < options.count; ++plot) {
+        const long long start_ns = steady_now_ns();
+
+        MessageComposer message_composer;
+        compose_plot(options, contents, message_composer);
+        message_composer.send(socket);
+
+        long long first_ns;
+        long long complete_ns;
+        if (!wait_for_window_line(window, socket, "[frame] first", first_ns) ||
+            !wait_for_window_line(
+                window, socket, "[frame] complete", complete_ns)) {
+            cerr << "[error] The window did not display plot " << plot
+                 << endl;
+            window.kill();
+            return EXIT_FAILURE;
+        }
+
+        // Cold start lasts until the first buffer is on screen
+        if (plot == 0) {
+            first_buffer_ms = (first_ns - launch_ns) * 1e-6;
+        }
+
+        first_frame_ms.push_back((first_ns - start_ns) * 1e-6);
+        complete_frame_ms.push_back((complete_ns - start_ns) * 1e-6);
+    }
+
+    // The window quits once the bridge disconnects, and then reports its
+    // memory usage
+    socket->disconnectFromHost();
+
+    long long window_peak_rss = 0;
+    wait_for_window_line(window, nullptr, "[memory] peak_rss", window_peak_rss);
+    window.waitForFinished(window_timeout_ms);
+
+    double total_complete_ms = 0.0;
+    for (double latency : complete_frame_ms) {
+        total_complete_ms += latency;
+    }
+    const double throughput_mb_s =
+        static_cast<double>(contents.size()) * options.count / (1 << 20) /
+        (total_complete_ms * 1e-3);
+
+    ostringstream report;
+    report << "{\n"
+           << "  \"type\": \"" << type_name(options.type) << "\",\n"
+           << "  \"width\": " << options.width << ",\n"
+           << "  \"height\": " << options.height << ",\n"
+           << "  \"channels\": " << options.channels << ",\n"
+           << "  \"count\": " << options.count << ",\n"
+           << "  \"compression\": \"" << options.compression << "\",\n"
+           << "  \"buffer_bytes\": " << contents.size() << ",\n"
+           << "  \"throughput_mb_s\": " << throughput_mb_s << ",\n";
+    report << "  \"startup_ms\": {\"connect\": " << connect_ms
+           << ", \"first_buffer\": " << first_buffer_ms << "},\n";
+    write_statistics(
+        report, "first_frame_ms", latency_statistics(first_frame_ms));
+    write_statistics(
+        report, "complete_frame_ms", latency_statistics(complete_frame_ms));
+    report << "  \"peak_rss_bytes\": {\"bridge\": " << peak_resident_memory()
+           << ", \"window\": " << window_peak_rss << "}\n"
+           << "}\n";
+
+    if (options.output_path.empty()) {
+        cout << report.str();
+    } else {
+        ofstream output(options.output_path);
+        output << report.str();
+        if (!output) {
+            cerr << "[error] Could not write the report to "
+                 << options.output_path << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.max_startup_ms > 0.0 &&
+        first_buffer_ms > options.max_startup_ms) {
+        cerr << "[error] The window took " << first_buffer_ms
+             << " ms to show its first buffer, over the target of "
+             << options.max_startup_ms << " ms" << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
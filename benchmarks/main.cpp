@@ -0,0 +1,350 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Micro-benchmarks of the kernels of the window on the hot paths, from
+ * receiving a buffer to displaying and exporting it. Run with --help for
+ * the options.
+ */
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+
+#include "benchmark.h"
+#include "io/buffer_exporter.h"
+#include "ipc/message_exchange.h"
+#include "ipc/raw_data_decode.h"
+#include "math/linear_algebra.h"
+#include "synthetic_buffers.h"
+#include "visualization/channel_range.h"
+#include "visualization/histogram.h"
+#include "visualization/value_labels.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Width and height of the buffers of the benchmarks
+const int buffer_sizes[] = {256, 1024, 4096, 16384};
+
+// Same as the labels of BufferValues
+const int label_length = 16;
+
+// Labels formatted by each iteration of the pix2str benchmarks, about as
+// many as a zoomed in canvas shows
+const int labelled_pixels = 64 * 64;
+
+
+/*
+ * Sends contents to the window side of the loopback connection whenever it
+ * asks for them with a non-zero byte, until it sends a zero byte
+ */
+void serve_contents(quint16 port,
+                    vector<uint8_t>* contents,
+                    CompressionMode compression)
+{
+    QTcpSocket socket;
+    socket.connectToHost(QHostAddress::LocalHost, port);
+    if (!socket.waitForConnected()) {
+        cerr << "[error] Could not connect to the benchmark server" << endl;
+        return;
+    }
+
+    for (;;) {
+        while (socket.bytesAvailable() < 1) {
+            if (!socket.waitForReadyRead()) {
+                return;
+            }
+        }
+
+        char request;
+        socket.read(&request, 1);
+        if (request == 0) {
+            break;
+        }
+
+        MessageComposer message;
+        message.set_compression(compression);
+        message.push(MessageType::PlotBufferContents)
+            .push(contents->data(), contents->size());
+        message.send(&socket);
+    }
+}
+
+
+// Time from requesting contents to having decoded them, as when the window
+// requests a buffer from the bridge
+void benchmark_message_exchange(const BenchmarkRunner& runner,
+                                const string& name,
+                                vector<uint8_t>& contents,
+                                CompressionMode compression)
+{
+    if (!runner.selected(name)) {
+        return;
+    }
+
+    QTcpServer server;
+    if (!server.listen(QHostAddress::LocalHost)) {
+        cerr << "[error] Could not start the benchmark server" << endl;
+        return;
+    }
+
+    thread bridge(serve_contents, server.serverPort(), &contents, compression);
+
+    if (!server.waitForNewConnection(30000)) {
+        cerr << "[error] The benchmark client did not connect" << endl;
+        bridge.join();
+        return;
+    }
+
+    QTcpSocket* socket = server.nextPendingConnection();
+    MessageDecoder decoder(socket);
+    vector<uint8_t> received;
+
+    runner.run(name, contents.size(), [&]() {
+        const char request = 1;
+        socket->write(&request, 1);
+        socket->flush();
+
+        MessageHeader header;
+        decoder.read(header).read<vector<uint8_t>>(received);
+    });
+
+    const char stop = 0;
+    socket->write(&stop, 1);
+    socket->waitForBytesWritten();
+    bridge.join();
+
+    delete socket;
+}
+
+
+void benchmark_buffer(const BenchmarkRunner& runner,
+                      const QTemporaryDir& export_dir,
+                      BufferType type,
+                      int size,
+                      int channels)
+{
+    const string suffix = string("/") + type_name(type) + "/c" +
+                          to_string(channels) + "/" + to_string(size) + "x" +
+                          to_string(size);
+
+    const size_t count = static_cast<size_t>(size) * size * channels;
+    if (count * typesize(type) > runner.max_bytes()) {
+        return;
+    }
+
+    const char* kernels[] = {"narrow_buffer_to_held_type",
+                             "compute_channel_range",
+                             "compute_histogram",
+                             "export_bitmap",
+                             "export_binary",
+                             "pix2str",
+                             "message_exchange",
+                             "message_exchange_fast"};
+    bool any_selected = false;
+    for (const char* kernel : kernels) {
+        any_selected = any_selected || runner.selected(kernel + suffix);
+    }
+    if (!any_selected) {
+        return;
+    }
+
+    vector<uint8_t> buffer = make_buffer(type, count);
+
+    const BufferType held_type = held_buffer_type(type);
+    if (held_type != type) {
+        // Includes copying the received buffer, which must be narrowed
+        // again by each iteration
+        vector<uint8_t> narrowed;
+        runner.run("narrow_buffer_to_held_type" + suffix, buffer.size(), [&]() {
+            narrowed.assign(buffer.begin(), buffer.end());
+            narrow_buffer_to_held_type(type, narrowed);
+        });
+    }
+
+    vector<uint8_t> held = buffer;
+    narrow_buffer_to_held_type(type, held);
+
+    runner.run("compute_channel_range" + suffix, held.size(), [&]() {
+        float lowest[4];
+        float upper[4];
+        compute_channel_range(
+            held.data(), size, size, size, channels, held_type, lowest, upper);
+    });
+
+    Histogram histogram;
+    const atomic<bool> cancel(false);
+    runner.run("compute_histogram" + suffix, held.size(), [&]() {
+        compute_histogram(held.data(),
+                          size,
+                          size,
+                          size,
+                          channels,
+                          held_type,
+                          cancel,
+                          histogram);
+    });
+
+    const float contrast_brightness[8] = {
+        1.0, 1.0, 1.0, 1.0, 0.0, 0.0, 0.0, 0.0};
+    const BufferExporter::Contents contents{held.data(),
+                                            size,
+                                            size,
+                                            size,
+                                            channels,
+                                            held_type,
+                                            "rgba",
+                                            contrast_brightness};
+
+    const string bitmap_path = export_dir.filePath("export.png").toStdString();
+    runner.run("export_bitmap" + suffix, held.size(), [&]() {
+        BufferExporter::export_buffer(
+            contents, bitmap_path, BufferExporter::OutputType::Bitmap);
+    });
+
+    const string binary_path = export_dir.filePath("export.oct").toStdString();
+    runner.run("export_binary" + suffix, held.size(), [&]() {
+        BufferExporter::export_buffer(
+            contents, binary_path, BufferExporter::OutputType::OctaveMatrix);
+    });
+
+    vector<char> labels(static_cast<size_t>(labelled_pixels) * channels *
+                        label_length);
+    const int pixels = min(labelled_pixels, size * size);
+    runner.run("pix2str" + suffix, 0, [&]() {
+        for (int p = 0; p < pixels; ++p) {
+            for (int c = 0; c < channels; ++c) {
+                pix2str(held_type,
+                        held.data(),
+                        p * channels,
+                        c,
+                        label_length,
+                        &labels[(p * channels + c) * label_length]);
+            }
+        }
+    });
+
+    benchmark_message_exchange(
+        runner, "message_exchange" + suffix, buffer, CompressionMode::None);
+    benchmark_message_exchange(runner,
+                               "message_exchange_fast" + suffix,
+                               buffer,
+                               CompressionMode::Fast);
+}
+
+
+void benchmark_mat4_inv(const BenchmarkRunner& runner)
+{
+    mat4 transform;
+    transform.set_from_srt(2.f, 3.f, 1.f, 0.5f, 10.f, -20.f, 0.f);
+
+    float sink = 0.f;
+    runner.run("mat4::inv", 0, [&]() {
+        sink += transform.inv().data()[0];
+    });
+
+    if (sink == 0.f) {
+        cerr << "[error] mat4::inv returned a singular matrix" << endl;
+    }
+}
+
+
+void print_usage(const char* program)
+{
+    cout << "Usage: " << program << " [options] [filter]" << endl
+         << "Runs the benchmarks whose name contains filter, e.g."
+            " compute_histogram/float32/c4"
+         << endl
+         << endl
+         << "  --max-mb=N        skip the buffers above N MiB (default 1024)"
+         << endl
+         << "  --min-time-ms=N   run each benchmark for at least N ms"
+            " (default 200)"
+         << endl;
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    string filter;
+    size_t max_mb          = 1024;
+    double min_duration_ms = 200.0;
+
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (arg.compare(0, 9, "--max-mb=") == 0) {
+            max_mb = static_cast<size_t>(stoul(arg.substr(9)));
+        } else if (arg.compare(0, 14, "--min-time-ms=") == 0) {
+            min_duration_ms = stod(arg.substr(14));
+        } else if (arg.compare(0, 2, "--") == 0) {
+            cerr << "[error] Unknown option " << arg << endl;
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            filter = arg;
+        }
+    }
+
+    const QTemporaryDir export_dir;
+    if (!export_dir.isValid()) {
+        cerr << "[error] Could not create a directory for the exports" << endl;
+        return EXIT_FAILURE;
+    }
+
+    const BenchmarkRunner runner(filter, max_mb << 20, min_duration_ms);
+
+    benchmark_mat4_inv(runner);
+
+    for (int size : buffer_sizes) {
+        for (BufferType type : buffer_types) {
+            for (int channels = 1; channels <= 4; ++channels) {
+                benchmark_buffer(runner, export_dir, type, size, channels);
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
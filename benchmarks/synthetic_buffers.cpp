@@ -0,0 +1,154 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "synthetic_buffers.h"
+
+using namespace std;
+
+
+const BufferType buffer_types[10] = {BufferType::UnsignedByte,
+                                     BufferType::Int8,
+                                     BufferType::UnsignedShort,
+                                     BufferType::Short,
+                                     BufferType::Int32,
+                                     BufferType::UnsignedInt32,
+                                     BufferType::Int64,
+                                     BufferType::Float16,
+                                     BufferType::Float32,
+                                     BufferType::Float64};
+
+
+const char* type_name(BufferType type)
+{
+    switch (type) {
+    case BufferType::UnsignedByte:
+        return "uint8";
+    case BufferType::Int8:
+        return "int8";
+    case BufferType::UnsignedShort:
+        return "uint16";
+    case BufferType::Short:
+        return "int16";
+    case BufferType::Int32:
+        return "int32";
+    case BufferType::UnsignedInt32:
+        return "uint32";
+    case BufferType::Int64:
+        return "int64";
+    case BufferType::Float16:
+        return "float16";
+    case BufferType::Float32:
+        return "float32";
+    case BufferType::Float64:
+        return "float64";
+    }
+
+    return "unknown";
+}
+
+
+namespace
+{
+
+// Pseudo random values, so that the kernels don't take any shortcut on
+// constant buffers
+template <typename T>
+void fill_values(uint8_t* dst, size_t count)
+{
+    T* values      = reinterpret_cast<T*>(dst);
+    uint32_t state = 1;
+    for (size_t i = 0; i < count; ++i) {
+        state     = state * 1664525u + 1013904223u;
+        values[i] = static_cast<T>(state >> 24);
+    }
+}
+
+
+template <>
+void fill_values<Half>(uint8_t* dst, size_t count)
+{
+    Half* values   = reinterpret_cast<Half*>(dst);
+    uint32_t state = 1;
+    for (size_t i = 0; i < count; ++i) {
+        state          = state * 1664525u + 1013904223u;
+        values[i].bits = float_to_half(static_cast<float>(state >> 24));
+    }
+}
+
+} // namespace
+
+
+bool type_from_name(const string& name, BufferType& type)
+{
+    for (BufferType candidate : buffer_types) {
+        if (name == type_name(candidate)) {
+            type = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+vector<uint8_t> make_buffer(BufferType type, size_t count)
+{
+    vector<uint8_t> buffer(count * typesize(type));
+
+    switch (type) {
+    case BufferType::UnsignedByte:
+        fill_values<uint8_t>(buffer.data(), count);
+        break;
+    case BufferType::Int8:
+        fill_values<int8_t>(buffer.data(), count);
+        break;
+    case BufferType::UnsignedShort:
+        fill_values<uint16_t>(buffer.data(), count);
+        break;
+    case BufferType::Short:
+        fill_values<int16_t>(buffer.data(), count);
+        break;
+    case BufferType::Int32:
+        fill_values<int32_t>(buffer.data(), count);
+        break;
+    case BufferType::UnsignedInt32:
+        fill_values<uint32_t>(buffer.data(), count);
+        break;
+    case BufferType::Int64:
+        fill_values<int64_t>(buffer.data(), count);
+        break;
+    case BufferType::Float16:
+        fill_values<Half>(buffer.data(), count);
+        break;
+    case BufferType::Float32:
+        fill_values<float>(buffer.data(), count);
+        break;
+    case BufferType::Float64:
+        fill_values<double>(buffer.data(), count);
+        break;
+    }
+
+    return buffer;
+}
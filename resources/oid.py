@@ -39,9 +39,41 @@ def lldb_stop_hook_handler(debugger, command, result, dict):
     lldbbridge.instance.stop_hook(debugger, command, result, dict)
 
 
+def lldb_plot_live_command(debugger, command, result, internal_dict):
+    """
+    Implements the 'plot-live <location> <variables...>' command for LLDB
+    """
+    import shlex
+    from oidscripts.debuggers import lldbbridge
+
+    args = shlex.split(command)
+    if len(args) < 2:
+        result.SetError('Usage: plot-live <location> <variable>'
+                        ' [<variable>...]')
+        return
+
+    breakpoint_id = lldbbridge.instance.add_live_plot_breakpoint(args[0],
+                                                                 args[1:])
+    if breakpoint_id is None:
+        result.SetError('Could not set a breakpoint at %s' % args[0])
+        return
+
+    result.AppendMessage('Live breakpoint %d set at %s' % (breakpoint_id,
+                                                           args[0]))
+
+
+def lldb_live_plot_callback(frame, bp_loc, internal_dict):
+    from oidscripts.debuggers import lldbbridge
+    return lldbbridge.instance.live_plot_callback(bp_loc)
+
+
 def __lldb_init_module(debugger, internal_dict):
     from oidscripts.debuggers import lldbbridge
 
+    debugger.HandleCommand("command script add -f "
+                           "oid.lldb_plot_live_command "
+                           "plot-live")
+
     def ide_prevents_stop_hook():
         from oidscripts.ides import qtcreator
         ide_checkers = [qtcreator.prevents_stop_hook]
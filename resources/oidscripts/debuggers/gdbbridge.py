@@ -5,8 +5,6 @@ Code responsible with directly interacting with GDB
 """
 
 import gdb
-import time
-import threading
 
 from oidscripts import sysinfo
 from oidscripts.debuggers.interfaces import BridgeInterface
@@ -20,35 +18,26 @@ class GdbBridge(BridgeInterface):
     """
     def __init__(self, type_bridge):
         self._type_bridge = type_bridge
-        self._commands = dict(plot=PlotterCommand(self))
+        self._commands = {'plot': PlotterCommand(self),
+                          'plot-live': LivePlotCommand()}
         self._event_handler = None  # type: BridgeEventHandlerInterface
 
-        self._pending_requests = []
-        self._lock = threading.Lock()
+        # Observable symbols of the scopes visited so far, since listing them
+        # requires inspecting every symbol in scope. See get_available_symbols.
+        self._available_symbols_cache = dict()
 
         gdb.events.stop.connect(self._event_stop_handler)
         gdb.events.exited.connect(self._event_exit_handler)
-
-        event_loop_thread = threading.Thread(target=self.event_loop)
-        event_loop_thread.daemon = True
-        event_loop_thread.start()
-
-    def event_loop(self):
-        while True:
-            requests_to_process = []
-            with self._lock:
-                requests_to_process = self._pending_requests
-                self._pending_requests = []
-
-            while requests_to_process:
-                callback = requests_to_process.pop(0)
-                gdb.post_event(callback)
-
-            time.sleep(0.1)
+        gdb.events.new_objfile.connect(self._event_objfiles_changed_handler)
+        # Not available in older GDB versions
+        if hasattr(gdb.events, 'clear_objfiles'):
+            gdb.events.clear_objfiles.connect(
+                self._event_objfiles_changed_handler)
 
     def queue_request(self, callable_request):
-        with self._lock:
-            self._pending_requests.append(callable_request)
+        # gdb.post_event is thread safe, and runs its events in order in the
+        # GDB main thread as soon as possible
+        gdb.post_event(callable_request)
 
     def get_backend_name(self):
         return 'gdb'
@@ -63,6 +52,102 @@ class GdbBridge(BridgeInterface):
             # Invalid symbol for current frame
             return None
 
+        return self._complete_buffer_metadata(variable, buffer_metadata)
+
+    def prefetch_buffers_metadata(self, variables, read_memory_blocks):
+        # Headers are decoded with the data layout of this machine, so only
+        # local inferiors are read this way
+        native_pid = self._get_native_pid()
+        if native_pid is None:
+            return {}
+
+        headers = []
+        for variable in variables:
+            try:
+                picked_obj = gdb.parse_and_eval(variable)
+                if picked_obj.address is None:
+                    continue
+
+                layout = self._type_bridge.get_buffer_header_layout(
+                    variable, picked_obj, self)
+                if layout is not None:
+                    headers.append((variable, int(picked_obj.address), layout))
+            except gdb.error:
+                # Reported by get_buffer_metadata
+                continue
+
+        if len(headers) == 0:
+            return {}
+
+        headers_contents = read_memory_blocks(
+            native_pid,
+            [(address, layout.size) for _, address, layout in headers])
+
+        prefetched_metadata = dict()
+        for (variable, address, layout), contents in zip(headers,
+                                                         headers_contents):
+            if contents is None:
+                continue
+
+            try:
+                buffer_metadata = layout.decode(variable, address, contents)
+                prefetched_metadata[variable] = self._complete_buffer_metadata(
+                    variable, buffer_metadata)
+            except Exception:
+                # Inspected again (and reported) by get_buffer_metadata
+                continue
+
+        return prefetched_metadata
+
+    def get_member_layout(self, object_type, member_path):
+        offset = 0
+        member_type = object_type
+        for member_name in member_path:
+            member = GdbBridge._find_member(member_type, member_name)
+            if member is None:
+                return None
+
+            member_offset, member_type = member
+            offset += member_offset
+
+        member_type = member_type.strip_typedefs()
+        while member_type.code == gdb.TYPE_CODE_ARRAY:
+            member_type = member_type.target().strip_typedefs()
+
+        return offset, member_type.sizeof
+
+    @staticmethod
+    def _find_member(struct_type, member_name):
+        """
+        Get the (offset in bytes, type) of the non static member 'member_name'
+        of struct_type, which may have been inherited from one of its bases or
+        belong to an anonymous union
+        """
+        struct_type = struct_type.strip_typedefs()
+        if struct_type.code not in (gdb.TYPE_CODE_STRUCT,
+                                    gdb.TYPE_CODE_UNION):
+            return None
+
+        for field in struct_type.fields():
+            # Static members have no position
+            if not hasattr(field, 'bitpos'):
+                continue
+
+            if field.name == member_name:
+                return field.bitpos // 8, field.type
+
+            if field.is_base_class or not field.name:
+                member = GdbBridge._find_member(field.type, member_name)
+                if member is not None:
+                    return field.bitpos // 8 + member[0], member[1]
+
+        return None
+
+    def _complete_buffer_metadata(self, variable, buffer_metadata):
+        """
+        Validate the metadata returned by a type inspector, and complete it
+        with the fields required by the native bridge
+        """
         bufsize = sysinfo.get_buffer_size(
             buffer_metadata['height'],
             buffer_metadata['channels'],
@@ -75,29 +160,64 @@ class GdbBridge(BridgeInterface):
             raise Exception('Invalid null buffer pointer')
         if bufsize == 0:
             raise Exception('Invalid buffer of zero bytes')
-        elif bufsize >= sysinfo.get_available_memory() / 10:
-            raise Exception('Invalid buffer size larger than available memory')
+
+        # Header layouts give the buffer address directly
+        buffer_address = buffer_metadata['pointer']
+        if isinstance(buffer_address, gdb.Value):
+            buffer_address = int(buffer_address.cast(gdb.lookup_type('long')))
 
         # Check if buffer is valid. If it isn't, this function will throw an
         # exception
-        gdb.execute('x ' + str(int(buffer_metadata['pointer'].cast(gdb.lookup_type('long')))))
+        gdb.execute('x ' + str(buffer_address))
 
-        inferior = gdb.selected_inferior()
         buffer_metadata['variable_name'] = variable
-        buffer_metadata['pointer'] = inferior.read_memory(
-            buffer_metadata['pointer'], bufsize)
+
+        # The buffer is read by the native bridge: directly from the inferior
+        # memory if it is a local process, or else with read_memory
+        buffer_metadata['pointer'] = buffer_address
+        native_pid = self._get_native_pid()
+        if native_pid is not None:
+            buffer_metadata['pid'] = native_pid
+
+        if sysinfo.is_lazy_buffer_size(bufsize):
+            # Only the regions displayed by the window will be read
+            buffer_metadata['lazy'] = True
 
         return buffer_metadata
 
+    @staticmethod
+    def _get_native_pid():
+        """
+        Get the PID of the inferior if it runs on this machine. The memory of
+        remote inferiors can only be read through GDB.
+        """
+        inferior = gdb.selected_inferior()
+        # Older GDB versions can't tell whether the inferior is remote
+        connection = getattr(inferior, 'connection', None)
+        if connection is None or connection.type != 'native' or \
+                inferior.pid == 0:
+            return None
+        return inferior.pid
+
+    def read_memory(self, address, length):
+        return gdb.selected_inferior().read_memory(address, length)
+
     def _event_stop_handler(self, event):
         self._event_handler.stop_handler()
 
     def _event_exit_handler(self, event):
         self._event_handler.exit_handler()
 
+    def _event_objfiles_changed_handler(self, event):
+        # The cached scopes and types may refer to unloaded symbol files
+        self._available_symbols_cache.clear()
+        self._type_bridge.invalidate_cache()
+
     def register_event_handlers(self, event_handler):
         self._event_handler = event_handler
         self._commands['plot'].set_command_listener(event_handler.plot_handler)
+        self._commands['plot-live'].set_command_listener(
+            event_handler.live_plot_handler)
 
     def get_fields_from_type(self, this_type, observable_symbols):
         """
@@ -126,6 +246,14 @@ class GdbBridge(BridgeInterface):
     def get_available_symbols(self):
         frame = gdb.selected_frame()
         block = frame.block()
+
+        # The symbols in scope are given by the innermost block, which also
+        # belongs to a single function (and thus a single type of 'this')
+        scope_key = (str(frame.function()), block.start, block.end)
+        cached_symbols = self._available_symbols_cache.get(scope_key)
+        if cached_symbols is not None:
+            return set(cached_symbols)
+
         observable_symbols = set()
 
         while block is not None:
@@ -154,6 +282,9 @@ class GdbBridge(BridgeInterface):
 
             block = block.superblock
 
+        self._available_symbols_cache[scope_key] = frozenset(
+            observable_symbols)
+
         return observable_symbols
 
 
@@ -184,3 +315,58 @@ class PlotterCommand(gdb.Command):
 
         if self._command_listener is not None:
             self._command_listener(var_name)
+
+
+class LivePlotCommand(gdb.Command):
+    """
+    Implements the 'plot-live <location> <variables...>' command, which sets a
+    breakpoint at location that plots the variables whenever it is hit, and
+    lets the inferior run on right away. It is removed like any breakpoint.
+    """
+    def __init__(self):
+        super(LivePlotCommand, self).__init__("plot-live",
+                                              gdb.COMMAND_BREAKPOINTS,
+                                              gdb.COMPLETE_LOCATION)
+        self._command_listener = None
+
+    def set_command_listener(self, callback):
+        """
+        Configure the callback called with the variables of a live breakpoint
+        whenever it is hit.
+        """
+        self._command_listener = callback
+
+    def invoke(self, arg, from_tty):
+        args = gdb.string_to_argv(arg)
+        if len(args) < 2:
+            raise gdb.GdbError('Usage: plot-live <location> <variable>'
+                               ' [<variable>...]')
+
+        LivePlotBreakpoint(args[0], args[1:], self)
+
+    def notify_hit(self, variables):
+        if self._command_listener is not None:
+            self._command_listener(variables)
+
+
+class LivePlotBreakpoint(gdb.Breakpoint):
+    """
+    Breakpoint set by the 'plot-live' command
+    """
+    def __init__(self, location, variables, command):
+        super(LivePlotBreakpoint, self).__init__(location)
+        self._variables = variables
+        self._command = command
+
+    def stop(self):
+        """
+        Called by GDB whenever the breakpoint is hit, before the inferior
+        stops. Returning False lets it continue without raising a stop event.
+        """
+        try:
+            self._command.notify_hit(self._variables)
+        except Exception as err:
+            print('[OpenImageDebugger] Error: Could not plot live variables')
+            print(err)
+
+        return False
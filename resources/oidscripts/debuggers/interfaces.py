@@ -34,17 +34,57 @@ class BridgeInterface(object):
         type: (str) -> {
             variable_name:str,
             display_name:str,
-            pointer:Union(memoryview, buffer),
+            pointer:Union(memoryview, buffer, int (address in the inferior)),
             width:int,
             height:int,
             channels:int,
             type:int (see symbols.py),
             row_stride:int,
             pixel_layout:str,
+            [lazy:bool] (if True, pointer is the buffer address:int),
+            [pid:int] (local inferior process, read without the debugger),
+            [planar:bool] (channels stored as planes, one after the other),
+            [batch:int] (number of planar images, one after the other),
+            [batch_index:int] (only image of the batch to display),
         }
         """
         raise NotImplementedError("Method is not implemented")
 
+    def prefetch_buffers_metadata(self, variables, read_memory_blocks):
+        # type: (list, Callable[[int, list], list]) -> dict
+        """
+        Optionally get the metadata of several variables at once, e.g. by
+        reading the objects describing them from the inferior memory in a
+        single batch instead of inspecting each of their fields through the
+        debugger API. 'read_memory_blocks(pid, [(address, length), ...])'
+        reads blocks of the memory of a local process, and returns a list with
+        their contents (or None for those which couldn't be read).
+
+        Returns a dict with the metadata (as given by get_buffer_metadata) of
+        the variables which could be handled this way; the others are given
+        to get_buffer_metadata.
+        """
+        return {}
+
+    def get_member_layout(self, object_type, member_path):
+        # type: (object, list) -> Optional[tuple]
+        """
+        Optionally get the (offset, size) in bytes of the member of the
+        struct type 'object_type' given by the list of member names
+        'member_path' (e.g. ['step', 'buf']). Arrays are described by their
+        first element. Returns None if the member can't be located.
+        """
+        return None
+
+    @abc.abstractmethod
+    def read_memory(self, address, length):
+        # type: (int, int) -> Union(memoryview, buffer)
+        """
+        Read 'length' bytes at 'address' in the inferior memory. Used to fetch
+        the displayed regions of buffers too large to be read up front.
+        """
+        raise NotImplementedError("Method is not implemented")
+
     @abc.abstractmethod
     def get_backend_name(self):
         # type: () -> str
@@ -113,6 +153,15 @@ class BridgeEventHandlerInterface(object):
         """
         raise NotImplementedError("Method is not implemented")
 
+    @abc.abstractmethod
+    def live_plot_handler(self, variable_names):
+        """
+        Handler to be called whenever a breakpoint set with the 'plot-live'
+        command is hit. The inferior runs on as soon as it returns, without
+        raising a stop event.
+        """
+        raise NotImplementedError("Method is not implemented")
+
 
 class DebuggerSymbolReference(object):
     __metaclass__ = abc.ABCMeta
@@ -5,7 +5,6 @@ Code responsible with directly interacting with LLDB
 """
 
 import lldb
-import time
 import threading
 
 from oidscripts import sysinfo
@@ -29,10 +28,13 @@ class LldbBridge(BridgeInterface):
         self._type_bridge = type_bridge
         self._pending_requests = []
         self._lock = threading.Lock()
+        self._request_queued = threading.Condition(self._lock)
         self._event_queue = []
         self._event_handler = None
         self._last_thread_id = 0
         self._last_frame_idx = 0
+        # Variables plotted by each live breakpoint, by breakpoint ID
+        self._live_plots = dict()
         event_loop_thread = threading.Thread(target=self.event_loop)
         event_loop_thread.daemon = True
         event_loop_thread.start()
@@ -65,6 +67,12 @@ class LldbBridge(BridgeInterface):
 
     def event_loop(self):
         while True:
+            with self._lock:
+                # LLDB stops can't be listened to from here, so frame changes
+                # are polled for. New requests wake the loop up right away.
+                if not self._pending_requests:
+                    self._request_queued.wait(0.1)
+
             self._check_frame_modification()
 
             requests_to_process = []
@@ -86,12 +94,11 @@ class LldbBridge(BridgeInterface):
                 callback = requests_to_process.pop(0)
                 callback()
 
-            time.sleep(0.1)
-
     def queue_request(self, callable_request):
         # type: (Callable[[None],None]) -> None
         with self._lock:
             self._pending_requests.append(callable_request)
+            self._request_queued.notify()
 
     def _get_process(self, debugger):
         # type: (lldb.SBDebugger) -> lldb.SBProcess
@@ -142,15 +149,26 @@ class LldbBridge(BridgeInterface):
             raise Exception('Invalid null buffer pointer')
         if bufsize == 0:
             raise Exception('Invalid buffer of zero bytes')
-        elif bufsize >= sysinfo.get_available_memory() / 10:
-            raise Exception('Invalid buffer size larger than available memory')
 
         buffer_metadata['variable_name'] = variable
-        buffer_metadata['pointer'] = memoryview(process.ReadMemory(
-            buffer_metadata['pointer'], bufsize, lldb.SBError()))
+
+        # The buffer is read by the native bridge: directly from the inferior
+        # memory if it is a local process, or else with read_memory. The
+        # memory of remote inferiors can only be read through LLDB.
+        target = self.get_lldb_backend().GetSelectedTarget()
+        if target.GetPlatform().GetName() == 'host':
+            buffer_metadata['pid'] = process.GetProcessID()
+
+        if sysinfo.is_lazy_buffer_size(bufsize):
+            # Only the regions displayed by the window will be read
+            buffer_metadata['lazy'] = True
 
         return buffer_metadata
 
+    def read_memory(self, address, length):
+        process = self._get_process(self.get_lldb_backend())
+        return memoryview(process.ReadMemory(address, length, lldb.SBError()))
+
     def register_event_handlers(self, event_handler):
         self._event_handler = event_handler
 
@@ -208,6 +226,44 @@ class LldbBridge(BridgeInterface):
         with self._lock:
             self._event_queue.append('stop')
 
+    def add_live_plot_breakpoint(self, location, variables):
+        # type: (str, list) -> int
+        """
+        Set a breakpoint at 'location' (a function name, or file:line) which
+        plots 'variables' whenever it is hit, and lets the inferior run on
+        right away. Returns the breakpoint ID, or None if it can't be set.
+        """
+        target = self.get_lldb_backend().GetSelectedTarget()
+        file_name, _, line = location.rpartition(':')
+        if file_name and line.isdigit():
+            breakpoint = target.BreakpointCreateByLocation(file_name,
+                                                           int(line))
+        else:
+            breakpoint = target.BreakpointCreateByName(location)
+
+        if not breakpoint.IsValid():
+            return None
+
+        self._live_plots[breakpoint.GetID()] = variables
+        breakpoint.SetScriptCallbackFunction('oid.lldb_live_plot_callback')
+        return breakpoint.GetID()
+
+    def live_plot_callback(self, bp_loc):
+        """
+        Called by LLDB whenever a live breakpoint is hit. Returning False lets
+        the inferior continue.
+        """
+        variables = self._live_plots.get(bp_loc.GetBreakpoint().GetID())
+        if variables is not None and self._event_handler is not None:
+            try:
+                self._event_handler.live_plot_handler(variables)
+            except Exception as err:
+                print('[OpenImageDebugger] Error: Could not plot live'
+                      ' variables')
+                print(err)
+
+        return False
+
 
 class SymbolWrapper(DebuggerSymbolReference):
     def __init__(self, symbol):
@@ -22,10 +22,23 @@ class OpenImageDebuggerEvents(BridgeEventHandlerInterface):
         Retrieve the list of available symbols and provide it to the OID window
         for autocompleting.
         """
+        # Headless sessions have no symbol list to complete
+        if self._window.is_headless():
+            return
+
         observable_symbols = list(self._debugger.get_available_symbols())
         if self._window.is_ready():
             self._window.set_available_symbols(observable_symbols)
 
+    def _wait_for_window(self):
+        """
+        Block until the window is up and running
+        """
+        if not self._window.is_ready():
+            self._window.initialize_window()
+            while not self._window.is_ready():
+                time.sleep(0.1)
+
     def exit_handler(self):
         self._window.terminate()
 
@@ -34,16 +47,15 @@ class OpenImageDebuggerEvents(BridgeEventHandlerInterface):
         The debugger has stopped (e.g. a breakpoint was hit). We must list all
         available buffers and pass it to the Open Image Debugger window.
         """
-        # Block until the window is up and running
-        if not self._window.is_ready():
-            self._window.initialize_window()
-            while not self._window.is_ready():
-                time.sleep(0.1)
+        self._wait_for_window()
+
+        # Drop what is still queued for the previous stops
+        self._window.begin_stop_generation()
 
         # Update buffers being visualized
         observed_buffers = self._window.get_observed_buffers()
-        for buffer_name in observed_buffers:
-            self._window.plot_variable(buffer_name)
+        if len(observed_buffers) > 0:
+            self._window.plot_variables(observed_buffers)
 
         # Set list of available symbols
         self._set_symbol_complete_list()
@@ -53,3 +65,11 @@ class OpenImageDebuggerEvents(BridgeEventHandlerInterface):
         Command window to plot variable_name if user requests from debugger log
         """
         self._window.plot_variable(variable_name)
+
+    def live_plot_handler(self, variable_names):
+        """
+        A live breakpoint was hit: its variables are plotted before the
+        inferior runs on
+        """
+        self._wait_for_window()
+        self._window.plot_live_variables(variable_names)
@@ -12,26 +12,68 @@ from oidscripts import symbols
 from oidscripts.oidtypes import interface
 
 
+EIGEN_TYPE_REGEX = re.compile(r'(const\s+)?Eigen::(\s+?[*&])?')
+
+
 class EigenXX(interface.TypeInspectorInterface):
     """
     Implementation for inspecting Eigen::Matrix and Eigen::Map
     """
-    def get_buffer_metadata(self, obj_name, picked_obj, debugger_bridge):
+    # OpenImageDebugger type of each supported scalar type
+    _TYPE_VALUES = {
+        'short': symbols.OID_TYPES_INT16,
+        'float': symbols.OID_TYPES_FLOAT32,
+        'double': symbols.OID_TYPES_FLOAT64,
+        'int': symbols.OID_TYPES_INT32,
+        'signed char': symbols.OID_TYPES_INT8,
+        'unsigned int': symbols.OID_TYPES_UINT32,
+        'long long': symbols.OID_TYPES_INT64,
+        'Eigen::half': symbols.OID_TYPES_FLOAT16,
+    }
+
+    @staticmethod
+    def _get_matrix_type(picked_type):
         """
-        Gets the buffer meta data from types of the Eigen Library
-        Note that it only implements single channel matrix display,
-        which should be quite common in Eigen.
+        Returns whether picked_type is an Eigen::Map, and its matrix type
         """
-
-        type_str = str(picked_obj.type)
-        is_eigen_map = 'Map' in type_str
+        is_eigen_map = 'Map' in str(picked_type)
         # First we need the python object for the actual matrix type. When
         # parsing a Map, the type is the first template parameter of the
         # wrapper type. Otherwise, it is the type field of the picked_obj
         if is_eigen_map:
-            matrix_type_obj = picked_obj.type.template_argument(0)
+            matrix_type_obj = picked_type.template_argument(0)
         else:
-            matrix_type_obj = picked_obj.type
+            matrix_type_obj = picked_type
+
+        return is_eigen_map, matrix_type_obj
+
+    @staticmethod
+    def _make_buffer_metadata(obj_name, matrix_type_obj, buffer, width,
+                              height, type_value, transpose_buffer):
+        # Set row stride and pixel layout
+        pixel_layout = 'bgra'
+        row_stride = width
+
+        return {
+            'display_name': obj_name + ' (' + str(matrix_type_obj) + ')',
+            'pointer': buffer,
+            'width': width,
+            'height': height,
+            'channels': 1,
+            'type': type_value,
+            'row_stride': row_stride,
+            'pixel_layout': pixel_layout,
+            'transpose_buffer': transpose_buffer
+        }
+
+    def get_buffer_metadata(self, obj_name, picked_obj, debugger_bridge):
+        """
+        Gets the buffer meta data from types of the Eigen Library
+        Note that it only implements single channel matrix display,
+        which should be quite common in Eigen.
+        """
+        is_eigen_map, matrix_type_obj = EigenXX._get_matrix_type(
+            picked_obj.type)
 
         current_type = str(matrix_type_obj.template_argument(0))
         height = int(matrix_type_obj.template_argument(1))
@@ -60,14 +102,7 @@ class EigenXX(interface.TypeInspectorInterface):
             width, height = height, width
 
         # Assign the OpenImageDebugger type according to underlying type
-        if current_type == 'short':
-            type_value = symbols.OID_TYPES_INT16
-        elif current_type == 'float':
-            type_value = symbols.OID_TYPES_FLOAT32
-        elif current_type == 'double':
-            type_value = symbols.OID_TYPES_FLOAT64
-        elif current_type == 'int':
-            type_value = symbols.OID_TYPES_INT32
+        type_value = EigenXX._TYPE_VALUES[current_type]
 
         # Differentiate between Map and dynamic/static Matrices
         if is_eigen_map:
@@ -80,21 +115,86 @@ class EigenXX(interface.TypeInspectorInterface):
             buffer = debugger_bridge.get_casted_pointer(
                 current_type, picked_obj['m_storage']['m_data']['array'])
 
-        # Set row stride and pixel layout
-        pixel_layout = 'bgra'
-        row_stride = width
+        return EigenXX._make_buffer_metadata(obj_name,
+                                             matrix_type_obj,
+                                             buffer,
+                                             width,
+                                             height,
+                                             type_value,
+                                             transpose_buffer)
 
-        return {
-            'display_name': obj_name + ' (' + str(matrix_type_obj) + ')',
-            'pointer': buffer,
-            'width': width,
-            'height': height,
-            'channels': 1,
-            'type': type_value,
-            'row_stride': row_stride,
-            'pixel_layout': pixel_layout,
-            'transpose_buffer': transpose_buffer
-        }
+    def get_buffer_header_layout(self, picked_obj, debugger_bridge):
+        """
+        The scalar type and the fixed dimensions are given by the template
+        arguments of the type; only the data pointer and the dynamic
+        dimensions are read from each object
+        """
+        picked_type = picked_obj.type
+        is_eigen_map, matrix_type_obj = EigenXX._get_matrix_type(picked_type)
+
+        current_type = str(matrix_type_obj.template_argument(0))
+        if current_type not in EigenXX._TYPE_VALUES:
+            return None
+
+        type_value = EigenXX._TYPE_VALUES[current_type]
+        fixed_height = int(matrix_type_obj.template_argument(1))
+        fixed_width = int(matrix_type_obj.template_argument(2))
+        matrix_flag = int(matrix_type_obj.template_argument(3))
+        transpose_buffer = ((matrix_flag&0x1) == 0)
+        dynamic_buffer = fixed_height <= 0 or fixed_width <= 0
+
+        if is_eigen_map:
+            members = [('data', ['m_data'], False),
+                       ('rows', ['m_rows', 'm_value'], True),
+                       ('cols', ['m_cols', 'm_value'], True)]
+        else:
+            members = [('data', ['m_storage', 'm_data'], False),
+                       ('rows', ['m_storage', 'm_rows'], True),
+                       ('cols', ['m_storage', 'm_cols'], True)]
+
+        # The contents of fixed size matrices are stored in the object itself
+        inline_data_offset = None
+        if not is_eigen_map and not dynamic_buffer:
+            inline_data = debugger_bridge.get_member_layout(
+                picked_type, ['m_storage', 'm_data', 'array'])
+            if inline_data is None:
+                return None
+            inline_data_offset = inline_data[0]
+            members = []
+        else:
+            if fixed_height > 0:
+                members = [member for member in members
+                           if member[0] != 'rows']
+            if fixed_width > 0:
+                members = [member for member in members
+                           if member[0] != 'cols']
+
+        def decode(obj_name, address, fields):
+            if inline_data_offset is not None:
+                buffer = address + inline_data_offset
+            else:
+                buffer = fields['data']
+
+            height = fields.get('rows', fixed_height)
+            width = fields.get('cols', fixed_width)
+            if transpose_buffer:
+                width, height = height, width
+
+            return EigenXX._make_buffer_metadata(obj_name,
+                                                 matrix_type_obj,
+                                                 buffer,
+                                                 width,
+                                                 height,
+                                                 type_value,
+                                                 transpose_buffer)
+
+        layout = interface.BufferHeaderLayout(decode)
+        for field_name, member_path, is_signed in members:
+            if not layout.add_member(field_name, picked_type, member_path,
+                                     debugger_bridge, is_signed):
+                return None
+
+        return layout
 
     def is_symbol_observable(self, symbol, symbol_name):
         """
@@ -104,5 +204,4 @@ class EigenXX(interface.TypeInspectorInterface):
         """
         # Check if symbol type is the expected buffer
         symbol_type = str(symbol.type)
-        type_regex = r'(const\s+)?Eigen::(\s+?[*&])?'
-        return re.match(type_regex, symbol_type) is not None
+        return EIGEN_TYPE_REGEX.match(symbol_type) is not None
@@ -7,6 +7,7 @@ plotted in the OpenImageDebugger window.
 """
 
 import abc
+import struct
 
 
 def debug_buffer_metadata(func):
@@ -44,6 +45,64 @@ def debug_symbol_observable(func):
     return wrapper
 
 
+class BufferHeaderLayout(object):
+    """
+    Location of the fields describing a buffer within the objects of a given
+    type. Objects of that type can then be decoded from a single block of the
+    inferior memory (their header), instead of through one debugger call per
+    field.
+    """
+    # struct formats of signed integers, by size
+    _INTEGER_FORMATS = {1: 'b', 2: 'h', 4: 'i', 8: 'q'}
+
+    def __init__(self, decode):
+        """
+        'decode(obj_name, address, fields)' must return the buffer metadata,
+        as returned by get_buffer_metadata, of the object at 'address' whose
+        fields (a dict) were read from the inferior. Its pointer is the
+        address of the buffer, as an int.
+        """
+        self._decode = decode
+        self._fields = []
+        self.size = 0
+
+    def add_member(self, field_name, object_type, member_path,
+                   debugger_bridge, is_signed=True):
+        """
+        Read the member of object_type at 'member_path' (as given to
+        BridgeInterface.get_member_layout) as the integer 'field_name'.
+        Returns False if the member can't be read.
+        """
+        member_layout = debugger_bridge.get_member_layout(object_type,
+                                                          member_path)
+        if member_layout is None:
+            return False
+
+        offset, size = member_layout
+        field_format = BufferHeaderLayout._INTEGER_FORMATS.get(size)
+        if field_format is None:
+            return False
+        if not is_signed:
+            field_format = field_format.upper()
+
+        self._fields.append((field_name, offset, '=' + field_format))
+        self.size = max(self.size, offset + size)
+        return True
+
+    def decode(self, obj_name, address, header):
+        """
+        Get the metadata of the object 'obj_name' at 'address', given the
+        first 'size' bytes of its contents
+        """
+        fields = dict()
+        for field_name, offset, field_format in self._fields:
+            fields[field_name] = struct.unpack_from(field_format,
+                                                    header,
+                                                    offset)[0]
+
+        return self._decode(obj_name, address, fields)
+
+
 class TypeInspectorInterface(object):
     """
     This interface defines methods to be implemented by type inspectors that
@@ -71,6 +130,9 @@ class TypeInspectorInterface(object):
          * row_stride
          * pixel_layout
          * transpose_buffer
+         * planar (optional)
+         * batch (optional)
+         * batch_index (optional)
 
          For information about these fields, consult the documentation for
          oid_plot_buffer in the file $ROOT/src/oid_window.h. The module
@@ -89,3 +151,23 @@ class TypeInspectorInterface(object):
         of the buffers that you want to plot).
         """
         pass
+
+    def get_buffer_header_layout(self, picked_obj, debugger_bridge):
+        # type: (DebuggerSymbolReference, BridgeInterface) -> BufferHeaderLayout
+        """
+        Optionally returns the BufferHeaderLayout of the type of picked_obj,
+        which is then used for all objects of that type. Returns None if the
+        objects of this type must be inspected with get_buffer_metadata
+        instead.
+        """
+        return None
+
+    def get_observable_type_names(self):
+        # type: () -> list
+        """
+        Optionally returns the exact names of types known to be observable by
+        this inspector (e.g. 'cv::Mat', 'cv::Mat *'), so that symbols of
+        these types are dispatched to it without calling
+        is_symbol_observable.
+        """
+        return []
@@ -19,6 +19,51 @@ CV_MAT_CN_MASK = ((CV_CN_MAX - 1) << CV_CN_SHIFT)
 CV_DEPTH_MAX = (1 << CV_CN_SHIFT)
 CV_MAT_TYPE_MASK = (CV_DEPTH_MAX * CV_CN_MAX - 1)
 
+MAT_TYPE_REGEX = re.compile(r'(const\s+)?cv::Mat(\s+?[*&])?$')
+CVMAT_TYPE_REGEX = re.compile(r'(const\s+)?CvMat(\s+?[*&])?')
+
+
+def get_cv_buffer_metadata(obj_name, type_name, buffer, width, height, flags,
+                           step):
+    """
+    Describe an OpenCV matrix given its fields, where flags the matrix type
+    and step the length of its rows, in bytes
+    """
+    channels = ((((flags) & CV_MAT_CN_MASK) >> CV_CN_SHIFT) + 1)
+    row_stride = int(int(step)/channels)
+
+    if channels >= 3:
+        pixel_layout = 'bgra'
+    else:
+        pixel_layout = 'rgba'
+
+    cvtype = ((flags) & CV_MAT_TYPE_MASK)
+
+    type_value = (cvtype & 7)
+
+    # OpenCV depths match the OpenImageDebugger types up to CV_16F
+    if (type_value == symbols.OID_TYPES_UINT16 or
+        type_value == symbols.OID_TYPES_INT16 or
+        type_value == symbols.OID_TYPES_FLOAT16):
+        row_stride = int(row_stride / 2)
+    elif (type_value == symbols.OID_TYPES_INT32 or
+          type_value == symbols.OID_TYPES_FLOAT32):
+        row_stride = int(row_stride / 4)
+    elif type_value == symbols.OID_TYPES_FLOAT64:
+        row_stride = int(row_stride / 8)
+
+    return {
+        'display_name':  obj_name + ' (' + type_name + ')',
+        'pointer': buffer,
+        'width': width,
+        'height': height,
+        'channels': channels,
+        'type': type_value,
+        'row_stride': row_stride,
+        'pixel_layout': pixel_layout,
+        'transpose_buffer' : False
+    }
+
 
 class Mat(interface.TypeInspectorInterface):
     """
@@ -27,42 +72,38 @@ class Mat(interface.TypeInspectorInterface):
     def get_buffer_metadata(self, obj_name, picked_obj, debugger_bridge):
         buffer = debugger_bridge.get_casted_pointer('char', picked_obj['data'])
 
-        width = int(picked_obj['cols'])
-        height = int(picked_obj['rows'])
-        flags = int(picked_obj['flags'])
-
-        channels = ((((flags) & CV_MAT_CN_MASK) >> CV_CN_SHIFT) + 1)
-        row_stride = int(int(picked_obj['step']['buf'][0])/channels)
-
-        if channels >= 3:
-            pixel_layout = 'bgra'
-        else:
-            pixel_layout = 'rgba'
-
-        cvtype = ((flags) & CV_MAT_TYPE_MASK)
-
-        type_value = (cvtype & 7)
-
-        if (type_value == symbols.OID_TYPES_UINT16 or
-            type_value == symbols.OID_TYPES_INT16):
-            row_stride = int(row_stride / 2)
-        elif (type_value == symbols.OID_TYPES_INT32 or
-              type_value == symbols.OID_TYPES_FLOAT32):
-            row_stride = int(row_stride / 4)
-        elif type_value == symbols.OID_TYPES_FLOAT64:
-            row_stride = int(row_stride / 8)
-
-        return {
-            'display_name':  obj_name + ' (' + str(picked_obj.type) + ')',
-            'pointer': buffer,
-            'width': width,
-            'height': height,
-            'channels': channels,
-            'type': type_value,
-            'row_stride': row_stride,
-            'pixel_layout': pixel_layout,
-            'transpose_buffer' : False
-        }
+        return get_cv_buffer_metadata(obj_name,
+                                      str(picked_obj.type),
+                                      buffer,
+                                      int(picked_obj['cols']),
+                                      int(picked_obj['rows']),
+                                      int(picked_obj['flags']),
+                                      int(picked_obj['step']['buf'][0]))
+
+    def get_buffer_header_layout(self, picked_obj, debugger_bridge):
+        type_name = str(picked_obj.type)
+
+        def decode(obj_name, address, fields):
+            return get_cv_buffer_metadata(obj_name,
+                                          type_name,
+                                          fields['data'],
+                                          fields['cols'],
+                                          fields['rows'],
+                                          fields['flags'],
+                                          fields['step'])
+
+        layout = interface.BufferHeaderLayout(decode)
+        members = [('data', ['data'], False),
+                   ('cols', ['cols'], True),
+                   ('rows', ['rows'], True),
+                   ('flags', ['flags'], True),
+                   ('step', ['step', 'buf'], False)]
+        for field_name, member_path, is_signed in members:
+            if not layout.add_member(field_name, picked_obj.type, member_path,
+                                     debugger_bridge, is_signed):
+                return None
+
+        return layout
 
     def is_symbol_observable(self, symbol, symbol_name):
         """
@@ -72,8 +113,11 @@ class Mat(interface.TypeInspectorInterface):
         """
         # Check if symbol type is the expected buffer
         symbol_type = str(symbol.type)
-        type_regex = r'(const\s+)?cv::Mat(\s+?[*&])?$'
-        return re.match(type_regex, symbol_type) is not None
+        return MAT_TYPE_REGEX.match(symbol_type) is not None
+
+    def get_observable_type_names(self):
+        return ['cv::Mat', 'cv::Mat *', 'cv::Mat &',
+                'const cv::Mat', 'const cv::Mat *', 'const cv::Mat &']
 
 class CvMat(interface.TypeInspectorInterface):
     """
@@ -84,44 +128,46 @@ class CvMat(interface.TypeInspectorInterface):
         if buffer == 0x0:
             raise Exception('Received null buffer!')
 
-        width = int(picked_obj['cols'])
-        height = int(picked_obj['rows'])
-        flags = int(picked_obj['type'])
-
-        channels = ((((flags) & CV_MAT_CN_MASK) >> CV_CN_SHIFT) + 1)
-        row_stride = int(int(picked_obj['step'])/channels)
-
-        if channels >= 3:
-            pixel_layout = 'bgra'
-        else:
-            pixel_layout = 'rgba'
-
-        cvtype = ((flags) & CV_MAT_TYPE_MASK)
-
-        type_value = (cvtype & 7)
-
-        if (type_value == symbols.OID_TYPES_UINT16 or
-            type_value == symbols.OID_TYPES_INT16):
-            row_stride = int(row_stride / 2)
-        elif (type_value == symbols.OID_TYPES_INT32 or
-              type_value == symbols.OID_TYPES_FLOAT32):
-            row_stride = int(row_stride / 4)
-        elif type_value == symbols.OID_TYPES_FLOAT64:
-            row_stride = int(row_stride / 8)
-
-        return {
-            'display_name':  obj_name + ' (' + str(picked_obj.type) + ')',
-            'pointer': buffer,
-            'width': width,
-            'height': height,
-            'channels': channels,
-            'type': type_value,
-            'row_stride': row_stride,
-            'pixel_layout': pixel_layout,
-            'transpose_buffer': False
-        }
+        return get_cv_buffer_metadata(obj_name,
+                                      str(picked_obj.type),
+                                      buffer,
+                                      int(picked_obj['cols']),
+                                      int(picked_obj['rows']),
+                                      int(picked_obj['type']),
+                                      int(picked_obj['step']))
+
+    def get_buffer_header_layout(self, picked_obj, debugger_bridge):
+        type_name = str(picked_obj.type)
+
+        def decode(obj_name, address, fields):
+            if fields['data'] == 0x0:
+                raise Exception('Received null buffer!')
+
+            return get_cv_buffer_metadata(obj_name,
+                                          type_name,
+                                          fields['data'],
+                                          fields['cols'],
+                                          fields['rows'],
+                                          fields['type'],
+                                          fields['step'])
+
+        layout = interface.BufferHeaderLayout(decode)
+        members = [('data', ['data', 'ptr'], False),
+                   ('cols', ['cols'], True),
+                   ('rows', ['rows'], True),
+                   ('type', ['type'], True),
+                   ('step', ['step'], True)]
+        for field_name, member_path, is_signed in members:
+            if not layout.add_member(field_name, picked_obj.type, member_path,
+                                     debugger_bridge, is_signed):
+                return None
+
+        return layout
 
     def is_symbol_observable(self, symbol, symbol_name):
         symbol_type = str(symbol.type)
-        type_regex = r'(const\s+)?CvMat(\s+?[*&])?'
-        return re.match(type_regex, symbol_type) is not None
+        return CVMAT_TYPE_REGEX.match(symbol_type) is not None
+
+    def get_observable_type_names(self):
+        return ['CvMat', 'CvMat *', 'CvMat &',
+                'const CvMat', 'const CvMat *', 'const CvMat &']
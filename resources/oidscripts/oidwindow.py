@@ -6,9 +6,14 @@ Classes related to exposing an interface to the OpenImageDebugger window
 
 import ctypes
 import ctypes.util
+import os
 import platform
+import select
+import socket
 import sys
-import time
+import threading
+
+from oidscripts.tracing import PlotTracer
 
 FETCH_BUFFER_CBK_TYPE = ctypes.CFUNCTYPE(ctypes.c_int,
                                          ctypes.c_char_p)
@@ -26,12 +31,18 @@ class OpenImageDebuggerWindow(object):
         self._bridge = bridge
         self._script_path = script_path
 
+        # Headless sessions save the plotted buffers to OID_CAPTURE_DIR
+        # instead of showing them in a window
+        self._capture_options = OpenImageDebuggerWindow.__get_capture_options()
+
         # Request ctypes to load libGL before the native oidwindow does; this
         # fixes an issue on Ubuntu machines with nvidia drivers. For more
         # information, please refer to
         # https://github.com/csantosbh/gdb-imagewatch/issues/28
-        lib_opengl = 'opengl32' if PLATFORM_NAME == 'windows' else 'GL'
-        ctypes.CDLL(ctypes.util.find_library(lib_opengl), ctypes.RTLD_GLOBAL)
+        if not self.is_headless():
+            lib_opengl = 'opengl32' if PLATFORM_NAME == 'windows' else 'GL'
+            ctypes.CDLL(ctypes.util.find_library(lib_opengl),
+                        ctypes.RTLD_GLOBAL)
 
         # Load OpenImageDebugger library and set up its API
         self._lib = ctypes.cdll.LoadLibrary(
@@ -60,7 +71,13 @@ class OpenImageDebuggerWindow(object):
         self._lib.oid_set_available_symbols.restype = None
 
         self._lib.oid_run_event_loop.argtypes = [ctypes.c_void_p]
-        self._lib.oid_run_event_loop.restype = None
+        self._lib.oid_run_event_loop.restype = ctypes.c_bool
+
+        self._lib.oid_begin_stop_generation.argtypes = [ctypes.c_void_p]
+        self._lib.oid_begin_stop_generation.restype = ctypes.c_int
+
+        self._lib.oid_get_socket_descriptor.argtypes = [ctypes.c_void_p]
+        self._lib.oid_get_socket_descriptor.restype = ctypes.c_longlong
 
         self._lib.oid_plot_buffer.argtypes = [
             ctypes.c_void_p,
@@ -68,16 +85,80 @@ class OpenImageDebuggerWindow(object):
         ]
         self._lib.oid_plot_buffer.restype = None
 
+        self._lib.oid_read_memory_blocks.argtypes = [
+            ctypes.c_void_p,
+            ctypes.c_ulonglong,
+            ctypes.py_object
+        ]
+        self._lib.oid_read_memory_blocks.restype = ctypes.py_object
+
+        self._lib.oid_plot_buffers.argtypes = [
+            ctypes.c_void_p,
+            ctypes.py_object
+        ]
+        self._lib.oid_plot_buffers.restype = None
+
+        self._lib.oid_plot_live_buffers.argtypes = [
+            ctypes.c_void_p,
+            ctypes.py_object
+        ]
+        self._lib.oid_plot_live_buffers.restype = None
+
+        PlotTracer.declare_api(self._lib)
+
         # UI handler
         self._native_handler = None
-        self._event_loop_wait_time = 1.0/30.0
-        self._previous_evloop_time = OpenImageDebuggerWindow.__get_time_ms()
         self._plot_variable_c_callback = FETCH_BUFFER_CBK_TYPE(self.plot_variable)
 
+        # State of the event loop, which is scheduled by the event watcher
+        # thread whenever the UI sends messages or the bridge has pending work
+        self._socket_descriptor = -1
+        self._has_pending_work = False
+        self._event_loop_done = threading.Event()
+        self._wakeup_reader, self._wakeup_writer = socket.socketpair()
+
+        # Variables whose plot is queued but hasn't started yet. Further
+        # requests to plot them are coalesced with the queued one.
+        self._pending_plots = set()
+        self._pending_plots_lock = threading.Lock()
+
+        # Number of the current stop of the inferior. Plots queued during
+        # previous stops are dropped.
+        self._stop_generation = 0
 
     @staticmethod
-    def __get_time_ms():
-        return int(time.time() * 1000.0)
+    def __get_capture_options():
+        """
+        Return the options of the bridge for headless sessions, read from the
+        environment, or an empty dict if the session shows a window:
+            OID_CAPTURE_DIR: directory the buffers are saved to
+            OID_CAPTURE_WATCH: comma separated symbols saved at every stop
+            OID_CAPTURE_QUEUE_MB: memory held by the buffers waiting to be
+                                  written (512 MiB by default)
+        """
+        capture_dir = os.environ.get('OID_CAPTURE_DIR', '')
+        if not capture_dir:
+            return {}
+
+        watched_symbols = os.environ.get('OID_CAPTURE_WATCH', '').split(',')
+        options = {
+            'capture_dir': os.path.abspath(capture_dir),
+            'capture_watch': [symbol.strip() for symbol in watched_symbols
+                              if symbol.strip()]
+        }
+
+        queue_mb = os.environ.get('OID_CAPTURE_QUEUE_MB', '')
+        if queue_mb.isdigit():
+            options['capture_queue_mb'] = int(queue_mb)
+
+        return options
+
+    def is_headless(self):
+        """
+        Returns True if the plotted buffers are saved to disk instead of being
+        shown in a window
+        """
+        return len(self._capture_options) > 0
 
     @staticmethod
     def __get_library_name():
@@ -114,11 +195,20 @@ class OpenImageDebuggerWindow(object):
             else:
                 variable = requested_symbol
 
+            with self._pending_plots_lock:
+                if variable in self._pending_plots:
+                    return 1
+                self._pending_plots.add(variable)
+                generation = self._stop_generation
+
             plot_callable = DeferredVariablePlotter(variable,
                                                     self._lib,
                                                     self._bridge,
-                                                    self._native_handler)
+                                                    self._native_handler,
+                                                    self._start_pending_plots,
+                                                    generation)
             self._bridge.queue_request(plot_callable)
+            self._wake_up_event_loop()
             return 1
         except Exception as err:
             print('[OpenImageDebugger] Error: Could not plot variable')
@@ -126,6 +216,107 @@ class OpenImageDebuggerWindow(object):
 
         return 0
 
+    def plot_variables(self, requested_symbols):
+        """
+        Plot all variables whose names are in the list 'requested_symbols'.
+
+        Similar to plot_variable, but all buffers are sent to the window in a
+        single batch, which is then updated all at once.
+        """
+        if self._bridge is None:
+            print('[OpenImageDebugger] Could not plot symbols: Not a debugging'
+                  ' session.')
+            return 0
+
+        try:
+            variables = [symbol.decode('utf-8')
+                         if not isinstance(symbol, str) else symbol
+                         for symbol in requested_symbols]
+
+            # The order of the variables (which is their priority) is kept
+            with self._pending_plots_lock:
+                variables = [variable for variable in variables
+                             if variable not in self._pending_plots]
+                self._pending_plots.update(variables)
+                generation = self._stop_generation
+
+            if not variables:
+                return 1
+
+            plot_callable = DeferredVariableBatchPlotter(
+                variables,
+                self._lib,
+                self._bridge,
+                self._native_handler,
+                self._start_pending_plots,
+                generation)
+            self._bridge.queue_request(plot_callable)
+            self._wake_up_event_loop()
+            return 1
+        except Exception as err:
+            print('[OpenImageDebugger] Error: Could not plot variables')
+            print(err)
+
+        return 0
+
+    def plot_live_variables(self, requested_symbols):
+        """
+        Plot the variables of a live breakpoint which was just hit. Must be
+        called in the debugger main thread, since the inferior runs on as soon
+        as this returns: their buffers are read right away, and sent in the
+        background. Frames are dropped when the window falls behind.
+        """
+        if self._bridge is None:
+            print('[OpenImageDebugger] Could not plot symbols: Not a debugging'
+                  ' session.')
+            return 0
+
+        try:
+            variables = [symbol.decode('utf-8')
+                         if not isinstance(symbol, str) else symbol
+                         for symbol in requested_symbols]
+
+            DeferredVariableBatchPlotter(variables,
+                                         self._lib,
+                                         self._bridge,
+                                         self._native_handler,
+                                         live=True)()
+            self._wake_up_event_loop()
+            return 1
+        except Exception as err:
+            print('[OpenImageDebugger] Error: Could not plot variables')
+            print(err)
+
+        return 0
+
+    def _start_pending_plots(self, variables, generation):
+        """
+        Called once the plot of 'variables' starts: new requests to plot them
+        must be queued again, since they would see a newer state.
+
+        Returns False if the plot was queued before the last stop of the
+        inferior, in which case it must be dropped.
+        """
+        with self._pending_plots_lock:
+            if generation != self._stop_generation:
+                return False
+
+            self._pending_plots.difference_update(variables)
+            return True
+
+    def begin_stop_generation(self):
+        """
+        Must be called whenever the inferior stops, before its buffers are
+        replotted. Plots queued during the previous stops, and the buffers
+        which the bridge didn't start sending yet, are dropped.
+        """
+        with self._pending_plots_lock:
+            self._stop_generation = self._lib.oid_begin_stop_generation(
+                self._native_handler)
+
+            # The dropped plots can't be coalesced with anymore
+            self._pending_plots.clear()
+
     def is_ready(self):
         """
         Returns True if the OpenImageDebugger window has been loaded; False otherwise.
@@ -159,16 +350,45 @@ class OpenImageDebuggerWindow(object):
     def run_event_loop(self):
         """
         Run the debugger-side event loop, which consists of checking for new
-        user requests coming from the UI
+        user requests coming from the UI and sending pending buffers
         """
-        current_time = OpenImageDebuggerWindow.__get_time_ms()
-        dt = current_time - self._previous_evloop_time
-        if dt > self._event_loop_wait_time:
-            self._lib.oid_run_event_loop(self._native_handler)
-            self._previous_evloop_time = current_time
+        try:
+            self._has_pending_work = self._lib.oid_run_event_loop(
+                self._native_handler)
+            self._socket_descriptor = self._lib.oid_get_socket_descriptor(
+                self._native_handler)
+        finally:
+            self._event_loop_done.set()
+
+    def _wake_up_event_loop(self):
+        """
+        Make the event watcher schedule the event loop, e.g. to send a buffer
+        which has just been queued for plotting
+        """
+        self._wakeup_writer.send(b'\0')
 
-        # Schedule next run of the event loop
-        self._bridge.queue_request(self.run_event_loop)
+    def _watch_events(self):
+        """
+        Schedule the event loop whenever there is work for it, instead of
+        polling for it. Runs in its own thread.
+        """
+        while self._socket_descriptor >= 0:
+            if not self._has_pending_work:
+                try:
+                    readable, _, _ = select.select(
+                        [self._socket_descriptor, self._wakeup_reader], [], [])
+                except (OSError, ValueError, select.error):
+                    # The socket was closed
+                    break
+
+                if self._wakeup_reader in readable:
+                    self._wakeup_reader.recv(4096)
+
+            # The socket remains readable until the event loop has consumed
+            # its messages
+            self._event_loop_done.clear()
+            self._bridge.queue_request(self.run_event_loop)
+            self._event_loop_done.wait()
 
     def get_observed_buffers(self):
         """
@@ -178,15 +398,23 @@ class OpenImageDebuggerWindow(object):
 
     def initialize_window(self):
         # Initialize OID lib
+        parameters = {'oid_path': self._script_path,
+                      'read_memory': self._bridge.read_memory}
+        parameters.update(self._capture_options)
+
         self._native_handler = self._lib.oid_initialize(
             self._plot_variable_c_callback,
-            {'oid_path': self._script_path})
+            parameters)
 
         # Launch UI
         self._lib.oid_exec(self._native_handler)
 
         # Schedule event loop
-        self._bridge.queue_request(self.run_event_loop)
+        self._socket_descriptor = self._lib.oid_get_socket_descriptor(
+            self._native_handler)
+        event_watcher_thread = threading.Thread(target=self._watch_events)
+        event_watcher_thread.daemon = True
+        event_watcher_thread.start()
 
 
 class DeferredVariablePlotter(object):
@@ -195,25 +423,123 @@ class DeferredVariablePlotter(object):
     a buffer plot command. Useful for deferring the plot command to a safe
     thread.
     """
-    def __init__(self, variable, lib, bridge, native_handler):
+    def __init__(self, variable, lib, bridge, native_handler, on_start=None,
+                 generation=0):
         self._variable = variable
         self._lib = lib
         self._bridge = bridge
         self._native_handler = native_handler
+        self._on_start = on_start
+        self._generation = generation
+        self._tracer = PlotTracer(lib)
 
     def __call__(self):
+        if self._on_start is not None and \
+                not self._on_start([self._variable], self._generation):
+            return
+
         try:
-            buffer_metadata = self._bridge.get_buffer_metadata(self._variable)
+            request_id = self._tracer.new_request_id()
+
+            with self._tracer.span('get_buffer_metadata', request_id,
+                                   self._variable):
+                buffer_metadata = self._bridge.get_buffer_metadata(
+                    self._variable)
 
             if buffer_metadata is None:
                 return
 
-            self._lib.oid_plot_buffer(
-                self._native_handler,
-                buffer_metadata)
+            PlotTracer.tag(buffer_metadata, request_id)
+
+            with self._tracer.span('oid_plot_buffer', request_id,
+                                   self._variable):
+                self._lib.oid_plot_buffer(
+                    self._native_handler,
+                    buffer_metadata)
 
         except Exception as err:
             import traceback
             print('[OpenImageDebugger] Error: Could not plot variable')
             print(err)
             traceback.print_exc()
+
+
+class DeferredVariableBatchPlotter(object):
+    """
+    Callable object that plots a list of variables at once. Like
+    DeferredVariablePlotter, it is meant to be executed in a safe thread.
+    Live plots are read right away by the bridge (see plot_live_variables).
+    """
+    def __init__(self, variables, lib, bridge, native_handler, on_start=None,
+                 generation=0, live=False):
+        self._variables = variables
+        self._live = live
+        self._lib = lib
+        self._bridge = bridge
+        self._native_handler = native_handler
+        self._on_start = on_start
+        self._generation = generation
+        self._tracer = PlotTracer(lib)
+
+    def __call__(self):
+        if self._on_start is not None and \
+                not self._on_start(self._variables, self._generation):
+            return
+
+        buffers_metadata = []
+        request_ids = dict((variable, self._tracer.new_request_id())
+                           for variable in self._variables)
+
+        # Buffers of known types are described in one go from their headers.
+        # The batch is traced under the request of its first buffer.
+        try:
+            with self._tracer.span('prefetch_buffers_metadata',
+                                   request_ids[self._variables[0]]):
+                prefetched_metadata = self._bridge.prefetch_buffers_metadata(
+                    self._variables, self._read_memory_blocks)
+        except Exception as err:
+            print('[OpenImageDebugger] Warning: Could not prefetch the'
+                  ' metadata of the plotted variables')
+            print(err)
+            prefetched_metadata = {}
+
+        for variable in self._variables:
+            try:
+                buffer_metadata = prefetched_metadata.get(variable)
+                if buffer_metadata is None:
+                    with self._tracer.span('get_buffer_metadata',
+                                           request_ids[variable], variable):
+                        buffer_metadata = self._bridge.get_buffer_metadata(
+                            variable)
+
+                if buffer_metadata is not None:
+                    PlotTracer.tag(buffer_metadata, request_ids[variable])
+                    buffers_metadata.append(buffer_metadata)
+
+            except Exception as err:
+                import traceback
+                print('[OpenImageDebugger] Error: Could not plot variable')
+                print(err)
+                traceback.print_exc()
+
+        if len(buffers_metadata) == 0:
+            return
+
+        plot_buffers = self._lib.oid_plot_live_buffers if self._live \
+            else self._lib.oid_plot_buffers
+
+        try:
+            with self._tracer.span(plot_buffers.__name__,
+                                   request_ids[self._variables[0]]):
+                plot_buffers(self._native_handler, buffers_metadata)
+
+        except Exception as err:
+            import traceback
+            print('[OpenImageDebugger] Error: Could not plot variables')
+            print(err)
+            traceback.print_exc()
+
+    def _read_memory_blocks(self, pid, blocks):
+        return self._lib.oid_read_memory_blocks(self._native_handler,
+                                                pid,
+                                                blocks)
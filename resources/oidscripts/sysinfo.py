@@ -99,18 +99,35 @@ def get_available_memory():
         raise Exception('Platform %s not supported' % platform)
 
 
+# Buffers larger than this are fetched lazily, region by region, as the window
+# displays them
+LAZY_BUFFER_SIZE = 256 << 20
+
+
+def is_lazy_buffer_size(bufsize):
+    """
+    Check if a buffer of bufsize bytes should be fetched lazily instead of
+    being copied up front
+    """
+    return (bufsize >= LAZY_BUFFER_SIZE or
+            bufsize >= get_available_memory() / 10)
+
+
 def get_buffer_size(height, channels, typevalue, rowstride):
     """
     Compute the buffer size in bytes
     """
     channel_size = 1
     if (typevalue == symbols.OID_TYPES_UINT16 or
-            typevalue == symbols.OID_TYPES_INT16):
+            typevalue == symbols.OID_TYPES_INT16 or
+            typevalue == symbols.OID_TYPES_FLOAT16):
         channel_size = 2  # 2 bytes per element
     elif (typevalue == symbols.OID_TYPES_INT32 or
+          typevalue == symbols.OID_TYPES_UINT32 or
           typevalue == symbols.OID_TYPES_FLOAT32):
         channel_size = 4  # 4 bytes per element
-    elif typevalue == symbols.OID_TYPES_FLOAT64:
+    elif (typevalue == symbols.OID_TYPES_FLOAT64 or
+          typevalue == symbols.OID_TYPES_INT64):
         channel_size = 8  # 8 bytes per element
 
     return channel_size * channels * rowstride * height
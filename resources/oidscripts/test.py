@@ -183,6 +183,12 @@ class DummyDebugger(BridgeInterface):
         """
         pass
 
+    def read_memory(self, address, length):
+        """
+        The sample buffers are small enough to never be fetched lazily
+        """
+        return None
+
     def get_available_symbols(self):
         """
         Return the names of the available sample buffers
@@ -0,0 +1,147 @@
+# -*- coding: utf-8 -*-
+
+"""
+Tracing of the plots, enabled by setting the OID_TRACE_DIR environment
+variable. The debugger scripts write their events to the trace file of the
+bridge (so that both share the same clock), and the window to its own. The
+files of a session are merged into a single Chrome trace (which can be opened
+with chrome://tracing or https://ui.perfetto.dev) with:
+
+    python -m oidscripts.tracing merged.json $OID_TRACE_DIR/*.json
+"""
+
+import ctypes
+import json
+import sys
+
+
+class PlotTracer(object):
+    """
+    Writes the trace events of the debugger scripts through the bridge
+    library, which must have been initialized
+    """
+    def __init__(self, lib):
+        self._lib = lib
+
+    @staticmethod
+    def declare_api(lib):
+        """
+        Set up the tracing functions of the bridge library
+        """
+        lib.oid_trace_enabled.argtypes = []
+        lib.oid_trace_enabled.restype = ctypes.c_int
+
+        lib.oid_new_trace_request_id.argtypes = []
+        lib.oid_new_trace_request_id.restype = ctypes.c_ulonglong
+
+        lib.oid_trace_now_us.argtypes = []
+        lib.oid_trace_now_us.restype = ctypes.c_double
+
+        lib.oid_trace_event.argtypes = [
+            ctypes.c_char_p,
+            ctypes.c_ulonglong,
+            ctypes.c_double,
+            ctypes.c_double,
+            ctypes.c_char_p
+        ]
+        lib.oid_trace_event.restype = None
+
+    def enabled(self):
+        return self._lib.oid_trace_enabled() != 0
+
+    def new_request_id(self):
+        """
+        Return the ID correlating the events of a new plot, or 0 if plots are
+        not traced
+        """
+        if not self.enabled():
+            return 0
+
+        return self._lib.oid_new_trace_request_id()
+
+    def span(self, name, request_id, buffer_name=''):
+        """
+        Return a context manager which traces the step it encloses
+        """
+        return _TraceSpan(self._lib, name, request_id, buffer_name)
+
+    @staticmethod
+    def tag(buffer_metadata, request_id):
+        """
+        Give the request ID of its plot to the metadata of a buffer, so that
+        the bridge and the window trace it under the same ID
+        """
+        if request_id != 0 and buffer_metadata is not None:
+            buffer_metadata['request_id'] = request_id
+
+
+class _TraceSpan(object):
+    def __init__(self, lib, name, request_id, buffer_name):
+        self._lib = lib
+        self._name = name
+        self._request_id = request_id
+        self._buffer_name = buffer_name
+        self._begin_us = 0.0
+
+    def __enter__(self):
+        if self._request_id != 0:
+            self._begin_us = self._lib.oid_trace_now_us()
+        return self
+
+    def __exit__(self, exc_type, exc_value, exc_traceback):
+        if self._request_id != 0:
+            self._lib.oid_trace_event(_encode(self._name),
+                                      self._request_id,
+                                      self._begin_us,
+                                      self._lib.oid_trace_now_us(),
+                                      _encode(self._buffer_name))
+        return False
+
+
+def _encode(text):
+    if isinstance(text, bytes):
+        return text
+    return text.encode('utf-8')
+
+
+def read_trace_events(path):
+    """
+    Read the events of a trace file. Their array is left open by the
+    processes, which may have been killed before closing it.
+    """
+    with open(path) as trace_file:
+        contents = trace_file.read().strip()
+
+    if contents.endswith(','):
+        contents = contents[:-1]
+    if not contents.endswith(']'):
+        contents += ']'
+
+    return json.loads(contents)
+
+
+def merge_traces(output_path, input_paths):
+    """
+    Merge the trace files of the processes of a session into one timeline
+    """
+    events = []
+    for path in input_paths:
+        events.extend(read_trace_events(path))
+
+    with open(output_path, 'w') as output_file:
+        json.dump({'traceEvents': events, 'displayTimeUnit': 'ms'},
+                  output_file)
+
+
+def main(argv):
+    if len(argv) < 3:
+        print('Usage: python -m oidscripts.tracing <merged trace>'
+              ' <trace files...>')
+        return 1
+
+    merge_traces(argv[1], argv[2:])
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -14,6 +14,11 @@ from oidscripts import oidtypes
 from oidscripts.oidtypes.interface import TypeInspectorInterface
 
 
+# Entry of TypeBridge._inspectors_by_type_name for types which haven't been
+# checked yet
+_UNKNOWN_TYPE = object()
+
+
 class TypeBridge(object):
     """
     Class responsible for loading and interfacing with all modules implementing
@@ -30,26 +35,101 @@ class TypeBridge(object):
         for inspector_class in TypeInspectorInterface.__subclasses__():
             self._type_inspectors.append(inspector_class())
 
+        # Inspector of each type (given by its normalized name), or None if
+        # the type is not observable. Inspectors only look at the type of the
+        # symbols, and scopes are full of symbols of the same few types.
+        self._inspectors_by_type_name = {}
+        self._register_observable_type_names()
+
+        # BufferHeaderLayout of each type, or None if it has no known layout
+        self._header_layouts_by_type_name = {}
+
+    def _register_observable_type_names(self):
+        """
+        Dispatch the types which the inspectors name exactly, without asking
+        them
+        """
+        for module in reversed(self._type_inspectors):
+            for type_name in module.get_observable_type_names():
+                normalized_name = TypeBridge._normalize_type_name(type_name)
+                self._inspectors_by_type_name[normalized_name] = module
+
+    @staticmethod
+    def _normalize_type_name(type_name):
+        """
+        Give the same name to types which are only spelled with different
+        whitespace (e.g. 'cv::Mat*' and 'cv::Mat *')
+        """
+        normalized_name = ' '.join(type_name.split())
+        return normalized_name.replace(' *', '*').replace(' &', '&')
+
+    def _get_type_inspector(self, symbol_obj, symbol_name):
+        """
+        Returns the module able to process symbols of the type of symbol_obj,
+        or None if there is none
+        """
+        type_name = TypeBridge._normalize_type_name(str(symbol_obj.type))
+
+        module = self._inspectors_by_type_name.get(type_name, _UNKNOWN_TYPE)
+        if module is _UNKNOWN_TYPE:
+            module = next((module for module in self._type_inspectors
+                           if module.is_symbol_observable(symbol_obj,
+                                                          symbol_name)),
+                          None)
+            self._inspectors_by_type_name[type_name] = module
+
+        return module
+
+    def invalidate_cache(self):
+        """
+        Forget the inspectors found for each type, e.g. because the debugger
+        loaded new symbol files whose types may share their names
+        """
+        self._inspectors_by_type_name.clear()
+        self._register_observable_type_names()
+        self._header_layouts_by_type_name.clear()
+
     def get_buffer_metadata(self, symbol_name, picked_obj, debugger_bridge):
         """
         Returns the metadata related to a variable, which are required for the
         purpose of plotting it in the oidwindow
         """
-        for module in self._type_inspectors:
-            if module.is_symbol_observable(picked_obj, symbol_name):
-                return module.get_buffer_metadata(symbol_name,
-                                                  picked_obj,
-                                                  debugger_bridge)
+        module = self._get_type_inspector(picked_obj, symbol_name)
+        if module is None:
+            return None
 
-        return None
+        return module.get_buffer_metadata(symbol_name,
+                                          picked_obj,
+                                          debugger_bridge)
+
+    def get_buffer_header_layout(self, symbol_name, picked_obj,
+                                 debugger_bridge):
+        """
+        Returns the BufferHeaderLayout of the type of picked_obj, or None if
+        its metadata must be fetched with get_buffer_metadata. Layouts are
+        only resolved once per type.
+        """
+        type_name = TypeBridge._normalize_type_name(str(picked_obj.type))
+
+        layout = self._header_layouts_by_type_name.get(type_name,
+                                                       _UNKNOWN_TYPE)
+        if layout is _UNKNOWN_TYPE:
+            module = self._get_type_inspector(picked_obj, symbol_name)
+            layout = None
+            try:
+                if module is not None:
+                    layout = module.get_buffer_header_layout(picked_obj,
+                                                             debugger_bridge)
+            except Exception:
+                # The type doesn't have the expected members
+                layout = None
+            self._header_layouts_by_type_name[type_name] = layout
+
+        return layout
 
     def is_symbol_observable(self, symbol_obj, symbol_name):
         """
         Returns true if any available module is able to process this particular
         symbol
         """
-        for module in self._type_inspectors:
-            if module.is_symbol_observable(symbol_obj, symbol_name):
-                return True
-
-        return False
+        return self._get_type_inspector(symbol_obj, symbol_name) is not None
@@ -23,18 +23,104 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
 #include <memory>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
 
-#include <QPixmap>
+#include <QImage>
 
 #include "buffer_exporter.h"
 
+#include "ipc/row_packer.h"
 #include "math/assorted.h"
 
 
 using namespace std;
 
 
+namespace
+{
+
+// Below this size, spawning threads costs more than the conversion itself
+const size_t parallel_export_threshold = 4 << 20;
+
+const unsigned int max_export_threads = 8;
+
+
+// What is exported of a buffer, which may be a copy of its contents
+struct ExportContents
+{
+    const uint8_t* contents;
+    int width;
+    int height;
+    int step;
+    int channels;
+    BufferType type;
+    uint8_t pixel_layout[4];
+    float contrast_brightness[8];
+
+    vector<uint8_t> storage;
+};
+
+
+ExportContents get_export_contents(const BufferExporter::Contents& contents)
+{
+    ExportContents exported;
+    exported.contents = contents.buffer;
+    exported.width    = contents.width;
+    exported.height   = contents.height;
+    exported.step     = contents.step;
+    exported.channels = contents.channels;
+    exported.type     = contents.type;
+
+    for (int c = 0; c < 4; ++c) {
+        switch (contents.pixel_layout[c]) {
+        case 'r':
+            exported.pixel_layout[c] = 0;
+            break;
+        case 'g':
+            exported.pixel_layout[c] = 1;
+            break;
+        case 'b':
+            exported.pixel_layout[c] = 2;
+            break;
+        case 'a':
+            exported.pixel_layout[c] = 3;
+            break;
+        }
+    }
+
+    copy(contents.contrast_brightness,
+         contents.contrast_brightness + 8,
+         exported.contrast_brightness);
+
+    return exported;
+}
+
+
+ExportContents get_export_contents(const uint8_t* contents,
+                                   int step,
+                                   const Buffer* buffer)
+{
+    return get_export_contents(
+        BufferExporter::Contents{contents,
+                                 static_cast<int>(buffer->buffer_width_f),
+                                 static_cast<int>(buffer->buffer_height_f),
+                                 step,
+                                 buffer->channels,
+                                 buffer->type,
+                                 buffer->get_pixel_layout(),
+                                 buffer->auto_buffer_contrast_brightness()});
+}
+
+
 template <typename T>
 float get_multiplier()
 {
@@ -49,10 +135,17 @@ float get_multiplier<float>()
 }
 
 
+template <>
+float get_multiplier<Half>()
+{
+    return 255.f;
+}
+
+
 template <typename T>
-T get_max_intensity()
+float get_max_intensity()
 {
-    return std::numeric_limits<T>::max();
+    return static_cast<float>(std::numeric_limits<T>::max());
 }
 
 
@@ -63,80 +156,160 @@ float get_max_intensity<float>()
 }
 
 
-template <typename T>
-void export_bitmap(const char* fname, const Buffer* buffer)
+template <>
+float get_max_intensity<Half>()
 {
-    const auto width_i  = static_cast<size_t>(buffer->buffer_width_f);
-    const auto height_i = static_cast<size_t>(buffer->buffer_height_f);
+    return 1.f;
+}
 
-    vector<uint8_t> processed_buffer(4 * width_i * height_i);
-    uint8_t default_channel_vals[] = {0, 0, 0, 255};
 
-    uint8_t* out_ptr = processed_buffer.data();
+// The channel count is known at compile time, so that the inner loop has
+// no branches left but the clamping, which compilers vectorize
+template <typename T, int Channels>
+void convert_row_range(const ExportContents* exported,
+                       int first_row,
+                       int last_row,
+                       uint8_t* dst,
+                       const atomic<bool>* cancelled,
+                       atomic<int>* rows_done)
+{
+    const float color_scale   = get_multiplier<T>();
+    const float max_intensity = get_max_intensity<T>();
+    const float* bc_comp      = exported->contrast_brightness;
+    const uint8_t* layout     = exported->pixel_layout;
 
-    const float* bc_comp = buffer->auto_buffer_contrast_brightness();
-    float color_scale    = get_multiplier<T>();
+    // Perform contrast normalization as a single multiply-add
+    float scale[Channels];
+    float offset[Channels];
+    for (int c = 0; c < Channels; ++c) {
+        scale[c]  = bc_comp[c] * color_scale;
+        offset[c] = bc_comp[4 + c] * max_intensity * color_scale;
+    }
 
-    const float max_intensity = get_max_intensity<T>();
+    const size_t width        = static_cast<size_t>(exported->width);
+    const size_t input_stride = static_cast<size_t>(exported->step) * Channels;
 
-    uint8_t pixel_layout[4];
-    for (int c = 0; c < 4; ++c) {
-        switch (buffer->get_pixel_layout()[c]) {
-        case 'r':
-            pixel_layout[c] = 0;
-            break;
-        case 'g':
-            pixel_layout[c] = 1;
-            break;
-        case 'b':
-            pixel_layout[c] = 2;
-            break;
-        case 'a':
-            pixel_layout[c] = 3;
-            break;
+    for (int y = first_row; y < last_row; ++y) {
+        if (*cancelled) {
+            return;
         }
-    }
 
-    const T* in_ptr  = reinterpret_cast<const T*>(buffer->buffer);
-    int input_stride = buffer->channels * buffer->step;
-    uint8_t unformatted_pixel[4];
+        const T* in_ptr = reinterpret_cast<const T*>(exported->contents) +
+                          static_cast<size_t>(y) * input_stride;
+        uint8_t* out_ptr = dst + static_cast<size_t>(y) * width * 4;
 
-    for (size_t y = 0; y < height_i; ++y) {
-        for (size_t x = 0; x < width_i; ++x) {
-            int col_offset = x * buffer->channels;
-            int c;
+        for (size_t x = 0; x < width; ++x) {
+            // The remaining, non-filled channels are set to a default value
+            uint8_t pixel[4] = {0, 0, 0, 255};
 
-            // Perform contrast normalization
-            for (c = 0; c < buffer->channels; ++c) {
-                float in_val = static_cast<float>(in_ptr[col_offset + c]);
+            for (int c = 0; c < Channels; ++c) {
+                const float value =
+                    static_cast<float>(in_ptr[x * Channels + c]) * scale[c] +
+                    offset[c];
 
-                unformatted_pixel[c] = static_cast<uint8_t>(clamp(
-                    (in_val * bc_comp[c] + bc_comp[4 + c] * max_intensity) *
-                        color_scale,
-                    0.f,
-                    255.f));
+                // NaNs are exported as 0
+                pixel[c] = static_cast<uint8_t>(
+                    value > 0.f ? (value < 255.f ? value : 255.f) : 0.f);
             }
 
             // Grayscale: Repeat first channel into G and B
-            if (buffer->channels == 1) {
-                for (; c < 3; ++c) {
-                    unformatted_pixel[c] = unformatted_pixel[0];
-                }
-            }
-
-            // The remaining, non-filled channels will be set to a default value
-            for (; c < 4; ++c) {
-                unformatted_pixel[c] = default_channel_vals[c];
+            if (Channels == 1) {
+                pixel[1] = pixel[0];
+                pixel[2] = pixel[0];
             }
 
             // Reorganize pixel layout according to user provided format
-            for (int c = 0; c < 4; ++c) {
-                out_ptr[pixel_layout[c]] = unformatted_pixel[c];
-            }
+            out_ptr[layout[0]] = pixel[0];
+            out_ptr[layout[1]] = pixel[1];
+            out_ptr[layout[2]] = pixel[2];
+            out_ptr[layout[3]] = pixel[3];
             out_ptr += 4;
         }
 
-        in_ptr += input_stride;
+        ++*rows_done;
+    }
+}
+
+
+template <typename T>
+void convert_rows(const ExportContents& exported,
+                  int first_row,
+                  int last_row,
+                  uint8_t* dst,
+                  const atomic<bool>& cancelled,
+                  atomic<int>& rows_done)
+{
+    switch (exported.channels) {
+    case 1:
+        convert_row_range<T, 1>(
+            &exported, first_row, last_row, dst, &cancelled, &rows_done);
+        break;
+    case 2:
+        convert_row_range<T, 2>(
+            &exported, first_row, last_row, dst, &cancelled, &rows_done);
+        break;
+    case 3:
+        convert_row_range<T, 3>(
+            &exported, first_row, last_row, dst, &cancelled, &rows_done);
+        break;
+    case 4:
+        convert_row_range<T, 4>(
+            &exported, first_row, last_row, dst, &cancelled, &rows_done);
+        break;
+    }
+}
+
+
+template <typename T>
+bool export_bitmap(const char* fname,
+                   const ExportContents& exported,
+                   const atomic<bool>& cancelled,
+                   atomic<int>& rows_done)
+{
+    const auto width_i  = static_cast<size_t>(exported.width);
+    const auto height_i = static_cast<size_t>(exported.height);
+
+    vector<uint8_t> processed_buffer(4 * width_i * height_i);
+
+    unsigned int num_threads = 1;
+    if (processed_buffer.size() >= parallel_export_threshold) {
+        num_threads = min(max(thread::hardware_concurrency(), 1u),
+                          max_export_threads);
+        num_threads = min(num_threads, static_cast<unsigned int>(height_i));
+    }
+
+    const int height = exported.height;
+    const int rows_per_thread =
+        (height + static_cast<int>(num_threads) - 1) /
+        static_cast<int>(num_threads);
+
+    vector<thread> workers;
+    for (int first_row = rows_per_thread; first_row < height;
+         first_row += rows_per_thread) {
+        const int last_row = min(first_row + rows_per_thread, height);
+        workers.emplace_back(convert_rows<T>,
+                             cref(exported),
+                             first_row,
+                             last_row,
+                             processed_buffer.data(),
+                             cref(cancelled),
+                             ref(rows_done));
+    }
+
+    // The first range is converted by the calling thread
+    convert_rows<T>(exported,
+                    0,
+                    min(rows_per_thread, height),
+                    processed_buffer.data(),
+                    cancelled,
+                    rows_done);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (cancelled) {
+        return false;
     }
 
     const int bytes_per_line = width_i * 4;
@@ -145,7 +318,15 @@ void export_bitmap(const char* fname, const Buffer* buffer)
                         height_i,
                         bytes_per_line,
                         QImage::Format_RGBA8888);
-    output_image.save(fname, "png");
+    const bool saved = output_image.save(fname, "png");
+
+    // The encoding itself can't be interrupted
+    if (saved && cancelled) {
+        remove(fname);
+        return false;
+    }
+
+    return saved;
 }
 
 
@@ -181,6 +362,20 @@ const char* get_type_descriptor<int32_t>()
 }
 
 
+template <>
+const char* get_type_descriptor<int8_t>()
+{
+    return "int8";
+}
+
+
+template <>
+const char* get_type_descriptor<uint32_t>()
+{
+    return "uint32";
+}
+
+
 template <>
 const char* get_type_descriptor<float>()
 {
@@ -188,74 +383,720 @@ const char* get_type_descriptor<float>()
 }
 
 
+// Rows are written in chunks of about this size, rather than one by one
+const size_t write_chunk_size = 4 << 20;
+
+
+// Write the rows of exported, without their padding, in large chunks
+bool write_rows(FILE* fhandle,
+                const ExportContents& exported,
+                const atomic<bool>& cancelled,
+                atomic<int>& rows_done)
+{
+    const size_t pixel_size = held_pixel_size(exported.type, exported.channels);
+    const size_t row_length = static_cast<size_t>(exported.width) * pixel_size;
+    const size_t row_stride = static_cast<size_t>(exported.step) * pixel_size;
+
+    if (row_length == 0) {
+        return true;
+    }
+
+    const int chunk_rows =
+        static_cast<int>(max(write_chunk_size / row_length, size_t(1)));
+
+    // Padded rows are packed into a chunk before being written
+    vector<uint8_t> chunk;
+    if (row_stride != row_length) {
+        chunk.resize(static_cast<size_t>(chunk_rows) * row_length);
+    }
+
+    for (int y = 0; y < exported.height; y += chunk_rows) {
+        if (cancelled) {
+            return false;
+        }
+
+        const int rows           = min(chunk_rows, exported.height - y);
+        const uint8_t* rows_data = exported.contents + y * row_stride;
+
+        if (!chunk.empty()) {
+            pack_rows(rows_data,
+                      exported.width,
+                      rows,
+                      exported.step,
+                      pixel_size,
+                      chunk.data());
+            rows_data = chunk.data();
+        }
+
+        const size_t length = static_cast<size_t>(rows) * row_length;
+        if (fwrite(rows_data, 1, length, fhandle) != length) {
+            return false;
+        }
+
+        rows_done += rows;
+    }
+
+    return true;
+}
+
+
 template <typename T>
-void export_binary(const char* fname, const Buffer* buffer)
+bool export_binary(const char* fname,
+                   const ExportContents& exported,
+                   const atomic<bool>& cancelled,
+                   atomic<int>& rows_done)
 {
-    int width_i  = static_cast<int>(buffer->buffer_width_f);
-    int height_i = static_cast<int>(buffer->buffer_height_f);
+    int width_i  = exported.width;
+    int height_i = exported.height;
+
+    FILE* fhandle = fopen(fname, "wb");
 
-    const T* in_ptr = reinterpret_cast<const T*>(buffer->buffer);
+    if (fhandle == NULL) {
+        return false;
+    }
+
+    // The rows are written in chunks, which are already large
+    setvbuf(fhandle, NULL, _IONBF, 0);
+
+    fprintf(fhandle, "%s\n", get_type_descriptor<T>());
+    fwrite(&height_i, sizeof(int), 1, fhandle);
+    fwrite(&width_i, sizeof(int), 1, fhandle);
+    fwrite(&exported.channels, sizeof(int), 1, fhandle);
+
+    const bool written = write_rows(fhandle, exported, cancelled, rows_done);
+    fclose(fhandle);
+
+    if (!written) {
+        remove(fname);
+        return false;
+    }
+
+    return true;
+}
+
+
+// Descriptor of the NumPy dtype of the held values of a type
+string get_numpy_descriptor(BufferType type)
+{
+    const uint16_t byte_order_mark = 1;
+    const bool little_endian =
+        *reinterpret_cast<const uint8_t*>(&byte_order_mark) == 1;
+    const char byte_order = little_endian ? '<' : '>';
+
+    switch (type) {
+    case BufferType::UnsignedByte:
+        return "|u1";
+    case BufferType::UnsignedShort:
+        return string(1, byte_order) + "u2";
+    case BufferType::Short:
+        return string(1, byte_order) + "i2";
+    case BufferType::Int32:
+        return string(1, byte_order) + "i4";
+    case BufferType::Int8:
+        return "|i1";
+    case BufferType::UnsignedInt32:
+        return string(1, byte_order) + "u4";
+    case BufferType::Float16:
+        return string(1, byte_order) + "f2";
+    case BufferType::Float32: // fall-through
+    case BufferType::Float64:
+    case BufferType::Int64:
+        return string(1, byte_order) + "f4";
+    }
+
+    return "|u1";
+}
+
+
+/*
+ * NumPy .npy file (format version 1.0), which np.load can memory map: a
+ * magic string, the length of the header, and the header itself, padded so
+ * that the data starts 64 bytes aligned. The data is in C order, with the
+ * channels as the last dimension of multichannel buffers.
+ */
+bool export_numpy(const char* fname,
+                  const ExportContents& exported,
+                  const atomic<bool>& cancelled,
+                  atomic<int>& rows_done)
+{
+    stringstream header;
+    header << "{'descr': '" << get_numpy_descriptor(exported.type)
+           << "', 'fortran_order': False, 'shape': (" << exported.height
+           << ", " << exported.width;
+    if (exported.channels > 1) {
+        header << ", " << exported.channels;
+    }
+    header << "), }";
+
+    // Magic string, version and header length take 10 bytes, and the header
+    // ends with a newline
+    const size_t preamble_size  = 10;
+    const size_t data_alignment = 64;
+
+    string header_str = header.str();
+    const size_t unpadded_size = preamble_size + header_str.size() + 1;
+    header_str.append(
+        (data_alignment - unpadded_size % data_alignment) % data_alignment,
+        ' ');
+    header_str.push_back('\n');
 
     FILE* fhandle = fopen(fname, "wb");
 
-    if (fhandle != NULL) {
-        fprintf(fhandle, "%s\n", get_type_descriptor<T>());
-        fwrite(&height_i, sizeof(int), 1, fhandle);
-        fwrite(&width_i, sizeof(int), 1, fhandle);
-        fwrite(&buffer->channels, sizeof(int), 1, fhandle);
-        for (int y = 0; y < height_i; ++y) {
-            fwrite(in_ptr + y * buffer->step * buffer->channels,
-                   sizeof(T),
-                   static_cast<size_t>(width_i) * static_cast<size_t>(buffer->channels),
-                   fhandle);
-        }
-        fclose(fhandle);
+    if (fhandle == NULL) {
+        return false;
     }
+
+    // The rows are written in chunks, which are already large
+    setvbuf(fhandle, NULL, _IONBF, 0);
+
+    const uint16_t header_length = static_cast<uint16_t>(header_str.size());
+    const uint8_t preamble[preamble_size] = {
+        0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+        static_cast<uint8_t>(header_length & 0xff),
+        static_cast<uint8_t>(header_length >> 8)};
+
+    bool written =
+        fwrite(preamble, 1, preamble_size, fhandle) == preamble_size &&
+        fwrite(header_str.data(), 1, header_str.size(), fhandle) ==
+            header_str.size();
+
+    written = written && write_rows(fhandle, exported, cancelled, rows_done);
+    fclose(fhandle);
+
+    if (!written) {
+        remove(fname);
+        return false;
+    }
+
+    return true;
 }
 
 
-void BufferExporter::export_buffer(const Buffer* buffer,
-                                   const std::string& path,
-                                   BufferExporter::OutputType type)
+// Copy of Float16 contents, with their halves widened to floats
+ExportContents widen_half_contents(const ExportContents& exported)
+{
+    ExportContents widened = exported;
+    widened.type           = BufferType::Float32;
+    widened.step           = exported.width;
+
+    const size_t row_length =
+        static_cast<size_t>(exported.width) * exported.channels;
+    const size_t row_stride =
+        static_cast<size_t>(exported.step) * exported.channels;
+
+    widened.storage.resize(row_length * exported.height * sizeof(float));
+    float* values = reinterpret_cast<float*>(widened.storage.data());
+
+    const Half* halves = reinterpret_cast<const Half*>(exported.contents);
+    for (int y = 0; y < exported.height; ++y) {
+        const Half* row = halves + y * row_stride;
+        copy(row, row + row_length, values + y * row_length);
+    }
+
+    widened.contents = widened.storage.data();
+
+    return widened;
+}
+
+
+bool export_contents(const ExportContents& exported,
+                     const string& path,
+                     BufferExporter::OutputType type,
+                     const atomic<bool>& cancelled,
+                     atomic<int>& rows_done)
 {
-    if (type == OutputType::Bitmap) {
-        switch (buffer->type) {
+    if (type == BufferExporter::OutputType::Bitmap) {
+        switch (exported.type) {
         case BufferType::UnsignedByte:
-            export_bitmap<uint8_t>(path.c_str(), buffer);
-            break;
+            return export_bitmap<uint8_t>(
+                path.c_str(), exported, cancelled, rows_done);
         case BufferType::UnsignedShort:
-            export_bitmap<uint16_t>(path.c_str(), buffer);
-            break;
+            return export_bitmap<uint16_t>(
+                path.c_str(), exported, cancelled, rows_done);
         case BufferType::Short:
-            export_bitmap<int16_t>(path.c_str(), buffer);
-            break;
+            return export_bitmap<int16_t>(
+                path.c_str(), exported, cancelled, rows_done);
         case BufferType::Int32:
-            export_bitmap<int32_t>(path.c_str(), buffer);
-            break;
+            return export_bitmap<int32_t>(
+                path.c_str(), exported, cancelled, rows_done);
+        case BufferType::Int8:
+            return export_bitmap<int8_t>(
+                path.c_str(), exported, cancelled, rows_done);
+        case BufferType::UnsignedInt32:
+            return export_bitmap<uint32_t>(
+                path.c_str(), exported, cancelled, rows_done);
+        case BufferType::Float16:
+            return export_bitmap<Half>(
+                path.c_str(), exported, cancelled, rows_done);
         case BufferType::Float32:
         case BufferType::Float64:
-            export_bitmap<float>(path.c_str(), buffer);
-            break;
+        case BufferType::Int64:
+            return export_bitmap<float>(
+                path.c_str(), exported, cancelled, rows_done);
         }
+    } else if (type == BufferExporter::OutputType::NumpyArray) {
+        return export_numpy(path.c_str(), exported, cancelled, rows_done);
     } else {
         // Matlab/Octave matrix (load with the oid_load.m function)
-        switch (buffer->type) {
+        switch (exported.type) {
         case BufferType::UnsignedByte:
-            export_binary<uint8_t>(path.c_str(), buffer);
-            break;
+            return export_binary<uint8_t>(
+                path.c_str(), exported, cancelled, rows_done);
         case BufferType::UnsignedShort:
-            export_binary<uint16_t>(path.c_str(), buffer);
-            break;
+            return export_binary<uint16_t>(
+                path.c_str(), exported, cancelled, rows_done);
         case BufferType::Short:
-            export_binary<int16_t>(path.c_str(), buffer);
-            break;
+            return export_binary<int16_t>(
+                path.c_str(), exported, cancelled, rows_done);
         case BufferType::Int32:
-            export_binary<int32_t>(path.c_str(), buffer);
-            break;
+            return export_binary<int32_t>(
+                path.c_str(), exported, cancelled, rows_done);
+        case BufferType::Int8:
+            return export_binary<int8_t>(
+                path.c_str(), exported, cancelled, rows_done);
+        case BufferType::UnsignedInt32:
+            return export_binary<uint32_t>(
+                path.c_str(), exported, cancelled, rows_done);
+        case BufferType::Float16: {
+            // Octave has no half precision type to read them as
+            const ExportContents widened = widen_half_contents(exported);
+            return export_binary<float>(
+                path.c_str(), widened, cancelled, rows_done);
+        }
         case BufferType::Float32:
         case BufferType::Float64:
-            export_binary<float>(path.c_str(), buffer);
-            break;
+        case BufferType::Int64:
+            return export_binary<float>(
+                path.c_str(), exported, cancelled, rows_done);
+        }
+    }
+
+    return false;
+}
+
+// Copy of contents laid out like those of buffer, without their row padding
+ExportContents copy_export_contents(const uint8_t* contents,
+                                    int step,
+                                    const Buffer* buffer)
+{
+    ExportContents exported = get_export_contents(contents, step, buffer);
+    const size_t pixel_size = held_pixel_size(exported.type, exported.channels);
+
+    exported.storage.resize(static_cast<size_t>(exported.width) *
+                            static_cast<size_t>(exported.height) *
+                            pixel_size);
+    pack_rows(exported.contents,
+              exported.width,
+              exported.height,
+              exported.step,
+              pixel_size,
+              exported.storage.data());
+    exported.contents = exported.storage.data();
+    exported.step     = exported.width;
+
+    return exported;
+}
+
+
+const char* get_extension(BufferExporter::OutputType type)
+{
+    switch (type) {
+    case BufferExporter::OutputType::Bitmap:
+        return "png";
+    case BufferExporter::OutputType::OctaveMatrix:
+        return "oct";
+    case BufferExporter::OutputType::NumpyArray:
+        return "npy";
+    }
+
+    return "bin";
+}
+
+
+const char* get_type_name(BufferType type)
+{
+    switch (type) {
+    case BufferType::UnsignedByte:
+        return "uint8";
+    case BufferType::UnsignedShort:
+        return "uint16";
+    case BufferType::Short:
+        return "int16";
+    case BufferType::Int32:
+        return "int32";
+    case BufferType::Float32:
+        return "float32";
+    case BufferType::Float64:
+        return "float64";
+    case BufferType::Float16:
+        return "float16";
+    case BufferType::Int8:
+        return "int8";
+    case BufferType::UnsignedInt32:
+        return "uint32";
+    case BufferType::Int64:
+        return "int64";
+    }
+
+    return "unknown";
+}
+
+
+string escape_json(const string& value)
+{
+    stringstream escaped;
+    for (const char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped << "\\u00" << hex << setw(2) << setfill('0')
+                    << static_cast<int>(c) << dec;
+        } else {
+            escaped << c;
         }
     }
+
+    return escaped.str();
+}
+
+
+// Buffer names are expressions of the debugged program, which are turned
+// into distinct file names
+vector<string> get_file_names(const vector<string>& names,
+                              BufferExporter::OutputType type)
+{
+    vector<string> file_names;
+    set<string> used_names;
+
+    for (const auto& name : names) {
+        string base_name = name;
+        for (char& c : base_name) {
+            if (!isalnum(static_cast<unsigned char>(c)) && c != '_' &&
+                c != '-') {
+                c = '_';
+            }
+        }
+
+        string file_name = base_name + "." + get_extension(type);
+        for (int suffix = 1; used_names.count(file_name) > 0; ++suffix) {
+            file_name = base_name + "_" + to_string(suffix) + "." +
+                        get_extension(type);
+        }
+
+        used_names.insert(file_name);
+        file_names.push_back(file_name);
+    }
+
+    return file_names;
+}
+
+
+struct BulkEntry
+{
+    string name;
+    string file_name;
+    int step;
+    bool transpose;
+    string pixel_layout;
+    ExportContents exported;
+};
+
+
+bool write_manifest(const string& path,
+                    const vector<BulkEntry>& entries,
+                    const vector<char>& results,
+                    BufferExporter::OutputType type)
+{
+    ofstream manifest(path);
+    if (!manifest) {
+        return false;
+    }
+
+    manifest << "{\n  \"format\": \"" << get_extension(type)
+             << "\",\n  \"buffers\": [";
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const BulkEntry& entry = entries[i];
+
+        // The files hold the rows without their padding; step is the one
+        // of the buffer in the debugged program
+        manifest << (i == 0 ? "\n" : ",\n") << "    {\"name\": \""
+                 << escape_json(entry.name) << "\", \"file\": \""
+                 << escape_json(entry.file_name) << "\", \"type\": \""
+                 << get_type_name(entry.exported.type)
+                 << "\", \"width\": " << entry.exported.width
+                 << ", \"height\": " << entry.exported.height
+                 << ", \"channels\": " << entry.exported.channels
+                 << ", \"step\": " << entry.step
+                 << ", \"transpose\": "
+                 << (entry.transpose ? "true" : "false")
+                 << ", \"pixel_layout\": \""
+                 << escape_json(entry.pixel_layout)
+                 << "\", \"exported\": " << (results[i] ? "true" : "false")
+                 << "}";
+    }
+
+    manifest << "\n  ]\n}\n";
+
+    return static_cast<bool>(manifest);
+}
+
+
+// The buffers are spread over a pool of threads, which take the next one
+// to export as soon as they are done with the previous one
+bool export_bulk(const vector<BulkEntry>& entries,
+                 const string& directory,
+                 BufferExporter::OutputType type,
+                 const atomic<bool>& cancelled,
+                 atomic<int>& rows_done)
+{
+    vector<char> results(entries.size(), 0);
+    atomic<size_t> next_entry(0);
+
+    const auto export_entries = [&]() {
+        for (size_t i = next_entry++; i < entries.size() && !cancelled;
+             i = next_entry++) {
+            results[i] = export_contents(entries[i].exported,
+                                         directory + "/" +
+                                             entries[i].file_name,
+                                         type,
+                                         cancelled,
+                                         rows_done);
+        }
+    };
+
+    const unsigned int num_threads = min(
+        {max(thread::hardware_concurrency(), 1u),
+         max_export_threads,
+         static_cast<unsigned int>(max(entries.size(), size_t(1)))});
+
+    vector<thread> workers;
+    for (unsigned int i = 1; i < num_threads; ++i) {
+        workers.emplace_back(export_entries);
+    }
+
+    export_entries();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (cancelled) {
+        return false;
+    }
+
+    const bool manifest_written =
+        write_manifest(directory + "/manifest.json", entries, results, type);
+
+    return manifest_written &&
+           all_of(results.begin(), results.end(), [](char r) { return r; });
+}
+
+} // namespace
+
+
+BufferExporter::BufferExporter()
+    : cancelled_(false)
+    , rows_done_(0)
+    , total_rows_(0)
+{
+}
+
+
+BufferExporter::~BufferExporter()
+{
+    cancel();
+
+    if (export_future_.valid()) {
+        export_future_.wait();
+    }
+}
+
+
+bool BufferExporter::export_buffer(const Buffer* buffer,
+                                   const std::string& path,
+                                   BufferExporter::OutputType type)
+{
+    const atomic<bool> cancelled(false);
+    atomic<int> rows_done(0);
+
+    return export_contents(
+        get_export_contents(buffer->buffer, buffer->step, buffer),
+        path,
+        type,
+        cancelled,
+        rows_done);
+}
+
+
+bool BufferExporter::export_buffer(const Contents& contents,
+                                   const std::string& path,
+                                   BufferExporter::OutputType type)
+{
+    const atomic<bool> cancelled(false);
+    atomic<int> rows_done(0);
+
+    return export_contents(
+        get_export_contents(contents), path, type, cancelled, rows_done);
+}
+
+
+bool BufferExporter::start(const Buffer* buffer,
+                           const std::string& path,
+                           OutputType type)
+{
+    return start(buffer->buffer, buffer->step, buffer, path, type);
+}
+
+
+bool BufferExporter::start(const uint8_t* contents,
+                           int step,
+                           const Buffer* buffer,
+                           const std::string& path,
+                           OutputType type)
+{
+    if (is_pending()) {
+        return false;
+    }
+
+    ExportContents exported = copy_export_contents(contents, step, buffer);
+
+    path_       = path;
+    cancelled_  = false;
+    rows_done_  = 0;
+    total_rows_ = exported.height;
+
+    const atomic<bool>* cancelled = &cancelled_;
+    atomic<int>* rows_done        = &rows_done_;
+
+    export_future_ = async(
+        launch::async,
+        [exported = move(exported), path, type, cancelled, rows_done]() {
+            return export_contents(
+                exported, path, type, *cancelled, *rows_done);
+        });
+
+    return true;
+}
+
+
+bool BufferExporter::start_bulk(const vector<BulkBuffer>& buffers,
+                                const string& directory,
+                                OutputType type)
+{
+    if (is_pending()) {
+        return false;
+    }
+
+    vector<string> names;
+    for (const auto& buffer : buffers) {
+        names.push_back(buffer.name);
+    }
+    const vector<string> file_names = get_file_names(names, type);
+
+    vector<BulkEntry> entries;
+    total_rows_ = 0;
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        const BulkBuffer& bulk_buffer = buffers[i];
+        const Buffer* buffer          = bulk_buffer.buffer;
+
+        entries.push_back(
+            BulkEntry{bulk_buffer.name,
+                      file_names[i],
+                      bulk_buffer.step,
+                      buffer->transpose,
+                      string(buffer->get_pixel_layout(), 4),
+                      copy_export_contents(
+                          bulk_buffer.contents, bulk_buffer.step, buffer)});
+        total_rows_ += entries.back().exported.height;
+    }
+
+    path_      = directory;
+    cancelled_ = false;
+    rows_done_ = 0;
+
+    const atomic<bool>* cancelled = &cancelled_;
+    atomic<int>* rows_done        = &rows_done_;
+
+    export_future_ = async(
+        launch::async,
+        [entries = move(entries), directory, type, cancelled, rows_done]() {
+            return export_bulk(
+                entries, directory, type, *cancelled, *rows_done);
+        });
+
+    return true;
+}
+
+
+bool BufferExporter::start_image(QImage image, const string& path)
+{
+    if (is_pending()) {
+        return false;
+    }
+
+    path_       = path;
+    cancelled_  = false;
+    rows_done_  = 0;
+    total_rows_ = image.height();
+
+    atomic<int>* rows_done = &rows_done_;
+
+    // QImage shares its pixels implicitly, and is only read by the export
+    export_future_ =
+        async(launch::async, [image = move(image), path, rows_done]() {
+            const bool saved = image.save(path.c_str(), "PNG");
+            *rows_done       = image.height();
+            return saved;
+        });
+
+    return true;
+}
+
+
+void BufferExporter::cancel()
+{
+    cancelled_ = true;
+}
+
+
+bool BufferExporter::cancelled() const
+{
+    return cancelled_;
+}
+
+
+bool BufferExporter::is_pending() const
+{
+    return export_future_.valid();
+}
+
+
+float BufferExporter::progress() const
+{
+    if (total_rows_ <= 0) {
+        return 0.f;
+    }
+
+    return min(static_cast<float>(rows_done_) / total_rows_, 1.f);
+}
+
+
+const std::string& BufferExporter::path() const
+{
+    return path_;
+}
+
+
+bool BufferExporter::poll(bool& succeeded)
+{
+    if (!export_future_.valid() ||
+        export_future_.wait_for(chrono::seconds(0)) !=
+            future_status::ready) {
+        return false;
+    }
+
+    succeeded = export_future_.get();
+    return true;
 }
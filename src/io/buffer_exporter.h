@@ -26,17 +26,110 @@
 #ifndef BUFFER_EXPORTER_H_
 #define BUFFER_EXPORTER_H_
 
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <QImage>
+
 #include "visualization/components/buffer.h"
 
 
+/*
+ * Exports buffers to files. Exports started in the background work on a copy
+ * of the contents and contrast of their buffers, taken when they start, so
+ * that the buffers can change or go away in the meantime. Only one of them
+ * runs at a time, though bulk exports write several buffers at once.
+ */
 class BufferExporter
 {
   public:
-    enum class OutputType { Bitmap, OctaveMatrix };
+    enum class OutputType { Bitmap, OctaveMatrix, NumpyArray };
+
+    // Contents laid out like those of a Buffer, along with how they are
+    // displayed, which can be exported without any stage
+    struct Contents
+    {
+        const std::uint8_t* buffer;
+        int width;
+        int height;
+        int step;
+        int channels;
+        BufferType type;
+        const char* pixel_layout;
+        const float* contrast_brightness;
+    };
+
+    BufferExporter();
+    ~BufferExporter();
 
-    static void export_buffer(const Buffer* buffer,
+    static bool export_buffer(const Buffer* buffer,
                               const std::string& path,
                               OutputType type);
+
+    static bool export_buffer(const Contents& contents,
+                              const std::string& path,
+                              OutputType type);
+
+    // False if another export is still running
+    bool start(const Buffer* buffer,
+               const std::string& path,
+               OutputType type);
+
+    // Export buffer from contents laid out like its own with step, such as
+    // those read back from its textures once it dropped its copy
+    bool start(const std::uint8_t* contents,
+               int step,
+               const Buffer* buffer,
+               const std::string& path,
+               OutputType type);
+
+    // Buffer exported by start_bulk under name, from contents laid out like
+    // its own
+    struct BulkBuffer
+    {
+        std::string name;
+        const Buffer* buffer;
+        const std::uint8_t* contents;
+        int step;
+    };
+
+    // Export all buffers to directory, which must exist. A manifest.json
+    // file lists them along with their metadata.
+    bool start_bulk(const std::vector<BulkBuffer>& buffers,
+                    const std::string& directory,
+                    OutputType type);
+
+    // Save an image rendered from a buffer as it is displayed
+    bool start_image(QImage image, const std::string& path);
+
+    void cancel();
+
+    bool cancelled() const;
+
+    bool is_pending() const;
+
+    // Fraction of the rows exported so far, in [0, 1]
+    float progress() const;
+
+    const std::string& path() const;
+
+    /**
+     * Check whether the background export is over, without waiting for it.
+     *
+     * @return true if it is, with succeeded set once the file was written
+     */
+    bool poll(bool& succeeded);
+
+  private:
+    std::string path_;
+    std::future<bool> export_future_;
+    std::atomic<bool> cancelled_;
+    std::atomic<int> rows_done_;
+    int total_rows_;
 };
 
 #endif // BUFFER_EXPORTER_H_
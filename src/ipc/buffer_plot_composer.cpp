@@ -0,0 +1,218 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "buffer_plot_composer.h"
+
+#include <vector>
+
+#include "row_packer.h"
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Buffers from this size on are sent progressively
+const size_t progressive_transfer_threshold = 32 << 20;
+
+// Target preview size, in pixels
+const size_t max_preview_area = 1 << 20;
+
+
+bool is_delta_worthwhile(const vector<TileRegion>& dirty_tiles,
+                         int buff_width,
+                         int buff_height)
+{
+    // Past half of the buffer, the full contents are cheaper to send
+    size_t dirty_area = 0;
+    for (const auto& tile : dirty_tiles) {
+        dirty_area +=
+            static_cast<size_t>(tile.width) * static_cast<size_t>(tile.height);
+    }
+
+    return 2 * dirty_area <=
+           static_cast<size_t>(buff_width) * static_cast<size_t>(buff_height);
+}
+
+} // namespace
+
+
+BufferPlotComposer::BufferPlotComposer(const string& shared_key_prefix)
+    : shared_buffers_{shared_key_prefix}
+{
+}
+
+
+void BufferPlotComposer::compose(MessageComposer& message_composer,
+                                 const BufferPlotContents& contents,
+                                 bool use_shared_memory)
+{
+    const string& variable_name_str = contents.variable_name;
+    const string& display_name_str  = contents.display_name;
+    const string& pixel_layout_str  = contents.pixel_layout;
+    const bool transpose_buffer     = contents.transpose_buffer;
+    const int buff_width            = contents.width;
+    const int buff_height           = contents.height;
+    const int buff_channels         = contents.channels;
+    const int buff_stride           = contents.stride;
+    const BufferType buff_type      = contents.type;
+    uint8_t* buff_ptr               = contents.buffer;
+    const size_t buff_length        = contents.length;
+
+    // Local windows read the buffer contents straight from shared memory
+    SharedBufferHandle shared_handle;
+    if (use_shared_memory &&
+        shared_buffers_.write(
+            variable_name_str, buff_ptr, buff_length, shared_handle)) {
+        message_composer.push(MessageType::PlotBufferContentsShared)
+            .push(variable_name_str)
+            .push(display_name_str)
+            .push(pixel_layout_str)
+            .push(transpose_buffer)
+            .push(buff_width)
+            .push(buff_height)
+            .push(buff_channels)
+            .push(buff_stride)
+            .push(buff_type)
+            .push(shared_handle.key)
+            .push(shared_handle.sequence)
+            .push(shared_handle.offset)
+            .push(shared_handle.length);
+
+        // The window no longer has the state the tile hashes refer to
+        tile_hashes_.invalidate(variable_name_str);
+        return;
+    }
+
+    // If the buffer was plotted before, only send the tiles that changed
+    vector<TileRegion> dirty_tiles;
+    if (tile_hashes_.update(variable_name_str,
+                            buff_ptr,
+                            buff_width,
+                            buff_height,
+                            buff_channels,
+                            buff_stride,
+                            buff_type,
+                            dirty_tiles) &&
+        is_delta_worthwhile(dirty_tiles, buff_width, buff_height)) {
+        const size_t pixel_size =
+            static_cast<size_t>(buff_channels) * typesize(buff_type);
+
+        vector<uint8_t> tile_contents;
+        for (const auto& tile : dirty_tiles) {
+            pack_tile(buff_ptr, buff_stride, pixel_size, tile, tile_contents);
+        }
+
+        message_composer.push(MessageType::PlotBufferTiles)
+            .push(variable_name_str)
+            .push(display_name_str)
+            .push(pixel_layout_str)
+            .push(transpose_buffer)
+            .push(buff_width)
+            .push(buff_height)
+            .push(buff_channels)
+            .push(buff_stride)
+            .push(buff_type)
+            .push(dirty_tiles.size());
+        for (const auto& tile : dirty_tiles) {
+            message_composer.push(tile.x)
+                .push(tile.y)
+                .push(tile.width)
+                .push(tile.height);
+        }
+        message_composer.push_owned(std::move(tile_contents));
+        return;
+    }
+
+    // Large buffers are preceded by a downsampled preview, which the window
+    // can display long before the full contents have arrived
+    if (buff_length >= progressive_transfer_threshold) {
+        compose_preview(message_composer, contents);
+    }
+
+    message_composer.push(MessageType::PlotBufferContents)
+        .push(variable_name_str)
+        .push(display_name_str)
+        .push(pixel_layout_str)
+        .push(transpose_buffer)
+        .push(buff_width)
+        .push(buff_height)
+        .push(buff_channels)
+        .push(buff_stride)
+        .push(buff_type)
+        .push(buff_ptr, buff_length);
+}
+
+
+void BufferPlotComposer::invalidate(const string& name)
+{
+    tile_hashes_.invalidate(name);
+    shared_buffers_.release(name);
+}
+
+
+void BufferPlotComposer::clear()
+{
+    tile_hashes_.clear();
+    shared_buffers_.clear();
+}
+
+
+void BufferPlotComposer::compose_preview(MessageComposer& message_composer,
+                                         const BufferPlotContents& contents)
+{
+    int factor = 2;
+    while (static_cast<size_t>(contents.width / factor) *
+               static_cast<size_t>(contents.height / factor) >
+           max_preview_area) {
+        factor *= 2;
+    }
+
+    const size_t pixel_size =
+        static_cast<size_t>(contents.channels) * typesize(contents.type);
+
+    vector<uint8_t> preview;
+    pack_preview(contents.buffer,
+                 contents.width,
+                 contents.height,
+                 contents.stride,
+                 pixel_size,
+                 factor,
+                 preview);
+
+    message_composer.push(MessageType::PlotBufferPreview)
+        .push(contents.variable_name)
+        .push(contents.display_name)
+        .push(contents.pixel_layout)
+        .push(contents.transpose_buffer)
+        .push(contents.width)
+        .push(contents.height)
+        .push(contents.channels)
+        .push(contents.type)
+        .push(factor)
+        .push_owned(std::move(preview));
+}
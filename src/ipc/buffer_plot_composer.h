@@ -0,0 +1,105 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef IPC_BUFFER_PLOT_COMPOSER_H_
+#define IPC_BUFFER_PLOT_COMPOSER_H_
+
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint8_t
+
+#include <string>
+
+#include "message_exchange.h"
+#include "raw_data_decode.h"
+#include "shared_buffer.h"
+#include "tile_delta.h"
+
+/*
+ * Contents of a plotted buffer, whose rows are stride pixels apart
+ */
+struct BufferPlotContents
+{
+    std::string variable_name;
+    std::string display_name;
+    std::string pixel_layout;
+    bool transpose_buffer;
+    int width;
+    int height;
+    int channels;
+    int stride;
+    BufferType type;
+    std::uint8_t* buffer;
+    std::size_t length;
+};
+
+/*
+ * Composes the messages plotting the contents of buffers with the cheapest
+ * transport available: shared memory for windows on this machine, else the
+ * tiles which changed since the previous plot of the buffer, else its whole
+ * contents, preceded by a downsampled preview if they are large. Used by the
+ * debugger bridge and by liboidclient.
+ */
+class BufferPlotComposer
+{
+  public:
+    explicit BufferPlotComposer(const std::string& shared_key_prefix);
+
+    /**
+     * Push the messages plotting contents to message_composer, which must be
+     * sent before the buffer is plotted again.
+     *
+     * @param use_shared_memory  If false, the contents are sent through the
+     *     socket, e.g. because the window runs on another machine
+     */
+    void compose(MessageComposer& message_composer,
+                 const BufferPlotContents& contents,
+                 bool use_shared_memory);
+
+    // The window no longer holds the contents the buffer was last plotted
+    // with (e.g. its message was dropped)
+    void invalidate(const std::string& name);
+
+    // Forget every buffer, e.g. once the window disconnected
+    void clear();
+
+    SharedBufferWriter& shared_buffers()
+    {
+        return shared_buffers_;
+    }
+
+    TileHashCache& tile_hashes()
+    {
+        return tile_hashes_;
+    }
+
+  private:
+    SharedBufferWriter shared_buffers_;
+    TileHashCache tile_hashes_;
+
+    void compose_preview(MessageComposer& message_composer,
+                         const BufferPlotContents& contents);
+};
+
+#endif // IPC_BUFFER_PLOT_COMPOSER_H_
@@ -23,25 +23,643 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
 
 #include "message_exchange.h"
 
-MessageBlock::~MessageBlock()
+#include <QElapsedTimer>
+
+#if defined(Q_OS_UNIX)
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Buffers up to this size are copied into the message arena
+const size_t coalesce_threshold = 4096;
+
+// Enough for all fields of the usual messages
+const size_t initial_arena_capacity = 1024;
+
+const size_t no_frame = static_cast<size_t>(-1);
+
+// Maximum amount of data handed to the socket's own write buffer at a time
+const qint64 max_buffered_bytes = 1 << 20;
+
+#if defined(Q_OS_UNIX)
+// Write the remaining segments with a single system call. Returns the
+// number of bytes written, or 0 if the socket would block.
+size_t write_vectored(QTcpSocket* socket,
+                      const vector<MessageSegment>& segments,
+                      size_t segment_index,
+                      size_t segment_offset)
+{
+    const size_t max_iovecs = 64;
+
+    iovec iov[max_iovecs];
+    size_t num_iovecs = 0;
+
+    for (size_t i = segment_index;
+         i < segments.size() && num_iovecs < max_iovecs;
+         ++i) {
+        const size_t offset = (i == segment_index) ? segment_offset : 0;
+
+        iov[num_iovecs].iov_base =
+            const_cast<uint8_t*>(segments[i].data + offset);
+        iov[num_iovecs].iov_len = segments[i].size - offset;
+        ++num_iovecs;
+    }
+
+    msghdr message = {};
+    message.msg_iov    = iov;
+    message.msg_iovlen = num_iovecs;
+
+    int flags = 0;
+#if defined(MSG_NOSIGNAL)
+    flags |= MSG_NOSIGNAL;
+#endif
+
+    ssize_t written;
+    do {
+        written = ::sendmsg(
+            static_cast<int>(socket->socketDescriptor()), &message, flags);
+    } while (written < 0 && errno == EINTR);
+
+    return written > 0 ? static_cast<size_t>(written) : 0;
+}
+#endif
+
+
+void advance_segments(const vector<MessageSegment>& segments,
+                      size_t written,
+                      size_t& segment_index,
+                      size_t& segment_offset)
+{
+    while (written > 0) {
+        const size_t remaining = segments[segment_index].size - segment_offset;
+
+        if (written < remaining) {
+            segment_offset += written;
+            return;
+        }
+
+        written -= remaining;
+        segment_offset = 0;
+        ++segment_index;
+    }
+}
+
+
+// Write segments from (segment_index, segment_offset) on, until they are all
+// written or the socket would block
+void write_segments(QTcpSocket* socket,
+                    const vector<MessageSegment>& segments,
+                    size_t& segment_index,
+                    size_t& segment_offset)
+{
+    while (segment_index < segments.size()) {
+#if defined(Q_OS_UNIX)
+        // Writing directly to the descriptor is only safe while Qt has
+        // nothing buffered that should go out first
+        if (socket->bytesToWrite() == 0) {
+            size_t written = write_vectored(
+                socket, segments, segment_index, segment_offset);
+
+            if (written > 0) {
+                advance_segments(
+                    segments, written, segment_index, segment_offset);
+                continue;
+            }
+        }
+#endif
+
+        // Otherwise, keep a bounded amount of data in the socket's buffer
+        if (socket->bytesToWrite() >= max_buffered_bytes) {
+            break;
+        }
+
+        const MessageSegment& segment = segments[segment_index];
+        const qint64 length =
+            min(static_cast<qint64>(segment.size - segment_offset),
+                max_buffered_bytes);
+
+        qint64 written = socket->write(
+            reinterpret_cast<const char*>(segment.data + segment_offset),
+            length);
+
+        if (written <= 0) {
+            break;
+        }
+
+        advance_segments(segments,
+                         static_cast<size_t>(written),
+                         segment_index,
+                         segment_offset);
+
+        socket->flush();
+    }
+}
+
+} // namespace
+
+
+MessageComposer::MessageComposer()
+    : compression_(CompressionMode::None)
+    , request_id_(0)
+    , joins_previous_(false)
+    , frame_offset_(no_frame)
+    , frame_external_bytes_(0)
+{
+    arena_.reserve(initial_arena_capacity);
+}
+
+
+MessageComposer& MessageComposer::push(MessageType type)
+{
+    finish_frame();
+
+    frame_offset_ = arena_.size();
+
+    MessageHeader header;
+    header.type       = type;
+    header.version    = message_protocol_version;
+    header.length     = 0;
+    header.request_id = request_id_;
+
+    return push(header);
+}
+
+
+void MessageComposer::send(QTcpSocket* socket)
+{
+    finish_frame();
+
+    vector<MessageSegment> segments;
+    build_segments(segments);
+
+    size_t segment_index  = 0;
+    size_t segment_offset = 0;
+
+    while (segment_index < segments.size()) {
+        write_segments(socket, segments, segment_index, segment_offset);
+
+        if (segment_index < segments.size() &&
+            !socket->waitForBytesWritten()) {
+            break;
+        }
+    }
+
+    while (socket->bytesToWrite() > 0 && socket->waitForBytesWritten()) {
+    }
+}
+
+
+void MessageComposer::send_async(MessageSendQueue& queue,
+                                 function<void()> on_sent,
+                                 function<void()> on_discarded)
+{
+    queue.enqueue(
+        std::move(*this), std::move(on_sent), std::move(on_discarded));
+}
+
+
+void MessageComposer::clear()
+{
+    arena_.clear();
+    external_blocks_.clear();
+    compressed_chunks_.clear();
+    owned_buffers_.clear();
+
+    frame_offset_         = no_frame;
+    frame_external_bytes_ = 0;
+}
+
+
+void MessageComposer::push_external(const uint8_t* buffer, size_t size)
+{
+    // Small buffers are cheaper to copy than to send separately
+    if (size <= coalesce_threshold) {
+        append(buffer, size);
+        return;
+    }
+
+    external_blocks_.push_back({arena_.size(), buffer, size});
+    frame_external_bytes_ += size;
+}
+
+
+void MessageComposer::finish_frame()
+{
+    if (frame_offset_ == no_frame) {
+        return;
+    }
+
+    const uint64_t length = static_cast<uint64_t>(
+        arena_.size() - frame_offset_ - sizeof(MessageHeader) +
+        frame_external_bytes_);
+
+    memcpy(arena_.data() + frame_offset_ + offsetof(MessageHeader, length),
+           &length,
+           sizeof(length));
+
+    frame_offset_         = no_frame;
+    frame_external_bytes_ = 0;
+}
+
+
+void MessageComposer::build_segments(vector<MessageSegment>& segments) const
+{
+    segments.clear();
+    segments.reserve(2 * external_blocks_.size() + 1);
+
+    size_t arena_offset = 0;
+
+    for (const auto& block : external_blocks_) {
+        if (block.arena_offset > arena_offset) {
+            segments.push_back({arena_.data() + arena_offset,
+                                block.arena_offset - arena_offset});
+            arena_offset = block.arena_offset;
+        }
+
+        segments.push_back({block.data, block.size});
+    }
+
+    if (arena_.size() > arena_offset) {
+        segments.push_back(
+            {arena_.data() + arena_offset, arena_.size() - arena_offset});
+    }
+}
+
+
+void MessageComposer::push_compressed(const uint8_t* buffer, size_t size)
+{
+    const int level = compression_ == CompressionMode::Best ? 9 : 1;
+
+    for (size_t offset = 0; offset < size; offset += payload_chunk_size) {
+        const size_t chunk_size = min(payload_chunk_size, size - offset);
+
+        QByteArray compressed =
+            qCompress(buffer + offset, static_cast<int>(chunk_size), level);
+
+        // Chunks that do not compress are sent as they are
+        if (static_cast<size_t>(compressed.size()) < chunk_size) {
+            compressed_chunks_.push_back(compressed);
+
+            push(PayloadCodec::Zlib)
+                .push(static_cast<size_t>(compressed.size()));
+            push_external(
+                reinterpret_cast<const uint8_t*>(
+                    compressed_chunks_.back().constData()),
+                static_cast<size_t>(compressed.size()));
+        } else {
+            push(PayloadCodec::Raw).push(chunk_size);
+            push_external(buffer + offset, chunk_size);
+        }
+    }
+}
+
+
+PayloadReceiver::PayloadReceiver()
+    : dst_(nullptr)
+    , size_(0)
+    , offset_(0)
+    , wire_bytes_(0)
+    , decompression_ms_(0.0)
+    , chunk_codec_(PayloadCodec::Raw)
+    , chunk_remaining_(0)
+    , failed_(false)
+{
+}
+
+
+void PayloadReceiver::start(uint8_t* dst, size_t size)
+{
+    dst_             = dst;
+    size_            = size;
+    offset_           = 0;
+    wire_bytes_       = 0;
+    decompression_ms_ = 0.0;
+    chunk_remaining_  = 0;
+    failed_           = false;
+    compressed_chunk_.clear();
+}
+
+
+bool PayloadReceiver::receive(QIODevice* device)
+{
+    while (offset_ < size_ && !failed_) {
+        // Chunk header
+        if (chunk_remaining_ == 0) {
+            const qint64 header_size =
+                static_cast<qint64>(sizeof(chunk_codec_) + sizeof(size_t));
+            if (device->bytesAvailable() < header_size) {
+                return false;
+            }
+
+            device->read(reinterpret_cast<char*>(&chunk_codec_),
+                         sizeof(chunk_codec_));
+            device->read(reinterpret_cast<char*>(&chunk_remaining_),
+                         sizeof(chunk_remaining_));
+            wire_bytes_ += static_cast<size_t>(header_size);
+
+            const bool valid_raw_chunk = chunk_codec_ == PayloadCodec::Raw &&
+                                         chunk_remaining_ <= size_ - offset_;
+            const bool valid_zlib_chunk = chunk_codec_ == PayloadCodec::Zlib;
+
+            if (chunk_remaining_ == 0 ||
+                (!valid_raw_chunk && !valid_zlib_chunk)) {
+                cerr << "[OpenImageDebugger] Received malformed payload"
+                     << endl;
+                failed_ = true;
+            }
+
+            compressed_chunk_.clear();
+            continue;
+        }
+
+        // Chunk contents
+        const qint64 available =
+            min(device->bytesAvailable(), static_cast<qint64>(chunk_remaining_));
+        if (available <= 0) {
+            return false;
+        }
+
+        if (chunk_codec_ == PayloadCodec::Raw) {
+            const qint64 bytes_read =
+                device->read(reinterpret_cast<char*>(dst_ + offset_), available);
+            if (bytes_read <= 0) {
+                return false;
+            }
+
+            offset_ += static_cast<size_t>(bytes_read);
+            wire_bytes_ += static_cast<size_t>(bytes_read);
+            chunk_remaining_ -= static_cast<size_t>(bytes_read);
+        } else {
+            const int previous_size = compressed_chunk_.size();
+            compressed_chunk_.resize(previous_size +
+                                     static_cast<int>(available));
+
+            const qint64 bytes_read = device->read(
+                compressed_chunk_.data() + previous_size, available);
+            if (bytes_read <= 0) {
+                compressed_chunk_.resize(previous_size);
+                return false;
+            }
+
+            compressed_chunk_.resize(previous_size +
+                                     static_cast<int>(bytes_read));
+            wire_bytes_ += static_cast<size_t>(bytes_read);
+            chunk_remaining_ -= static_cast<size_t>(bytes_read);
+
+            if (chunk_remaining_ == 0) {
+                const auto decompression_start = chrono::steady_clock::now();
+
+                const QByteArray chunk  = qUncompress(compressed_chunk_);
+                const size_t chunk_size = static_cast<size_t>(chunk.size());
+
+                decompression_ms_ += chrono::duration<double, milli>(
+                                         chrono::steady_clock::now() -
+                                         decompression_start)
+                                         .count();
+
+                if (chunk_size == 0 || chunk_size > size_ - offset_) {
+                    cerr << "[OpenImageDebugger] Could not decompress payload"
+                         << endl;
+                    failed_ = true;
+                    continue;
+                }
+
+                memcpy(dst_ + offset_, chunk.constData(), chunk_size);
+                offset_ += chunk_size;
+                compressed_chunk_.clear();
+            }
+        }
+    }
+
+    return true;
+}
+
+
+bool PayloadReceiver::failed() const
 {
+    return failed_;
 }
 
-StringBlock::StringBlock(const std::string &value)
-    : data_(value)
+
+size_t PayloadReceiver::bytes_received() const
 {
+    return offset_;
 }
 
-size_t StringBlock::size() const
+
+size_t PayloadReceiver::total_bytes() const
 {
-    return data_.size();
+    return size_;
 }
 
-const uint8_t *StringBlock::data() const
+
+size_t PayloadReceiver::wire_bytes() const
+{
+    return wire_bytes_;
+}
+
+
+double PayloadReceiver::decompression_ms() const
+{
+    return decompression_ms_;
+}
+
+
+void MessageDecoder::read_payload(uint8_t* dst, size_t length)
+{
+    PayloadReceiver receiver;
+    receiver.start(dst, length);
+
+    while (!receiver.receive(socket_)) {
+        if (!blocking_) {
+            complete_ = false;
+            return;
+        }
+
+        socket_->waitForReadyRead();
+    }
+}
+
+
+MessageSendQueue::MessageSendQueue(QTcpSocket* socket)
+    : socket_(socket)
+{
+}
+
+
+MessageSendQueue::~MessageSendQueue()
+{
+    clear();
+}
+
+
+void MessageSendQueue::set_socket(QTcpSocket* socket)
+{
+    socket_ = socket;
+}
+
+
+void MessageSendQueue::enqueue(MessageComposer&& message,
+                               function<void()> on_sent,
+                               function<void()> on_discarded)
+{
+    unique_ptr<PendingMessage> pending(new PendingMessage());
+    pending->message = std::move(message);
+    pending->message.finish_frame();
+    pending->message.build_segments(pending->segments);
+    pending->segment_index  = 0;
+    pending->segment_offset = 0;
+    pending->on_sent        = std::move(on_sent);
+    pending->on_discarded   = std::move(on_discarded);
+
+    pending_.push_back(std::move(pending));
+
+    pump();
+}
+
+
+void MessageSendQueue::pump()
+{
+    if (socket_ == nullptr) {
+        return;
+    }
+
+    while (!pending_.empty()) {
+        PendingMessage& message = *pending_.front();
+
+        write_segments(socket_,
+                       message.segments,
+                       message.segment_index,
+                       message.segment_offset);
+
+        if (message.segment_index < message.segments.size()) {
+            return;
+        }
+
+        // Everything was handed to the socket; release the buffers
+        function<void()> on_sent = std::move(message.on_sent);
+        pending_.pop_front();
+
+        if (on_sent) {
+            on_sent();
+        }
+    }
+}
+
+
+void MessageSendQueue::pump_for(int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    pump();
+
+    while (!pending_.empty() && timer.elapsed() < msecs) {
+        const int remaining = msecs - static_cast<int>(timer.elapsed());
+
+        // Unfinished messages always leave data in the socket buffer, unless
+        // the socket failed
+        if (socket_->bytesToWrite() == 0 ||
+            !socket_->waitForBytesWritten(remaining)) {
+            return;
+        }
+
+        pump();
+    }
+}
+
+
+void MessageSendQueue::flush()
+{
+    pump();
+
+    while (!pending_.empty()) {
+        if (socket_ == nullptr || socket_->bytesToWrite() == 0 ||
+            !socket_->waitForBytesWritten()) {
+            cerr << "[OpenImageDebugger] Could not send queued messages"
+                 << endl;
+            clear();
+            return;
+        }
+
+        pump();
+    }
+
+    while (socket_ != nullptr && socket_->bytesToWrite() > 0 &&
+           socket_->waitForBytesWritten()) {
+    }
+}
+
+
+void MessageSendQueue::clear()
+{
+    while (!pending_.empty()) {
+        function<void()> on_sent = std::move(pending_.front()->on_sent);
+        pending_.pop_front();
+
+        if (on_sent) {
+            on_sent();
+        }
+    }
+}
+
+
+size_t MessageSendQueue::discard_unsent()
+{
+    size_t discarded_count = 0;
+    bool previous_discarded = false;
+
+    auto message_it = pending_.begin();
+    while (message_it != pending_.end()) {
+        const PendingMessage& message = **message_it;
+        const bool started =
+            message.segment_index > 0 || message.segment_offset > 0;
+
+        // Joined messages are never started before the one they belong to
+        const bool discarded = message.message.joins_previous_
+                                   ? previous_discarded
+                                   : !started && message.on_discarded;
+        previous_discarded = discarded;
+
+        if (!discarded) {
+            ++message_it;
+            continue;
+        }
+
+        function<void()> on_discarded = std::move((*message_it)->on_discarded);
+        function<void()> on_sent      = std::move((*message_it)->on_sent);
+        message_it                    = pending_.erase(message_it);
+        ++discarded_count;
+
+        if (on_discarded) {
+            on_discarded();
+        }
+        if (on_sent) {
+            on_sent();
+        }
+    }
+
+    return discarded_count;
+}
+
+
+bool MessageSendQueue::empty() const
 {
-    return reinterpret_cast<const uint8_t*>(data_.data());
+    return pending_.empty();
 }
@@ -26,8 +26,12 @@
 #ifndef IPC_MESSAGE_EXCHANGE_H_
 #define IPC_MESSAGE_EXCHANGE_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <deque>
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include <QTcpSocket>
 
@@ -38,78 +42,67 @@ enum class MessageType {
     GetObservedSymbolsResponse = 1,
     SetAvailableSymbols        = 2,
     PlotBufferContents         = 3,
-    PlotBufferRequest          = 4
+    PlotBufferRequest          = 4,
+    PlotBufferContentsShared   = 5,
+    SharedMemoryUnavailable    = 6,
+    PlotBufferTiles            = 7,
+    InvalidateBufferCache      = 8,
+    SetCompressionMode         = 9,
+    PlotBufferBatch            = 10,
+    PlotBufferPreview          = 11,
+    PlotBufferLazy             = 12,
+    RequestBufferRegion        = 13,
+    PlotBufferRegion           = 14,
+    SetPlotPriorities          = 15,
+    SetStopGeneration          = 16,
+    PlotBufferUnavailable      = 17,
+    PlotBufferChunk            = 18,
+    SetAvailableSymbolsDiff    = 19,
+    RequestAvailableSymbols    = 20,
+    PlotBufferAlias            = 21
 };
 
-struct MessageBlock
-{
-    virtual size_t size() const         = 0;
-    virtual const uint8_t* data() const = 0;
-    virtual ~MessageBlock();
-};
+enum class CompressionMode { None = 0, Fast = 1, Best = 2 };
 
-template <typename Primitive>
-struct PrimitiveBlock : public MessageBlock
-{
-    PrimitiveBlock(Primitive value)
-        : data_(value)
-    {
-    }
+// Encoding of each chunk of a buffer payload
+enum class PayloadCodec : unsigned char { Raw = 0, Zlib = 1 };
 
-    virtual size_t size() const
-    {
-        return sizeof(Primitive);
-    }
+// Buffer payloads are compressed in chunks of this size, so that the receiver
+// can decompress each chunk while the next one is still arriving
+const std::size_t payload_chunk_size = 1 << 20;
 
-    virtual const uint8_t* data() const
-    {
-        return reinterpret_cast<const uint8_t*>(&data_);
-    }
-
-  private:
-    Primitive data_;
+/*
+ * Every message starts with this header, so that receivers can skip the
+ * messages they don't understand (or whose version they don't support)
+ * without losing track of the stream.
+ */
+struct MessageHeader
+{
+    MessageType type;
+    uint32_t version;
+    // Size of the message fields, excluding this header
+    uint64_t length;
+    // Plot request this message belongs to, for tracing; 0 if none
+    uint64_t request_id;
 };
 
+const uint32_t message_protocol_version = 2;
 
-struct StringBlock : public MessageBlock
+struct MessageSegment
 {
-    StringBlock(const std::string& value);
-
-    virtual size_t size() const;
-
-    virtual const uint8_t* data() const;
-
-  private:
-    std::string data_;
+    const uint8_t* data;
+    std::size_t size;
 };
 
-struct BufferBlock : public MessageBlock
-{
-    BufferBlock(const uint8_t* buffer, size_t length)
-        : buffer_(buffer)
-        , length_(length)
-    {
-    }
-
-    virtual size_t size() const
-    {
-        return length_;
-    }
-
-    virtual const uint8_t* data() const
-    {
-        return buffer_;
-    }
-
-  private:
-    const uint8_t* buffer_;
-    size_t length_;
-};
+class MessageSendQueue;
 
 template <typename PrimitiveType>
 void assert_primitive_type()
 {
     static_assert(std::is_same<PrimitiveType, MessageType>::value ||
+                      std::is_same<PrimitiveType, MessageHeader>::value ||
+                      std::is_same<PrimitiveType, CompressionMode>::value ||
+                      std::is_same<PrimitiveType, PayloadCodec>::value ||
                       std::is_same<PrimitiveType, int>::value ||
                       std::is_same<PrimitiveType, unsigned char>::value ||
                       std::is_same<PrimitiveType, BufferType>::value ||
@@ -118,15 +111,53 @@ void assert_primitive_type()
                   "this function must only be called with primitives");
 }
 
+/*
+ * Serializes one or more messages. Fields are copied into a single arena;
+ * large buffers are only referenced, and sent straight from their original
+ * memory.
+ */
 class MessageComposer
 {
   public:
+    MessageComposer();
+
+    // Compression applied to the buffers pushed after this call
+    MessageComposer& set_compression(CompressionMode compression)
+    {
+        compression_ = compression;
+
+        return *this;
+    }
+
+    // Plot request of the messages pushed after this call (see trace_events.h)
+    MessageComposer& set_request_id(uint64_t request_id)
+    {
+        request_id_ = request_id;
+
+        return *this;
+    }
+
+    /**
+     * Make this message part of the one queued right before it, e.g. one of
+     * the buffers of a PlotBufferBatch: MessageSendQueue::discard_unsent()
+     * drops it if and only if it drops that message
+     */
+    MessageComposer& join_previous()
+    {
+        joins_previous_ = true;
+
+        return *this;
+    }
+
+    // Start a new message (the previous one, if any, is finished)
+    MessageComposer& push(MessageType type);
+
     template <typename PrimitiveType>
     MessageComposer& push(const PrimitiveType& value)
     {
         assert_primitive_type<PrimitiveType>();
 
-        message_blocks_.emplace_back(new PrimitiveBlock<PrimitiveType>(value));
+        append(&value, sizeof(PrimitiveType));
 
         return *this;
     }
@@ -134,46 +165,208 @@ class MessageComposer
     MessageComposer& push(uint8_t* buffer, size_t size)
     {
         push(size);
-        message_blocks_.emplace_back(new BufferBlock(buffer, size));
+
+        if (compression_ == CompressionMode::None) {
+            if (size > 0) {
+                push(PayloadCodec::Raw).push(size);
+                push_external(buffer, size);
+            }
+        } else {
+            push_compressed(buffer, size);
+        }
 
         return *this;
     }
 
-    void send(QTcpSocket* socket) const
+    // Keep a copy of buffer alive for as long as this message
+    MessageComposer& push_owned(std::vector<uint8_t>&& buffer)
     {
-        for (const auto& block : message_blocks_) {
-            qint64 offset = 0;
-            do {
-                offset +=
-                    socket->write(reinterpret_cast<const char*>(block->data()),
-                                  static_cast<qint64>(block->size()));
-
-                if (offset < static_cast<qint64>(block->size())) {
-                    socket->waitForBytesWritten();
-                }
-            } while (offset < static_cast<qint64>(block->size()));
-        }
+        owned_buffers_.push_back(std::move(buffer));
 
-        socket->waitForBytesWritten();
+        return push(owned_buffers_.back().data(), owned_buffers_.back().size());
     }
 
-    void clear()
+    // Blocks until the whole message was written
+    void send(QTcpSocket* socket);
+
+    /**
+     * Move this message into queue, which will send it without blocking.
+     * on_sent is called once the pushed buffers are no longer needed.
+     * If on_discarded is given, the message may be dropped by
+     * MessageSendQueue::discard_unsent(), which then calls it before on_sent.
+     */
+    void send_async(MessageSendQueue& queue,
+                    std::function<void()> on_sent      = nullptr,
+                    std::function<void()> on_discarded = nullptr);
+
+    void clear();
+
+  private:
+    friend class MessageSendQueue;
+
+    // Buffer sent in between arena_[0, arena_offset) and the rest of arena_
+    struct ExternalBlock
     {
-        message_blocks_.clear();
+        std::size_t arena_offset;
+        const uint8_t* data;
+        std::size_t size;
+    };
+
+    CompressionMode compression_;
+    uint64_t request_id_;
+    bool joins_previous_;
+
+    std::vector<uint8_t> arena_;
+    std::vector<ExternalBlock> external_blocks_;
+    std::deque<QByteArray> compressed_chunks_;
+    std::deque<std::vector<uint8_t>> owned_buffers_;
+
+    // Header of the message being composed, if any
+    std::size_t frame_offset_;
+    std::size_t frame_external_bytes_;
+
+    void append(const void* data, std::size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        arena_.insert(arena_.end(), bytes, bytes + size);
     }
 
+    void push_external(const uint8_t* buffer, std::size_t size);
+
+    void push_compressed(const uint8_t* buffer, size_t size);
+
+    // Write the length of the current message into its header
+    void finish_frame();
+
+    void build_segments(std::vector<MessageSegment>& segments) const;
+};
+
+
+/*
+ * Writes messages in the order they were queued, only as far as the socket
+ * accepts data without blocking. Large buffers are written straight from
+ * their original memory (with vectored writes where available), instead of
+ * being copied into the socket's write buffer.
+ */
+class MessageSendQueue
+{
+  public:
+    explicit MessageSendQueue(QTcpSocket* socket = nullptr);
+
+    ~MessageSendQueue();
+
+    void set_socket(QTcpSocket* socket);
+
+    void enqueue(MessageComposer&& message,
+                 std::function<void()> on_sent      = nullptr,
+                 std::function<void()> on_discarded = nullptr);
+
+    // Write as much as possible without blocking
+    void pump();
+
+    // Keep writing for up to msecs milliseconds, or until the queue is empty
+    void pump_for(int msecs);
+
+    // Block until all queued messages were written
+    void flush();
+
+    // Drop all queued messages (their callbacks are still called)
+    void clear();
+
+    /**
+     * Drop the discardable messages which didn't start being written yet,
+     * along with the messages joined to them. The message being written is
+     * always finished, so that the stream remains consistent.
+     *
+     * @return number of dropped messages
+     */
+    std::size_t discard_unsent();
+
+    bool empty() const;
+
+  private:
+    struct PendingMessage
+    {
+        MessageComposer message;
+        std::vector<MessageSegment> segments;
+        std::size_t segment_index;
+        std::size_t segment_offset;
+        std::function<void()> on_sent;
+        std::function<void()> on_discarded;
+    };
+
+    QTcpSocket* socket_;
+    std::deque<std::unique_ptr<PendingMessage>> pending_;
+};
+
+/*
+ * Receives a buffer payload (as written by MessageComposer::push(buffer,
+ * size)) incrementally, decompressing each chunk as soon as it is complete.
+ */
+class PayloadReceiver
+{
+  public:
+    PayloadReceiver();
+
+    // Start receiving size bytes (after the size field itself) into dst
+    void start(uint8_t* dst, std::size_t size);
+
+    /**
+     * Consume the payload bytes currently available in device, without
+     * blocking.
+     *
+     * @return true once the payload is complete (or failed)
+     */
+    bool receive(QIODevice* device);
+
+    bool failed() const;
+
+    std::size_t bytes_received() const;
+
+    std::size_t total_bytes() const;
+
+    // Bytes read from the device so far, which are fewer than the payload
+    // itself if it is compressed
+    std::size_t wire_bytes() const;
+
+    // Time spent decompressing the payload so far
+    double decompression_ms() const;
+
   private:
-    std::deque<std::unique_ptr<MessageBlock>> message_blocks_;
+    uint8_t* dst_;
+    std::size_t size_;
+    std::size_t offset_;
+    std::size_t wire_bytes_;
+    double decompression_ms_;
+
+    PayloadCodec chunk_codec_;
+    std::size_t chunk_remaining_;
+    QByteArray compressed_chunk_;
+
+    bool failed_;
 };
 
 class MessageDecoder
 {
   public:
-    MessageDecoder(QTcpSocket* socket)
+    /**
+     * In non-blocking mode, reads fail instead of waiting for more data, and
+     * complete() returns false afterwards. Callers are expected to retry
+     * the whole message later, e.g. by wrapping it in a QIODevice
+     * transaction.
+     */
+    MessageDecoder(QTcpSocket* socket, bool blocking = true)
         : socket_(socket)
+        , blocking_(blocking)
+        , complete_(true)
     {
     }
 
+    bool complete() const
+    {
+        return complete_;
+    }
+
     template <typename PrimitiveType>
     MessageDecoder& read(PrimitiveType& value)
     {
@@ -190,6 +383,10 @@ class MessageDecoder
         size_t number_symbols;
         read(number_symbols);
 
+        if (!complete_) {
+            return *this;
+        }
+
         for (int s = 0; s < static_cast<int>(number_symbols); ++s) {
             StringType symbol_value;
             read(symbol_value);
@@ -200,11 +397,48 @@ class MessageDecoder
         return *this;
     }
 
+    // Discard the next length bytes, e.g. the fields of an unknown message
+    MessageDecoder& skip(size_t length)
+    {
+        if (!blocking_ &&
+            socket_->bytesAvailable() < static_cast<qint64>(length)) {
+            complete_ = false;
+            return *this;
+        }
+
+        char discarded[4096];
+        while (length > 0 && complete_) {
+            const size_t chunk_length = std::min(length, sizeof(discarded));
+            read_impl(discarded, chunk_length);
+            length -= chunk_length;
+        }
+
+        return *this;
+    }
+
   private:
     QTcpSocket* socket_;
+    bool blocking_;
+    bool complete_;
+
+    void read_payload(uint8_t* dst, size_t length);
 
     void read_impl(char* dst, size_t read_length)
     {
+        if (!complete_) {
+            return;
+        }
+
+        if (!blocking_) {
+            if (socket_->bytesAvailable() < static_cast<qint64>(read_length)) {
+                complete_ = false;
+                return;
+            }
+
+            socket_->read(dst, static_cast<qint64>(read_length));
+            return;
+        }
+
         size_t offset = 0;
         do {
             offset += socket_->read(dst + offset,
@@ -221,7 +455,7 @@ template <> inline
 MessageComposer& MessageComposer::push<std::string>(const std::string& value)
 {
     push(value.size());
-    message_blocks_.emplace_back(new StringBlock(value));
+    append(value.data(), value.size());
     return *this;
 }
 
@@ -242,8 +476,12 @@ MessageDecoder& MessageDecoder::read<std::vector<uint8_t>>(std::vector<uint8_t>&
     size_t container_size;
     read(container_size);
 
+    if (!complete_) {
+        return *this;
+    }
+
     container.resize(container_size);
-    read_impl(reinterpret_cast<char*>(container.data()), container_size);
+    read_payload(container.data(), container_size);
 
     return *this;
 }
@@ -254,6 +492,10 @@ MessageDecoder& MessageDecoder::read<std::string>(std::string& value)
     size_t symbol_length;
     read(symbol_length);
 
+    if (!complete_) {
+        return *this;
+    }
+
     value.resize(symbol_length);
     read_impl(&value.front(), static_cast<qint64>(symbol_length));
 
@@ -266,6 +508,10 @@ MessageDecoder& MessageDecoder::read<QString>(QString& value)
     size_t symbol_length;
     read(symbol_length);
 
+    if (!complete_) {
+        return *this;
+    }
+
     std::vector<char> temp_string;
     temp_string.resize(symbol_length + 1, '\0');
     read_impl(reinterpret_cast<char*>(temp_string.data()), symbol_length);
@@ -25,37 +25,216 @@
 
 #include "raw_data_decode.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <thread>
 
-std::vector<std::uint8_t>
-    make_float_buffer_from_double(const std::vector<std::uint8_t>& buff_double)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace
+{
+
+// Below this size, spawning threads costs more than the conversion itself
+const std::size_t parallel_conversion_threshold = 4 << 20;
+
+const unsigned int max_conversion_threads = 8;
+
+
+// Narrows the doubles in [first, last) to floats written from the start of
+// the same range. Every store only overwrites doubles that were already
+// loaded, so the range can be converted in place.
+void narrow_double_range(std::uint8_t* buffer,
+                         std::size_t first,
+                         std::size_t last)
+{
+    std::uint8_t* src = buffer + first * sizeof(double);
+    std::uint8_t* dst = src;
+    std::size_t i     = first;
+
+#if defined(__SSE2__)
+    for (; i + 4 <= last; i += 4) {
+        const __m128d low  = _mm_loadu_pd(reinterpret_cast<double*>(src));
+        const __m128d high = _mm_loadu_pd(reinterpret_cast<double*>(src) + 2);
+        _mm_storeu_ps(reinterpret_cast<float*>(dst),
+                      _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high)));
+
+        src += 4 * sizeof(double);
+        dst += 4 * sizeof(float);
+    }
+#endif
+
+    for (; i < last; ++i) {
+        double value;
+        std::memcpy(&value, src, sizeof(double));
+        const float narrowed = static_cast<float>(value);
+        std::memcpy(dst, &narrowed, sizeof(float));
+
+        src += sizeof(double);
+        dst += sizeof(float);
+    }
+}
+
+
+// Same as narrow_double_range, for 64 bit integers
+void narrow_int64_range(std::uint8_t* buffer,
+                        std::size_t first,
+                        std::size_t last)
+{
+    std::uint8_t* src = buffer + first * sizeof(std::int64_t);
+    std::uint8_t* dst = src;
+
+    for (std::size_t i = first; i < last; ++i) {
+        std::int64_t value;
+        std::memcpy(&value, src, sizeof(std::int64_t));
+        const float narrowed = static_cast<float>(value);
+        std::memcpy(dst, &narrowed, sizeof(float));
+
+        src += sizeof(std::int64_t);
+        dst += sizeof(float);
+    }
+}
+
+
+using NarrowRange = void (*)(std::uint8_t*, std::size_t, std::size_t);
+
+
+// Narrows a buffer of 8 byte elements to floats with narrow_range
+void narrow_buffer_to_float(std::vector<std::uint8_t>& buffer,
+                            NarrowRange narrow_range)
+{
+    const std::size_t element_count = buffer.size() / sizeof(double);
+    std::uint8_t* data              = buffer.data();
+
+    unsigned int num_threads = 1;
+    if (buffer.size() >= parallel_conversion_threshold) {
+        num_threads =
+            std::min(std::max(std::thread::hardware_concurrency(), 1u),
+                     max_conversion_threads);
+    }
+
+    if (num_threads <= 1) {
+        narrow_range(data, 0, element_count);
+        buffer.resize(element_count * sizeof(float));
+        return;
+    }
+
+    // Each range is narrowed in place by its own thread, and then moved
+    // next to the previous one. The first range is already in its place.
+    const std::size_t elements_per_thread =
+        (element_count + num_threads - 1) / num_threads;
+
+    std::vector<std::thread> workers;
+    for (std::size_t first = elements_per_thread; first < element_count;
+         first += elements_per_thread) {
+        const std::size_t last =
+            std::min(first + elements_per_thread, element_count);
+        workers.emplace_back(narrow_range, data, first, last);
+    }
+
+    narrow_range(data, 0, elements_per_thread);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (std::size_t first = elements_per_thread; first < element_count;
+         first += elements_per_thread) {
+        const std::size_t last =
+            std::min(first + elements_per_thread, element_count);
+        std::memmove(data + first * sizeof(float),
+                     data + first * sizeof(double),
+                     (last - first) * sizeof(float));
+    }
+
+    buffer.resize(element_count * sizeof(float));
+}
+
+} // namespace
+
+
+std::uint16_t float_to_half(float value)
 {
-    int element_count = buff_double.size() / sizeof(double);
-    std::vector<std::uint8_t> buff_float(element_count);
-
-    // Cast from double to float
-    const double* src = reinterpret_cast<const double*>(buff_double.data());
-    float* dst = reinterpret_cast<float*>(buff_float.data());
-    for (int i = 0; i < element_count; ++i) {
-        dst[i] = static_cast<float>(src[i]);
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const std::uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    std::uint16_t half;
+    if (bits >= (127u + 16u) << 23) {
+        // Overflows become infinities, and NaNs stay quiet NaNs
+        half = bits > 255u << 23 ? 0x7e00 : 0x7c00;
+    } else if (bits < 113u << 23) {
+        // Subnormals and zeros, rounded by the float unit when adding a
+        // value whose exponent leaves only the bits of the half mantissa
+        const std::uint32_t magic_bits = ((127 - 15) + (23 - 10) + 1) << 23;
+        float magic;
+        float magnitude;
+        std::memcpy(&magic, &magic_bits, sizeof(magic));
+        std::memcpy(&magnitude, &bits, sizeof(magnitude));
+
+        magnitude += magic;
+        std::memcpy(&bits, &magnitude, sizeof(bits));
+        half = static_cast<std::uint16_t>(bits - magic_bits);
+    } else {
+        const std::uint32_t odd_mantissa = (bits >> 13) & 1;
+        bits += (static_cast<std::uint32_t>(15 - 127) << 23) + 0xfff;
+        bits += odd_mantissa;
+        half = static_cast<std::uint16_t>(bits >> 13);
     }
 
-    return buff_float;
+    return static_cast<std::uint16_t>(half | (sign >> 16));
+}
+
+
+BufferType held_buffer_type(BufferType type)
+{
+    if (type == BufferType::Float64 || type == BufferType::Int64) {
+        return BufferType::Float32;
+    }
+
+    return type;
+}
+
+
+size_t held_pixel_size(BufferType type, int channels)
+{
+    return static_cast<size_t>(channels) * typesize(held_buffer_type(type));
+}
+
+
+void narrow_buffer_to_held_type(BufferType type,
+                                std::vector<std::uint8_t>& buffer)
+{
+    if (type == BufferType::Float64) {
+        narrow_buffer_to_float(buffer, narrow_double_range);
+    } else if (type == BufferType::Int64) {
+        narrow_buffer_to_float(buffer, narrow_int64_range);
+    }
 }
 
 
 size_t typesize(BufferType type)
 {
     switch(type) {
-    case BufferType::Int32:
+    case BufferType::Int64:
+        return sizeof(std::int64_t);
+    case BufferType::Int32: // fall-through
+    case BufferType::UnsignedInt32:
         return sizeof(int32_t);
     case BufferType::Short: // fall-through
     case BufferType::UnsignedShort:
+    case BufferType::Float16:
         return sizeof(int16_t);
     case BufferType::Float32:
         return sizeof(float);
     case BufferType::Float64:
         return sizeof(double);
+    case BufferType::Int8: // fall-through
     case BufferType::UnsignedByte:
         return sizeof(std::uint8_t);
     default:
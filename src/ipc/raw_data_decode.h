@@ -28,20 +28,85 @@
 
 #include <cstddef> // for std::size_t
 #include <cstdint> // for std::uint8_t
+#include <cstring> // for std::memcpy
 
 #include <vector> // for std::vector
 
 enum class BufferType {
     UnsignedByte  = 0,
+    Int8          = 1,
     UnsignedShort = 2,
     Short         = 3,
     Int32         = 4,
     Float32       = 5,
-    Float64       = 6
+    Float64       = 6,
+    Float16       = 7,
+    UnsignedInt32 = 8,
+    Int64         = 9
 };
 
-std::vector<std::uint8_t>
-    make_float_buffer_from_double(const std::vector<std::uint8_t>& buff_double);
+/*
+ * IEEE 754 half precision value, as held in Float16 buffers. It converts to
+ * float implicitly, so that the templates over the held value types accept
+ * it along with the arithmetic types.
+ */
+struct Half
+{
+    std::uint16_t bits;
+
+    operator float() const;
+};
+
+inline float half_to_float(std::uint16_t bits)
+{
+    const std::uint32_t shifted_exponent = 0x7c00u << 13;
+
+    std::uint32_t value_bits = (bits & 0x7fffu) << 13;
+    const std::uint32_t exponent = value_bits & shifted_exponent;
+    value_bits += (127 - 15) << 23;
+
+    float value;
+    if (exponent == shifted_exponent) {
+        // Infinities and NaNs
+        value_bits += (128 - 16) << 23;
+    } else if (exponent == 0) {
+        // Zeros and subnormals, renormalized by the float unit
+        const std::uint32_t magic_bits = 113u << 23;
+        float magic;
+        std::memcpy(&magic, &magic_bits, sizeof(magic));
+
+        value_bits += 1 << 23;
+        std::memcpy(&value, &value_bits, sizeof(value));
+        value -= magic;
+        std::memcpy(&value_bits, &value, sizeof(value));
+    }
+
+    value_bits |= static_cast<std::uint32_t>(bits & 0x8000u) << 16;
+    std::memcpy(&value, &value_bits, sizeof(value));
+
+    return value;
+}
+
+inline Half::operator float() const
+{
+    return half_to_float(bits);
+}
+
+// Rounds to the nearest half, ties to even
+std::uint16_t float_to_half(float value);
+
+// Doubles and 64 bit integers are held as floats once they are received,
+// the other types as they are sent. Pixels of the held contents are made of
+// channels values of the held type.
+BufferType held_buffer_type(BufferType type);
+
+std::size_t held_pixel_size(BufferType type, int channels);
+
+// Converts the contents of a buffer to its held type. They are narrowed
+// towards the front of the same allocation, whose capacity is kept, so the
+// conversion doesn't need a second copy of the buffer.
+void narrow_buffer_to_held_type(BufferType type,
+                                std::vector<std::uint8_t>& buffer);
 
 std::size_t typesize(BufferType type);
 
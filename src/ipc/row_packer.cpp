@@ -0,0 +1,224 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "row_packer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Below this size, spawning threads costs more than the copy itself
+const size_t parallel_copy_threshold = 4 << 20;
+
+const unsigned int max_copy_threads = 8;
+
+
+void pack_row_range(const uint8_t* src,
+                    size_t src_row_length,
+                    size_t dst_row_length,
+                    int first_row,
+                    int last_row,
+                    uint8_t* dst)
+{
+    for (int y = first_row; y < last_row; ++y) {
+        memcpy(dst + static_cast<size_t>(y) * dst_row_length,
+               src + static_cast<size_t>(y) * src_row_length,
+               dst_row_length);
+    }
+}
+
+// Interleave the rows [first_row, last_row) of the channels planes of src,
+// whose elements are ChannelSize bytes long
+template <size_t ChannelSize>
+void interleave_row_range(const uint8_t* src,
+                          size_t src_row_length,
+                          size_t plane_length,
+                          int width,
+                          int channels,
+                          size_t dst_row_length,
+                          int first_row,
+                          int last_row,
+                          uint8_t* dst)
+{
+    const size_t pixel_size = static_cast<size_t>(channels) * ChannelSize;
+
+    for (int y = first_row; y < last_row; ++y) {
+        uint8_t* dst_row = dst + static_cast<size_t>(y) * dst_row_length;
+
+        for (int c = 0; c < channels; ++c) {
+            const uint8_t* src_row = src +
+                                     static_cast<size_t>(c) * plane_length +
+                                     static_cast<size_t>(y) * src_row_length;
+            uint8_t* dst_channel = dst_row + static_cast<size_t>(c) *
+                                                 ChannelSize;
+
+            for (int x = 0; x < width; ++x) {
+                memcpy(dst_channel + static_cast<size_t>(x) * pixel_size,
+                       src_row + static_cast<size_t>(x) * ChannelSize,
+                       ChannelSize);
+            }
+        }
+    }
+}
+
+
+// Call copy_rows(first_row, last_row) over all the height rows of a copy of
+// total_length bytes, split between several threads if it is large
+template <typename CopyRows>
+void for_row_ranges(int height, size_t total_length, const CopyRows& copy_rows)
+{
+    unsigned int num_threads = 1;
+    if (total_length >= parallel_copy_threshold) {
+        num_threads = min(max(thread::hardware_concurrency(), 1u),
+                          max_copy_threads);
+        num_threads = min(num_threads, static_cast<unsigned int>(height));
+    }
+
+    if (num_threads <= 1) {
+        copy_rows(0, height);
+        return;
+    }
+
+    const int rows_per_thread =
+        (height + static_cast<int>(num_threads) - 1) /
+        static_cast<int>(num_threads);
+
+    vector<thread> workers;
+    for (int first_row = rows_per_thread; first_row < height;
+         first_row += rows_per_thread) {
+        const int last_row = min(first_row + rows_per_thread, height);
+        workers.emplace_back(copy_rows, first_row, last_row);
+    }
+
+    // The first range is copied by the calling thread
+    copy_rows(0, rows_per_thread);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+
+void pack_rows(const uint8_t* src,
+               int width,
+               int height,
+               int step,
+               size_t pixel_size,
+               uint8_t* dst)
+{
+    const size_t src_row_length = static_cast<size_t>(step) * pixel_size;
+    const size_t dst_row_length = static_cast<size_t>(width) * pixel_size;
+
+    for_row_ranges(height,
+                   dst_row_length * static_cast<size_t>(height),
+                   [=](int first_row, int last_row) {
+                       pack_row_range(src,
+                                      src_row_length,
+                                      dst_row_length,
+                                      first_row,
+                                      last_row,
+                                      dst);
+                   });
+}
+
+
+void pack_planes(const uint8_t* src,
+                 int width,
+                 int height,
+                 int step,
+                 int channels,
+                 size_t channel_size,
+                 int dst_step,
+                 uint8_t* dst)
+{
+    // The copy of each element has a constant size
+    auto interleave_rows = interleave_row_range<1>;
+    if (channel_size == 2) {
+        interleave_rows = interleave_row_range<2>;
+    } else if (channel_size == 4) {
+        interleave_rows = interleave_row_range<4>;
+    } else if (channel_size == 8) {
+        interleave_rows = interleave_row_range<8>;
+    }
+
+    const size_t src_row_length = static_cast<size_t>(step) * channel_size;
+    const size_t plane_length   = src_row_length * static_cast<size_t>(height);
+    const size_t dst_row_length = static_cast<size_t>(dst_step) *
+                                  static_cast<size_t>(channels) * channel_size;
+
+    for_row_ranges(height,
+                   plane_length * static_cast<size_t>(channels),
+                   [=](int first_row, int last_row) {
+                       interleave_rows(src,
+                                       src_row_length,
+                                       plane_length,
+                                       width,
+                                       channels,
+                                       dst_row_length,
+                                       first_row,
+                                       last_row,
+                                       dst);
+                   });
+}
+
+
+void pack_preview(const uint8_t* src,
+                  int width,
+                  int height,
+                  int step,
+                  size_t pixel_size,
+                  int factor,
+                  vector<uint8_t>& dst)
+{
+    const int preview_width  = (width + factor - 1) / factor;
+    const int preview_height = (height + factor - 1) / factor;
+
+    dst.resize(static_cast<size_t>(preview_width) *
+               static_cast<size_t>(preview_height) * pixel_size);
+
+    uint8_t* dst_pixel = dst.data();
+    for (int y = 0; y < height; y += factor) {
+        const uint8_t* src_row =
+            src + static_cast<size_t>(y) * static_cast<size_t>(step) *
+                      pixel_size;
+
+        for (int x = 0; x < width; x += factor) {
+            memcpy(dst_pixel,
+                   src_row + static_cast<size_t>(x) * pixel_size,
+                   pixel_size);
+            dst_pixel += pixel_size;
+        }
+    }
+}
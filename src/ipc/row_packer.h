@@ -0,0 +1,76 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef IPC_ROW_PACKER_H_
+#define IPC_ROW_PACKER_H_
+
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint8_t
+
+#include <vector>
+
+/**
+ * Copy the first width pixels of each of the height rows of src, whose
+ * rows are step pixels apart, to the contiguous buffer dst (which must hold
+ * width * height * pixel_size bytes). Large buffers are copied by several
+ * threads.
+ */
+void pack_rows(const std::uint8_t* src,
+               int width,
+               int height,
+               int step,
+               std::size_t pixel_size,
+               std::uint8_t* dst);
+
+/**
+ * Interleave the channels planes of src into the pixels of dst, whose rows
+ * are dst_step pixels apart. Each plane is made of height rows of width
+ * elements of channel_size bytes, step elements apart, and the planes
+ * follow each other in src. Large buffers are interleaved by several
+ * threads.
+ */
+void pack_planes(const std::uint8_t* src,
+                 int width,
+                 int height,
+                 int step,
+                 int channels,
+                 std::size_t channel_size,
+                 int dst_step,
+                 std::uint8_t* dst);
+
+/**
+ * Write a preview of src, made of every factor-th pixel of every factor-th
+ * row, to dst. The preview is ceil(width / factor) pixels wide and
+ * ceil(height / factor) pixels high, without row padding.
+ */
+void pack_preview(const std::uint8_t* src,
+                  int width,
+                  int height,
+                  int step,
+                  std::size_t pixel_size,
+                  int factor,
+                  std::vector<std::uint8_t>& dst);
+
+#endif // IPC_ROW_PACKER_H_
@@ -0,0 +1,196 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "shared_buffer.h"
+
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include <QSharedMemory>
+#include <QString>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Segment layout: a SegmentHeader, padded to segment_payload_offset bytes,
+// followed by the buffer contents
+struct SegmentHeader
+{
+    size_t sequence;
+    size_t length;
+};
+
+const size_t segment_payload_offset = 64;
+
+static_assert(sizeof(SegmentHeader) <= segment_payload_offset,
+              "segment header does not fit before the payload");
+
+} // namespace
+
+
+SharedBufferWriter::SharedBufferWriter(const string& key_prefix)
+    : key_prefix_(key_prefix)
+    , sequence_(0)
+{
+}
+
+
+SharedBufferWriter::~SharedBufferWriter()
+{
+}
+
+
+bool SharedBufferWriter::write(const string& name,
+                               const uint8_t* buffer,
+                               size_t length,
+                               SharedBufferHandle& handle)
+{
+    QSharedMemory* segment =
+        get_segment(name, segment_payload_offset + length);
+
+    if (segment == nullptr) {
+        return false;
+    }
+
+    if (!segment->lock()) {
+        cerr << "[OpenImageDebugger] Could not lock shared memory segment: "
+             << segment->errorString().toStdString() << endl;
+        return false;
+    }
+
+    uint8_t* segment_data = static_cast<uint8_t*>(segment->data());
+
+    SegmentHeader header;
+    header.sequence = ++sequence_;
+    header.length   = length;
+
+    memcpy(segment_data, &header, sizeof(header));
+    memcpy(segment_data + segment_payload_offset, buffer, length);
+
+    segment->unlock();
+
+    handle.key      = segment->key().toStdString();
+    handle.sequence = header.sequence;
+    handle.offset   = segment_payload_offset;
+    handle.length   = length;
+
+    return true;
+}
+
+
+void SharedBufferWriter::release(const string& name)
+{
+    segments_.erase(name);
+}
+
+
+void SharedBufferWriter::clear()
+{
+    segments_.clear();
+}
+
+
+QSharedMemory* SharedBufferWriter::get_segment(const string& name, size_t size)
+{
+    auto found_segment = segments_.find(name);
+    if (found_segment != segments_.end()) {
+        if (static_cast<size_t>(found_segment->second->size()) >= size) {
+            return found_segment->second.get();
+        }
+
+        // Too small for the new contents; recreate it below
+        segments_.erase(found_segment);
+    }
+
+    // QSharedMemory sizes are limited to the range of an int
+    if (size > static_cast<size_t>(numeric_limits<int>::max())) {
+        return nullptr;
+    }
+
+    const QString key = QString::fromStdString(key_prefix_ + name);
+
+    unique_ptr<QSharedMemory> segment(new QSharedMemory(key));
+
+    if (!segment->create(static_cast<int>(size))) {
+        // A leftover segment with the same key may still be usable
+        if (segment->error() != QSharedMemory::AlreadyExists ||
+            !segment->attach() ||
+            static_cast<size_t>(segment->size()) < size) {
+            cerr << "[OpenImageDebugger] Could not create shared memory "
+                    "segment: "
+                 << segment->errorString().toStdString() << endl;
+            return nullptr;
+        }
+    }
+
+    QSharedMemory* result = segment.get();
+    segments_[name]       = std::move(segment);
+
+    return result;
+}
+
+
+SharedBufferStatus read_shared_buffer(const SharedBufferHandle& handle,
+                                      vector<uint8_t>& dst)
+{
+    QSharedMemory segment(QString::fromStdString(handle.key));
+
+    if (!segment.attach(QSharedMemory::ReadOnly)) {
+        cerr << "[error] Could not attach to shared memory segment: "
+             << segment.errorString().toStdString() << endl;
+        return SharedBufferStatus::Unavailable;
+    }
+
+    if (static_cast<size_t>(segment.size()) < handle.offset + handle.length) {
+        cerr << "[error] Shared memory segment is smaller than expected"
+             << endl;
+        return SharedBufferStatus::Unavailable;
+    }
+
+    SharedBufferStatus status = SharedBufferStatus::Stale;
+
+    segment.lock();
+
+    const uint8_t* segment_data =
+        static_cast<const uint8_t*>(segment.constData());
+
+    SegmentHeader header;
+    memcpy(&header, segment_data, sizeof(header));
+
+    if (header.sequence == handle.sequence && header.length == handle.length) {
+        dst.resize(handle.length);
+        memcpy(dst.data(), segment_data + handle.offset, handle.length);
+        status = SharedBufferStatus::Ok;
+    }
+
+    segment.unlock();
+
+    return status;
+}
@@ -0,0 +1,98 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef IPC_SHARED_BUFFER_H_
+#define IPC_SHARED_BUFFER_H_
+
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint8_t
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class QSharedMemory;
+
+/*
+ * Describes where the contents of a buffer can be found in shared memory.
+ * Sent over the socket in place of the buffer contents themselves.
+ */
+struct SharedBufferHandle
+{
+    std::string key;
+    std::size_t sequence;
+    std::size_t offset;
+    std::size_t length;
+};
+
+enum class SharedBufferStatus { Ok, Stale, Unavailable };
+
+/*
+ * Owns one shared memory segment per plotted variable. Segments are kept
+ * alive (and reused) between breakpoints, so that the window can read them
+ * after the corresponding message has been sent.
+ */
+class SharedBufferWriter
+{
+  public:
+    explicit SharedBufferWriter(const std::string& key_prefix);
+
+    ~SharedBufferWriter();
+
+    /**
+     * Copy the given buffer into the segment associated with name.
+     *
+     * @return false if shared memory could not be used, in which case the
+     * caller must fall back to sending the contents through the socket.
+     */
+    bool write(const std::string& name,
+               const std::uint8_t* buffer,
+               std::size_t length,
+               SharedBufferHandle& handle);
+
+    void release(const std::string& name);
+
+    void clear();
+
+  private:
+    std::string key_prefix_;
+    std::size_t sequence_;
+
+    std::map<std::string, std::unique_ptr<QSharedMemory>> segments_;
+
+    QSharedMemory* get_segment(const std::string& name, std::size_t size);
+};
+
+/**
+ * Copy the contents referenced by handle into dst.
+ *
+ * Returns SharedBufferStatus::Stale if the segment was already overwritten by
+ * a newer plot of the same buffer (which will arrive in a later message).
+ */
+SharedBufferStatus read_shared_buffer(const SharedBufferHandle& handle,
+                                      std::vector<std::uint8_t>& dst);
+
+#endif // IPC_SHARED_BUFFER_H_
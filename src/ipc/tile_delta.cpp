@@ -0,0 +1,174 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "tile_delta.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// 64 bit FNV-1a, consuming eight bytes per step
+uint64_t hash_tile(const uint8_t* buffer,
+                   int step,
+                   size_t pixel_size,
+                   const TileRegion& tile)
+{
+    const uint64_t fnv_prime = 0x100000001b3ULL;
+    uint64_t hash            = 0xcbf29ce484222325ULL;
+
+    const size_t row_length = static_cast<size_t>(tile.width) * pixel_size;
+
+    for (int y = tile.y; y < tile.y + tile.height; ++y) {
+        const uint8_t* row =
+            buffer + (static_cast<size_t>(y) * step + tile.x) * pixel_size;
+
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= row_length; i += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, row + i, sizeof(word));
+            hash = (hash ^ word) * fnv_prime;
+        }
+        for (; i < row_length; ++i) {
+            hash = (hash ^ row[i]) * fnv_prime;
+        }
+    }
+
+    return hash;
+}
+
+} // namespace
+
+
+bool TileHashCache::update(const string& name,
+                           const uint8_t* buffer,
+                           int width,
+                           int height,
+                           int channels,
+                           int step,
+                           BufferType type,
+                           vector<TileRegion>& dirty_tiles)
+{
+    dirty_tiles.clear();
+
+    const size_t pixel_size = static_cast<size_t>(channels) * typesize(type);
+
+    const int num_tiles_x = (width + delta_tile_size - 1) / delta_tile_size;
+    const int num_tiles_y = (height + delta_tile_size - 1) / delta_tile_size;
+    const size_t num_tiles = static_cast<size_t>(num_tiles_x * num_tiles_y);
+
+    auto found_entry = entries_.find(name);
+
+    const bool has_previous_state =
+        found_entry != entries_.end() && found_entry->second.width == width &&
+        found_entry->second.height == height &&
+        found_entry->second.channels == channels &&
+        found_entry->second.step == step && found_entry->second.type == type;
+
+    Entry& entry = entries_[name];
+    if (!has_previous_state) {
+        entry.width    = width;
+        entry.height   = height;
+        entry.channels = channels;
+        entry.step     = step;
+        entry.type     = type;
+        entry.hashes.assign(num_tiles, 0);
+    }
+
+    for (int ty = 0; ty < num_tiles_y; ++ty) {
+        for (int tx = 0; tx < num_tiles_x; ++tx) {
+            TileRegion tile;
+            tile.x      = tx * delta_tile_size;
+            tile.y      = ty * delta_tile_size;
+            tile.width  = min(delta_tile_size, width - tile.x);
+            tile.height = min(delta_tile_size, height - tile.y);
+
+            const uint64_t hash = hash_tile(buffer, step, pixel_size, tile);
+            uint64_t& stored_hash = entry.hashes[ty * num_tiles_x + tx];
+
+            if (has_previous_state && hash != stored_hash) {
+                dirty_tiles.push_back(tile);
+            }
+
+            stored_hash = hash;
+        }
+    }
+
+    return has_previous_state;
+}
+
+
+void TileHashCache::invalidate(const string& name)
+{
+    entries_.erase(name);
+}
+
+
+void TileHashCache::clear()
+{
+    entries_.clear();
+}
+
+
+void pack_tile(const uint8_t* buffer,
+               int step,
+               size_t pixel_size,
+               const TileRegion& tile,
+               vector<uint8_t>& dst)
+{
+    const size_t row_length = static_cast<size_t>(tile.width) * pixel_size;
+
+    size_t offset = dst.size();
+    dst.resize(offset + row_length * static_cast<size_t>(tile.height));
+
+    for (int y = tile.y; y < tile.y + tile.height; ++y) {
+        memcpy(dst.data() + offset,
+               buffer + (static_cast<size_t>(y) * step + tile.x) * pixel_size,
+               row_length);
+        offset += row_length;
+    }
+}
+
+
+void unpack_tile(const uint8_t* src,
+                 int step,
+                 size_t pixel_size,
+                 const TileRegion& tile,
+                 uint8_t* buffer)
+{
+    const size_t row_length = static_cast<size_t>(tile.width) * pixel_size;
+
+    for (int y = tile.y; y < tile.y + tile.height; ++y) {
+        memcpy(buffer + (static_cast<size_t>(y) * step + tile.x) * pixel_size,
+               src,
+               row_length);
+        src += row_length;
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef IPC_TILE_DELTA_H_
+#define IPC_TILE_DELTA_H_
+
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint8_t, std::uint64_t
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "raw_data_decode.h"
+
+// Width/height of the tiles compared between two plots of the same buffer.
+// A tile that overlaps more than one texture tile is split by the window.
+const int delta_tile_size = 256;
+
+struct TileRegion
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+/*
+ * Keeps the hash of every tile of the last plotted contents of each buffer,
+ * so that a new plot of the same buffer only needs to send the tiles whose
+ * contents have changed.
+ */
+class TileHashCache
+{
+  public:
+    /**
+     * Hash all tiles of buffer and store them as the latest state of name.
+     *
+     * @return true if a previous state with the same geometry was available,
+     * in which case dirty_tiles contains the tiles that differ from it.
+     */
+    bool update(const std::string& name,
+                const std::uint8_t* buffer,
+                int width,
+                int height,
+                int channels,
+                int step,
+                BufferType type,
+                std::vector<TileRegion>& dirty_tiles);
+
+    void invalidate(const std::string& name);
+
+    void clear();
+
+  private:
+    struct Entry
+    {
+        int width;
+        int height;
+        int channels;
+        int step;
+        BufferType type;
+        std::vector<std::uint64_t> hashes;
+    };
+
+    std::map<std::string, Entry> entries_;
+};
+
+/**
+ * Append the rows of tile, read from a buffer with the given step (in
+ * pixels), to dst without any padding.
+ */
+void pack_tile(const std::uint8_t* buffer,
+               int step,
+               std::size_t pixel_size,
+               const TileRegion& tile,
+               std::vector<std::uint8_t>& dst);
+
+/**
+ * Inverse of pack_tile: copy the packed rows in src into buffer.
+ */
+void unpack_tile(const std::uint8_t* src,
+                 int step,
+                 std::size_t pixel_size,
+                 const TileRegion& tile,
+                 std::uint8_t* buffer);
+
+#endif // IPC_TILE_DELTA_H_
@@ -0,0 +1,229 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "trace_events.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include <QCoreApplication>
+#include <QDir>
+
+
+using namespace std;
+
+
+namespace
+{
+
+mutex trace_mutex;
+FILE* trace_file = nullptr;
+atomic<bool> is_tracing_enabled(false);
+long long trace_pid = 0;
+
+atomic<uint64_t> next_request_id(1);
+atomic<int> next_thread_id(1);
+
+// Name given to initialize_tracing, which prefixes the startup reports
+string process_name_str = "process";
+
+// Roughly when the process (or the library, in the bridge) was loaded
+const double process_start_timestamp_us =
+    chrono::duration<double, micro>(
+        chrono::steady_clock::now().time_since_epoch())
+        .count();
+
+
+// Small and stable thread ids, which are easier to read in the timeline
+int current_thread_id()
+{
+    thread_local int thread_id = next_thread_id++;
+    return thread_id;
+}
+
+
+string escape_json(const string& value)
+{
+    string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped.push_back('\\');
+            escaped.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped.push_back(c);
+        }
+    }
+
+    return escaped;
+}
+
+
+void write_event(const char* name,
+                 const char* category,
+                 uint64_t request_id,
+                 double begin_us,
+                 double end_us,
+                 const string& buffer_name)
+{
+    ostringstream event;
+    event.precision(3);
+    event << fixed << "{\"name\": \"" << escape_json(name)
+          << "\", \"cat\": \"" << category << "\", \"ph\": \"X\", \"ts\": "
+          << begin_us << ", \"dur\": " << end_us - begin_us
+          << ", \"pid\": " << trace_pid << ", \"tid\": " << current_thread_id()
+          << ", \"args\": {\"request_id\": " << request_id;
+    if (!buffer_name.empty()) {
+        event << ", \"buffer\": \"" << escape_json(buffer_name) << "\"";
+    }
+    event << "}},\n";
+
+    const string line = event.str();
+
+    lock_guard<mutex> lock(trace_mutex);
+    fputs(line.c_str(), trace_file);
+    fflush(trace_file);
+}
+
+} // namespace
+
+
+void initialize_tracing(const char* process_name)
+{
+    process_name_str = process_name;
+
+    const char* trace_dir = getenv("OID_TRACE_DIR");
+    if (trace_dir == nullptr || trace_dir[0] == '\0') {
+        return;
+    }
+
+    lock_guard<mutex> lock(trace_mutex);
+    if (trace_file != nullptr) {
+        return;
+    }
+
+    trace_pid = static_cast<long long>(QCoreApplication::applicationPid());
+
+    QDir().mkpath(trace_dir);
+    const string path = QDir(trace_dir)
+                            .filePath(QString("%1-%2.json")
+                                          .arg(process_name)
+                                          .arg(trace_pid))
+                            .toStdString();
+
+    trace_file = fopen(path.c_str(), "w");
+    if (trace_file == nullptr) {
+        cerr << "[error] Could not open the trace file " << path << endl;
+        return;
+    }
+
+    // The closing bracket of the JSON array is optional in the trace event
+    // format, so that traces of processes which were killed stay readable
+    fprintf(trace_file,
+            "[\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %lld,"
+            " \"tid\": 0, \"args\": {\"name\": \"%s\"}},\n",
+            trace_pid,
+            escape_json(process_name).c_str());
+    fflush(trace_file);
+
+    is_tracing_enabled = true;
+}
+
+
+bool tracing_enabled()
+{
+    return is_tracing_enabled;
+}
+
+
+double trace_now_us()
+{
+    return chrono::duration<double, micro>(
+               chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+
+uint64_t new_trace_request_id()
+{
+    return next_request_id++;
+}
+
+
+void trace_event(const char* name,
+                 uint64_t request_id,
+                 double begin_us,
+                 double end_us,
+                 const string& buffer_name)
+{
+    if (!is_tracing_enabled) {
+        return;
+    }
+
+    write_event(name, "plot", request_id, begin_us, end_us, buffer_name);
+}
+
+
+double process_start_us()
+{
+    return process_start_timestamp_us;
+}
+
+
+bool startup_report_enabled()
+{
+    static const bool is_enabled = []() {
+        const char* report_startup = getenv("OID_REPORT_STARTUP");
+        return report_startup != nullptr && report_startup[0] != '\0' &&
+               string(report_startup) != "0";
+    }();
+
+    return is_enabled;
+}
+
+
+void report_startup_phase(const char* phase, double begin_us, double end_us)
+{
+    if (startup_report_enabled()) {
+        ostringstream report;
+        report.precision(2);
+        report << fixed << "[startup] " << process_name_str << " " << phase
+               << " " << (end_us - begin_us) * 1e-3 << " ms\n";
+        cerr << report.str() << flush;
+    }
+
+    if (is_tracing_enabled) {
+        write_event(phase, "startup", 0, begin_us, end_us, string());
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef IPC_TRACE_EVENTS_H_
+#define IPC_TRACE_EVENTS_H_
+
+#include <cstdint>
+#include <string>
+
+
+/*
+ * Opt-in tracing of plots, in the Chrome trace event format. When the
+ * OID_TRACE_DIR environment variable is set, each process writes its events
+ * to <OID_TRACE_DIR>/<process name>-<pid>.json, and the files of a session
+ * can be merged into a single timeline with oidscripts/tracing.py. Events
+ * are correlated across processes by the request ID of their plot, which
+ * travels in the header of the messages.
+ */
+
+// Open the trace file of this process, if tracing is enabled
+void initialize_tracing(const char* process_name);
+
+bool tracing_enabled();
+
+// Microseconds on a clock shared by the processes of the machine
+double trace_now_us();
+
+// New request ID, unique within this process; 0 means no request
+std::uint64_t new_trace_request_id();
+
+/**
+ * Write an event spanning [begin_us, end_us) to the trace, if tracing is
+ * enabled. buffer_name, if any, is the name of the plotted buffer.
+ */
+void trace_event(const char* name,
+                 std::uint64_t request_id,
+                 double begin_us,
+                 double end_us,
+                 const std::string& buffer_name = std::string());
+
+
+/*
+ * Startup phases are reported to stderr, as "[startup] <process> <phase>
+ * <milliseconds> ms", when the OID_REPORT_STARTUP environment variable is
+ * set, and traced like plots when tracing is enabled.
+ */
+
+// Timestamp of the start of this process, as given by trace_now_us()
+double process_start_us();
+
+bool startup_report_enabled();
+
+void report_startup_phase(const char* phase, double begin_us, double end_us);
+
+
+// Event spanning the lifetime of this object
+class TraceScope
+{
+  public:
+    TraceScope(const char* name,
+               std::uint64_t request_id,
+               const std::string& buffer_name = std::string())
+        : name_(name)
+        , request_id_(request_id)
+        , buffer_name_(tracing_enabled() ? buffer_name : std::string())
+        , begin_us_(tracing_enabled() ? trace_now_us() : 0.0)
+    {
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    ~TraceScope()
+    {
+        if (tracing_enabled()) {
+            trace_event(
+                name_, request_id_, begin_us_, trace_now_us(), buffer_name_);
+        }
+    }
+
+  private:
+    const char* name_;
+    std::uint64_t request_id_;
+    std::string buffer_name_;
+    double begin_us_;
+};
+
+
+
+// Startup phase spanning the lifetime of this object
+class StartupPhase
+{
+  public:
+    explicit StartupPhase(const char* phase)
+        : phase_(phase)
+        , begin_us_(trace_now_us())
+    {
+    }
+
+    StartupPhase(const StartupPhase&) = delete;
+    StartupPhase& operator=(const StartupPhase&) = delete;
+
+    ~StartupPhase()
+    {
+        report_startup_phase(phase_, begin_us_, trace_now_us());
+    }
+
+  private:
+    const char* phase_;
+    double begin_us_;
+};
+
+#endif // IPC_TRACE_EVENTS_H_
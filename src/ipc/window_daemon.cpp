@@ -0,0 +1,131 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "window_daemon.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTextStream>
+
+
+using namespace std;
+
+
+namespace
+{
+
+QString window_daemon_port_file()
+{
+    // The runtime location is private to the user, where available
+    QString directory =
+        QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (directory.isEmpty()) {
+        directory = QDir::tempPath();
+    }
+
+    return directory + "/OpenImageDebugger-daemon.port";
+}
+
+
+// Port file contents: the port, followed by the process id of the daemon
+bool read_window_daemon_port_file(uint16_t& port, qint64& pid)
+{
+    QFile port_file(window_daemon_port_file());
+    if (!port_file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream port_stream(&port_file);
+    unsigned int port_value = 0;
+    port_stream >> port_value >> pid;
+
+    if (port_stream.status() != QTextStream::Ok || port_value == 0 ||
+        port_value > 0xFFFF) {
+        return false;
+    }
+
+    port = static_cast<uint16_t>(port_value);
+    return true;
+}
+
+} // namespace
+
+
+bool advertise_window_daemon(uint16_t port)
+{
+    QFile port_file(window_daemon_port_file());
+    if (!port_file.open(QIODevice::WriteOnly | QIODevice::Truncate |
+                        QIODevice::Text)) {
+        return false;
+    }
+
+    port_file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    QTextStream port_stream(&port_file);
+    port_stream << port << " " << QCoreApplication::applicationPid() << "\n";
+    port_stream.flush();
+
+    return port_stream.status() == QTextStream::Ok;
+}
+
+
+void withdraw_window_daemon()
+{
+    // Another daemon may have taken over the port file in the meantime
+    uint16_t port;
+    qint64 pid = 0;
+    if (read_window_daemon_port_file(port, pid) &&
+        pid == QCoreApplication::applicationPid()) {
+        QFile::remove(window_daemon_port_file());
+    }
+}
+
+
+bool find_window_daemon(uint16_t& port)
+{
+    qint64 pid = 0;
+    return read_window_daemon_port_file(port, pid);
+}
+
+
+bool WindowDaemonServer::take_connection(qintptr& socket_descriptor)
+{
+    if (pending_connections_.empty()) {
+        return false;
+    }
+
+    socket_descriptor = pending_connections_.front();
+    pending_connections_.pop_front();
+
+    return true;
+}
+
+
+void WindowDaemonServer::incomingConnection(qintptr socket_descriptor)
+{
+    pending_connections_.push_back(socket_descriptor);
+}
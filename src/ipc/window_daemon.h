@@ -0,0 +1,78 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef IPC_WINDOW_DAEMON_H_
+#define IPC_WINDOW_DAEMON_H_
+
+#include <cstdint> // for std::uint16_t
+
+#include <deque>
+
+#include <QTcpServer>
+
+/*
+ * A window started in daemon mode keeps running between debug sessions, so
+ * that new bridges connect to it instead of starting a window of their own.
+ * It advertises the port it listens on in a file private to the user, which
+ * is where bridges look for it.
+ */
+
+/**
+ * Advertise the port of the window daemon of the current user.
+ *
+ * @return false if the port file could not be written
+ */
+bool advertise_window_daemon(std::uint16_t port);
+
+// Remove the port file, if it was written by this process
+void withdraw_window_daemon();
+
+/**
+ * Look for the port of the window daemon of the current user. The daemon may
+ * have exited without withdrawing it, so connecting to it can still fail.
+ *
+ * @return false if no window daemon is advertised
+ */
+bool find_window_daemon(std::uint16_t& port);
+
+/*
+ * Listens for bridge connections on behalf of a window daemon. Connections
+ * are taken as plain socket descriptors, so that the window keeps using a
+ * single socket for all of the bridges it serves.
+ */
+class WindowDaemonServer : public QTcpServer
+{
+  public:
+    // Oldest pending connection; false if there is none
+    bool take_connection(qintptr& socket_descriptor);
+
+  protected:
+    void incomingConnection(qintptr socket_descriptor) override;
+
+  private:
+    std::deque<qintptr> pending_connections_;
+};
+
+#endif // IPC_WINDOW_DAEMON_H_
@@ -218,6 +218,12 @@ float* mat4::data()
 }
 
 
+const float* mat4::data() const
+{
+    return mat_.data();
+}
+
+
 void mat4::operator<<(const std::initializer_list<float>& data)
 {
     memcpy(mat_.data(), data.begin(), sizeof(float) * data.size());
@@ -300,6 +306,12 @@ mat4 mat4::inv() const
 }
 
 
+bool mat4::operator==(const mat4& b) const
+{
+    return mat_ == b.mat_;
+}
+
+
 vec4 mat4::operator*(const vec4& b) const
 {
     vec4 res;
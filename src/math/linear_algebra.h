@@ -107,6 +107,8 @@ class mat4
 
     float* data();
 
+    const float* data() const;
+
     void operator<<(const std::initializer_list<float>& data);
 
     void set_ortho_projection(float right, float top, float near, float far);
@@ -115,6 +117,8 @@ class mat4
 
     mat4 inv() const;
 
+    bool operator==(const mat4& b) const;
+
     mat4 operator*(const mat4& b) const;
 
     vec4 operator*(const vec4& b) const;
@@ -25,33 +25,84 @@
 
 #include <csignal>
 
+#include <iostream>
 #include <string>
 
 #include <QApplication>
 #include <QCommandLineParser>
 
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
 #include "debuggerinterface/preprocessor_directives.h"
+#include "ipc/trace_events.h"
 #include "ui/main_window/main_window.h"
 
 using namespace std;
 
 
+namespace
+{
+
+// Largest resident memory of the window so far, in bytes, or 0 if unknown
+long long peak_resident_memory()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+#if defined(Q_OS_MACOS)
+    return static_cast<long long>(usage.ru_maxrss);
+#else
+    return static_cast<long long>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
 
+    initialize_tracing("oidwindow");
+    report_startup_phase(
+        "initialize_application", process_start_us(), trace_now_us());
+
     QCommandLineParser parser;
     parser.addOptions({
         {"h", "hostname", "hostname", "127.0.0.1"},
         {"p", "port", "port", "9588"},
+        {"c", "compression", "auto|none|fast|best", "auto"},
+        {{"d", "daemon"}, "keep running and accept new debug sessions"},
+        {"report-frames",
+         "print when the received buffers are displayed, for benchmarks"},
     });
     parser.parse(QCoreApplication::arguments());
 
     ConnectionSettings host_settings;
     host_settings.url = parser.value("h").toStdString();
     host_settings.port = static_cast<uint16_t>(parser.value("p").toUInt());
+    host_settings.compression = parser.value("c").toStdString();
+    host_settings.daemon = parser.isSet("d");
+    host_settings.report_frames = parser.isSet("report-frames");
 
     MainWindow window(host_settings);
-    window.show();
-    return app.exec();
+    {
+        StartupPhase startup("show_window");
+        window.show();
+    }
+    const int exit_code = app.exec();
+
+    if (host_settings.report_frames) {
+        cout << "[memory] peak_rss " << peak_resident_memory() << endl;
+    }
+
+    return exit_code;
 }
@@ -0,0 +1,377 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "buffer_capture.h"
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <QDir>
+
+#include "ipc/trace_events.h"
+
+
+using namespace std;
+
+
+namespace
+{
+
+const char* get_type_name(BufferType type)
+{
+    switch (type) {
+    case BufferType::UnsignedByte:
+        return "uint8";
+    case BufferType::UnsignedShort:
+        return "uint16";
+    case BufferType::Short:
+        return "int16";
+    case BufferType::Int32:
+        return "int32";
+    case BufferType::Float32:
+        return "float32";
+    case BufferType::Float64:
+        return "float64";
+    case BufferType::Float16:
+        return "float16";
+    case BufferType::Int8:
+        return "int8";
+    case BufferType::UnsignedInt32:
+        return "uint32";
+    case BufferType::Int64:
+        return "int64";
+    }
+
+    return "uint8";
+}
+
+
+// Unlike the window, the bridge holds the values as the debugged program
+// does, so 64 bit types are written as they are
+string get_numpy_descriptor(BufferType type)
+{
+    const uint16_t byte_order_mark = 1;
+    const bool little_endian =
+        *reinterpret_cast<const uint8_t*>(&byte_order_mark) == 1;
+    const string byte_order = little_endian ? "<" : ">";
+
+    switch (type) {
+    case BufferType::UnsignedByte:
+        return "|u1";
+    case BufferType::Int8:
+        return "|i1";
+    case BufferType::UnsignedShort:
+        return byte_order + "u2";
+    case BufferType::Short:
+        return byte_order + "i2";
+    case BufferType::Int32:
+        return byte_order + "i4";
+    case BufferType::UnsignedInt32:
+        return byte_order + "u4";
+    case BufferType::Int64:
+        return byte_order + "i8";
+    case BufferType::Float16:
+        return byte_order + "f2";
+    case BufferType::Float32:
+        return byte_order + "f4";
+    case BufferType::Float64:
+        return byte_order + "f8";
+    }
+
+    return "|u1";
+}
+
+
+string escape_json(const string& value)
+{
+    stringstream escaped;
+    for (const char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped << "\\u00" << hex << setw(2) << setfill('0')
+                    << static_cast<int>(c) << dec;
+        } else {
+            escaped << c;
+        }
+    }
+
+    return escaped.str();
+}
+
+
+// Buffer names are expressions of the debugged program, which are turned
+// into file names distinct from the used ones
+string get_file_name(const string& name, set<string>& used_names)
+{
+    string base_name = name;
+    for (char& c : base_name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') {
+            c = '_';
+        }
+    }
+
+    string file_name = base_name + ".npy";
+    for (int suffix = 1; used_names.count(file_name) > 0; ++suffix) {
+        file_name = base_name + "_" + to_string(suffix) + ".npy";
+    }
+
+    used_names.insert(file_name);
+    return file_name;
+}
+
+} // namespace
+
+
+BufferCapture::BufferCapture(const string& directory, size_t queue_capacity)
+    : directory_(directory)
+    , queue_capacity_(queue_capacity)
+    , queued_bytes_(0)
+    , is_writing_(false)
+    , is_closing_(false)
+    , stop_(0)
+    , written_stop_(-1)
+{
+    writer_ = thread(&BufferCapture::write_queued_captures, this);
+}
+
+
+BufferCapture::~BufferCapture()
+{
+    {
+        lock_guard<mutex> lock(queue_mutex_);
+        is_closing_ = true;
+    }
+    queue_changed_.notify_all();
+
+    writer_.join();
+}
+
+
+void BufferCapture::begin_stop()
+{
+    lock_guard<mutex> lock(queue_mutex_);
+    ++stop_;
+}
+
+
+void BufferCapture::enqueue(Capture capture)
+{
+    unique_lock<mutex> lock(queue_mutex_);
+
+    // A buffer larger than the whole queue is let in once it is empty
+    queue_changed_.wait(lock, [this, &capture]() {
+        return queued_bytes_ == 0 ||
+               queued_bytes_ + capture.length <= queue_capacity_;
+    });
+
+    queued_bytes_ += capture.length;
+    queue_.push_back({std::move(capture), stop_});
+
+    lock.unlock();
+    queue_changed_.notify_all();
+}
+
+
+void BufferCapture::flush()
+{
+    unique_lock<mutex> lock(queue_mutex_);
+    queue_changed_.wait(
+        lock, [this]() { return queue_.empty() && !is_writing_; });
+}
+
+
+void BufferCapture::write_queued_captures()
+{
+    unique_lock<mutex> lock(queue_mutex_);
+
+    while (true) {
+        queue_changed_.wait(
+            lock, [this]() { return !queue_.empty() || is_closing_; });
+
+        // The queue is drained before closing
+        if (queue_.empty()) {
+            return;
+        }
+
+        QueuedCapture queued = std::move(queue_.front());
+        queue_.pop_front();
+        is_writing_ = true;
+
+        lock.unlock();
+
+        const Capture& capture = queued.capture;
+
+        if (queued.stop != written_stop_) {
+            written_stop_   = queued.stop;
+            stop_directory_ = QDir(QString::fromStdString(directory_))
+                                  .filePath(QString("stop_%1").arg(queued.stop))
+                                  .toStdString();
+            manifest_.clear();
+            file_names_.clear();
+
+            if (!QDir().mkpath(QString::fromStdString(stop_directory_))) {
+                cerr << "[OpenImageDebugger] Could not create the capture"
+                        " directory "
+                     << stop_directory_ << endl;
+            }
+        }
+
+        ManifestEntry entry;
+        entry.name         = capture.variable_name;
+        entry.file_name    = get_file_name(capture.variable_name, file_names_);
+        entry.type         = get_type_name(capture.type);
+        entry.width        = capture.width;
+        entry.height       = capture.height;
+        entry.channels     = capture.channels;
+        entry.transpose    = capture.transpose_buffer;
+        entry.pixel_layout = capture.pixel_layout;
+
+        {
+            TraceScope trace(
+                "capture_buffer", capture.request_id, capture.variable_name);
+            entry.written = write_capture(
+                capture, stop_directory_ + "/" + entry.file_name);
+        }
+
+        if (!entry.written) {
+            cerr << "[OpenImageDebugger] Could not capture buffer "
+                 << capture.variable_name << endl;
+        }
+
+        manifest_.push_back(entry);
+        if (!write_manifest()) {
+            cerr << "[OpenImageDebugger] Could not write the manifest of "
+                 << stop_directory_ << endl;
+        }
+
+        if (capture.release) {
+            capture.release();
+        }
+
+        lock.lock();
+
+        queued_bytes_ -= capture.length;
+        is_writing_ = false;
+        queue_changed_.notify_all();
+    }
+}
+
+
+/*
+ * NumPy .npy file (format version 1.0), as written by the window exports: a
+ * magic string, the length of the header, and the header itself, padded so
+ * that the data starts 64 bytes aligned. The data is in C order, with the
+ * channels as the last dimension of multichannel buffers.
+ */
+bool BufferCapture::write_capture(const Capture& capture, const string& path)
+{
+    stringstream header;
+    header << "{'descr': '" << get_numpy_descriptor(capture.type)
+           << "', 'fortran_order': False, 'shape': (" << capture.height
+           << ", " << capture.width;
+    if (capture.channels > 1) {
+        header << ", " << capture.channels;
+    }
+    header << "), }";
+
+    // Magic string, version and header length take 10 bytes, and the header
+    // ends with a newline
+    const size_t preamble_size  = 10;
+    const size_t data_alignment = 64;
+
+    string header_str = header.str();
+    const size_t unpadded_size = preamble_size + header_str.size() + 1;
+    header_str.append(
+        (data_alignment - unpadded_size % data_alignment) % data_alignment,
+        ' ');
+    header_str.push_back('\n');
+
+    FILE* fhandle = fopen(path.c_str(), "wb");
+    if (fhandle == nullptr) {
+        return false;
+    }
+
+    // The contents are written in one go, which needs no buffering
+    setvbuf(fhandle, nullptr, _IONBF, 0);
+
+    const uint16_t header_length = static_cast<uint16_t>(header_str.size());
+    const uint8_t preamble[preamble_size] = {
+        0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+        static_cast<uint8_t>(header_length & 0xff),
+        static_cast<uint8_t>(header_length >> 8)};
+
+    bool written =
+        fwrite(preamble, 1, preamble_size, fhandle) == preamble_size &&
+        fwrite(header_str.data(), 1, header_str.size(), fhandle) ==
+            header_str.size() &&
+        fwrite(capture.contents, 1, capture.length, fhandle) ==
+            capture.length;
+
+    written = fclose(fhandle) == 0 && written;
+
+    if (!written) {
+        remove(path.c_str());
+    }
+
+    return written;
+}
+
+
+// Rewritten after each buffer, so that it lists what was captured so far
+// even if the session is killed
+bool BufferCapture::write_manifest()
+{
+    ofstream manifest(stop_directory_ + "/manifest.json");
+    if (!manifest) {
+        return false;
+    }
+
+    manifest << "{\n  \"format\": \"npy\",\n  \"stop\": " << written_stop_
+             << ",\n  \"buffers\": [";
+
+    for (size_t i = 0; i < manifest_.size(); ++i) {
+        const ManifestEntry& entry = manifest_[i];
+
+        manifest << (i == 0 ? "\n" : ",\n") << "    {\"name\": \""
+                 << escape_json(entry.name) << "\", \"file\": \""
+                 << escape_json(entry.file_name) << "\", \"type\": \""
+                 << entry.type << "\", \"width\": " << entry.width
+                 << ", \"height\": " << entry.height
+                 << ", \"channels\": " << entry.channels
+                 << ", \"transpose\": " << (entry.transpose ? "true" : "false")
+                 << ", \"pixel_layout\": \"" << escape_json(entry.pixel_layout)
+                 << "\", \"exported\": " << (entry.written ? "true" : "false")
+                 << "}";
+    }
+
+    manifest << "\n  ]\n}\n";
+
+    return static_cast<bool>(manifest);
+}
@@ -0,0 +1,142 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BUFFER_CAPTURE_H_
+#define BUFFER_CAPTURE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ipc/raw_data_decode.h"
+
+
+/*
+ * Writes the plotted buffers to disk instead of sending them to a window, for
+ * headless sessions. The buffers of each stop of the debugged program are
+ * saved to the stop_<n> subdirectory of the capture directory as NumPy .npy
+ * files, along with a manifest.json file listing them and their metadata.
+ *
+ * The files are written by a background thread, so that the debugger can
+ * resume the inferior right away. The buffers waiting to be written are
+ * bounded by the capacity of the queue: once it is full, queueing another
+ * one blocks until the writer has caught up.
+ */
+class BufferCapture
+{
+  public:
+    struct Capture
+    {
+        std::string variable_name;
+        std::string display_name;
+        std::string pixel_layout;
+        bool transpose_buffer;
+        int width;
+        int height;
+        int channels;
+        BufferType type;
+
+        // Contiguous rows, which stay valid until release is called from the
+        // writer thread
+        const std::uint8_t* contents;
+        std::size_t length;
+        std::function<void()> release;
+
+        // Correlates the write with the other trace events of the plot
+        std::uint64_t request_id;
+    };
+
+    BufferCapture(const std::string& directory, std::size_t queue_capacity);
+
+    // Waits for the queued buffers to be written
+    ~BufferCapture();
+
+    BufferCapture(const BufferCapture&) = delete;
+    BufferCapture& operator=(const BufferCapture&) = delete;
+
+    // The buffers queued from now on belong to the next stop
+    void begin_stop();
+
+    void enqueue(Capture capture);
+
+    // Block until all queued buffers were written
+    void flush();
+
+  private:
+    // Capture along with the stop it was taken at
+    struct QueuedCapture
+    {
+        Capture capture;
+        int stop;
+    };
+
+    struct ManifestEntry
+    {
+        std::string name;
+        std::string file_name;
+        std::string type;
+        int width;
+        int height;
+        int channels;
+        bool transpose;
+        std::string pixel_layout;
+        bool written;
+    };
+
+    void write_queued_captures();
+
+    bool write_capture(const Capture& capture, const std::string& path);
+
+    bool write_manifest();
+
+    std::string directory_;
+    std::size_t queue_capacity_;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_changed_;
+    std::deque<QueuedCapture> queue_;
+    std::size_t queued_bytes_;
+    bool is_writing_;
+    bool is_closing_;
+    int stop_;
+
+    // State of the writer thread: the stop whose directory is being written
+    // and its manifest so far
+    int written_stop_;
+    std::string stop_directory_;
+    std::vector<ManifestEntry> manifest_;
+    std::set<std::string> file_names_;
+
+    std::thread writer_;
+};
+
+#endif // BUFFER_CAPTURE_H_
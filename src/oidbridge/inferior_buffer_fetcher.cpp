@@ -0,0 +1,98 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "inferior_buffer_fetcher.h"
+
+#include <algorithm>
+#include <utility>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Large buffers are already read by several threads each, so only a few of
+// them are read at once
+const size_t max_fetch_threads = 4;
+
+} // namespace
+
+
+InferiorBufferFetcher::InferiorBufferFetcher(InferiorMemory& inferior_memory,
+                                             vector<Request> requests)
+    : inferior_memory_(inferior_memory)
+    , requests_(std::move(requests))
+    , results_(requests_.size())
+    , next_request_(0)
+{
+    for (auto& result : results_) {
+        pending_results_.push_back(result.get_future());
+    }
+
+    const size_t num_threads =
+        min({requests_.size(),
+             max_fetch_threads,
+             max(static_cast<size_t>(thread::hardware_concurrency()),
+                 size_t{1})});
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers_.emplace_back(&InferiorBufferFetcher::read_requests, this);
+    }
+}
+
+
+InferiorBufferFetcher::~InferiorBufferFetcher()
+{
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+
+bool InferiorBufferFetcher::wait(size_t index)
+{
+    return pending_results_[index].get();
+}
+
+
+void InferiorBufferFetcher::read_requests()
+{
+    // Each worker takes the first request nobody is reading yet
+    while (true) {
+        const size_t index = next_request_++;
+        if (index >= requests_.size()) {
+            return;
+        }
+
+        const Request& request = requests_[index];
+        results_[index].set_value(
+            inferior_memory_.readRows(request.address,
+                                      request.row_length,
+                                      request.row_stride,
+                                      request.height,
+                                      request.dst));
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef INFERIOR_BUFFER_FETCHER_H_
+#define INFERIOR_BUFFER_FETCHER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "system/memory/inferior_memory.h"
+
+
+/*
+ * Reads several buffers from the inferior memory in worker threads, in the
+ * order they were given, so that the first ones can be sent while the others
+ * are still being read. Only native reads are made: the debugger API must not
+ * be used outside of its own thread.
+ */
+class InferiorBufferFetcher
+{
+  public:
+    // Read height rows of row_length bytes, spaced by row_stride bytes,
+    // starting at address, contiguously into dst
+    struct Request
+    {
+        std::uint64_t address;
+        std::size_t row_length;
+        std::size_t row_stride;
+        int height;
+        std::uint8_t* dst;
+    };
+
+    InferiorBufferFetcher(InferiorMemory& inferior_memory,
+                          std::vector<Request> requests);
+
+    // Waits for the pending reads, whose results are no longer needed
+    ~InferiorBufferFetcher();
+
+    // Block until the request at index was read; true if it succeeded
+    bool wait(std::size_t index);
+
+  private:
+    void read_requests();
+
+    InferiorMemory& inferior_memory_;
+    std::vector<Request> requests_;
+
+    std::vector<std::promise<bool>> results_;
+    std::vector<std::future<bool>> pending_results_;
+    std::atomic<std::size_t> next_request_;
+
+    std::vector<std::thread> workers_;
+};
+
+
+#endif // INFERIOR_BUFFER_FETCHER_H_
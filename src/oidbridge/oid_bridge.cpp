@@ -23,17 +23,38 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <deque>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include "debuggerinterface/preprocessor_directives.h"
 #include "debuggerinterface/python_native_interface.h"
 #include "oid_bridge.h"
+#include "buffer_capture.h"
+#include "inferior_buffer_fetcher.h"
+#include "plot_request_scheduler.h"
+#include "ipc/buffer_plot_composer.h"
 #include "ipc/message_exchange.h"
+#include "ipc/row_packer.h"
+#include "ipc/trace_events.h"
+#include "ipc/window_daemon.h"
+#include "system/memory/inferior_memory.h"
 #include "system/process/process.h"
 
+#include <QCoreApplication>
 #include <QDataStream>
+#include <QHostAddress>
 #include <QString>
 #include <QTcpServer>
 #include <QTcpSocket>
@@ -60,16 +81,192 @@ GetObservedSymbolsResponseMessage::~GetObservedSymbolsResponseMessage()
 {
 }
 
-struct PlotBufferRequestMessage : public UiMessage
+// Fetch index of the plots whose buffer isn't read by InferiorBufferFetcher
+const size_t no_fetch_index = static_cast<size_t>(-1);
+
+// How long to wait for an advertised window daemon to accept the bridge
+const int window_daemon_connect_timeout_ms = 1000;
+
+// Lazy buffers are streamed to the window in chunks of about this size, so
+// that only one of them is held at a time
+const size_t stream_chunk_size = 64 << 20;
+
+struct BufferPlot
+{
+    string variable_name;
+    string display_name;
+    string pixel_layout;
+    bool transpose_buffer;
+    int width;
+    int height;
+    int channels;
+    int stride;
+    BufferType type;
+    uint8_t* buffer;
+    size_t length;
+
+    // Called once the buffer contents are no longer needed
+    function<void()> on_sent;
+
+    // Buffers given by their address in the inferior (buffer is null until
+    // then) are read by the bridge itself. Lazy buffers are only read when
+    // the window requests their regions.
+    bool lazy;
+    uint64_t address;
+    uint64_t pid;
+
+    // Planar buffers (e.g. NCHW tensors) hold a batch of images made of one
+    // plane per channel, which are interleaved before being sent. width and
+    // height are then those of the montage of the images side by side, or
+    // of the image batch_index alone if it was selected.
+    bool planar;
+    int image_width;
+    int image_height;
+    int batch;
+    int batch_index;
+
+    // Correlates the trace events of the plot across processes
+    uint64_t request_id;
+
+    // Identifies the memory of the buffer: its address in the inferior, or
+    // else that of the Python buffer
+    uint64_t source_address;
+
+    // Buffer with the same memory and layout which was already sent during
+    // this stop, if any. Its aliases (e.g. img and this->img) are neither
+    // read nor sent again.
+    string alias_source;
+
+    // Live frames are read when their breakpoint is hit, but sent later on,
+    // so they never alias the buffers sent in between
+    bool live;
+};
+
+
+// Frames of a buffer plotted by a live breakpoint. At most one of them is
+// being sent, and one waits for it to be handed to the socket.
+struct LiveBuffer
+{
+    BufferPlot waiting_frame;
+    bool has_waiting_frame;
+    bool is_sending;
+};
+
+
+// Memory and layout shared by the aliases of a buffer
+struct BufferAliasKey
 {
-    std::string buffer_name;
-    ~PlotBufferRequestMessage();
+    uint64_t pid;
+    uint64_t source_address;
+    int width;
+    int height;
+    int channels;
+    int stride;
+    BufferType type;
+    bool planar;
+    int batch_index;
+    string pixel_layout;
+    bool transpose_buffer;
+
+    bool operator<(const BufferAliasKey& other) const
+    {
+        return tie(pid,
+                   source_address,
+                   width,
+                   height,
+                   channels,
+                   stride,
+                   type,
+                   planar,
+                   batch_index,
+                   pixel_layout,
+                   transpose_buffer) < tie(other.pid,
+                                           other.source_address,
+                                           other.width,
+                                           other.height,
+                                           other.channels,
+                                           other.stride,
+                                           other.type,
+                                           other.planar,
+                                           other.batch_index,
+                                           other.pixel_layout,
+                                           other.transpose_buffer);
+    }
 };
 
-PlotBufferRequestMessage::~PlotBufferRequestMessage()
+
+static BufferAliasKey get_alias_key(const BufferPlot& plot)
+{
+    return BufferAliasKey{plot.pid,
+                          plot.source_address,
+                          plot.width,
+                          plot.height,
+                          plot.channels,
+                          plot.stride,
+                          plot.type,
+                          plot.planar,
+                          plot.batch_index,
+                          plot.pixel_layout,
+                          plot.transpose_buffer};
+}
+
+
+// Number of images of the batch of plot which are displayed
+static int displayed_images(const BufferPlot& plot)
 {
+    return plot.batch_index >= 0 ? 1 : plot.batch;
 }
 
+
+// Length in bytes of each image of a planar buffer, whose rows are step
+// elements apart
+static size_t planar_image_length(const BufferPlot& plot, int step)
+{
+    return static_cast<size_t>(step) * static_cast<size_t>(plot.image_height) *
+           static_cast<size_t>(plot.channels) * typesize(plot.type);
+}
+
+
+// Interleave the displayed images of the planar buffer plot, starting at
+// images and whose rows are step elements apart, into their montage dst
+static void pack_planar_images(const BufferPlot& plot,
+                               const uint8_t* images,
+                               int step,
+                               uint8_t* dst)
+{
+    const size_t channel_size = typesize(plot.type);
+    const size_t pixel_size =
+        static_cast<size_t>(plot.channels) * channel_size;
+    const int columns = plot.width / plot.image_width;
+
+    for (int i = 0; i < displayed_images(plot); ++i) {
+        const size_t x = static_cast<size_t>((i % columns) * plot.image_width);
+        const size_t y = static_cast<size_t>((i / columns) * plot.image_height);
+
+        pack_planes(images + static_cast<size_t>(i) *
+                                 planar_image_length(plot, step),
+                    plot.image_width,
+                    plot.image_height,
+                    step,
+                    plot.channels,
+                    channel_size,
+                    plot.width,
+                    dst + (y * static_cast<size_t>(plot.width) + x) *
+                              pixel_size);
+    }
+}
+
+struct BufferRegionRequest
+{
+    string buffer_name;
+    int x;
+    int y;
+    int width;
+    int height;
+    int factor;
+    int generation;
+};
+
 class PyGILRAII
 {
   public:
@@ -92,6 +289,40 @@ class PyGILRAII
     PyGILState_STATE _py_gil_state;
 };
 
+
+// Lets other Python threads run while the bridge doesn't need the GIL
+class PyGILReleaseRAII
+{
+  public:
+    PyGILReleaseRAII()
+    {
+        _py_thread_state = PyEval_SaveThread();
+    }
+    PyGILReleaseRAII(const PyGILReleaseRAII&)  = delete;
+    PyGILReleaseRAII(const PyGILReleaseRAII&&) = delete;
+
+    PyGILReleaseRAII& operator=(const PyGILReleaseRAII&) = delete;
+    PyGILReleaseRAII& operator=(const PyGILReleaseRAII&&) = delete;
+
+    ~PyGILReleaseRAII()
+    {
+        PyEval_RestoreThread(_py_thread_state);
+    }
+
+  private:
+    PyThreadState* _py_thread_state;
+};
+
+
+// The GIL no longer serializes the calls into the bridge once it is released
+// for I/O, so they take this lock as well. It is always taken before the
+// GIL, so that the threads waiting for it never hold the GIL.
+static recursive_mutex& bridge_call_mutex()
+{
+    static recursive_mutex mutex;
+    return mutex;
+}
+
 class OidBridge
 {
   public:
@@ -99,11 +330,41 @@ class OidBridge
         : ui_proc_{}
         , client_{nullptr}
         , plot_callback_{plot_callback}
+        , read_memory_{nullptr}
+        , compression_mode_{CompressionMode::None}
+        , shared_memory_enabled_{true}
+        , stop_generation_{0}
+        , plot_composer_{"OpenImageDebugger/" +
+                         std::to_string(QCoreApplication::applicationPid()) +
+                         "/"}
+        , stream_chunk_in_flight_{false}
+        , symbols_version_{0}
+        , symbols_resync_{true}
     {
     }
 
     bool start()
     {
+        // Headless sessions have no window to start
+        if (capture_ != nullptr) {
+            return true;
+        }
+
+        StartupPhase startup("start_window");
+
+        // A running window daemon is reused, along with its GL resources and
+        // the buffers of the previous sessions
+        bool is_daemon_connected;
+        {
+            StartupPhase daemon_phase("connect_to_window_daemon");
+            is_daemon_connected = connect_to_window_daemon();
+        }
+
+        if (is_daemon_connected) {
+            send_queue_.set_socket(client_);
+            return true;
+        }
+
         // Initialize server
         if (!server_.listen(QHostAddress::Any)) {
             // TODO escalate error
@@ -116,11 +377,19 @@ class OidBridge
 
         const vector<string> command {windowBinaryPath, "-style", "fusion", "-p", portStdString};
 
-        ui_proc_.start(command);
+        {
+            StartupPhase spawn_phase("spawn_window");
+            ui_proc_.start(command);
+            ui_proc_.waitForStart();
+        }
 
-        ui_proc_.waitForStart();
+        // The window connects before building its UI
+        {
+            StartupPhase connect_phase("wait_for_window");
+            wait_for_client();
+        }
 
-        wait_for_client();
+        send_queue_.set_socket(client_);
 
         return client_ != nullptr;
     }
@@ -130,23 +399,69 @@ class OidBridge
         oid_path_ = oid_path;
     }
 
+    // Save the buffers plotted at each stop to directory instead of starting
+    // a window, along with the watched symbols, which are replotted at each
+    // stop as the ones observed in a window would be
+    void set_capture(const string& directory,
+                     size_t queue_capacity,
+                     const deque<string>& watched_symbols)
+    {
+        capture_.reset(new BufferCapture(directory, queue_capacity));
+        watched_symbols_ = watched_symbols;
+    }
+
+    // Python callable (address, length) -> buffer, used to read the regions
+    // of lazy buffers from the inferior
+    void set_read_memory_callback(PyObject* read_memory)
+    {
+        Py_XINCREF(read_memory);
+        Py_XDECREF(read_memory_);
+        read_memory_ = read_memory;
+    }
+
     bool is_window_ready()
     {
+        if (capture_ != nullptr) {
+            return true;
+        }
+
+        if (client_ != nullptr && client_ == &daemon_socket_) {
+            // The daemon outlives the bridge, which only owns its connection
+            return daemon_socket_.state() == QAbstractSocket::ConnectedState;
+        }
+
         return client_ != nullptr && ui_proc_.isRunning();
     }
 
     deque<string> get_observed_symbols()
     {
+        if (capture_ != nullptr) {
+            return watched_symbols_;
+        }
+
         assert(client_ != nullptr);
 
-        MessageComposer message_composer;
-        message_composer.push(MessageType::GetObservedSymbols).send(client_);
+        unique_ptr<UiMessage> response;
+        {
+            // Waits for the window without blocking the debugger scripts
+            PyGILReleaseRAII py_gil_release_raii;
+
+            send_queue_.flush();
+
+            MessageComposer message_composer;
+            message_composer.push(MessageType::GetObservedSymbols)
+                .send(client_);
+
+            response = fetch_message(MessageType::GetObservedSymbolsResponse);
+        }
 
-        auto response = fetch_message(MessageType::GetObservedSymbolsResponse);
         if (response != nullptr) {
-            return static_cast<GetObservedSymbolsResponseMessage*>(
-                       response.get())
-                ->observed_symbols;
+            // Buffers are replotted in the order they are returned
+            deque<string>& observed_symbols =
+                static_cast<GetObservedSymbolsResponseMessage*>(response.get())
+                    ->observed_symbols;
+            plot_requests_.sort_by_priority(observed_symbols);
+            return observed_symbols;
         } else {
             return {};
         }
@@ -155,70 +470,545 @@ class OidBridge
 
     void set_available_symbols(const deque<string>& available_vars)
     {
+        // Only windows complete the symbols
+        if (capture_ != nullptr) {
+            return;
+        }
+
         assert(client_ != nullptr);
 
+        send_available_symbols(
+            set<string>(available_vars.begin(), available_vars.end()));
+
+        PyGILReleaseRAII py_gil_release_raii;
+        send_queue_.flush();
+    }
+
+    int begin_stop_generation()
+    {
+        ++stop_generation_;
+
+        if (capture_ != nullptr) {
+            capture_->begin_stop();
+            return stop_generation_;
+        }
+
+        // The buffers queued during previous stops would be replaced right
+        // away by their replots, so they are not worth sending anymore
+        send_queue_.discard_unsent();
+
+        // The memory of the aliases may have changed since
+        sent_buffers_.clear();
+
+        // The buffers are replotted from this stop on
+        drop_waiting_live_frames();
+
+        // The contents being streamed are outdated as well; the replotted
+        // buffers are streamed again from their first row
+        buffer_streams_.clear();
+
         MessageComposer message_composer;
-        message_composer.push(MessageType::SetAvailableSymbols)
-            .push(available_vars)
-            .send(client_);
+        message_composer.push(MessageType::SetStopGeneration)
+            .push(stop_generation_)
+            .send_async(send_queue_);
+
+        return stop_generation_;
+    }
+
+    bool run_event_loop()
+    {
+        // Captured buffers are written as soon as they are plotted
+        if (capture_ != nullptr) {
+            return false;
+        }
+
+        // Pending plots are sent in slices, so that the debugger remains
+        // responsive in between
+        const int send_period_ms = static_cast<int>(1000.0 / 30.0);
+
+        {
+            // The debugger scripts may run while the socket is written
+            PyGILReleaseRAII py_gil_release_raii;
+
+            if (!send_queue_.empty()) {
+                send_queue_.pump_for(send_period_ms);
+            }
+
+            // Only called once messages have arrived, so there is no need to
+            // wait for them
+            try_read_incoming_messages(0);
+        }
+
+        while (!plot_requests_.empty()) {
+            plot_callback_(plot_requests_.pop().c_str());
+        }
+
+        while (!region_requests_.empty()) {
+            send_buffer_region(region_requests_.front());
+            region_requests_.pop_front();
+        }
+
+        // Streams only advance once the requested regions were queued
+        send_next_stream_chunk();
+
+        // The live frames which were waiting for the previous ones to be
+        // sent may go now
+        send_live_frames();
+
+        return !send_queue_.empty() || client_->bytesAvailable() > 0 ||
+               !buffer_streams_.empty();
+    }
+
+    long long get_socket_descriptor() const
+    {
+        if (client_ == nullptr ||
+            client_->state() != QAbstractSocket::ConnectedState) {
+            return -1;
+        }
+
+        return static_cast<long long>(client_->socketDescriptor());
     }
 
-    void run_event_loop()
+    void plot_buffers(vector<BufferPlot>& plots)
     {
-        try_read_incoming_messages(static_cast<int>(1000.0 / 5.0));
+        if (capture_ != nullptr) {
+            capture_plots(plots);
+            return;
+        }
+
+        // The buffer selected in the window is read and sent ahead of the
+        // others, so that it is the first one to be refreshed
+        auto other_plots = stable_partition(
+            plots.begin(), plots.end(), [this](const BufferPlot& plot) {
+                return plot_requests_.is_selected(plot.variable_name);
+            });
 
-        unique_ptr<UiMessage> plot_request_message;
-        while ((plot_request_message = try_get_stored_message(
-                    MessageType::PlotBufferRequest)) != nullptr) {
-            const PlotBufferRequestMessage* msg =
-                dynamic_cast<PlotBufferRequestMessage*>(
-                    plot_request_message.get());
-            plot_callback_(msg->buffer_name.c_str());
+        if (other_plots != plots.begin() && other_plots != plots.end()) {
+            send_plots(plots.begin(), other_plots);
+            send_plots(other_plots, plots.end());
+        } else {
+            send_plots(plots.begin(), plots.end());
         }
     }
 
-    void plot_buffer(const string& variable_name_str,
-                     const string& display_name_str,
-                     const string& pixel_layout_str,
-                     bool transpose_buffer,
-                     int buff_width,
-                     int buff_height,
-                     int buff_channels,
-                     int buff_stride,
-                     BufferType buff_type,
-                     uint8_t* buff_ptr,
-                     size_t buff_length)
+    // Live breakpoints let the inferior run on as soon as they plotted their
+    // buffers, so these are read right away, and sent in the background. When
+    // the window falls behind, the frames which have not started being sent
+    // are replaced by newer ones, so that it always receives the latest frame
+    // once it catches up (a waiting frame at most per buffer).
+    void plot_live_buffers(vector<BufferPlot>& plots)
     {
-        MessageComposer message_composer;
-        message_composer.push(MessageType::PlotBufferContents)
-            .push(variable_name_str)
-            .push(display_name_str)
-            .push(pixel_layout_str)
-            .push(transpose_buffer)
-            .push(buff_width)
-            .push(buff_height)
-            .push(buff_channels)
-            .push(buff_stride)
-            .push(buff_type)
-            .push(buff_ptr, buff_length)
-            .send(client_);
+        if (capture_ != nullptr) {
+            // Each hit of the breakpoint is saved as a stop of its own
+            capture_->begin_stop();
+            capture_plots(plots);
+            return;
+        }
+
+        for (auto& plot : plots) {
+            plot.lazy = false;
+            plot.live = true;
+        }
+
+        vector<shared_ptr<vector<uint8_t>>> contents(plots.size());
+        vector<size_t> fetch_indices(plots.size(), no_fetch_index);
+        InferiorBufferFetcher fetcher(
+            inferior_memory_,
+            get_fetch_requests(plots.begin(), contents, fetch_indices));
+
+        for (size_t i = 0; i < plots.size(); ++i) {
+            BufferPlot& plot = plots[i];
+
+            if (contents[i] != nullptr) {
+                TraceScope trace("read_inferior_buffer",
+                                 plot.request_id,
+                                 plot.variable_name);
+                if (!fetch_inferior_buffer(
+                        plot, fetcher, fetch_indices[i], contents[i])) {
+                    cerr << "[OpenImageDebugger] Could not read buffer "
+                         << plot.variable_name << endl;
+                    continue;
+                }
+            }
+
+            LiveBuffer& live_buffer = live_buffers_[plot.variable_name];
+            if (live_buffer.has_waiting_frame &&
+                live_buffer.waiting_frame.on_sent) {
+                // Dropped in favor of the newer frame
+                live_buffer.waiting_frame.on_sent();
+            }
+
+            live_buffer.waiting_frame     = std::move(plot);
+            live_buffer.has_waiting_frame = true;
+        }
+
+        send_live_frames();
+    }
+
+
+    // Send the waiting frame of each live buffer whose previous frame was
+    // handed to the socket already
+    void send_live_frames()
+    {
+        for (auto& entry : live_buffers_) {
+            LiveBuffer& live_buffer = entry.second;
+            if (!live_buffer.has_waiting_frame || live_buffer.is_sending) {
+                continue;
+            }
+
+            vector<BufferPlot> frame(1);
+            frame[0]                  = std::move(live_buffer.waiting_frame);
+            live_buffer.waiting_frame = BufferPlot();
+            live_buffer.has_waiting_frame = false;
+            live_buffer.is_sending        = true;
+
+            // Also called if the frame is discarded by the next stop
+            const function<void()> on_sent = frame[0].on_sent;
+            const string buffer_name       = entry.first;
+            frame[0].on_sent = [this, on_sent, buffer_name]() {
+                if (on_sent) {
+                    on_sent();
+                }
+                live_buffers_[buffer_name].is_sending = false;
+            };
+
+            send_plots(frame.begin(), frame.end());
+        }
+    }
+
+
+    // The frames which have not started being sent are outdated once the
+    // inferior stops
+    void drop_waiting_live_frames()
+    {
+        for (auto& entry : live_buffers_) {
+            LiveBuffer& live_buffer = entry.second;
+            if (live_buffer.has_waiting_frame &&
+                live_buffer.waiting_frame.on_sent) {
+                live_buffer.waiting_frame.on_sent();
+            }
+
+            live_buffer.waiting_frame     = BufferPlot();
+            live_buffer.has_waiting_frame = false;
+        }
+    }
+
+
+    void send_plots(vector<BufferPlot>::iterator first_plot,
+                    vector<BufferPlot>::iterator last_plot)
+    {
+        const size_t num_plots =
+            static_cast<size_t>(distance(first_plot, last_plot));
+        if (num_plots == 0) {
+            return;
+        }
+
+        for (auto plot = first_plot; plot != last_plot; ++plot) {
+            plot->alias_source = find_alias_source(*plot);
+        }
+
+        // The buffers given by their address are read natively by worker
+        // threads, while the ones read first are already being sent
+        vector<shared_ptr<vector<uint8_t>>> contents(num_plots);
+        vector<size_t> fetch_indices(num_plots, no_fetch_index);
+        InferiorBufferFetcher fetcher(
+            inferior_memory_,
+            get_fetch_requests(first_plot, contents, fetch_indices));
+
+        // Several buffers are sent in a single batch, so that the window can
+        // update them all at once. Each of them is queued as soon as it was
+        // read, and is only dropped along with the whole batch.
+        const bool is_batch = num_plots > 1;
+        if (is_batch) {
+            MessageComposer message_composer;
+            message_composer.push(MessageType::PlotBufferBatch)
+                .push(num_plots)
+                .send_async(send_queue_, nullptr, []() {});
+        }
+
+        for (size_t i = 0; i < num_plots; ++i) {
+            BufferPlot& plot = first_plot[static_cast<ptrdiff_t>(i)];
+
+            MessageComposer message_composer;
+            message_composer.set_compression(compression_mode_)
+                .set_request_id(plot.request_id);
+            if (is_batch) {
+                message_composer.join_previous();
+            }
+
+            bool is_buffer_read = true;
+            if (contents[i] != nullptr) {
+                TraceScope trace("read_inferior_buffer",
+                                 plot.request_id,
+                                 plot.variable_name);
+                is_buffer_read = fetch_inferior_buffer(
+                    plot, fetcher, fetch_indices[i], contents[i]);
+            }
+
+            // The aliases of a buffer which could not be read are just as
+            // unreadable
+            if (!plot.alias_source.empty()) {
+                auto source = sent_buffers_.find(get_alias_key(plot));
+                is_buffer_read = source != sent_buffers_.end() &&
+                                 source->second == plot.alias_source;
+            }
+
+            if (!is_buffer_read) {
+                cerr << "[OpenImageDebugger] Could not read buffer "
+                     << plot.variable_name << endl;
+
+                forget_sent_buffer(plot.variable_name);
+
+                // Takes the place of the buffer in the batch
+                message_composer.push(MessageType::PlotBufferUnavailable)
+                    .push(plot.variable_name)
+                    .send_async(send_queue_, nullptr, []() {});
+
+                if (plot.on_sent) {
+                    plot.on_sent();
+                }
+                continue;
+            }
+
+            // Writing to the shared memory, hashing the tiles and compressing
+            // them don't touch any Python object
+            PyGILReleaseRAII py_gil_release_raii;
+
+            {
+                TraceScope trace(
+                    "compose_plot", plot.request_id, plot.variable_name);
+                if (!plot.alias_source.empty()) {
+                    compose_plot_buffer_alias(message_composer, plot);
+                } else if (plot.lazy) {
+                    compose_plot_buffer_lazy(message_composer, plot);
+                } else {
+                    compose_plot_buffer(message_composer, plot);
+                }
+            }
+
+            // The send is traced until the socket took the whole message
+            if (tracing_enabled()) {
+                const function<void()> on_sent = plot.on_sent;
+                const uint64_t request_id      = plot.request_id;
+                const string variable_name     = plot.variable_name;
+                const double begin_us          = trace_now_us();
+                plot.on_sent = [=]() {
+                    trace_event("send_plot",
+                                request_id,
+                                begin_us,
+                                trace_now_us(),
+                                variable_name);
+                    if (on_sent) {
+                        on_sent();
+                    }
+                };
+            }
+
+            const string buffer_name = plot.variable_name;
+            message_composer.send_async(
+                send_queue_, plot.on_sent, [this, buffer_name]() {
+                    // The window never received the contents the tile
+                    // hashes were updated with
+                    plot_composer_.tile_hashes().invalidate(buffer_name);
+                });
+        }
+    }
+
+
+    // Allocate the contents of the plots given by their address in the
+    // inferior, and return the native reads of them. The index of the read
+    // of each plot is set in fetch_indices, unless it must be read through
+    // the debugger.
+    vector<InferiorBufferFetcher::Request>
+    get_fetch_requests(vector<BufferPlot>::iterator first_plot,
+                       vector<shared_ptr<vector<uint8_t>>>& contents,
+                       vector<size_t>& fetch_indices)
+    {
+        vector<InferiorBufferFetcher::Request> fetch_requests;
+        for (size_t i = 0; i < contents.size(); ++i) {
+            const BufferPlot& plot = first_plot[static_cast<ptrdiff_t>(i)];
+            if (plot.pid != 0 && !inferior_memory_.attach(plot.pid)) {
+                cerr << "[OpenImageDebugger] Could not open the memory of"
+                        " process "
+                     << plot.pid << "; reading it through the debugger"
+                     << endl;
+            }
+
+            if (plot.lazy || plot.buffer != nullptr ||
+                !plot.alias_source.empty()) {
+                continue;
+            }
+
+            const InferiorBufferFetcher::Request request =
+                get_fetch_request(plot, nullptr);
+            contents[i] = make_shared<vector<uint8_t>>(
+                request.row_length * static_cast<size_t>(request.height));
+            if (inferior_memory_.isAttached()) {
+                fetch_indices[i] = fetch_requests.size();
+                fetch_requests.push_back(
+                    get_fetch_request(plot, contents[i]->data()));
+            }
+        }
+
+        return fetch_requests;
+    }
+
+
+    // Headless sessions save the plotted buffers instead of sending them.
+    // They are read as a whole, since there is no window to request the
+    // regions of lazy buffers.
+    void capture_plots(vector<BufferPlot>& plots)
+    {
+        for (auto& plot : plots) {
+            plot.lazy = false;
+
+            // Plotted symbols are captured again at the next stops
+            if (find(watched_symbols_.begin(),
+                     watched_symbols_.end(),
+                     plot.variable_name) == watched_symbols_.end()) {
+                watched_symbols_.push_back(plot.variable_name);
+            }
+        }
+
+        vector<shared_ptr<vector<uint8_t>>> contents(plots.size());
+        vector<size_t> fetch_indices(plots.size(), no_fetch_index);
+        InferiorBufferFetcher fetcher(
+            inferior_memory_,
+            get_fetch_requests(plots.begin(), contents, fetch_indices));
+
+        for (size_t i = 0; i < plots.size(); ++i) {
+            BufferPlot& plot = plots[i];
+
+            bool is_buffer_read = true;
+            if (contents[i] != nullptr) {
+                TraceScope trace("read_inferior_buffer",
+                                 plot.request_id,
+                                 plot.variable_name);
+                is_buffer_read = fetch_inferior_buffer(
+                    plot, fetcher, fetch_indices[i], contents[i]);
+            }
+
+            if (!is_buffer_read) {
+                cerr << "[OpenImageDebugger] Could not read buffer "
+                     << plot.variable_name << endl;
+                continue;
+            }
+
+            // The rows of the contents are contiguous by now
+            BufferCapture::Capture capture;
+            capture.variable_name    = plot.variable_name;
+            capture.display_name     = plot.display_name;
+            capture.pixel_layout     = plot.pixel_layout;
+            capture.transpose_buffer = plot.transpose_buffer;
+            capture.width            = plot.width;
+            capture.height           = plot.height;
+            capture.channels         = plot.channels;
+            capture.type             = plot.type;
+            capture.contents         = plot.buffer;
+            capture.length           = static_cast<size_t>(plot.width) *
+                                         static_cast<size_t>(plot.height) *
+                                         static_cast<size_t>(plot.channels) *
+                                         typesize(plot.type);
+            capture.request_id       = plot.request_id;
+
+            if (contents[i] != nullptr) {
+                // Only holds the contents read by the bridge, which can be
+                // released from the writer thread
+                capture.release = plot.on_sent;
+            } else {
+                // Buffers given by the debugger scripts must be released with
+                // the GIL held
+                auto copy = make_shared<vector<uint8_t>>(
+                    plot.buffer, plot.buffer + capture.length);
+                capture.contents = copy->data();
+                capture.release  = [copy]() {};
+
+                if (plot.on_sent) {
+                    plot.on_sent();
+                }
+            }
+
+            // Only blocks while the writer is behind by a whole queue
+            PyGILReleaseRAII py_gil_release_raii;
+            capture_->enqueue(std::move(capture));
+        }
+    }
+
+
+    // Read several small blocks (e.g. object headers) straight from the
+    // memory of the local process pid, setting their success flags
+    bool read_process_blocks(uint64_t pid, vector<InferiorMemoryBlock>& blocks)
+    {
+        if (!inferior_memory_.attach(pid)) {
+            return false;
+        }
+
+        // Native reads don't touch any Python object
+        PyGILReleaseRAII py_gil_release_raii;
+        inferior_memory_.readBlocks(blocks);
+
+        return true;
     }
 
+
     ~OidBridge()
     {
+        // The captured buffers are all written before the session ends
+        if (capture_ != nullptr) {
+            PyGILReleaseRAII py_gil_release_raii;
+            capture_.reset();
+        }
+
+        send_queue_.clear();
+        daemon_socket_.abort();
         ui_proc_.kill();
+        Py_XDECREF(read_memory_);
     }
 
   private:
     Process ui_proc_;
     QTcpServer server_;
+    QTcpSocket daemon_socket_;
     QTcpSocket* client_;
+    MessageSendQueue send_queue_;
     string oid_path_;
 
     int (*plot_callback_)(const char*);
+    PyObject* read_memory_;
+
+    CompressionMode compression_mode_;
+    bool shared_memory_enabled_;
+    int stop_generation_;
+    BufferPlotComposer plot_composer_;
+    InferiorMemory inferior_memory_;
+
+    PlotRequestScheduler plot_requests_;
+
+    std::map<std::string, BufferPlot> lazy_buffers_;
+    std::deque<BufferRegionRequest> region_requests_;
+
+    // Next row to be streamed of each lazy buffer being streamed
+    std::map<std::string, int> buffer_streams_;
+    bool stream_chunk_in_flight_;
+    std::vector<uint8_t> row_samples_;
+
+    // Symbols last sent to the window, and their version
+    std::set<std::string> sent_symbols_;
+    int symbols_version_;
+    bool symbols_resync_;
 
     std::map<MessageType, std::unique_ptr<UiMessage>> received_messages_;
 
+    // Buffer sent with each memory and layout during the current stop
+    std::map<BufferAliasKey, std::string> sent_buffers_;
+
+    // Frames of the buffers plotted by live breakpoints
+    std::map<std::string, LiveBuffer> live_buffers_;
+
+    // Set in headless sessions, along with the symbols captured at each stop
+    std::unique_ptr<BufferCapture> capture_;
+    std::deque<std::string> watched_symbols_;
+
     std::unique_ptr<UiMessage>
     try_get_stored_message(const MessageType& msg_type)
     {
@@ -234,45 +1024,601 @@ class OidBridge
     }
 
 
-    void try_read_incoming_messages(int msecs = 3000)
+    void compose_plot_buffer_lazy(MessageComposer& message_composer,
+                                  const BufferPlot& plot)
+    {
+        lazy_buffers_[plot.variable_name] = plot;
+
+        plot_composer_.invalidate(plot.variable_name);
+
+        // Buffers which can be read natively are also streamed in full, in
+        // between the regions requested by the window. Reading them through
+        // the debugger would block it for too long.
+        const bool streamed =
+            plot.pid != 0 && inferior_memory_.attach(plot.pid);
+        if (streamed) {
+            buffer_streams_[plot.variable_name] = 0;
+        } else {
+            buffer_streams_.erase(plot.variable_name);
+        }
+
+        message_composer.push(MessageType::PlotBufferLazy)
+            .push(plot.variable_name)
+            .push(plot.display_name)
+            .push(plot.pixel_layout)
+            .push(plot.transpose_buffer)
+            .push(plot.width)
+            .push(plot.height)
+            .push(plot.channels)
+            .push(plot.type)
+            .push(streamed);
+    }
+
+
+    // Return the buffer plotted with the memory and layout of plot during
+    // this stop, or else record plot as the one sent with them. Lazy buffers
+    // are only read in parts, so they are never shared.
+    string find_alias_source(const BufferPlot& plot)
+    {
+        // The window replaces whatever it displayed under this name
+        forget_sent_buffer(plot.variable_name);
+
+        if (plot.lazy || plot.live) {
+            return string();
+        }
+
+        const BufferAliasKey key = get_alias_key(plot);
+        auto source              = sent_buffers_.find(key);
+        if (source != sent_buffers_.end()) {
+            return source->second;
+        }
+
+        sent_buffers_[key] = plot.variable_name;
+        return string();
+    }
+
+
+    void forget_sent_buffer(const string& variable_name)
+    {
+        for (auto sent = sent_buffers_.begin(); sent != sent_buffers_.end();) {
+            if (sent->second == variable_name) {
+                sent = sent_buffers_.erase(sent);
+            } else {
+                ++sent;
+            }
+        }
+    }
+
+
+    // The window displays aliases from the contents and textures of their
+    // source, so only their names are sent
+    void compose_plot_buffer_alias(MessageComposer& message_composer,
+                                   const BufferPlot& plot)
+    {
+        lazy_buffers_.erase(plot.variable_name);
+        buffer_streams_.erase(plot.variable_name);
+
+        plot_composer_.invalidate(plot.variable_name);
+
+        message_composer.push(MessageType::PlotBufferAlias)
+            .push(plot.variable_name)
+            .push(plot.display_name)
+            .push(plot.alias_source);
+    }
+
+
+    // Read the next chunk of rows of one of the streamed buffers, once the
+    // previous chunk was written. Peak memory doesn't depend on the size of
+    // the streamed buffers.
+    void send_next_stream_chunk()
+    {
+        if (stream_chunk_in_flight_ || buffer_streams_.empty()) {
+            return;
+        }
+
+        auto stream      = buffer_streams_.begin();
+        auto lazy_buffer = lazy_buffers_.find(stream->first);
+        if (lazy_buffer == lazy_buffers_.end()) {
+            buffer_streams_.erase(stream);
+            return;
+        }
+
+        const BufferPlot& plot   = lazy_buffer->second;
+        const string buffer_name = stream->first;
+        const int y              = stream->second;
+
+        const size_t row_length = static_cast<size_t>(plot.width) *
+                                  static_cast<size_t>(plot.channels) *
+                                  typesize(plot.type);
+        const int chunk_height =
+            min(plot.height - y,
+                static_cast<int>(
+                    max(stream_chunk_size / row_length, size_t{1})));
+
+        vector<uint8_t> chunk(row_length * static_cast<size_t>(chunk_height));
+
+        InferiorBufferFetcher::Request request =
+            get_fetch_request(plot, chunk.data());
+        request.address += static_cast<uint64_t>(y) * request.row_stride;
+        request.height = chunk_height;
+
+        bool success = inferior_memory_.attach(plot.pid);
+        if (success) {
+            // Native reads don't touch any Python object
+            PyGILReleaseRAII py_gil_release_raii;
+            InferiorBufferFetcher fetcher(inferior_memory_, {request});
+            success = fetcher.wait(0);
+        }
+
+        if (success && y + chunk_height < plot.height) {
+            stream->second = y + chunk_height;
+        } else {
+            buffer_streams_.erase(stream);
+        }
+
+        // An empty chunk ends the stream early; the window then requests the
+        // regions it displays instead
+        if (!success) {
+            cerr << "[OpenImageDebugger] Could not stream buffer "
+                 << buffer_name << endl;
+            chunk.clear();
+        }
+
+        stream_chunk_in_flight_ = true;
+
+        MessageComposer message_composer;
+        message_composer.set_compression(compression_mode_);
+        message_composer.push(MessageType::PlotBufferChunk)
+            .push(buffer_name)
+            .push(y)
+            .push(success ? chunk_height : 0)
+            .push(stop_generation_)
+            .push_owned(std::move(chunk))
+            .send_async(
+                send_queue_,
+                [this]() { stream_chunk_in_flight_ = false; },
+                []() {
+                    // Only chunks of the previous stops are discarded, and
+                    // their streams were ended along with them
+                });
+    }
+
+
+    // Native read of the contents of plot, without their row padding. The
+    // planes of planar buffers are read as they are, one row after the
+    // other.
+    static InferiorBufferFetcher::Request
+    get_fetch_request(const BufferPlot& plot, uint8_t* dst)
+    {
+        const size_t pixel_size =
+            static_cast<size_t>(plot.channels) * typesize(plot.type);
+
+        InferiorBufferFetcher::Request request;
+        request.address    = plot.address;
+        request.row_length = static_cast<size_t>(plot.width) * pixel_size;
+        request.row_stride = static_cast<size_t>(plot.stride) * pixel_size;
+        request.height     = plot.height;
+        request.dst        = dst;
+
+        if (plot.planar) {
+            const size_t channel_size = typesize(plot.type);
+            const int first_image = max(plot.batch_index, 0);
+
+            request.address +=
+                static_cast<uint64_t>(first_image) *
+                planar_image_length(plot, plot.stride);
+            request.row_length =
+                static_cast<size_t>(plot.image_width) * channel_size;
+            request.row_stride =
+                static_cast<size_t>(plot.stride) * channel_size;
+            request.height = displayed_images(plot) * plot.channels *
+                             plot.image_height;
+        }
+
+        return request;
+    }
+
+
+    // Wait for the contents of a buffer given by its address in the inferior
+    // to be read by fetcher (if it was given to it at fetch_index), or else
+    // read them through the debugger
+    bool fetch_inferior_buffer(BufferPlot& plot,
+                               InferiorBufferFetcher& fetcher,
+                               size_t fetch_index,
+                               const shared_ptr<vector<uint8_t>>& contents)
+    {
+        bool success = false;
+        if (fetch_index != no_fetch_index) {
+            // Lets the debugger run while the workers read the inferior
+            PyGILReleaseRAII py_gil_release_raii;
+            success = fetcher.wait(fetch_index);
+        }
+
+        if (!success) {
+            const InferiorBufferFetcher::Request request =
+                get_fetch_request(plot, contents->data());
+            success = read_debugger_rows(request.address,
+                                         request.row_length,
+                                         request.row_stride,
+                                         request.height,
+                                         request.dst);
+        }
+
+        if (!success) {
+            return false;
+        }
+
+        if (plot.planar) {
+            auto packed_contents = make_shared<vector<uint8_t>>(plot.length);
+            pack_planar_images(plot,
+                               contents->data(),
+                               plot.image_width,
+                               packed_contents->data());
+
+            plot.buffer  = packed_contents->data();
+            plot.stride  = plot.width;
+            plot.on_sent = [packed_contents]() {};
+
+            return true;
+        }
+
+        plot.buffer  = contents->data();
+        plot.stride  = plot.width;
+        plot.on_sent = [contents]() {};
+
+        return true;
+    }
+
+
+    // Read height rows of row_length bytes, spaced by row_stride bytes,
+    // starting at address in the inferior into dst, through the debugger
+    bool read_debugger_rows(uint64_t address,
+                            size_t row_length,
+                            size_t row_stride,
+                            int height,
+                            uint8_t* dst)
+    {
+        if (row_stride == row_length) {
+            return read_debugger_memory(
+                address, row_length * static_cast<size_t>(height), dst);
+        }
+
+        for (int y = 0; y < height; ++y) {
+            if (!read_debugger_memory(
+                    address + static_cast<uint64_t>(y) * row_stride,
+                    row_length,
+                    dst + static_cast<size_t>(y) * row_length)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    // Read length bytes at address in the inferior into dst
+    bool read_inferior_memory(uint64_t address, size_t length, uint8_t* dst)
+    {
+        if (inferior_memory_.isAttached() &&
+            inferior_memory_.read(address, length, dst)) {
+            return true;
+        }
+
+        return read_debugger_memory(address, length, dst);
+    }
+
+
+    // Read length bytes at address in the inferior into dst, through the
+    // read_memory callback of the debugger bridge
+    bool read_debugger_memory(uint64_t address, size_t length, uint8_t* dst)
+    {
+        if (read_memory_ == nullptr) {
+            return false;
+        }
+
+        PyObject* py_memory =
+            PyObject_CallFunction(read_memory_,
+                                  "KK",
+                                  static_cast<unsigned long long>(address),
+                                  static_cast<unsigned long long>(length));
+        if (py_memory == nullptr) {
+            PyErr_Clear();
+            return false;
+        }
+
+        Py_buffer view;
+        bool success = false;
+        if (PyObject_GetBuffer(py_memory, &view, PyBUF_SIMPLE) == 0) {
+            if (static_cast<size_t>(view.len) >= length) {
+                memcpy(dst, view.buf, length);
+                success = true;
+            }
+            PyBuffer_Release(&view);
+        } else {
+            PyErr_Clear();
+        }
+
+        Py_DECREF(py_memory);
+
+        return success;
+    }
+
+
+    void send_buffer_region(const BufferRegionRequest& request)
+    {
+        auto lazy_buffer = lazy_buffers_.find(request.buffer_name);
+        if (lazy_buffer == lazy_buffers_.end()) {
+            return;
+        }
+        const BufferPlot& plot = lazy_buffer->second;
+
+        // Clip the region to the buffer
+        const int x      = max(0, request.x);
+        const int y      = max(0, request.y);
+        const int width  = min(request.width, plot.width - x);
+        const int height = min(request.height, plot.height - y);
+        const int factor = max(1, request.factor);
+
+        if (width <= 0 || height <= 0) {
+            return;
+        }
+
+        const size_t pixel_size =
+            static_cast<size_t>(plot.channels) * typesize(plot.type);
+        const int region_width  = (width + factor - 1) / factor;
+        const int region_height = (height + factor - 1) / factor;
+
+        vector<uint8_t> region(static_cast<size_t>(region_width) *
+                               static_cast<size_t>(region_height) *
+                               pixel_size);
+        vector<uint8_t> row(static_cast<size_t>(width) * pixel_size);
+
+        // Read the sampled rows one at a time, and keep every factor-th pixel.
+        // Rows which can't be read are sent blank, so that the window doesn't
+        // wait for them forever.
+        bool success = true;
+        for (int ry = 0; ry < region_height; ++ry) {
+            const uint64_t row_address =
+                plot.address +
+                (static_cast<uint64_t>(y + ry * factor) *
+                     static_cast<uint64_t>(plot.stride) +
+                 static_cast<uint64_t>(x)) *
+                    pixel_size;
+
+            if (!read_inferior_memory(row_address, row.size(), row.data())) {
+                fill(row.begin(), row.end(), 0);
+                success = false;
+            }
+
+            pack_preview(row.data(),
+                         width,
+                         1,
+                         width,
+                         pixel_size,
+                         factor,
+                         row_samples_);
+            memcpy(region.data() + static_cast<size_t>(ry) *
+                                       static_cast<size_t>(region_width) *
+                                       pixel_size,
+                   row_samples_.data(),
+                   row_samples_.size());
+        }
+
+        if (!success) {
+            cerr << "[OpenImageDebugger] Could not read region of buffer "
+                 << request.buffer_name << endl;
+        }
+
+        MessageComposer message_composer;
+        message_composer.set_compression(compression_mode_);
+        message_composer.push(MessageType::PlotBufferRegion)
+            .push(request.buffer_name)
+            .push(x)
+            .push(y)
+            .push(width)
+            .push(height)
+            .push(factor)
+            .push(request.generation)
+            .push_owned(std::move(region))
+            .send_async(send_queue_, nullptr, []() {
+                // The window requests the regions it displays again once it
+                // learns about the new stop
+            });
+    }
+
+
+    void compose_plot_buffer(MessageComposer& message_composer,
+                             const BufferPlot& plot)
+    {
+        // This buffer is (no longer) lazy
+        lazy_buffers_.erase(plot.variable_name);
+        buffer_streams_.erase(plot.variable_name);
+
+        BufferPlotContents contents;
+        contents.variable_name    = plot.variable_name;
+        contents.display_name     = plot.display_name;
+        contents.pixel_layout     = plot.pixel_layout;
+        contents.transpose_buffer = plot.transpose_buffer;
+        contents.width            = plot.width;
+        contents.height           = plot.height;
+        contents.channels         = plot.channels;
+        contents.stride           = plot.stride;
+        contents.type             = plot.type;
+        contents.buffer           = plot.buffer;
+        contents.length           = plot.length;
+
+        plot_composer_.compose(message_composer, contents, use_shared_memory());
+    }
+
+
+    bool use_shared_memory() const
+    {
+        // Shared memory is only reachable if the window runs on this machine
+        return shared_memory_enabled_ && client_->peerAddress().isLoopback();
+    }
+
+
+    void try_read_incoming_messages(int msecs = 3000)
+    {
+        assert(client_ != nullptr);
+
+        do {
+            client_->waitForReadyRead(msecs);
+
+            if (client_->bytesAvailable() == 0) {
+                break;
+            }
+
+            MessageHeader header;
+            MessageDecoder(client_).read(header);
+
+            if (header.version != message_protocol_version) {
+                cerr << "[OpenImageDebugger] Received message with unsupported"
+                        " version "
+                     << header.version << endl;
+                MessageDecoder(client_).skip(header.length);
+                continue;
+            }
+
+            switch (header.type) {
+            case MessageType::PlotBufferRequest:
+                decode_plot_buffer_request();
+                break;
+            case MessageType::GetObservedSymbolsResponse:
+                received_messages_[header.type] =
+                    decode_get_observed_symbols_response();
+                break;
+            case MessageType::SharedMemoryUnavailable:
+                // The window could not read the buffer from shared memory,
+                // so plot it again through the socket
+                shared_memory_enabled_ = false;
+                plot_composer_.shared_buffers().clear();
+                decode_plot_buffer_request();
+                break;
+            case MessageType::InvalidateBufferCache:
+                decode_invalidate_buffer_cache();
+                break;
+            case MessageType::SetCompressionMode:
+                MessageDecoder(client_).read(compression_mode_);
+                break;
+            case MessageType::RequestBufferRegion:
+                decode_request_buffer_region();
+                break;
+            case MessageType::SetPlotPriorities:
+                decode_set_plot_priorities();
+                break;
+            case MessageType::RequestAvailableSymbols:
+                // The window missed an update of the symbols
+                symbols_resync_ = true;
+                send_available_symbols(sent_symbols_);
+                break;
+            default:
+                cerr << "[OpenImageDebugger] Received message with incorrect"
+                        " header"
+                     << endl;
+                MessageDecoder(client_).skip(header.length);
+                break;
+            }
+        } while (client_->bytesAvailable() > 0);
+    }
+
+
+    // Only the symbols added and removed since the previous version are sent,
+    // unless the window has to be resynchronised
+    void send_available_symbols(set<string> symbols)
+    {
+        deque<string> added_symbols;
+        deque<string> removed_symbols;
+        int base_version = 0;
+
+        if (symbols_resync_) {
+            added_symbols.assign(symbols.begin(), symbols.end());
+        } else {
+            base_version = symbols_version_;
+            set_difference(symbols.begin(),
+                           symbols.end(),
+                           sent_symbols_.begin(),
+                           sent_symbols_.end(),
+                           back_inserter(added_symbols));
+            set_difference(sent_symbols_.begin(),
+                           sent_symbols_.end(),
+                           symbols.begin(),
+                           symbols.end(),
+                           back_inserter(removed_symbols));
+        }
+
+        ++symbols_version_;
+        symbols_resync_ = false;
+        sent_symbols_.swap(symbols);
+
+        MessageComposer message_composer;
+        message_composer.push(MessageType::SetAvailableSymbolsDiff)
+            .push(symbols_version_)
+            .push(base_version)
+            .push(added_symbols)
+            .push(removed_symbols)
+            .send_async(send_queue_);
+    }
+
+
+    void decode_plot_buffer_request()
     {
         assert(client_ != nullptr);
 
-        do {
-            client_->waitForReadyRead(msecs);
+        string buffer_name;
+        MessageDecoder message_decoder(client_);
+        message_decoder.read(buffer_name);
 
-            if (client_->bytesAvailable() == 0) {
-                break;
-            }
+        plot_requests_.push(buffer_name);
+    }
 
-            MessageType header;
-            client_->read(reinterpret_cast<char*>(&header),
-                          static_cast<qint64>(sizeof(header)));
+    void decode_set_plot_priorities()
+    {
+        assert(client_ != nullptr);
 
-            switch (header) {
-            case MessageType::PlotBufferRequest:
-                received_messages_[header] = decode_plot_buffer_request();
-                break;
-            case MessageType::GetObservedSymbolsResponse:
-                received_messages_[header] =
-                    decode_get_observed_symbols_response();
-                break;
-            default:
-                cerr << "[OpenImageDebugger] Received message with incorrect header" << endl;
-                break;
-            }
-        } while (client_->bytesAvailable() > 0);
+        string selected_buffer;
+        deque<string> visible_buffers;
+        MessageDecoder message_decoder(client_);
+        message_decoder.read(selected_buffer)
+            .read<std::deque<std::string>, std::string>(visible_buffers);
+
+        plot_requests_.set_priorities(selected_buffer, visible_buffers);
     }
 
+    void decode_request_buffer_region()
+    {
+        assert(client_ != nullptr);
+
+        BufferRegionRequest request;
+        MessageDecoder message_decoder(client_);
+        message_decoder.read(request.buffer_name)
+            .read(request.x)
+            .read(request.y)
+            .read(request.width)
+            .read(request.height)
+            .read(request.factor)
+            .read(request.generation);
+
+        // The window requested it before learning that the inferior stopped
+        if (request.generation != stop_generation_) {
+            return;
+        }
+
+        region_requests_.push_back(request);
+    }
 
-    unique_ptr<UiMessage> decode_plot_buffer_request()
+    void decode_invalidate_buffer_cache()
     {
         assert(client_ != nullptr);
 
-        auto response = new PlotBufferRequestMessage();
+        string buffer_name;
         MessageDecoder message_decoder(client_);
-        message_decoder.read(response->buffer_name);
-        return unique_ptr<UiMessage>(response);
+        message_decoder.read(buffer_name);
+
+        plot_composer_.tile_hashes().invalidate(buffer_name);
+
+        // The window no longer holds the contents its aliases would share
+        forget_sent_buffer(buffer_name);
     }
 
     unique_ptr<UiMessage> decode_get_observed_symbols_response()
@@ -304,6 +1650,27 @@ class OidBridge
     }
 
 
+    bool connect_to_window_daemon()
+    {
+        uint16_t daemon_port;
+        if (!find_window_daemon(daemon_port)) {
+            return false;
+        }
+
+        daemon_socket_.connectToHost(QHostAddress::LocalHost, daemon_port);
+        if (!daemon_socket_.waitForConnected(
+                window_daemon_connect_timeout_ms)) {
+            // The daemon exited without withdrawing its port
+            daemon_socket_.abort();
+            return false;
+        }
+
+        client_         = &daemon_socket_;
+        symbols_resync_ = true;
+        return true;
+    }
+
+
     void wait_for_client()
     {
         if (client_ == nullptr) {
@@ -311,7 +1678,8 @@ class OidBridge
                 cerr << "[OpenImageDebugger] No clients connected to OpenImageDebugger server"
                      << endl;
             }
-            client_ = server_.nextPendingConnection();
+            client_         = server_.nextPendingConnection();
+            symbols_resync_ = true;
         }
     }
 };
@@ -320,6 +1688,7 @@ class OidBridge
 AppHandler oid_initialize(int (*plot_callback)(const char*),
                           PyObject* optional_parameters)
 {
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
     PyGILRAII py_gil_raii;
 
     if (optional_parameters != nullptr && !PyDict_Check(optional_parameters)) {
@@ -336,6 +1705,8 @@ AppHandler oid_initialize(int (*plot_callback)(const char*),
     PyObject* py_oid_path =
         PyDict_GetItemString(optional_parameters, "oid_path");
 
+    initialize_tracing("oidbridge");
+
     OidBridge* app = new OidBridge(plot_callback);
 
     if (py_oid_path) {
@@ -344,12 +1715,52 @@ AppHandler oid_initialize(int (*plot_callback)(const char*),
         app->set_path(oid_path_str);
     }
 
+    PyObject* py_read_memory =
+        PyDict_GetItemString(optional_parameters, "read_memory");
+
+    if (py_read_memory != nullptr && PyCallable_Check(py_read_memory)) {
+        app->set_read_memory_callback(py_read_memory);
+    }
+
+    // Headless sessions save the buffers to capture_dir instead
+    PyObject* py_capture_dir =
+        PyDict_GetItemString(optional_parameters, "capture_dir");
+
+    if (py_capture_dir != nullptr && check_py_string_type(py_capture_dir)) {
+        string capture_dir_str;
+        copy_py_string(capture_dir_str, py_capture_dir);
+
+        // Bytes of the buffers waiting to be written, 512 MiB by default
+        size_t queue_capacity = size_t(512) << 20;
+        PyObject* py_queue_mb =
+            PyDict_GetItemString(optional_parameters, "capture_queue_mb");
+        if (py_queue_mb != nullptr && PY_INT_CHECK_FUNC(py_queue_mb) &&
+            get_py_int(py_queue_mb) > 0) {
+            queue_capacity = static_cast<size_t>(get_py_int(py_queue_mb))
+                             << 20;
+        }
+
+        deque<string> watched_symbols;
+        PyObject* py_watch =
+            PyDict_GetItemString(optional_parameters, "capture_watch");
+        if (py_watch != nullptr && PyList_Check(py_watch)) {
+            for (Py_ssize_t pos = 0; pos < PyList_Size(py_watch); ++pos) {
+                string symbol_str;
+                copy_py_string(symbol_str, PyList_GetItem(py_watch, pos));
+                watched_symbols.push_back(symbol_str);
+            }
+        }
+
+        app->set_capture(capture_dir_str, queue_capacity, watched_symbols);
+    }
+
     return static_cast<AppHandler>(app);
 }
 
 
 void oid_cleanup(AppHandler handler)
 {
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
     PyGILRAII py_gil_raii;
 
     OidBridge* app = static_cast<OidBridge*>(handler);
@@ -366,6 +1777,7 @@ void oid_cleanup(AppHandler handler)
 
 void oid_exec(AppHandler handler)
 {
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
     PyGILRAII py_gil_raii;
 
     OidBridge* app = static_cast<OidBridge*>(handler);
@@ -382,6 +1794,7 @@ void oid_exec(AppHandler handler)
 
 int oid_is_window_ready(AppHandler handler)
 {
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
     PyGILRAII py_gil_raii;
 
     OidBridge* app = static_cast<OidBridge*>(handler);
@@ -398,6 +1811,7 @@ int oid_is_window_ready(AppHandler handler)
 
 PyObject* oid_get_observed_buffers(AppHandler handler)
 {
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
     PyGILRAII py_gil_raii;
 
     OidBridge* app = static_cast<OidBridge*>(handler);
@@ -432,6 +1846,7 @@ PyObject* oid_get_observed_buffers(AppHandler handler)
 
 void oid_set_available_symbols(AppHandler handler, PyObject* available_vars_py)
 {
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
     PyGILRAII py_gil_raii;
 
     assert(PyList_Check(available_vars_py));
@@ -457,8 +1872,9 @@ void oid_set_available_symbols(AppHandler handler, PyObject* available_vars_py)
 }
 
 
-void oid_run_event_loop(AppHandler handler)
+int oid_run_event_loop(AppHandler handler)
 {
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
     PyGILRAII py_gil_raii;
 
     OidBridge* app = static_cast<OidBridge*>(handler);
@@ -467,31 +1883,129 @@ void oid_run_event_loop(AppHandler handler)
         RAISE_PY_EXCEPTION(PyExc_RuntimeError,
                            "oid_run_event_loop received null application "
                            "handler");
-        return;
+        return 0;
     }
 
-    app->run_event_loop();
+    return app->run_event_loop();
 }
 
 
-void oid_plot_buffer(AppHandler handler, PyObject* buffer_metadata)
+int oid_begin_stop_generation(AppHandler handler)
+{
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
+    PyGILRAII py_gil_raii;
+
+    OidBridge* app = static_cast<OidBridge*>(handler);
+
+    if (app == nullptr) {
+        RAISE_PY_EXCEPTION(PyExc_RuntimeError,
+                           "oid_begin_stop_generation received null "
+                           "application handler");
+        return 0;
+    }
+
+    return app->begin_stop_generation();
+}
+
+
+long long oid_get_socket_descriptor(AppHandler handler)
 {
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
     PyGILRAII py_gil_raii;
 
+    OidBridge* app = static_cast<OidBridge*>(handler);
+
+    if (app == nullptr) {
+        RAISE_PY_EXCEPTION(PyExc_RuntimeError,
+                           "oid_get_socket_descriptor received null "
+                           "application handler");
+        return -1;
+    }
+
+    return app->get_socket_descriptor();
+}
+
+
+PyObject* oid_read_memory_blocks(AppHandler handler,
+                                 unsigned long long pid,
+                                 PyObject* blocks_py)
+{
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
+    PyGILRAII py_gil_raii;
 
     OidBridge* app = static_cast<OidBridge*>(handler);
 
     if (app == nullptr) {
         RAISE_PY_EXCEPTION(PyExc_RuntimeError,
-                           "oid_plot_buffer received null application handler");
-        return;
+                           "oid_read_memory_blocks received null application "
+                           "handler");
+        return nullptr;
+    }
+
+    if (!PyList_Check(blocks_py)) {
+        RAISE_PY_EXCEPTION(PyExc_TypeError,
+                           "Invalid object given to read_memory_blocks (was"
+                           " expecting a list).");
+        return nullptr;
+    }
+
+    const Py_ssize_t num_blocks = PyList_Size(blocks_py);
+
+    vector<InferiorMemoryBlock> blocks(static_cast<size_t>(num_blocks));
+    vector<vector<uint8_t>> contents(static_cast<size_t>(num_blocks));
+    for (Py_ssize_t i = 0; i < num_blocks; ++i) {
+        PyObject* block_py = PyList_GetItem(blocks_py, i);
+        unsigned long long address;
+        unsigned long long length;
+        if (!PyArg_ParseTuple(block_py, "KK", &address, &length)) {
+            return nullptr;
+        }
+
+        vector<uint8_t>& block_contents = contents[static_cast<size_t>(i)];
+        block_contents.resize(static_cast<size_t>(length));
+
+        InferiorMemoryBlock& block = blocks[static_cast<size_t>(i)];
+        block.address = static_cast<uint64_t>(address);
+        block.length  = block_contents.size();
+        block.dst     = block_contents.data();
+        block.success = false;
     }
 
+    // Blocks which can't be read natively are left as None
+    app->read_process_blocks(static_cast<uint64_t>(pid), blocks);
+
+    PyObject* result = PyList_New(num_blocks);
+    for (Py_ssize_t i = 0; i < num_blocks; ++i) {
+        PyObject* block_contents_py;
+        if (blocks[static_cast<size_t>(i)].success) {
+            const vector<uint8_t>& block_contents =
+                contents[static_cast<size_t>(i)];
+            block_contents_py = PyBytes_FromStringAndSize(
+                reinterpret_cast<const char*>(block_contents.data()),
+                static_cast<Py_ssize_t>(block_contents.size()));
+        } else {
+            Py_INCREF(Py_None);
+            block_contents_py = Py_None;
+        }
+        PyList_SetItem(result, i, block_contents_py);
+    }
+
+    return result;
+}
+
+
+/**
+ * Parse the buffer_metadata dict given to oid_plot_buffer(s)
+ *
+ * @return false (with a Python exception set) if the metadata is invalid
+ */
+static bool get_buffer_plot(PyObject* buffer_metadata, BufferPlot& plot)
+{
     if (!PyDict_Check(buffer_metadata)) {
         RAISE_PY_EXCEPTION(PyExc_TypeError,
                            "Invalid object given to plot_buffer (was expecting"
                            " a dict).");
-        return;
+        return false;
     }
 
     /*
@@ -518,42 +2032,176 @@ void oid_plot_buffer(AppHandler handler, PyObject* buffer_metadata)
         PyDict_GetItemString(buffer_metadata, "transpose_buffer");
     bool transpose_buffer = false;
     if (py_transpose_buffer != nullptr) {
-        CHECK_FIELD_TYPE(transpose_buffer, PyBool_Check, "transpose_buffer");
+        CHECK_FIELD_TYPE_RET(
+            transpose_buffer, PyBool_Check, "transpose_buffer", false);
         transpose_buffer = PyObject_IsTrue(py_transpose_buffer);
     }
 
+    PyObject* py_planar = PyDict_GetItemString(buffer_metadata, "planar");
+    bool planar         = false;
+    if (py_planar != nullptr) {
+        CHECK_FIELD_TYPE_RET(planar, PyBool_Check, "plot_buffer", false);
+        planar = PyObject_IsTrue(py_planar);
+    }
+
+    PyObject* py_batch = PyDict_GetItemString(buffer_metadata, "batch");
+    int batch          = 1;
+    if (py_batch != nullptr) {
+        CHECK_FIELD_TYPE_RET(batch, PY_INT_CHECK_FUNC, "plot_buffer", false);
+        batch = static_cast<int>(get_py_int(py_batch));
+    }
+
+    PyObject* py_batch_index =
+        PyDict_GetItemString(buffer_metadata, "batch_index");
+    int batch_index = -1;
+    if (py_batch_index != nullptr) {
+        CHECK_FIELD_TYPE_RET(
+            batch_index, PY_INT_CHECK_FUNC, "plot_buffer", false);
+        batch_index = static_cast<int>(get_py_int(py_batch_index));
+    }
+
+    if (batch < 1 || batch_index >= batch || (batch > 1 && !planar)) {
+        RAISE_PY_EXCEPTION(PyExc_ValueError,
+                           "Invalid batch given to plot_buffer (batches must"
+                           " be planar, and batch_index one of their"
+                           " images).");
+        return false;
+    }
+
     /*
      * Check if expected fields were provided
      */
-    CHECK_FIELD_PROVIDED(variable_name, "plot_buffer");
-    CHECK_FIELD_PROVIDED(display_name, "plot_buffer");
-    CHECK_FIELD_PROVIDED(pointer, "plot_buffer");
-    CHECK_FIELD_PROVIDED(width, "plot_buffer");
-    CHECK_FIELD_PROVIDED(height, "plot_buffer");
-    CHECK_FIELD_PROVIDED(channels, "plot_buffer");
-    CHECK_FIELD_PROVIDED(type, "plot_buffer");
-    CHECK_FIELD_PROVIDED(row_stride, "plot_buffer");
-    CHECK_FIELD_PROVIDED(pixel_layout, "plot_buffer");
+    CHECK_FIELD_PROVIDED_RET(variable_name, "plot_buffer", false);
+    CHECK_FIELD_PROVIDED_RET(display_name, "plot_buffer", false);
+    CHECK_FIELD_PROVIDED_RET(pointer, "plot_buffer", false);
+    CHECK_FIELD_PROVIDED_RET(width, "plot_buffer", false);
+    CHECK_FIELD_PROVIDED_RET(height, "plot_buffer", false);
+    CHECK_FIELD_PROVIDED_RET(channels, "plot_buffer", false);
+    CHECK_FIELD_PROVIDED_RET(type, "plot_buffer", false);
+    CHECK_FIELD_PROVIDED_RET(row_stride, "plot_buffer", false);
+    CHECK_FIELD_PROVIDED_RET(pixel_layout, "plot_buffer", false);
 
     /*
      * Check if expected fields have the correct types
      */
-    CHECK_FIELD_TYPE(variable_name, check_py_string_type, "plot_buffer");
-    CHECK_FIELD_TYPE(display_name, check_py_string_type, "plot_buffer");
-    CHECK_FIELD_TYPE(width, PY_INT_CHECK_FUNC, "plot_buffer");
-    CHECK_FIELD_TYPE(height, PY_INT_CHECK_FUNC, "plot_buffer");
-    CHECK_FIELD_TYPE(channels, PY_INT_CHECK_FUNC, "plot_buffer");
-    CHECK_FIELD_TYPE(type, PY_INT_CHECK_FUNC, "plot_buffer");
-    CHECK_FIELD_TYPE(row_stride, PY_INT_CHECK_FUNC, "plot_buffer");
-    CHECK_FIELD_TYPE(pixel_layout, check_py_string_type, "plot_buffer");
+    CHECK_FIELD_TYPE_RET(
+        variable_name, check_py_string_type, "plot_buffer", false);
+    CHECK_FIELD_TYPE_RET(
+        display_name, check_py_string_type, "plot_buffer", false);
+    CHECK_FIELD_TYPE_RET(width, PY_INT_CHECK_FUNC, "plot_buffer", false);
+    CHECK_FIELD_TYPE_RET(height, PY_INT_CHECK_FUNC, "plot_buffer", false);
+    CHECK_FIELD_TYPE_RET(channels, PY_INT_CHECK_FUNC, "plot_buffer", false);
+    CHECK_FIELD_TYPE_RET(type, PY_INT_CHECK_FUNC, "plot_buffer", false);
+    CHECK_FIELD_TYPE_RET(row_stride, PY_INT_CHECK_FUNC, "plot_buffer", false);
+    CHECK_FIELD_TYPE_RET(
+        pixel_layout, check_py_string_type, "plot_buffer", false);
+
+    /*
+     * Read buffer info
+     */
+    string variable_name_str;
+    string display_name_str;
+    string pixel_layout_str;
+
+    copy_py_string(variable_name_str, py_variable_name);
+    copy_py_string(display_name_str, py_display_name);
+    copy_py_string(pixel_layout_str, py_pixel_layout);
+
+    auto buff_width    = static_cast<int>(get_py_int(py_width));
+    auto buff_height   = static_cast<int>(get_py_int(py_height));
+    auto buff_channels = static_cast<int>(get_py_int(py_channels));
+    auto buff_stride   = static_cast<int>(get_py_int(py_row_stride));
+
+    BufferType buff_type = static_cast<BufferType>(get_py_int(py_type));
+
+    plot.planar       = planar;
+    plot.image_width  = buff_width;
+    plot.image_height = buff_height;
+    plot.batch        = batch;
+    plot.batch_index  = batch_index;
+
+    // The images of a batch are displayed in a grid, about as many columns
+    // as rows
+    if (planar && batch_index < 0 && batch > 1) {
+        const int columns = static_cast<int>(
+            ceil(sqrt(static_cast<double>(batch))));
+        const int rows = (batch + columns - 1) / columns;
+
+        buff_width *= columns;
+        buff_height *= rows;
+    }
+
+    const size_t pixel_size =
+        static_cast<size_t>(buff_channels) * typesize(buff_type);
+    const size_t buff_length = static_cast<size_t>(buff_width) *
+                               static_cast<size_t>(buff_height) * pixel_size;
+
+    plot.variable_name    = variable_name_str;
+    plot.display_name     = display_name_str;
+    plot.pixel_layout     = pixel_layout_str;
+    plot.transpose_buffer = transpose_buffer;
+    plot.width            = buff_width;
+    plot.height           = buff_height;
+    plot.channels         = buff_channels;
+    plot.stride           = buff_stride;
+    plot.type             = buff_type;
+    plot.length           = buff_length;
+
+    PyObject* py_pid = PyDict_GetItemString(buffer_metadata, "pid");
+    plot.pid         = 0;
+    if (py_pid != nullptr) {
+        CHECK_FIELD_TYPE_RET(pid, PY_INT_CHECK_FUNC, "plot_buffer", false);
+        plot.pid = static_cast<uint64_t>(get_py_int(py_pid));
+    }
+
+    // Plots traced from the debugger scripts already have a request ID
+    PyObject* py_request_id =
+        PyDict_GetItemString(buffer_metadata, "request_id");
+    plot.request_id = 0;
+    if (py_request_id != nullptr) {
+        CHECK_FIELD_TYPE_RET(
+            request_id, PY_INT_CHECK_FUNC, "plot_buffer", false);
+        plot.request_id = static_cast<uint64_t>(get_py_int(py_request_id));
+    } else if (tracing_enabled()) {
+        plot.request_id = new_trace_request_id();
+    }
+
+    /*
+     * Lazy buffers are too large to be read up front: their pointer is the
+     * address of the buffer in the inferior, and its regions are read on
+     * demand
+     */
+    PyObject* py_lazy = PyDict_GetItemString(buffer_metadata, "lazy");
+    plot.lazy         = py_lazy != nullptr && PyObject_IsTrue(py_lazy);
+
+    // Regions are read from interleaved pixels, so planar buffers are always
+    // read (and interleaved) as a whole
+    plot.lazy = plot.lazy && !planar;
+
+    /*
+     * Buffers given by their address are read by the bridge, straight from
+     * the inferior memory when possible
+     */
+    if (plot.lazy || PyNumber_Check(py_pointer) != 0) {
+        CHECK_FIELD_TYPE_RET(pointer, PyNumber_Check, "plot_buffer", false);
+
+        plot.address = static_cast<uint64_t>(
+            PyLong_AsUnsignedLongLongMask(py_pointer));
+        plot.buffer         = nullptr;
+        plot.source_address = plot.address;
+
+        return true;
+    }
+
+    plot.address = 0;
 
 #if PY_MAJOR_VERSION == 2
     auto pybuffer_deleter = [](Py_buffer* buff) {
+        PyGILRAII py_gil_raii;
         PyBuffer_Release(buff);
         delete buff;
     };
-    std::unique_ptr<Py_buffer, decltype(pybuffer_deleter)> py_buff(
-        nullptr, pybuffer_deleter);
+    std::shared_ptr<Py_buffer> py_buff;
 #endif
 
     // Retrieve pointer to buffer
@@ -564,7 +2212,7 @@ void oid_plot_buffer(AppHandler handler, PyObject* buffer_metadata)
     }
 #if PY_MAJOR_VERSION == 2
     else if (PyBuffer_Check(py_pointer) != 0) {
-        py_buff.reset(new Py_buffer());
+        py_buff.reset(new Py_buffer(), pybuffer_deleter);
         PyObject_GetBuffer(py_pointer, py_buff.get(), PyBUF_SIMPLE);
         buff_ptr = reinterpret_cast<uint8_t*>(py_buff->buf);
     }
@@ -572,40 +2220,233 @@ void oid_plot_buffer(AppHandler handler, PyObject* buffer_metadata)
     else {
         RAISE_PY_EXCEPTION(PyExc_TypeError,
                            "Could not retrieve C pointer to provided buffer");
+        return false;
+    }
+
+    plot.source_address = reinterpret_cast<uintptr_t>(buff_ptr);
+
+    // The buffer is sent asynchronously, so it must outlive this call. The
+    // callback runs from within the bridge, which may have released the GIL.
+    function<void()> on_sent;
+
+    // The buffer object is pinned while it is packed without the GIL, since
+    // the other Python threads may drop the metadata referencing it
+    const bool is_packed = planar || buff_stride > buff_width;
+    if (is_packed) {
+        Py_INCREF(py_pointer);
+    }
+
+    if (planar) {
+        // Interleaved natively, so that the window receives the pixels as
+        // it expects them, without any copy through the debugger
+        const uint8_t* images =
+            buff_ptr + static_cast<size_t>(max(batch_index, 0)) *
+                           planar_image_length(plot, buff_stride);
+
+        auto packed_buffer = make_shared<vector<uint8_t>>(buff_length);
+        {
+            PyGILReleaseRAII py_gil_release_raii;
+            pack_planar_images(
+                plot, images, buff_stride, packed_buffer->data());
+        }
+
+        buff_ptr    = packed_buffer->data();
+        buff_stride = buff_width;
+        on_sent     = [packed_buffer]() {};
+    } else if (buff_stride > buff_width) {
+        // Strip the row padding (e.g. of a ROI of a larger image), so that
+        // only the visible pixels are sent to the UI
+        auto packed_buffer = make_shared<vector<uint8_t>>(buff_length);
+        {
+            PyGILReleaseRAII py_gil_release_raii;
+            pack_rows(buff_ptr,
+                      buff_width,
+                      buff_height,
+                      buff_stride,
+                      pixel_size,
+                      packed_buffer->data());
+        }
+
+        buff_ptr    = packed_buffer->data();
+        buff_stride = buff_width;
+        on_sent     = [packed_buffer]() {};
+    } else {
+        Py_INCREF(py_pointer);
+#if PY_MAJOR_VERSION == 2
+        on_sent = [py_pointer, py_buff]() {
+            PyGILRAII py_gil_raii;
+            Py_DECREF(py_pointer);
+        };
+#else
+        on_sent = [py_pointer]() {
+            PyGILRAII py_gil_raii;
+            Py_DECREF(py_pointer);
+        };
+#endif
+    }
+
+    if (is_packed) {
+        Py_DECREF(py_pointer);
+    }
+
+    plot.stride  = buff_stride;
+    plot.buffer  = buff_ptr;
+    plot.on_sent = on_sent;
+
+    return true;
+}
+
+
+void oid_plot_buffer(AppHandler handler, PyObject* buffer_metadata)
+{
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
+    PyGILRAII py_gil_raii;
+
+
+    OidBridge* app = static_cast<OidBridge*>(handler);
+
+    if (app == nullptr) {
+        RAISE_PY_EXCEPTION(PyExc_RuntimeError,
+                           "oid_plot_buffer received null application handler");
         return;
     }
 
-    /*
-     * Send buffer contents
-     */
-    string variable_name_str;
-    string display_name_str;
-    string pixel_layout_str;
+    const double begin_us = trace_now_us();
 
-    copy_py_string(variable_name_str, py_variable_name);
-    copy_py_string(display_name_str, py_display_name);
-    copy_py_string(pixel_layout_str, py_pixel_layout);
+    vector<BufferPlot> plots(1);
+    if (!get_buffer_plot(buffer_metadata, plots[0])) {
+        return;
+    }
 
-    auto buff_width    = static_cast<int>(get_py_int(py_width));
-    auto buff_height   = static_cast<int>(get_py_int(py_height));
-    auto buff_channels = static_cast<int>(get_py_int(py_channels));
-    auto buff_stride   = static_cast<int>(get_py_int(py_row_stride));
+    trace_event("get_buffer_plot",
+                plots[0].request_id,
+                begin_us,
+                trace_now_us(),
+                plots[0].variable_name);
 
-    BufferType buff_type = static_cast<BufferType>(get_py_int(py_type));
+    app->plot_buffers(plots);
+}
+
+
+void oid_plot_buffers(AppHandler handler, PyObject* buffer_metadata_list)
+{
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
+    PyGILRAII py_gil_raii;
+
+
+    OidBridge* app = static_cast<OidBridge*>(handler);
+
+    if (app == nullptr) {
+        RAISE_PY_EXCEPTION(
+            PyExc_RuntimeError,
+            "oid_plot_buffers received null application handler");
+        return;
+    }
+
+    if (!PyList_Check(buffer_metadata_list)) {
+        RAISE_PY_EXCEPTION(PyExc_TypeError,
+                           "Invalid object given to plot_buffers (was"
+                           " expecting a list).");
+        return;
+    }
+
+    const Py_ssize_t num_buffers = PyList_Size(buffer_metadata_list);
+
+    vector<BufferPlot> plots(static_cast<size_t>(num_buffers));
+    for (Py_ssize_t i = 0; i < num_buffers; ++i) {
+        const double begin_us = trace_now_us();
+
+        if (!get_buffer_plot(PyList_GetItem(buffer_metadata_list, i),
+                             plots[static_cast<size_t>(i)])) {
+            // Release the buffers retained by the previous entries
+            for (Py_ssize_t j = 0; j < i; ++j) {
+                if (plots[static_cast<size_t>(j)].on_sent) {
+                    plots[static_cast<size_t>(j)].on_sent();
+                }
+            }
+            return;
+        }
+
+        trace_event("get_buffer_plot",
+                    plots[static_cast<size_t>(i)].request_id,
+                    begin_us,
+                    trace_now_us(),
+                    plots[static_cast<size_t>(i)].variable_name);
+    }
+
+    app->plot_buffers(plots);
+}
+
+
+void oid_plot_live_buffers(AppHandler handler, PyObject* buffer_metadata_list)
+{
+    lock_guard<recursive_mutex> bridge_lock(bridge_call_mutex());
+    PyGILRAII py_gil_raii;
 
-    size_t buff_length =
-        static_cast<size_t>(buff_width * buff_height * buff_channels) *
-        typesize(buff_type);
-
-    app->plot_buffer(variable_name_str,
-                     display_name_str,
-                     pixel_layout_str,
-                     transpose_buffer,
-                     buff_width,
-                     buff_height,
-                     buff_channels,
-                     buff_stride,
-                     buff_type,
-                     buff_ptr,
-                     buff_length);
+
+    OidBridge* app = static_cast<OidBridge*>(handler);
+
+    if (app == nullptr) {
+        RAISE_PY_EXCEPTION(
+            PyExc_RuntimeError,
+            "oid_plot_live_buffers received null application handler");
+        return;
+    }
+
+    if (!PyList_Check(buffer_metadata_list)) {
+        RAISE_PY_EXCEPTION(PyExc_TypeError,
+                           "Invalid object given to plot_live_buffers (was"
+                           " expecting a list).");
+        return;
+    }
+
+    const Py_ssize_t num_buffers = PyList_Size(buffer_metadata_list);
+
+    vector<BufferPlot> plots(static_cast<size_t>(num_buffers));
+    for (Py_ssize_t i = 0; i < num_buffers; ++i) {
+        if (!get_buffer_plot(PyList_GetItem(buffer_metadata_list, i),
+                             plots[static_cast<size_t>(i)])) {
+            // Release the buffers retained by the previous entries
+            for (Py_ssize_t j = 0; j < i; ++j) {
+                if (plots[static_cast<size_t>(j)].on_sent) {
+                    plots[static_cast<size_t>(j)].on_sent();
+                }
+            }
+            return;
+        }
+    }
+
+    app->plot_live_buffers(plots);
+}
+
+
+int oid_trace_enabled()
+{
+    return tracing_enabled() ? 1 : 0;
+}
+
+
+unsigned long long oid_new_trace_request_id()
+{
+    return new_trace_request_id();
+}
+
+
+double oid_trace_now_us()
+{
+    return trace_now_us();
+}
+
+
+void oid_trace_event(const char* name,
+                     unsigned long long request_id,
+                     double begin_us,
+                     double end_us,
+                     const char* buffer_name)
+{
+    trace_event(name,
+                request_id,
+                begin_us,
+                end_us,
+                buffer_name != nullptr ? buffer_name : "");
 }
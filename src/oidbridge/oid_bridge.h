@@ -53,6 +53,9 @@ typedef void* AppHandler;
  *     a symbol name from the OpenImageDebugger window
  * @param optional_parameters  Dictionary with the following optional members:
  *   - oid_path  Path where the plugin is located
+ *   - read_memory  Callable (address, length) returning a buffer with the
+ *     contents of the inferior memory at address; used to read the regions
+ *     of lazy buffers
  * @return  Application context
  */
 OID_API
@@ -122,12 +125,57 @@ void oid_set_available_symbols(AppHandler handler,
  * Process pending events related to communication with UI
  *
  * Must be called in order for requests from the UI to reach the debugger
- * bridge.
+ * bridge: whenever the socket returned by oid_get_socket_descriptor() is
+ * ready for reading, and again right away while it returns true.
  *
  * @param handler  Window handler, generated by oid_initialize()
+ * @return true if there is still work pending (e.g. buffers being sent)
  */
 OID_API
-void oid_run_event_loop(AppHandler handler);
+int oid_run_event_loop(AppHandler handler);
+
+
+/**
+ * Notify that the inferior stopped again, before its buffers are replotted
+ *
+ * The buffers queued for plotting during the previous stops which have not
+ * started being sent yet are dropped, as are the regions of lazy buffers
+ * requested by the window before it learns about the new stop.
+ *
+ * @param handler  Window handler, generated by oid_initialize()
+ * @return  Number of the new stop generation
+ */
+OID_API
+int oid_begin_stop_generation(AppHandler handler);
+
+
+/**
+ * Get the descriptor of the socket connected to the UI, so that the caller
+ * can wait for its messages (e.g. with select) before calling
+ * oid_run_event_loop()
+ *
+ * @param handler  Window handler, generated by oid_initialize()
+ * @return -1 if the UI is not connected
+ */
+OID_API
+long long oid_get_socket_descriptor(AppHandler handler);
+
+
+/**
+ * Read several small blocks of the memory of a local inferior at once, e.g.
+ * the headers of the objects describing buffers, with as few system calls as
+ * possible
+ *
+ * @param handler  Window handler, generated by oid_initialize()
+ * @param pid  Id of the inferior process, which must run on this machine
+ * @param blocks  Python list of (address, length) tuples
+ * @return  Python list with the contents (bytes) of each block, or None for
+ *     the blocks which couldn't be read
+ */
+OID_API
+PyObject* oid_read_memory_blocks(AppHandler handler,
+                                 unsigned long long pid,
+                                 PyObject* blocks);
 
 
 /**
@@ -135,7 +183,9 @@ void oid_run_event_loop(AppHandler handler);
  *
  * @param handler  Handler of the window where the buffer should be plotted
  * @param buffer_metadata  Python dictionary with the following elements:
- *     - [pointer     ] PyMemoryView object wrapping the target buffer
+ *     - [pointer     ] PyMemoryView object wrapping the target buffer, or
+ *                      address (int) of the buffer in the inferior, which
+ *                      is then read by the bridge
  *     - [display_name] Variable name as it shall be displayed
  *     - [width       ] Buffer width, in pixels
  *     - [height      ] Buffer height, in pixels
@@ -143,10 +193,92 @@ void oid_run_event_loop(AppHandler handler);
  *     - [type        ] Buffer type (see symbols.py for details)
  *     - [row_stride  ] Row stride, in pixels
  *     - [pixel_layout] String defining pixel channel layout (e.g. 'rgba')
+ *     - [lazy        ] Optional; if True, pointer is the address of the
+ *                      buffer in the inferior, and only the regions the
+ *                      window displays are read (with read_memory)
+ *     - [pid         ] Optional; id of the inferior process. If given, its
+ *                      memory is read directly instead of with read_memory
+ *     - [request_id  ] Optional; request ID of the plot in the traces (see
+ *                      oid_trace_event())
  * */
 OID_API
 void oid_plot_buffer(AppHandler handler, PyObject* bufffer_metadata);
 
+/**
+ * Add several buffers to the plot list at once
+ *
+ * All buffers are sent in a single message, and are updated together by the
+ * window.
+ *
+ * @param handler  Handler of the window where the buffers should be plotted
+ * @param buffer_metadata_list  Python list of dictionaries, each with the
+ *     same elements as the buffer_metadata parameter of oid_plot_buffer()
+ * */
+OID_API
+void oid_plot_buffers(AppHandler handler, PyObject* buffer_metadata_list);
+
+/**
+ * Plot buffers from a live breakpoint, which lets the inferior run on as soon
+ * as this returns
+ *
+ * The buffers are read before returning, and sent to the window in the
+ * background. Frames of a buffer which have not started being sent when a
+ * newer one is plotted are dropped, so that the window receives the latest
+ * frame of each buffer when it falls behind.
+ *
+ * @param handler  Handler of the window where the buffers should be plotted
+ * @param buffer_metadata_list  Python list of dictionaries, each with the
+ *     same elements as the buffer_metadata parameter of oid_plot_buffer().
+ *     Lazy buffers are read as a whole.
+ * */
+OID_API
+void oid_plot_live_buffers(AppHandler handler,
+                           PyObject* buffer_metadata_list);
+
+
+/**
+ * Check if the plots are traced, i.e. if the OID_TRACE_DIR environment
+ * variable was set when oid_initialize() was called
+ *
+ * @return  1 if the plots are traced, 0 otherwise
+ */
+OID_API
+int oid_trace_enabled();
+
+/**
+ * Get a new request ID, which correlates the trace events of a plot in the
+ * debugger scripts, the bridge and the window
+ *
+ * @return  Request ID, unique within the debugger process
+ */
+OID_API
+unsigned long long oid_new_trace_request_id();
+
+/**
+ * Get the current time on the clock of the trace events
+ *
+ * @return  Time in microseconds
+ */
+OID_API
+double oid_trace_now_us();
+
+/**
+ * Write an event to the trace of the debugger process, if the plots are
+ * traced. Events of the debugger scripts share the trace file of the bridge.
+ *
+ * @param name  Name of the traced step
+ * @param request_id  Request ID of the plot, or 0
+ * @param begin_us  Start of the step, given by oid_trace_now_us()
+ * @param end_us  End of the step, given by oid_trace_now_us()
+ * @param buffer_name  Name of the plotted buffer, or an empty string
+ */
+OID_API
+void oid_trace_event(const char* name,
+                     unsigned long long request_id,
+                     double begin_us,
+                     double end_us,
+                     const char* buffer_name);
+
 #ifdef __cplusplus
 }
 #endif
@@ -24,10 +24,23 @@
 cmake_minimum_required(VERSION 3.10.0)
 
 add_library(${PROJECT_NAME} SHARED
+            ../buffer_capture.cpp
+            ../inferior_buffer_fetcher.cpp
             ../oid_bridge.cpp
+            ../plot_request_scheduler.cpp
             ../../debuggerinterface/python_native_interface.cpp
+            ../../ipc/buffer_plot_composer.cpp
             ../../ipc/message_exchange.cpp
             ../../ipc/raw_data_decode.cpp
+            ../../ipc/row_packer.cpp
+            ../../ipc/shared_buffer.cpp
+            ../../ipc/tile_delta.cpp
+            ../../ipc/trace_events.cpp
+            ../../ipc/window_daemon.cpp
+            ../../system/memory/inferior_memory.cpp
+            $<$<PLATFORM_ID:Linux>:../../system/memory/inferior_memory_linux.cpp>
+            $<$<PLATFORM_ID:Darwin>:../../system/memory/inferior_memory_macos.cpp>
+            $<$<BOOL:${WIN32}>:../../system/memory/inferior_memory_win32.cpp>
             ../../system/process/process.cpp
             $<$<BOOL:${UNIX}>:../../system/process/process_unix.cpp>
             $<$<BOOL:${WIN32}>:../../system/process/process_win32.cpp>)
@@ -0,0 +1,103 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "plot_request_scheduler.h"
+
+#include <algorithm>
+
+
+using namespace std;
+
+
+void PlotRequestScheduler::push(const string& buffer_name)
+{
+    if (queued_buffers_.insert(buffer_name).second) {
+        queue_.push_back(buffer_name);
+    }
+}
+
+
+bool PlotRequestScheduler::empty() const
+{
+    return queue_.empty();
+}
+
+
+string PlotRequestScheduler::pop()
+{
+    // The queue is short, so it is simply searched for the first entry with
+    // the highest priority
+    auto next_buffer =
+        min_element(queue_.begin(),
+                    queue_.end(),
+                    [this](const string& a, const string& b) {
+                        return get_priority(a) < get_priority(b);
+                    });
+
+    string buffer_name = *next_buffer;
+    queue_.erase(next_buffer);
+    queued_buffers_.erase(buffer_name);
+
+    return buffer_name;
+}
+
+
+void PlotRequestScheduler::set_priorities(
+    const string& selected_buffer,
+    const deque<string>& visible_buffers)
+{
+    selected_buffer_ = selected_buffer;
+    visible_buffers_ = set<string>(visible_buffers.begin(),
+                                   visible_buffers.end());
+}
+
+
+bool PlotRequestScheduler::is_selected(const string& buffer_name) const
+{
+    return !selected_buffer_.empty() && buffer_name == selected_buffer_;
+}
+
+
+void PlotRequestScheduler::sort_by_priority(deque<string>& buffer_names) const
+{
+    stable_sort(buffer_names.begin(),
+                buffer_names.end(),
+                [this](const string& a, const string& b) {
+                    return get_priority(a) < get_priority(b);
+                });
+}
+
+
+PlotRequestScheduler::Priority
+PlotRequestScheduler::get_priority(const string& buffer_name) const
+{
+    if (is_selected(buffer_name)) {
+        return Priority::Selected;
+    } else if (visible_buffers_.find(buffer_name) != visible_buffers_.end()) {
+        return Priority::Visible;
+    } else {
+        return Priority::Other;
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PLOT_REQUEST_SCHEDULER_H_
+#define PLOT_REQUEST_SCHEDULER_H_
+
+#include <deque>
+#include <set>
+#include <string>
+
+
+/*
+ * Queue of the buffers the window asked to be plotted. A buffer is queued
+ * at most once, and buffers are handed out in order of priority: first the
+ * one selected in the window, then the ones whose thumbnails are visible,
+ * then all others in the order they were requested.
+ */
+class PlotRequestScheduler
+{
+  public:
+    // Queue buffer_name, unless it is queued already
+    void push(const std::string& buffer_name);
+
+    bool empty() const;
+
+    // Remove and return the buffer with the highest priority
+    std::string pop();
+
+    void set_priorities(const std::string& selected_buffer,
+                        const std::deque<std::string>& visible_buffers);
+
+    bool is_selected(const std::string& buffer_name) const;
+
+    // Stable sort of buffer_names by priority
+    void sort_by_priority(std::deque<std::string>& buffer_names) const;
+
+  private:
+    enum class Priority { Selected = 0, Visible = 1, Other = 2 };
+
+    Priority get_priority(const std::string& buffer_name) const;
+
+    std::deque<std::string> queue_;
+    std::set<std::string> queued_buffers_;
+
+    std::string selected_buffer_;
+    std::set<std::string> visible_buffers_;
+};
+
+
+#endif // PLOT_REQUEST_SCHEDULER_H_
@@ -0,0 +1,514 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "oid_client.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QTcpSocket>
+
+#include "ipc/buffer_plot_composer.h"
+#include "ipc/message_exchange.h"
+#include "ipc/row_packer.h"
+#include "ipc/window_daemon.h"
+
+
+using namespace std;
+
+
+namespace
+{
+
+// How long to wait for an advertised window daemon to accept the client
+const int window_daemon_connect_timeout_ms = 1000;
+
+// The window daemon is looked for again this often while it isn't running
+const chrono::milliseconds reconnect_interval(1000);
+
+// How often the sender looks for messages from the window while idle
+const chrono::milliseconds idle_poll_interval(10);
+
+const double default_max_frame_rate = 30.0;
+
+
+// Frames of a published buffer. At most one of them is being sent, and one
+// waits for it to be handed to the socket; newer frames replace the waiting
+// one.
+struct PublishedBuffer
+{
+    BufferPlotContents waiting_frame;
+    vector<uint8_t> waiting_contents;
+    bool has_waiting_frame = false;
+    bool is_sending        = false;
+
+    // Storage of a sent or replaced frame, reused by the next one
+    vector<uint8_t> spare_contents;
+
+    bool was_taken = false;
+    chrono::steady_clock::time_point last_taken;
+};
+
+
+class OidClient
+{
+  public:
+    explicit OidClient(double max_frame_rate);
+
+    ~OidClient();
+
+    bool publish(const string& name,
+                 const uint8_t* buffer,
+                 int width,
+                 int height,
+                 int channels,
+                 BufferType type,
+                 int row_stride,
+                 const string& pixel_layout);
+
+    void set_max_frame_rate(double frames_per_second);
+
+  private:
+    // Shared with the publishing threads
+    mutex mutex_;
+    condition_variable frame_published_;
+    bool stopping_;
+    map<string, PublishedBuffer> buffers_;
+    chrono::steady_clock::duration min_frame_interval_;
+
+    // Only used by the sender thread, which owns the socket
+    unique_ptr<QTcpSocket> socket_;
+    MessageSendQueue send_queue_;
+    BufferPlotComposer plot_composer_;
+    CompressionMode compression_mode_;
+    bool shared_memory_enabled_;
+
+    thread sender_;
+
+    void run_sender();
+
+    bool connect_to_window_daemon();
+
+    // Must be called with mutex_ held
+    bool has_frames_to_send() const;
+
+    void send_waiting_frames();
+
+    void read_incoming_messages();
+};
+
+
+OidClient::OidClient(double max_frame_rate)
+    : stopping_{false}
+    , min_frame_interval_{}
+    , plot_composer_{"OpenImageDebugger/" +
+                     to_string(QCoreApplication::applicationPid()) +
+                     "/client/"}
+    , compression_mode_{CompressionMode::None}
+    , shared_memory_enabled_{true}
+{
+    set_max_frame_rate(max_frame_rate);
+    sender_ = thread(&OidClient::run_sender, this);
+}
+
+
+OidClient::~OidClient()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    frame_published_.notify_one();
+
+    sender_.join();
+}
+
+
+bool OidClient::publish(const string& name,
+                        const uint8_t* buffer,
+                        int width,
+                        int height,
+                        int channels,
+                        BufferType type,
+                        int row_stride,
+                        const string& pixel_layout)
+{
+    const auto now = chrono::steady_clock::now();
+
+    // Dropped frames cost no more than this lookup
+    vector<uint8_t> contents;
+    {
+        lock_guard<mutex> lock(mutex_);
+        PublishedBuffer& published = buffers_[name];
+        if (published.was_taken &&
+            now - published.last_taken < min_frame_interval_) {
+            return false;
+        }
+
+        published.was_taken  = true;
+        published.last_taken = now;
+        contents             = std::move(published.spare_contents);
+    }
+
+    // Copied without holding the lock, so that the sender carries on
+    const size_t pixel_size =
+        static_cast<size_t>(channels) * typesize(type);
+    contents.resize(static_cast<size_t>(width) *
+                    static_cast<size_t>(height) * pixel_size);
+    pack_rows(buffer, width, height, row_stride, pixel_size, contents.data());
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        PublishedBuffer& published = buffers_[name];
+        if (published.has_waiting_frame) {
+            // Not sent in time; replaced by the newer frame
+            published.spare_contents = std::move(published.waiting_contents);
+        }
+
+        BufferPlotContents& frame = published.waiting_frame;
+        frame.variable_name       = name;
+        frame.display_name        = name;
+        frame.pixel_layout        = pixel_layout;
+        frame.transpose_buffer    = false;
+        frame.width               = width;
+        frame.height              = height;
+        frame.channels            = channels;
+        frame.stride              = width;
+        frame.type                = type;
+        frame.buffer              = nullptr;
+        frame.length              = contents.size();
+
+        published.waiting_contents  = std::move(contents);
+        published.has_waiting_frame = true;
+    }
+
+    frame_published_.notify_one();
+    return true;
+}
+
+
+void OidClient::set_max_frame_rate(double frames_per_second)
+{
+    lock_guard<mutex> lock(mutex_);
+
+    if (frames_per_second > 0.0) {
+        min_frame_interval_ =
+            chrono::duration_cast<chrono::steady_clock::duration>(
+                chrono::duration<double>(1.0 / frames_per_second));
+    } else {
+        min_frame_interval_ = chrono::steady_clock::duration::zero();
+    }
+}
+
+
+void OidClient::run_sender()
+{
+    socket_.reset(new QTcpSocket());
+    send_queue_.set_socket(socket_.get());
+
+    unique_lock<mutex> lock(mutex_);
+    while (!stopping_) {
+        if (socket_->state() != QAbstractSocket::ConnectedState) {
+            lock.unlock();
+
+            // Whatever the previous window had is gone along with it. The
+            // callbacks of the dropped frames take the lock themselves.
+            send_queue_.clear();
+            plot_composer_.clear();
+            compression_mode_      = CompressionMode::None;
+            shared_memory_enabled_ = true;
+
+            const bool is_connected = connect_to_window_daemon();
+
+            lock.lock();
+            if (!is_connected) {
+                frame_published_.wait_for(
+                    lock, reconnect_interval, [this]() { return stopping_; });
+            }
+            continue;
+        }
+
+        lock.unlock();
+
+        read_incoming_messages();
+        send_waiting_frames();
+
+        // Only as much as the socket takes without blocking; the frames
+        // published meanwhile wait, and replace each other
+        if (!send_queue_.empty()) {
+            socket_->waitForBytesWritten(
+                static_cast<int>(idle_poll_interval.count()));
+            send_queue_.pump();
+        }
+
+        lock.lock();
+        if (send_queue_.empty() && !has_frames_to_send()) {
+            frame_published_.wait_for(lock, idle_poll_interval);
+        }
+    }
+    lock.unlock();
+
+    // The frames published before stopping still make it to the window
+    if (socket_->state() == QAbstractSocket::ConnectedState) {
+        send_waiting_frames();
+        send_queue_.flush();
+    }
+
+    send_queue_.clear();
+    send_queue_.set_socket(nullptr);
+    plot_composer_.clear();
+    socket_.reset();
+}
+
+
+bool OidClient::connect_to_window_daemon()
+{
+    uint16_t daemon_port;
+    if (!find_window_daemon(daemon_port)) {
+        return false;
+    }
+
+    socket_->abort();
+    socket_->connectToHost(QHostAddress::LocalHost, daemon_port);
+    if (!socket_->waitForConnected(window_daemon_connect_timeout_ms)) {
+        // The daemon exited without withdrawing its port
+        socket_->abort();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool OidClient::has_frames_to_send() const
+{
+    for (const auto& entry : buffers_) {
+        if (entry.second.has_waiting_frame && !entry.second.is_sending) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void OidClient::send_waiting_frames()
+{
+    struct Frame
+    {
+        BufferPlotContents plot;
+        shared_ptr<vector<uint8_t>> contents;
+    };
+
+    vector<Frame> frames;
+    {
+        lock_guard<mutex> lock(mutex_);
+        for (auto& entry : buffers_) {
+            PublishedBuffer& published = entry.second;
+            if (!published.has_waiting_frame || published.is_sending) {
+                continue;
+            }
+
+            Frame frame;
+            frame.plot     = published.waiting_frame;
+            frame.contents = make_shared<vector<uint8_t>>(
+                std::move(published.waiting_contents));
+            frame.plot.buffer = frame.contents->data();
+
+            published.waiting_contents  = vector<uint8_t>();
+            published.has_waiting_frame = false;
+            published.is_sending        = true;
+
+            frames.push_back(std::move(frame));
+        }
+    }
+
+    for (auto& frame : frames) {
+        MessageComposer message_composer;
+        message_composer.set_compression(compression_mode_);
+
+        // The window runs on this machine, since it is a daemon of this user
+        plot_composer_.compose(
+            message_composer, frame.plot, shared_memory_enabled_);
+
+        const string name                          = frame.plot.variable_name;
+        const shared_ptr<vector<uint8_t>> contents = frame.contents;
+        message_composer.send_async(send_queue_, [this, name, contents]() {
+            lock_guard<mutex> lock(mutex_);
+            PublishedBuffer& published = buffers_[name];
+            published.is_sending       = false;
+            if (published.spare_contents.empty()) {
+                published.spare_contents = std::move(*contents);
+            }
+        });
+    }
+}
+
+
+void OidClient::read_incoming_messages()
+{
+    do {
+        socket_->waitForReadyRead(0);
+
+        if (socket_->bytesAvailable() == 0) {
+            break;
+        }
+
+        MessageHeader header;
+        MessageDecoder(socket_.get()).read(header);
+
+        if (header.version != message_protocol_version) {
+            MessageDecoder(socket_.get()).skip(header.length);
+            continue;
+        }
+
+        switch (header.type) {
+        case MessageType::SetCompressionMode:
+            MessageDecoder(socket_.get()).read(compression_mode_);
+            break;
+        case MessageType::SharedMemoryUnavailable:
+            // The window could not read the buffer from shared memory, so the
+            // next frames are sent through the socket
+            shared_memory_enabled_ = false;
+            plot_composer_.shared_buffers().clear();
+            MessageDecoder(socket_.get()).skip(header.length);
+            break;
+        case MessageType::InvalidateBufferCache: {
+            string buffer_name;
+            MessageDecoder(socket_.get()).read(buffer_name);
+            plot_composer_.tile_hashes().invalidate(buffer_name);
+            break;
+        }
+        default:
+            // Requests meant for debugger bridges (e.g. to plot a symbol)
+            // have no answer here
+            MessageDecoder(socket_.get()).skip(header.length);
+            break;
+        }
+    } while (socket_->bytesAvailable() > 0);
+}
+
+
+// Guards client_instance() and client_max_frame_rate()
+mutex& client_mutex()
+{
+    static mutex client_mutex;
+    return client_mutex;
+}
+
+
+// Started by the first publish(). Callers hold their own reference, so that
+// shutdown() waits for them before stopping it.
+shared_ptr<OidClient>& client_instance()
+{
+    static shared_ptr<OidClient> client;
+    return client;
+}
+
+
+double& client_max_frame_rate()
+{
+    static double max_frame_rate = default_max_frame_rate;
+    return max_frame_rate;
+}
+
+} // namespace
+
+
+namespace oid
+{
+
+bool publish(const string& name,
+             const void* buffer,
+             int width,
+             int height,
+             int channels,
+             BufferType type,
+             int row_stride,
+             const string& pixel_layout)
+{
+    if (buffer == nullptr || width <= 0 || height <= 0 || channels < 1 ||
+        channels > 4 || row_stride < width) {
+        cerr << "[OpenImageDebugger] Invalid buffer published as " << name
+             << endl;
+        return false;
+    }
+
+    shared_ptr<OidClient> client;
+    {
+        lock_guard<mutex> lock(client_mutex());
+        if (client_instance() == nullptr) {
+            client_instance() =
+                make_shared<OidClient>(client_max_frame_rate());
+        }
+        client = client_instance();
+    }
+
+    return client->publish(name,
+                           static_cast<const uint8_t*>(buffer),
+                           width,
+                           height,
+                           channels,
+                           type,
+                           row_stride,
+                           pixel_layout);
+}
+
+
+void set_max_frame_rate(double frames_per_second)
+{
+    lock_guard<mutex> lock(client_mutex());
+
+    client_max_frame_rate() = frames_per_second;
+    if (client_instance() != nullptr) {
+        client_instance()->set_max_frame_rate(frames_per_second);
+    }
+}
+
+
+void shutdown()
+{
+    shared_ptr<OidClient> client;
+    {
+        lock_guard<mutex> lock(client_mutex());
+        client = std::move(client_instance());
+        client_instance().reset();
+    }
+
+    // Sends the waiting frames once the last publish() returned
+    client.reset();
+}
+
+} // namespace oid
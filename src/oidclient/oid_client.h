@@ -0,0 +1,98 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef OID_CLIENT_H_
+#define OID_CLIENT_H_
+
+#include <string>
+
+#include "ipc/raw_data_decode.h"
+
+#ifndef OID_CLIENT_API
+#  if __GNUC__ >= 4
+#    define OID_CLIENT_API __attribute__((visibility("default")))
+#  else
+#    define OID_CLIENT_API
+#  endif
+#endif
+
+/*
+ * liboidclient streams buffers from the process which holds them to a running
+ * window daemon (oidwindow --daemon), without a debugger: e.g. the frames of
+ * a service which can't be stopped at a breakpoint. The buffers are sent by a
+ * background thread, which connects to the daemon as soon as it is running.
+ */
+namespace oid
+{
+
+/**
+ * Publish the contents of a buffer to the window, which displays them under
+ * name
+ *
+ * Returns as soon as the contents were copied; they are then sent in the
+ * background, through shared memory. Frames published faster than the
+ * maximum frame rate are dropped before being copied. If the window falls
+ * behind, the frame of the buffer which is still waiting to be sent is
+ * replaced by this one.
+ *
+ * @param name  Name of the buffer in the window
+ * @param buffer  First pixel of the buffer, whose channels are interleaved
+ * @param width  Buffer width, in pixels
+ * @param height  Buffer height, in pixels
+ * @param channels  Number of channels (1 to 4)
+ * @param type  Type of the channel values
+ * @param row_stride  Distance between the starts of two rows, in pixels
+ * @param pixel_layout  Order of the channels, e.g. "rgba" or "bgra"
+ * @return  false if the frame was dropped by the rate limit, or is invalid
+ */
+OID_CLIENT_API
+bool publish(const std::string& name,
+             const void* buffer,
+             int width,
+             int height,
+             int channels,
+             BufferType type,
+             int row_stride,
+             const std::string& pixel_layout);
+
+/**
+ * Set the largest number of frames of each buffer taken by publish() per
+ * second, 30 by default
+ *
+ * @param frames_per_second  Maximum frame rate; 0 lifts the limit
+ */
+OID_CLIENT_API
+void set_max_frame_rate(double frames_per_second);
+
+/**
+ * Send the frames waiting to be sent, if the window is connected, and stop
+ * the sender thread. Publishing again starts it over.
+ */
+OID_CLIENT_API
+void shutdown();
+
+} // namespace oid
+
+#endif // OID_CLIENT_H_
@@ -0,0 +1,200 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "inferior_memory.h"
+#include "inferior_memory_impl.h"
+
+using namespace std;
+
+namespace
+{
+
+// Below this size, spawning threads costs more than the read itself
+const size_t parallel_read_threshold = 8 << 20;
+
+const unsigned int max_read_threads = 8;
+
+
+unsigned int get_num_read_threads(size_t total_length, size_t max_parts)
+{
+    if (total_length < parallel_read_threshold) {
+        return 1;
+    }
+
+    unsigned int num_threads =
+        min(max(thread::hardware_concurrency(), 1u), max_read_threads);
+
+    return static_cast<unsigned int>(
+        min(static_cast<size_t>(num_threads), max(max_parts, size_t{1})));
+}
+
+} // namespace
+
+InferiorMemory::InferiorMemory()
+    : pid_(0)
+{
+    createImpl();
+}
+
+bool InferiorMemory::attach(uint64_t pid)
+{
+    if (pid == pid_) {
+        return true;
+    }
+
+    detach();
+
+    if (!impl_->attach(pid)) {
+        return false;
+    }
+
+    pid_ = pid;
+    return true;
+}
+
+void InferiorMemory::detach()
+{
+    if (pid_ != 0) {
+        impl_->detach();
+        pid_ = 0;
+    }
+}
+
+bool InferiorMemory::isAttached() const
+{
+    return pid_ != 0;
+}
+
+bool InferiorMemory::readRows(uint64_t address,
+                              size_t row_length,
+                              size_t row_stride,
+                              int height,
+                              uint8_t* dst)
+{
+    if (height <= 0) {
+        return true;
+    }
+
+    // Rows without padding are read as a single block
+    if (row_stride == row_length) {
+        return read(address, row_length * static_cast<size_t>(height), dst);
+    }
+
+    if (!isAttached()) {
+        return false;
+    }
+
+    const unsigned int num_threads = get_num_read_threads(
+        row_length * static_cast<size_t>(height), static_cast<size_t>(height));
+
+    auto read_row_range = [=](int first_row, int last_row, bool* success) {
+        for (int y = first_row; y < last_row; ++y) {
+            if (!impl_->read(address + static_cast<uint64_t>(y) * row_stride,
+                             row_length,
+                             dst + static_cast<size_t>(y) * row_length)) {
+                *success = false;
+                return;
+            }
+        }
+        *success = true;
+    };
+
+    vector<thread> workers;
+    // vector<bool> can't be written from several threads
+    unique_ptr<bool[]> results(new bool[num_threads]);
+    const int rows_per_thread = (height + num_threads - 1) / num_threads;
+
+    for (unsigned int i = 1; i < num_threads; ++i) {
+        const int first_row =
+            min(height, static_cast<int>(i) * rows_per_thread);
+        const int last_row  = min(height, first_row + rows_per_thread);
+        workers.emplace_back(read_row_range, first_row, last_row, &results[i]);
+    }
+    read_row_range(0, min(height, rows_per_thread), &results[0]);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return all_of(
+        results.get(), results.get() + num_threads, [](bool r) { return r; });
+}
+
+void InferiorMemory::readBlocks(vector<InferiorMemoryBlock>& blocks)
+{
+    if (!isAttached()) {
+        for (auto& block : blocks) {
+            block.success = false;
+        }
+        return;
+    }
+
+    impl_->readBlocks(blocks);
+}
+
+bool InferiorMemory::read(uint64_t address, size_t length, uint8_t* dst)
+{
+    if (!isAttached()) {
+        return false;
+    }
+
+    const size_t page_size = 4096;
+    const unsigned int num_threads =
+        get_num_read_threads(length, length / page_size);
+
+    if (num_threads == 1) {
+        return impl_->read(address, length, dst);
+    }
+
+    // Split the block in page aligned chunks, one per thread
+    const size_t chunk_length =
+        ((length / num_threads + page_size - 1) / page_size) * page_size;
+
+    auto read_chunk = [=](size_t offset, bool* success) {
+        const size_t chunk_end = min(length, offset + chunk_length);
+        *success =
+            offset >= chunk_end ||
+            impl_->read(address + offset, chunk_end - offset, dst + offset);
+    };
+
+    vector<thread> workers;
+    unique_ptr<bool[]> results(new bool[num_threads]);
+
+    for (unsigned int i = 1; i < num_threads; ++i) {
+        workers.emplace_back(read_chunk, i * chunk_length, &results[i]);
+    }
+    read_chunk(0, &results[0]);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return all_of(
+        results.get(), results.get() + num_threads, [](bool r) { return r; });
+}
@@ -0,0 +1,104 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SYSTEM_INFERIOR_MEMORY_H_
+#define SYSTEM_INFERIOR_MEMORY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class InferiorMemoryImpl;
+
+/**
+ * Block of the inferior memory to be read by InferiorMemory::readBlocks
+ */
+struct InferiorMemoryBlock {
+    std::uint64_t address;
+    std::size_t length;
+    std::uint8_t* dst;
+
+    // Set once the block was read
+    bool success;
+};
+
+/**
+ * Reads the memory of the debugged process directly, without going through
+ * the debugger API
+ */
+class InferiorMemory {
+public:
+    InferiorMemory();
+
+    /**
+     * Prepare to read the memory of the process pid. Does nothing if already
+     * attached to it.
+     * @return false if the memory of the process can't be read natively
+     */
+    bool attach(std::uint64_t pid);
+
+    void detach();
+
+    bool isAttached() const;
+
+    /**
+     * Read height rows of row_length bytes, spaced by row_stride bytes in the
+     * inferior starting at address, and write them contiguously to dst.
+     * Large reads are split across several threads.
+     * @return true if all rows were read
+     */
+    bool readRows(std::uint64_t address,
+                  std::size_t row_length,
+                  std::size_t row_stride,
+                  int height,
+                  std::uint8_t* dst);
+
+    /**
+     * Read length bytes at address in the inferior to dst
+     * @return true if all bytes were read
+     */
+    bool read(std::uint64_t address, std::size_t length, std::uint8_t* dst);
+
+    /**
+     * Read many small blocks (e.g. object headers) at once, with as few
+     * system calls as the platform allows. Sets the success flag of each
+     * block.
+     */
+    void readBlocks(std::vector<InferiorMemoryBlock>& blocks);
+
+private:
+    /**
+     * Initialize pimpl according to platform
+     */
+    void createImpl();
+
+    // pimpl idiom
+    std::shared_ptr<InferiorMemoryImpl> impl_;
+
+    std::uint64_t pid_;
+};
+
+#endif // #ifndef SYSTEM_INFERIOR_MEMORY_H_
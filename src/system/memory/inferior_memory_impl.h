@@ -0,0 +1,71 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SYSTEM_INFERIOR_MEMORY_IMPL_H_
+#define SYSTEM_INFERIOR_MEMORY_IMPL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "inferior_memory.h"
+
+/**
+ * Interface to the platform specific inferior memory readers
+ */
+class InferiorMemoryImpl {
+public:
+    virtual ~InferiorMemoryImpl() noexcept = default;
+
+    /**
+     * Open the process pid for reading
+     * @return false if its memory can't be read
+     */
+    virtual bool attach(std::uint64_t pid) = 0;
+
+    virtual void detach() = 0;
+
+    /**
+     * Read length bytes at address in the attached process to dst. May be
+     * called from several threads at once.
+     * @return true if all bytes were read
+     */
+    virtual bool read(std::uint64_t address,
+                      std::size_t length,
+                      std::uint8_t* dst) const = 0;
+
+    /**
+     * Read each of the blocks, and set their success flags. Platforms able to
+     * read several blocks in a single call should override it.
+     */
+    virtual void readBlocks(std::vector<InferiorMemoryBlock>& blocks) const
+    {
+        for (auto& block : blocks) {
+            block.success = read(block.address, block.length, block.dst);
+        }
+    }
+};
+
+#endif // #ifndef SYSTEM_INFERIOR_MEMORY_IMPL_H_
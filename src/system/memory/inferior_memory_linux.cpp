@@ -0,0 +1,140 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "inferior_memory.h"
+#include "inferior_memory_impl.h"
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+// Number of iovecs accepted by process_vm_readv (UIO_MAXIOV)
+const size_t max_read_iovecs = 1024;
+
+} // namespace
+
+class InferiorMemoryImplLinux final : public InferiorMemoryImpl
+{
+public:
+    InferiorMemoryImplLinux() = default;
+
+    bool attach(uint64_t pid) override
+    {
+        pid_ = static_cast<pid_t>(pid);
+        return pid_ != 0;
+    }
+
+    void detach() override
+    {
+        pid_ = 0;
+    }
+
+    bool read(uint64_t address, size_t length, uint8_t* dst) const override
+    {
+        // The kernel may read less than requested, e.g. at page boundaries
+        while (length > 0) {
+            iovec local_iov{dst, length};
+            iovec remote_iov{reinterpret_cast<void*>(address), length};
+
+            const ssize_t bytes_read =
+                process_vm_readv(pid_, &local_iov, 1, &remote_iov, 1, 0);
+            if (bytes_read <= 0) {
+                return false;
+            }
+
+            address += static_cast<uint64_t>(bytes_read);
+            dst += bytes_read;
+            length -= static_cast<size_t>(bytes_read);
+        }
+
+        return true;
+    }
+
+    void readBlocks(vector<InferiorMemoryBlock>& blocks) const override
+    {
+        vector<iovec> local_iovs;
+        vector<iovec> remote_iovs;
+
+        size_t first_block = 0;
+        while (first_block < blocks.size()) {
+            const size_t num_blocks =
+                min(blocks.size() - first_block, max_read_iovecs);
+
+            local_iovs.clear();
+            remote_iovs.clear();
+            for (size_t i = first_block; i < first_block + num_blocks; ++i) {
+                local_iovs.push_back({blocks[i].dst, blocks[i].length});
+                remote_iovs.push_back(
+                    {reinterpret_cast<void*>(blocks[i].address),
+                     blocks[i].length});
+            }
+
+            const ssize_t bytes_read = process_vm_readv(pid_,
+                                                        local_iovs.data(),
+                                                        num_blocks,
+                                                        remote_iovs.data(),
+                                                        num_blocks,
+                                                        0);
+
+            // The kernel stops at the first block it can't read completely
+            size_t remaining_bytes =
+                bytes_read > 0 ? static_cast<size_t>(bytes_read) : 0;
+            size_t block = first_block;
+            while (block < first_block + num_blocks &&
+                   remaining_bytes >= blocks[block].length) {
+                remaining_bytes -= blocks[block].length;
+                blocks[block].success = true;
+                ++block;
+            }
+
+            // Retry the block where it stopped on its own
+            if (block < first_block + num_blocks) {
+                InferiorMemoryBlock& failed_block = blocks[block];
+                failed_block.success              = read(failed_block.address,
+                                                failed_block.length,
+                                                failed_block.dst);
+                ++block;
+            }
+
+            first_block = block;
+        }
+    }
+
+private:
+    pid_t pid_{0};
+};
+
+void InferiorMemory::createImpl()
+{
+    impl_ = make_shared<InferiorMemoryImplLinux>();
+}
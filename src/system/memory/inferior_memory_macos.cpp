@@ -0,0 +1,84 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "inferior_memory.h"
+#include "inferior_memory_impl.h"
+
+#include <mach/mach.h>
+#include <mach/mach_vm.h>
+
+#include <memory>
+
+using namespace std;
+
+class InferiorMemoryImplMacos final : public InferiorMemoryImpl
+{
+public:
+    InferiorMemoryImplMacos() = default;
+
+    ~InferiorMemoryImplMacos() noexcept
+    {
+        detach();
+    }
+
+    bool attach(uint64_t pid) override
+    {
+        // Requires the same entitlements as the debugger itself
+        return task_for_pid(mach_task_self(),
+                            static_cast<int>(pid),
+                            &task_) == KERN_SUCCESS;
+    }
+
+    void detach() override
+    {
+        if (task_ != MACH_PORT_NULL) {
+            mach_port_deallocate(mach_task_self(), task_);
+            task_ = MACH_PORT_NULL;
+        }
+    }
+
+    bool read(uint64_t address, size_t length, uint8_t* dst) const override
+    {
+        // Unlike mach_vm_read, writes straight to dst instead of mapping new
+        // pages
+        mach_vm_size_t bytes_read = 0;
+        const kern_return_t result =
+            mach_vm_read_overwrite(task_,
+                                   address,
+                                   length,
+                                   reinterpret_cast<mach_vm_address_t>(dst),
+                                   &bytes_read);
+
+        return result == KERN_SUCCESS && bytes_read == length;
+    }
+
+private:
+    mach_port_t task_{MACH_PORT_NULL};
+};
+
+void InferiorMemory::createImpl()
+{
+    impl_ = make_shared<InferiorMemoryImplMacos>();
+}
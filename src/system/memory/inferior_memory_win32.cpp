@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "inferior_memory.h"
+#include "inferior_memory_impl.h"
+
+#include <windows.h>
+
+#include <memory>
+
+using namespace std;
+
+class InferiorMemoryImplWin32 final : public InferiorMemoryImpl
+{
+public:
+    InferiorMemoryImplWin32() = default;
+
+    ~InferiorMemoryImplWin32() noexcept
+    {
+        detach();
+    }
+
+    bool attach(uint64_t pid) override
+    {
+        process_ = OpenProcess(PROCESS_VM_READ,
+                               FALSE,
+                               static_cast<DWORD>(pid));
+        return process_ != nullptr;
+    }
+
+    void detach() override
+    {
+        if (process_ != nullptr) {
+            CloseHandle(process_);
+            process_ = nullptr;
+        }
+    }
+
+    bool read(uint64_t address, size_t length, uint8_t* dst) const override
+    {
+        SIZE_T bytes_read = 0;
+        const BOOL result =
+            ReadProcessMemory(process_,
+                              reinterpret_cast<LPCVOID>(address),
+                              dst,
+                              length,
+                              &bytes_read);
+
+        return result != FALSE && bytes_read == length;
+    }
+
+private:
+    HANDLE process_{nullptr};
+};
+
+void InferiorMemory::createImpl()
+{
+    impl_ = make_shared<InferiorMemoryImplWin32>();
+}
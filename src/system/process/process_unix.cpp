@@ -71,7 +71,10 @@ public:
 
     void kill() override
     {
-        ::kill(pid_, SIGTERM);
+        // A pid of 0 would signal the whole process group
+        if (pid_ != 0) {
+            ::kill(pid_, SIGTERM);
+        }
     }
 
 private:
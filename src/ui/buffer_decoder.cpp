@@ -0,0 +1,106 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "buffer_decoder.h"
+
+#include <chrono>
+
+#include "ipc/trace_events.h"
+#include "visualization/channel_range.h"
+
+
+using namespace std;
+
+
+namespace
+{
+
+DecodedBuffer decode_buffer(DecodedBuffer buffer)
+{
+    TraceScope trace("decode_buffer", buffer.request_id, buffer.name);
+
+    const auto convert_start = chrono::steady_clock::now();
+
+    const BufferType held_type = held_buffer_type(buffer.type);
+    narrow_buffer_to_held_type(buffer.type, buffer.contents);
+
+    const auto range_start = chrono::steady_clock::now();
+    buffer.convert_ms =
+        chrono::duration<double, milli>(range_start - convert_start).count();
+
+    if (buffer.compute_range) {
+        compute_channel_range(buffer.contents.data(),
+                              buffer.width,
+                              buffer.height,
+                              buffer.step,
+                              buffer.channels,
+                              held_type,
+                              buffer.lowest,
+                              buffer.upper);
+        buffer.has_range = true;
+    }
+
+    buffer.range_ms = chrono::duration<double, milli>(
+                          chrono::steady_clock::now() - range_start)
+                          .count();
+
+    return buffer;
+}
+
+} // namespace
+
+
+BufferDecoder::~BufferDecoder()
+{
+    if (decoded_future_.valid()) {
+        decoded_future_.wait();
+    }
+}
+
+
+void BufferDecoder::start(DecodedBuffer buffer)
+{
+    buffer.has_range = false;
+    decoded_future_  = async(launch::async, decode_buffer, move(buffer));
+}
+
+
+bool BufferDecoder::is_pending() const
+{
+    return decoded_future_.valid();
+}
+
+
+bool BufferDecoder::poll(DecodedBuffer& buffer)
+{
+    if (!decoded_future_.valid() ||
+        decoded_future_.wait_for(chrono::seconds(0)) !=
+            future_status::ready) {
+        return false;
+    }
+
+    buffer = decoded_future_.get();
+    return true;
+}
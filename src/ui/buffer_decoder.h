@@ -0,0 +1,97 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BUFFER_DECODER_H_
+#define BUFFER_DECODER_H_
+
+#include <cstdint>
+
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "ipc/raw_data_decode.h"
+
+
+// Contents of a buffer received from the bridge, and what is known of them
+// once they were decoded
+struct DecodedBuffer
+{
+    std::vector<std::uint8_t> contents;
+    BufferType type;
+    int width;
+    int height;
+    int channels;
+    int step;
+
+    // The range is only found if it will be computed on the CPU anyway
+    bool compute_range;
+    bool has_range;
+    float lowest[4];
+    float upper[4];
+
+    // Time spent converting the contents to their held type, and finding
+    // their range
+    double convert_ms;
+    double range_ms;
+
+    // Plot request of the buffer, for tracing
+    std::uint64_t request_id;
+    std::string name;
+
+    // Applies the decoded contents, on the UI thread
+    std::function<void(DecodedBuffer&)> on_decoded;
+};
+
+
+/*
+ * Decodes received buffers in a worker thread, so that the UI thread only
+ * has to hand them over to their stage: doubles are narrowed to floats and
+ * the channel ranges are computed without blocking the window. Buffers are
+ * decoded one at a time, which keeps them in the order they were received.
+ */
+class BufferDecoder
+{
+  public:
+    ~BufferDecoder();
+
+    // The buffer must not be started while another one is pending
+    void start(DecodedBuffer buffer);
+
+    bool is_pending() const;
+
+    /**
+     * Take the decoded buffer, if the worker is done with it.
+     *
+     * @return true if buffer was filled, which ends the decoding
+     */
+    bool poll(DecodedBuffer& buffer);
+
+  private:
+    std::future<DecodedBuffer> decoded_future_;
+};
+
+#endif // BUFFER_DECODER_H_
@@ -0,0 +1,232 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "buffer_history.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDir>
+
+using namespace std;
+
+
+const size_t BufferHistory::BlockSize = 64 << 10;
+
+
+namespace
+{
+
+uint64_t hash_block(const uint8_t* block, size_t length)
+{
+    // Mixes whole words, since the blocks are compared before being shared
+    uint64_t hash = 0xcbf29ce484222325ull ^ length;
+
+    size_t offset = 0;
+    for (; offset + sizeof(uint64_t) <= length; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, block + offset, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+    }
+    for (; offset < length; ++offset) {
+        hash = (hash ^ block[offset]) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+} // namespace
+
+
+BufferHistory::BufferHistory(size_t capacity_bytes)
+    : capacity_bytes_(capacity_bytes)
+    , mapped_(nullptr)
+{
+}
+
+
+bool BufferHistory::open()
+{
+    const size_t slot_count = capacity_bytes_ / BlockSize;
+    if (slot_count == 0) {
+        return false;
+    }
+
+    file_.setFileTemplate(QDir::tempPath() + "/oid_history_XXXXXX");
+
+    // The file is sparse until slots are written to
+    const qint64 file_size = static_cast<qint64>(slot_count * BlockSize);
+    if (!file_.open() || !file_.resize(file_size)) {
+        return false;
+    }
+
+    mapped_ = file_.map(0, file_size);
+    if (mapped_ == nullptr) {
+        return false;
+    }
+
+    slots_.resize(slot_count);
+    clear();
+
+    return true;
+}
+
+
+bool BufferHistory::append(Version version, const vector<uint8_t>& contents)
+{
+    const size_t block_count = (contents.size() + BlockSize - 1) / BlockSize;
+    if (mapped_ == nullptr || block_count > slots_.size()) {
+        return false;
+    }
+
+    version.length = contents.size();
+    version.blocks.clear();
+    version.blocks.reserve(block_count);
+
+    for (size_t offset = 0; offset < contents.size(); offset += BlockSize) {
+        uint32_t slot_index;
+        if (!store_block(contents.data() + offset,
+                         min(BlockSize, contents.size() - offset),
+                         slot_index)) {
+            for (const uint32_t stored_slot : version.blocks) {
+                release_block(stored_slot);
+            }
+            return false;
+        }
+
+        version.blocks.push_back(slot_index);
+    }
+
+    versions_.push_back(std::move(version));
+
+    return true;
+}
+
+
+size_t BufferHistory::version_count() const
+{
+    return versions_.size();
+}
+
+
+const BufferHistory::Version& BufferHistory::version(size_t index) const
+{
+    return versions_[index];
+}
+
+
+void BufferHistory::read(size_t index, vector<uint8_t>& contents) const
+{
+    const Version& version = versions_[index];
+
+    contents.resize(version.length);
+    for (size_t block = 0; block < version.blocks.size(); ++block) {
+        const uint32_t slot_index = version.blocks[block];
+        memcpy(contents.data() + block * BlockSize,
+               mapped_ + slot_index * BlockSize,
+               slots_[slot_index].length);
+    }
+}
+
+
+void BufferHistory::clear()
+{
+    versions_.clear();
+    slots_by_hash_.clear();
+
+    // The lowest slots are taken first
+    free_slots_.clear();
+    for (size_t slot = slots_.size(); slot > 0; --slot) {
+        slots_[slot - 1] = Slot{0, 0, 0};
+        free_slots_.push_back(static_cast<uint32_t>(slot - 1));
+    }
+}
+
+
+bool BufferHistory::store_block(const uint8_t* block,
+                                size_t length,
+                                uint32_t& slot_index)
+{
+    const uint64_t hash = hash_block(block, length);
+
+    const auto candidates = slots_by_hash_.equal_range(hash);
+    for (auto candidate = candidates.first; candidate != candidates.second;
+         ++candidate) {
+        Slot& slot = slots_[candidate->second];
+        if (slot.length == length &&
+            memcmp(mapped_ + candidate->second * BlockSize, block, length) ==
+                0) {
+            ++slot.references;
+            slot_index = candidate->second;
+            return true;
+        }
+    }
+
+    while (free_slots_.empty()) {
+        if (versions_.empty()) {
+            return false;
+        }
+        evict_oldest();
+    }
+
+    slot_index = free_slots_.back();
+    free_slots_.pop_back();
+
+    memcpy(mapped_ + slot_index * BlockSize, block, length);
+    slots_[slot_index] = Slot{hash, length, 1};
+    slots_by_hash_.emplace(hash, slot_index);
+
+    return true;
+}
+
+
+void BufferHistory::release_block(uint32_t slot_index)
+{
+    Slot& slot = slots_[slot_index];
+    if (--slot.references > 0) {
+        return;
+    }
+
+    const auto candidates = slots_by_hash_.equal_range(slot.hash);
+    for (auto candidate = candidates.first; candidate != candidates.second;
+         ++candidate) {
+        if (candidate->second == slot_index) {
+            slots_by_hash_.erase(candidate);
+            break;
+        }
+    }
+
+    free_slots_.push_back(slot_index);
+}
+
+
+void BufferHistory::evict_oldest()
+{
+    for (const uint32_t slot_index : versions_.front().blocks) {
+        release_block(slot_index);
+    }
+    versions_.pop_front();
+}
@@ -0,0 +1,127 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BUFFER_HISTORY_H_
+#define BUFFER_HISTORY_H_
+
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint8_t
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <QTemporaryFile>
+
+#include "ipc/raw_data_decode.h"
+
+
+/*
+ * Versions of a buffer recorded while stepping through the debugged program.
+ * Their contents are split into blocks, stored once per distinct content in
+ * the slots of a memory mapped file, so that unchanged regions of successive
+ * versions share their blocks. Once all slots are taken, the oldest versions
+ * are evicted. Only the version being displayed is assembled in memory.
+ */
+class BufferHistory
+{
+  public:
+    struct Version
+    {
+        std::string pixel_layout;
+        bool transpose;
+        int width;
+        int height;
+        int channels;
+        int stride;
+        BufferType type;
+
+        std::size_t length;
+        std::vector<std::uint32_t> blocks;
+    };
+
+    explicit BufferHistory(std::size_t capacity_bytes);
+
+    /**
+     * Map the history file, in the temporary directory.
+     *
+     * @return false if it could not be created
+     */
+    bool open();
+
+    /**
+     * Record a version of the buffer. The contents are held as they are, so
+     * double buffers must already be narrowed. The fields of version, apart
+     * from its blocks, describe the contents.
+     *
+     * @return false if the contents don't fit in the history
+     */
+    bool append(Version version, const std::vector<std::uint8_t>& contents);
+
+    std::size_t version_count() const;
+
+    // Oldest version first
+    const Version& version(std::size_t index) const;
+
+    // Copy the contents of a version out of the history file
+    void read(std::size_t index, std::vector<std::uint8_t>& contents) const;
+
+    void clear();
+
+  private:
+    static const std::size_t BlockSize;
+
+    struct Slot
+    {
+        std::uint64_t hash;
+        std::size_t length;
+        int references;
+    };
+
+    // Map a block to a slot holding the same contents, or store it into a
+    // free one, evicting the oldest versions if needed
+    bool store_block(const std::uint8_t* block,
+                     std::size_t length,
+                     std::uint32_t& slot_index);
+
+    void release_block(std::uint32_t slot_index);
+
+    void evict_oldest();
+
+    std::size_t capacity_bytes_;
+
+    QTemporaryFile file_;
+    std::uint8_t* mapped_;
+
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> free_slots_;
+    std::unordered_multimap<std::uint64_t, std::uint32_t> slots_by_hash_;
+
+    std::deque<Version> versions_;
+};
+
+
+#endif // BUFFER_HISTORY_H_
@@ -0,0 +1,232 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "buffer_list_model.h"
+
+#include <algorithm>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Number of icon pixmaps kept around; a few screens worth of visible rows
+const int max_cached_pixmaps = 64;
+
+} // namespace
+
+
+BufferListModel::BufferListModel(QObject* parent)
+    : QAbstractListModel(parent)
+    , pixmaps_(max_cached_pixmaps)
+{
+}
+
+
+int BufferListModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+
+    return rows_.size();
+}
+
+
+QVariant BufferListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows_.size()) {
+        return QVariant();
+    }
+
+    const Row& row = rows_[index.row()];
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return row.label;
+    case BufferNameRole:
+        return row.name;
+    case Qt::DecorationRole: {
+        if (row.icon.isNull()) {
+            return QVariant();
+        }
+
+        QPixmap* pixmap = pixmaps_.object(row.name);
+        if (pixmap == nullptr) {
+            pixmap = new QPixmap(QPixmap::fromImage(row.icon));
+            pixmaps_.insert(row.name, pixmap);
+        }
+
+        return *pixmap;
+    }
+    default:
+        return QVariant();
+    }
+}
+
+
+Qt::ItemFlags BufferListModel::flags(const QModelIndex& index) const
+{
+    // Buffers are dropped between rows, not on them
+    if (!index.isValid()) {
+        return Qt::ItemIsDropEnabled;
+    }
+
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled;
+}
+
+
+Qt::DropActions BufferListModel::supportedDropActions() const
+{
+    return Qt::MoveAction;
+}
+
+
+bool BufferListModel::moveRows(const QModelIndex& source_parent,
+                               int source_row,
+                               int count,
+                               const QModelIndex& destination_parent,
+                               int destination_child)
+{
+    if (source_parent.isValid() || destination_parent.isValid() ||
+        count <= 0 || source_row < 0 || source_row + count > rows_.size() ||
+        destination_child < 0 || destination_child > rows_.size() ||
+        (destination_child >= source_row &&
+         destination_child <= source_row + count)) {
+        return false;
+    }
+
+    beginMoveRows(source_parent,
+                  source_row,
+                  source_row + count - 1,
+                  destination_parent,
+                  destination_child);
+
+    const QVector<Row> moved = rows_.mid(source_row, count);
+    rows_.remove(source_row, count);
+
+    const int insertion_row = destination_child > source_row
+                                  ? destination_child - count
+                                  : destination_child;
+    for (int i = 0; i < count; ++i) {
+        rows_.insert(insertion_row + i, moved[i]);
+    }
+
+    update_row_indices(min(source_row, insertion_row));
+
+    endMoveRows();
+
+    return true;
+}
+
+
+void BufferListModel::add_buffer(const QString& name, const QString& label)
+{
+    if (row_indices_.contains(name)) {
+        set_label(name, label);
+        return;
+    }
+
+    const int row = rows_.size();
+
+    beginInsertRows(QModelIndex(), row, row);
+    rows_.push_back(Row{name, label, QImage()});
+    row_indices_.insert(name, row);
+    endInsertRows();
+}
+
+
+void BufferListModel::remove_buffer(const QString& name)
+{
+    const int row = row_of(name);
+    if (row < 0) {
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), row, row);
+    rows_.remove(row);
+    row_indices_.remove(name);
+    pixmaps_.remove(name);
+    update_row_indices(row);
+    endRemoveRows();
+}
+
+
+int BufferListModel::row_of(const QString& name) const
+{
+    return row_indices_.value(name, -1);
+}
+
+
+const QString& BufferListModel::buffer_name(int row) const
+{
+    return rows_[row].name;
+}
+
+
+bool BufferListModel::set_label(const QString& name, const QString& label)
+{
+    const int row = row_of(name);
+    if (row < 0) {
+        return false;
+    }
+
+    if (rows_[row].label != label) {
+        rows_[row].label = label;
+
+        const QModelIndex changed = index(row);
+        Q_EMIT(dataChanged(changed, changed, {Qt::DisplayRole}));
+    }
+
+    return true;
+}
+
+
+bool BufferListModel::set_icon(const QString& name, const QImage& icon)
+{
+    const int row = row_of(name);
+    if (row < 0) {
+        return false;
+    }
+
+    // The pixmap is created again once the view draws the row
+    rows_[row].icon = icon;
+    pixmaps_.remove(name);
+
+    const QModelIndex changed = index(row);
+    Q_EMIT(dataChanged(changed, changed, {Qt::DecorationRole}));
+
+    return true;
+}
+
+
+void BufferListModel::update_row_indices(int first)
+{
+    for (int row = first; row < rows_.size(); ++row) {
+        row_indices_[rows_[row].name] = row;
+    }
+}
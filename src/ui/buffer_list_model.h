@@ -0,0 +1,100 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BUFFER_LIST_MODEL_H_
+#define BUFFER_LIST_MODEL_H_
+
+#include <QAbstractListModel>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QString>
+#include <QVector>
+
+
+// Model of the buffer list, with one row per held buffer. Rows are found by
+// buffer name through a hash map, and the icon pixmaps are only created for
+// the rows the view asks for (the visible ones), then kept in a bounded cache
+class BufferListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+  public:
+    static const int BufferNameRole = Qt::UserRole;
+
+    explicit BufferListModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+
+    QVariant data(const QModelIndex& index, int role) const;
+
+    Qt::ItemFlags flags(const QModelIndex& index) const;
+
+    Qt::DropActions supportedDropActions() const;
+
+    // Reordering by drag and drop
+    bool moveRows(const QModelIndex& source_parent,
+                  int source_row,
+                  int count,
+                  const QModelIndex& destination_parent,
+                  int destination_child);
+
+    // Append a row without icon, unless the buffer already has one
+    void add_buffer(const QString& name, const QString& label);
+
+    void remove_buffer(const QString& name);
+
+    /**
+     * @return the row of the buffer, or -1 if it is not in the list
+     */
+    int row_of(const QString& name) const;
+
+    const QString& buffer_name(int row) const;
+
+    /**
+     * @return false if the buffer is not in the list
+     */
+    bool set_label(const QString& name, const QString& label);
+
+    bool set_icon(const QString& name, const QImage& icon);
+
+  private:
+    struct Row {
+        QString name;
+        QString label;
+        QImage icon;
+    };
+
+    // Refresh the hash map entries of the rows from first on
+    void update_row_indices(int first);
+
+    QVector<Row> rows_;
+    QHash<QString, int> row_indices_;
+
+    mutable QCache<QString, QPixmap> pixmaps_;
+};
+
+#endif // BUFFER_LIST_MODEL_H_
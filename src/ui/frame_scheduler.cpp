@@ -0,0 +1,234 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "frame_scheduler.h"
+
+#include <algorithm>
+
+#include <QOpenGLContext>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Not defined by the OpenGL ES headers, whose contexts don't support it
+#ifndef GL_TIME_ELAPSED
+const GLenum GL_TIME_ELAPSED = 0x88BF;
+#endif
+
+// The interaction is over once no input event was received for this long
+const auto interaction_timeout = chrono::milliseconds(150);
+
+// Weight of the cost of each new frame in the smoothed cost
+const double frame_cost_smoothing = 0.25;
+
+
+double smoothed(double cost, double frame_cost)
+{
+    return cost + frame_cost_smoothing * (frame_cost - cost);
+}
+
+} // namespace
+
+
+FrameScheduler::FrameScheduler(GLCanvas* gl_canvas)
+    : gl_canvas_(gl_canvas)
+    , use_timer_queries_(false)
+    , timer_queries_{}
+    , timer_query_pending_{}
+    , next_timer_query_(0)
+    , active_timer_query_(-1)
+    , budget_ms_(1000.0 / 60.0)
+    , cpu_cost_ms_(0.0)
+    , gpu_cost_ms_(0.0)
+    , in_frame_(false)
+    , deferring_(false)
+{
+}
+
+
+FrameScheduler::~FrameScheduler()
+{
+    if (use_timer_queries_) {
+        gl_canvas_->glDeleteQueries(num_timer_queries, timer_queries_);
+    }
+}
+
+
+bool FrameScheduler::initialize()
+{
+    const QOpenGLContext* context = QOpenGLContext::currentContext();
+    const QSurfaceFormat format   = context->format();
+    use_timer_queries_ = !context->isOpenGLES() &&
+                         (format.majorVersion() > 3 ||
+                          (format.majorVersion() == 3 &&
+                           format.minorVersion() >= 3));
+
+    if (use_timer_queries_) {
+        gl_canvas_->glGenQueries(num_timer_queries, timer_queries_);
+    }
+
+    return true;
+}
+
+
+void FrameScheduler::set_frame_budget(double budget_ms)
+{
+    budget_ms_ = budget_ms;
+}
+
+
+void FrameScheduler::begin_frame()
+{
+    frame_start_ = chrono::steady_clock::now();
+    in_frame_    = true;
+
+    if (!use_timer_queries_) {
+        return;
+    }
+
+    read_timer_queries();
+
+    // If all queries are still in flight, this frame isn't measured on the
+    // GPU
+    if (timer_query_pending_[next_timer_query_]) {
+        active_timer_query_ = -1;
+        return;
+    }
+
+    active_timer_query_ = next_timer_query_;
+    next_timer_query_   = (next_timer_query_ + 1) % num_timer_queries;
+
+    gl_canvas_->glBeginQuery(GL_TIME_ELAPSED,
+                             timer_queries_[active_timer_query_]);
+}
+
+
+void FrameScheduler::end_frame()
+{
+    const chrono::duration<double, milli> cpu_cost =
+        chrono::steady_clock::now() - frame_start_;
+    cpu_cost_ms_ = smoothed(cpu_cost_ms_, cpu_cost.count());
+    in_frame_    = false;
+
+    if (active_timer_query_ >= 0) {
+        gl_canvas_->glEndQuery(GL_TIME_ELAPSED);
+        timer_query_pending_[active_timer_query_] = true;
+        active_timer_query_                       = -1;
+    }
+
+    if (is_interacting() && frame_cost_ms() > budget_ms_) {
+        deferring_ = true;
+    }
+}
+
+
+void FrameScheduler::notify_interaction()
+{
+    last_interaction_ = chrono::steady_clock::now();
+}
+
+
+bool FrameScheduler::is_interacting() const
+{
+    return chrono::steady_clock::now() - last_interaction_ <
+           interaction_timeout;
+}
+
+
+bool FrameScheduler::allow_deferrable_pass() const
+{
+    return !in_frame_ || !deferring_;
+}
+
+
+bool FrameScheduler::is_deferring() const
+{
+    return deferring_;
+}
+
+
+bool FrameScheduler::take_deferred_passes()
+{
+    if (!deferring_ || is_interacting()) {
+        return false;
+    }
+
+    deferring_ = false;
+
+    return true;
+}
+
+
+double FrameScheduler::frame_cost_ms() const
+{
+    return max(cpu_cost_ms_, gpu_cost_ms_);
+}
+
+
+double FrameScheduler::cpu_cost_ms() const
+{
+    return cpu_cost_ms_;
+}
+
+
+double FrameScheduler::gpu_cost_ms() const
+{
+    return gpu_cost_ms_;
+}
+
+
+bool FrameScheduler::measures_gpu_cost() const
+{
+    return use_timer_queries_;
+}
+
+
+void FrameScheduler::read_timer_queries()
+{
+    for (int i = 0; i < num_timer_queries; ++i) {
+        if (!timer_query_pending_[i]) {
+            continue;
+        }
+
+        GLuint available = GL_FALSE;
+        gl_canvas_->glGetQueryObjectuiv(
+            timer_queries_[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) {
+            continue;
+        }
+
+        // In nanoseconds, which only overflow after 4 seconds
+        GLuint elapsed = 0;
+        gl_canvas_->glGetQueryObjectuiv(
+            timer_queries_[i], GL_QUERY_RESULT, &elapsed);
+        gpu_cost_ms_ = smoothed(gpu_cost_ms_, elapsed / 1.0e6);
+
+        timer_query_pending_[i] = false;
+    }
+}
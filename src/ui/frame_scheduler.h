@@ -0,0 +1,115 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef FRAME_SCHEDULER_H_
+#define FRAME_SCHEDULER_H_
+
+#include <chrono>
+
+#include "ui/gl_canvas.h"
+
+
+/*
+ * Keeps the frames drawn while the user interacts with the view within a
+ * time budget. The cost of each frame is measured on the CPU and, with timer
+ * queries, on the GPU; queries are only read once their results are
+ * available, from the following frames, so that measuring never stalls the
+ * pipeline. Once the frames go over budget during an interaction, the
+ * passes which can wait (value labels, icons, linked stages which aren't
+ * displayed) are deferred until it stops, and then run. Timer queries are
+ * core since OpenGL 3.3; only the CPU cost is measured otherwise.
+ */
+class FrameScheduler
+{
+  public:
+    explicit FrameScheduler(GLCanvas* gl_canvas);
+    ~FrameScheduler();
+
+    bool initialize();
+
+    void set_frame_budget(double budget_ms);
+
+    // Measure the frame drawn in between both calls
+    void begin_frame();
+    void end_frame();
+
+    // An input event changed what is displayed
+    void notify_interaction();
+
+    // Input events were received recently
+    bool is_interacting() const;
+
+    // Whether a pass which can wait may be drawn in the current frame.
+    // Passes drawn outside of the measured frames, e.g. into icons or
+    // exports, are never deferred.
+    bool allow_deferrable_pass() const;
+
+    // The passes which can wait are deferred until the interaction stops
+    bool is_deferring() const;
+
+    /**
+     * Stop deferring once the interaction stopped.
+     *
+     * @return true if passes were deferred, which must run now
+     */
+    bool take_deferred_passes();
+
+    // Smoothed cost of the last frames, in milliseconds
+    double frame_cost_ms() const;
+
+    // Smoothed costs of the last frames on the CPU and the GPU; the GPU cost
+    // is only measured with timer queries
+    double cpu_cost_ms() const;
+    double gpu_cost_ms() const;
+    bool measures_gpu_cost() const;
+
+  private:
+    void read_timer_queries();
+
+    static constexpr int num_timer_queries = 4;
+
+    GLCanvas* gl_canvas_;
+
+    bool use_timer_queries_;
+    GLuint timer_queries_[num_timer_queries];
+    bool timer_query_pending_[num_timer_queries];
+    int next_timer_query_;
+    int active_timer_query_;
+
+    double budget_ms_;
+    double cpu_cost_ms_;
+    double gpu_cost_ms_;
+
+    std::chrono::steady_clock::time_point frame_start_;
+    std::chrono::steady_clock::time_point last_interaction_;
+
+    bool in_frame_;
+
+    // Deferring lasts until the interaction stops, so that the deferred
+    // passes don't flicker in and out as the frame cost changes
+    bool deferring_;
+};
+
+#endif // FRAME_SCHEDULER_H_
@@ -23,24 +23,67 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "gl_canvas.h"
 
+#include "ipc/trace_events.h"
 #include "main_window/main_window.h"
+#include "ui/frame_scheduler.h"
 #include "ui/gl_text_renderer.h"
+#include "ui/gpu_reducer.h"
+#include "ui/perf_overlay.h"
+#include "ui/texture_uploader.h"
+#include "visualization/components/buffer.h"
 #include "visualization/components/camera.h"
 #include "visualization/game_object.h"
+#include "visualization/stage.h"
 
 
 using namespace std;
 
 
+namespace
+{
+
+// Bytes of texture contents uploaded per frame, while uploads are queued
+const size_t texture_upload_budget = 32 << 20;
+
+// Largest width/height of the tiles rendered by render_buffer_image
+const int max_image_tile_size = 2048;
+
+// Largest number of bytes of the images rendered by render_buffer_image
+const size_t max_image_bytes = size_t(1) << 31;
+
+// Space between the views of a split canvas
+const int split_cell_gap = 2;
+
+// Color of the outline of the active view
+const GLfloat active_cell_color[4] = {0.2f, 0.5f, 0.9f, 1.f};
+
+} // namespace
+
+
 GLCanvas::GLCanvas(QWidget* parent)
     : QOpenGLWidget(parent)
-    , QOpenGLFunctions()
+    , QOpenGLExtraFunctions()
     , mouse_x_(0)
     , mouse_y_(0)
+    , pixel_buffers_supported_(false)
     , initialized_(false)
+    , max_texture_size_(0)
+    , max_texture_layers_(0)
+    , mip_reduction_(MipReduction::Average)
+    , gpu_value_labels_(false)
+    , split_count_(1)
+    , active_split_cell_(0)
     , text_renderer_(new GLTextRenderer(this))
+    , texture_uploader_(new TextureUploader(this))
+    , gpu_reducer_(new GpuReducer(this))
+    , frame_scheduler_(new FrameScheduler(this))
+    , perf_overlay_(new PerfOverlay(this))
 {
     mouse_down_[0] = mouse_down_[1] = false;
 }
@@ -71,9 +114,17 @@ void GLCanvas::mouseMoveEvent(QMouseEvent* ev)
 
 void GLCanvas::mousePressEvent(QMouseEvent* ev)
 {
-    if (ev->button() == Qt::LeftButton)
+    if (ev->button() == Qt::LeftButton) {
         mouse_down_[0] = true;
 
+        // Clicking another view makes it the active one
+        const int cell =
+            split_cell_at(ev->localPos().x(), ev->localPos().y());
+        if (cell >= 0 && cell != active_split_cell_) {
+            main_window_->split_cell_selected(cell);
+        }
+    }
+
     if (ev->button() == Qt::RightButton)
         mouse_down_[1] = true;
 }
@@ -91,6 +142,8 @@ void GLCanvas::mouseReleaseEvent(QMouseEvent* ev)
 
 void GLCanvas::initializeGL()
 {
+    StartupPhase startup("initialize_gl");
+
     this->makeCurrent();
     initializeOpenGLFunctions();
 
@@ -98,6 +151,21 @@ void GLCanvas::initializeGL()
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size_);
+
+    // Array textures are core since OpenGL 3.0, and instanced vertex
+    // attributes since OpenGL 3.3 and OpenGL ES 3.0
+    const QSurfaceFormat format = context()->format();
+    const int required_minor    = context()->isOpenGLES() ? 0 : 3;
+    if (format.majorVersion() > 3 ||
+        (format.majorVersion() == 3 &&
+         format.minorVersion() >= required_minor)) {
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_texture_layers_);
+    }
+
+    // Pixel buffers are mapped with glMapBufferRange, core since OpenGL 3.0
+    pixel_buffers_supported_ = format.majorVersion() >= 3;
+
     ///
     // Texture for generating icons
     assert(main_window_ != nullptr);
@@ -145,14 +213,26 @@ void GLCanvas::initializeGL()
     // Initialize text renderer
     text_renderer_->initialize();
 
+    texture_uploader_->initialize();
+
+    gpu_reducer_->initialize();
+
+    frame_scheduler_->initialize();
+
     initialized_ = true;
 }
 
 
 void GLCanvas::paintGL()
 {
+    frame_scheduler_->begin_frame();
+    perf_overlay_->begin_frame();
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     main_window_->draw();
+
+    perf_overlay_->end_frame();
+    frame_scheduler_->end_frame();
 }
 
 
@@ -162,20 +242,328 @@ void GLCanvas::wheelEvent(QWheelEvent* ev)
 }
 
 
+int GLCanvas::mouse_x()
+{
+    return mouse_x_ - split_cell_rect(active_split_cell_).x();
+}
+
+
+int GLCanvas::mouse_y()
+{
+    return mouse_y_ - split_cell_rect(active_split_cell_).y();
+}
+
+
 const GLTextRenderer* GLCanvas::get_text_renderer()
 {
     return text_renderer_.get();
 }
 
 
+TextureUploader* GLCanvas::get_texture_uploader()
+{
+    return texture_uploader_.get();
+}
+
+
+GpuReducer* GLCanvas::get_gpu_reducer()
+{
+    return gpu_reducer_.get();
+}
+
+
+FrameScheduler* GLCanvas::get_frame_scheduler()
+{
+    return frame_scheduler_.get();
+}
+
+
+PerfOverlay* GLCanvas::get_perf_overlay()
+{
+    return perf_overlay_.get();
+}
+
+
+int GLCanvas::max_texture_size() const
+{
+    return max_texture_size_;
+}
+
+
+int GLCanvas::max_texture_layers() const
+{
+    return max_texture_layers_;
+}
+
+
+MipReduction GLCanvas::mip_reduction() const
+{
+    return mip_reduction_;
+}
+
+
+void GLCanvas::set_mip_reduction(MipReduction reduction)
+{
+    mip_reduction_ = reduction;
+}
+
+
+bool GLCanvas::gpu_value_labels() const
+{
+    return gpu_value_labels_;
+}
+
+
+void GLCanvas::set_gpu_value_labels(bool enabled)
+{
+    gpu_value_labels_ = enabled;
+}
+
+
+int GLCanvas::split_count() const
+{
+    return split_count_;
+}
+
+
+void GLCanvas::set_split_count(int count)
+{
+    split_count_ = count >= 4 ? 4 : (count >= 2 ? 2 : 1);
+    if (active_split_cell_ >= split_count_) {
+        active_split_cell_ = 0;
+    }
+}
+
+
+int GLCanvas::active_split_cell() const
+{
+    return active_split_cell_;
+}
+
+
+void GLCanvas::set_active_split_cell(int cell)
+{
+    if (cell >= 0 && cell < split_count_) {
+        active_split_cell_ = cell;
+    }
+}
+
+
+int GLCanvas::view_width() const
+{
+    return split_cell_rect(0).width();
+}
+
+
+int GLCanvas::view_height() const
+{
+    return split_cell_rect(0).height();
+}
+
+
+QRect GLCanvas::split_cell_rect(int cell) const
+{
+    // Two views are side by side, four in a 2x2 grid
+    const int columns = split_count_ > 1 ? 2 : 1;
+    const int rows    = split_count_ > 2 ? 2 : 1;
+
+    const int cell_width =
+        max((width() - (columns - 1) * split_cell_gap) / columns, 1);
+    const int cell_height =
+        max((height() - (rows - 1) * split_cell_gap) / rows, 1);
+
+    const int column = cell % columns;
+    const int row    = cell / columns;
+
+    return QRect(column * (cell_width + split_cell_gap),
+                 row * (cell_height + split_cell_gap),
+                 cell_width,
+                 cell_height);
+}
+
+
+int GLCanvas::split_cell_at(int x, int y) const
+{
+    for (int cell = 0; cell < split_count_; ++cell) {
+        if (split_cell_rect(cell).contains(x, y)) {
+            return cell;
+        }
+    }
+
+    return -1;
+}
+
+
+QRect GLCanvas::view_framebuffer_rect() const
+{
+    return split_cell_framebuffer_rect(active_split_cell_);
+}
+
+
+void GLCanvas::begin_split_cell(int cell)
+{
+    // Primitives are clipped to the viewport, which is all a view needs:
+    // the views share the programs and buffers of their stages
+    const QRect viewport = split_cell_framebuffer_rect(cell);
+    glViewport(
+        viewport.x(), viewport.y(), viewport.width(), viewport.height());
+}
+
+
+void GLCanvas::end_split_cells()
+{
+    const qreal ratio = devicePixelRatioF();
+    glViewport(0,
+               0,
+               static_cast<GLsizei>(round(width() * ratio)),
+               static_cast<GLsizei>(round(height() * ratio)));
+
+    if (split_count_ == 1) {
+        return;
+    }
+
+    // The edges are cleared through scissor rectangles, which needs no
+    // program of its own
+    const QRect cell        = view_framebuffer_rect();
+    const GLint left        = cell.x();
+    const GLint bottom      = cell.y();
+    const GLsizei thickness = max(static_cast<GLsizei>(round(ratio)), 1);
+
+    GLfloat clear_color[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+
+    glEnable(GL_SCISSOR_TEST);
+    glClearColor(active_cell_color[0],
+                 active_cell_color[1],
+                 active_cell_color[2],
+                 active_cell_color[3]);
+
+    const GLint edges[4][4] = {
+        {left, bottom, cell.width(), thickness},
+        {left, bottom + cell.height() - thickness, cell.width(), thickness},
+        {left, bottom, thickness, cell.height()},
+        {left + cell.width() - thickness, bottom, thickness, cell.height()}};
+
+    for (const auto& edge : edges) {
+        glScissor(edge[0], edge[1], edge[2], edge[3]);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(
+        clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+}
+
+
+QRect GLCanvas::split_cell_framebuffer_rect(int cell) const
+{
+    const qreal ratio = devicePixelRatioF();
+    const QRect rect  = split_cell_rect(cell);
+
+    // Rows of the framebuffer go up from the bottom of the widget
+    const int left   = static_cast<int>(round(rect.x() * ratio));
+    const int bottom = static_cast<int>(
+        round((height() - rect.y() - rect.height()) * ratio));
+
+    return QRect(left,
+                 bottom,
+                 static_cast<int>(round(rect.width() * ratio)),
+                 static_cast<int>(round(rect.height() * ratio)));
+}
+
+
+bool GLCanvas::upload_pending_textures()
+{
+    if (texture_uploader_->empty()) {
+        return false;
+    }
+
+    texture_uploader_->upload_pending(texture_upload_budget);
+    return true;
+}
+
+
 void GLCanvas::render_buffer_icon(Stage* stage, const int icon_width, const int icon_height)
+{
+    draw_buffer_icon(stage, icon_width, icon_height);
+
+    stage->buffer_icon.resize(3 * static_cast<size_t>(icon_width) * static_cast<size_t>(icon_height));
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0,
+                 0,
+                 icon_width,
+                 icon_height,
+                 GL_RGB,
+                 GL_UNSIGNED_BYTE,
+                 stage->buffer_icon.data());
+
+    glBindFramebuffer(GL_FRAMEBUFFER_EXT, 0);
+}
+
+
+GLuint GLCanvas::start_buffer_icon(Stage* stage,
+                                   int icon_width,
+                                   int icon_height)
+{
+    if (!pixel_buffers_supported_) {
+        return 0;
+    }
+
+    draw_buffer_icon(stage, icon_width, icon_height);
+
+    GLuint pixel_buffer;
+    glGenBuffers(1, &pixel_buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER,
+                 3 * icon_width * icon_height,
+                 nullptr,
+                 GL_STREAM_READ);
+
+    // The pixels are copied into the pixel buffer once the GPU is done with
+    // the icon, without waiting for it
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(
+        0, 0, icon_width, icon_height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER_EXT, 0);
+
+    return pixel_buffer;
+}
+
+
+void GLCanvas::finish_buffer_icon(GLuint pixel_buffer,
+                                  int icon_width,
+                                  int icon_height,
+                                  vector<uint8_t>& icon)
+{
+    const size_t icon_bytes = 3 * static_cast<size_t>(icon_width) *
+                              static_cast<size_t>(icon_height);
+    icon.resize(icon_bytes);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer);
+    const void* pixels = glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, icon_bytes, GL_MAP_READ_BIT);
+    if (pixels != nullptr) {
+        memcpy(icon.data(), pixels, icon_bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        cerr << "[error] Could not read the buffer icon back" << endl;
+        fill(icon.begin(), icon.end(), 0);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glDeleteBuffers(1, &pixel_buffer);
+}
+
+
+void GLCanvas::draw_buffer_icon(Stage* stage, int icon_width, int icon_height)
 {
     glBindFramebuffer(GL_FRAMEBUFFER_EXT, icon_fbo_);
 
     glViewport(0, 0, icon_width, icon_height);
 
-    GameObject* camera = stage->get_game_object("camera");
-    Camera* cam        = camera->get_component<Camera>("camera_component");
+    Camera* cam = stage->get_camera_component();
 
     // Save original camera pose
     Camera original_pose = *cam;
@@ -183,34 +571,143 @@ void GLCanvas::render_buffer_icon(Stage* stage, const int icon_width, const int
     // Adapt camera to the thumbnail dimentions
     cam->window_resized(icon_width, icon_height);
     // Flips the projected image along the horizontal axis
-    cam->projection.set_ortho_projection(
-        icon_width / 2.0, -icon_height / 2.0, -1.0f, 1.0f);
+    cam->set_ortho_projection(icon_width / 2.0, -icon_height / 2.0);
     // Reposition buffer in the center of the canvas
     cam->recenter_camera();
 
     stage->draw();
-    stage->buffer_icon.resize(3 * static_cast<size_t>(icon_width) * static_cast<size_t>(icon_height));
-    glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    glReadPixels(0,
+
+    // Reset stage camera
+    glViewport(0, 0, width(), height());
+    *cam = original_pose;
+    cam->window_resized(view_width(), view_height());
+}
+
+
+bool GLCanvas::render_buffer_image(Stage* stage, float scale, QImage& image)
+{
+    GameObject* buffer_obj = stage->get_buffer_object();
+    Buffer* buffer         = stage->get_buffer_component();
+
+    // Extent of the buffer in the scene, once rotated
+    const vec4 buf_dim =
+        buffer_obj->get_pose() *
+        vec4(buffer->display_width_f, buffer->display_height_f, 0, 1);
+    const float scene_width  = std::abs(buf_dim.x());
+    const float scene_height = std::abs(buf_dim.y());
+
+    const int image_width  = static_cast<int>(std::ceil(scene_width * scale));
+    const int image_height = static_cast<int>(std::ceil(scene_height * scale));
+
+    if (image_width <= 0 || image_height <= 0 ||
+        3 * static_cast<size_t>(image_width) *
+                static_cast<size_t>(image_height) >
+            max_image_bytes) {
+        cerr << "[error] The exported image would be too large" << endl;
+        return false;
+    }
+
+    image = QImage(image_width, image_height, QImage::Format_RGB888);
+    if (image.isNull()) {
+        cerr << "[error] Could not allocate the exported image" << endl;
+        return false;
+    }
+
+    const int tile_size = min(max_image_tile_size, max_texture_size_);
+
+    GLuint tile_texture;
+    glGenTextures(1, &tile_texture);
+    glBindTexture(GL_TEXTURE_2D, tile_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGB8,
+                 tile_size,
+                 tile_size,
                  0,
-                 icon_width,
-                 icon_height,
                  GL_RGB,
                  GL_UNSIGNED_BYTE,
-                 stage->buffer_icon.data());
+                 NULL);
 
-    // Reset stage camera
-    glBindFramebuffer(GL_FRAMEBUFFER_EXT, 0);
+    GLuint tile_fbo;
+    glGenFramebuffers(1, &tile_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, tile_fbo);
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tile_texture, 0);
+
+    const bool complete =
+        glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    if (complete) {
+        Camera* cam = stage->get_camera_component();
+
+        // Save original camera pose
+        Camera original_pose = *cam;
+
+        vector<uint8_t> tile(3 * static_cast<size_t>(tile_size) *
+                             static_cast<size_t>(tile_size));
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+        for (int tile_y = 0; tile_y < image_height; tile_y += tile_size) {
+            for (int tile_x = 0; tile_x < image_width; tile_x += tile_size) {
+                const int tile_width  = min(tile_size, image_width - tile_x);
+                const int tile_height = min(tile_size, image_height - tile_y);
+
+                glViewport(0, 0, tile_width, tile_height);
+                glClear(GL_COLOR_BUFFER_BIT);
+
+                // Flips the projected image along the horizontal axis, so
+                // that the rows are read back from the top
+                cam->window_resized(tile_width, tile_height);
+                cam->set_ortho_projection(tile_width / 2.0,
+                                          -tile_height / 2.0);
+                cam->set_view(
+                    scale,
+                    -scene_width / 2.f + (tile_x + tile_width / 2.f) / scale,
+                    scene_height / 2.f -
+                        (tile_y + tile_height / 2.f) / scale);
+
+                stage->draw();
+                glReadPixels(0,
+                             0,
+                             tile_width,
+                             tile_height,
+                             GL_RGB,
+                             GL_UNSIGNED_BYTE,
+                             tile.data());
+
+                for (int row = 0; row < tile_height; ++row) {
+                    memcpy(image.scanLine(tile_y + row) + 3 * tile_x,
+                           tile.data() + 3 * static_cast<size_t>(row) *
+                                             static_cast<size_t>(tile_width),
+                           3 * static_cast<size_t>(tile_width));
+                }
+            }
+        }
+
+        // Reset stage camera
+        *cam = original_pose;
+        cam->window_resized(view_width(), view_height());
+    } else {
+        cerr << "[error] Could not create the framebuffer of the exported "
+                "image"
+             << endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
     glViewport(0, 0, width(), height());
-    *cam = original_pose;
-    cam->window_resized(width(), height());
+    glDeleteFramebuffers(1, &tile_fbo);
+    glDeleteTextures(1, &tile_texture);
+
+    return complete;
 }
 
 
 void GLCanvas::resizeGL(int w, int h)
 {
     glViewport(0, 0, w, h);
-    main_window_->resize_callback(w, h);
+    main_window_->resize_callback(view_width(), view_height());
 }
 
 
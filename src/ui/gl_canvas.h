@@ -28,17 +28,25 @@
 
 #include <memory>
 
+#include <QImage>
 #include <QMouseEvent>
-#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLWidget>
+#include <QRect>
+
+#include "visualization/mip_pyramid.h"
 
 
 class MainWindow;
 class Stage;
+class FrameScheduler;
 class GLTextRenderer;
+class GpuReducer;
+class PerfOverlay;
+class TextureUploader;
 
 
-class GLCanvas : public QOpenGLWidget, public QOpenGLFunctions
+class GLCanvas : public QOpenGLWidget, public QOpenGLExtraFunctions
 {
     Q_OBJECT
   public:
@@ -60,15 +68,10 @@ class GLCanvas : public QOpenGLWidget, public QOpenGLFunctions
 
     void wheelEvent(QWheelEvent* ev);
 
-    int mouse_x()
-    {
-        return mouse_x_;
-    }
+    // Position of the mouse in the active view
+    int mouse_x();
 
-    int mouse_y()
-    {
-        return mouse_y_;
-    }
+    int mouse_y();
 
     bool is_mouse_down()
     {
@@ -82,10 +85,93 @@ class GLCanvas : public QOpenGLWidget, public QOpenGLFunctions
 
     const GLTextRenderer* get_text_renderer();
 
+    TextureUploader* get_texture_uploader();
+
+    GpuReducer* get_gpu_reducer();
+
+    FrameScheduler* get_frame_scheduler();
+
+    PerfOverlay* get_perf_overlay();
+
+    // Largest width/height of the textures supported by the driver
+    int max_texture_size() const;
+
+    // Largest number of layers of an array texture drawn with instancing,
+    // or 0 if the context doesn't support them
+    int max_texture_layers() const;
+
+    // Reduction of the mipmaps of the buffers, used when zoomed out
+    MipReduction mip_reduction() const;
+
+    void set_mip_reduction(MipReduction reduction);
+
+    // Pixel values are drawn by the buffer shader, rather than from labels
+    // formatted on the CPU
+    bool gpu_value_labels() const;
+
+    void set_gpu_value_labels(bool enabled);
+
+    /**
+     * The canvas is split into a grid of 1, 2 or 4 views, each drawing a
+     * stage of its own in the same frame. The active view is the one which
+     * receives the input.
+     */
+    int split_count() const;
+
+    void set_split_count(int count);
+
+    int active_split_cell() const;
+
+    void set_active_split_cell(int cell);
+
+    // Size of each view, which the cameras project to
+    int view_width() const;
+
+    int view_height() const;
+
+    // Rectangle of a view in the widget, with its origin at the top left
+    QRect split_cell_rect(int cell) const;
+
+    // View under a position of the widget, or -1 if it is between views
+    int split_cell_at(int x, int y) const;
+
+    // Rectangle of the active view in the framebuffer, in device pixels
+    // with its origin at the bottom left
+    QRect view_framebuffer_rect() const;
+
+    // Draw to a single view, until end_split_cells
+    void begin_split_cell(int cell);
+
+    // Outline the active view, and draw to the whole canvas again
+    void end_split_cells();
+
+    // Make some of the queued texture uploads; false if there were none
+    bool upload_pending_textures();
+
     void set_main_window(MainWindow* mw);
 
     void render_buffer_icon(Stage* stage, const int icon_width, const int icon_height);
 
+    /**
+     * Render the icon of stage, and start reading it back into a pixel
+     * buffer, which is only waited for by finish_buffer_icon. Contexts older
+     * than OpenGL 3.0 don't support it.
+     *
+     * @return the pixel buffer, or 0 if the icon wasn't rendered
+     */
+    GLuint start_buffer_icon(Stage* stage, int icon_width, int icon_height);
+
+    // Copy the pixels of an icon started by start_buffer_icon, read back
+    // once the GPU rendered it, then release its pixel buffer
+    void finish_buffer_icon(GLuint pixel_buffer,
+                            int icon_width,
+                            int icon_height,
+                            std::vector<uint8_t>& icon);
+
+    // Render the whole buffer of stage as displayed, magnified by scale, in
+    // tiles no larger than the textures supported by the driver
+    bool render_buffer_image(Stage* stage, float scale, QImage& image);
+
   private:
     bool mouse_down_[2];
 
@@ -97,11 +183,32 @@ class GLCanvas : public QOpenGLWidget, public QOpenGLFunctions
     GLuint icon_texture_;
     GLuint icon_fbo_;
 
+    bool pixel_buffers_supported_;
+
     bool initialized_;
 
+    GLint max_texture_size_;
+    GLint max_texture_layers_;
+
+    MipReduction mip_reduction_;
+
+    bool gpu_value_labels_;
+
+    int split_count_;
+    int active_split_cell_;
+
     std::unique_ptr<GLTextRenderer> text_renderer_;
+    std::unique_ptr<TextureUploader> texture_uploader_;
+    std::unique_ptr<GpuReducer> gpu_reducer_;
+    std::unique_ptr<FrameScheduler> frame_scheduler_;
+    std::unique_ptr<PerfOverlay> perf_overlay_;
 
     void generate_icon_texture();
+
+    QRect split_cell_framebuffer_rect(int cell) const;
+
+    // Draw stage into icon_fbo_, which is left bound to be read
+    void draw_buffer_icon(Stage* stage, int icon_width, int icon_height);
 };
 
 #endif // GL_CANVAS_H_
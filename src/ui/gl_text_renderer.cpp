@@ -23,6 +23,8 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+
 #include <QPainter>
 #include <QPixmap>
 
@@ -33,14 +35,22 @@
 GLTextRenderer::GLTextRenderer(GLCanvas* gl_canvas)
     : font("Times New Roman", font_size)
     , text_prog(gl_canvas)
+    , overlay_font("Monospace")
+    , overlay_tex(0)
+    , overlay_cell_width(0)
+    , overlay_cell_height(0)
+    , overlay_texture_width(1.0f)
+    , overlay_texture_height(1.0f)
     , gl_canvas_(gl_canvas)
 {
+    overlay_font.setStyleHint(QFont::TypeWriter);
 }
 
 
 GLTextRenderer::~GLTextRenderer()
 {
     gl_canvas_->glDeleteTextures(1, &text_tex);
+    gl_canvas_->glDeleteTextures(1, &overlay_tex);
     gl_canvas_->glDeleteBuffers(1, &text_vbo);
 }
 
@@ -51,11 +61,8 @@ bool GLTextRenderer::initialize()
                      shader::text_frag_shader,
                      ShaderProgram::FormatR,
                      "rgba",
-                     {"mvp",
-                      "buff_sampler",
-                      "text_sampler",
-                      "pix_coord",
-                      "brightness_contrast"});
+                     {"mvp", "text_sampler", "brightness_contrast"},
+                     {"input_position", "input_value"});
 
     gl_canvas_->glGenTextures(1, &text_tex);
     gl_canvas_->glActiveTexture(GL_TEXTURE0);
@@ -64,10 +71,36 @@ bool GLTextRenderer::initialize()
     gl_canvas_->glGenBuffers(1, &text_vbo);
     generate_glyphs_texture();
 
+    gl_canvas_->glGenTextures(1, &overlay_tex);
+    generate_overlay_glyphs_texture();
+
     return true;
 }
 
 
+void GLTextRenderer::get_label_glyphs(float rects[][4],
+                                      float boxes[][4]) const
+{
+    for (int g = 0; g < label_glyph_count; ++g) {
+        const unsigned char glyph = static_cast<unsigned char>(label_glyphs[g]);
+
+        const int tex_wid = text_texture_sizes[glyph][0];
+        const int tex_hei = text_texture_sizes[glyph][1];
+
+        // As for the labels drawn from the CPU
+        rects[g][0] = text_texture_offsets[glyph][0] / text_texture_width;
+        rects[g][1] = text_texture_offsets[glyph][1] / text_texture_height;
+        rects[g][2] = (tex_wid - 1.0f) / text_texture_width;
+        rects[g][3] = (tex_hei - 1.0f) / text_texture_height;
+
+        boxes[g][0] = static_cast<float>(text_texture_advances[glyph][0]);
+        boxes[g][1] = static_cast<float>(tex_hei);
+        boxes[g][2] = 0.f;
+        boxes[g][3] = 0.f;
+    }
+}
+
+
 void GLTextRenderer::generate_glyphs_texture()
 {
     // Required characters for numbers, scientific notation (e), nan, inf
@@ -215,3 +248,118 @@ void GLTextRenderer::generate_glyphs_texture()
     gl_canvas_->glTexParameteri(
         GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
 }
+
+
+void GLTextRenderer::generate_overlay_glyphs_texture()
+{
+    // Overlay text is drawn at the resolution of the screen
+    overlay_font.setPixelSize(static_cast<int>(
+        overlay_font_size * gl_canvas_->devicePixelRatioF() + 0.5));
+
+    QFontMetrics metrics(overlay_font);
+    overlay_cell_width  = metrics.maxWidth();
+    overlay_cell_height = metrics.height();
+
+    const int grid_rows =
+        (overlay_glyph_count + overlay_grid_columns - 1) / overlay_grid_columns;
+    const int grid_width  = overlay_cell_width * overlay_grid_columns;
+    const int grid_height = overlay_cell_height * grid_rows;
+
+    overlay_texture_width = overlay_texture_height = 1.0f;
+    while (overlay_texture_width < grid_width)
+        overlay_texture_width *= 2.f;
+    while (overlay_texture_height < grid_height)
+        overlay_texture_height *= 2.f;
+
+    QImage img(static_cast<int>(overlay_texture_width),
+               static_cast<int>(overlay_texture_height),
+               QImage::Format_Grayscale8);
+    img.fill(0);
+
+    {
+        QPainter painter(&img);
+        painter.setPen(QColor(255, 255, 255));
+        painter.setFont(overlay_font);
+
+        for (int g = 0; g < overlay_glyph_count; ++g) {
+            const char glyph[2] = {static_cast<char>(overlay_first_glyph + g),
+                                   '\0'};
+
+            painter.drawText((g % overlay_grid_columns) * overlay_cell_width,
+                             (g / overlay_grid_columns) * overlay_cell_height +
+                                 metrics.ascent(),
+                             glyph);
+        }
+    }
+
+    // The rows of the image are padded to 32 bits
+    std::vector<uint8_t> packed_texture(
+        static_cast<size_t>(overlay_texture_width * overlay_texture_height));
+    for (int y = 0; y < img.height(); ++y) {
+        std::copy(img.constScanLine(y),
+                  img.constScanLine(y) + img.width(),
+                  packed_texture.data() + y * img.width());
+    }
+
+    gl_canvas_->glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, overlay_tex);
+    gl_canvas_->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    gl_canvas_->glTexImage2D(GL_TEXTURE_2D,
+                             0,
+                             GL_R8,
+                             img.width(),
+                             img.height(),
+                             0,
+                             GL_RED,
+                             GL_UNSIGNED_BYTE,
+                             packed_texture.data());
+
+    // Glyphs are drawn one texel per pixel
+    gl_canvas_->glTexParameteri(
+        GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl_canvas_->glTexParameteri(
+        GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    gl_canvas_->glTexParameteri(
+        GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gl_canvas_->glTexParameteri(
+        GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+
+void GLTextRenderer::append_overlay_text(const char* text,
+                                         float x,
+                                         float y,
+                                         float value,
+                                         std::vector<GLfloat>& vertices) const
+{
+    const float w = static_cast<float>(overlay_cell_width);
+    const float h = static_cast<float>(overlay_cell_height);
+
+    for (auto p = reinterpret_cast<const unsigned char*>(text); *p;
+         p++, x += w) {
+        const int g = *p - overlay_first_glyph;
+        if (g <= 0 || g >= overlay_glyph_count) {
+            // Spaces and unsupported characters are left blank
+            continue;
+        }
+
+        const float tex_lower_x =
+            (g % overlay_grid_columns) * w / overlay_texture_width;
+        const float tex_lower_y =
+            (g / overlay_grid_columns) * h / overlay_texture_height;
+        const float tex_upper_x = tex_lower_x + w / overlay_texture_width;
+        const float tex_upper_y = tex_lower_y + h / overlay_texture_height;
+
+        // Same vertex format as the value labels, two triangles per glyph
+        const GLfloat quad[6][5] = {
+            {x, y, tex_lower_x, tex_lower_y, value},
+            {x + w, y, tex_upper_x, tex_lower_y, value},
+            {x, y + h, tex_lower_x, tex_upper_y, value},
+            {x, y + h, tex_lower_x, tex_upper_y, value},
+            {x + w, y, tex_upper_x, tex_lower_y, value},
+            {x + w, y + h, tex_upper_x, tex_upper_y, value},
+        };
+
+        vertices.insert(vertices.end(), &quad[0][0], &quad[0][0] + 6 * 5);
+    }
+}
@@ -26,6 +26,8 @@
 #ifndef GL_TEXT_RENDERER_H_
 #define GL_TEXT_RENDERER_H_
 
+#include <vector>
+
 #include "math/linear_algebra.h"
 #include "ui/gl_canvas.h"
 #include "visualization/shader.h"
@@ -36,6 +38,11 @@ class GLTextRenderer
   public:
     static constexpr float font_size = 96.0f;
 
+    // Glyphs which labels drawn by shaders are made of, in the order of
+    // their ids in the shaders
+    static constexpr const char* label_glyphs = "0123456789.-+enaif";
+    static constexpr int label_glyph_count    = 18;
+
     QFont font;
     GLuint text_vbo;
     GLuint text_tex;
@@ -52,11 +59,45 @@ class GLTextRenderer
 
     void generate_glyphs_texture();
 
+    /**
+     * Describe label_glyphs for the shaders. rects receives the rectangle
+     * of each glyph in the texture (lower x, lower y, width, height), and
+     * boxes their size in font pixels (width and height).
+     */
+    void get_label_glyphs(float rects[][4], float boxes[][4]) const;
+
     ShaderProgram text_prog;
 
     float text_texture_width;
     float text_texture_height;
 
+    // Monospaced glyphs of the printable ASCII characters, laid out in a
+    // grid of cells, for text drawn in window pixels (e.g. overlays)
+    static constexpr int overlay_first_glyph  = 32;
+    static constexpr int overlay_glyph_count  = 95;
+    static constexpr int overlay_grid_columns = 16;
+    static constexpr int overlay_font_size    = 13;
+
+    QFont overlay_font;
+    GLuint overlay_tex;
+    int overlay_cell_width;
+    int overlay_cell_height;
+    float overlay_texture_width;
+    float overlay_texture_height;
+
+    void generate_overlay_glyphs_texture();
+
+    /**
+     * Add the glyphs of a line of overlay text, whose top left corner is at
+     * x, y in window pixels, to vertices, in the vertex format of text_prog.
+     * value sets the color of the glyphs, as the buffer value of labels.
+     */
+    void append_overlay_text(const char* text,
+                             float x,
+                             float y,
+                             float value,
+                             std::vector<GLfloat>& vertices) const;
+
   private:
     GLCanvas* gl_canvas_;
 };
@@ -0,0 +1,604 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "gpu_reducer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include <QOpenGLContext>
+
+#include "visualization/shaders/oid_shaders.h"
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Each pass reduces blocks of block_size x block_size texels into one
+const int block_size = 16;
+
+// Statistics held in each target: lowest, upper, sum, NaN and Inf counts
+const int num_statistics = 5;
+
+
+int reduced_size(int size)
+{
+    return max((size + block_size - 1) / block_size, 1);
+}
+
+} // namespace
+
+
+GpuReducer::GpuReducer(GLCanvas* gl_canvas)
+    : gl_canvas_(gl_canvas)
+    , available_(false)
+    , source_prog_(gl_canvas)
+    , source_array_prog_(gl_canvas)
+    , difference_prog_(gl_canvas)
+    , difference_array_prog_(gl_canvas)
+    , combine_prog_(gl_canvas)
+    , vbo_(0)
+    , targets_{}
+{
+}
+
+
+GpuReducer::~GpuReducer()
+{
+    if (!available_) {
+        return;
+    }
+
+    for (auto& readback : readbacks_) {
+        release_readback(readback.second);
+    }
+
+    for (auto& target : targets_) {
+        release_target(target);
+    }
+
+    gl_canvas_->glDeleteBuffers(1, &vbo_);
+}
+
+
+bool GpuReducer::initialize()
+{
+    // Float color buffers are core since OpenGL 3.0 and fence syncs since
+    // OpenGL 3.2. OpenGL ES 3 only renders into floats with an extension.
+    const QOpenGLContext* context = QOpenGLContext::currentContext();
+    const QSurfaceFormat format   = context->format();
+    available_ = !context->isOpenGLES() &&
+                 (format.majorVersion() > 3 ||
+                  (format.majorVersion() == 3 && format.minorVersion() >= 2));
+
+    if (!available_) {
+        return true;
+    }
+
+    GLint max_draw_buffers      = 0;
+    GLint max_color_attachments = 0;
+    gl_canvas_->glGetIntegerv(GL_MAX_DRAW_BUFFERS, &max_draw_buffers);
+    gl_canvas_->glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS,
+                              &max_color_attachments);
+
+    available_ = max_draw_buffers >= num_statistics &&
+                 max_color_attachments >= num_statistics;
+
+    const vector<string> source_uniforms = {
+        "sampler", "layer", "source_size", "texture_size", "output_origin"};
+
+    available_ = available_ &&
+                 source_prog_.create(shader::background_vert_shader,
+                                     shader::reduce_source_frag_shader,
+                                     ShaderProgram::FormatRGBA,
+                                     "rgba",
+                                     source_uniforms,
+                                     {"input_position"});
+
+    vector<string> difference_uniforms = source_uniforms;
+    difference_uniforms.insert(
+        difference_uniforms.end(),
+        {"reference_sampler", "difference_mode", "value_scale", "threshold"});
+
+    available_ = available_ &&
+                 difference_prog_.create(shader::background_vert_shader,
+                                         shader::reduce_difference_frag_shader,
+                                         ShaderProgram::FormatRGBA,
+                                         "rgba",
+                                         difference_uniforms,
+                                         {"input_position"});
+
+    // Tiles are only held in an array texture if they are supported
+    if (available_ && gl_canvas_->max_texture_layers() > 0) {
+        available_ =
+            source_array_prog_.create(shader::background_vert_shader,
+                                      shader::reduce_source_frag_shader,
+                                      ShaderProgram::FormatRGBA,
+                                      "rgba",
+                                      source_uniforms,
+                                      {"input_position"},
+                                      true) &&
+            difference_array_prog_.create(
+                shader::background_vert_shader,
+                shader::reduce_difference_frag_shader,
+                ShaderProgram::FormatRGBA,
+                "rgba",
+                difference_uniforms,
+                {"input_position"},
+                true);
+    }
+
+    available_ = available_ &&
+                 combine_prog_.create(shader::background_vert_shader,
+                                      shader::reduce_combine_frag_shader,
+                                      ShaderProgram::FormatRGBA,
+                                      "rgba",
+                                      {"lowest_sampler",
+                                       "upper_sampler",
+                                       "sum_sampler",
+                                       "nan_count_sampler",
+                                       "inf_count_sampler",
+                                       "source_size",
+                                       "texture_size",
+                                       "output_origin"},
+                                      {"input_position"});
+
+    if (!available_) {
+        return true;
+    }
+
+    // clang-format off
+    static const GLfloat vertex_buffer_data[] = {
+        -1, -1,
+         1, -1,
+         1,  1,
+         1,  1,
+        -1,  1,
+        -1, -1,
+    };
+    // clang-format on
+
+    gl_canvas_->glGenBuffers(1, &vbo_);
+    gl_canvas_->glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    gl_canvas_->glBufferData(GL_ARRAY_BUFFER,
+                             sizeof(vertex_buffer_data),
+                             vertex_buffer_data,
+                             GL_STATIC_DRAW);
+
+    return true;
+}
+
+
+bool GpuReducer::is_available() const
+{
+    return available_;
+}
+
+
+bool GpuReducer::reduce(const void* owner,
+                        GLenum target,
+                        int texture_width,
+                        int texture_height,
+                        const vector<Tile>& tiles)
+{
+    return reduce_tiles(
+        owner, target, texture_width, texture_height, tiles, nullptr);
+}
+
+
+bool GpuReducer::reduce_difference(const void* owner,
+                                   GLenum target,
+                                   int texture_width,
+                                   int texture_height,
+                                   const vector<Tile>& tiles,
+                                   const vector<Tile>& reference_tiles,
+                                   DifferenceMode mode,
+                                   float value_scale,
+                                   float threshold)
+{
+    if (reference_tiles.size() != tiles.size()) {
+        cancel(owner);
+        return false;
+    }
+
+    const Difference difference{&reference_tiles, mode, value_scale, threshold};
+    return reduce_tiles(
+        owner, target, texture_width, texture_height, tiles, &difference);
+}
+
+
+bool GpuReducer::reduce_tiles(const void* owner,
+                              GLenum target,
+                              int texture_width,
+                              int texture_height,
+                              const vector<Tile>& tiles,
+                              const Difference* difference)
+{
+    cancel(owner);
+
+    const int num_tiles = static_cast<int>(tiles.size());
+
+    if (!available_ || num_tiles == 0 ||
+        num_tiles > gl_canvas_->max_texture_size()) {
+        return false;
+    }
+
+    GLint previous_fbo = 0;
+    GLint previous_viewport[4];
+    gl_canvas_->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_fbo);
+    gl_canvas_->glGetIntegerv(GL_VIEWPORT, previous_viewport);
+    const GLboolean blend_enabled = gl_canvas_->glIsEnabled(GL_BLEND);
+
+    const int first_width  = reduced_size(texture_width);
+    const int first_height = reduced_size(texture_height);
+
+    if (!reserve_target(targets_[0], first_width, first_height) ||
+        !reserve_target(targets_[1],
+                        reduced_size(first_width),
+                        reduced_size(first_height)) ||
+        !reserve_target(targets_[2], num_tiles, 1)) {
+        gl_canvas_->glBindFramebuffer(GL_FRAMEBUFFER,
+                                      static_cast<GLuint>(previous_fbo));
+        return false;
+    }
+
+    gl_canvas_->glDisable(GL_BLEND);
+
+    gl_canvas_->glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    gl_canvas_->glEnableVertexAttribArray(0);
+    gl_canvas_->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+    const bool is_array = target == GL_TEXTURE_2D_ARRAY;
+
+    const ShaderProgram& source_prog =
+        difference != nullptr
+            ? (is_array ? difference_array_prog_ : difference_prog_)
+            : (is_array ? source_array_prog_ : source_prog_);
+
+    for (int tile_id = 0; tile_id < num_tiles; ++tile_id) {
+        const Tile& tile = tiles[tile_id];
+        int width        = tile.width;
+        int height       = tile.height;
+
+        // The contents are sampled from their base level, even though
+        // neighbouring fragments are a block apart
+        gl_canvas_->glActiveTexture(GL_TEXTURE0);
+        gl_canvas_->glBindTexture(target, tile.texture);
+        gl_canvas_->glTexParameterf(target, GL_TEXTURE_MAX_LOD, 0.f);
+
+        const Tile* reference_tile =
+            difference != nullptr ? &(*difference->reference_tiles)[tile_id]
+                                  : nullptr;
+        if (reference_tile != nullptr) {
+            gl_canvas_->glActiveTexture(GL_TEXTURE1);
+            gl_canvas_->glBindTexture(target, reference_tile->texture);
+            gl_canvas_->glTexParameterf(target, GL_TEXTURE_MAX_LOD, 0.f);
+        }
+
+        for (int pass = 0;; ++pass) {
+            const int output_width  = reduced_size(width);
+            const int output_height = reduced_size(height);
+            const bool is_last_pass = output_width == 1 && output_height == 1;
+
+            const Target& output =
+                is_last_pass ? targets_[2] : targets_[pass % 2];
+            const int output_x = is_last_pass ? tile_id : 0;
+
+            gl_canvas_->glBindFramebuffer(GL_FRAMEBUFFER, output.fbo);
+            gl_canvas_->glViewport(output_x, 0, output_width, output_height);
+
+            if (pass == 0) {
+                source_prog.use();
+                source_prog.uniform1i("sampler", 0);
+                source_prog.uniform1f("layer", static_cast<float>(tile.layer));
+                source_prog.uniform2f("source_size", width, height);
+                source_prog.uniform2f(
+                    "texture_size", texture_width, texture_height);
+                source_prog.uniform2f("output_origin", output_x, 0);
+
+                if (reference_tile != nullptr) {
+                    source_prog.uniform1i("reference_sampler", 1);
+                    source_prog.uniform1i(
+                        "difference_mode", static_cast<int>(difference->mode));
+                    source_prog.uniform1f("value_scale",
+                                          difference->value_scale);
+                    source_prog.uniform1f("threshold", difference->threshold);
+
+                    gl_canvas_->glActiveTexture(GL_TEXTURE1);
+                    gl_canvas_->glBindTexture(target, reference_tile->texture);
+                }
+
+                gl_canvas_->glActiveTexture(GL_TEXTURE0);
+                gl_canvas_->glBindTexture(target, tile.texture);
+            } else {
+                const Target& input = targets_[(pass - 1) % 2];
+
+                for (int i = 0; i < num_statistics; ++i) {
+                    gl_canvas_->glActiveTexture(GL_TEXTURE0 + i);
+                    gl_canvas_->glBindTexture(GL_TEXTURE_2D,
+                                              input.textures[i]);
+                }
+
+                combine_prog_.use();
+                combine_prog_.uniform1i("lowest_sampler", 0);
+                combine_prog_.uniform1i("upper_sampler", 1);
+                combine_prog_.uniform1i("sum_sampler", 2);
+                combine_prog_.uniform1i("nan_count_sampler", 3);
+                combine_prog_.uniform1i("inf_count_sampler", 4);
+                combine_prog_.uniform2f("source_size", width, height);
+                combine_prog_.uniform2f(
+                    "texture_size", input.width, input.height);
+                combine_prog_.uniform2f("output_origin", output_x, 0);
+            }
+
+            gl_canvas_->glDrawArrays(GL_TRIANGLES, 0, 6);
+
+            if (is_last_pass) {
+                break;
+            }
+
+            width  = output_width;
+            height = output_height;
+        }
+
+        if (reference_tile != nullptr) {
+            gl_canvas_->glActiveTexture(GL_TEXTURE1);
+            gl_canvas_->glBindTexture(target, reference_tile->texture);
+            gl_canvas_->glTexParameterf(target, GL_TEXTURE_MAX_LOD, 1000.f);
+        }
+
+        gl_canvas_->glActiveTexture(GL_TEXTURE0);
+        gl_canvas_->glBindTexture(target, tile.texture);
+        gl_canvas_->glTexParameterf(target, GL_TEXTURE_MAX_LOD, 1000.f);
+    }
+
+    // One row of tile results per statistic
+    const size_t row_size = static_cast<size_t>(num_tiles) * 4 * sizeof(float);
+
+    Readback readback{0, nullptr, num_tiles};
+    gl_canvas_->glGenBuffers(1, &readback.pbo);
+    gl_canvas_->glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    gl_canvas_->glBufferData(GL_PIXEL_PACK_BUFFER,
+                             static_cast<GLsizeiptr>(row_size * num_statistics),
+                             nullptr,
+                             GL_STREAM_READ);
+
+    gl_canvas_->glBindFramebuffer(GL_FRAMEBUFFER, targets_[2].fbo);
+    gl_canvas_->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    for (int i = 0; i < num_statistics; ++i) {
+        gl_canvas_->glReadBuffer(GL_COLOR_ATTACHMENT0 + i);
+        gl_canvas_->glReadPixels(0,
+                                 0,
+                                 num_tiles,
+                                 1,
+                                 GL_RGBA,
+                                 GL_FLOAT,
+                                 reinterpret_cast<void*>(i * row_size));
+    }
+
+    readback.fence = gl_canvas_->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl_canvas_->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readbacks_[owner] = readback;
+
+    gl_canvas_->glBindFramebuffer(GL_FRAMEBUFFER,
+                                  static_cast<GLuint>(previous_fbo));
+    gl_canvas_->glViewport(previous_viewport[0],
+                           previous_viewport[1],
+                           previous_viewport[2],
+                           previous_viewport[3]);
+    if (blend_enabled) {
+        gl_canvas_->glEnable(GL_BLEND);
+    }
+
+    return true;
+}
+
+
+void GpuReducer::cancel(const void* owner)
+{
+    auto readback = readbacks_.find(owner);
+    if (readback == readbacks_.end()) {
+        return;
+    }
+
+    release_readback(readback->second);
+    readbacks_.erase(readback);
+}
+
+
+bool GpuReducer::is_pending(const void* owner) const
+{
+    return readbacks_.find(owner) != readbacks_.end();
+}
+
+
+bool GpuReducer::poll(const void* owner, BufferStatistics& statistics)
+{
+    auto readback = readbacks_.find(owner);
+    if (readback == readbacks_.end()) {
+        return false;
+    }
+
+    if (gl_canvas_->glClientWaitSync(readback->second.fence, 0, 0) ==
+        GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+
+    const int num_tiles   = readback->second.num_tiles;
+    const size_t row_size = static_cast<size_t>(num_tiles) * 4 * sizeof(float);
+
+    gl_canvas_->glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->second.pbo);
+    const float* results = static_cast<const float*>(
+        gl_canvas_->glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+                                     0,
+                                     static_cast<GLsizeiptr>(row_size *
+                                                             num_statistics),
+                                     GL_MAP_READ_BIT));
+
+    if (results != nullptr) {
+        const float* lowest    = results;
+        const float* upper     = lowest + num_tiles * 4;
+        const float* sum       = upper + num_tiles * 4;
+        const float* nan_count = sum + num_tiles * 4;
+        const float* inf_count = nan_count + num_tiles * 4;
+
+        for (int c = 0; c < 4; ++c) {
+            statistics.lowest[c]    = numeric_limits<float>::max();
+            statistics.upper[c]     = numeric_limits<float>::lowest();
+            statistics.sum[c]       = 0.0;
+            statistics.nan_count[c] = 0;
+            statistics.inf_count[c] = 0;
+
+            for (int tile_id = 0; tile_id < num_tiles; ++tile_id) {
+                const int i = tile_id * 4 + c;
+
+                statistics.lowest[c] = min(statistics.lowest[c], lowest[i]);
+                statistics.upper[c]  = max(statistics.upper[c], upper[i]);
+                statistics.sum[c] += sum[i];
+                statistics.nan_count[c] +=
+                    static_cast<size_t>(round(nan_count[i]));
+                statistics.inf_count[c] +=
+                    static_cast<size_t>(round(inf_count[i]));
+            }
+        }
+
+        gl_canvas_->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    gl_canvas_->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    release_readback(readback->second);
+    readbacks_.erase(readback);
+
+    return results != nullptr;
+}
+
+
+bool GpuReducer::poll_difference(const void* owner,
+                                 DifferenceStatistics& statistics)
+{
+    // The counts of infinities hold the counts above the threshold instead
+    BufferStatistics reduced;
+    if (!poll(owner, reduced)) {
+        return false;
+    }
+
+    for (int c = 0; c < 4; ++c) {
+        statistics.lowest[c]          = reduced.lowest[c];
+        statistics.upper[c]           = reduced.upper[c];
+        statistics.sum[c]             = reduced.sum[c];
+        statistics.nan_count[c]       = reduced.nan_count[c];
+        statistics.above_threshold[c] = reduced.inf_count[c];
+    }
+
+    return true;
+}
+
+
+bool GpuReducer::reserve_target(Target& target, int width, int height)
+{
+    if (target.fbo != 0 && target.width >= width && target.height >= height) {
+        return true;
+    }
+
+    if (target.fbo == 0) {
+        gl_canvas_->glGenFramebuffers(1, &target.fbo);
+        gl_canvas_->glGenTextures(num_statistics, target.textures);
+    }
+
+    // Targets only grow, since tiles of all sizes are reduced through them
+    target.width  = max(width, target.width);
+    target.height = max(height, target.height);
+
+    gl_canvas_->glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+
+    GLenum attachments[num_statistics];
+    for (int i = 0; i < num_statistics; ++i) {
+        gl_canvas_->glBindTexture(GL_TEXTURE_2D, target.textures[i]);
+        gl_canvas_->glTexParameteri(
+            GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        gl_canvas_->glTexParameteri(
+            GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        gl_canvas_->glTexParameteri(
+            GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        gl_canvas_->glTexParameteri(
+            GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        gl_canvas_->glTexImage2D(GL_TEXTURE_2D,
+                                 0,
+                                 GL_RGBA32F,
+                                 target.width,
+                                 target.height,
+                                 0,
+                                 GL_RGBA,
+                                 GL_FLOAT,
+                                 nullptr);
+
+        attachments[i] = GL_COLOR_ATTACHMENT0 + i;
+        gl_canvas_->glFramebufferTexture2D(GL_FRAMEBUFFER,
+                                           attachments[i],
+                                           GL_TEXTURE_2D,
+                                           target.textures[i],
+                                           0);
+    }
+
+    gl_canvas_->glDrawBuffers(num_statistics, attachments);
+
+    if (gl_canvas_->glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+        GL_FRAMEBUFFER_COMPLETE) {
+        cerr << "[error] Float framebuffers are not supported, buffer "
+                "statistics are computed on the CPU"
+             << endl;
+        release_target(target);
+        available_ = false;
+        return false;
+    }
+
+    return true;
+}
+
+
+void GpuReducer::release_target(Target& target)
+{
+    if (target.fbo == 0) {
+        return;
+    }
+
+    gl_canvas_->glDeleteFramebuffers(1, &target.fbo);
+    gl_canvas_->glDeleteTextures(num_statistics, target.textures);
+    target = Target{};
+}
+
+
+void GpuReducer::release_readback(Readback& readback)
+{
+    gl_canvas_->glDeleteSync(readback.fence);
+    gl_canvas_->glDeleteBuffers(1, &readback.pbo);
+}
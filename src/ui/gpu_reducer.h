@@ -0,0 +1,199 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GPU_REDUCER_H_
+#define GPU_REDUCER_H_
+
+#include <cstddef> // for std::size_t
+
+#include <map>
+#include <vector>
+
+#include "ui/gl_canvas.h"
+#include "visualization/shader.h"
+
+
+// Per channel statistics of the texels of a buffer, as they are sampled
+struct BufferStatistics
+{
+    // Non finite values are left out of the sums, and NaNs of the ranges
+    float lowest[4];
+    float upper[4];
+    double sum[4];
+    std::size_t nan_count[4];
+    std::size_t inf_count[4];
+};
+
+
+// How a buffer is compared with a reference of the same layout
+enum class DifferenceMode { Absolute, Signed, Relative };
+
+
+// Per channel statistics of the differences between two buffers, in buffer
+// values
+struct DifferenceStatistics
+{
+    float lowest[4];
+    float upper[4];
+    double sum[4];
+    std::size_t nan_count[4];
+
+    // Differences whose magnitude is above the threshold of the reduction
+    std::size_t above_threshold[4];
+};
+
+
+/*
+ * Reduces the tile textures of buffers into their statistics on the GPU, by
+ * rendering them into float framebuffers a fraction of their size until a
+ * single pixel is left per tile. The results are read back through a pixel
+ * buffer object, which is only mapped once the GPU signalled that it is
+ * done, so that the UI thread never waits for the reduction. It needs
+ * float render targets and fence syncs, which are core since OpenGL 3.2;
+ * buffers fall back to computing their statistics on the CPU otherwise.
+ */
+class GpuReducer
+{
+  public:
+    // Contents of width x height texels of a tile, from the origin of its
+    // texture (layer, for array textures)
+    struct Tile
+    {
+        GLuint texture;
+        int layer;
+        int width;
+        int height;
+    };
+
+    explicit GpuReducer(GLCanvas* gl_canvas);
+    ~GpuReducer();
+
+    bool initialize();
+
+    bool is_available() const;
+
+    /**
+     * Issue the reduction of the tiles of owner, which are all held in
+     * textures of the given target and size. Any previous reduction of
+     * owner is dropped.
+     *
+     * @return false if the reduction couldn't be started
+     */
+    bool reduce(const void* owner,
+                GLenum target,
+                int texture_width,
+                int texture_height,
+                const std::vector<Tile>& tiles);
+
+    /**
+     * Issue the reduction of the differences between the tiles of owner and
+     * those of a reference, split in tiles of the same size. The texels of
+     * both are scaled by value_scale before being compared.
+     *
+     * @return false if the reduction couldn't be started
+     */
+    bool reduce_difference(const void* owner,
+                           GLenum target,
+                           int texture_width,
+                           int texture_height,
+                           const std::vector<Tile>& tiles,
+                           const std::vector<Tile>& reference_tiles,
+                           DifferenceMode mode,
+                           float value_scale,
+                           float threshold);
+
+    void cancel(const void* owner);
+
+    bool is_pending(const void* owner) const;
+
+    /**
+     * Read the statistics of the reduction of owner back, if the GPU is
+     * done with it.
+     *
+     * @return true if statistics were filled, which ends the reduction
+     */
+    bool poll(const void* owner, BufferStatistics& statistics);
+
+    bool poll_difference(const void* owner, DifferenceStatistics& statistics);
+
+  private:
+    struct Difference
+    {
+        const std::vector<Tile>* reference_tiles;
+        DifferenceMode mode;
+        float value_scale;
+        float threshold;
+    };
+
+    // The first pass reduces the differences with the reference tiles, if
+    // difference is set, and the texels of the tiles otherwise
+    bool reduce_tiles(const void* owner,
+                      GLenum target,
+                      int texture_width,
+                      int texture_height,
+                      const std::vector<Tile>& tiles,
+                      const Difference* difference);
+
+    // Framebuffer rendering into one float texture per kind of statistic
+    struct Target
+    {
+        GLuint fbo;
+        GLuint textures[5];
+        int width;
+        int height;
+    };
+
+    struct Readback
+    {
+        GLuint pbo;
+        GLsync fence;
+        int num_tiles;
+    };
+
+    bool reserve_target(Target& target, int width, int height);
+
+    void release_target(Target& target);
+
+    void release_readback(Readback& readback);
+
+    GLCanvas* gl_canvas_;
+
+    bool available_;
+
+    ShaderProgram source_prog_;
+    ShaderProgram source_array_prog_;
+    ShaderProgram difference_prog_;
+    ShaderProgram difference_array_prog_;
+    ShaderProgram combine_prog_;
+    GLuint vbo_;
+
+    // Passes alternate between the first two, and each tile is reduced into
+    // its own pixel of the last one
+    Target targets_[3];
+
+    std::map<const void*, Readback> readbacks_;
+};
+
+#endif // GPU_REDUCER_H_
@@ -0,0 +1,162 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "histogram_widget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <QPainter>
+
+
+using namespace std;
+
+
+namespace
+{
+
+QColor channel_color(int channels, int channel)
+{
+    if (channels == 1) {
+        return QColor(200, 200, 200, 200);
+    }
+
+    static const QColor colors[] = {QColor(230, 60, 60, 200),
+                                    QColor(60, 200, 60, 200),
+                                    QColor(70, 110, 240, 200),
+                                    QColor(240, 240, 240, 200)};
+
+    return colors[channel];
+}
+
+} // namespace
+
+
+HistogramWidget::HistogramWidget(QWidget* parent)
+    : QWidget(parent)
+    , has_histogram_(false)
+    , first_bin_(0)
+    , last_bin_(0)
+    , lowest_{0.f, 0.f, 0.f, 0.f}
+    , upper_{0.f, 0.f, 0.f, 0.f}
+{
+    setMinimumSize(120, 40);
+}
+
+
+void HistogramWidget::set_histogram(const Histogram* histogram)
+{
+    has_histogram_ = histogram != nullptr;
+
+    if (has_histogram_) {
+        histogram_ = *histogram;
+
+        first_bin_ = histogram_bins - 1;
+        last_bin_  = 0;
+        for (int c = 0; c < histogram_.channels; ++c) {
+            const vector<uint32_t>& counts = histogram_.counts[c];
+            for (int bin = 0; bin < static_cast<int>(counts.size()); ++bin) {
+                if (counts[bin] > 0) {
+                    first_bin_ = min(first_bin_, bin);
+                    last_bin_  = max(last_bin_, bin);
+                }
+            }
+        }
+
+        has_histogram_ = first_bin_ <= last_bin_;
+    }
+
+    update();
+}
+
+
+void HistogramWidget::set_ranges(const float* lowest, const float* upper)
+{
+    copy(lowest, lowest + 4, lowest_);
+    copy(upper, upper + 4, upper_);
+
+    update();
+}
+
+
+void HistogramWidget::paintEvent(QPaintEvent*)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(30, 30, 30));
+
+    if (!has_histogram_) {
+        return;
+    }
+
+    const int columns  = max(width(), 1);
+    const int num_bins = last_bin_ - first_bin_ + 1;
+
+    auto column_of = [&](int bin) {
+        const int offset = min(max(bin - first_bin_, 0), num_bins - 1);
+        return static_cast<int>(static_cast<long long>(offset) * columns /
+                                num_bins);
+    };
+
+    for (int c = 0; c < histogram_.channels; ++c) {
+        const vector<uint32_t>& counts = histogram_.counts[c];
+        if (counts.empty()) {
+            continue;
+        }
+
+        // Bins are gathered into the columns they fall in
+        vector<double> column_counts(columns, 0.0);
+        for (int bin = first_bin_; bin <= last_bin_; ++bin) {
+            column_counts[column_of(bin)] += counts[bin];
+        }
+
+        const double max_count =
+            *max_element(column_counts.begin(), column_counts.end());
+        if (max_count == 0.0) {
+            continue;
+        }
+
+        const QColor color = channel_color(histogram_.channels, c);
+        painter.setPen(color);
+
+        const double scale = height() / log1p(max_count);
+        for (int x = 0; x < columns; ++x) {
+            const int bar_height =
+                static_cast<int>(round(log1p(column_counts[x]) * scale));
+            if (bar_height > 0) {
+                painter.drawLine(x, height() - 1, x, height() - bar_height);
+            }
+        }
+
+        // Bounds of the auto contrast range of the channel
+        painter.setPen(QPen(color, 1, Qt::DashLine));
+        const int lowest_x =
+            column_of(histogram_bin(histogram_.type, lowest_[c]));
+        const int upper_x =
+            column_of(histogram_bin(histogram_.type, upper_[c]));
+        painter.drawLine(lowest_x, 0, lowest_x, height() - 1);
+        painter.drawLine(upper_x, 0, upper_x, height() - 1);
+    }
+}
@@ -0,0 +1,63 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef HISTOGRAM_WIDGET_H_
+#define HISTOGRAM_WIDGET_H_
+
+#include <QWidget>
+
+#include "visualization/histogram.h"
+
+
+// Histogram of the channels of a buffer, with log scaled counts, and markers
+// at the bounds of the auto contrast ranges
+class HistogramWidget : public QWidget
+{
+    Q_OBJECT
+
+  public:
+    explicit HistogramWidget(QWidget* parent = nullptr);
+
+    // Show a copy of histogram, or nothing if it is nullptr
+    void set_histogram(const Histogram* histogram);
+
+    void set_ranges(const float* lowest, const float* upper);
+
+  protected:
+    void paintEvent(QPaintEvent* event);
+
+  private:
+    bool has_histogram_;
+    Histogram histogram_;
+
+    // Only the bins between the first and last non empty ones are shown
+    int first_bin_;
+    int last_bin_;
+
+    float lowest_[4];
+    float upper_[4];
+};
+
+#endif // HISTOGRAM_WIDGET_H_
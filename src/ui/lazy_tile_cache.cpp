@@ -0,0 +1,116 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "lazy_tile_cache.h"
+
+#include <iterator>
+#include <tuple>
+
+using namespace std;
+
+
+bool TileKey::operator<(const TileKey& other) const
+{
+    return tie(level, y, x) < tie(other.level, other.y, other.x);
+}
+
+
+LazyTileCache::LazyTileCache(size_t capacity_bytes)
+    : capacity_bytes_(capacity_bytes)
+    , size_bytes_(0)
+{
+}
+
+
+void LazyTileCache::insert(const TileKey& key, vector<uint8_t>&& contents)
+{
+    auto tile = tiles_.find(key);
+    if (tile != tiles_.end()) {
+        size_bytes_ -= tile->second.contents.size();
+        lru_.erase(tile->second.lru_position);
+        tiles_.erase(tile);
+    }
+
+    size_bytes_ += contents.size();
+    lru_.push_front(key);
+    tiles_[key] = CachedTile{std::move(contents), lru_.begin()};
+
+    evict();
+}
+
+
+bool LazyTileCache::insert_prefetched(const TileKey& key,
+                                      vector<uint8_t>&& contents)
+{
+    if (tiles_.find(key) != tiles_.end() ||
+        size_bytes_ + contents.size() > capacity_bytes_) {
+        return false;
+    }
+
+    size_bytes_ += contents.size();
+    lru_.push_back(key);
+    tiles_[key] = CachedTile{std::move(contents), prev(lru_.end())};
+
+    return true;
+}
+
+
+const vector<uint8_t>* LazyTileCache::find(const TileKey& key)
+{
+    auto tile = tiles_.find(key);
+    if (tile == tiles_.end()) {
+        return nullptr;
+    }
+
+    lru_.splice(lru_.begin(), lru_, tile->second.lru_position);
+
+    return &tile->second.contents;
+}
+
+
+bool LazyTileCache::contains(const TileKey& key) const
+{
+    return tiles_.find(key) != tiles_.end();
+}
+
+
+void LazyTileCache::clear()
+{
+    lru_.clear();
+    tiles_.clear();
+    size_bytes_ = 0;
+}
+
+
+void LazyTileCache::evict()
+{
+    // The most recently inserted tile is always kept
+    while (size_bytes_ > capacity_bytes_ && lru_.size() > 1) {
+        auto tile = tiles_.find(lru_.back());
+        size_bytes_ -= tile->second.contents.size();
+        tiles_.erase(tile);
+        lru_.pop_back();
+    }
+}
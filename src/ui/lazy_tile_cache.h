@@ -0,0 +1,98 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef LAZY_TILE_CACHE_H_
+#define LAZY_TILE_CACHE_H_
+
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint8_t
+
+#include <list>
+#include <map>
+#include <vector>
+
+
+// Identifies one tile of a lazy buffer, downsampled by a factor of level
+struct TileKey
+{
+    int level;
+    int x;
+    int y;
+
+    bool operator<(const TileKey& other) const;
+};
+
+/*
+ * Holds the tiles of a lazy buffer which have been fetched from the bridge.
+ * Once the cache grows beyond its capacity, the least recently used tiles are
+ * evicted.
+ */
+class LazyTileCache
+{
+  public:
+    explicit LazyTileCache(std::size_t capacity_bytes = 128 << 20);
+
+    void insert(const TileKey& key, std::vector<std::uint8_t>&& contents);
+
+    /**
+     * Insert a tile which wasn't requested, as the least recently used one.
+     * Prefetched tiles only take the free capacity of the cache: they never
+     * evict other tiles, nor replace a cached version of themselves.
+     *
+     * @return false if the tile was dropped
+     */
+    bool insert_prefetched(const TileKey& key,
+                           std::vector<std::uint8_t>&& contents);
+
+    /**
+     * Get the contents of a tile, and mark it as recently used.
+     *
+     * @return nullptr if the tile is not in the cache
+     */
+    const std::vector<std::uint8_t>* find(const TileKey& key);
+
+    bool contains(const TileKey& key) const;
+
+    void clear();
+
+  private:
+    struct CachedTile
+    {
+        std::vector<std::uint8_t> contents;
+        std::list<TileKey>::iterator lru_position;
+    };
+
+    void evict();
+
+    // Most recently used tiles first
+    std::list<TileKey> lru_;
+    std::map<TileKey, CachedTile> tiles_;
+
+    std::size_t capacity_bytes_;
+    std::size_t size_bytes_;
+};
+
+
+#endif // LAZY_TILE_CACHE_H_
@@ -0,0 +1,152 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "main_window.h"
+
+
+using namespace std;
+
+
+void MainWindow::plot_buffer_alias(const string& alias_name_str,
+                                   const string& display_name_str,
+                                   const string& source_name_str)
+{
+    // The source must be displayed from its full contents
+    auto source_stage = stages_.find(source_name_str);
+    if (source_stage == stages_.end() || source_name_str == alias_name_str ||
+        is_buffer_alias(source_name_str) ||
+        lazy_buffers_.count(source_name_str) > 0) {
+        // The bridge then sends the contents of the alias instead
+        send_buffer_message(MessageType::InvalidateBufferCache,
+                            source_name_str);
+        request_plot_buffer(alias_name_str.c_str());
+        return;
+    }
+
+    const shared_ptr<Stage> source = source_stage->second;
+
+    // The previous stage of the alias is only released once it is no longer
+    // selected or compared
+    shared_ptr<Stage> previous_stage;
+    bool was_displayed = false;
+
+    auto alias_stage = stages_.find(alias_name_str);
+    const bool is_new_buffer = alias_stage == stages_.end();
+    if (!is_new_buffer && alias_stage->second != source) {
+        previous_stage = alias_stage->second;
+        was_displayed  = previous_stage.get() == currently_selected_stage_;
+
+        // It must stop reading its contents before they are freed
+        previous_stage->get_buffer_component()->cancel_histogram();
+    }
+
+    stages_[alias_name_str]         = source;
+    buffer_aliases_[alias_name_str] = source_name_str;
+
+    held_buffers_.erase(alias_name_str);
+    lazy_buffers_.erase(alias_name_str);
+
+    if (was_displayed) {
+        set_currently_selected_stage(source.get());
+        update_history_timeline();
+    }
+
+    if (was_displayed || alias_name_str == difference_reference_name_) {
+        update_difference_reference();
+    }
+
+    if (is_new_buffer) {
+        // The icon and label are set by update_buffer_list_item
+        buffer_list_model_->add_buffer(alias_name_str.c_str(),
+                                       display_name_str.c_str());
+
+        persist_settings_deferred();
+    }
+
+    // Human readable dimensions
+    const Buffer* buffer = source->get_buffer_component();
+    const int buff_width  = static_cast<int>(buffer->buffer_width_f);
+    const int buff_height = static_cast<int>(buffer->buffer_height_f);
+
+    update_buffer_list_item(alias_name_str,
+                            display_name_str,
+                            buffer->transpose ? buff_height : buff_width,
+                            buffer->transpose ? buff_width : buff_height,
+                            buffer->channels,
+                            buffer->type);
+
+    request_render_update();
+}
+
+
+bool MainWindow::is_buffer_alias(const string& variable_name_str) const
+{
+    return buffer_aliases_.count(variable_name_str) > 0;
+}
+
+
+bool MainWindow::detach_buffer_alias(const string& variable_name_str)
+{
+    if (buffer_aliases_.erase(variable_name_str) == 0) {
+        return false;
+    }
+
+    // The selected stage remains the one of the source until the alias gets
+    // its own
+    stages_.erase(variable_name_str);
+
+    return true;
+}
+
+
+void MainWindow::remove_buffer_aliases(const string& variable_name_str)
+{
+    buffer_aliases_.erase(variable_name_str);
+
+    // The stage keeps pointing at the same contents, which are moved along
+    // with their vector
+    string heir_name;
+    for (auto alias = buffer_aliases_.begin();
+         alias != buffer_aliases_.end();) {
+        if (alias->second != variable_name_str) {
+            ++alias;
+            continue;
+        }
+
+        if (heir_name.empty()) {
+            heir_name = alias->first;
+
+            auto held_buffer = held_buffers_.find(variable_name_str);
+            if (held_buffer != held_buffers_.end()) {
+                held_buffers_[heir_name] = std::move(held_buffer->second);
+            }
+
+            alias = buffer_aliases_.erase(alias);
+        } else {
+            alias->second = heir_name;
+            ++alias;
+        }
+    }
+}
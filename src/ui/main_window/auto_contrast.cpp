@@ -23,6 +23,9 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <limits>
+
 #include <QLineEdit>
 
 #include "main_window.h"
@@ -53,8 +56,7 @@ void disable_inputs(const initializer_list<QLineEdit*>& inputs)
 
 void MainWindow::reset_ac_min_labels()
 {
-    GameObject* buffer_obj = currently_selected_stage_->get_game_object("buffer");
-    Buffer* buffer = buffer_obj->get_component<Buffer>("buffer_component");
+    Buffer* buffer = currently_selected_stage_->get_buffer_component();
     float* ac_min  = buffer->min_buffer_values();
 
     ui_->ac_red_min->setText(QString::number(ac_min[0]));
@@ -82,13 +84,14 @@ void MainWindow::reset_ac_min_labels()
         disable_inputs(
             {ui_->ac_green_min, ui_->ac_blue_min, ui_->ac_alpha_min});
     }
+
+    update_ac_histogram();
 }
 
 
 void MainWindow::reset_ac_max_labels()
 {
-    GameObject* buffer_obj = currently_selected_stage_->get_game_object("buffer");
-    Buffer* buffer = buffer_obj->get_component<Buffer>("buffer_component");
+    Buffer* buffer = currently_selected_stage_->get_buffer_component();
     float* ac_max  = buffer->max_buffer_values();
 
     ui_->ac_red_max->setText(QString::number(ac_max[0]));
@@ -115,6 +118,23 @@ void MainWindow::reset_ac_max_labels()
         disable_inputs(
             {ui_->ac_green_max, ui_->ac_blue_max, ui_->ac_alpha_max});
     }
+
+    update_ac_histogram();
+}
+
+
+void MainWindow::update_ac_histogram()
+{
+    if (currently_selected_stage_ == nullptr) {
+        histogram_widget_->set_histogram(nullptr);
+        return;
+    }
+
+    Buffer* buffer = currently_selected_stage_->get_buffer_component();
+
+    histogram_widget_->set_histogram(buffer->get_histogram());
+    histogram_widget_->set_ranges(buffer->min_buffer_values(),
+                                  buffer->max_buffer_values());
 }
 
 
@@ -169,16 +189,14 @@ void MainWindow::ac_alpha_max_update()
 void MainWindow::ac_min_reset()
 {
     if (currently_selected_stage_ != nullptr) {
-        GameObject* buffer_obj =
-            currently_selected_stage_->get_game_object("buffer");
-        Buffer* buff = buffer_obj->get_component<Buffer>("buffer_component");
+        Buffer* buff = currently_selected_stage_->get_buffer_component();
         buff->recompute_min_color_values();
         buff->compute_contrast_brightness_parameters();
 
         // Update inputs
         reset_ac_min_labels();
 
-        request_render_update_ = true;
+        request_render_update();
     }
 }
 
@@ -186,16 +204,14 @@ void MainWindow::ac_min_reset()
 void MainWindow::ac_max_reset()
 {
     if (currently_selected_stage_ != nullptr) {
-        GameObject* buffer_obj =
-            currently_selected_stage_->get_game_object("buffer");
-        Buffer* buff = buffer_obj->get_component<Buffer>("buffer_component");
+        Buffer* buff = currently_selected_stage_->get_buffer_component();
         buff->recompute_max_color_values();
         buff->compute_contrast_brightness_parameters();
 
         // Update inputs
         reset_ac_max_labels();
 
-        request_render_update_ = true;
+        request_render_update();
     }
 }
 
@@ -206,20 +222,109 @@ void MainWindow::ac_toggle()
     for (auto& stage : stages_)
         stage.second->contrast_enabled = ac_enabled_;
 
-    request_render_update_ = true;
+    request_render_update();
+}
+
+
+void MainWindow::ac_clip_outliers_toggle()
+{
+    ac_clip_outliers_ = !ac_clip_outliers_;
+
+    // The ranges are reset in the new mode
+    for (auto& stage : stages_) {
+        if (is_buffer_alias(stage.first)) {
+            continue;
+        }
+
+        Buffer* buff        = stage.second->get_buffer_component();
+        buff->clip_outliers = ac_clip_outliers_;
+
+        if (stage.second->components_initialized()) {
+            buff->recompute_color_range();
+            buff->compute_contrast_brightness_parameters();
+        }
+    }
+
+    if (currently_selected_stage_ != nullptr) {
+        reset_ac_min_labels();
+        reset_ac_max_labels();
+    }
+
+    request_render_update();
+}
+
+
+void MainWindow::ac_visible_range_toggle()
+{
+    ac_visible_range_only_ = !ac_visible_range_only_;
+
+    for (auto& stage : stages_) {
+        if (is_buffer_alias(stage.first)) {
+            continue;
+        }
+
+        Buffer* buff             = stage.second->get_buffer_component();
+        buff->visible_range_only = ac_visible_range_only_;
+
+        if (stage.second->components_initialized()) {
+            buff->recompute_color_range();
+            buff->compute_contrast_brightness_parameters();
+        }
+    }
+
+    if (currently_selected_stage_ != nullptr) {
+        reset_ac_min_labels();
+        reset_ac_max_labels();
+    }
+
+    request_render_update();
+}
+
+
+void MainWindow::update_visible_color_range()
+{
+    if (!ac_visible_range_only_ || currently_selected_stage_ == nullptr ||
+        !currently_selected_stage_->components_initialized()) {
+        return;
+    }
+
+    const float win_w = ui_->bufferPreview->view_width();
+    const float win_h = ui_->bufferPreview->view_height();
+
+    float min_x = numeric_limits<float>::max();
+    float min_y = numeric_limits<float>::max();
+    float max_x = numeric_limits<float>::lowest();
+    float max_y = numeric_limits<float>::lowest();
+
+    // The view may be rotated, so all of its corners are considered
+    const float corners[4][2] = {
+        {0, 0}, {win_w, 0}, {0, win_h}, {win_w, win_h}};
+    for (const auto& corner : corners) {
+        vec4 stage_pos = get_stage_coordinates(corner[0], corner[1]);
+        min_x          = min(min_x, stage_pos.x());
+        min_y          = min(min_y, stage_pos.y());
+        max_x          = max(max_x, stage_pos.x());
+        max_y          = max(max_y, stage_pos.y());
+    }
+
+    Buffer* buffer = currently_selected_stage_->get_buffer_component();
+    if (buffer->set_visible_region(min_x, min_y, max_x, max_y)) {
+        reset_ac_min_labels();
+        reset_ac_max_labels();
+        request_render_update_ = true;
+    }
 }
 
 
 void MainWindow::set_ac_min_value(int idx, float value)
 {
     if (currently_selected_stage_ != nullptr) {
-        GameObject* buffer_obj =
-            currently_selected_stage_->get_game_object("buffer");
-        Buffer* buff = buffer_obj->get_component<Buffer>("buffer_component");
+        Buffer* buff = currently_selected_stage_->get_buffer_component();
         buff->min_buffer_values()[idx] = value;
         buff->compute_contrast_brightness_parameters();
+        update_ac_histogram();
 
-        request_render_update_ = true;
+        request_render_update();
     }
 }
 
@@ -227,12 +332,11 @@ void MainWindow::set_ac_min_value(int idx, float value)
 void MainWindow::set_ac_max_value(int idx, float value)
 {
     if (currently_selected_stage_ != nullptr) {
-        GameObject* buffer_obj =
-            currently_selected_stage_->get_game_object("buffer");
-        Buffer* buff = buffer_obj->get_component<Buffer>("buffer_component");
+        Buffer* buff = currently_selected_stage_->get_buffer_component();
         buff->max_buffer_values()[idx] = value;
         buff->compute_contrast_brightness_parameters();
+        update_ac_histogram();
 
-        request_render_update_ = true;
+        request_render_update();
     }
 }
@@ -0,0 +1,147 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <iostream>
+
+#include <QAction>
+
+#include "main_window.h"
+
+
+using namespace std;
+
+
+Stage* MainWindow::difference_reference_stage() const
+{
+    if (difference_version_stage_ != nullptr) {
+        return difference_version_stage_.get();
+    }
+
+    const auto stage = stages_.find(difference_reference_name_);
+    return stage != stages_.end() ? stage->second.get() : nullptr;
+}
+
+
+bool MainWindow::is_comparing() const
+{
+    return difference_reference_stage() != nullptr;
+}
+
+
+void MainWindow::update_difference_reference()
+{
+    Stage* reference = difference_reference_stage();
+
+    // The reference is never displayed, but its textures are sampled
+    if (reference != nullptr) {
+        if (!reference->initialize_components()) {
+            cerr << "[error] Could not initialize opengl canvas!" << endl;
+        }
+        reference->restore_textures();
+    }
+
+    // Only the selected buffer is drawn compared with the reference
+    for (const auto& buffer_stage : stages_) {
+        const bool is_compared = reference != nullptr &&
+                                 buffer_stage.second.get() ==
+                                     currently_selected_stage_;
+
+        buffer_stage.second->get_buffer_component()->set_difference_reference(
+            is_compared ? reference->get_buffer_component() : nullptr,
+            difference_mode_,
+            difference_threshold_);
+    }
+
+    update_status_bar();
+    request_render_update();
+}
+
+
+void MainWindow::compare_with_buffer()
+{
+    auto sender_action(static_cast<QAction*>(sender()));
+
+    difference_reference_name_ =
+        sender_action->data().toString().toStdString();
+    difference_version_stage_.reset();
+    vector<uint8_t>().swap(difference_version_contents_);
+
+    update_difference_reference();
+}
+
+
+void MainWindow::compare_with_history_version()
+{
+    const auto history = buffer_histories_.find(history_buffer_name_);
+    if (history == buffer_histories_.end()) {
+        return;
+    }
+
+    // The past version displayed is kept in a stage of its own, which the
+    // following versions are compared with
+    const BufferHistory::Version& version =
+        history->second->version(history_position_);
+    difference_version_contents_ = history_contents_;
+
+    shared_ptr<Stage> stage = make_shared<Stage>(this);
+    if (!stage->initialize(difference_version_contents_.data(),
+                           version.width,
+                           version.height,
+                           version.channels,
+                           version.type,
+                           version.stride,
+                           version.pixel_layout,
+                           version.transpose,
+                           true)) {
+        cerr << "[error] Could not initialize opengl canvas!" << endl;
+    }
+
+    difference_version_stage_ = stage;
+    difference_reference_name_.clear();
+
+    update_difference_reference();
+}
+
+
+void MainWindow::stop_comparing()
+{
+    difference_reference_name_.clear();
+    difference_version_stage_.reset();
+    vector<uint8_t>().swap(difference_version_contents_);
+
+    update_difference_reference();
+}
+
+
+void MainWindow::set_difference_mode()
+{
+    auto sender_action(static_cast<QAction*>(sender()));
+
+    difference_mode_ =
+        static_cast<DifferenceMode>(sender_action->data().toInt());
+
+    update_difference_reference();
+    persist_settings_deferred();
+}
@@ -0,0 +1,232 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <iostream>
+
+#include <QSignalBlocker>
+
+#include "main_window.h"
+
+#include "ui_main_window.h"
+
+
+using namespace std;
+
+
+void MainWindow::record_buffer_version(const string& variable_name_str,
+                                       const BufferHistory::Version& format,
+                                       const vector<uint8_t>& contents)
+{
+    if (!history_recording_) {
+        return;
+    }
+
+    auto history = buffer_histories_.find(variable_name_str);
+    if (history == buffer_histories_.end()) {
+        unique_ptr<BufferHistory> new_history(
+            new BufferHistory(history_capacity_bytes_));
+        if (!new_history->open()) {
+            cerr << "[error] Could not create the history file of "
+                 << variable_name_str << endl;
+            return;
+        }
+
+        history = buffer_histories_
+                      .emplace(variable_name_str, std::move(new_history))
+                      .first;
+    }
+
+    if (!history->second->append(format, contents)) {
+        cerr << "[error] Buffer " << variable_name_str
+             << " is too large to be recorded" << endl;
+        return;
+    }
+
+    if (selected_buffer_name() == variable_name_str) {
+        update_history_timeline();
+    }
+}
+
+
+string MainWindow::selected_buffer_name() const
+{
+    // The versions of aliases are recorded for their source
+    for (const auto& buffer_stage : stages_) {
+        if (buffer_stage.second.get() == currently_selected_stage_ &&
+            !is_buffer_alias(buffer_stage.first)) {
+            return buffer_stage.first;
+        }
+    }
+
+    return string();
+}
+
+
+void MainWindow::update_history_timeline()
+{
+    const string buffer_name = selected_buffer_name();
+
+    const auto history = buffer_histories_.find(buffer_name);
+    const int version_count =
+        history != buffer_histories_.end()
+            ? static_cast<int>(history->second->version_count())
+            : 0;
+
+    // The last position of the slider shows the live contents
+    int position = version_count;
+    if (!buffer_name.empty() && history_buffer_name_ == buffer_name) {
+        position = static_cast<int>(history_position_);
+    }
+
+    {
+        const QSignalBlocker blocker(history_slider_);
+        history_slider_->setRange(0, version_count);
+        history_slider_->setValue(position);
+        history_slider_->setEnabled(version_count > 0);
+    }
+
+    if (position == version_count) {
+        history_label_->setText("Live");
+    } else {
+        history_label_->setText(
+            QString("%1/%2").arg(position + 1).arg(version_count));
+    }
+}
+
+
+void MainWindow::show_live_buffer()
+{
+    if (history_buffer_name_.empty()) {
+        return;
+    }
+
+    const string buffer_name = history_buffer_name_;
+    history_buffer_name_.clear();
+
+    auto buffer_stage = stages_.find(buffer_name);
+    auto held_buffer  = held_buffers_.find(buffer_name);
+
+    if (buffer_stage != stages_.end()) {
+        buffer_stage->second->get_buffer_component()->cancel_histogram();
+
+        if (held_buffer != held_buffers_.end() &&
+            !held_buffer->second.empty()) {
+            const BufferHistory::Version& live = history_live_format_;
+            buffer_stage->second->buffer_update(held_buffer->second.data(),
+                                                live.width,
+                                                live.height,
+                                                live.channels,
+                                                live.type,
+                                                live.stride,
+                                                live.pixel_layout,
+                                                live.transpose);
+        } else {
+            // The live contents were dropped once they were uploaded
+            request_plot_buffer(buffer_name.c_str());
+        }
+    }
+
+    vector<uint8_t>().swap(history_contents_);
+    request_render_update();
+}
+
+
+void MainWindow::forget_buffer_history(const string& variable_name_str)
+{
+    buffer_histories_.erase(variable_name_str);
+
+    if (history_buffer_name_ == variable_name_str) {
+        history_buffer_name_.clear();
+        vector<uint8_t>().swap(history_contents_);
+    }
+}
+
+
+void MainWindow::history_recording_toggled(bool checked)
+{
+    history_recording_ = checked;
+    persist_settings_deferred();
+}
+
+
+void MainWindow::history_position_changed(int position)
+{
+    const string buffer_name = selected_buffer_name();
+
+    const auto history      = buffer_histories_.find(buffer_name);
+    const auto buffer_stage = stages_.find(buffer_name);
+    if (history == buffer_histories_.end() || buffer_stage == stages_.end()) {
+        return;
+    }
+
+    if (position >= static_cast<int>(history->second->version_count())) {
+        show_live_buffer();
+        update_history_timeline();
+        return;
+    }
+
+    Buffer* buffer = buffer_stage->second->get_buffer_component();
+
+    // The stage must stop reading the previously displayed contents
+    buffer->cancel_histogram();
+
+    // The format of the live contents is restored once the slider is back
+    // at its end
+    if (history_buffer_name_ != buffer_name) {
+        show_live_buffer();
+
+        history_live_format_ = BufferHistory::Version{
+            string(buffer->get_pixel_layout(), 4),
+            buffer->transpose,
+            static_cast<int>(buffer->buffer_width_f),
+            static_cast<int>(buffer->buffer_height_f),
+            buffer->channels,
+            buffer->step,
+            buffer->type,
+            0,
+            {}};
+        history_buffer_name_ = buffer_name;
+    }
+
+    history_position_ = static_cast<size_t>(position);
+
+    // Only the version displayed is copied out of the history file
+    history->second->read(history_position_, history_contents_);
+
+    const BufferHistory::Version& version =
+        history->second->version(history_position_);
+    buffer->set_color_range_hint(nullptr, nullptr);
+    buffer_stage->second->buffer_update(history_contents_.data(),
+                                        version.width,
+                                        version.height,
+                                        version.channels,
+                                        version.type,
+                                        version.stride,
+                                        version.pixel_layout,
+                                        version.transpose);
+
+    update_history_timeline();
+    request_render_update();
+}
@@ -24,18 +24,26 @@
  */
 
 #include <cmath>
+#include <future>
 #include <iostream>
 
 #include <QDateTime>
 #include <QDebug>
 #include <QFontDatabase>
+#include <QMenu>
 #include <QSettings>
 #include <QShortcut>
+#include <QSlider>
+#include <QStatusBar>
+#include <QToolButton>
 #include <QHostAddress>
 
 #include "main_window.h"
 
 #include "ui_main_window.h"
+#include "ui/frame_scheduler.h"
+#include "ui/perf_overlay.h"
+#include "ipc/trace_events.h"
 
 
 void MainWindow::initialize_settings()
@@ -45,6 +53,11 @@ void MainWindow::initialize_settings()
     qRegisterMetaTypeStreamOperators<QList<BufferExpiration>>(
         "QList<QPair<QString, QDateTime>>");
 
+    // The settings file was parsed into the cache of QSettings meanwhile
+    if (settings_prefetch_.valid()) {
+        settings_prefetch_.wait();
+    }
+
     QSettings settings(QSettings::Format::IniFormat,
                        QSettings::Scope::UserScope,
                        "OpenImageDebugger");
@@ -58,6 +71,83 @@ void MainWindow::initialize_settings()
         render_framerate_ = 1.0;
     }
 
+    // Frames drawn while the view moves should keep up with the framerate
+    ui_->bufferPreview->get_frame_scheduler()->set_frame_budget(
+        1000.0 / render_framerate_);
+
+    // Load the GPU memory budget of the buffer textures, in MiB
+    const qulonglong texture_memory_budget =
+        settings.value("Rendering/texture_memory_budget", 1024)
+            .toULongLong();
+    texture_memory_budget_ = static_cast<size_t>(texture_memory_budget) << 20;
+
+    // Load whether held buffers are dropped once uploaded, to save memory
+    drop_uploaded_buffers_ =
+        settings.value("Rendering/drop_uploaded_buffers", false).toBool();
+
+    // Load the reduction of the mipmaps shown when zoomed out
+    const QString mip_reduction =
+        settings.value("Rendering/mipmap_reduction", "average").toString();
+    if (mip_reduction == "minimum") {
+        ui_->bufferPreview->set_mip_reduction(MipReduction::Minimum);
+    } else if (mip_reduction == "maximum") {
+        ui_->bufferPreview->set_mip_reduction(MipReduction::Maximum);
+    } else {
+        ui_->bufferPreview->set_mip_reduction(MipReduction::Average);
+    }
+
+    // Load whether pixel values are drawn by the buffer shader
+    ui_->bufferPreview->set_gpu_value_labels(
+        settings.value("Rendering/gpu_value_labels", false).toBool());
+
+    // Load whether the performance overlay is shown
+    ui_->bufferPreview->get_perf_overlay()->set_enabled(
+        settings.value("Rendering/perf_overlay", false).toBool());
+
+    // Load the number of views the canvas is split into
+    ui_->bufferPreview->set_split_count(
+        settings.value("Rendering/split_views", 1).toInt());
+    split_view_buffers_.resize(ui_->bufferPreview->split_count());
+
+    // Load whether the received buffers are recorded, and the size of the
+    // history file of each buffer, in MiB
+    history_recording_ = settings.value("History/record", false).toBool();
+    const qulonglong buffer_history_size =
+        settings.value("History/buffer_history_size", 256).toULongLong();
+    history_capacity_bytes_ = static_cast<size_t>(buffer_history_size) << 20;
+
+    // Load how buffers are compared, and the magnitude of the differences
+    // which are counted
+    const QString difference_mode =
+        settings.value("Difference/mode", "absolute").toString();
+    if (difference_mode == "signed") {
+        difference_mode_ = DifferenceMode::Signed;
+    } else if (difference_mode == "relative") {
+        difference_mode_ = DifferenceMode::Relative;
+    } else {
+        difference_mode_ = DifferenceMode::Absolute;
+    }
+    difference_threshold_ =
+        settings.value("Difference/threshold", 0.0).toFloat();
+
+    // Load the memory the region statistics of each buffer may take, in MiB
+    const qulonglong region_table_memory =
+        settings.value("Rendering/region_table_memory", 1024).toULongLong();
+    region_table_budget_bytes_ = static_cast<size_t>(region_table_memory)
+                                 << 20;
+
+    // Load the memory kept to receive the next versions of the buffers, in
+    // MiB
+    const qulonglong receive_pool_memory =
+        settings.value("Rendering/receive_pool_memory", 512).toULongLong();
+    receive_buffer_pool_.set_capacity(
+        static_cast<size_t>(receive_pool_memory) << 20);
+
+    // Load the size of the session snapshot, in MiB
+    const qulonglong snapshot_size =
+        settings.value("PreviousSession/snapshot_size", 64).toULongLong();
+    snapshot_capacity_bytes_ = static_cast<size_t>(snapshot_size) << 20;
+
     // Default save suffix: Image
     if (settings.contains("Export/default_export_suffix")) {
         default_export_suffix_ =
@@ -66,6 +156,11 @@ void MainWindow::initialize_settings()
         default_export_suffix_ = "Image File (*.png)";
     }
 
+    // Directory of the exports after each stop: none
+    auto_export_directory_ =
+        settings.value("Export/auto_export_directory", QString())
+            .value<QString>();
+
     // Load previous session symbols
     QDateTime now = QDateTime::currentDateTime();
     QList<BufferExpiration> previous_buffers =
@@ -153,6 +248,12 @@ void MainWindow::initialize_timers()
     settings_persist_timer_.setSingleShot(true);
 
     connect(&update_timer_, SIGNAL(timeout()), this, SLOT(loop()));
+
+    connect(&icon_debounce_timer_,
+            SIGNAL(timeout()),
+            this,
+            SLOT(update_debounced_list_items()));
+    icon_debounce_timer_.setSingleShot(true);
 }
 
 
@@ -176,6 +277,34 @@ void MainWindow::initialize_shortcuts()
         new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_L), this);
     connect(
         go_to_shortcut, SIGNAL(activated()), this, SLOT(toggle_go_to_dialog()));
+    QShortcut* perf_overlay_shortcut =
+        new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_P), this);
+    connect(perf_overlay_shortcut,
+            SIGNAL(activated()),
+            this,
+            SLOT(toggle_perf_overlay()));
+
+    QShortcut* memory_panel_shortcut =
+        new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_M), this);
+    connect(memory_panel_shortcut,
+            SIGNAL(activated()),
+            memory_dock_->toggleViewAction(),
+            SLOT(trigger()));
+
+    QShortcut* split_views_shortcut =
+        new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_G), this);
+    connect(split_views_shortcut,
+            SIGNAL(activated()),
+            this,
+            SLOT(cycle_split_views()));
+
+    QShortcut* region_clear_shortcut =
+        new QShortcut(QKeySequence(Qt::Key_Escape), ui_->bufferPreview);
+    connect(region_clear_shortcut,
+            SIGNAL(activated()),
+            this,
+            SLOT(clear_region()));
+
     connect(go_to_widget_,
             SIGNAL(go_to_requested(float, float)),
             this,
@@ -185,9 +314,61 @@ void MainWindow::initialize_shortcuts()
 
 void MainWindow::initialize_networking()
 {
-    socket_.connectToHost(QString(host_settings_.url.c_str()),
-                          host_settings_.port);
-    socket_.waitForConnected();
+    connect(
+        &daemon_server_, SIGNAL(newConnection()), this, SLOT(schedule_loop()));
+
+    // Daemons wait for bridges to connect to them
+    if (host_settings_.daemon) {
+        if (!daemon_server_.listen(QHostAddress::LocalHost) ||
+            !advertise_window_daemon(daemon_server_.serverPort())) {
+            std::cerr << "[error] Could not advertise the window daemon"
+                      << std::endl;
+        }
+        return;
+    }
+
+    // The connection started by connect_to_bridge() completes in the event
+    // loop
+    QTcpSocket& socket = session_->socket;
+    if (socket.state() == QAbstractSocket::ConnectedState) {
+        bridge_connected();
+    } else {
+        connect(&socket, SIGNAL(connected()), this, SLOT(bridge_connected()));
+    }
+}
+
+
+void MainWindow::prefetch_settings()
+{
+    settings_prefetch_ = std::async(std::launch::async, []() {
+        QSettings settings(QSettings::Format::IniFormat,
+                           QSettings::Scope::UserScope,
+                           "OpenImageDebugger");
+        settings.allKeys();
+    });
+}
+
+
+void MainWindow::connect_to_bridge()
+{
+    // Daemons wait for bridges to connect to them instead
+    if (host_settings_.daemon) {
+        return;
+    }
+
+    add_session()->socket.connectToHost(QString(host_settings_.url.c_str()),
+                                        host_settings_.port);
+}
+
+
+void MainWindow::bridge_connected()
+{
+    report_startup_phase(
+        "connect_to_bridge", process_start_us(), trace_now_us());
+
+    if (session_ != nullptr) {
+        negotiate_compression(*session_);
+    }
 }
 
 
@@ -197,8 +378,8 @@ void MainWindow::initialize_symbol_completer()
 
     symbol_completer_->setCaseSensitivity(Qt::CaseSensitivity::CaseInsensitive);
     symbol_completer_->setCompletionMode(QCompleter::PopupCompletion);
-    symbol_completer_->setModelSorting(
-        QCompleter::CaseInsensitivelySortedModel);
+    // Completions are ranked by the completer itself
+    symbol_completer_->setModelSorting(QCompleter::UnsortedModel);
 
     ui_->symbolList->set_completer(symbol_completer_);
     connect(ui_->symbolList->completer(),
@@ -210,10 +391,13 @@ void MainWindow::initialize_symbol_completer()
 
 void MainWindow::initialize_left_pane()
 {
-    connect(ui_->imageList,
-            SIGNAL(currentItemChanged(QListWidgetItem*, QListWidgetItem*)),
+    buffer_list_model_ = new BufferListModel(this);
+    ui_->imageList->setModel(buffer_list_model_);
+
+    connect(ui_->imageList->selectionModel(),
+            SIGNAL(currentChanged(const QModelIndex&, const QModelIndex&)),
             this,
-            SLOT(buffer_selected(QListWidgetItem*)));
+            SLOT(buffer_selected(const QModelIndex&)));
 
     connect(ui_->symbolList,
             SIGNAL(editingFinished()),
@@ -274,6 +458,37 @@ void MainWindow::initialize_auto_contrast_form()
 
     connect(ui_->ac_reset_min, SIGNAL(clicked()), this, SLOT(ac_min_reset()));
     connect(ui_->ac_reset_max, SIGNAL(clicked()), this, SLOT(ac_max_reset()));
+
+    QToolButton* ac_clip_outliers = new QToolButton(ui_->minMaxEditor);
+    ac_clip_outliers->setCheckable(true);
+    ac_clip_outliers->setText("%");
+    ac_clip_outliers->setToolTip(
+        "Reset auto contrast levels to the 0.5th and 99.5th percentiles of "
+        "the buffer values, instead of their extremes, so that a few "
+        "outliers don't flatten the image.");
+    ui_->gridLayout->addWidget(ac_clip_outliers, 0, 10, 1, 1);
+
+    connect(ac_clip_outliers,
+            SIGNAL(clicked()),
+            this,
+            SLOT(ac_clip_outliers_toggle()));
+
+    QToolButton* ac_visible_range = new QToolButton(ui_->minMaxEditor);
+    ac_visible_range->setCheckable(true);
+    ac_visible_range->setText("V");
+    ac_visible_range->setToolTip(
+        "Reset auto contrast levels to the extremes of the values in view, "
+        "following the view as it moves, instead of those of the whole "
+        "buffer.");
+    ui_->gridLayout->addWidget(ac_visible_range, 1, 10, 1, 1);
+
+    connect(ac_visible_range,
+            SIGNAL(clicked()),
+            this,
+            SLOT(ac_visible_range_toggle()));
+
+    histogram_widget_ = new HistogramWidget(ui_->minMaxEditor);
+    ui_->gridLayout->addWidget(histogram_widget_, 0, 11, 2, 1);
 }
 
 
@@ -318,3 +533,75 @@ void MainWindow::initialize_go_to_widget()
 {
     go_to_widget_ = new GoToWidget(ui_->bufferPreview);
 }
+
+
+void MainWindow::initialize_history_timeline()
+{
+    history_record_button_ = new QToolButton(this);
+    history_record_button_->setText("Record");
+    history_record_button_->setToolTip(
+        "Record the buffers received at each stop, to go back to them");
+    history_record_button_->setCheckable(true);
+    history_record_button_->setChecked(history_recording_);
+
+    history_slider_ = new QSlider(Qt::Horizontal, this);
+    history_slider_->setMinimumWidth(160);
+    history_slider_->setRange(0, 0);
+    history_slider_->setEnabled(false);
+
+    history_label_ = new QLabel("Live", this);
+
+    statusBar()->addPermanentWidget(history_record_button_);
+    statusBar()->addPermanentWidget(history_slider_);
+    statusBar()->addPermanentWidget(history_label_);
+
+    connect(history_record_button_,
+            SIGNAL(toggled(bool)),
+            this,
+            SLOT(history_recording_toggled(bool)));
+
+    connect(history_slider_,
+            SIGNAL(valueChanged(int)),
+            this,
+            SLOT(history_position_changed(int)));
+}
+
+
+void MainWindow::initialize_memory_panel()
+{
+    memory_panel_ = new MemoryPanel(this);
+
+    memory_dock_ = new QDockWidget("Memory", this);
+    memory_dock_->setObjectName("memory_dock");
+    memory_dock_->setWidget(memory_panel_);
+    addDockWidget(Qt::RightDockWidgetArea, memory_dock_);
+    memory_dock_->hide();
+
+    QMenu* view_menu = ui_->menubar->addMenu("View");
+    view_menu->addAction(memory_dock_->toggleViewAction());
+
+    connect(memory_dock_,
+            SIGNAL(visibilityChanged(bool)),
+            this,
+            SLOT(memory_panel_visibility_changed(bool)));
+
+    // The panel only needs to follow uploads and evictions roughly
+    memory_panel_timer_.setInterval(500);
+    connect(&memory_panel_timer_,
+            SIGNAL(timeout()),
+            this,
+            SLOT(update_memory_panel()));
+
+    connect(memory_panel_,
+            SIGNAL(drop_gpu_requested(const QString&)),
+            this,
+            SLOT(drop_buffer_textures(const QString&)));
+    connect(memory_panel_,
+            SIGNAL(drop_cpu_requested(const QString&)),
+            this,
+            SLOT(drop_buffer_contents(const QString&)));
+    connect(memory_panel_,
+            SIGNAL(remove_requested(const QString&)),
+            this,
+            SLOT(remove_panel_buffer(const QString&)));
+}
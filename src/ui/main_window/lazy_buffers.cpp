@@ -0,0 +1,540 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "main_window.h"
+
+#include "ipc/raw_data_decode.h"
+#include "ipc/tile_delta.h"
+#include "ui_main_window.h"
+#include "visualization/components/camera.h"
+#include "visualization/game_object.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Width/height of the tiles of lazy buffers, in pixels of their level
+const int lazy_tile_size = 512;
+
+// Largest number of pixels of the overview of a lazy buffer
+const long long max_overview_pixels = 1 << 20;
+
+
+int div_up(int value, int divisor)
+{
+    return (value + divisor - 1) / divisor;
+}
+
+
+LazyTileRange full_tile_range(int width, int height, int level)
+{
+    const int tile_span = lazy_tile_size * level;
+    return LazyTileRange{
+        level, 0, 0, (width - 1) / tile_span, (height - 1) / tile_span};
+}
+
+} // namespace
+
+
+bool LazyTileRange::operator==(const LazyTileRange& other) const
+{
+    return level == other.level && x0 == other.x0 && y0 == other.y0 &&
+           x1 == other.x1 && y1 == other.y1;
+}
+
+
+bool LazyTileRange::operator!=(const LazyTileRange& other) const
+{
+    return !(*this == other);
+}
+
+
+void MainWindow::plot_lazy_buffer(const string& variable_name_str,
+                                  const string& display_name_str,
+                                  const string& pixel_layout_str,
+                                  bool transpose_buffer,
+                                  int buff_width,
+                                  int buff_height,
+                                  int buff_channels,
+                                  BufferType buff_type,
+                                  bool streamed)
+{
+    if (buff_width <= 0 || buff_height <= 0) {
+        return;
+    }
+
+    const bool is_new_buffer = stages_.find(variable_name_str) == stages_.end();
+
+    // A new plot of a lazy buffer with the same layout keeps displaying the
+    // previous contents until the new tiles arrive
+    auto previous_state   = lazy_buffers_.find(variable_name_str);
+    const bool keeps_view = !is_new_buffer &&
+                            previous_state != lazy_buffers_.end() &&
+                            previous_state->second.width == buff_width &&
+                            previous_state->second.height == buff_height &&
+                            previous_state->second.channels == buff_channels &&
+                            previous_state->second.type == buff_type;
+
+    int overview_level = 1;
+    while (static_cast<long long>(div_up(buff_width, overview_level)) *
+               div_up(buff_height, overview_level) >
+           max_overview_pixels) {
+        overview_level *= 2;
+    }
+
+    if (!keeps_view) {
+        // Display a blank overview until its tiles arrive
+        const int overview_width  = div_up(buff_width, overview_level);
+        const int overview_height = div_up(buff_height, overview_level);
+
+        vector<uint8_t> overview_contents(
+            static_cast<size_t>(overview_width) *
+            static_cast<size_t>(overview_height) *
+            static_cast<size_t>(buff_channels) * typesize(buff_type));
+
+        update_buffer(variable_name_str,
+                      display_name_str,
+                      pixel_layout_str,
+                      transpose_buffer,
+                      overview_width,
+                      overview_height,
+                      buff_channels,
+                      overview_width,
+                      buff_type,
+                      overview_contents);
+
+        stages_[variable_name_str]->set_display_region(
+            buff_width, buff_height, 0, 0, overview_level, is_new_buffer);
+    }
+
+    LazyBufferState& state = lazy_buffers_[variable_name_str];
+
+    state.display_name   = display_name_str;
+    state.pixel_layout   = pixel_layout_str;
+    state.transpose      = transpose_buffer;
+    state.width          = buff_width;
+    state.height         = buff_height;
+    state.channels       = buff_channels;
+    state.type           = buff_type;
+    state.overview_level = overview_level;
+    state.view_complete  = false;
+
+    // The previously fetched tiles belong to the previous contents
+    state.tiles.clear();
+    state.requested_tiles.clear();
+
+    state.streamed      = streamed;
+    state.streamed_rows = 0;
+    state.stream_rows.clear();
+
+    if (!keeps_view) {
+        state.view = full_tile_range(buff_width, buff_height, overview_level);
+
+        // Human readable dimensions
+        update_buffer_list_item(variable_name_str,
+                                display_name_str,
+                                transpose_buffer ? buff_height : buff_width,
+                                transpose_buffer ? buff_width : buff_height,
+                                buff_channels,
+                                buff_type);
+    }
+}
+
+
+void MainWindow::receive_buffer_region(const string& variable_name_str,
+                                       int region_x,
+                                       int region_y,
+                                       int region_width,
+                                       int region_height,
+                                       int factor,
+                                       vector<uint8_t>& region_contents)
+{
+    auto lazy_buffer = lazy_buffers_.find(variable_name_str);
+    if (lazy_buffer == lazy_buffers_.end() || factor < 1) {
+        return;
+    }
+    LazyBufferState& state = lazy_buffer->second;
+
+    const int tile_span = lazy_tile_size * factor;
+    if (region_x % tile_span != 0 || region_y % tile_span != 0) {
+        return;
+    }
+
+    const TileKey key{factor, region_x / tile_span, region_y / tile_span};
+    state.requested_tiles.erase(key);
+
+    const size_t expected_length =
+        static_cast<size_t>(div_up(region_width, factor)) *
+        static_cast<size_t>(div_up(region_height, factor)) *
+        static_cast<size_t>(state.channels) * typesize(state.type);
+
+    if (region_contents.size() != expected_length) {
+        cerr << "[error] Received region of unexpected size for buffer "
+             << variable_name_str << endl;
+        return;
+    }
+
+    narrow_buffer_to_held_type(state.type, region_contents);
+
+    state.tiles.insert(key, std::move(region_contents));
+}
+
+
+void MainWindow::receive_buffer_chunk(const string& variable_name_str,
+                                      int chunk_y,
+                                      int chunk_height,
+                                      vector<uint8_t>& chunk_contents)
+{
+    auto lazy_buffer = lazy_buffers_.find(variable_name_str);
+    if (lazy_buffer == lazy_buffers_.end()) {
+        return;
+    }
+    LazyBufferState& state = lazy_buffer->second;
+
+    if (!state.streamed || chunk_y != state.streamed_rows) {
+        return;
+    }
+
+    const size_t row_length = static_cast<size_t>(state.width) *
+                              static_cast<size_t>(state.channels) *
+                              typesize(state.type);
+
+    if (chunk_height <= 0 || chunk_y + chunk_height > state.height ||
+        chunk_contents.size() !=
+            row_length * static_cast<size_t>(chunk_height)) {
+        // The bridge could not read the rest of the buffer; its tiles are
+        // only fetched as they are displayed
+        if (chunk_height > 0) {
+            cerr << "[error] Received chunk of unexpected size for buffer "
+                 << variable_name_str << endl;
+        }
+        state.streamed = false;
+        vector<uint8_t>().swap(state.stream_rows);
+        return;
+    }
+
+    narrow_buffer_to_held_type(state.type, chunk_contents);
+
+    const size_t pixel_size = held_pixel_size(state.type, state.channels);
+    const size_t held_row_length = static_cast<size_t>(state.width) *
+                                   pixel_size;
+
+    // The rows left over by the previous chunks start a row of tiles
+    vector<uint8_t>& rows = state.stream_rows;
+    if (rows.empty()) {
+        rows = std::move(chunk_contents);
+    } else {
+        rows.insert(rows.end(), chunk_contents.begin(), chunk_contents.end());
+    }
+    state.streamed_rows += chunk_height;
+
+    const int num_rows = static_cast<int>(rows.size() / held_row_length);
+    const int rows_y   = state.streamed_rows - num_rows;
+
+    // Cut every complete row of tiles into tiles of level 1
+    int cut_rows = 0;
+    while (cut_rows < num_rows) {
+        const int tile_y      = rows_y + cut_rows;
+        const int tile_height = min(lazy_tile_size, state.height - tile_y);
+        if (num_rows - cut_rows < tile_height) {
+            break;
+        }
+
+        const uint8_t* tile_rows =
+            rows.data() + static_cast<size_t>(cut_rows) * held_row_length;
+        for (int tx = 0; tx * lazy_tile_size < state.width; ++tx) {
+            const TileRegion region{
+                tx * lazy_tile_size,
+                0,
+                min(lazy_tile_size, state.width - tx * lazy_tile_size),
+                tile_height};
+
+            vector<uint8_t> tile;
+            pack_tile(tile_rows, state.width, pixel_size, region, tile);
+
+            // Tiles which don't fit anymore are fetched again if displayed
+            state.tiles.insert_prefetched(
+                TileKey{1, tx, tile_y / lazy_tile_size}, std::move(tile));
+        }
+
+        cut_rows += tile_height;
+    }
+
+    if (state.streamed_rows == state.height) {
+        state.streamed = false;
+        vector<uint8_t>().swap(rows);
+    } else {
+        rows.erase(rows.begin(),
+                   rows.begin() + static_cast<ptrdiff_t>(
+                                      static_cast<size_t>(cut_rows) *
+                                      held_row_length));
+    }
+}
+
+
+void MainWindow::update_lazy_buffers()
+{
+    for (auto& lazy_buffer : lazy_buffers_) {
+        auto buffer_stage = stages_.find(lazy_buffer.first);
+        if (buffer_stage == stages_.end()) {
+            continue;
+        }
+
+        LazyBufferState& state = lazy_buffer.second;
+
+        // Only the selected buffer follows the camera
+        LazyTileRange range = state.view;
+        if (buffer_stage->second.get() == currently_selected_stage_) {
+            range = get_visible_tile_range(state);
+        }
+
+        if (range == state.view && state.view_complete) {
+            continue;
+        }
+
+        // Keep displaying the current view until all of its replacement
+        // tiles have arrived
+        if (request_lazy_tiles(lazy_buffer.first, state, range)) {
+            show_lazy_view(lazy_buffer.first, state, range);
+        }
+    }
+}
+
+
+LazyTileRange MainWindow::get_visible_tile_range(const LazyBufferState& state)
+{
+    Camera* cam = currently_selected_stage_->get_camera_component();
+
+    // Coarsest level which still has at least one buffer pixel per screen
+    // pixel
+    const float zoom = cam->compute_zoom();
+    int level        = 1;
+    while (level < state.overview_level && 2.f * level * zoom <= 1.f) {
+        level *= 2;
+    }
+
+    if (level == state.overview_level) {
+        return full_tile_range(state.width, state.height, level);
+    }
+
+    const float win_w = ui_->bufferPreview->view_width();
+    const float win_h = ui_->bufferPreview->view_height();
+
+    float min_x = numeric_limits<float>::max();
+    float min_y = numeric_limits<float>::max();
+    float max_x = numeric_limits<float>::lowest();
+    float max_y = numeric_limits<float>::lowest();
+
+    // The view may be rotated, so all of its corners are considered
+    const float corners[4][2] = {
+        {0, 0}, {win_w, 0}, {0, win_h}, {win_w, win_h}};
+    for (const auto& corner : corners) {
+        vec4 stage_pos = get_stage_coordinates(corner[0], corner[1]);
+        min_x          = min(min_x, stage_pos.x());
+        min_y          = min(min_y, stage_pos.y());
+        max_x          = max(max_x, stage_pos.x());
+        max_y          = max(max_y, stage_pos.y());
+    }
+
+    min_x = max(min_x, 0.f);
+    min_y = max(min_y, 0.f);
+    max_x = min(max_x, static_cast<float>(state.width - 1));
+    max_y = min(max_y, static_cast<float>(state.height - 1));
+
+    if (min_x > max_x || min_y > max_y) {
+        // The buffer is out of sight
+        return state.view;
+    }
+
+    const int tile_span = lazy_tile_size * level;
+    return LazyTileRange{level,
+                         static_cast<int>(min_x) / tile_span,
+                         static_cast<int>(min_y) / tile_span,
+                         static_cast<int>(max_x) / tile_span,
+                         static_cast<int>(max_y) / tile_span};
+}
+
+
+bool MainWindow::request_lazy_tiles(const string& variable_name_str,
+                                    LazyBufferState& state,
+                                    const LazyTileRange& range)
+{
+    string session_buffer_name;
+    BridgeSession* session =
+        buffer_session(variable_name_str, session_buffer_name);
+    if (session == nullptr) {
+        // Nothing else can be fetched once the bridge disconnected
+        return true;
+    }
+
+    const int tile_span = lazy_tile_size * range.level;
+
+    bool all_tiles_cached = true;
+    bool has_requests     = false;
+
+    MessageComposer message_composer;
+    for (int ty = range.y0; ty <= range.y1; ++ty) {
+        for (int tx = range.x0; tx <= range.x1; ++tx) {
+            const TileKey key{range.level, tx, ty};
+            if (state.tiles.contains(key)) {
+                continue;
+            }
+
+            all_tiles_cached = false;
+
+            if (!state.requested_tiles.insert(key).second) {
+                // Already on its way
+                continue;
+            }
+
+            const int region_x = tx * tile_span;
+            const int region_y = ty * tile_span;
+            message_composer.push(MessageType::RequestBufferRegion)
+                .push(session_buffer_name)
+                .push(region_x)
+                .push(region_y)
+                .push(min(tile_span, state.width - region_x))
+                .push(min(tile_span, state.height - region_y))
+                .push(range.level)
+                .push(session->stop_generation);
+            has_requests = true;
+        }
+    }
+
+    if (has_requests) {
+        message_composer.send_async(session->send_queue);
+    }
+
+    return all_tiles_cached;
+}
+
+
+void MainWindow::show_lazy_view(const string& variable_name_str,
+                                LazyBufferState& state,
+                                const LazyTileRange& range)
+{
+    const size_t pixel_size = held_pixel_size(state.type, state.channels);
+
+    const int tile_span = lazy_tile_size * range.level;
+
+    // Dimensions of the view, in pixels of its level
+    const int view_x = range.x0 * lazy_tile_size;
+    const int view_y = range.y0 * lazy_tile_size;
+    const int view_width =
+        div_up(min((range.x1 + 1) * tile_span, state.width), range.level) -
+        view_x;
+    const int view_height =
+        div_up(min((range.y1 + 1) * tile_span, state.height), range.level) -
+        view_y;
+
+    vector<uint8_t> view_contents(static_cast<size_t>(view_width) *
+                                  static_cast<size_t>(view_height) *
+                                  pixel_size);
+
+    for (int ty = range.y0; ty <= range.y1; ++ty) {
+        for (int tx = range.x0; tx <= range.x1; ++tx) {
+            // Tiles evicted in the meantime are left blank
+            const vector<uint8_t>* tile =
+                state.tiles.find(TileKey{range.level, tx, ty});
+            if (tile == nullptr) {
+                continue;
+            }
+
+            const int tile_width = div_up(
+                min(tile_span, state.width - tx * tile_span), range.level);
+            const int tile_height = div_up(
+                min(tile_span, state.height - ty * tile_span), range.level);
+            const size_t tile_row_size =
+                static_cast<size_t>(tile_width) * pixel_size;
+
+            uint8_t* dst =
+                view_contents.data() +
+                (static_cast<size_t>((ty - range.y0) * lazy_tile_size) *
+                     static_cast<size_t>(view_width) +
+                 static_cast<size_t>((tx - range.x0) * lazy_tile_size)) *
+                    pixel_size;
+
+            for (int row = 0; row < tile_height; ++row) {
+                memcpy(dst + static_cast<size_t>(row) *
+                                 static_cast<size_t>(view_width) * pixel_size,
+                       tile->data() + static_cast<size_t>(row) * tile_row_size,
+                       tile_row_size);
+            }
+        }
+    }
+
+    shared_ptr<Stage>& stage = stages_[variable_name_str];
+
+    // The stage must stop reading the previous contents before they are
+    // freed, and not take a range computed from them
+    stage->get_buffer_component()->cancel_histogram();
+    stage->get_buffer_component()->set_color_range_hint(nullptr, nullptr);
+
+    vector<uint8_t>& held_buffer = held_buffers_[variable_name_str];
+    held_buffer                  = std::move(view_contents);
+
+    stage->buffer_update(held_buffer.data(),
+                         view_width,
+                         view_height,
+                         state.channels,
+                         state.type,
+                         view_width,
+                         state.pixel_layout,
+                         state.transpose);
+    stage->set_display_region(state.width,
+                              state.height,
+                              range.x0 * tile_span,
+                              range.y0 * tile_span,
+                              range.level,
+                              false);
+
+    state.view          = range;
+    state.view_complete = true;
+
+    touch_stage_textures(variable_name_str);
+    enforce_texture_budget();
+
+    if (range ==
+        full_tile_range(state.width, state.height, state.overview_level)) {
+        // Human readable dimensions
+        update_buffer_list_item(variable_name_str,
+                                state.display_name,
+                                state.transpose ? state.height : state.width,
+                                state.transpose ? state.width : state.height,
+                                state.channels,
+                                state.type);
+    } else if (stage.get() == currently_selected_stage_) {
+        reset_ac_min_labels();
+        reset_ac_max_labels();
+    }
+
+    request_render_update();
+}
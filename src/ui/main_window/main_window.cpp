@@ -23,7 +23,11 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iomanip>
+#include <iostream>
 
 #include <QAction>
 #include <QDateTime>
@@ -33,9 +37,13 @@
 #include "main_window.h"
 
 #include "ui_main_window.h"
+#include "ui/frame_scheduler.h"
+#include "ui/perf_overlay.h"
+#include "ui/texture_uploader.h"
 #include "visualization/components/camera.h"
 #include "visualization/game_object.h"
 #include "ipc/message_exchange.h"
+#include "ipc/trace_events.h"
 
 
 using namespace std;
@@ -49,31 +57,82 @@ MainWindow::MainWindow(const ConnectionSettings& host_settings,
     : QMainWindow(parent)
     , is_window_ready_(false)
     , request_render_update_(true)
-    , completer_updated_(false)
     , ac_enabled_(true)
+    , ac_clip_outliers_(false)
+    , ac_visible_range_only_(false)
     , link_views_enabled_(false)
     , icon_width_base_(100)
     , icon_height_base_(50)
+    , auto_export_pending_(false)
     , currently_selected_stage_(nullptr)
     , ui_(new Ui::MainWindowUi)
+    , buffer_list_model_(nullptr)
+    , memory_dock_(nullptr)
+    , memory_panel_(nullptr)
     , host_settings_(host_settings)
+    , session_(nullptr)
+    , is_receiving_payload_(false)
+    , payload_ends_message_(true)
+    , receiving_progress_(-1)
+    , payload_reports_progress_(true)
+    , message_request_id_(0)
+    , payload_request_id_(0)
+    , payload_begin_us_(0.0)
+    , finish_decoded_message_(false)
+    , batch_messages_remaining_(0)
+    , texture_memory_budget_(0)
+    , drop_uploaded_buffers_(false)
+    , is_first_buffer_reported_(false)
+    , history_recording_(false)
+    , history_capacity_bytes_(0)
+    , history_position_(0)
+    , history_record_button_(nullptr)
+    , history_slider_(nullptr)
+    , history_label_(nullptr)
+    , difference_mode_(DifferenceMode::Absolute)
+    , difference_threshold_(0.f)
+    , has_region_(false)
+    , is_selecting_region_(false)
+    , region_table_budget_bytes_(0)
+    , snapshot_capacity_bytes_(0)
 {
+    StartupPhase construction_phase("construct_window");
+
+    // The bridge is connected to and the settings are read while the UI is
+    // built, which doesn't depend on either
+    prefetch_settings();
+    connect_to_bridge();
+
     QCoreApplication::instance()->installEventFilter(this);
 
-    ui_->setupUi(this);
-
-    initialize_ui_icons();
-    initialize_timers();
-    initialize_symbol_completer();
-    initialize_left_pane();
-    initialize_auto_contrast_form();
-    initialize_toolbar();
-    initialize_status_bar();
-    initialize_visualization_pane();
-    initialize_settings();
-    initialize_go_to_widget();
-    initialize_shortcuts();
-    initialize_networking();
+#define TIMED_INITIALIZATION(initializer)   \
+    {                                       \
+        StartupPhase startup(#initializer); \
+        initializer();                      \
+    }
+
+    {
+        StartupPhase startup("setup_ui");
+        ui_->setupUi(this);
+    }
+
+    TIMED_INITIALIZATION(initialize_ui_icons);
+    TIMED_INITIALIZATION(initialize_timers);
+    TIMED_INITIALIZATION(initialize_symbol_completer);
+    TIMED_INITIALIZATION(initialize_left_pane);
+    TIMED_INITIALIZATION(initialize_auto_contrast_form);
+    TIMED_INITIALIZATION(initialize_toolbar);
+    TIMED_INITIALIZATION(initialize_status_bar);
+    TIMED_INITIALIZATION(initialize_visualization_pane);
+    TIMED_INITIALIZATION(initialize_settings);
+    TIMED_INITIALIZATION(initialize_go_to_widget);
+    TIMED_INITIALIZATION(initialize_memory_panel);
+    TIMED_INITIALIZATION(initialize_history_timeline);
+    TIMED_INITIALIZATION(initialize_shortcuts);
+    TIMED_INITIALIZATION(show_session_snapshot);
+    TIMED_INITIALIZATION(initialize_networking);
+
+#undef TIMED_INITIALIZATION
 
     is_window_ready_ = true;
 }
@@ -81,24 +140,66 @@ MainWindow::MainWindow(const ConnectionSettings& host_settings,
 
 MainWindow::~MainWindow()
 {
+    // Stages may still be reading the held buffers in the background
+    for (const auto& stage : stages_) {
+        stage.second->get_buffer_component()->cancel_histogram();
+    }
+
     held_buffers_.clear();
     is_window_ready_ = false;
 
+    if (host_settings_.daemon) {
+        withdraw_window_daemon();
+    }
+
     delete ui_;
 }
 
 
 void MainWindow::show()
 {
-    update_timer_.start(static_cast<int>(1000.0 / render_framerate_));
     QMainWindow::show();
+    schedule_loop();
 }
 
 
 void MainWindow::draw()
 {
-    if (currently_selected_stage_ != nullptr) {
+    if (ui_->bufferPreview->split_count() > 1) {
+        draw_split_views();
+    } else if (currently_selected_stage_ != nullptr) {
         currently_selected_stage_->draw();
+
+        draw_region_outline();
+    }
+
+    if (currently_selected_stage_ != nullptr) {
+        if (!is_first_buffer_reported_) {
+            report_startup_phase(
+                "first_buffer", process_start_us(), trace_now_us());
+            is_first_buffer_reported_ = true;
+        }
+    }
+
+    PerfOverlay* perf_overlay = ui_->bufferPreview->get_perf_overlay();
+    if (perf_overlay->is_enabled()) {
+        size_t texture_bytes = 0;
+        for (const auto& buffer_stage : stages_) {
+            if (!is_buffer_alias(buffer_stage.first)) {
+                texture_bytes += buffer_stage.second->texture_bytes();
+            }
+        }
+
+        size_t held_bytes = 0;
+        for (const auto& held_buffer : held_buffers_) {
+            held_bytes += held_buffer.second.size();
+        }
+
+        perf_overlay->set_memory(texture_bytes, held_bytes);
+    }
+
+    if (host_settings_.report_frames) {
+        report_displayed_frames();
     }
 }
 
@@ -125,17 +226,70 @@ bool MainWindow::is_window_ready()
 
 void MainWindow::loop()
 {
-    decode_incoming_messages();
+    // Close application if server has disconnected. Daemons keep running
+    // until the next bridge connects, and serve all bridges connected to
+    // them at once.
+    if (host_settings_.daemon) {
+        accept_bridge_connections();
+    }
+
+    remove_disconnected_sessions();
+    if (!host_settings_.daemon && sessions_.empty()) {
+        save_session_snapshot();
+        QApplication::quit();
+    }
 
-    if (completer_updated_) {
-        // Update auto-complete suggestion list
-        symbol_completer_->update_symbol_list(available_vars_);
-        completer_updated_ = false;
+    pump_send_queues();
+
+    // Icons read back since the previous iteration are ready by now
+    finish_pending_icons();
+
+    // Buffers are decoded in the background while the window stays
+    // responsive
+    apply_decoded_buffer();
+
+    // Large buffers are uploaded over several frames, which display more of
+    // their tiles each time
+    if (ui_->bufferPreview->upload_pending_textures()) {
+        report_finished_texture_uploads();
+        update_pending_upload_list_items();
+        request_render_update_ = true;
     }
 
+    update_lazy_buffers();
+
+    update_visible_color_range();
+
+    update_plot_priorities();
+
+    symbol_completer_->update_index();
+
     // Run update for current stage
     if (currently_selected_stage_ != nullptr) {
+        const bool statistics_pending =
+            currently_selected_stage_->has_pending_statistics();
+
         currently_selected_stage_->update();
+
+        // Buffer statistics are read back from the GPU asynchronously
+        if (statistics_pending &&
+            !currently_selected_stage_->has_pending_statistics()) {
+            reset_ac_min_labels();
+            reset_ac_max_labels();
+            update_status_bar();
+            request_render_update_ = true;
+        }
+    }
+
+    drop_uploaded_contents();
+
+    update_export_progress();
+
+    // The passes deferred while the view moved run once it stopped
+    if (ui_->bufferPreview->get_frame_scheduler()->take_deferred_passes()) {
+        apply_pending_linked_drag();
+        update_debounced_list_items();
+        request_render_update_ = true;
     }
 
     if (request_render_update_) {
@@ -144,12 +298,158 @@ void MainWindow::loop()
 
         request_render_update_ = false;
     }
+
+    // Only keep looping at the maximum framerate while something animates
+    if (!is_animating()) {
+        update_timer_.stop();
+    }
+}
+
+
+void MainWindow::schedule_loop()
+{
+    if (!isVisible() || update_timer_.isActive()) {
+        return;
+    }
+
+    // Handle the request right away
+    QTimer::singleShot(0, this, SLOT(loop()));
+    update_timer_.start(static_cast<int>(1000.0 / render_framerate_));
+}
+
+
+bool MainWindow::is_animating()
+{
+    const bool stage_needs_update = currently_selected_stage_ != nullptr &&
+                                    currently_selected_stage_->needs_update();
+
+    return request_render_update_ || stage_needs_update ||
+           ui_->bufferPreview->get_frame_scheduler()->is_deferring() ||
+           !ui_->bufferPreview->get_texture_uploader()->empty() ||
+           has_queued_messages() || !pending_icons_.empty() ||
+           buffer_decoder_.is_pending() || buffer_exporter_.is_pending() ||
+           KeyboardState::is_any_key_pressed();
+}
+
+
+void MainWindow::update_pending_upload_list_items()
+{
+    for (auto list_update = pending_upload_list_updates_.begin();
+         list_update != pending_upload_list_updates_.end();) {
+        auto buffer_stage = stages_.find(list_update->first);
+        if (buffer_stage == stages_.end()) {
+            list_update = pending_upload_list_updates_.erase(list_update);
+        } else if (!buffer_stage->second->has_pending_uploads()) {
+            const function<void()> update = list_update->second;
+            list_update = pending_upload_list_updates_.erase(list_update);
+            update();
+        } else {
+            ++list_update;
+        }
+    }
+
+    // Stages whose icon was rendered can now be evicted
+    enforce_texture_budget();
+}
+
+
+void MainWindow::report_finished_texture_uploads()
+{
+    for (auto upload = texture_upload_begin_us_.begin();
+         upload != texture_upload_begin_us_.end();) {
+        auto buffer_stage = stages_.find(upload->first);
+        if (buffer_stage == stages_.end()) {
+            upload = texture_upload_begin_us_.erase(upload);
+        } else if (!buffer_stage->second->has_pending_uploads()) {
+            const double end_us = trace_now_us();
+            trace_event("texture_upload",
+                        buffer_request_ids_[upload->first],
+                        upload->second,
+                        end_us,
+                        upload->first);
+            ui_->bufferPreview->get_perf_overlay()->set_update_step(
+                PerfOverlay::UpdateStep::Upload,
+                (end_us - upload->second) / 1000.0);
+            upload = texture_upload_begin_us_.erase(upload);
+        } else {
+            ++upload;
+        }
+    }
+}
+
+
+void MainWindow::report_displayed_frames()
+{
+    // Steady clock timestamps can be compared to those of the process
+    // reading them on the same machine
+    const long long now_ns =
+        chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch())
+            .count();
+
+    for (auto report = frame_reports_.begin();
+         report != frame_reports_.end();) {
+        const auto stage = stages_.find(report->first);
+        if (stage == stages_.end()) {
+            report = frame_reports_.erase(report);
+            continue;
+        }
+
+        if (stage->second.get() != currently_selected_stage_) {
+            ++report;
+            continue;
+        }
+
+        if (!report->second.first_displayed) {
+            cout << "[frame] first " << now_ns << " " << report->first
+                 << endl;
+            report->second.first_displayed = true;
+        }
+
+        if (report->second.complete &&
+            !currently_selected_stage_->has_pending_uploads()) {
+            cout << "[frame] complete " << now_ns << " " << report->first
+                 << endl;
+            report = frame_reports_.erase(report);
+            continue;
+        }
+
+        ++report;
+    }
+}
+
+
+void MainWindow::update_export_progress()
+{
+    if (!buffer_exporter_.is_pending()) {
+        return;
+    }
+
+    stringstream message;
+
+    bool succeeded;
+    if (!buffer_exporter_.poll(succeeded)) {
+        message << "[exporting "
+                << static_cast<int>(100.f * buffer_exporter_.progress())
+                << "%]";
+    } else if (succeeded) {
+        message << "Exported " << buffer_exporter_.path();
+    } else if (buffer_exporter_.cancelled()) {
+        message << "[export cancelled]";
+    } else {
+        cerr << "[error] Could not export buffer to "
+             << buffer_exporter_.path() << endl;
+        message << "[error] Could not export buffer";
+    }
+
+    status_bar_->setText(message.str().c_str());
 }
 
 
 void MainWindow::request_render_update()
 {
     request_render_update_ = true;
+    schedule_loop();
 }
 
 
@@ -177,7 +477,8 @@ void MainWindow::persist_settings()
         const string buff_name_std_str = prev_buff.first.toStdString();
 
         const bool being_viewed =
-            held_buffers_.find(buff_name_std_str) != held_buffers_.end();
+            held_buffers_.find(buff_name_std_str) != held_buffers_.end() ||
+            is_buffer_alias(buff_name_std_str);
         const bool was_removed =
             removed_buffer_names_.find(buff_name_std_str) !=
             removed_buffer_names_.end();
@@ -193,13 +494,79 @@ void MainWindow::persist_settings()
         persisted_session_buffers.append(
             BufferExpiration(held_buffer.first.c_str(), next_expiration));
     }
+    for (const auto& alias : buffer_aliases_) {
+        persisted_session_buffers.append(
+            BufferExpiration(alias.first.c_str(), next_expiration));
+    }
 
     // Write default suffix for buffer export
     settings.setValue("Export/default_export_suffix", default_export_suffix_);
 
+    // Write directory of the exports after each stop
+    settings.setValue("Export/auto_export_directory", auto_export_directory_);
+
     // Write maximum framerate
     settings.setValue("Rendering/maximum_framerate", render_framerate_);
 
+    // Write texture memory budget
+    settings.setValue("Rendering/texture_memory_budget",
+                      static_cast<qulonglong>(texture_memory_budget_ >> 20));
+
+    // Write whether held buffers are dropped after upload
+    settings.setValue("Rendering/drop_uploaded_buffers",
+                      drop_uploaded_buffers_);
+
+    // Write mipmap reduction
+    const MipReduction mip_reduction = ui_->bufferPreview->mip_reduction();
+    if (mip_reduction == MipReduction::Minimum) {
+        settings.setValue("Rendering/mipmap_reduction", "minimum");
+    } else if (mip_reduction == MipReduction::Maximum) {
+        settings.setValue("Rendering/mipmap_reduction", "maximum");
+    } else {
+        settings.setValue("Rendering/mipmap_reduction", "average");
+    }
+
+    // Write whether pixel values are drawn by the buffer shader
+    settings.setValue("Rendering/gpu_value_labels",
+                      ui_->bufferPreview->gpu_value_labels());
+
+    // Write whether the performance overlay is shown
+    settings.setValue("Rendering/perf_overlay",
+                      ui_->bufferPreview->get_perf_overlay()->is_enabled());
+
+    settings.setValue("Rendering/split_views",
+                      ui_->bufferPreview->split_count());
+
+    // Write whether the received buffers are recorded, and the size of
+    // their history files
+    settings.setValue("History/record", history_recording_);
+    settings.setValue("History/buffer_history_size",
+                      static_cast<qulonglong>(history_capacity_bytes_ >> 20));
+
+    // Write how buffers are compared
+    if (difference_mode_ == DifferenceMode::Signed) {
+        settings.setValue("Difference/mode", "signed");
+    } else if (difference_mode_ == DifferenceMode::Relative) {
+        settings.setValue("Difference/mode", "relative");
+    } else {
+        settings.setValue("Difference/mode", "absolute");
+    }
+    settings.setValue("Difference/threshold", difference_threshold_);
+
+    // Write the memory the region statistics of each buffer may take
+    settings.setValue(
+        "Rendering/region_table_memory",
+        static_cast<qulonglong>(region_table_budget_bytes_ >> 20));
+
+    // Write the memory kept to receive the next versions of the buffers
+    settings.setValue(
+        "Rendering/receive_pool_memory",
+        static_cast<qulonglong>(receive_buffer_pool_.capacity() >> 20));
+
+    // Write the size of the session snapshot
+    settings.setValue("PreviousSession/snapshot_size",
+                      static_cast<qulonglong>(snapshot_capacity_bytes_ >> 20));
+
     // Write previous session symbols
     settings.setValue("PreviousSession/buffers",
                       QVariant::fromValue(persisted_session_buffers));
@@ -218,26 +585,23 @@ void MainWindow::persist_settings()
 
 vec4 MainWindow::get_stage_coordinates(float pos_window_x, float pos_window_y)
 {
-    GameObject* cam_obj = currently_selected_stage_->get_game_object("camera");
-    Camera* cam         = cam_obj->get_component<Camera>("camera_component");
+    Camera* cam = currently_selected_stage_->get_camera_component();
 
-    GameObject* buffer_obj =
-        currently_selected_stage_->get_game_object("buffer");
-    Buffer* buffer = buffer_obj->get_component<Buffer>("buffer_component");
+    GameObject* buffer_obj = currently_selected_stage_->get_buffer_object();
+    Buffer* buffer         = currently_selected_stage_->get_buffer_component();
 
-    float win_w = ui_->bufferPreview->width();
-    float win_h = ui_->bufferPreview->height();
+    float win_w = ui_->bufferPreview->view_width();
+    float win_h = ui_->bufferPreview->view_height();
     vec4 mouse_pos_ndc(2.0f * (pos_window_x - win_w / 2) / win_w,
                        -2.0f * (pos_window_y - win_h / 2) / win_h,
                        0,
                        1);
-    mat4 view      = cam_obj->get_pose().inv();
-    mat4 buff_pose = buffer_obj->get_pose();
-    mat4 vp_inv    = (cam->projection * view * buff_pose).inv();
+    const mat4 vp_inv =
+        buffer_obj->get_pose_inverse() * cam->get_view_projection_inverse();
 
     vec4 mouse_pos = vp_inv * mouse_pos_ndc;
-    mouse_pos +=
-        vec4(buffer->buffer_width_f / 2.f, buffer->buffer_height_f / 2.f, 0, 0);
+    mouse_pos += vec4(
+        buffer->display_width_f / 2.f, buffer->display_height_f / 2.f, 0, 0);
 
     return mouse_pos;
 }
@@ -248,13 +612,9 @@ void MainWindow::update_status_bar()
     if (currently_selected_stage_ != nullptr) {
         stringstream message;
 
-        GameObject* cam_obj =
-            currently_selected_stage_->get_game_object("camera");
-        Camera* cam = cam_obj->get_component<Camera>("camera_component");
+        Camera* cam = currently_selected_stage_->get_camera_component();
 
-        GameObject* buffer_obj =
-            currently_selected_stage_->get_game_object("buffer");
-        Buffer* buffer = buffer_obj->get_component<Buffer>("buffer_component");
+        Buffer* buffer = currently_selected_stage_->get_buffer_component();
 
         float mouse_x = ui_->bufferPreview->mouse_x();
         float mouse_y = ui_->bufferPreview->mouse_y();
@@ -272,6 +632,26 @@ void MainWindow::update_status_bar()
             static_cast<int>(floor(mouse_pos.x())),
             static_cast<int>(floor(mouse_pos.y())));
 
+        // Largest differences with the reference, and how many are above
+        // the threshold, per channel
+        DifferenceStatistics difference;
+        if (buffer->get_difference_statistics(difference)) {
+            message << "\tmax diff=[";
+            for (int c = 0; c < buffer->channels; ++c) {
+                message << (c > 0 ? " " : "")
+                        << max(abs(difference.lowest[c]),
+                               abs(difference.upper[c]));
+            }
+            message << "] above " << difference_threshold_ << "=[";
+            for (int c = 0; c < buffer->channels; ++c) {
+                message << (c > 0 ? " " : "")
+                        << difference.above_threshold[c];
+            }
+            message << "]";
+        }
+
+        append_region_statistics(message);
+
         status_bar_->setText(message.str().c_str());
     }
 }
@@ -298,6 +678,14 @@ string MainWindow::get_type_label(BufferType type, int channels)
         result << "int32";
     } else if (type == BufferType::Float64) {
         result << "float64";
+    } else if (type == BufferType::Float16) {
+        result << "float16";
+    } else if (type == BufferType::Int8) {
+        result << "int8";
+    } else if (type == BufferType::UnsignedInt32) {
+        result << "uint32";
+    } else if (type == BufferType::Int64) {
+        result << "int64";
     }
     result << "x" << channels;
 
@@ -313,6 +701,30 @@ void MainWindow::persist_settings_deferred()
 
 void MainWindow::set_currently_selected_stage(Stage* stage)
 {
+    // The drags held back only skipped the stage displayed until now
+    apply_pending_linked_drag();
+
     currently_selected_stage_ = stage;
-    request_render_update_    = true;
+    request_render_update();
+
+    if (stage == nullptr) {
+        return;
+    }
+
+    // Stages are only initialized once they are displayed
+    if (!stage->initialize_components()) {
+        cerr << "[error] Could not initialize opengl canvas!" << endl;
+    }
+
+    // The textures of the stage may have been released to save GPU memory
+    stage->restore_textures();
+
+    for (const auto& buffer_stage : stages_) {
+        if (buffer_stage.second.get() == stage) {
+            touch_stage_textures(buffer_stage.first);
+            break;
+        }
+    }
+
+    enforce_texture_budget();
 }
@@ -26,20 +26,37 @@
 #ifndef MAIN_WINDOW_H_
 #define MAIN_WINDOW_H_
 
+#include <chrono>
 #include <deque>
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <sstream>
 #include <string>
 
+#include <QDockWidget>
 #include <QLabel>
-#include <QListWidgetItem>
 #include <QMainWindow>
+#include <QModelIndex>
+#include <QSlider>
 #include <QTimer>
 #include <QTcpSocket>
+#include <QToolButton>
 
+#include "io/buffer_exporter.h"
+#include "ipc/window_daemon.h"
 #include "math/linear_algebra.h"
+#include "ui/buffer_decoder.h"
+#include "ui/buffer_history.h"
+#include "ui/buffer_list_model.h"
 #include "ui/go_to_widget.h"
+#include "ui/histogram_widget.h"
+#include "ui/lazy_tile_cache.h"
+#include "ui/memory_panel.h"
+#include "ui/receive_buffer_pool.h"
 #include "ui/symbol_completer.h"
 #include "visualization/stage.h"
 
@@ -52,6 +69,87 @@ class MainWindowUi;
 struct ConnectionSettings {
     std::string url;
     uint16_t port;
+    std::string compression; // auto, none, fast or best
+
+    // Keep running between debug sessions, and accept the connections of new
+    // bridges instead of connecting to one
+    bool daemon;
+
+    // Print when the received buffers are first and completely displayed,
+    // for benchmarks
+    bool report_frames;
+};
+
+// Range of tiles of a lazy buffer, downsampled by a factor of level
+struct LazyTileRange {
+    int level;
+    int x0;
+    int y0;
+    int x1; // inclusive
+    int y1; // inclusive
+
+    bool operator==(const LazyTileRange& other) const;
+    bool operator!=(const LazyTileRange& other) const;
+};
+
+// Buffers too large to be sent up front. Only the tiles covered by the view
+// are fetched from the bridge, unless the bridge streams their rows, whose
+// tiles then fill the free capacity of the cache.
+struct LazyBufferState {
+    std::string display_name;
+    std::string pixel_layout;
+    bool transpose;
+    int width;
+    int height;
+    int channels;
+    BufferType type;
+
+    // Smallest downsampling level at which the whole buffer is displayed
+    int overview_level;
+
+    LazyTileCache tiles;
+    std::set<TileKey> requested_tiles;
+
+    // Rows received while the bridge streams the buffer; the ones which don't
+    // fill a whole row of tiles yet are kept in stream_rows
+    bool streamed;
+    int streamed_rows;
+    std::vector<uint8_t> stream_rows;
+
+    // Tiles currently displayed by the buffer stage
+    LazyTileRange view;
+    bool view_complete;
+};
+
+// Connection of a bridge to the window. The buffers of the first session
+// keep their names, while those of the sessions connected alongside it are
+// prefixed with their number (as in "2:image").
+struct BridgeSession {
+    explicit BridgeSession(int session_number);
+
+    // Names of symbols of the bridge in the window
+    QStringList window_symbols(const QStringList& symbols) const;
+
+    int number;
+    std::string name_prefix;
+
+    QTcpSocket socket;
+    MessageSendQueue send_queue;
+
+    // Symbols of the bridge, without the prefix, and their version, which
+    // the bridge sends the changes of. Once an update is missed, all symbols
+    // are requested again.
+    QStringList available_vars;
+    int available_symbols_version;
+    bool available_symbols_requested;
+
+    // Number of times the inferior stopped, as counted by the bridge. Regions
+    // requested before the last stop are out of date.
+    int stop_generation;
+
+    // Last buffer priorities sent to the bridge
+    std::string prioritized_selected_buffer;
+    std::deque<std::string> prioritized_visible_buffers;
 };
 
 
@@ -86,6 +184,13 @@ class MainWindow : public QMainWindow
 
     void reset_ac_max_labels();
 
+    // Show the histogram of the selected buffer, and its contrast ranges
+    void update_ac_histogram();
+
+    // Give the region in view to the selected buffer, whose ranges follow it
+    // when only the visible values are considered
+    void update_visible_color_range();
+
     ///
     // General UI Events - implemented in ui_events.cpp
     void resize_callback(int w, int h);
@@ -96,6 +201,10 @@ class MainWindow : public QMainWindow
 
     void mouse_move_event(int mouse_x, int mouse_y);
 
+    // Apply the drags held back from the linked stages which aren't
+    // displayed, before anything else moves them
+    void apply_pending_linked_drag();
+
     // Window change events - only called after the event is finished
     bool eventFilter(QObject* target, QEvent* event);
 
@@ -105,11 +214,20 @@ class MainWindow : public QMainWindow
 
     void closeEvent(QCloseEvent*);
 
+    ///
+    // Split views - implemented in split_view.cpp
+    // Make a view of the split canvas the active one, which displays the
+    // selected buffer
+    void split_cell_selected(int cell);
+
 public Q_SLOTS:
     ///
     // Assorted methods - slots - implemented in main_window.cpp
     void loop();
 
+    // Run the loop soon, if it is idle
+    void schedule_loop();
+
     void request_render_update();
 
     ///
@@ -136,6 +254,10 @@ public Q_SLOTS:
 
     void ac_toggle();
 
+    void ac_clip_outliers_toggle();
+
+    void ac_visible_range_toggle();
+
     ///
     // General UI Events - slots - implemented in ui_events.cpp
     void recenter_buffer();
@@ -146,34 +268,99 @@ public Q_SLOTS:
 
     void rotate_90_ccw();
 
-    void buffer_selected(QListWidgetItem* item);
+    void buffer_selected(const QModelIndex& index);
 
     void remove_selected_buffer();
 
+    void remove_buffer(const std::string& buffer_name);
+
     void symbol_selected();
 
     void symbol_completed(QString str);
 
     void export_buffer();
 
+    void export_all_buffers();
+
+    void cancel_export();
+
     void show_context_menu(const QPoint& pos);
 
     void toggle_go_to_dialog();
 
+    void toggle_perf_overlay();
+
     void go_to_pixel(float x, float y);
 
+    ///
+    // Split views - slots - implemented in split_view.cpp
+    // Go from a single view to two, four, and back
+    void cycle_split_views();
+
   private Q_SLOTS:
     ///
     // Assorted methods - private slots - implemented in main_window.cpp
     void persist_settings();
 
+    ///
+    // Communication with debugger bridge - private slots - implemented in
+    // message_processing.cpp
+    void decode_incoming_messages();
+
+    // Run the list item updates held back by the icon debouncing
+    void update_debounced_list_items();
+
+    void bridge_connected();
+
+    ///
+    // Memory panel - private slots - implemented in texture_budget.cpp
+    void update_memory_panel();
+
+    void memory_panel_visibility_changed(bool visible);
+
+    void drop_buffer_textures(const QString& name);
+
+    void drop_buffer_contents(const QString& name);
+
+    void remove_panel_buffer(const QString& name);
+
+    ///
+    // History timeline - private slots - implemented in history.cpp
+    void history_recording_toggled(bool checked);
+
+    // Display a recorded version of the selected buffer, or its live
+    // contents at the end of the timeline
+    void history_position_changed(int position);
+
+    ///
+    // Difference view - private slots - implemented in difference.cpp
+    // Compare the selected buffer with the one the sender action holds the
+    // name of
+    void compare_with_buffer();
+
+    // Compare the selected buffer with the past version it displays
+    void compare_with_history_version();
+
+    void stop_comparing();
+
+    void set_difference_mode();
+
+    ///
+    // Region statistics - private slots - implemented in region.cpp
+    void clear_region();
+
   private:
     bool is_window_ready_;
     bool request_render_update_;
-    bool completer_updated_;
     bool ac_enabled_;
+    bool ac_clip_outliers_;
+    bool ac_visible_range_only_;
     bool link_views_enabled_;
 
+    // Drags of the linked stages which aren't displayed, held back while the
+    // frame scheduler defers the passes which can wait
+    QPoint pending_linked_drag_;
+
     const int icon_width_base_;
     const int icon_height_base_;
 
@@ -184,27 +371,166 @@ public Q_SLOTS:
 
     QString default_export_suffix_;
 
+    // All held buffers are exported to a directory below this one after
+    // each stop, unless it is empty
+    QString auto_export_directory_;
+    bool auto_export_pending_;
+
     Stage* currently_selected_stage_;
 
     std::map<std::string, std::vector<uint8_t>> held_buffers_;
     std::map<std::string, std::shared_ptr<Stage>> stages_;
 
+    // Source buffer of each alias (a buffer plotted from the same memory
+    // under another name), whose contents and stage it shares
+    std::map<std::string, std::string> buffer_aliases_;
+
     std::set<std::string> previous_session_buffers_;
     std::set<std::string> removed_buffer_names_;
 
-    QStringList available_vars_;
-
     std::mutex ui_mutex_;
 
     SymbolCompleter* symbol_completer_;
 
     Ui::MainWindowUi* ui_;
 
+    BufferListModel* buffer_list_model_;
+
     QLabel* status_bar_;
     GoToWidget* go_to_widget_;
+    HistogramWidget* histogram_widget_;
+    QDockWidget* memory_dock_;
+    MemoryPanel* memory_panel_;
+
+    // Refreshes the memory panel while it is shown
+    QTimer memory_panel_timer_;
 
     ConnectionSettings host_settings_;
-    QTcpSocket socket_;
+    BufferExporter buffer_exporter_;
+    WindowDaemonServer daemon_server_;
+
+    // Connected bridges by number, and the one whose messages are being
+    // decoded. The sessions take turns in between messages.
+    std::map<int, std::unique_ptr<BridgeSession>> sessions_;
+    BridgeSession* session_;
+
+    // State of the buffer payload currently being received
+    bool is_receiving_payload_;
+    bool payload_ends_message_;
+    int receiving_progress_;
+    bool payload_reports_progress_;
+    PayloadReceiver payload_receiver_;
+    std::vector<uint8_t> pending_payload_;
+
+    // Previous contents of the held buffers, which receive their next
+    // versions
+    ReceiveBufferPool receive_buffer_pool_;
+    std::string receiving_buffer_name_;
+    std::string receiving_display_name_;
+    std::function<void(std::vector<uint8_t>&)> on_payload_received_;
+
+    // Tracing of plot requests: the request of the message being decoded,
+    // the latest request of each buffer, and the start of the texture
+    // uploads still pending (which are also measured by the perf overlay)
+    uint64_t message_request_id_;
+    uint64_t payload_request_id_;
+    double payload_begin_us_;
+    std::map<std::string, uint64_t> buffer_request_ids_;
+    std::map<std::string, double> texture_upload_begin_us_;
+
+    // Complete buffers are decoded in a worker thread, and the message
+    // holding the one being decoded is finished once it was applied
+    BufferDecoder buffer_decoder_;
+    bool finish_decoded_message_;
+
+    // Number of messages of the current PlotBufferBatch yet to be received
+    size_t batch_messages_remaining_;
+    std::map<std::string, std::function<void()>> deferred_list_updates_;
+
+    // List items whose icon waits for the buffer textures to be uploaded
+    std::map<std::string, std::function<void()>> pending_upload_list_updates_;
+
+    // Icons being read back from the GPU, which are set on the next
+    // iteration of the loop
+    struct PendingIcon
+    {
+        GLuint pixel_buffer;
+        int width;
+        int height;
+        std::string label;
+    };
+    std::map<std::string, PendingIcon> pending_icons_;
+
+    // List items of buffers updated again shortly after their last icon,
+    // until the debounce timer runs out
+    std::map<std::string, std::function<void()>> debounced_list_updates_;
+    std::map<std::string, std::chrono::steady_clock::time_point>
+        icon_update_times_;
+    QTimer icon_debounce_timer_;
+
+    std::map<std::string, LazyBufferState> lazy_buffers_;
+
+    // Textures of the least recently displayed stages are released when
+    // all stages hold more than the budget, in bytes
+    std::size_t texture_memory_budget_;
+
+    // The held buffers are freed once they were uploaded
+    bool drop_uploaded_buffers_;
+    std::deque<std::string> texture_lru_;
+
+    // Buffers received but not completely displayed yet, when frames are
+    // reported
+    struct FrameReport
+    {
+        bool first_displayed;
+        bool complete;
+    };
+    std::map<std::string, FrameReport> frame_reports_;
+
+    // Settings file, parsed in the background while the UI is built
+    std::future<void> settings_prefetch_;
+
+    bool is_first_buffer_reported_;
+
+    // Versions of the buffers received while recording, each in a history
+    // file capped to history_capacity_bytes_. A single buffer at a time
+    // displays a past version, which is copied out of its history file.
+    bool history_recording_;
+    std::size_t history_capacity_bytes_;
+    std::map<std::string, std::unique_ptr<BufferHistory>> buffer_histories_;
+    std::string history_buffer_name_;
+    std::size_t history_position_;
+    std::vector<uint8_t> history_contents_;
+    BufferHistory::Version history_live_format_;
+
+    QToolButton* history_record_button_;
+    QSlider* history_slider_;
+    QLabel* history_label_;
+
+    // The selected buffer is drawn compared with another buffer, or with a
+    // past version of a buffer held by a stage of its own
+    std::string difference_reference_name_;
+    std::shared_ptr<Stage> difference_version_stage_;
+    std::vector<uint8_t> difference_version_contents_;
+    DifferenceMode difference_mode_;
+    float difference_threshold_;
+
+    // Region of interest, dragged with Shift held, between the scene
+    // coordinates of its corners. Its statistics are queried from tables
+    // whose size is capped to region_table_budget_bytes_ per buffer.
+    bool has_region_;
+    bool is_selecting_region_;
+    float region_begin_[2];
+    float region_end_[2];
+    std::size_t region_table_budget_bytes_;
+
+    // Size of the downsampled copies of the held buffers saved when the
+    // window closes, and shown by the next one until they are replotted
+    std::size_t snapshot_capacity_bytes_;
+
+    // Buffers drawn by each view of the split canvas. The active view draws
+    // the selected stage, which may be a past version of its buffer.
+    std::vector<std::string> split_view_buffers_;
 
     ///
     // Assorted methods - private - implemented in main_window.cpp
@@ -216,22 +542,338 @@ public Q_SLOTS:
 
     void persist_settings_deferred();
 
+    void update_pending_upload_list_items();
+
+    // Trace and measure the texture uploads that were completed
+    void report_finished_texture_uploads();
+
+    // Print the frames displaying the received buffers for the first time,
+    // and in full once all of their textures were uploaded
+    void report_displayed_frames();
+
+    // Report the progress of the export running in the background
+    void update_export_progress();
+
+    // Render the buffer of stage as displayed, at a scale chosen by the
+    // user, and save it to file_name
+    void export_displayed_buffer(Stage* stage, const std::string& file_name);
+
+    // Export all held buffers, in the default export format, to directory
+    bool start_bulk_export(const QString& directory);
+
+    // Something changes without any event, e.g. textures being uploaded or
+    // held keys moving the camera
+    bool is_animating();
+
     void set_currently_selected_stage(Stage* stage);
 
     vec4 get_stage_coordinates(float pos_window_x, float pos_window_y);
 
     ///
     // Communication with debugger bridge
-    void decode_set_available_symbols();
+    // The decode_* methods return false, without side effects, if the
+    // message hasn't completely arrived yet
+    bool decode_set_available_symbols();
+
+    bool decode_set_available_symbols_diff();
+
+    // Plot the symbols that were held in the previous session
+    void request_previous_session_buffers(const QStringList& symbols);
 
     void respond_get_observed_symbols();
 
-    void decode_plot_buffer_contents();
+    bool decode_plot_buffer_contents();
 
-    void decode_incoming_messages();
+    bool decode_plot_buffer_contents_shared();
+
+    bool decode_plot_buffer_preview();
+
+    // Narrow the contents and compute their ranges in the background, and
+    // then update the buffer with them from apply_decoded_buffer
+    void decode_buffer(const std::string& variable_name_str,
+                       const std::string& display_name_str,
+                       const std::string& pixel_layout_str,
+                       bool transpose_buffer,
+                       int buff_width,
+                       int buff_height,
+                       int buff_channels,
+                       int buff_stride,
+                       BufferType buff_type,
+                       std::vector<uint8_t>& buff_contents);
+
+    void apply_decoded_buffer();
+
+    // When frames are reported, the received buffer is displayed right away
+    // so that the time until it is on screen can be measured
+    void report_received_buffer(const std::string& variable_name_str,
+                                bool complete);
+
+    // The contents are held as they are, so double buffers must already be
+    // narrowed. The ranges, if they were computed from them, can be null.
+    void update_buffer(const std::string& variable_name_str,
+                       const std::string& display_name_str,
+                       const std::string& pixel_layout_str,
+                       bool transpose_buffer,
+                       int buff_width,
+                       int buff_height,
+                       int buff_channels,
+                       int buff_stride,
+                       BufferType buff_type,
+                       std::vector<uint8_t>& buff_contents,
+                       const float* lowest = nullptr,
+                       const float* upper  = nullptr);
+
+    bool decode_plot_buffer_tiles();
+
+    void apply_buffer_tiles(const std::string& variable_name_str,
+                            const std::string& display_name_str,
+                            const std::string& pixel_layout_str,
+                            bool transpose_buffer,
+                            int buff_width,
+                            int buff_height,
+                            int buff_channels,
+                            int buff_stride,
+                            BufferType buff_type,
+                            const std::vector<TileRegion>& tiles,
+                            std::vector<uint8_t>& tile_contents);
+
+    void update_buffer_list_item(const std::string& variable_name_str,
+                                 const std::string& display_name_str,
+                                 int visualized_width,
+                                 int visualized_height,
+                                 int buff_channels,
+                                 BufferType buff_type);
+
+    void set_buffer_list_item(const std::string& variable_name_str,
+                              const std::string& label,
+                              const std::vector<uint8_t>& icon,
+                              int icon_width,
+                              int icon_height);
+
+    void finish_pending_icon(
+        const std::pair<const std::string, PendingIcon>& pending_icon);
+
+    void finish_pending_icons();
+
+    void schedule_debounced_list_items();
+
+    void start_payload(
+        const std::string& variable_name_str,
+        const std::string& display_name_str,
+        size_t length,
+        std::function<void(std::vector<uint8_t>&)> on_received,
+        bool ends_message     = true,
+        bool reports_progress = true);
+
+    bool receive_payload();
+
+    bool decode_plot_buffer_batch();
+
+    bool decode_plot_buffer_lazy();
+
+    bool decode_plot_buffer_region();
+
+    bool decode_plot_buffer_chunk();
+
+    bool decode_set_stop_generation();
+
+    bool decode_plot_buffer_unavailable();
+
+    bool decode_plot_buffer_alias();
+
+    bool decode_message(const MessageHeader& header);
+
+    void finish_batch_message();
+
+    void update_transfer_progress();
+
+    // Decode the next message, or the next part of the current one, of the
+    // session whose turn it is. Returns false if nothing could be decoded.
+    bool decode_next_message();
 
     void request_plot_buffer(const char* buffer_name);
 
+    void update_plot_priorities();
+
+    ///
+    // Bridge sessions - private - implemented in sessions.cpp
+    BridgeSession* add_session();
+
+    // In daemon mode, serve the new bridges alongside the connected ones
+    void accept_bridge_connections();
+
+    void negotiate_compression(BridgeSession& session);
+
+    // Sessions are removed once their messages were all decoded. Their
+    // buffers stay displayed.
+    void remove_disconnected_sessions();
+
+    void remove_session(BridgeSession* session);
+
+    // Whether the session whose turn it is is in the middle of a message or
+    // of a batch, which other sessions have to wait for
+    bool is_decoding_message() const;
+
+    void select_next_session();
+
+    // Turn the name given to a buffer by the bridge whose messages are being
+    // decoded into its name in the window
+    void add_session_prefix(std::string& buffer_name) const;
+
+    // Session which plotted the buffer named buffer_name in the window, and
+    // the name of the buffer in that session. Null if it has disconnected.
+    BridgeSession* buffer_session(const std::string& buffer_name,
+                                  std::string& session_buffer_name);
+
+    void send_buffer_message(MessageType type, const std::string& buffer_name);
+
+    // Symbols of all sessions, with their prefixes
+    QStringList available_symbols() const;
+
+    void pump_send_queues();
+
+    bool has_queued_messages() const;
+
+    ///
+    // Lazy buffers - private - implemented in lazy_buffers.cpp
+    void plot_lazy_buffer(const std::string& variable_name_str,
+                          const std::string& display_name_str,
+                          const std::string& pixel_layout_str,
+                          bool transpose_buffer,
+                          int buff_width,
+                          int buff_height,
+                          int buff_channels,
+                          BufferType buff_type,
+                          bool streamed);
+
+    void receive_buffer_region(const std::string& variable_name_str,
+                               int region_x,
+                               int region_y,
+                               int region_width,
+                               int region_height,
+                               int factor,
+                               std::vector<uint8_t>& region_contents);
+
+    void receive_buffer_chunk(const std::string& variable_name_str,
+                              int chunk_y,
+                              int chunk_height,
+                              std::vector<uint8_t>& chunk_contents);
+
+    void update_lazy_buffers();
+
+    LazyTileRange get_visible_tile_range(const LazyBufferState& state);
+
+    bool request_lazy_tiles(const std::string& variable_name_str,
+                            LazyBufferState& state,
+                            const LazyTileRange& range);
+
+    void show_lazy_view(const std::string& variable_name_str,
+                        LazyBufferState& state,
+                        const LazyTileRange& range);
+
+    ///
+    // Texture memory budget - private - implemented in texture_budget.cpp
+    void touch_stage_textures(const std::string& variable_name_str);
+    void enforce_texture_budget();
+
+    // Stages which are not displayed can have their textures released as
+    // long as they can be uploaded again
+    bool can_release_textures(const std::string& variable_name_str,
+                              Stage* stage) const;
+
+    bool can_drop_held_buffer(const std::string& variable_name_str,
+                              Stage* stage) const;
+
+    // Free the held buffers whose textures hold everything still needed
+    void drop_uploaded_contents();
+
+    void drop_held_buffer(const std::string& variable_name_str);
+
+    ///
+    // History timeline - private - implemented in history.cpp
+    void record_buffer_version(const std::string& variable_name_str,
+                               const BufferHistory::Version& format,
+                               const std::vector<uint8_t>& contents);
+
+    std::string selected_buffer_name() const;
+
+    // Follow the versions recorded for the selected buffer
+    void update_history_timeline();
+
+    // Display the live contents of the buffer showing a past version again
+    void show_live_buffer();
+
+    void forget_buffer_history(const std::string& variable_name_str);
+
+    ///
+    // Difference view - private - implemented in difference.cpp
+    Stage* difference_reference_stage() const;
+
+    bool is_comparing() const;
+
+    // Compare the selected buffer with the reference, if any, and the
+    // other buffers with nothing
+    void update_difference_reference();
+
+    ///
+    // Session snapshot - private - implemented in snapshot.cpp
+    // Show the buffers of the previous session saved in the snapshot, if
+    // they are going to be plotted again
+    void show_session_snapshot();
+
+    void save_session_snapshot();
+
+    ///
+    // Split views - private - implemented in split_view.cpp
+    void set_split_view_count(int count);
+
+    // Display a buffer in a view, whose stage is made ready to be drawn
+    void show_in_split_view(int cell, const std::string& variable_name_str);
+
+    // Views without a buffer display the listed buffers which aren't
+    // displayed yet
+    void fill_split_views();
+
+    // Stage drawn by a view, or nullptr if it is empty
+    Stage* split_view_stage(int cell);
+
+    bool is_in_split_view(const std::string& variable_name_str) const;
+
+    // Name of the row selected in the buffer list, which may be an alias
+    std::string selected_list_buffer_name() const;
+
+    void draw_split_views();
+
+    ///
+    // Region statistics - private - implemented in region.cpp
+    // Resize the region while Shift is held, or false if the drag moves the
+    // view instead
+    bool drag_region(int delta_x, int delta_y);
+
+    void get_region_bounds(int& x0, int& y0, int& x1, int& y1) const;
+
+    // Statistics of the region in the selected buffer, for the status bar
+    void append_region_statistics(std::stringstream& message);
+
+    void draw_region_outline();
+
+    ///
+    // Buffer aliases - private - implemented in aliases.cpp
+    void plot_buffer_alias(const std::string& alias_name_str,
+                           const std::string& display_name_str,
+                           const std::string& source_name_str);
+
+    // Aliases hold no contents of their own, and loops over stages_ skip
+    // them so that each stage is only visited once
+    bool is_buffer_alias(const std::string& variable_name_str) const;
+
+    // Stop sharing the stage of the source of an alias, before it gets its
+    // own contents. Returns whether the buffer was an alias.
+    bool detach_buffer_alias(const std::string& variable_name_str);
+
+    // Before a buffer is removed, its first alias takes over its contents
+    void remove_buffer_aliases(const std::string& variable_name_str);
+
     ///
     // Auto contrast pane - private - implemented in auto_contrast.cpp
     void set_ac_min_value(int idx, float value);
@@ -262,6 +904,16 @@ public Q_SLOTS:
 
     void initialize_go_to_widget();
 
+    void initialize_memory_panel();
+
+    void initialize_history_timeline();
+
+    // Start parsing the settings file in the background
+    void prefetch_settings();
+
+    // Start connecting to the bridge, which is finished by the event loop
+    void connect_to_bridge();
+
     void initialize_networking();
 };
 
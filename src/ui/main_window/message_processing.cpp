@@ -23,51 +23,292 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <chrono>
+
+#include <QDir>
+#include <QSet>
+
 #include "main_window.h"
 
+#include "ipc/shared_buffer.h"
+#include "ipc/tile_delta.h"
+#include "ipc/trace_events.h"
 #include "ui_main_window.h"
+#include "ui/frame_scheduler.h"
+#include "ui/perf_overlay.h"
+#include "visualization/game_object.h"
+#include "visualization/thumbnail.h"
 
 using namespace std;
 
 
-void MainWindow::decode_set_available_symbols()
+namespace
+{
+
+// Shortest time between two icon updates of a buffer
+const auto icon_debounce_interval = chrono::milliseconds(250);
+
+} // namespace
+
+
+bool MainWindow::decode_set_available_symbols()
+{
+    QStringList available_vars;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read<QStringList, QString>(available_vars);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(ui_mutex_);
+    session_->available_vars = available_vars;
+
+    // The changes that follow can't be applied to this unversioned list
+    session_->available_symbols_version = 0;
+
+    symbol_completer_->update_symbol_list(available_symbols());
+
+    request_previous_session_buffers(session_->window_symbols(available_vars));
+
+    return true;
+}
+
+
+bool MainWindow::decode_set_available_symbols_diff()
 {
+    int version;
+    int base_version;
+    QStringList added_symbols;
+    QStringList removed_symbols;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(version)
+        .read(base_version)
+        .read<QStringList, QString>(added_symbols)
+        .read<QStringList, QString>(removed_symbols);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    // A base version of 0 replaces all symbols
+    if (base_version != 0 &&
+        base_version != session_->available_symbols_version) {
+        if (!session_->available_symbols_requested) {
+            MessageComposer message_composer;
+            message_composer.push(MessageType::RequestAvailableSymbols)
+                .send_async(session_->send_queue);
+            session_->available_symbols_requested = true;
+        }
+        return true;
+    }
+
     std::unique_lock<std::mutex> lock(ui_mutex_);
-    MessageDecoder message_decoder(&socket_);
-    message_decoder.read<QStringList, QString>(available_vars_);
 
-    for (const auto& symbol_value : available_vars_) {
+    QStringList& available_vars = session_->available_vars;
+    if (base_version == 0) {
+        available_vars = added_symbols;
+        symbol_completer_->update_symbol_list(available_symbols());
+        session_->available_symbols_requested = false;
+    } else {
+        QSet<QString> removed_set;
+        for (const QString& symbol : removed_symbols) {
+            removed_set.insert(symbol);
+        }
+
+        available_vars.erase(
+            remove_if(available_vars.begin(),
+                      available_vars.end(),
+                      [&removed_set](const QString& symbol) {
+                          return removed_set.contains(symbol);
+                      }),
+            available_vars.end());
+        available_vars.append(added_symbols);
+
+        symbol_completer_->apply_symbol_changes(
+            session_->window_symbols(added_symbols),
+            session_->window_symbols(removed_symbols));
+    }
+
+    session_->available_symbols_version = version;
+
+    // Symbols that were already available had their buffers requested then
+    request_previous_session_buffers(session_->window_symbols(added_symbols));
+
+    return true;
+}
+
+
+void MainWindow::request_previous_session_buffers(const QStringList& symbols)
+{
+    for (const auto& symbol_value : symbols) {
         // Plot buffer if it was available in the previous session
         if (previous_session_buffers_.find(symbol_value.toStdString()) !=
             previous_session_buffers_.end()) {
             request_plot_buffer(symbol_value.toStdString().data());
         }
     }
-
-    completer_updated_ = true;
 }
 
 
 void MainWindow::respond_get_observed_symbols()
 {
+    // Each bridge only replots the buffers it plotted
+    vector<string> observed_names;
+    string session_buffer_name;
+    for (const auto& name : held_buffers_) {
+        if (buffer_session(name.first, session_buffer_name) == session_) {
+            observed_names.push_back(session_buffer_name);
+        }
+    }
+    for (const auto& alias : buffer_aliases_) {
+        if (buffer_session(alias.first, session_buffer_name) == session_) {
+            observed_names.push_back(session_buffer_name);
+        }
+    }
+
     MessageComposer message_composer;
     message_composer.push(MessageType::GetObservedSymbolsResponse)
-        .push(held_buffers_.size());
-    for (const auto& name : held_buffers_) {
-        message_composer.push(name.first);
+        .push(observed_names.size());
+    for (const auto& name : observed_names) {
+        message_composer.push(name);
     }
-    message_composer.send(&socket_);
+    message_composer.send_async(session_->send_queue);
 }
 
 
-void MainWindow::decode_plot_buffer_contents()
+bool MainWindow::decode_plot_buffer_contents()
 {
-    // Buffer icon dimensions
-    QSizeF icon_size         = get_icon_size();
-    int icon_width           = static_cast<int>(icon_size.width());
-    int icon_height          = static_cast<int>(icon_size.height());
-    const int bytes_per_line = icon_width * 3;
+    // Read buffer info
+    string variable_name_str;
+    string display_name_str;
+    string pixel_layout_str;
+    bool transpose_buffer;
+    int buff_width;
+    int buff_height;
+    int buff_channels;
+    int buff_stride;
+    BufferType buff_type;
+    size_t buff_length;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(variable_name_str)
+        .read(display_name_str)
+        .read(pixel_layout_str)
+        .read(transpose_buffer)
+        .read(buff_width)
+        .read(buff_height)
+        .read(buff_channels)
+        .read(buff_stride)
+        .read(buff_type)
+        .read(buff_length);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
 
+    add_session_prefix(variable_name_str);
+    add_session_prefix(display_name_str);
+
+    // The buffer contents are received incrementally by
+    // decode_incoming_messages
+    start_payload(variable_name_str,
+                  display_name_str,
+                  buff_length,
+                  [=](vector<uint8_t>& buff_contents) {
+                      decode_buffer(variable_name_str,
+                                    display_name_str,
+                                    pixel_layout_str,
+                                    transpose_buffer,
+                                    buff_width,
+                                    buff_height,
+                                    buff_channels,
+                                    buff_stride,
+                                    buff_type,
+                                    buff_contents);
+                  });
+
+    return true;
+}
+
+
+bool MainWindow::decode_plot_buffer_preview()
+{
+    // Read buffer info
+    string variable_name_str;
+    string display_name_str;
+    string pixel_layout_str;
+    bool transpose_buffer;
+    int buff_width;
+    int buff_height;
+    int buff_channels;
+    BufferType buff_type;
+    int preview_factor;
+    size_t preview_length;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(variable_name_str)
+        .read(display_name_str)
+        .read(pixel_layout_str)
+        .read(transpose_buffer)
+        .read(buff_width)
+        .read(buff_height)
+        .read(buff_channels)
+        .read(buff_type)
+        .read(preview_factor)
+        .read(preview_length);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    add_session_prefix(variable_name_str);
+    add_session_prefix(display_name_str);
+
+    // The full contents of the buffer follow the preview, which is not the
+    // final message of its buffer
+    start_payload(
+        variable_name_str,
+        display_name_str,
+        preview_length,
+        [=](vector<uint8_t>& preview_contents) {
+            const int preview_width =
+                (buff_width + preview_factor - 1) / preview_factor;
+            const int preview_height =
+                (buff_height + preview_factor - 1) / preview_factor;
+
+            const bool is_new_buffer =
+                stages_.find(variable_name_str) == stages_.end();
+
+            narrow_buffer_to_held_type(buff_type, preview_contents);
+
+            update_buffer(variable_name_str,
+                          display_name_str,
+                          pixel_layout_str,
+                          transpose_buffer,
+                          preview_width,
+                          preview_height,
+                          buff_channels,
+                          preview_width,
+                          buff_type,
+                          preview_contents);
+
+            stages_[variable_name_str]->set_display_size(
+                buff_width, buff_height, is_new_buffer);
+
+            report_received_buffer(variable_name_str, false);
+        },
+        false);
+
+    return true;
+}
+
+
+bool MainWindow::decode_plot_buffer_contents_shared()
+{
     // Read buffer info
     string variable_name_str;
     string display_name_str;
@@ -78,9 +319,9 @@ void MainWindow::decode_plot_buffer_contents()
     int buff_channels;
     int buff_stride;
     BufferType buff_type;
-    vector<uint8_t> buff_contents;
+    SharedBufferHandle shared_handle;
 
-    MessageDecoder message_decoder(&socket_);
+    MessageDecoder message_decoder(&session_->socket, false);
     message_decoder.read(variable_name_str)
         .read(display_name_str)
         .read(pixel_layout_str)
@@ -90,17 +331,194 @@ void MainWindow::decode_plot_buffer_contents()
         .read(buff_channels)
         .read(buff_stride)
         .read(buff_type)
-        .read(buff_contents);
+        .read(shared_handle.key)
+        .read(shared_handle.sequence)
+        .read(shared_handle.offset)
+        .read(shared_handle.length);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
 
+    add_session_prefix(variable_name_str);
+    add_session_prefix(display_name_str);
+
+    vector<uint8_t> buff_contents =
+        receive_buffer_pool_.take(variable_name_str, shared_handle.length);
+    switch (read_shared_buffer(shared_handle, buff_contents)) {
+    case SharedBufferStatus::Ok:
+        break;
+    case SharedBufferStatus::Stale:
+        // A newer version of this buffer is already on its way
+        receive_buffer_pool_.give(variable_name_str, std::move(buff_contents));
+        return true;
+    case SharedBufferStatus::Unavailable:
+        // Ask the bridge to send it through the socket instead
+        receive_buffer_pool_.give(variable_name_str, std::move(buff_contents));
+        send_buffer_message(MessageType::SharedMemoryUnavailable,
+                            variable_name_str);
+        return true;
+    }
+
+    decode_buffer(variable_name_str,
+                  display_name_str,
+                  pixel_layout_str,
+                  transpose_buffer,
+                  buff_width,
+                  buff_height,
+                  buff_channels,
+                  buff_stride,
+                  buff_type,
+                  buff_contents);
+
+    return true;
+}
+
+
+void MainWindow::decode_buffer(const string& variable_name_str,
+                               const string& display_name_str,
+                               const string& pixel_layout_str,
+                               bool transpose_buffer,
+                               int buff_width,
+                               int buff_height,
+                               int buff_channels,
+                               int buff_stride,
+                               BufferType buff_type,
+                               vector<uint8_t>& buff_contents)
+{
+    DecodedBuffer decoded;
+    decoded.contents = std::move(buff_contents);
+    decoded.type     = buff_type;
+    decoded.width    = buff_width;
+    decoded.height   = buff_height;
+    decoded.channels = buff_channels;
+    decoded.step     = buff_stride;
+
+    decoded.request_id = message_request_id_;
+    if (tracing_enabled()) {
+        decoded.name = variable_name_str;
+    }
+
+    // The ranges are only computed on the CPU without GPU reductions, and
+    // from the histogram when outliers are clipped
     auto buffer_stage = stages_.find(variable_name_str);
+    const bool clip_outliers =
+        buffer_stage != stages_.end()
+            ? buffer_stage->second->get_buffer_component()->clip_outliers
+            : ac_clip_outliers_;
+    decoded.compute_range =
+        !clip_outliers &&
+        !ui_->bufferPreview->get_gpu_reducer()->is_available();
 
-    if (buff_type == BufferType::Float64) {
-        held_buffers_[variable_name_str] =
-            make_float_buffer_from_double(buff_contents);
-    } else {
-        held_buffers_[variable_name_str] = std::move(buff_contents);
+    decoded.on_decoded = [=](DecodedBuffer& buffer) {
+        PerfOverlay* perf_overlay = ui_->bufferPreview->get_perf_overlay();
+        perf_overlay->set_update_step(PerfOverlay::UpdateStep::Convert,
+                                      buffer.convert_ms);
+        perf_overlay->set_update_step(PerfOverlay::UpdateStep::Range,
+                                      buffer.range_ms);
+
+        PerfOverlay::StepTimer update_timer(perf_overlay,
+                                            PerfOverlay::UpdateStep::Update);
+        TraceScope trace(
+            "update_buffer", buffer.request_id, variable_name_str);
+        if (tracing_enabled()) {
+            buffer_request_ids_[variable_name_str] = buffer.request_id;
+        }
+
+        update_buffer(variable_name_str,
+                      display_name_str,
+                      pixel_layout_str,
+                      transpose_buffer,
+                      buff_width,
+                      buff_height,
+                      buff_channels,
+                      buff_stride,
+                      buff_type,
+                      buffer.contents,
+                      buffer.has_range ? buffer.lowest : nullptr,
+                      buffer.has_range ? buffer.upper : nullptr);
+
+        report_received_buffer(variable_name_str, true);
+    };
+
+    // Further messages wait until the buffer was applied, so that they
+    // apply to its contents
+    buffer_decoder_.start(std::move(decoded));
+    schedule_loop();
+}
+
+
+void MainWindow::report_received_buffer(const string& variable_name_str,
+                                        bool complete)
+{
+    if (!host_settings_.report_frames) {
+        return;
+    }
+
+    auto report = frame_reports_.find(variable_name_str);
+    if (report == frame_reports_.end()) {
+        report = frame_reports_
+                     .emplace(variable_name_str, FrameReport{false, false})
+                     .first;
+    }
+    report->second.complete = complete;
+
+    const int row =
+        buffer_list_model_->row_of(QString::fromStdString(variable_name_str));
+    if (row >= 0 && ui_->imageList->currentIndex().row() != row) {
+        ui_->imageList->setCurrentIndex(buffer_list_model_->index(row));
+    }
+
+    request_render_update();
+}
+
+
+void MainWindow::update_buffer(const string& variable_name_str,
+                               const string& display_name_str,
+                               const string& pixel_layout_str,
+                               bool transpose_buffer,
+                               int buff_width,
+                               int buff_height,
+                               int buff_channels,
+                               int buff_stride,
+                               BufferType buff_type,
+                               vector<uint8_t>& buff_contents,
+                               const float* lowest,
+                               const float* upper)
+{
+    const bool was_alias = detach_buffer_alias(variable_name_str);
+
+    auto buffer_stage = stages_.find(variable_name_str);
+
+    // The buffer contents replace any previously fetched tiles
+    lazy_buffers_.erase(variable_name_str);
+
+    // The stage must stop reading the previous contents before they are freed
+    if (buffer_stage != stages_.end()) {
+        buffer_stage->second->get_buffer_component()->cancel_histogram();
+    }
+
+    // The previous contents receive the next version of the buffer
+    auto held_buffer = held_buffers_.find(variable_name_str);
+    if (held_buffer != held_buffers_.end()) {
+        receive_buffer_pool_.give(variable_name_str,
+                                  std::move(held_buffer->second));
     }
 
+    held_buffers_[variable_name_str] = std::move(buff_contents);
+
+    record_buffer_version(variable_name_str,
+                          BufferHistory::Version{pixel_layout_str,
+                                                 transpose_buffer,
+                                                 buff_width,
+                                                 buff_height,
+                                                 buff_channels,
+                                                 buff_stride,
+                                                 buff_type,
+                                                 0,
+                                                 {}},
+                          held_buffers_[variable_name_str]);
+
     // Human readable dimensions
     int visualized_width;
     int visualized_height;
@@ -113,6 +531,8 @@ void MainWindow::decode_plot_buffer_contents()
     }
 
     if (buffer_stage == stages_.end()) { // New buffer request
+        // The stage components are only initialized once it is selected,
+        // until then its icon is rendered on the CPU
         shared_ptr<Stage> stage = make_shared<Stage>(this);
         if (!stage->initialize(held_buffers_[variable_name_str].data(),
                                buff_width,
@@ -121,36 +541,42 @@ void MainWindow::decode_plot_buffer_contents()
                                buff_type,
                                buff_stride,
                                pixel_layout_str,
-                               transpose_buffer)) {
+                               transpose_buffer,
+                               true)) {
             cerr << "[error] Could not initialize opengl canvas!" << endl;
         }
         stage->contrast_enabled    = ac_enabled_;
         stages_[variable_name_str] = stage;
 
-        ui_->bufferPreview->render_buffer_icon(
-            stage.get(), icon_width, icon_height);
+        stage->get_buffer_component()->clip_outliers = ac_clip_outliers_;
+        stage->get_buffer_component()->visible_range_only =
+            ac_visible_range_only_;
+        stage->get_buffer_component()->set_color_range_hint(lowest, upper);
+
+        // The row of a detached alias may be selected, or compared with
+        if (was_alias) {
+            const int row = buffer_list_model_->row_of(
+                QString::fromStdString(variable_name_str));
+            if (row >= 0 && ui_->imageList->currentIndex().row() == row) {
+                set_currently_selected_stage(stage.get());
+            }
+            if (variable_name_str == difference_reference_name_ ||
+                stage.get() == currently_selected_stage_) {
+                update_difference_reference();
+            }
+        }
 
-        QImage bufferIcon(stage->buffer_icon.data(),
-                          icon_width,
-                          icon_height,
-                          bytes_per_line,
-                          QImage::Format_RGB888);
-
-        stringstream label;
-        label << display_name_str << "\n[" << visualized_width << "x"
-              << visualized_height << "]\n"
-              << get_type_label(buff_type, buff_channels);
-        QListWidgetItem* item =
-            new QListWidgetItem(QPixmap::fromImage(bufferIcon),
-                                label.str().c_str(),
-                                ui_->imageList);
-        item->setData(Qt::UserRole, QString(variable_name_str.c_str()));
-        item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled |
-                       Qt::ItemIsDragEnabled);
-        ui_->imageList->addItem(item);
+        // The icon and label are set by update_buffer_list_item
+        buffer_list_model_->add_buffer(variable_name_str.c_str(),
+                                       display_name_str.c_str());
+        fill_split_views();
 
         persist_settings_deferred();
     } else { // Update buffer request
+        // Initialized stages take the range as their contents are updated,
+        // the others once they are initialized
+        buffer_stage->second->get_buffer_component()->set_color_range_hint(
+            lowest, upper);
         buffer_stage->second->buffer_update(
             held_buffers_[variable_name_str].data(),
             buff_width,
@@ -161,83 +587,998 @@ void MainWindow::decode_plot_buffer_contents()
             pixel_layout_str,
             transpose_buffer);
 
-        // Update buffer icon
-        shared_ptr<Stage>& stage = stages_[variable_name_str];
-        ui_->bufferPreview->render_buffer_icon(
+        // The new contents replace the past version which was displayed
+        if (history_buffer_name_ == variable_name_str) {
+            history_buffer_name_.clear();
+            vector<uint8_t>().swap(history_contents_);
+            update_history_timeline();
+        }
+    }
+
+    const auto stage = stages_.find(variable_name_str);
+    if (stage != stages_.end() && stage->second->has_pending_uploads()) {
+        texture_upload_begin_us_.emplace(variable_name_str, trace_now_us());
+    }
+
+    touch_stage_textures(variable_name_str);
+    enforce_texture_budget();
+
+    update_buffer_list_item(variable_name_str,
+                            display_name_str,
+                            visualized_width,
+                            visualized_height,
+                            buff_channels,
+                            buff_type);
+
+    request_render_update();
+}
+
+
+bool MainWindow::decode_plot_buffer_tiles()
+{
+    // Read buffer info
+    string variable_name_str;
+    string display_name_str;
+    string pixel_layout_str;
+    bool transpose_buffer;
+    int buff_width;
+    int buff_height;
+    int buff_channels;
+    int buff_stride;
+    BufferType buff_type;
+    size_t num_tiles;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(variable_name_str)
+        .read(display_name_str)
+        .read(pixel_layout_str)
+        .read(transpose_buffer)
+        .read(buff_width)
+        .read(buff_height)
+        .read(buff_channels)
+        .read(buff_stride)
+        .read(buff_type)
+        .read(num_tiles);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    add_session_prefix(variable_name_str);
+    add_session_prefix(display_name_str);
+
+    // Each tile region takes four ints; don't trust num_tiles before they
+    // have all arrived
+    const size_t tile_region_size = 4 * sizeof(int);
+    if (static_cast<size_t>(session_->socket.bytesAvailable()) <
+        num_tiles * tile_region_size + sizeof(size_t)) {
+        return false;
+    }
+
+    vector<TileRegion> tiles(num_tiles);
+    for (auto& tile : tiles) {
+        message_decoder.read(tile.x)
+            .read(tile.y)
+            .read(tile.width)
+            .read(tile.height);
+    }
+
+    size_t contents_length;
+    message_decoder.read(contents_length);
+
+    start_payload(variable_name_str,
+                  display_name_str,
+                  contents_length,
+                  [=](vector<uint8_t>& tile_contents) {
+                      apply_buffer_tiles(variable_name_str,
+                                         display_name_str,
+                                         pixel_layout_str,
+                                         transpose_buffer,
+                                         buff_width,
+                                         buff_height,
+                                         buff_channels,
+                                         buff_stride,
+                                         buff_type,
+                                         tiles,
+                                         tile_contents);
+                  });
+
+    return true;
+}
+
+
+void MainWindow::apply_buffer_tiles(const string& variable_name_str,
+                                    const string& display_name_str,
+                                    const string& pixel_layout_str,
+                                    bool transpose_buffer,
+                                    int buff_width,
+                                    int buff_height,
+                                    int buff_channels,
+                                    int buff_stride,
+                                    BufferType buff_type,
+                                    const vector<TileRegion>& tiles,
+                                    vector<uint8_t>& tile_contents)
+{
+    narrow_buffer_to_held_type(buff_type, tile_contents);
+
+    const size_t pixel_size = held_pixel_size(buff_type, buff_channels);
+
+    size_t expected_contents_size = 0;
+    for (const auto& tile : tiles) {
+        expected_contents_size +=
+            static_cast<size_t>(tile.width * tile.height) * pixel_size;
+    }
+
+    // The tiles can only be applied on top of the exact same buffer layout
+    auto buffer_stage = stages_.find(variable_name_str);
+    auto held_buffer  = held_buffers_.find(variable_name_str);
+
+    bool can_apply_tiles = buffer_stage != stages_.end() &&
+                           held_buffer != held_buffers_.end() &&
+                           tile_contents.size() == expected_contents_size;
+
+    if (can_apply_tiles) {
+        Buffer* buffer = buffer_stage->second->get_buffer_component();
+
+        can_apply_tiles =
+            static_cast<int>(buffer->buffer_width_f) == buff_width &&
+            static_cast<int>(buffer->buffer_height_f) == buff_height &&
+            buffer->channels == buff_channels &&
+            buffer->step == buff_stride && buffer->type == buff_type &&
+            buffer->transpose == transpose_buffer &&
+            pixel_layout_str.compare(0, 4, buffer->get_pixel_layout(), 4) ==
+                0 &&
+            buffer->has_contents() &&
+            buffer->buffer == held_buffer->second.data();
+    }
+
+    if (!can_apply_tiles) {
+        // Ask the bridge to forget its tile hashes and resend everything
+        send_buffer_message(MessageType::InvalidateBufferCache,
+                            variable_name_str);
+        request_plot_buffer(variable_name_str.c_str());
+        return;
+    }
+
+    buffer_stage->second->get_buffer_component()->prepare_tiles_update(tiles);
+
+    const uint8_t* tile_src = tile_contents.data();
+    for (const auto& tile : tiles) {
+        unpack_tile(tile_src,
+                    buff_stride,
+                    pixel_size,
+                    tile,
+                    held_buffer->second.data());
+        tile_src += static_cast<size_t>(tile.width * tile.height) * pixel_size;
+    }
+
+    buffer_stage->second->buffer_tiles_update(tiles);
+
+    record_buffer_version(variable_name_str,
+                          BufferHistory::Version{pixel_layout_str,
+                                                 transpose_buffer,
+                                                 buff_width,
+                                                 buff_height,
+                                                 buff_channels,
+                                                 buff_stride,
+                                                 buff_type,
+                                                 0,
+                                                 {}},
+                          held_buffer->second);
+
+    // Human readable dimensions
+    int visualized_width;
+    int visualized_height;
+    if (!transpose_buffer) {
+        visualized_width  = buff_width;
+        visualized_height = buff_height;
+    } else {
+        visualized_width  = buff_height;
+        visualized_height = buff_width;
+    }
+
+    update_buffer_list_item(variable_name_str,
+                            display_name_str,
+                            visualized_width,
+                            visualized_height,
+                            buff_channels,
+                            buff_type);
+
+    request_render_update();
+}
+
+
+void MainWindow::update_buffer_list_item(const string& variable_name_str,
+                                         const string& display_name_str,
+                                         int visualized_width,
+                                         int visualized_height,
+                                         int buff_channels,
+                                         BufferType buff_type)
+{
+    // Within a batch, all items are updated at once when it is over
+    if (batch_messages_remaining_ > 0) {
+        deferred_list_updates_[variable_name_str] = [=]() {
+            update_buffer_list_item(variable_name_str,
+                                    display_name_str,
+                                    visualized_width,
+                                    visualized_height,
+                                    buff_channels,
+                                    buff_type);
+        };
+        return;
+    }
+
+    // The icon is rendered from the buffer textures, which are restored if
+    // they were released in the meantime. Stages that were never displayed
+    // have no textures, and their icon is rendered from the buffer contents.
+    shared_ptr<Stage>& stage = stages_[variable_name_str];
+    stage->restore_textures();
+    if (stage->has_pending_uploads()) {
+        pending_upload_list_updates_[variable_name_str] = [=]() {
+            update_buffer_list_item(variable_name_str,
+                                    display_name_str,
+                                    visualized_width,
+                                    visualized_height,
+                                    buff_channels,
+                                    buff_type);
+        };
+        return;
+    }
+
+    // Buffers refreshed rapidly only get a new icon every so often, and
+    // icons wait while the frames of a moving view are over budget
+    const auto now = chrono::steady_clock::now();
+    const auto last_update = icon_update_times_.find(variable_name_str);
+    if ((last_update != icon_update_times_.end() &&
+         now - last_update->second < icon_debounce_interval) ||
+        ui_->bufferPreview->get_frame_scheduler()->is_deferring()) {
+        debounced_list_updates_[variable_name_str] = [=]() {
+            update_buffer_list_item(variable_name_str,
+                                    display_name_str,
+                                    visualized_width,
+                                    visualized_height,
+                                    buff_channels,
+                                    buff_type);
+        };
+        schedule_debounced_list_items();
+        return;
+    }
+    icon_update_times_[variable_name_str] = now;
+    debounced_list_updates_.erase(variable_name_str);
+
+    // Buffer icon dimensions
+    QSizeF icon_size = get_icon_size();
+    int icon_width   = static_cast<int>(icon_size.width());
+    int icon_height  = static_cast<int>(icon_size.height());
+
+    stringstream label;
+    label << display_name_str << "\n[" << visualized_width << "x"
+          << visualized_height << "]\n"
+          << get_type_label(buff_type, buff_channels);
+
+    PerfOverlay::StepTimer thumbnail_timer(
+        ui_->bufferPreview->get_perf_overlay(),
+        PerfOverlay::UpdateStep::Thumbnail);
+    const auto request_id = buffer_request_ids_.find(variable_name_str);
+    TraceScope trace("thumbnail",
+                     request_id != buffer_request_ids_.end()
+                         ? request_id->second
+                         : 0,
+                     variable_name_str);
+
+    // Update buffer icon. Icons rendered from the textures are read back
+    // asynchronously, and set on the next iteration of the loop.
+    if (stage->components_initialized()) {
+        const GLuint pixel_buffer = ui_->bufferPreview->start_buffer_icon(
             stage.get(), icon_width, icon_height);
 
-        // Looking for corresponding item...
-        QImage bufferIcon(stage->buffer_icon.data(),
-                          icon_width,
-                          icon_height,
-                          bytes_per_line,
-                          QImage::Format_RGB888);
-        stringstream label;
-        label << display_name_str << "\n[" << visualized_width << "x"
-              << visualized_height << "]\n"
-              << get_type_label(buff_type, buff_channels);
-
-        for (int i = 0; i < ui_->imageList->count(); ++i) {
-            QListWidgetItem* item = ui_->imageList->item(i);
-            if (item->data(Qt::UserRole) == variable_name_str.c_str()) {
-                item->setIcon(QPixmap::fromImage(bufferIcon));
-                item->setText(label.str().c_str());
-                break;
+        if (pixel_buffer != 0) {
+            auto pending_icon = pending_icons_.find(variable_name_str);
+            if (pending_icon != pending_icons_.end()) {
+                finish_pending_icon(*pending_icon);
+                pending_icons_.erase(pending_icon);
             }
+
+            pending_icons_[variable_name_str] =
+                PendingIcon{pixel_buffer, icon_width, icon_height, label.str()};
+            schedule_loop();
+            return;
         }
 
-        // Update AC values
-        if (currently_selected_stage_ != nullptr) {
-            reset_ac_min_labels();
-            reset_ac_max_labels();
+        ui_->bufferPreview->render_buffer_icon(
+            stage.get(), icon_width, icon_height);
+    } else {
+        const Buffer* buffer = stage->get_buffer_component();
+
+        render_buffer_thumbnail(buffer->buffer,
+                                static_cast<int>(buffer->buffer_width_f),
+                                static_cast<int>(buffer->buffer_height_f),
+                                buffer->channels,
+                                buffer->type,
+                                buffer->step,
+                                buffer->get_pixel_layout(),
+                                buffer->transpose,
+                                stage->contrast_enabled,
+                                icon_width,
+                                icon_height,
+                                stage->buffer_icon);
+    }
+
+    set_buffer_list_item(variable_name_str,
+                         label.str(),
+                         stage->buffer_icon,
+                         icon_width,
+                         icon_height);
+}
+
+
+void MainWindow::set_buffer_list_item(const string& variable_name_str,
+                                      const string& label,
+                                      const vector<uint8_t>& icon,
+                                      int icon_width,
+                                      int icon_height)
+{
+    const int bytes_per_line = icon_width * 3;
+
+    // The model keeps its own copy, as icon is reused for the next buffers
+    QImage bufferIcon(icon.data(),
+                      icon_width,
+                      icon_height,
+                      bytes_per_line,
+                      QImage::Format_RGB888);
+
+    const QString buffer_name = variable_name_str.c_str();
+    if (buffer_list_model_->set_icon(buffer_name, bufferIcon.copy())) {
+        buffer_list_model_->set_label(buffer_name, label.c_str());
+    }
+
+    // Update AC values
+    if (currently_selected_stage_ != nullptr) {
+        reset_ac_min_labels();
+        reset_ac_max_labels();
+    }
+}
+
+
+void MainWindow::finish_pending_icon(
+    const pair<const string, PendingIcon>& pending_icon)
+{
+    const PendingIcon& icon = pending_icon.second;
+
+    vector<uint8_t> pixels;
+    ui_->bufferPreview->finish_buffer_icon(
+        icon.pixel_buffer, icon.width, icon.height, pixels);
+
+    // The icon is kept by stages, like the ones rendered synchronously
+    auto buffer_stage = stages_.find(pending_icon.first);
+    if (buffer_stage == stages_.end()) {
+        return;
+    }
+    buffer_stage->second->buffer_icon = pixels;
+
+    set_buffer_list_item(
+        pending_icon.first, icon.label, pixels, icon.width, icon.height);
+}
+
+
+void MainWindow::finish_pending_icons()
+{
+    map<string, PendingIcon> pending_icons;
+    pending_icons.swap(pending_icons_);
+
+    for (const auto& pending_icon : pending_icons) {
+        finish_pending_icon(pending_icon);
+    }
+}
+
+
+void MainWindow::schedule_debounced_list_items()
+{
+    if (icon_debounce_timer_.isActive()) {
+        return;
+    }
+
+    icon_debounce_timer_.start(static_cast<int>(
+        chrono::duration_cast<chrono::milliseconds>(icon_debounce_interval)
+            .count()));
+}
+
+
+void MainWindow::update_debounced_list_items()
+{
+    map<string, function<void()>> debounced_list_updates;
+    debounced_list_updates.swap(debounced_list_updates_);
+
+    // Updates which are still too recent are debounced again
+    for (const auto& list_update : debounced_list_updates) {
+        if (stages_.find(list_update.first) != stages_.end()) {
+            list_update.second();
         }
     }
+}
+
+
+void MainWindow::start_payload(const string& variable_name_str,
+                               const string& display_name_str,
+                               size_t length,
+                               function<void(vector<uint8_t>&)> on_received,
+                               bool ends_message,
+                               bool reports_progress)
+{
+    // The destination buffer is allocated once, before any data arrives,
+    // preferably from the previous contents of the buffer
+    pending_payload_ = receive_buffer_pool_.take(variable_name_str, length);
+    payload_receiver_.start(pending_payload_.data(), length);
 
-    request_render_update_ = true;
+    receiving_buffer_name_  = variable_name_str;
+    receiving_display_name_ = display_name_str;
+    receiving_progress_       = -1;
+    payload_request_id_       = message_request_id_;
+    payload_begin_us_         = trace_now_us();
+    on_payload_received_      = on_received;
+    payload_ends_message_     = ends_message;
+    payload_reports_progress_ = reports_progress;
+    is_receiving_payload_     = true;
 }
 
 
-void MainWindow::decode_incoming_messages()
+bool MainWindow::receive_payload()
+{
+    if (!payload_receiver_.receive(&session_->socket)) {
+        update_transfer_progress();
+        return false;
+    }
+
+    is_receiving_payload_ = false;
+
+    const double payload_end_us = trace_now_us();
+    trace_event("receive_payload",
+                payload_request_id_,
+                payload_begin_us_,
+                payload_end_us,
+                receiving_buffer_name_);
+
+    PerfOverlay* perf_overlay = ui_->bufferPreview->get_perf_overlay();
+    perf_overlay->set_transfer(payload_receiver_.wire_bytes(),
+                               (payload_end_us - payload_begin_us_) / 1000.0);
+    perf_overlay->set_update_step(PerfOverlay::UpdateStep::Decompress,
+                                  payload_receiver_.decompression_ms());
+
+    // The decoding of the payload is traced with the request of its message
+    message_request_id_ = payload_request_id_;
+
+    if (payload_receiver_.failed()) {
+        // The rest of the stream can't be trusted anymore
+        cerr << "[error] Could not receive buffer "
+             << receiving_buffer_name_ << endl;
+        session_->socket.readAll();
+        request_plot_buffer(receiving_buffer_name_.c_str());
+    } else if (on_payload_received_) {
+        on_payload_received_(pending_payload_);
+    }
+
+    on_payload_received_ = nullptr;
+    pending_payload_     = vector<uint8_t>();
+
+    if (payload_ends_message_) {
+        finish_batch_message();
+    }
+
+    return true;
+}
+
+
+bool MainWindow::decode_plot_buffer_batch()
+{
+    size_t num_messages;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(num_messages);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    batch_messages_remaining_ = num_messages;
+
+    return true;
+}
+
+
+void MainWindow::finish_batch_message()
 {
-    // Close application if server has disconnected
-    if(socket_.state() == QTcpSocket::UnconnectedState) {
-        QApplication::quit();
+    // A buffer decoded in the background finishes its message once it was
+    // applied
+    if (buffer_decoder_.is_pending()) {
+        finish_decoded_message_ = true;
+        return;
+    }
+
+    if (batch_messages_remaining_ == 0 || --batch_messages_remaining_ > 0) {
+        return;
+    }
+
+    // Render the icons of all buffers in the batch in one go
+    map<string, function<void()>> deferred_list_updates;
+    deferred_list_updates.swap(deferred_list_updates_);
+    for (const auto& list_update : deferred_list_updates) {
+        list_update.second();
     }
 
-    available_vars_.clear();
+    request_render_update();
 
-    if (socket_.bytesAvailable() == 0) {
+    if (auto_export_pending_) {
+        auto_export_pending_ = false;
+        start_bulk_export(QDir(auto_export_directory_)
+                              .filePath(QString("stop_%1").arg(
+                                  session_->stop_generation)));
+    }
+}
+
+
+void MainWindow::update_transfer_progress()
+{
+    const size_t total_bytes = payload_receiver_.total_bytes();
+    if (total_bytes == 0 || !payload_reports_progress_) {
+        return;
+    }
+
+    const int progress = static_cast<int>(
+        100.0 * static_cast<double>(payload_receiver_.bytes_received()) /
+        static_cast<double>(total_bytes));
+    if (progress == receiving_progress_) {
         return;
     }
+    receiving_progress_ = progress;
 
-    MessageType header;
-    if (!socket_.read(reinterpret_cast<char*>(&header),
-                      static_cast<qint64>(sizeof(header)))) {
+    stringstream message;
+    message << "[receiving " << progress << "%]";
+
+    // Show the progress in the buffer list if the buffer is already there,
+    // otherwise in the status bar
+    stringstream label;
+    label << receiving_display_name_ << "\n" << message.str();
+    if (buffer_list_model_->set_label(receiving_buffer_name_.c_str(),
+                                      label.str().c_str())) {
         return;
     }
 
-    socket_.waitForReadyRead(100);
+    status_bar_->setText(
+        (receiving_display_name_ + " " + message.str()).c_str());
+}
+
 
-    switch (header) {
+bool MainWindow::decode_plot_buffer_lazy()
+{
+    // Read buffer info
+    string variable_name_str;
+    string display_name_str;
+    string pixel_layout_str;
+    bool transpose_buffer;
+    int buff_width;
+    int buff_height;
+    int buff_channels;
+    BufferType buff_type;
+    bool streamed;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(variable_name_str)
+        .read(display_name_str)
+        .read(pixel_layout_str)
+        .read(transpose_buffer)
+        .read(buff_width)
+        .read(buff_height)
+        .read(buff_channels)
+        .read(buff_type)
+        .read(streamed);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    add_session_prefix(variable_name_str);
+    add_session_prefix(display_name_str);
+
+    plot_lazy_buffer(variable_name_str,
+                     display_name_str,
+                     pixel_layout_str,
+                     transpose_buffer,
+                     buff_width,
+                     buff_height,
+                     buff_channels,
+                     buff_type,
+                     streamed);
+
+    return true;
+}
+
+
+bool MainWindow::decode_plot_buffer_region()
+{
+    string variable_name_str;
+    int region_x;
+    int region_y;
+    int region_width;
+    int region_height;
+    int factor;
+    int generation;
+    size_t region_length;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(variable_name_str)
+        .read(region_x)
+        .read(region_y)
+        .read(region_width)
+        .read(region_height)
+        .read(factor)
+        .read(generation)
+        .read(region_length);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    add_session_prefix(variable_name_str);
+
+    // The region was read before the inferior last stopped, and the buffer
+    // is about to be replotted: its contents are only received and dropped
+    if (generation != session_->stop_generation) {
+        start_payload(variable_name_str,
+                      variable_name_str,
+                      region_length,
+                      nullptr,
+                      true,
+                      false);
+        return true;
+    }
+
+    // Regions are small and frequent, their progress is not worth showing
+    start_payload(variable_name_str,
+                  variable_name_str,
+                  region_length,
+                  [=](vector<uint8_t>& region_contents) {
+                      receive_buffer_region(variable_name_str,
+                                            region_x,
+                                            region_y,
+                                            region_width,
+                                            region_height,
+                                            factor,
+                                            region_contents);
+                  },
+                  true,
+                  false);
+
+    return true;
+}
+
+
+bool MainWindow::decode_plot_buffer_chunk()
+{
+    string variable_name_str;
+    int chunk_y;
+    int chunk_height;
+    int generation;
+    size_t chunk_length;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(variable_name_str)
+        .read(chunk_y)
+        .read(chunk_height)
+        .read(generation)
+        .read(chunk_length);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    add_session_prefix(variable_name_str);
+
+    // The stream was ended by the stop
+    if (generation != session_->stop_generation) {
+        start_payload(variable_name_str,
+                      variable_name_str,
+                      chunk_length,
+                      nullptr,
+                      true,
+                      false);
+        return true;
+    }
+
+    // Chunks are dropped as soon as their tiles were cached
+    start_payload(variable_name_str,
+                  variable_name_str,
+                  chunk_length,
+                  [=](vector<uint8_t>& chunk_contents) {
+                      receive_buffer_chunk(variable_name_str,
+                                           chunk_y,
+                                           chunk_height,
+                                           chunk_contents);
+                  },
+                  true,
+                  false);
+
+    return true;
+}
+
+
+bool MainWindow::decode_set_stop_generation()
+{
+    int stop_generation;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(stop_generation);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    session_->stop_generation = stop_generation;
+
+    // The buffers are exported once the batch plotted after the stop is in
+    auto_export_pending_ = !auto_export_directory_.isEmpty();
+
+    // The bridge drops the regions requested before the stop, as well as its
+    // streams; the regions which are still displayed are requested again
+    string session_buffer_name;
+    for (auto& lazy_buffer : lazy_buffers_) {
+        if (buffer_session(lazy_buffer.first, session_buffer_name) !=
+            session_) {
+            continue;
+        }
+
+        lazy_buffer.second.requested_tiles.clear();
+        lazy_buffer.second.streamed = false;
+        lazy_buffer.second.stream_rows.clear();
+    }
+
+    return true;
+}
+
+
+bool MainWindow::decode_plot_buffer_unavailable()
+{
+    string variable_name_str;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(variable_name_str);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    add_session_prefix(variable_name_str);
+
+    // The buffer keeps its previous contents
+    cerr << "[error] The debugger could not read buffer " << variable_name_str
+         << endl;
+
+    return true;
+}
+
+
+bool MainWindow::decode_plot_buffer_alias()
+{
+    string variable_name_str;
+    string display_name_str;
+    string source_name_str;
+
+    MessageDecoder message_decoder(&session_->socket, false);
+    message_decoder.read(variable_name_str)
+        .read(display_name_str)
+        .read(source_name_str);
+
+    if (!message_decoder.complete()) {
+        return false;
+    }
+
+    add_session_prefix(variable_name_str);
+    add_session_prefix(display_name_str);
+    add_session_prefix(source_name_str);
+
+    plot_buffer_alias(variable_name_str, display_name_str, source_name_str);
+
+    // Otherwise its contents were requested instead
+    if (is_buffer_alias(variable_name_str)) {
+        report_received_buffer(variable_name_str, true);
+    }
+
+    return true;
+}
+
+
+bool MainWindow::decode_message(const MessageHeader& header)
+{
+    // Messages from other protocol versions have an unknown layout
+    if (header.version != message_protocol_version) {
+        return MessageDecoder(&session_->socket, false)
+            .skip(header.length)
+            .complete();
+    }
+
+    switch (header.type) {
     case MessageType::SetAvailableSymbols:
-        decode_set_available_symbols();
-        break;
+        return decode_set_available_symbols();
+    case MessageType::SetAvailableSymbolsDiff:
+        return decode_set_available_symbols_diff();
     case MessageType::GetObservedSymbols:
         respond_get_observed_symbols();
-        break;
+        return true;
     case MessageType::PlotBufferContents:
-        decode_plot_buffer_contents();
-        break;
+        return decode_plot_buffer_contents();
+    case MessageType::PlotBufferContentsShared:
+        return decode_plot_buffer_contents_shared();
+    case MessageType::PlotBufferPreview:
+        return decode_plot_buffer_preview();
+    case MessageType::PlotBufferTiles:
+        return decode_plot_buffer_tiles();
+    case MessageType::PlotBufferBatch:
+        return decode_plot_buffer_batch();
+    case MessageType::PlotBufferLazy:
+        return decode_plot_buffer_lazy();
+    case MessageType::PlotBufferRegion:
+        return decode_plot_buffer_region();
+    case MessageType::PlotBufferChunk:
+        return decode_plot_buffer_chunk();
+    case MessageType::SetStopGeneration:
+        return decode_set_stop_generation();
+    case MessageType::PlotBufferUnavailable:
+        return decode_plot_buffer_unavailable();
+    case MessageType::PlotBufferAlias:
+        return decode_plot_buffer_alias();
     default:
-        break;
+        return MessageDecoder(&session_->socket, false)
+            .skip(header.length)
+            .complete();
+    }
+}
+
+
+void MainWindow::decode_incoming_messages()
+{
+    // The sessions take turns in between messages, until none of them has
+    // anything left to decode. A session keeps its turn until the end of its
+    // current message or batch.
+    size_t idle_sessions = 0;
+    while (session_ != nullptr && idle_sessions < sessions_.size()) {
+        const bool decoded = decode_next_message();
+
+        if (is_decoding_message()) {
+            if (!decoded) {
+                return;
+            }
+            continue;
+        }
+
+        idle_sessions = decoded ? 0 : idle_sessions + 1;
+        select_next_session();
+    }
+}
+
+
+bool MainWindow::decode_next_message()
+{
+    // The messages following a buffer may depend on its contents, and are
+    // decoded once it was applied by apply_decoded_buffer
+    if (buffer_decoder_.is_pending()) {
+        return false;
+    }
+
+    // Finish receiving the current buffer before anything else
+    if (is_receiving_payload_) {
+        return receive_payload();
+    }
+
+    QTcpSocket& socket = session_->socket;
+
+    MessageHeader header;
+    if (socket.bytesAvailable() < static_cast<qint64>(sizeof(header))) {
+        return false;
+    }
+
+    // Messages (except for buffer payloads) are only consumed once they have
+    // completely arrived
+    socket.startTransaction();
+
+    MessageDecoder(&socket, false).read(header);
+    message_request_id_ = header.request_id;
+
+    if (!decode_message(header)) {
+        socket.rollbackTransaction();
+        return false;
+    }
+
+    socket.commitTransaction();
+
+    // Messages with a payload are finished by receive_payload
+    if (header.type != MessageType::PlotBufferBatch &&
+        !is_receiving_payload_) {
+        finish_batch_message();
     }
+
+    return true;
+}
+
+
+void MainWindow::apply_decoded_buffer()
+{
+    DecodedBuffer decoded;
+    if (!buffer_decoder_.poll(decoded)) {
+        return;
+    }
+
+    decoded.on_decoded(decoded);
+
+    if (finish_decoded_message_) {
+        finish_decoded_message_ = false;
+        finish_batch_message();
+    }
+
+    // The messages received in the meantime wait in the socket
+    decode_incoming_messages();
 }
 
 
 void MainWindow::request_plot_buffer(const char* buffer_name)
 {
-    MessageComposer message_composer;
-    message_composer.push(MessageType::PlotBufferRequest)
-        .push(std::string(buffer_name))
-        .send(&socket_);
+    send_buffer_message(MessageType::PlotBufferRequest, buffer_name);
+}
+
+
+void MainWindow::update_plot_priorities()
+{
+    // Priorities of each session, under its own names of the buffers
+    map<int, string> selected_buffers;
+    map<int, deque<string>> visible_buffers;
+
+    // The bridge replots the selected buffer first, then the buffers whose
+    // thumbnails are visible
+    const QRect list_viewport = ui_->imageList->viewport()->rect();
+    string session_buffer_name;
+    for (int i = 0; i < buffer_list_model_->rowCount(); ++i) {
+        const string buffer_name =
+            buffer_list_model_->buffer_name(i).toStdString();
+
+        BridgeSession* session =
+            buffer_session(buffer_name, session_buffer_name);
+        if (session == nullptr) {
+            continue;
+        }
+
+        auto buffer_stage = stages_.find(buffer_name);
+        if (buffer_stage != stages_.end() && !is_buffer_alias(buffer_name) &&
+            buffer_stage->second.get() == currently_selected_stage_) {
+            selected_buffers[session->number] = session_buffer_name;
+        }
+
+        // The buffers of the other views are displayed as well
+        const QRect item_rect =
+            ui_->imageList->visualRect(buffer_list_model_->index(i));
+        if (item_rect.intersects(list_viewport) ||
+            is_in_split_view(buffer_name)) {
+            visible_buffers[session->number].push_back(session_buffer_name);
+        }
+    }
+
+    for (auto& entry : sessions_) {
+        BridgeSession& session = *entry.second;
+
+        const string& selected_buffer  = selected_buffers[session.number];
+        deque<string>& session_visible = visible_buffers[session.number];
+        if (selected_buffer == session.prioritized_selected_buffer &&
+            session_visible == session.prioritized_visible_buffers) {
+            continue;
+        }
+
+        MessageComposer message_composer;
+        message_composer.push(MessageType::SetPlotPriorities)
+            .push(selected_buffer)
+            .push(session_visible.size());
+        for (const auto& buffer_name : session_visible) {
+            message_composer.push(buffer_name);
+        }
+        message_composer.send_async(session.send_queue);
+
+        session.prioritized_selected_buffer = selected_buffer;
+        session.prioritized_visible_buffers.swap(session_visible);
+    }
 }
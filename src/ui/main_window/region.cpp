@@ -0,0 +1,244 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+#include "main_window.h"
+
+#include "ui_main_window.h"
+#include "visualization/components/camera.h"
+#include "visualization/events.h"
+#include "visualization/game_object.h"
+
+
+using namespace std;
+
+
+bool MainWindow::drag_region(int delta_x, int delta_y)
+{
+    if (currently_selected_stage_ == nullptr) {
+        return false;
+    }
+
+    // The drag keeps resizing the region if Shift is released meanwhile
+    if (!is_selecting_region_ &&
+        !KeyboardState::is_modifier_key_pressed(
+            KeyboardState::ModifierKey::Shift)) {
+        return false;
+    }
+
+    const float window_x = ui_->bufferPreview->mouse_x();
+    const float window_y = ui_->bufferPreview->mouse_y();
+
+    // The region starts where the mouse was before the first motion
+    if (!is_selecting_region_) {
+        const vec4 begin =
+            get_stage_coordinates(window_x - delta_x, window_y - delta_y);
+        region_begin_[0]     = begin.x();
+        region_begin_[1]     = begin.y();
+        is_selecting_region_ = true;
+        has_region_          = true;
+    }
+
+    const vec4 end = get_stage_coordinates(window_x, window_y);
+    region_end_[0] = end.x();
+    region_end_[1] = end.y();
+
+    update_status_bar();
+    request_render_update();
+
+    return true;
+}
+
+
+void MainWindow::get_region_bounds(int& x0, int& y0, int& x1, int& y1) const
+{
+    // The pixels under both corners are part of the region
+    x0 = static_cast<int>(floor(min(region_begin_[0], region_end_[0])));
+    y0 = static_cast<int>(floor(min(region_begin_[1], region_end_[1])));
+    x1 = static_cast<int>(floor(max(region_begin_[0], region_end_[0]))) + 1;
+    y1 = static_cast<int>(floor(max(region_begin_[1], region_end_[1]))) + 1;
+}
+
+
+void MainWindow::append_region_statistics(stringstream& message)
+{
+    if (!has_region_ || currently_selected_stage_ == nullptr) {
+        return;
+    }
+
+    Buffer* buffer = currently_selected_stage_->get_buffer_component();
+
+    int x0, y0, x1, y1;
+    get_region_bounds(x0, y0, x1, y1);
+
+    message << "\troi=(" << x0 << ", " << y0 << ") " << x1 - x0 << "x"
+            << y1 - y0 << " ";
+
+    RegionStatistics statistics;
+    const Buffer::RegionState state =
+        buffer->get_region_statistics(static_cast<float>(x0),
+                                      static_cast<float>(y0),
+                                      static_cast<float>(x1),
+                                      static_cast<float>(y1),
+                                      region_table_budget_bytes_,
+                                      statistics);
+
+    if (state == Buffer::RegionState::Pending) {
+        message << "[computing]";
+        return;
+    }
+
+    if (state == Buffer::RegionState::Unavailable) {
+        message << "[unavailable]";
+        return;
+    }
+
+    const int channels = buffer->channels;
+
+    message << "n=[";
+    for (int c = 0; c < channels; ++c) {
+        message << (c > 0 ? " " : "") << statistics.count[c];
+    }
+    message << "] mean=[";
+    for (int c = 0; c < channels; ++c) {
+        message << (c > 0 ? " " : "") << statistics.mean[c];
+    }
+    message << "] std=[";
+    for (int c = 0; c < channels; ++c) {
+        message << (c > 0 ? " " : "") << statistics.stddev[c];
+    }
+    message << "] sum=[";
+    for (int c = 0; c < channels; ++c) {
+        message << (c > 0 ? " " : "") << statistics.sum[c];
+    }
+    message << "]";
+}
+
+
+void MainWindow::draw_region_outline()
+{
+    if (!has_region_ || currently_selected_stage_ == nullptr) {
+        return;
+    }
+
+    Camera* cam = currently_selected_stage_->get_camera_component();
+
+    GameObject* buffer_obj = currently_selected_stage_->get_buffer_object();
+    Buffer* buffer         = currently_selected_stage_->get_buffer_component();
+
+    const mat4 vp = (buffer_obj->get_pose_inverse() *
+                     cam->get_view_projection_inverse())
+                        .inv();
+
+    int x0, y0, x1, y1;
+    get_region_bounds(x0, y0, x1, y1);
+
+    // Bounds of the corners in the framebuffer, whose origin is at the
+    // bottom left. Buffers are only rotated by multiples of 90 degrees.
+    GLCanvas* canvas  = ui_->bufferPreview;
+    const QRect view  = canvas->view_framebuffer_rect();
+    const float scale = static_cast<float>(get_screen_dpi_scale());
+
+    float lowest[2] = {numeric_limits<float>::max(),
+                       numeric_limits<float>::max()};
+    float upper[2]  = {numeric_limits<float>::lowest(),
+                       numeric_limits<float>::lowest()};
+
+    for (const int corner_x : {x0, x1}) {
+        for (const int corner_y : {y0, y1}) {
+            const vec4 corner(corner_x - buffer->display_width_f / 2.f,
+                              corner_y - buffer->display_height_f / 2.f,
+                              0,
+                              1);
+            const vec4 ndc = vp * corner;
+
+            const float fb_x = view.x() + (ndc.x() + 1.f) / 2.f * view.width();
+            const float fb_y =
+                view.y() + (ndc.y() + 1.f) / 2.f * view.height();
+
+            lowest[0] = min(lowest[0], fb_x);
+            lowest[1] = min(lowest[1], fb_y);
+            upper[0]  = max(upper[0], fb_x);
+            upper[1]  = max(upper[1], fb_y);
+        }
+    }
+
+    const GLint left   = static_cast<GLint>(round(lowest[0]));
+    const GLint bottom = static_cast<GLint>(round(lowest[1]));
+    const GLsizei width =
+        max(static_cast<GLsizei>(round(upper[0])) - left, 1);
+    const GLsizei height =
+        max(static_cast<GLsizei>(round(upper[1])) - bottom, 1);
+    const GLsizei thickness = max(static_cast<GLsizei>(round(scale)), 1);
+
+    // The edges are cleared through scissor rectangles, which needs no
+    // program of its own
+    GLfloat clear_color[4];
+    canvas->glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+
+    canvas->glEnable(GL_SCISSOR_TEST);
+    canvas->glClearColor(1.f, 0.8f, 0.f, 1.f);
+
+    const GLint edges[4][4] = {
+        {left, bottom, width, thickness},
+        {left, bottom + height - thickness, width, thickness},
+        {left, bottom, thickness, height},
+        {left + width - thickness, bottom, thickness, height}};
+
+    // They stay within the view, once the canvas is split
+    for (const auto& edge : edges) {
+        const QRect scissor =
+            QRect(edge[0], edge[1], edge[2], edge[3]).intersected(view);
+        if (scissor.isEmpty()) {
+            continue;
+        }
+
+        canvas->glScissor(
+            scissor.x(), scissor.y(), scissor.width(), scissor.height());
+        canvas->glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    canvas->glDisable(GL_SCISSOR_TEST);
+    canvas->glClearColor(
+        clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+}
+
+
+void MainWindow::clear_region()
+{
+    if (!has_region_) {
+        return;
+    }
+
+    has_region_          = false;
+    is_selecting_region_ = false;
+
+    update_status_bar();
+    request_render_update();
+}
@@ -0,0 +1,313 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+#include <QHostAddress>
+
+#include "main_window.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Longest session number in the prefix of a buffer name
+const size_t max_session_number_digits = 6;
+
+} // namespace
+
+
+BridgeSession::BridgeSession(int session_number)
+    : number(session_number)
+    , name_prefix(session_number == 1 ? ""
+                                      : to_string(session_number) + ":")
+    , send_queue(&socket)
+    , available_symbols_version(0)
+    , available_symbols_requested(false)
+    , stop_generation(0)
+{
+}
+
+
+QStringList BridgeSession::window_symbols(const QStringList& symbols) const
+{
+    if (name_prefix.empty()) {
+        return symbols;
+    }
+
+    const QString symbol_prefix = QString::fromStdString(name_prefix);
+
+    QStringList prefixed_symbols;
+    for (const QString& symbol : symbols) {
+        prefixed_symbols.append(symbol_prefix + symbol);
+    }
+
+    return prefixed_symbols;
+}
+
+
+BridgeSession* MainWindow::add_session()
+{
+    // The first free number is taken, so that the bridge of a new debug
+    // session takes over the buffers of the one which disconnected before
+    int number = 1;
+    while (sessions_.count(number) > 0) {
+        ++number;
+    }
+
+    BridgeSession* session = new BridgeSession(number);
+    sessions_[number].reset(session);
+
+    QTcpSocket* socket = &session->socket;
+    connect(socket,
+            SIGNAL(readyRead()),
+            this,
+            SLOT(decode_incoming_messages()));
+
+    // The loop only runs when something happens: it sends the queued
+    // messages, and removes the session once the bridge disconnects
+    connect(socket, SIGNAL(readyRead()), this, SLOT(schedule_loop()));
+    connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(schedule_loop()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(schedule_loop()));
+    connect(socket,
+            SIGNAL(stateChanged(QAbstractSocket::SocketState)),
+            this,
+            SLOT(schedule_loop()));
+
+    if (session_ == nullptr) {
+        session_ = session;
+    }
+
+    return session;
+}
+
+
+void MainWindow::accept_bridge_connections()
+{
+    qintptr socket_descriptor;
+    while (daemon_server_.take_connection(socket_descriptor)) {
+        BridgeSession* session = add_session();
+
+        if (!session->socket.setSocketDescriptor(socket_descriptor)) {
+            cerr << "[error] Could not accept the bridge connection" << endl;
+            remove_session(session);
+            continue;
+        }
+
+        negotiate_compression(*session);
+    }
+}
+
+
+void MainWindow::negotiate_compression(BridgeSession& session)
+{
+    // By default, only remote bridges compress the buffers they send
+    CompressionMode compression = CompressionMode::None;
+    if (host_settings_.compression == "fast") {
+        compression = CompressionMode::Fast;
+    } else if (host_settings_.compression == "best") {
+        compression = CompressionMode::Best;
+    } else if (host_settings_.compression != "none" &&
+               !session.socket.peerAddress().isLoopback()) {
+        compression = CompressionMode::Fast;
+    }
+
+    MessageComposer message_composer;
+    message_composer.push(MessageType::SetCompressionMode)
+        .push(compression)
+        .send_async(session.send_queue);
+}
+
+
+void MainWindow::remove_disconnected_sessions()
+{
+    for (auto entry = sessions_.begin(); entry != sessions_.end();) {
+        BridgeSession* session = (entry++)->second.get();
+        if (session->socket.state() != QAbstractSocket::UnconnectedState) {
+            continue;
+        }
+
+        // The messages which arrived before the disconnection still wait for
+        // the buffer being decoded, or for the turn of the session
+        const bool has_pending_messages =
+            session == session_ ? buffer_decoder_.is_pending()
+                                : session->socket.bytesAvailable() > 0 &&
+                                      is_decoding_message();
+        if (!has_pending_messages) {
+            remove_session(session);
+        }
+    }
+}
+
+
+void MainWindow::remove_session(BridgeSession* session)
+{
+    if (session == session_) {
+        // The rest of the message in flight is dropped
+        is_receiving_payload_ = false;
+        on_payload_received_  = nullptr;
+        pending_payload_      = vector<uint8_t>();
+
+        if (batch_messages_remaining_ > 0) {
+            batch_messages_remaining_ = 1;
+            finish_batch_message();
+        }
+
+        select_next_session();
+        if (session_ == session) {
+            session_ = nullptr;
+        }
+    }
+
+    // Lazy buffers keep their current view, but can't be fetched anymore
+    for (auto lazy_buffer = lazy_buffers_.begin();
+         lazy_buffer != lazy_buffers_.end();) {
+        string session_buffer_name;
+        if (buffer_session(lazy_buffer->first, session_buffer_name) ==
+            session) {
+            lazy_buffer = lazy_buffers_.erase(lazy_buffer);
+        } else {
+            ++lazy_buffer;
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(ui_mutex_);
+        symbol_completer_->apply_symbol_changes(
+            QStringList(), session->window_symbols(session->available_vars));
+    }
+
+    sessions_.erase(session->number);
+}
+
+
+bool MainWindow::is_decoding_message() const
+{
+    return is_receiving_payload_ || buffer_decoder_.is_pending() ||
+           batch_messages_remaining_ > 0;
+}
+
+
+void MainWindow::select_next_session()
+{
+    if (sessions_.empty()) {
+        session_ = nullptr;
+        return;
+    }
+
+    auto next = session_ == nullptr ? sessions_.end()
+                                    : sessions_.upper_bound(session_->number);
+    if (next == sessions_.end()) {
+        next = sessions_.begin();
+    }
+
+    session_ = next->second.get();
+}
+
+
+void MainWindow::add_session_prefix(string& buffer_name) const
+{
+    buffer_name.insert(0, session_->name_prefix);
+}
+
+
+BridgeSession* MainWindow::buffer_session(const string& buffer_name,
+                                          string& session_buffer_name)
+{
+    int number                = 1;
+    size_t name_prefix_length = 0;
+
+    // Only sessions other than the first one prefix the names of their
+    // buffers, as in "2:image"
+    const size_t separator = buffer_name.find(':');
+    if (separator != string::npos && separator > 0 &&
+        separator <= max_session_number_digits &&
+        all_of(buffer_name.begin(),
+               buffer_name.begin() + separator,
+               [](char c) { return isdigit(static_cast<unsigned char>(c)); })) {
+        const int prefix_number = stoi(buffer_name.substr(0, separator));
+        if (prefix_number > 1) {
+            number             = prefix_number;
+            name_prefix_length = separator + 1;
+        }
+    }
+
+    session_buffer_name = buffer_name.substr(name_prefix_length);
+
+    auto session = sessions_.find(number);
+    return session != sessions_.end() ? session->second.get() : nullptr;
+}
+
+
+void MainWindow::send_buffer_message(MessageType type,
+                                     const string& buffer_name)
+{
+    string session_buffer_name;
+    BridgeSession* session = buffer_session(buffer_name, session_buffer_name);
+    if (session == nullptr) {
+        return;
+    }
+
+    MessageComposer message_composer;
+    message_composer.push(type)
+        .push(session_buffer_name)
+        .send_async(session->send_queue);
+}
+
+
+QStringList MainWindow::available_symbols() const
+{
+    QStringList symbols;
+    for (const auto& session : sessions_) {
+        symbols.append(
+            session.second->window_symbols(session.second->available_vars));
+    }
+
+    return symbols;
+}
+
+
+void MainWindow::pump_send_queues()
+{
+    for (auto& session : sessions_) {
+        session.second->send_queue.pump();
+    }
+}
+
+
+bool MainWindow::has_queued_messages() const
+{
+    for (const auto& session : sessions_) {
+        if (!session.second->send_queue.empty()) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,150 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <iostream>
+
+#include "main_window.h"
+
+#include "ipc/row_packer.h"
+#include "ui/session_snapshot.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Largest number of pixels kept of each buffer
+const size_t max_snapshot_area = 1 << 18;
+
+} // namespace
+
+
+void MainWindow::show_session_snapshot()
+{
+    if (snapshot_capacity_bytes_ == 0) {
+        return;
+    }
+
+    vector<SessionSnapshot::Entry> entries;
+    if (!SessionSnapshot::load(entries)) {
+        return;
+    }
+
+    for (auto& entry : entries) {
+        // Only the buffers which will be plotted again are shown
+        if (previous_session_buffers_.count(entry.name) == 0 ||
+            stages_.count(entry.name) > 0) {
+            continue;
+        }
+
+        // The buffer is labeled as stale until the bridge plots it again
+        update_buffer(entry.name,
+                      entry.name + " (last session)",
+                      entry.pixel_layout,
+                      entry.transpose,
+                      entry.contents_width,
+                      entry.contents_height,
+                      entry.channels,
+                      entry.contents_width,
+                      entry.type,
+                      entry.contents);
+
+        stages_[entry.name]->set_display_size(
+            entry.width, entry.height, true);
+    }
+}
+
+
+void MainWindow::save_session_snapshot()
+{
+    if (snapshot_capacity_bytes_ == 0) {
+        return;
+    }
+
+    vector<SessionSnapshot::Entry> entries;
+    size_t snapshot_size = 0;
+
+    for (const auto& held_buffer : held_buffers_) {
+        const string& buffer_name = held_buffer.first;
+
+        // Lazy buffers only hold the tiles which were viewed, and dropped
+        // contents are only left on the GPU
+        auto buffer_stage = stages_.find(buffer_name);
+        if (held_buffer.second.empty() || buffer_stage == stages_.end() ||
+            lazy_buffers_.count(buffer_name) > 0) {
+            continue;
+        }
+
+        // Skip buffers displaying a past version
+        const Buffer* buffer = buffer_stage->second->get_buffer_component();
+        if (buffer->buffer != held_buffer.second.data()) {
+            continue;
+        }
+
+        const int buffer_width  = static_cast<int>(buffer->buffer_width_f);
+        const int buffer_height = static_cast<int>(buffer->buffer_height_f);
+
+        int factor = 1;
+        while (static_cast<size_t>(buffer_width / factor) *
+                   static_cast<size_t>(buffer_height / factor) >
+               max_snapshot_area) {
+            factor *= 2;
+        }
+
+        SessionSnapshot::Entry entry;
+        entry.name            = buffer_name;
+        entry.pixel_layout    = string(buffer->get_pixel_layout(), 4);
+        entry.transpose       = buffer->transpose;
+        entry.width           = static_cast<int>(buffer->display_width_f);
+        entry.height          = static_cast<int>(buffer->display_height_f);
+        entry.channels        = buffer->channels;
+        entry.type            = buffer->type;
+        entry.contents_width  = (buffer_width + factor - 1) / factor;
+        entry.contents_height = (buffer_height + factor - 1) / factor;
+
+        const size_t pixel_size =
+            held_pixel_size(buffer->type, buffer->channels);
+        pack_preview(held_buffer.second.data(),
+                     buffer_width,
+                     buffer_height,
+                     buffer->step,
+                     pixel_size,
+                     factor,
+                     entry.contents);
+
+        // The buffers which don't fit are left out
+        if (snapshot_size + entry.contents.size() > snapshot_capacity_bytes_) {
+            continue;
+        }
+        snapshot_size += entry.contents.size();
+
+        entries.push_back(std::move(entry));
+    }
+
+    if (!SessionSnapshot::save(entries)) {
+        cerr << "[error] Could not save the session snapshot" << endl;
+    }
+}
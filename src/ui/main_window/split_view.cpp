@@ -0,0 +1,208 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include "main_window.h"
+
+#include "ui/gl_canvas.h"
+#include "ui_main_window.h"
+
+using namespace std;
+
+
+void MainWindow::split_cell_selected(int cell)
+{
+    GLCanvas* canvas = ui_->bufferPreview;
+    if (cell < 0 || cell >= static_cast<int>(split_view_buffers_.size())) {
+        return;
+    }
+
+    canvas->set_active_split_cell(cell);
+
+    // An empty view displays the selected buffer once it is active, the
+    // others have their buffer selected in the list
+    const int row = buffer_list_model_->row_of(
+        QString::fromStdString(split_view_buffers_[cell]));
+    if (row < 0) {
+        split_view_buffers_[cell] = selected_list_buffer_name();
+    } else if (ui_->imageList->currentIndex().row() != row) {
+        ui_->imageList->setCurrentIndex(buffer_list_model_->index(row));
+    }
+
+    update_status_bar();
+    request_render_update();
+}
+
+
+void MainWindow::cycle_split_views()
+{
+    const int count = ui_->bufferPreview->split_count();
+    set_split_view_count(count == 1 ? 2 : (count == 2 ? 4 : 1));
+}
+
+
+void MainWindow::set_split_view_count(int count)
+{
+    GLCanvas* canvas = ui_->bufferPreview;
+    canvas->set_split_count(count);
+
+    split_view_buffers_.resize(canvas->split_count());
+    split_view_buffers_[canvas->active_split_cell()] = selected_list_buffer_name();
+
+    // The cameras project to the size of each view
+    resize_callback(canvas->view_width(), canvas->view_height());
+
+    fill_split_views();
+    update_status_bar();
+    request_render_update();
+    persist_settings_deferred();
+}
+
+
+void MainWindow::show_in_split_view(int cell, const string& variable_name_str)
+{
+    if (cell < 0 || cell >= static_cast<int>(split_view_buffers_.size())) {
+        return;
+    }
+
+    split_view_buffers_[cell] = variable_name_str;
+
+    auto buffer_stage = stages_.find(variable_name_str);
+    if (buffer_stage == stages_.end()) {
+        return;
+    }
+
+    // Stages are only initialized once they are displayed, and their
+    // textures may have been released to save GPU memory
+    Stage* stage = buffer_stage->second.get();
+    if (!stage->initialize_components()) {
+        cerr << "[error] Could not initialize opengl canvas!" << endl;
+    }
+
+    stage->restore_textures();
+    touch_stage_textures(variable_name_str);
+}
+
+
+void MainWindow::fill_split_views()
+{
+    if (ui_->bufferPreview->split_count() == 1) {
+        return;
+    }
+
+    const int active_cell = ui_->bufferPreview->active_split_cell();
+
+    int row = 0;
+    for (int cell = 0; cell < static_cast<int>(split_view_buffers_.size());
+         ++cell) {
+        if (cell == active_cell ||
+            stages_.count(split_view_buffers_[cell]) > 0) {
+            continue;
+        }
+
+        string variable_name_str;
+        while (row < buffer_list_model_->rowCount()) {
+            variable_name_str =
+                buffer_list_model_->buffer_name(row++).toStdString();
+            if (!is_in_split_view(variable_name_str)) {
+                break;
+            }
+            variable_name_str.clear();
+        }
+
+        if (variable_name_str.empty()) {
+            split_view_buffers_[cell].clear();
+            continue;
+        }
+
+        show_in_split_view(cell, variable_name_str);
+    }
+
+    enforce_texture_budget();
+}
+
+
+Stage* MainWindow::split_view_stage(int cell)
+{
+    if (cell == ui_->bufferPreview->active_split_cell()) {
+        return currently_selected_stage_;
+    }
+
+    auto buffer_stage = stages_.find(split_view_buffers_[cell]);
+    if (buffer_stage == stages_.end()) {
+        return nullptr;
+    }
+
+    return buffer_stage->second.get();
+}
+
+
+bool MainWindow::is_in_split_view(const string& variable_name_str) const
+{
+    if (ui_->bufferPreview->split_count() == 1) {
+        return false;
+    }
+
+    return find(split_view_buffers_.begin(),
+                split_view_buffers_.end(),
+                variable_name_str) != split_view_buffers_.end();
+}
+
+
+string MainWindow::selected_list_buffer_name() const
+{
+    const QModelIndex current_index = ui_->imageList->currentIndex();
+    if (!current_index.isValid()) {
+        return string();
+    }
+
+    return buffer_list_model_->buffer_name(current_index.row()).toStdString();
+}
+
+
+void MainWindow::draw_split_views()
+{
+    GLCanvas* canvas = ui_->bufferPreview;
+
+    // All views are drawn in the same frame, each by the stage of its
+    // buffer within its own viewport
+    for (int cell = 0; cell < canvas->split_count(); ++cell) {
+        Stage* stage = split_view_stage(cell);
+        if (stage == nullptr) {
+            continue;
+        }
+
+        canvas->begin_split_cell(cell);
+        stage->draw();
+
+        if (cell == canvas->active_split_cell()) {
+            draw_region_outline();
+        }
+    }
+
+    canvas->end_split_cells();
+}
@@ -0,0 +1,239 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "main_window.h"
+
+#include "ui/memory_panel.h"
+#include "visualization/shader.h"
+
+
+using namespace std;
+
+
+void MainWindow::touch_stage_textures(const string& variable_name_str)
+{
+    auto recent =
+        find(texture_lru_.begin(), texture_lru_.end(), variable_name_str);
+    if (recent != texture_lru_.end()) {
+        texture_lru_.erase(recent);
+    }
+
+    texture_lru_.push_back(variable_name_str);
+}
+
+
+void MainWindow::enforce_texture_budget()
+{
+    size_t texture_bytes = 0;
+    for (const auto& buffer_stage : stages_) {
+        if (!is_buffer_alias(buffer_stage.first)) {
+            texture_bytes += buffer_stage.second->texture_bytes();
+        }
+    }
+
+    // The least recently displayed stages are evicted first. Their textures
+    // are uploaded again from held_buffers_ when they are displayed.
+    auto name = texture_lru_.begin();
+    while (name != texture_lru_.end() &&
+           texture_bytes > texture_memory_budget_) {
+        auto buffer_stage = stages_.find(*name);
+        if (buffer_stage == stages_.end()) {
+            // The buffer was removed
+            name = texture_lru_.erase(name);
+            continue;
+        }
+
+        Stage* stage = buffer_stage->second.get();
+        if (can_release_textures(*name, stage)) {
+            texture_bytes -= stage->texture_bytes();
+            stage->release_textures();
+        }
+
+        ++name;
+    }
+}
+
+
+bool MainWindow::can_release_textures(const string& variable_name_str,
+                                      Stage* stage) const
+{
+    // List icons are rendered from the textures once they are uploaded
+    const bool is_icon_pending =
+        pending_upload_list_updates_.count(variable_name_str) > 0 ||
+        deferred_list_updates_.count(variable_name_str) > 0;
+
+    // Stages whose contents were dropped only have their textures left
+    const bool has_contents = stage->get_buffer_component()->has_contents();
+
+    // The buffer compared with the selected one is sampled along with it,
+    // and the buffers of the other views are drawn in the same frames
+    return stage != currently_selected_stage_ &&
+           !is_in_split_view(variable_name_str) &&
+           stage != difference_reference_stage() && stage->has_textures() &&
+           !stage->has_pending_uploads() && !is_icon_pending && has_contents;
+}
+
+
+bool MainWindow::can_drop_held_buffer(const string& variable_name_str,
+                                      Stage* stage) const
+{
+    // Lazy buffers are assembled from their tile cache instead, and aliases
+    // share the contents of their source
+    if (lazy_buffers_.count(variable_name_str) > 0 ||
+        is_buffer_alias(variable_name_str)) {
+        return false;
+    }
+
+    Buffer* buffer = stage->get_buffer_component();
+    return buffer != nullptr && buffer->can_drop_contents();
+}
+
+
+void MainWindow::drop_uploaded_contents()
+{
+    if (!drop_uploaded_buffers_) {
+        return;
+    }
+
+    for (const auto& buffer_stage : stages_) {
+        if (can_drop_held_buffer(buffer_stage.first,
+                                 buffer_stage.second.get())) {
+            drop_held_buffer(buffer_stage.first);
+        }
+    }
+}
+
+
+void MainWindow::drop_held_buffer(const string& variable_name_str)
+{
+    stages_[variable_name_str]->get_buffer_component()->drop_contents();
+    vector<uint8_t>().swap(held_buffers_[variable_name_str]);
+}
+
+
+void MainWindow::update_memory_panel()
+{
+    if (!memory_dock_->isVisible()) {
+        return;
+    }
+
+    // Buffers drawn with the same program share it
+    map<GLuint, int> program_users;
+    for (const auto& buffer_stage : stages_) {
+        const GLuint program = buffer_stage.second->buffer_program();
+        if (program != 0) {
+            ++program_users[program];
+        }
+    }
+
+    vector<MemoryPanel::BufferMemory> buffers;
+    buffers.reserve(stages_.size());
+
+    for (int row = 0; row < buffer_list_model_->rowCount(); ++row) {
+        const QString& name = buffer_list_model_->buffer_name(row);
+        const string name_str = name.toStdString();
+
+        auto buffer_stage = stages_.find(name_str);
+        if (buffer_stage == stages_.end()) {
+            continue;
+        }
+
+        Stage* stage = buffer_stage->second.get();
+
+        MemoryPanel::BufferMemory buffer;
+        buffer.name       = name;
+        buffer.cpu_bytes  = 0;
+        buffer.gpu_bytes  = stage->texture_bytes();
+        buffer.tiles      = stage->texture_tiles();
+        buffer.icon_bytes = stage->buffer_icon.size();
+        buffer.program    = stage->buffer_program();
+
+        auto held_buffer = held_buffers_.find(name_str);
+        if (held_buffer != held_buffers_.end()) {
+            buffer.cpu_bytes = held_buffer->second.size();
+        }
+
+        buffer.program_users =
+            buffer.program != 0 ? program_users[buffer.program] : 0;
+
+        buffer.can_drop_gpu = can_release_textures(name_str, stage);
+        buffer.can_drop_cpu =
+            buffer.cpu_bytes > 0 && can_drop_held_buffer(name_str, stage);
+
+        buffers.push_back(buffer);
+    }
+
+    memory_panel_->set_buffers(buffers, ShaderProgram::linked_program_count());
+}
+
+
+void MainWindow::memory_panel_visibility_changed(bool visible)
+{
+    if (visible) {
+        update_memory_panel();
+        memory_panel_timer_.start();
+    } else {
+        memory_panel_timer_.stop();
+    }
+}
+
+
+void MainWindow::drop_buffer_textures(const QString& name)
+{
+    const string name_str = name.toStdString();
+
+    auto buffer_stage = stages_.find(name_str);
+    if (buffer_stage != stages_.end() &&
+        can_release_textures(name_str, buffer_stage->second.get())) {
+        buffer_stage->second->release_textures();
+    }
+
+    update_memory_panel();
+}
+
+
+void MainWindow::drop_buffer_contents(const QString& name)
+{
+    const string name_str = name.toStdString();
+
+    auto buffer_stage = stages_.find(name_str);
+    if (buffer_stage != stages_.end() &&
+        can_drop_held_buffer(name_str, buffer_stage->second.get())) {
+        drop_held_buffer(name_str);
+    }
+
+    update_memory_panel();
+}
+
+
+void MainWindow::remove_panel_buffer(const QString& name)
+{
+    remove_buffer(name.toStdString());
+
+    update_memory_panel();
+}
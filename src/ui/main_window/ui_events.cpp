@@ -23,12 +23,16 @@
  * IN THE SOFTWARE.
  */
 
+#include <QDir>
 #include <QFileDialog>
+#include <QInputDialog>
 
 #include "main_window.h"
 
 #include "io/buffer_exporter.h"
 #include "ui_main_window.h"
+#include "ui/frame_scheduler.h"
+#include "ui/perf_overlay.h"
 #include "visualization/components/camera.h"
 #include "visualization/game_object.h"
 
@@ -36,6 +40,31 @@
 using namespace std;
 
 
+namespace
+{
+
+QHash<QString, BufferExporter::OutputType> get_output_extensions()
+{
+    QHash<QString, BufferExporter::OutputType> output_extensions;
+    output_extensions[QObject::tr("Image File (*.png)")] =
+        BufferExporter::OutputType::Bitmap;
+    output_extensions[QObject::tr("Octave Raw Matrix (*.oct)")] =
+        BufferExporter::OutputType::OctaveMatrix;
+    output_extensions[QObject::tr("NumPy Array (*.npy)")] =
+        BufferExporter::OutputType::NumpyArray;
+
+    return output_extensions;
+}
+
+
+QString get_displayed_image_filter()
+{
+    return QObject::tr("Displayed Image (*.png)");
+}
+
+} // namespace
+
+
 void MainWindow::resize_callback(int w, int h)
 {
     for (auto& stage : stages_)
@@ -48,9 +77,13 @@ void MainWindow::resize_callback(int w, int h)
 
 void MainWindow::scroll_callback(float delta)
 {
+    apply_pending_linked_drag();
+
     if (link_views_enabled_) {
         for (auto& stage : stages_) {
-            stage.second->scroll_callback(delta);
+            if (!is_buffer_alias(stage.first)) {
+                stage.second->scroll_callback(delta);
+            }
         }
     } else if (currently_selected_stage_ != nullptr) {
         currently_selected_stage_->scroll_callback(delta);
@@ -61,34 +94,72 @@ void MainWindow::scroll_callback(float delta)
 #if defined(Q_OS_DARWIN)
     ui_->bufferPreview->update();
 #endif
-    request_render_update_ = true;
+    request_render_update();
 }
 
 
 void MainWindow::mouse_drag_event(int mouse_x, int mouse_y)
 {
+    if (drag_region(mouse_x, mouse_y)) {
+        return;
+    }
+
     const QPoint virtual_motion(static_cast<int>(mouse_x),
                                 static_cast<int>(mouse_y));
 
-    if (link_views_enabled_) {
-        for (auto& stage : stages_)
-            stage.second->mouse_drag_event(virtual_motion.x(),
-                                           virtual_motion.y());
+    // Drags commute, so the other linked stages can be moved all at once
+    // later, unless they are displayed by the other views
+    if (link_views_enabled_ && ui_->bufferPreview->split_count() == 1 &&
+        ui_->bufferPreview->get_frame_scheduler()->is_deferring()) {
+        pending_linked_drag_ += virtual_motion;
+        if (currently_selected_stage_ != nullptr) {
+            currently_selected_stage_->mouse_drag_event(virtual_motion.x(),
+                                                        virtual_motion.y());
+        }
+    } else if (link_views_enabled_) {
+        apply_pending_linked_drag();
+        for (auto& stage : stages_) {
+            if (!is_buffer_alias(stage.first)) {
+                stage.second->mouse_drag_event(virtual_motion.x(),
+                                               virtual_motion.y());
+            }
+        }
     } else if (currently_selected_stage_ != nullptr) {
         currently_selected_stage_->mouse_drag_event(virtual_motion.x(),
                                                     virtual_motion.y());
     }
 
-    request_render_update_ = true;
+    request_render_update();
 }
 
 
 void MainWindow::mouse_move_event(int, int)
 {
+    // The mouse button was released
+    is_selecting_region_ = false;
+
     update_status_bar();
 }
 
 
+void MainWindow::apply_pending_linked_drag()
+{
+    if (pending_linked_drag_.isNull()) {
+        return;
+    }
+
+    for (auto& stage : stages_) {
+        if (stage.second.get() != currently_selected_stage_ &&
+            !is_buffer_alias(stage.first)) {
+            stage.second->mouse_drag_event(pending_linked_drag_.x(),
+                                           pending_linked_drag_.y());
+        }
+    }
+
+    pending_linked_drag_ = QPoint();
+}
+
+
 void MainWindow::resizeEvent(QResizeEvent*)
 {
     persist_settings_deferred();
@@ -104,6 +175,7 @@ void MainWindow::moveEvent(QMoveEvent*)
 void MainWindow::closeEvent(QCloseEvent*)
 {
     is_window_ready_ = false;
+    save_session_snapshot();
     persist_settings_deferred();
 }
 
@@ -112,13 +184,35 @@ bool MainWindow::eventFilter(QObject* target, QEvent* event)
 {
     KeyboardState::update_keyboard_state(event);
 
+    // Input events may change anything displayed, and the frames drawn
+    // meanwhile are kept within their budget
+    switch (event->type()) {
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseMove:
+    case QEvent::Wheel:
+    case QEvent::Resize:
+        ui_->bufferPreview->get_frame_scheduler()->notify_interaction();
+        schedule_loop();
+        break;
+    default:
+        break;
+    }
+
     if (event->type() == QEvent::KeyPress) {
         QKeyEvent* key_event = static_cast<QKeyEvent*>(event);
 
         EventProcessCode event_intercepted = EventProcessCode::IGNORED;
 
         if (link_views_enabled_) {
+            apply_pending_linked_drag();
             for (auto& stage : stages_) {
+                if (is_buffer_alias(stage.first)) {
+                    continue;
+                }
+
                 EventProcessCode event_intercepted_stage =
                     stage.second->key_press_event(key_event->key());
 
@@ -132,7 +226,7 @@ bool MainWindow::eventFilter(QObject* target, QEvent* event)
         }
 
         if (event_intercepted == EventProcessCode::INTERCEPTED) {
-            request_render_update_ = true;
+            request_render_update();
             update_status_bar();
 
             event->accept();
@@ -148,27 +242,27 @@ bool MainWindow::eventFilter(QObject* target, QEvent* event)
 
 void MainWindow::recenter_buffer()
 {
+    apply_pending_linked_drag();
+
     if (link_views_enabled_) {
         for (auto& stage : stages_) {
-            GameObject* cam_obj = stage.second->get_game_object("camera");
-            Camera* cam = cam_obj->get_component<Camera>("camera_component");
+            Camera* cam = stage.second->get_camera_component();
             cam->recenter_camera();
         }
     } else {
         if (currently_selected_stage_ != nullptr) {
-            GameObject* cam_obj =
-                currently_selected_stage_->get_game_object("camera");
-            Camera* cam = cam_obj->get_component<Camera>("camera_component");
+            Camera* cam = currently_selected_stage_->get_camera_component();
             cam->recenter_camera();
         }
     }
 
-    request_render_update_ = true;
+    request_render_update();
 }
 
 
 void MainWindow::link_views_toggle()
 {
+    apply_pending_linked_drag();
     link_views_enabled_ = !link_views_enabled_;
 }
 
@@ -176,16 +270,16 @@ void MainWindow::link_views_toggle()
 void MainWindow::rotate_90_cw()
 {
     const auto request_90_cw_rotation = [](Stage* stage) {
-        GameObject* buffer_obj = stage->get_game_object("buffer");
-        Buffer* buffer_comp =
-            buffer_obj->get_component<Buffer>("buffer_component");
+        Buffer* buffer_comp = stage->get_buffer_component();
 
         buffer_comp->rotate(static_cast<float>(90.0 * M_PI / 180.0));
     };
 
     if (link_views_enabled_) {
         for (auto& stage : stages_) {
-            request_90_cw_rotation(stage.second.get());
+            if (!is_buffer_alias(stage.first)) {
+                request_90_cw_rotation(stage.second.get());
+            }
         }
     } else {
         if (currently_selected_stage_ != nullptr) {
@@ -193,23 +287,23 @@ void MainWindow::rotate_90_cw()
         }
     }
 
-    request_render_update_ = true;
+    request_render_update();
 }
 
 
 void MainWindow::rotate_90_ccw()
 {
     const auto request_90_ccw_rotation = [](Stage* stage) {
-        GameObject* buffer_obj = stage->get_game_object("buffer");
-        Buffer* buffer_comp =
-            buffer_obj->get_component<Buffer>("buffer_component");
+        Buffer* buffer_comp = stage->get_buffer_component();
 
         buffer_comp->rotate(static_cast<float>(-90.0 * M_PI / 180.0));
     };
 
     if (link_views_enabled_) {
         for (auto& stage : stages_) {
-            request_90_ccw_rotation(stage.second.get());
+            if (!is_buffer_alias(stage.first)) {
+                request_90_ccw_rotation(stage.second.get());
+            }
         }
     } else {
         if (currently_selected_stage_ != nullptr) {
@@ -217,19 +311,28 @@ void MainWindow::rotate_90_ccw()
         }
     }
 
-    request_render_update_ = true;
+    request_render_update();
 }
 
 
-void MainWindow::buffer_selected(QListWidgetItem* item)
+void MainWindow::buffer_selected(const QModelIndex& index)
 {
-    if (item == nullptr)
+    if (!index.isValid())
         return;
 
-    auto stage =
-        stages_.find(item->data(Qt::UserRole).toString().toStdString());
+    auto stage = stages_.find(
+        buffer_list_model_->buffer_name(index.row()).toStdString());
     if (stage != stages_.end()) {
+        // Past versions are only displayed for the selected buffer
+        if (stage->first != history_buffer_name_) {
+            show_live_buffer();
+        }
+
         set_currently_selected_stage(stage->second.get());
+        show_in_split_view(ui_->bufferPreview->active_split_cell(),
+                           stage->first);
+        update_history_timeline();
+        update_difference_reference();
         reset_ac_min_labels();
         reset_ac_max_labels();
 
@@ -240,23 +343,59 @@ void MainWindow::buffer_selected(QListWidgetItem* item)
 
 void MainWindow::remove_selected_buffer()
 {
-    if (ui_->imageList->count() > 0 && currently_selected_stage_ != nullptr) {
-        QListWidgetItem* removed_item =
-            ui_->imageList->takeItem(ui_->imageList->currentRow());
-        string buffer_name =
-            removed_item->data(Qt::UserRole).toString().toStdString();
-        stages_.erase(buffer_name);
-        held_buffers_.erase(buffer_name);
-        delete removed_item;
-
-        removed_buffer_names_.insert(buffer_name);
-
-        if (stages_.size() == 0) {
-            set_currently_selected_stage(nullptr);
-        }
+    const QModelIndex current_index = ui_->imageList->currentIndex();
+    if (current_index.isValid() && currently_selected_stage_ != nullptr) {
+        remove_buffer(
+            buffer_list_model_->buffer_name(current_index.row()).toStdString());
+    }
+}
 
-        persist_settings_deferred();
+
+void MainWindow::remove_buffer(const string& buffer_name)
+{
+    auto stage = stages_.find(buffer_name);
+    if (stage == stages_.end()) {
+        return;
+    }
+
+    // The list selects the next buffer once the row is removed. The stage
+    // of an alias remains displayed by its source.
+    if (stage->second.get() == currently_selected_stage_ &&
+        !is_buffer_alias(buffer_name)) {
+        set_currently_selected_stage(nullptr);
     }
+
+    // The selected buffer must stop sampling the textures of the reference
+    if (buffer_name == difference_reference_name_) {
+        difference_reference_name_.clear();
+        update_difference_reference();
+    }
+
+    const QString removed_name = buffer_name.c_str();
+    remove_buffer_aliases(buffer_name);
+    stages_.erase(stage);
+    held_buffers_.erase(buffer_name);
+    lazy_buffers_.erase(buffer_name);
+    forget_buffer_history(buffer_name);
+    icon_update_times_.erase(buffer_name);
+    debounced_list_updates_.erase(buffer_name);
+    buffer_list_model_->remove_buffer(removed_name);
+
+    removed_buffer_names_.insert(buffer_name);
+
+    // The timeline follows the buffer selected next, if any
+    update_history_timeline();
+
+    // The bridge must send the full contents if this is plotted again
+    send_buffer_message(MessageType::InvalidateBufferCache, buffer_name);
+
+    if (stages_.size() == 0) {
+        set_currently_selected_stage(nullptr);
+    }
+
+    fill_split_views();
+
+    persist_settings_deferred();
 }
 
 
@@ -291,18 +430,14 @@ void MainWindow::export_buffer()
     auto stage =
         stages_.find(sender_action->data().toString().toStdString())->second;
 
-    GameObject* buffer_obj = stage->get_game_object("buffer");
-    Buffer* component = buffer_obj->get_component<Buffer>("buffer_component");
+    Buffer* component = stage->get_buffer_component();
 
     QFileDialog file_dialog(this);
     file_dialog.setAcceptMode(QFileDialog::AcceptSave);
     file_dialog.setFileMode(QFileDialog::AnyFile);
 
-    QHash<QString, BufferExporter::OutputType> output_extensions;
-    output_extensions[tr("Image File (*.png)")] =
-        BufferExporter::OutputType::Bitmap;
-    output_extensions[tr("Octave Raw Matrix (*.oct)")] =
-        BufferExporter::OutputType::OctaveMatrix;
+    const QHash<QString, BufferExporter::OutputType> output_extensions =
+        get_output_extensions();
 
     // Generate the save suffix string
     QHashIterator<QString, BufferExporter::OutputType> it(output_extensions);
@@ -312,10 +447,12 @@ void MainWindow::export_buffer()
     while (it.hasNext()) {
         it.next();
         save_message += it.key();
-        if (it.hasNext())
-            save_message += ";;";
+        save_message += ";;";
     }
 
+    // Rendered by the GPU, rather than converted from the buffer contents
+    save_message += get_displayed_image_filter();
+
     file_dialog.setNameFilter(save_message);
     file_dialog.selectNameFilter(default_export_suffix_);
 
@@ -323,11 +460,41 @@ void MainWindow::export_buffer()
         string file_name = file_dialog.selectedFiles()[0].toStdString();
         const auto selected_filter = file_dialog.selectedNameFilter();
 
-        // Export buffer
-        BufferExporter::export_buffer(
-            component,
-            file_name,
-            output_extensions[selected_filter]);
+        if (selected_filter == get_displayed_image_filter()) {
+            export_displayed_buffer(stage.get(), file_name);
+            return;
+        }
+
+        // Dropped contents are read back from the textures to be exported
+        vector<uint8_t> texels;
+        const uint8_t* contents = component->buffer;
+        int step                = component->step;
+        if (!component->has_contents()) {
+            if (!component->read_texels(
+                    0,
+                    0,
+                    static_cast<int>(component->buffer_width_f),
+                    static_cast<int>(component->buffer_height_f),
+                    texels)) {
+                cerr << "[error] Could not read the buffer back for export"
+                     << endl;
+                return;
+            }
+
+            contents = texels.data();
+            step     = static_cast<int>(component->buffer_width_f);
+        }
+
+        // The buffer is exported in the background, from a copy of its
+        // contents
+        if (!buffer_exporter_.start(contents,
+                                    step,
+                                    component,
+                                    file_name,
+                                    output_extensions[selected_filter])) {
+            status_bar_->setText("[error] Another buffer is being exported");
+        }
+        schedule_loop();
 
         // Update default export suffix to the previously used suffix
         default_export_suffix_ = selected_filter;
@@ -338,9 +505,141 @@ void MainWindow::export_buffer()
 }
 
 
+void MainWindow::export_displayed_buffer(Stage* stage,
+                                         const string& file_name)
+{
+    bool accepted;
+    const double scale = QInputDialog::getDouble(this,
+                                                 tr("Export as displayed"),
+                                                 tr("Scale:"),
+                                                 1.0,
+                                                 0.01,
+                                                 100.0,
+                                                 2,
+                                                 &accepted);
+    if (!accepted) {
+        return;
+    }
+
+    // Evicted textures are uploaded again, which has to finish first
+    if (!stage->has_textures()) {
+        stage->restore_textures();
+    }
+
+    if (stage->has_pending_uploads()) {
+        status_bar_->setText(
+            "[error] The buffer is still being uploaded, export it again "
+            "once it is displayed");
+        schedule_loop();
+        return;
+    }
+
+    if (buffer_exporter_.is_pending()) {
+        status_bar_->setText("[error] Another buffer is being exported");
+        return;
+    }
+
+    QImage image;
+    if (!ui_->bufferPreview->render_buffer_image(
+            stage, static_cast<float>(scale), image)) {
+        status_bar_->setText("[error] Could not render the buffer");
+        return;
+    }
+
+    buffer_exporter_.start_image(move(image), file_name);
+    schedule_loop();
+
+    // The displayed image is chosen again by default for later exports
+    default_export_suffix_ = get_displayed_image_filter();
+    persist_settings_deferred();
+}
+
+
+void MainWindow::export_all_buffers()
+{
+    const QString directory = QFileDialog::getExistingDirectory(
+        this, tr("Export all buffers"), QString());
+
+    if (!directory.isEmpty()) {
+        start_bulk_export(directory);
+    }
+}
+
+
+bool MainWindow::start_bulk_export(const QString& directory)
+{
+    if (!QDir().mkpath(directory)) {
+        cerr << "[error] Could not create the export directory "
+             << directory.toStdString() << endl;
+        return false;
+    }
+
+    vector<BufferExporter::BulkBuffer> buffers;
+
+    // Dropped contents are read back from the textures to be exported
+    vector<vector<uint8_t>> texels;
+    texels.reserve(stages_.size());
+
+    for (const auto& stage : stages_) {
+        // Lazy buffers were only received in parts
+        if (lazy_buffers_.count(stage.first) > 0) {
+            continue;
+        }
+
+        Buffer* component = stage.second->get_buffer_component();
+        if (component == nullptr) {
+            continue;
+        }
+
+        const uint8_t* contents = component->buffer;
+        int step                = component->step;
+        if (!component->has_contents()) {
+            texels.emplace_back();
+            if (!component->read_texels(
+                    0,
+                    0,
+                    static_cast<int>(component->buffer_width_f),
+                    static_cast<int>(component->buffer_height_f),
+                    texels.back())) {
+                cerr << "[error] Could not read the buffer " << stage.first
+                     << " back for export" << endl;
+                texels.pop_back();
+                continue;
+            }
+
+            contents = texels.back().data();
+            step     = static_cast<int>(component->buffer_width_f);
+        }
+
+        buffers.push_back(
+            BufferExporter::BulkBuffer{stage.first, component, contents, step});
+    }
+
+    // The buffers are exported in the background, from a copy of their
+    // contents. Exports as displayed fall back to bitmaps.
+    const bool started = buffer_exporter_.start_bulk(
+        buffers,
+        directory.toStdString(),
+        get_output_extensions()[default_export_suffix_]);
+    if (!started) {
+        status_bar_->setText("[error] Another buffer is being exported");
+    }
+    schedule_loop();
+
+    return started;
+}
+
+
+void MainWindow::cancel_export()
+{
+    buffer_exporter_.cancel();
+}
+
+
 void MainWindow::show_context_menu(const QPoint& pos)
 {
-    if (ui_->imageList->itemAt(pos) != nullptr) {
+    const QModelIndex index = ui_->imageList->indexAt(pos);
+    if (index.isValid()) {
         // Handle global position
         QPoint globalPos = ui_->imageList->mapToGlobal(pos);
 
@@ -351,7 +650,50 @@ void MainWindow::show_context_menu(const QPoint& pos)
             myMenu.addAction("Export buffer", this, SLOT(export_buffer()));
 
         // Add parameter to action: buffer name
-        exportAction->setData(ui_->imageList->itemAt(pos)->data(Qt::UserRole));
+        exportAction->setData(
+            index.data(BufferListModel::BufferNameRole));
+
+        myMenu.addAction(
+            "Export all buffers...", this, SLOT(export_all_buffers()));
+
+        if (buffer_exporter_.is_pending()) {
+            myMenu.addAction("Cancel export", this, SLOT(cancel_export()));
+        }
+
+        myMenu.addSeparator();
+
+        const QString buffer_name =
+            index.data(BufferListModel::BufferNameRole).toString();
+        if (currently_selected_stage_ != nullptr &&
+            buffer_name.toStdString() != selected_buffer_name()) {
+            QAction* compare_action = myMenu.addAction(
+                "Compare with this buffer", this, SLOT(compare_with_buffer()));
+            compare_action->setData(buffer_name);
+        }
+
+        if (!history_buffer_name_.empty()) {
+            myMenu.addAction("Compare with the displayed version",
+                             this,
+                             SLOT(compare_with_history_version()));
+        }
+
+        if (is_comparing()) {
+            QMenu* mode_menu = myMenu.addMenu("Difference");
+
+            const vector<pair<const char*, DifferenceMode>> modes = {
+                {"Absolute", DifferenceMode::Absolute},
+                {"Signed", DifferenceMode::Signed},
+                {"Relative", DifferenceMode::Relative}};
+            for (const auto& mode : modes) {
+                QAction* mode_action = mode_menu->addAction(
+                    mode.first, this, SLOT(set_difference_mode()));
+                mode_action->setCheckable(true);
+                mode_action->setChecked(mode.second == difference_mode_);
+                mode_action->setData(static_cast<int>(mode.second));
+            }
+
+            myMenu.addAction("Stop comparing", this, SLOT(stop_comparing()));
+        }
 
         // Show context menu at handling position
         myMenu.exec(globalPos);
@@ -365,9 +707,7 @@ void MainWindow::toggle_go_to_dialog()
         vec4 default_goal(0, 0, 0, 0);
 
         if (currently_selected_stage_ != nullptr) {
-            GameObject* cam_obj =
-                currently_selected_stage_->get_game_object("camera");
-            Camera* cam = cam_obj->get_component<Camera>("camera_component");
+            Camera* cam = currently_selected_stage_->get_camera_component();
 
             default_goal = cam->get_position();
         }
@@ -379,8 +719,20 @@ void MainWindow::toggle_go_to_dialog()
 }
 
 
+void MainWindow::toggle_perf_overlay()
+{
+    PerfOverlay* perf_overlay = ui_->bufferPreview->get_perf_overlay();
+    perf_overlay->set_enabled(!perf_overlay->is_enabled());
+
+    persist_settings_deferred();
+    request_render_update();
+}
+
+
 void MainWindow::go_to_pixel(float x, float y)
 {
+    apply_pending_linked_drag();
+
     if (link_views_enabled_) {
         for (auto& stage : stages_) {
             stage.second->go_to_pixel(x, y);
@@ -391,5 +743,5 @@ void MainWindow::go_to_pixel(float x, float y)
 
     update_status_bar();
 
-    request_render_update_ = true;
+    request_render_update();
 }
@@ -0,0 +1,241 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "memory_panel.h"
+
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+
+using namespace std;
+
+
+namespace
+{
+
+enum Column {
+    NameColumn,
+    CpuColumn,
+    GpuColumn,
+    TilesColumn,
+    IconColumn,
+    ProgramColumn,
+    NumColumns
+};
+
+
+QString format_bytes(size_t bytes)
+{
+    if (bytes >= (size_t(1) << 30)) {
+        return QString("%1 GiB").arg(bytes / double(1 << 30), 0, 'f', 2);
+    } else if (bytes >= (size_t(1) << 20)) {
+        return QString("%1 MiB").arg(bytes / double(1 << 20), 0, 'f', 1);
+    } else if (bytes >= (size_t(1) << 10)) {
+        return QString("%1 KiB").arg(bytes / double(1 << 10), 0, 'f', 1);
+    }
+
+    return QString("%1 B").arg(bytes);
+}
+
+
+QTableWidgetItem* make_item(const QString& text, bool is_number)
+{
+    QTableWidgetItem* item = new QTableWidgetItem(text);
+    item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+    if (is_number) {
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    }
+
+    return item;
+}
+
+} // namespace
+
+
+MemoryPanel::MemoryPanel(QWidget* parent)
+    : QWidget(parent)
+{
+    table_ = new QTableWidget(0, NumColumns, this);
+    table_->setHorizontalHeaderLabels(
+        {"Buffer", "CPU", "GPU", "Tiles", "Icon", "Program"});
+    table_->verticalHeader()->setVisible(false);
+    table_->horizontalHeader()->setSectionResizeMode(
+        NameColumn, QHeaderView::Stretch);
+    table_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table_->setSelectionMode(QAbstractItemView::SingleSelection);
+
+    totals_ = new QLabel(this);
+
+    drop_gpu_button_ = new QPushButton("Drop GPU copy", this);
+    drop_gpu_button_->setToolTip(
+        "Release the textures of the buffer, which are uploaded again when "
+        "it is displayed");
+    drop_cpu_button_ = new QPushButton("Drop CPU copy", this);
+    drop_cpu_button_->setToolTip(
+        "Free the contents held by the window once its textures hold all of "
+        "them; pixel values are then read back from the GPU");
+    remove_button_ = new QPushButton("Remove buffer", this);
+
+    QHBoxLayout* actions = new QHBoxLayout();
+    actions->addWidget(drop_gpu_button_);
+    actions->addWidget(drop_cpu_button_);
+    actions->addWidget(remove_button_);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addWidget(table_);
+    layout->addWidget(totals_);
+    layout->addLayout(actions);
+
+    connect(table_,
+            SIGNAL(itemSelectionChanged()),
+            this,
+            SLOT(update_actions()));
+    connect(drop_gpu_button_,
+            SIGNAL(clicked()),
+            this,
+            SLOT(request_drop_gpu()));
+    connect(drop_cpu_button_,
+            SIGNAL(clicked()),
+            this,
+            SLOT(request_drop_cpu()));
+    connect(remove_button_, SIGNAL(clicked()), this, SLOT(request_remove()));
+
+    update_actions();
+}
+
+
+void MemoryPanel::set_buffers(const vector<BufferMemory>& buffers,
+                              size_t linked_programs)
+{
+    const int selected    = selected_buffer();
+    const QString current = selected >= 0 ? buffers_[selected].name : QString();
+
+    buffers_ = buffers;
+
+    // Rows are refreshed in place, so that the table doesn't scroll back
+    table_->blockSignals(true);
+    table_->setRowCount(static_cast<int>(buffers_.size()));
+
+    size_t cpu_bytes  = 0;
+    size_t gpu_bytes  = 0;
+    size_t icon_bytes = 0;
+
+    for (int row = 0; row < static_cast<int>(buffers_.size()); ++row) {
+        const BufferMemory& buffer = buffers_[static_cast<size_t>(row)];
+
+        const QString program =
+            buffer.program == 0
+                ? QString("-")
+                : QString("#%1 (%2 buffers)")
+                      .arg(buffer.program)
+                      .arg(buffer.program_users);
+
+        table_->setItem(row, NameColumn, make_item(buffer.name, false));
+        table_->setItem(
+            row, CpuColumn, make_item(format_bytes(buffer.cpu_bytes), true));
+        table_->setItem(
+            row, GpuColumn, make_item(format_bytes(buffer.gpu_bytes), true));
+        table_->setItem(
+            row, TilesColumn, make_item(QString::number(buffer.tiles), true));
+        table_->setItem(
+            row, IconColumn, make_item(format_bytes(buffer.icon_bytes), true));
+        table_->setItem(row, ProgramColumn, make_item(program, false));
+
+        if (buffer.name == current) {
+            table_->selectRow(row);
+        }
+
+        cpu_bytes += buffer.cpu_bytes;
+        gpu_bytes += buffer.gpu_bytes;
+        icon_bytes += buffer.icon_bytes;
+    }
+
+    table_->blockSignals(false);
+
+    totals_->setText(QString("Total: %1 CPU, %2 GPU, %3 icons, %4 shader "
+                             "programs")
+                         .arg(format_bytes(cpu_bytes))
+                         .arg(format_bytes(gpu_bytes))
+                         .arg(format_bytes(icon_bytes))
+                         .arg(linked_programs));
+
+    update_actions();
+}
+
+
+void MemoryPanel::update_actions()
+{
+    const int selected = selected_buffer();
+
+    drop_gpu_button_->setEnabled(selected >= 0 &&
+                                 buffers_[selected].can_drop_gpu);
+    drop_cpu_button_->setEnabled(selected >= 0 &&
+                                 buffers_[selected].can_drop_cpu);
+    remove_button_->setEnabled(selected >= 0);
+}
+
+
+void MemoryPanel::request_drop_gpu()
+{
+    const int selected = selected_buffer();
+    if (selected >= 0) {
+        Q_EMIT(drop_gpu_requested(buffers_[selected].name));
+    }
+}
+
+
+void MemoryPanel::request_drop_cpu()
+{
+    const int selected = selected_buffer();
+    if (selected >= 0) {
+        Q_EMIT(drop_cpu_requested(buffers_[selected].name));
+    }
+}
+
+
+void MemoryPanel::request_remove()
+{
+    const int selected = selected_buffer();
+    if (selected >= 0) {
+        Q_EMIT(remove_requested(buffers_[selected].name));
+    }
+}
+
+
+int MemoryPanel::selected_buffer() const
+{
+    const QList<QTableWidgetItem*> selected = table_->selectedItems();
+    if (selected.empty()) {
+        return -1;
+    }
+
+    const int row = selected.front()->row();
+    if (row < 0 || row >= static_cast<int>(buffers_.size())) {
+        return -1;
+    }
+
+    return row;
+}
@@ -0,0 +1,106 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MEMORY_PANEL_H_
+#define MEMORY_PANEL_H_
+
+#include <cstddef>
+#include <vector>
+
+#include <QLabel>
+#include <QPushButton>
+#include <QString>
+#include <QTableWidget>
+#include <QWidget>
+
+
+/*
+ * Lists the memory each plotted buffer costs, with actions to free it: its
+ * GPU copy (which is uploaded again from its CPU copy when it is displayed),
+ * its CPU copy (once its textures hold all of it) or the whole buffer.
+ */
+class MemoryPanel : public QWidget
+{
+    Q_OBJECT
+
+  public:
+    struct BufferMemory
+    {
+        QString name;
+
+        // Contents held by the window
+        std::size_t cpu_bytes;
+
+        // Textures, and the tiles they are split in
+        std::size_t gpu_bytes;
+        int tiles;
+
+        std::size_t icon_bytes;
+
+        // Linked program the buffer is drawn with, and the number of
+        // buffers sharing it
+        unsigned int program;
+        int program_users;
+
+        bool can_drop_gpu;
+        bool can_drop_cpu;
+    };
+
+    explicit MemoryPanel(QWidget* parent = nullptr);
+
+    // Show the given buffers, keeping the selected one selected
+    void set_buffers(const std::vector<BufferMemory>& buffers,
+                     std::size_t linked_programs);
+
+  Q_SIGNALS:
+    void drop_gpu_requested(const QString& name);
+
+    void drop_cpu_requested(const QString& name);
+
+    void remove_requested(const QString& name);
+
+  private Q_SLOTS:
+    void update_actions();
+
+    void request_drop_gpu();
+
+    void request_drop_cpu();
+
+    void request_remove();
+
+  private:
+    QTableWidget* table_;
+    QLabel* totals_;
+    QPushButton* drop_gpu_button_;
+    QPushButton* drop_cpu_button_;
+    QPushButton* remove_button_;
+
+    std::vector<BufferMemory> buffers_;
+
+    // Index in buffers_ of the selected row, or -1
+    int selected_buffer() const;
+};
+
+#endif // MEMORY_PANEL_H_
@@ -0,0 +1,243 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "perf_overlay.h"
+
+#include <cstdio>
+
+#include "math/linear_algebra.h"
+#include "ui/frame_scheduler.h"
+#include "ui/gl_text_renderer.h"
+#include "visualization/components/buffer.h"
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Distance of the text from the corner of the canvas, in lines
+const float overlay_margin = 0.5f;
+
+constexpr double bytes_per_mb = 1024.0 * 1024.0;
+
+constexpr int num_lines = 6;
+
+// Floats per glyph vertex: position, atlas coordinates and value
+constexpr int glyph_vertex_size = 5;
+
+} // namespace
+
+
+PerfOverlay::PerfOverlay(GLCanvas* gl_canvas)
+    : gl_canvas_(gl_canvas)
+    , enabled_(false)
+    , in_frame_(false)
+    , frame_draw_calls_(0)
+    , draw_calls_(0)
+    , transfer_bytes_(0)
+    , transfer_ms_(0.0)
+    , texture_bytes_(0)
+    , held_bytes_(0)
+{
+    for (int i = 0; i < num_update_steps; ++i) {
+        update_step_ms_[i] = 0.0;
+    }
+}
+
+
+bool PerfOverlay::is_enabled() const
+{
+    return enabled_;
+}
+
+
+void PerfOverlay::set_enabled(bool enabled)
+{
+    enabled_ = enabled;
+}
+
+
+void PerfOverlay::begin_frame()
+{
+    frame_draw_calls_ = 0;
+    in_frame_         = true;
+}
+
+
+void PerfOverlay::end_frame()
+{
+    in_frame_   = false;
+    draw_calls_ = frame_draw_calls_;
+
+    if (enabled_) {
+        draw();
+    }
+}
+
+
+void PerfOverlay::count_draw_call()
+{
+    // Icons and exports are drawn outside of the frames
+    if (in_frame_) {
+        ++frame_draw_calls_;
+    }
+}
+
+
+void PerfOverlay::set_transfer(size_t bytes, double duration_ms)
+{
+    transfer_bytes_ = bytes;
+    transfer_ms_    = duration_ms;
+}
+
+
+void PerfOverlay::set_update_step(UpdateStep step, double duration_ms)
+{
+    update_step_ms_[static_cast<int>(step)] = duration_ms;
+}
+
+
+void PerfOverlay::set_memory(size_t texture_bytes, size_t held_bytes)
+{
+    texture_bytes_ = texture_bytes;
+    held_bytes_    = held_bytes;
+}
+
+
+void PerfOverlay::draw()
+{
+    const FrameScheduler* scheduler = gl_canvas_->get_frame_scheduler();
+    const double* step_ms           = update_step_ms_;
+
+    char lines[num_lines][96];
+    if (scheduler->measures_gpu_cost()) {
+        snprintf(lines[0],
+                 sizeof(lines[0]),
+                 "frame     cpu %.2f ms  gpu %.2f ms",
+                 scheduler->cpu_cost_ms(),
+                 scheduler->gpu_cost_ms());
+    } else {
+        snprintf(lines[0],
+                 sizeof(lines[0]),
+                 "frame     cpu %.2f ms  gpu n/a",
+                 scheduler->cpu_cost_ms());
+    }
+    snprintf(lines[1], sizeof(lines[1]), "draws     %d", draw_calls_);
+    snprintf(lines[2],
+             sizeof(lines[2]),
+             "transfer  %.1f MB in %.1f ms (%.1f MB/s)",
+             transfer_bytes_ / bytes_per_mb,
+             transfer_ms_,
+             transfer_ms_ > 0.0
+                 ? transfer_bytes_ / bytes_per_mb / (transfer_ms_ / 1000.0)
+                 : 0.0);
+    snprintf(lines[3],
+             sizeof(lines[3]),
+             "update    decompress %.1f  convert %.1f  min-max %.1f ms",
+             step_ms[static_cast<int>(UpdateStep::Decompress)],
+             step_ms[static_cast<int>(UpdateStep::Convert)],
+             step_ms[static_cast<int>(UpdateStep::Range)]);
+    snprintf(lines[4],
+             sizeof(lines[4]),
+             "          stage %.1f  upload %.1f  thumbnail %.1f ms",
+             step_ms[static_cast<int>(UpdateStep::Update)],
+             step_ms[static_cast<int>(UpdateStep::Upload)],
+             step_ms[static_cast<int>(UpdateStep::Thumbnail)]);
+    snprintf(lines[5],
+             sizeof(lines[5]),
+             "memory    textures %.1f MB  buffers %.1f MB",
+             texture_bytes_ / bytes_per_mb,
+             held_bytes_ / bytes_per_mb);
+
+    const GLTextRenderer* text_renderer = gl_canvas_->get_text_renderer();
+    const float line_height =
+        static_cast<float>(text_renderer->overlay_cell_height);
+    const float margin = overlay_margin * line_height;
+
+    // Light text with a dark shadow, which stays readable over any buffer.
+    // With the neutral contrast, labels of value 0 are white.
+    glyph_vertices_.clear();
+    for (int shadow = 1; shadow >= 0; --shadow) {
+        for (int l = 0; l < num_lines; ++l) {
+            text_renderer->append_overlay_text(lines[l],
+                                               margin + shadow,
+                                               margin + l * line_height +
+                                                   shadow,
+                                               static_cast<float>(shadow),
+                                               glyph_vertices_);
+        }
+    }
+
+    // Window pixels, from the top left corner of the canvas
+    const qreal pixel_ratio = gl_canvas_->devicePixelRatioF();
+    const float width  = static_cast<float>(gl_canvas_->width() * pixel_ratio);
+    const float height =
+        static_cast<float>(gl_canvas_->height() * pixel_ratio);
+
+    mat4 projection;
+    projection.set_ortho_projection(width / 2.0f, height / 2.0f, -1.0f, 1.0f);
+    const mat4 window_projection =
+        projection *
+        mat4::translation(vec4(-width / 2.0f, -height / 2.0f, 0.0f, 1.0f));
+
+    text_renderer->text_prog.use();
+
+    const GLsizei stride = glyph_vertex_size * sizeof(GLfloat);
+
+    gl_canvas_->glBindBuffer(GL_ARRAY_BUFFER, text_renderer->text_vbo);
+    gl_canvas_->glBufferData(GL_ARRAY_BUFFER,
+                             glyph_vertices_.size() * sizeof(GLfloat),
+                             glyph_vertices_.data(),
+                             GL_STREAM_DRAW);
+    gl_canvas_->glEnableVertexAttribArray(0);
+    gl_canvas_->glEnableVertexAttribArray(1);
+    gl_canvas_->glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, 0);
+    gl_canvas_->glVertexAttribPointer(
+        1,
+        1,
+        GL_FLOAT,
+        GL_FALSE,
+        stride,
+        reinterpret_cast<void*>(4 * sizeof(GLfloat)));
+
+    gl_canvas_->glActiveTexture(GL_TEXTURE0);
+    gl_canvas_->glBindTexture(GL_TEXTURE_2D, text_renderer->overlay_tex);
+    text_renderer->text_prog.uniform1i("text_sampler", 0);
+
+    text_renderer->text_prog.uniform_matrix4fv(
+        "mvp", 1, GL_FALSE, window_projection.data());
+
+    text_renderer->text_prog.uniform4fv(
+        "brightness_contrast", 2, Buffer::no_ac_params);
+
+    gl_canvas_->glDrawArrays(
+        GL_TRIANGLES,
+        0,
+        static_cast<GLsizei>(glyph_vertices_.size() / glyph_vertex_size));
+
+    gl_canvas_->glDisableVertexAttribArray(1);
+}
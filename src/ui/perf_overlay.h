@@ -0,0 +1,127 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PERF_OVERLAY_H_
+#define PERF_OVERLAY_H_
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "ui/gl_canvas.h"
+
+
+/*
+ * Performance figures of the window, drawn over the buffer when enabled: the
+ * cost of the frames, the draw calls of the buffer and of its value labels,
+ * the last buffer transfer, the breakdown of the last buffer update and the
+ * memory held by the buffers, so that slow plots can be diagnosed without a
+ * profiler.
+ */
+class PerfOverlay
+{
+  public:
+    // Steps of a buffer update, from its reception to its list icon
+    enum class UpdateStep {
+        Decompress = 0,
+        Convert    = 1,
+        Range      = 2,
+        Update     = 3,
+        Upload     = 4,
+        Thumbnail  = 5
+    };
+
+    static constexpr int num_update_steps = 6;
+
+    // Measures the step of an update until it goes out of scope
+    class StepTimer
+    {
+      public:
+        StepTimer(PerfOverlay* overlay, UpdateStep step)
+            : overlay_(overlay)
+            , step_(step)
+            , start_(std::chrono::steady_clock::now())
+        {
+        }
+
+        StepTimer(const StepTimer&) = delete;
+        StepTimer& operator=(const StepTimer&) = delete;
+
+        ~StepTimer()
+        {
+            const std::chrono::duration<double, std::milli> duration =
+                std::chrono::steady_clock::now() - start_;
+            overlay_->set_update_step(step_, duration.count());
+        }
+
+      private:
+        PerfOverlay* overlay_;
+        UpdateStep step_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    explicit PerfOverlay(GLCanvas* gl_canvas);
+
+    bool is_enabled() const;
+
+    void set_enabled(bool enabled);
+
+    // Count the draw calls of the frame drawn in between both calls, and
+    // draw the overlay over it
+    void begin_frame();
+    void end_frame();
+
+    void count_draw_call();
+
+    void set_transfer(std::size_t bytes, double duration_ms);
+
+    void set_update_step(UpdateStep step, double duration_ms);
+
+    void set_memory(std::size_t texture_bytes, std::size_t held_bytes);
+
+  private:
+    void draw();
+
+    GLCanvas* gl_canvas_;
+
+    bool enabled_;
+    bool in_frame_;
+
+    int frame_draw_calls_;
+    int draw_calls_;
+
+    std::size_t transfer_bytes_;
+    double transfer_ms_;
+
+    double update_step_ms_[num_update_steps];
+
+    std::size_t texture_bytes_;
+    std::size_t held_bytes_;
+
+    // Vertices of the glyphs of the overlay, reused across frames
+    std::vector<GLfloat> glyph_vertices_;
+};
+
+#endif // PERF_OVERLAY_H_
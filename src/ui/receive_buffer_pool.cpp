@@ -0,0 +1,131 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "receive_buffer_pool.h"
+
+using namespace std;
+
+
+const size_t ReceiveBufferPool::min_pooled_length;
+const int ReceiveBufferPool::size_class_denominator;
+
+
+ReceiveBufferPool::ReceiveBufferPool(size_t capacity_bytes)
+    : capacity_bytes_(capacity_bytes)
+    , size_bytes_(0)
+{
+}
+
+
+vector<uint8_t> ReceiveBufferPool::take(const string& variable_name,
+                                        size_t length)
+{
+    // The previous contents of the same buffer are preferred, since buffers
+    // usually keep their size from one version to the next
+    auto best = buffers_.end();
+    for (auto pooled = buffers_.begin(); pooled != buffers_.end(); ++pooled) {
+        const size_t capacity = pooled->contents.capacity();
+        if (capacity < length ||
+            capacity - capacity / size_class_denominator > length) {
+            continue;
+        }
+
+        if (pooled->variable_name == variable_name) {
+            best = pooled;
+            break;
+        }
+
+        if (best == buffers_.end() ||
+            capacity < best->contents.capacity()) {
+            best = pooled;
+        }
+    }
+
+    vector<uint8_t> contents;
+    if (best != buffers_.end()) {
+        size_bytes_ -= best->contents.capacity();
+        contents.swap(best->contents);
+        buffers_.erase(best);
+    }
+
+    // Only the bytes beyond the previous size of the allocation are zeroed
+    contents.resize(length);
+
+    return contents;
+}
+
+
+void ReceiveBufferPool::give(const string& variable_name,
+                             vector<uint8_t>&& contents)
+{
+    if (contents.capacity() < min_pooled_length ||
+        contents.capacity() > capacity_bytes_) {
+        vector<uint8_t>().swap(contents);
+        return;
+    }
+
+    // A buffer only keeps its latest allocation
+    for (auto pooled = buffers_.begin(); pooled != buffers_.end(); ++pooled) {
+        if (pooled->variable_name == variable_name) {
+            size_bytes_ -= pooled->contents.capacity();
+            buffers_.erase(pooled);
+            break;
+        }
+    }
+
+    size_bytes_ += contents.capacity();
+    buffers_.push_front(PooledBuffer{variable_name, std::move(contents)});
+
+    evict();
+}
+
+
+void ReceiveBufferPool::set_capacity(size_t capacity_bytes)
+{
+    capacity_bytes_ = capacity_bytes;
+    evict();
+}
+
+
+size_t ReceiveBufferPool::capacity() const
+{
+    return capacity_bytes_;
+}
+
+
+void ReceiveBufferPool::clear()
+{
+    buffers_.clear();
+    size_bytes_ = 0;
+}
+
+
+void ReceiveBufferPool::evict()
+{
+    while (size_bytes_ > capacity_bytes_ && !buffers_.empty()) {
+        size_bytes_ -= buffers_.back().contents.capacity();
+        buffers_.pop_back();
+    }
+}
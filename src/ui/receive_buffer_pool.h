@@ -0,0 +1,90 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef RECEIVE_BUFFER_POOL_H_
+#define RECEIVE_BUFFER_POOL_H_
+
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint8_t
+
+#include <list>
+#include <string>
+#include <vector>
+
+
+/*
+ * Recycles the contents of the buffers replaced by their next version, to
+ * receive the versions that follow. Receiving a buffer of the same size again
+ * then neither allocates its memory nor zero-fills it. Allocations only go
+ * back to the buffer they came from, or else to one of about the same size,
+ * and the oldest ones are freed once the pool grows beyond its capacity.
+ */
+class ReceiveBufferPool
+{
+  public:
+    explicit ReceiveBufferPool(std::size_t capacity_bytes = 512 << 20);
+
+    // Buffers smaller than this are not worth recycling
+    static const std::size_t min_pooled_length = 1 << 20;
+
+    // A pooled allocation is reused for lengths from its capacity down to
+    // this fraction of it
+    static const int size_class_denominator = 4;
+
+    /**
+     * Get storage for length bytes of the buffer variable_name. Its contents
+     * are left over from the previous buffer it held.
+     */
+    std::vector<std::uint8_t> take(const std::string& variable_name,
+                                   std::size_t length);
+
+    // Recycle the previous contents of the buffer variable_name
+    void give(const std::string& variable_name,
+              std::vector<std::uint8_t>&& contents);
+
+    void set_capacity(std::size_t capacity_bytes);
+
+    std::size_t capacity() const;
+
+    void clear();
+
+  private:
+    struct PooledBuffer
+    {
+        std::string variable_name;
+        std::vector<std::uint8_t> contents;
+    };
+
+    void evict();
+
+    // Most recently given buffers first
+    std::list<PooledBuffer> buffers_;
+
+    std::size_t capacity_bytes_;
+    std::size_t size_bytes_;
+};
+
+
+#endif // RECEIVE_BUFFER_POOL_H_
@@ -0,0 +1,192 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "session_snapshot.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+using namespace std;
+
+
+namespace
+{
+
+const quint32 snapshot_magic   = 0x4f494453; // "OIDS"
+const quint32 snapshot_version = 1;
+
+
+void write_string(QDataStream& stream, const string& value)
+{
+    stream << QByteArray(value.data(), static_cast<int>(value.size()));
+}
+
+
+string read_string(QDataStream& stream)
+{
+    QByteArray value;
+    stream >> value;
+    return value.toStdString();
+}
+
+
+size_t contents_size(const SessionSnapshot::Entry& entry)
+{
+    return static_cast<size_t>(entry.contents_width) *
+           static_cast<size_t>(entry.contents_height) *
+           held_pixel_size(entry.type, entry.channels);
+}
+
+} // namespace
+
+
+QString SessionSnapshot::file_path()
+{
+    QString directory =
+        QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (directory.isEmpty()) {
+        directory = QDir::tempPath();
+    }
+
+    return QDir(directory).filePath("OpenImageDebugger/session_snapshot.bin");
+}
+
+
+bool SessionSnapshot::save(const vector<Entry>& entries)
+{
+    const QString path = file_path();
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+
+    // Windows closing at the same time each replace the whole file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << snapshot_magic << snapshot_version
+           << static_cast<quint32>(entries.size());
+
+    for (const Entry& entry : entries) {
+        write_string(stream, entry.name);
+        write_string(stream, entry.pixel_layout);
+        stream << entry.transpose << static_cast<qint32>(entry.width)
+               << static_cast<qint32>(entry.height)
+               << static_cast<qint32>(entry.channels)
+               << static_cast<qint32>(entry.type)
+               << static_cast<qint32>(entry.contents_width)
+               << static_cast<qint32>(entry.contents_height)
+               << static_cast<quint64>(entry.contents.size());
+        stream.writeRawData(
+            reinterpret_cast<const char*>(entry.contents.data()),
+            static_cast<int>(entry.contents.size()));
+    }
+
+    return stream.status() == QDataStream::Ok && file.commit();
+}
+
+
+bool SessionSnapshot::load(vector<Entry>& entries)
+{
+    QFile file(file_path());
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) {
+        return false;
+    }
+
+    const qint64 file_size = file.size();
+    const uchar* mapped    = file.map(0, file_size);
+    if (mapped == nullptr) {
+        return false;
+    }
+
+    // The stream reads the mapped file in place
+    const QByteArray data = QByteArray::fromRawData(
+        reinterpret_cast<const char*>(mapped), static_cast<int>(file_size));
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic;
+    quint32 version;
+    quint32 entry_count;
+    stream >> magic >> version >> entry_count;
+    if (stream.status() != QDataStream::Ok || magic != snapshot_magic ||
+        version != snapshot_version) {
+        return false;
+    }
+
+    entries.clear();
+    for (quint32 i = 0; i < entry_count; ++i) {
+        Entry entry;
+        entry.name         = read_string(stream);
+        entry.pixel_layout = read_string(stream);
+
+        qint32 width;
+        qint32 height;
+        qint32 channels;
+        qint32 type;
+        qint32 contents_width;
+        qint32 contents_height;
+        quint64 length;
+        stream >> entry.transpose >> width >> height >> channels >> type >>
+            contents_width >> contents_height >> length;
+
+        entry.width           = width;
+        entry.height          = height;
+        entry.channels        = channels;
+        entry.type            = static_cast<BufferType>(type);
+        entry.contents_width  = contents_width;
+        entry.contents_height = contents_height;
+
+        // The rest of a truncated or corrupted file is dropped
+        if (stream.status() != QDataStream::Ok || width <= 0 || height <= 0 ||
+            channels <= 0 || channels > 4 || type < 0 ||
+            type > static_cast<qint32>(BufferType::Int64) ||
+            contents_width <= 0 ||
+            contents_height <= 0 || length != contents_size(entry) ||
+            length > static_cast<quint64>(file_size)) {
+            break;
+        }
+
+        entry.contents.resize(length);
+        if (stream.readRawData(reinterpret_cast<char*>(entry.contents.data()),
+                               static_cast<int>(length)) !=
+            static_cast<int>(length)) {
+            break;
+        }
+
+        entries.push_back(std::move(entry));
+    }
+
+    return true;
+}
@@ -0,0 +1,60 @@
+
+#ifndef SESSION_SNAPSHOT_H_
+#define SESSION_SNAPSHOT_H_
+
+#include <cstdint> // for std::uint8_t
+
+#include <string>
+#include <vector>
+
+#include <QString>
+
+#include "ipc/raw_data_decode.h"
+
+
+/*
+ * Downsampled copies of the buffers held when the window last closed, kept
+ * in a cache file so that the next window shows them as soon as it starts,
+ * before the debugger stops again. The file is memory mapped while it is
+ * read.
+ */
+class SessionSnapshot
+{
+  public:
+    struct Entry
+    {
+        std::string name;
+        std::string pixel_layout;
+        bool transpose;
+        int width;
+        int height;
+        int channels;
+        BufferType type;
+
+        // Downsampled contents, without row padding, held as they were by
+        // the window (see held_buffer_type)
+        int contents_width;
+        int contents_height;
+        std::vector<std::uint8_t> contents;
+    };
+
+    // Cache file, shared by all windows of the user
+    static QString file_path();
+
+    /**
+     * Replace the cache file with entries.
+     *
+     * @return false if it could not be written
+     */
+    static bool save(const std::vector<Entry>& entries);
+
+    /**
+     * Read the entries of the cache file.
+     *
+     * @return false if there is none, or it is invalid
+     */
+    static bool load(std::vector<Entry>& entries);
+};
+
+
+#endif // SESSION_SNAPSHOT_H_
@@ -25,11 +25,26 @@
 
 #include "symbol_completer.h"
 
+#include <QAbstractItemView>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Completions shown in the popup
+const int max_completions = 200;
+
+} // namespace
+
 
 SymbolCompleter::SymbolCompleter(QObject* parent)
     : QCompleter(parent)
-    , list_()
     , model_()
+    , index_(make_shared<const SymbolIndex>())
+    , cached_subsequences_(false)
 {
     setModel(&model_);
 }
@@ -37,8 +52,36 @@ SymbolCompleter::SymbolCompleter(QObject* parent)
 
 void SymbolCompleter::update(const QString& word)
 {
-    QStringList filtered = list_.filter(word, caseSensitivity());
-    model_.setStringList(filtered);
+    take_pending_index();
+
+    const QString lower_word = word.toLower();
+
+    // The matches of a word are also matches of its prefixes
+    const bool extends_cached_word =
+        cached_index_ == index_ && lower_word.startsWith(cached_word_);
+    const vector<int>* candidates =
+        extends_cached_word ? &cached_matches_ : nullptr;
+
+    vector<int> matches;
+    index_->find_substrings(lower_word, candidates, matches);
+
+    // Subsequences are only looked for when the substrings are too few
+    bool has_subsequences = false;
+    if (static_cast<int>(matches.size()) < max_completions) {
+        if (extends_cached_word && !cached_subsequences_) {
+            candidates = nullptr;
+        }
+        index_->find_subsequences(lower_word, candidates, matches);
+        has_subsequences = true;
+    }
+
+    model_.setStringList(index_->rank(lower_word, matches, max_completions));
+
+    cached_index_        = index_;
+    cached_word_         = lower_word;
+    cached_subsequences_ = has_subsequences;
+    cached_matches_.swap(matches);
+
     word_ = word;
     complete();
 }
@@ -46,7 +89,25 @@ void SymbolCompleter::update(const QString& word)
 
 void SymbolCompleter::update_symbol_list(const QStringList& symbols)
 {
-    list_ = symbols;
+    update_index_async(
+        [symbols](SymbolIndex& index) { index.update(symbols); });
+}
+
+
+void SymbolCompleter::apply_symbol_changes(const QStringList& added,
+                                           const QStringList& removed)
+{
+    update_index_async([added, removed](SymbolIndex& index) {
+        index.apply_changes(added, removed);
+    });
+}
+
+
+void SymbolCompleter::update_index()
+{
+    if (take_pending_index() && popup()->isVisible()) {
+        update(word_);
+    }
 }
 
 
@@ -54,3 +115,35 @@ const QString& SymbolCompleter::word() const
 {
     return word_;
 }
+
+
+void SymbolCompleter::update_index_async(
+    const function<void(SymbolIndex&)>& update)
+{
+    const shared_ptr<const SymbolIndex> index = index_;
+    const shared_future<shared_ptr<const SymbolIndex>> previous_index =
+        pending_index_;
+
+    auto build_index = [index, previous_index, update]() {
+        shared_ptr<SymbolIndex> next_index = make_shared<SymbolIndex>(
+            previous_index.valid() ? *previous_index.get() : *index);
+        update(*next_index);
+        return shared_ptr<const SymbolIndex>(next_index);
+    };
+
+    pending_index_ = async(launch::async, build_index).share();
+}
+
+
+bool SymbolCompleter::take_pending_index()
+{
+    if (!pending_index_.valid() ||
+        pending_index_.wait_for(chrono::seconds(0)) != future_status::ready) {
+        return false;
+    }
+
+    index_         = pending_index_.get();
+    pending_index_ = shared_future<shared_ptr<const SymbolIndex>>();
+
+    return true;
+}
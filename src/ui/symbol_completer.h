@@ -26,11 +26,21 @@
 #ifndef SYMBOL_COMPLETER_H_
 #define SYMBOL_COMPLETER_H_
 
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
 #include <QCompleter>
 #include <QStringList>
 #include <QStringListModel>
 
+#include "ui/symbol_index.h"
+
 
+// Completer of the symbol search input. The symbols are indexed in the
+// background as they arrive, and each word is first looked up among the
+// matches of the previous one when it extends it.
 class SymbolCompleter : public QCompleter
 {
     Q_OBJECT
@@ -42,12 +52,35 @@ class SymbolCompleter : public QCompleter
 
     void update_symbol_list(const QStringList& symbols);
 
+    void apply_symbol_changes(const QStringList& added,
+                              const QStringList& removed);
+
+    // Start using the index once it is built, showing its completions if
+    // the popup is open
+    void update_index();
+
     const QString& word() const;
 
   private:
-    QStringList list_;
+    // Updates are chained, each one starting from the index of the previous
+    void update_index_async(const std::function<void(SymbolIndex&)>& update);
+
+    // Take the index built in the background, if it is ready
+    bool take_pending_index();
+
     QStringListModel model_;
     QString word_;
+
+    std::shared_ptr<const SymbolIndex> index_;
+    std::shared_future<std::shared_ptr<const SymbolIndex>> pending_index_;
+
+    // Matches of the previous word, in the index they were found in. They
+    // hold all its subsequence matches if cached_subsequences_ is set, and
+    // only its substring matches otherwise.
+    std::shared_ptr<const SymbolIndex> cached_index_;
+    QString cached_word_;
+    std::vector<int> cached_matches_;
+    bool cached_subsequences_;
 };
 
 
@@ -0,0 +1,368 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "symbol_index.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <QSet>
+
+
+using namespace std;
+
+
+namespace
+{
+
+quint64 sequence_key(const QString& text, int start, int length)
+{
+    quint64 key = static_cast<quint64>(length) << 48;
+    for (int i = 0; i < length; ++i) {
+        key |= static_cast<quint64>(text[start + i].unicode())
+               << (16 * (2 - i));
+    }
+    return key;
+}
+
+
+/**
+ * @return the number of gaps between the characters of word in text, or -1
+ * if they are not all found in order
+ */
+int count_gaps(const QString& word, const QString& text)
+{
+    int gaps     = 0;
+    int position = 0;
+    int previous = -1;
+
+    for (const QChar character : word) {
+        const int found = text.indexOf(character, position);
+        if (found < 0) {
+            return -1;
+        }
+        if (previous >= 0 && found != previous + 1) {
+            ++gaps;
+        }
+        previous = found;
+        position = found + 1;
+    }
+
+    return gaps;
+}
+
+
+// Characters after which a member or word of a symbol begins
+bool is_separator(const QChar character)
+{
+    switch (character.unicode()) {
+    case '.':
+    case '>':
+    case ':':
+    case '_':
+    case '[':
+    case '(':
+    case '*':
+    case '&':
+    case ' ':
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+
+SymbolIndex::SymbolIndex()
+    : removed_count_(0)
+{
+}
+
+
+void SymbolIndex::update(const QStringList& symbols)
+{
+    QStringList added;
+    QStringList removed;
+
+    QSet<QString> next_symbols;
+    next_symbols.reserve(symbols.size());
+    for (const QString& symbol : symbols) {
+        next_symbols.insert(symbol);
+        if (!ids_.contains(symbol)) {
+            added.append(symbol);
+        }
+    }
+
+    for (auto id = ids_.constBegin(); id != ids_.constEnd(); ++id) {
+        if (!next_symbols.contains(id.key())) {
+            removed.append(id.key());
+        }
+    }
+
+    apply_changes(added, removed);
+}
+
+
+void SymbolIndex::apply_changes(const QStringList& added,
+                                const QStringList& removed)
+{
+    // Removed symbols stay in the postings until the next compaction
+    for (const QString& symbol : removed) {
+        auto id = ids_.find(symbol);
+        if (id == ids_.end()) {
+            continue;
+        }
+        symbols_[id.value()].removed = true;
+        ids_.erase(id);
+        ++removed_count_;
+    }
+
+    for (const QString& symbol : added) {
+        add_symbol(symbol);
+    }
+
+    if (removed_count_ * 2 > static_cast<int>(symbols_.size())) {
+        compact();
+    }
+}
+
+
+void SymbolIndex::find_substrings(const QString& word,
+                                  const vector<int>* candidates,
+                                  vector<int>& matches) const
+{
+    matches.clear();
+
+    if (candidates != nullptr) {
+        filter_candidates(*candidates, word, false, matches);
+        return;
+    }
+
+    if (word.isEmpty()) {
+        for (int id = 0; id < static_cast<int>(symbols_.size()); ++id) {
+            if (!symbols_[id].removed) {
+                matches.push_back(id);
+            }
+        }
+        return;
+    }
+
+    // The symbols holding all 3 character sequences of the word are only
+    // candidates, as those may be found in different places
+    vector<int> ids;
+    if (intersect_postings(word, min(word.size(), 3), ids)) {
+        filter_candidates(ids, word, false, matches);
+    }
+}
+
+
+void SymbolIndex::find_subsequences(const QString& word,
+                                    const vector<int>* candidates,
+                                    vector<int>& matches) const
+{
+    matches.clear();
+
+    if (candidates != nullptr) {
+        filter_candidates(*candidates, word, true, matches);
+        return;
+    }
+
+    if (word.isEmpty()) {
+        find_substrings(word, nullptr, matches);
+        return;
+    }
+
+    vector<int> ids;
+    if (intersect_postings(word, 1, ids)) {
+        filter_candidates(ids, word, true, matches);
+    }
+}
+
+
+QStringList SymbolIndex::rank(const QString& word,
+                              const vector<int>& matches,
+                              int max_count) const
+{
+    struct RankedMatch {
+        int score;
+        int id;
+    };
+
+    vector<RankedMatch> ranked_matches;
+    ranked_matches.reserve(matches.size());
+
+    for (const int id : matches) {
+        const QString& lower = symbols_[id].lower;
+        const int position   = lower.indexOf(word);
+
+        int score;
+        if (position == 0) {
+            score = 0;
+        } else if (position > 0) {
+            score = is_separator(lower[position - 1]) ? 1 : 2;
+        } else {
+            score = 3 + max(count_gaps(word, lower), 0);
+        }
+
+        ranked_matches.push_back(RankedMatch{score, id});
+    }
+
+    const auto is_better = [this](const RankedMatch& a,
+                                  const RankedMatch& b) {
+        if (a.score != b.score) {
+            return a.score < b.score;
+        }
+
+        const QString& a_lower = symbols_[a.id].lower;
+        const QString& b_lower = symbols_[b.id].lower;
+        if (a_lower.size() != b_lower.size()) {
+            return a_lower.size() < b_lower.size();
+        }
+
+        return a_lower < b_lower;
+    };
+
+    const int count =
+        min(max_count, static_cast<int>(ranked_matches.size()));
+    partial_sort(ranked_matches.begin(),
+                 ranked_matches.begin() + count,
+                 ranked_matches.end(),
+                 is_better);
+
+    QStringList ranked_names;
+    ranked_names.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        ranked_names.append(symbols_[ranked_matches[i].id].name);
+    }
+
+    return ranked_names;
+}
+
+
+void SymbolIndex::add_symbol(const QString& name)
+{
+    if (ids_.contains(name)) {
+        return;
+    }
+
+    const int id = static_cast<int>(symbols_.size());
+    symbols_.push_back(Symbol{name, name.toLower(), false});
+    ids_.insert(name, id);
+
+    const QString& lower = symbols_.back().lower;
+
+    vector<quint64> keys;
+    for (int length = 1; length <= 3; ++length) {
+        for (int start = 0; start + length <= lower.size(); ++start) {
+            keys.push_back(sequence_key(lower, start, length));
+        }
+    }
+
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+    // Ids only grow, which keeps the postings sorted
+    for (const quint64 key : keys) {
+        postings_[key].push_back(id);
+    }
+}
+
+
+void SymbolIndex::compact()
+{
+    vector<Symbol> symbols;
+    symbols.swap(symbols_);
+
+    ids_.clear();
+    postings_.clear();
+    removed_count_ = 0;
+
+    for (const Symbol& symbol : symbols) {
+        if (!symbol.removed) {
+            add_symbol(symbol.name);
+        }
+    }
+}
+
+
+bool SymbolIndex::intersect_postings(const QString& word,
+                                     int length,
+                                     vector<int>& ids) const
+{
+    vector<const vector<int>*> postings;
+    for (int start = 0; start + length <= word.size(); ++start) {
+        auto posting = postings_.constFind(sequence_key(word, start, length));
+        if (posting == postings_.constEnd()) {
+            return false;
+        }
+        postings.push_back(&posting.value());
+    }
+
+    if (postings.empty()) {
+        return false;
+    }
+
+    // Starting from the shortest postings keeps the intersections small
+    sort(postings.begin(),
+         postings.end(),
+         [](const vector<int>* a, const vector<int>* b) {
+             return a->size() < b->size();
+         });
+
+    ids = *postings[0];
+    for (size_t i = 1; i < postings.size() && !ids.empty(); ++i) {
+        vector<int> intersection;
+        set_intersection(ids.begin(),
+                         ids.end(),
+                         postings[i]->begin(),
+                         postings[i]->end(),
+                         back_inserter(intersection));
+        ids.swap(intersection);
+    }
+
+    return true;
+}
+
+
+void SymbolIndex::filter_candidates(const vector<int>& candidates,
+                                    const QString& word,
+                                    bool subsequence,
+                                    vector<int>& matches) const
+{
+    for (const int id : candidates) {
+        const Symbol& symbol = symbols_[id];
+        if (symbol.removed) {
+            continue;
+        }
+
+        const bool is_match = subsequence
+                                  ? count_gaps(word, symbol.lower) >= 0
+                                  : symbol.lower.contains(word);
+        if (is_match) {
+            matches.push_back(id);
+        }
+    }
+}
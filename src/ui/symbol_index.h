@@ -0,0 +1,113 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SYMBOL_INDEX_H_
+#define SYMBOL_INDEX_H_
+
+#include <vector>
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+
+// Index of the symbols offered by the completer. Every 1, 2 and 3 character
+// sequence of the lower case symbols is mapped to the ids of the symbols
+// containing it, in increasing order. Symbols are added and removed in place,
+// so that a copy of the index can be updated in the background while the
+// original one answers the queries.
+class SymbolIndex
+{
+  public:
+    SymbolIndex();
+
+    // Index the given symbols, only processing the ones that changed
+    void update(const QStringList& symbols);
+
+    void apply_changes(const QStringList& added, const QStringList& removed);
+
+    /**
+     * Find the symbols containing the lower case word.
+     *
+     * @param candidates if not null, only these symbol ids are considered
+     * @param matches receives the ids of the matching symbols
+     */
+    void find_substrings(const QString& word,
+                         const std::vector<int>* candidates,
+                         std::vector<int>& matches) const;
+
+    /**
+     * Find the symbols containing the characters of the lower case word in
+     * order, though not necessarily next to each other. These include the
+     * symbols found by find_substrings.
+     */
+    void find_subsequences(const QString& word,
+                           const std::vector<int>* candidates,
+                           std::vector<int>& matches) const;
+
+    /**
+     * Rank the matches of the lower case word: prefix matches first, then
+     * matches at the start of a member or word, other substrings and finally
+     * subsequences with the fewest gaps.
+     *
+     * @return the names of the best max_count matches
+     */
+    QStringList rank(const QString& word,
+                     const std::vector<int>& matches,
+                     int max_count) const;
+
+  private:
+    struct Symbol {
+        QString name;
+        QString lower;
+        bool removed;
+    };
+
+    void add_symbol(const QString& name);
+
+    // Index the remaining symbols again once most were removed
+    void compact();
+
+    /**
+     * Intersect the postings of the given sequences of the lower case word.
+     *
+     * @return false if one of them is not found in any symbol
+     */
+    bool intersect_postings(const QString& word,
+                            int length,
+                            std::vector<int>& ids) const;
+
+    void filter_candidates(const std::vector<int>& candidates,
+                           const QString& word,
+                           bool subsequence,
+                           std::vector<int>& matches) const;
+
+    std::vector<Symbol> symbols_;
+    QHash<QString, int> ids_;
+    QHash<quint64, std::vector<int>> postings_;
+    int removed_count_;
+};
+
+#endif // SYMBOL_INDEX_H_
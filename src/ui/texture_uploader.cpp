@@ -0,0 +1,324 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "texture_uploader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QOpenGLContext>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Uploads larger than this are split in bands of rows, so that each frame
+// only copies a bounded amount of data
+const size_t max_upload_bytes = 8 << 20;
+
+
+template <typename Key>
+void decrement_pending(map<Key, int>& pending, const Key& key)
+{
+    auto count = pending.find(key);
+    if (count != pending.end() && --count->second == 0) {
+        pending.erase(count);
+    }
+}
+
+} // namespace
+
+
+TextureUploader::TextureUploader(GLCanvas* gl_canvas)
+    : gl_canvas_(gl_canvas)
+    , use_pbos_(false)
+    , pixel_buffers_{{0, nullptr}, {0, nullptr}}
+    , next_pixel_buffer_(0)
+{
+}
+
+
+TextureUploader::~TextureUploader()
+{
+    if (!use_pbos_) {
+        return;
+    }
+
+    for (auto& pixel_buffer : pixel_buffers_) {
+        if (pixel_buffer.fence != nullptr) {
+            gl_canvas_->glDeleteSync(pixel_buffer.fence);
+        }
+        gl_canvas_->glDeleteBuffers(1, &pixel_buffer.pbo);
+    }
+}
+
+
+bool TextureUploader::initialize()
+{
+    // Fence syncs are core since OpenGL 3.2 and OpenGL ES 3.0
+    const QOpenGLContext* context = QOpenGLContext::currentContext();
+    const QSurfaceFormat format   = context->format();
+    const int required_minor      = context->isOpenGLES() ? 0 : 2;
+    use_pbos_ = format.majorVersion() > 3 ||
+                (format.majorVersion() == 3 &&
+                 format.minorVersion() >= required_minor);
+
+    if (use_pbos_) {
+        for (auto& pixel_buffer : pixel_buffers_) {
+            gl_canvas_->glGenBuffers(1, &pixel_buffer.pbo);
+        }
+    }
+
+    return true;
+}
+
+
+void TextureUploader::enqueue(const Upload& upload)
+{
+    if (upload.width <= 0 || upload.height <= 0) {
+        return;
+    }
+
+    const size_t row_size =
+        static_cast<size_t>(upload.width) * upload.pixel_size;
+    const int band_height = static_cast<int>(
+        max(max_upload_bytes / row_size, static_cast<size_t>(1)));
+
+    for (int y = 0; y < upload.height; y += band_height) {
+        Upload band = upload;
+        band.tex_y += y;
+        band.src_y += y;
+        band.height = min(band_height, upload.height - y);
+
+        uploads_.push_back(band);
+        add_pending(band);
+    }
+}
+
+
+void TextureUploader::cancel(const void* owner)
+{
+    if (pending_per_owner_.find(owner) == pending_per_owner_.end()) {
+        return;
+    }
+
+    auto cancelled = remove_if(
+        uploads_.begin(), uploads_.end(), [owner](const Upload& upload) {
+            return upload.owner == owner;
+        });
+    for (auto upload = cancelled; upload != uploads_.end(); ++upload) {
+        remove_pending(*upload);
+    }
+
+    uploads_.erase(cancelled, uploads_.end());
+}
+
+
+bool TextureUploader::is_pending(const void* owner) const
+{
+    return pending_per_owner_.find(owner) != pending_per_owner_.end();
+}
+
+
+bool TextureUploader::is_texture_pending(GLuint texture, int layer) const
+{
+    return pending_per_texture_.find(make_pair(texture, layer)) !=
+           pending_per_texture_.end();
+}
+
+
+bool TextureUploader::empty() const
+{
+    return uploads_.empty();
+}
+
+
+bool TextureUploader::upload_pending(size_t budget_bytes)
+{
+    size_t uploaded_bytes = 0;
+
+    while (!uploads_.empty() && uploaded_bytes < budget_bytes) {
+        const Upload& upload = uploads_.front();
+
+        if (use_pbos_) {
+            if (!upload_through_pbo(upload)) {
+                // The GPU is still reading both pixel buffers
+                break;
+            }
+        } else {
+            upload_directly(upload);
+        }
+
+        uploaded_bytes += static_cast<size_t>(upload.width) *
+                          static_cast<size_t>(upload.height) *
+                          upload.pixel_size;
+        remove_front();
+    }
+
+    return !uploads_.empty();
+}
+
+
+bool TextureUploader::upload_through_pbo(const Upload& upload)
+{
+    PixelBuffer& pixel_buffer = pixel_buffers_[next_pixel_buffer_];
+
+    if (pixel_buffer.fence != nullptr) {
+        const GLenum status =
+            gl_canvas_->glClientWaitSync(pixel_buffer.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+
+        gl_canvas_->glDeleteSync(pixel_buffer.fence);
+        pixel_buffer.fence = nullptr;
+    }
+
+    const size_t row_size =
+        static_cast<size_t>(upload.width) * upload.pixel_size;
+    const size_t upload_size = row_size * static_cast<size_t>(upload.height);
+
+    // Orphan the previous storage, so that mapping it doesn't wait for the
+    // GPU either
+    gl_canvas_->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer.pbo);
+    gl_canvas_->glBufferData(GL_PIXEL_UNPACK_BUFFER,
+                             static_cast<GLsizeiptr>(upload_size),
+                             nullptr,
+                             GL_STREAM_DRAW);
+
+    uint8_t* mapped = static_cast<uint8_t*>(gl_canvas_->glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER,
+        0,
+        static_cast<GLsizeiptr>(upload_size),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+
+    if (mapped == nullptr) {
+        gl_canvas_->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        upload_directly(upload);
+        return true;
+    }
+
+    // Pack the rows, so that the pixel buffer holds nothing but the upload
+    const size_t src_row_size =
+        static_cast<size_t>(upload.src_step) * upload.pixel_size;
+    const uint8_t* src =
+        upload.src + static_cast<size_t>(upload.src_y) * src_row_size +
+        static_cast<size_t>(upload.src_x) * upload.pixel_size;
+    for (int y = 0; y < upload.height; ++y) {
+        memcpy(mapped + static_cast<size_t>(y) * row_size,
+               src + static_cast<size_t>(y) * src_row_size,
+               row_size);
+    }
+
+    gl_canvas_->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    gl_canvas_->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    copy_to_texture(upload, nullptr);
+
+    pixel_buffer.fence =
+        gl_canvas_->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl_canvas_->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    next_pixel_buffer_ = 1 - next_pixel_buffer_;
+
+    return true;
+}
+
+
+void TextureUploader::upload_directly(const Upload& upload)
+{
+    gl_canvas_->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    gl_canvas_->glPixelStorei(GL_UNPACK_ROW_LENGTH, upload.src_step);
+    gl_canvas_->glPixelStorei(GL_UNPACK_SKIP_ROWS, upload.src_y);
+    gl_canvas_->glPixelStorei(GL_UNPACK_SKIP_PIXELS, upload.src_x);
+
+    copy_to_texture(upload, upload.src);
+
+    gl_canvas_->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    gl_canvas_->glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    gl_canvas_->glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+}
+
+
+void TextureUploader::copy_to_texture(const Upload& upload, const void* pixels)
+{
+    gl_canvas_->glBindTexture(upload.target, upload.texture);
+
+    if (upload.target == GL_TEXTURE_2D_ARRAY) {
+        gl_canvas_->glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                                    upload.level,
+                                    upload.tex_x,
+                                    upload.tex_y,
+                                    upload.tex_layer,
+                                    upload.width,
+                                    upload.height,
+                                    1,
+                                    upload.format,
+                                    upload.type,
+                                    pixels);
+    } else {
+        gl_canvas_->glTexSubImage2D(upload.target,
+                                    upload.level,
+                                    upload.tex_x,
+                                    upload.tex_y,
+                                    upload.width,
+                                    upload.height,
+                                    upload.format,
+                                    upload.type,
+                                    pixels);
+    }
+}
+
+
+void TextureUploader::remove_front()
+{
+    remove_pending(uploads_.front());
+    uploads_.pop_front();
+}
+
+
+void TextureUploader::add_pending(const Upload& upload)
+{
+    ++pending_per_owner_[upload.owner];
+
+    // Textures can be drawn while their mipmaps are uploaded
+    if (upload.level == 0) {
+        ++pending_per_texture_[make_pair(upload.texture, upload.tex_layer)];
+    }
+}
+
+
+void TextureUploader::remove_pending(const Upload& upload)
+{
+    decrement_pending(pending_per_owner_, upload.owner);
+
+    if (upload.level == 0) {
+        decrement_pending(pending_per_texture_,
+                          make_pair(upload.texture, upload.tex_layer));
+    }
+}
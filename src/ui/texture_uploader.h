@@ -0,0 +1,129 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef TEXTURE_UPLOADER_H_
+#define TEXTURE_UPLOADER_H_
+
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint8_t
+
+#include <deque>
+#include <map>
+#include <utility>
+
+#include "ui/gl_canvas.h"
+
+
+/*
+ * Uploads texture contents through a pair of pixel buffer objects, spread
+ * over several frames, so that large buffers don't stall the UI thread on
+ * the driver copy. Each pixel buffer is only reused once the GPU signalled
+ * that it is done with its previous upload. Without fence support, uploads
+ * are made straight from client memory instead (still spread over frames).
+ */
+class TextureUploader
+{
+  public:
+    // Copy width x height pixels, from (src_x, src_y) of a buffer with the
+    // given step (in pixels), to (tex_x, tex_y) of the given level of
+    // texture. For array textures (target GL_TEXTURE_2D_ARRAY), the pixels
+    // are copied into its tex_layer. The source buffer is read when the
+    // upload is made, so it must outlive it.
+    struct Upload
+    {
+        const void* owner;
+        GLuint texture;
+        GLenum target;
+        int level;
+        int tex_x;
+        int tex_y;
+        int tex_layer;
+        const std::uint8_t* src;
+        int src_x;
+        int src_y;
+        int src_step;
+        int width;
+        int height;
+        std::size_t pixel_size;
+        GLenum format;
+        GLenum type;
+    };
+
+    explicit TextureUploader(GLCanvas* gl_canvas);
+    ~TextureUploader();
+
+    bool initialize();
+
+    // Queue an upload, which is split in bands of rows if it is large
+    void enqueue(const Upload& upload);
+
+    // Drop the queued uploads of owner, e.g. before deleting its textures
+    void cancel(const void* owner);
+
+    bool is_pending(const void* owner) const;
+
+    // Whether the contents of level 0 of the texture (layer) are queued
+    bool is_texture_pending(GLuint texture, int layer = 0) const;
+
+    bool empty() const;
+
+    /**
+     * Make the queued uploads, until about budget_bytes were uploaded.
+     *
+     * @return true if some uploads are still queued
+     */
+    bool upload_pending(std::size_t budget_bytes);
+
+    // Make an upload right away, straight from client memory
+    void upload_directly(const Upload& upload);
+
+  private:
+    struct PixelBuffer
+    {
+        GLuint pbo;
+        GLsync fence;
+    };
+
+    bool upload_through_pbo(const Upload& upload);
+
+    void copy_to_texture(const Upload& upload, const void* pixels);
+
+    void add_pending(const Upload& upload);
+    void remove_pending(const Upload& upload);
+
+    void remove_front();
+
+    GLCanvas* gl_canvas_;
+
+    bool use_pbos_;
+    PixelBuffer pixel_buffers_[2];
+    int next_pixel_buffer_;
+
+    std::deque<Upload> uploads_;
+    std::map<const void*, int> pending_per_owner_;
+    std::map<std::pair<GLuint, int>, int> pending_per_texture_;
+};
+
+#endif // TEXTURE_UPLOADER_H_
@@ -0,0 +1,221 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "block_ranges.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+#include "visualization/channel_range.h"
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Below this size, spawning threads costs more than the pass itself
+const size_t parallel_blocks_threshold = 4 << 20;
+
+const unsigned int max_block_threads = 8;
+
+} // namespace
+
+
+BlockRanges::BlockRanges()
+    : width_(0)
+    , height_(0)
+    , step_(0)
+    , channels_(0)
+    , type_(BufferType::UnsignedByte)
+    , blocks_x_(0)
+    , blocks_y_(0)
+    , is_valid_(false)
+{
+}
+
+
+void BlockRanges::compute(const uint8_t* buffer,
+                          int width,
+                          int height,
+                          int step,
+                          int channels,
+                          BufferType type)
+{
+    width_    = max(width, 0);
+    height_   = max(height, 0);
+    step_     = step;
+    channels_ = channels;
+    type_     = type;
+    blocks_x_ = (width_ + block_size - 1) / block_size;
+    blocks_y_ = (height_ + block_size - 1) / block_size;
+
+    ranges_.assign(static_cast<size_t>(blocks_x_) * blocks_y_ * 8, 0.f);
+
+    const size_t total_length = static_cast<size_t>(width_) *
+                                static_cast<size_t>(height_) *
+                                held_pixel_size(type_, channels_);
+
+    unsigned int num_threads = 1;
+    if (total_length >= parallel_blocks_threshold) {
+        num_threads =
+            min(max(thread::hardware_concurrency(), 1u), max_block_threads);
+        num_threads = min(num_threads, static_cast<unsigned int>(blocks_y_));
+    }
+
+    const int rows_per_thread =
+        (blocks_y_ + static_cast<int>(num_threads) - 1) /
+        static_cast<int>(num_threads);
+
+    // Each thread finds the ranges of its rows of blocks
+    vector<thread> workers;
+    for (int first_row = rows_per_thread; first_row < blocks_y_;
+         first_row += rows_per_thread) {
+        const int last_row = min(first_row + rows_per_thread, blocks_y_);
+        workers.emplace_back(&BlockRanges::compute_block_rows,
+                             this,
+                             buffer,
+                             first_row,
+                             last_row);
+    }
+
+    // The first rows are reduced by the calling thread
+    compute_block_rows(buffer, 0, min(rows_per_thread, blocks_y_));
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    is_valid_ = true;
+}
+
+
+void BlockRanges::update(const uint8_t* buffer,
+                         const vector<TileRegion>& regions)
+{
+    if (!is_valid_) {
+        return;
+    }
+
+    for (const auto& region : regions) {
+        const int last_x = min(region.x + region.width, width_) - 1;
+        const int last_y = min(region.y + region.height, height_) - 1;
+
+        for (int by = region.y / block_size; by <= last_y / block_size;
+             ++by) {
+            for (int bx = region.x / block_size; bx <= last_x / block_size;
+                 ++bx) {
+                compute_block(buffer, bx, by);
+            }
+        }
+    }
+}
+
+
+void BlockRanges::clear()
+{
+    is_valid_ = false;
+    ranges_.clear();
+}
+
+
+bool BlockRanges::is_valid() const
+{
+    return is_valid_;
+}
+
+
+bool BlockRanges::get_range(int x0,
+                            int y0,
+                            int x1,
+                            int y1,
+                            float lowest[4],
+                            float upper[4]) const
+{
+    x0 = max(x0, 0);
+    y0 = max(y0, 0);
+    x1 = min(x1, width_);
+    y1 = min(y1, height_);
+
+    if (!is_valid_ || x1 <= x0 || y1 <= y0) {
+        return false;
+    }
+
+    for (int c = 0; c < 4; ++c) {
+        lowest[c] = numeric_limits<float>::max();
+        upper[c]  = numeric_limits<float>::lowest();
+    }
+
+    for (int by = y0 / block_size; by <= (y1 - 1) / block_size; ++by) {
+        for (int bx = x0 / block_size; bx <= (x1 - 1) / block_size; ++bx) {
+            const float* range =
+                &ranges_[(static_cast<size_t>(by) * blocks_x_ + bx) * 8];
+
+            for (int c = 0; c < 4; ++c) {
+                lowest[c] = min(lowest[c], range[c]);
+                upper[c]  = max(upper[c], range[4 + c]);
+            }
+        }
+    }
+
+    return true;
+}
+
+
+void BlockRanges::compute_block_rows(const uint8_t* buffer,
+                                     int first_block_row,
+                                     int last_block_row)
+{
+    for (int by = first_block_row; by < last_block_row; ++by) {
+        for (int bx = 0; bx < blocks_x_; ++bx) {
+            compute_block(buffer, bx, by);
+        }
+    }
+}
+
+
+void BlockRanges::compute_block(const uint8_t* buffer, int block_x, int block_y)
+{
+    const int x = block_x * block_size;
+    const int y = block_y * block_size;
+
+    const size_t pixel_size = held_pixel_size(type_, channels_);
+    const uint8_t* block =
+        buffer + (static_cast<size_t>(y) * step_ + x) * pixel_size;
+
+    float* range =
+        &ranges_[(static_cast<size_t>(block_y) * blocks_x_ + block_x) * 8];
+
+    compute_channel_range(block,
+                          min(block_size, width_ - x),
+                          min(block_size, height_ - y),
+                          step_,
+                          channels_,
+                          type_,
+                          range,
+                          range + 4);
+}
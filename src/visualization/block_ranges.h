@@ -0,0 +1,106 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BLOCK_RANGES_H_
+#define BLOCK_RANGES_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "ipc/raw_data_decode.h"
+#include "ipc/tile_delta.h"
+
+
+/**
+ * Lowest and upper values of each channel of every block of a buffer, whose
+ * blocks are the tiles compared between plots. The ranges of a buffer
+ * updated in parts, or of the part of it in view, are merged from those of
+ * its blocks rather than found from all of its values again.
+ */
+class BlockRanges
+{
+  public:
+    static const int block_size = delta_tile_size;
+
+    BlockRanges();
+
+    /**
+     * Find the ranges of all blocks of the width x height pixels of buffer,
+     * whose rows are step pixels apart. Doubles and 64 bit integers must be
+     * held as floats. Large buffers are split across several threads.
+     */
+    void compute(const std::uint8_t* buffer,
+                 int width,
+                 int height,
+                 int step,
+                 int channels,
+                 BufferType type);
+
+    // Find the ranges of the blocks overlapping the regions again, from the
+    // updated contents of the same buffer
+    void update(const std::uint8_t* buffer,
+                const std::vector<TileRegion>& regions);
+
+    void clear();
+
+    bool is_valid() const;
+
+    /**
+     * Merge the ranges of the blocks overlapping the pixels from (x0, y0) to
+     * (x1, y1), ends excluded. The values of the channels the buffer doesn't
+     * have are set to 0.
+     *
+     * @return false if the pixels are out of the buffer
+     */
+    bool get_range(int x0,
+                   int y0,
+                   int x1,
+                   int y1,
+                   float lowest[4],
+                   float upper[4]) const;
+
+  private:
+    void compute_block_rows(const std::uint8_t* buffer,
+                            int first_block_row,
+                            int last_block_row);
+
+    void compute_block(const std::uint8_t* buffer, int block_x, int block_y);
+
+    int width_;
+    int height_;
+    int step_;
+    int channels_;
+    BufferType type_;
+
+    int blocks_x_;
+    int blocks_y_;
+
+    bool is_valid_;
+
+    // Lowest values of the 4 channels of each block, then the upper ones
+    std::vector<float> ranges_;
+};
+
+#endif // BLOCK_RANGES_H_
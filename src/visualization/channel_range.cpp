@@ -0,0 +1,282 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "channel_range.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Below this size, spawning threads costs more than the pass itself
+const size_t parallel_range_threshold = 4 << 20;
+
+const unsigned int max_range_threads = 8;
+
+// Pixels reduced side by side, into independent accumulators that compilers
+// map to vector min/max instructions
+const int block_pixels = 8;
+
+
+// Values are compared as this type, into which halves are widened
+template <typename T>
+struct RangeValue
+{
+    using type = T;
+};
+
+
+template <>
+struct RangeValue<Half>
+{
+    using type = float;
+};
+
+
+template <typename T>
+struct ChannelRange
+{
+    array<T, 4> lowest;
+    array<T, 4> upper;
+};
+
+
+template <typename T, int Channels>
+void range_of_rows(const T* buffer,
+                   int width,
+                   int step,
+                   int first_row,
+                   int last_row,
+                   ChannelRange<typename RangeValue<T>::type>& range)
+{
+    using Value = typename RangeValue<T>::type;
+
+    const int block_length = block_pixels * Channels;
+
+    // Element j of a block belongs to channel j % Channels
+    Value block_lowest[block_length];
+    Value block_upper[block_length];
+    for (int j = 0; j < block_length; ++j) {
+        block_lowest[j] = numeric_limits<Value>::max();
+        block_upper[j]  = numeric_limits<Value>::lowest();
+    }
+
+    const int row_length = width * Channels;
+
+    for (int y = first_row; y < last_row; ++y) {
+        const T* row =
+            buffer + static_cast<size_t>(y) * static_cast<size_t>(step) *
+                         Channels;
+
+        int i = 0;
+        for (; i + block_length <= row_length; i += block_length) {
+            for (int j = 0; j < block_length; ++j) {
+                const Value value = row[i + j];
+                // Like std::min/std::max, NaNs are skipped
+                block_lowest[j] =
+                    value < block_lowest[j] ? value : block_lowest[j];
+                block_upper[j] =
+                    value > block_upper[j] ? value : block_upper[j];
+            }
+        }
+
+        for (; i < row_length; ++i) {
+            const int j       = i % Channels;
+            const Value value = row[i];
+            block_lowest[j] = value < block_lowest[j] ? value : block_lowest[j];
+            block_upper[j]  = value > block_upper[j] ? value : block_upper[j];
+        }
+    }
+
+    for (int c = 0; c < Channels; ++c) {
+        range.lowest[c] = block_lowest[c];
+        range.upper[c]  = block_upper[c];
+        for (int j = c + Channels; j < block_length; j += Channels) {
+            range.lowest[c] = min(range.lowest[c], block_lowest[j]);
+            range.upper[c]  = max(range.upper[c], block_upper[j]);
+        }
+    }
+}
+
+
+template <typename T, int Channels>
+void compute_range(const T* buffer,
+                   int width,
+                   int height,
+                   int step,
+                   float lowest[4],
+                   float upper[4])
+{
+    const size_t total_length = static_cast<size_t>(width) *
+                                static_cast<size_t>(height) * Channels *
+                                sizeof(T);
+
+    unsigned int num_threads = 1;
+    if (total_length >= parallel_range_threshold) {
+        num_threads = min(max(thread::hardware_concurrency(), 1u),
+                          max_range_threads);
+        num_threads = min(num_threads, static_cast<unsigned int>(height));
+    }
+
+    const int rows_per_thread =
+        (height + static_cast<int>(num_threads) - 1) /
+        static_cast<int>(num_threads);
+
+    using Value = typename RangeValue<T>::type;
+
+    vector<ChannelRange<Value>> ranges(num_threads);
+
+    vector<thread> workers;
+    size_t range_index = 1;
+    for (int first_row = rows_per_thread; first_row < height;
+         first_row += rows_per_thread) {
+        const int last_row = min(first_row + rows_per_thread, height);
+        workers.emplace_back(range_of_rows<T, Channels>,
+                             buffer,
+                             width,
+                             step,
+                             first_row,
+                             last_row,
+                             ref(ranges[range_index++]));
+    }
+
+    // The first rows are reduced by the calling thread
+    range_of_rows<T, Channels>(
+        buffer, width, step, 0, min(rows_per_thread, height), ranges[0]);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (int c = 0; c < Channels; ++c) {
+        Value channel_lowest = ranges[0].lowest[c];
+        Value channel_upper  = ranges[0].upper[c];
+        for (size_t i = 1; i < range_index; ++i) {
+            channel_lowest = min(channel_lowest, ranges[i].lowest[c]);
+            channel_upper  = max(channel_upper, ranges[i].upper[c]);
+        }
+
+        lowest[c] = static_cast<float>(channel_lowest);
+        upper[c]  = static_cast<float>(channel_upper);
+    }
+}
+
+
+template <typename T>
+void compute_range(const uint8_t* buffer,
+                   int width,
+                   int height,
+                   int step,
+                   int channels,
+                   float lowest[4],
+                   float upper[4])
+{
+    const T* typed_buffer = reinterpret_cast<const T*>(buffer);
+
+    switch (channels) {
+    case 1:
+        compute_range<T, 1>(typed_buffer, width, height, step, lowest, upper);
+        break;
+    case 2:
+        compute_range<T, 2>(typed_buffer, width, height, step, lowest, upper);
+        break;
+    case 3:
+        compute_range<T, 3>(typed_buffer, width, height, step, lowest, upper);
+        break;
+    case 4:
+        compute_range<T, 4>(typed_buffer, width, height, step, lowest, upper);
+        break;
+    }
+}
+
+} // namespace
+
+
+void compute_channel_range(const uint8_t* buffer,
+                           int width,
+                           int height,
+                           int step,
+                           int channels,
+                           BufferType type,
+                           float lowest[4],
+                           float upper[4])
+{
+    for (int c = 0; c < 4; ++c) {
+        lowest[c] = numeric_limits<float>::max();
+        upper[c]  = numeric_limits<float>::lowest();
+    }
+
+    if (width > 0 && height > 0) {
+        switch (type) {
+        case BufferType::UnsignedByte:
+            compute_range<uint8_t>(
+                buffer, width, height, step, channels, lowest, upper);
+            break;
+        case BufferType::UnsignedShort:
+            compute_range<uint16_t>(
+                buffer, width, height, step, channels, lowest, upper);
+            break;
+        case BufferType::Short:
+            compute_range<int16_t>(
+                buffer, width, height, step, channels, lowest, upper);
+            break;
+        case BufferType::Int32:
+            compute_range<int32_t>(
+                buffer, width, height, step, channels, lowest, upper);
+            break;
+        case BufferType::Int8:
+            compute_range<int8_t>(
+                buffer, width, height, step, channels, lowest, upper);
+            break;
+        case BufferType::UnsignedInt32:
+            compute_range<uint32_t>(
+                buffer, width, height, step, channels, lowest, upper);
+            break;
+        case BufferType::Float16:
+            compute_range<Half>(
+                buffer, width, height, step, channels, lowest, upper);
+            break;
+        case BufferType::Float32: // fall-through
+        case BufferType::Float64:
+        case BufferType::Int64:
+            compute_range<float>(
+                buffer, width, height, step, channels, lowest, upper);
+            break;
+        }
+    }
+
+    // For single channel buffers: fill with 0
+    for (int c = channels; c < 4; ++c) {
+        lowest[c] = upper[c] = 0.0f;
+    }
+}
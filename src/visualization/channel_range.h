@@ -0,0 +1,50 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef CHANNEL_RANGE_H_
+#define CHANNEL_RANGE_H_
+
+#include <cstdint>
+
+#include "ipc/raw_data_decode.h"
+
+
+/**
+ * Compute the lowest and upper values of each of the channels of the
+ * width x height pixels of buffer, whose rows are step pixels apart, in a
+ * single pass. Doubles and 64 bit integers must be held as floats. The
+ * values of the channels the buffer doesn't have are set to 0. Large buffers
+ * are split across several threads.
+ */
+void compute_channel_range(const std::uint8_t* buffer,
+                           int width,
+                           int height,
+                           int step,
+                           int channels,
+                           BufferType type,
+                           float lowest[4],
+                           float upper[4]);
+
+#endif // CHANNEL_RANGE_H_
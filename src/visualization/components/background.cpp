@@ -35,6 +35,7 @@
 Background::Background(GameObject* game_object, GLCanvas* gl_canvas)
     : Component(game_object, gl_canvas)
     , background_prog(gl_canvas)
+    , background_vbo(0)
 {
 }
 
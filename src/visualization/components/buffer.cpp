@@ -23,78 +23,235 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <limits>
 
 #include "GL/gl.h"
 
 #include "buffer.h"
 
+#include "buffer_values.h"
 #include "camera.h"
+#include "ui/frame_scheduler.h"
+#include "ui/gl_text_renderer.h"
+#include "ui/perf_overlay.h"
+#include "ui/texture_uploader.h"
+#include "visualization/block_ranges.h"
 #include "visualization/game_object.h"
+#include "visualization/histogram.h"
 #include "visualization/shaders/oid_shaders.h"
 #include "visualization/stage.h"
+#include "visualization/summed_area_table.h"
 
 using namespace std;
 
 
+namespace
+{
+
+// Floats per tile in the tile attributes: center and size, and layer
+const int tile_attribute_count = 5;
+
+// Fraction of the values left out on each side of the ranges when outliers
+// are clipped
+const float outlier_fraction = 0.005f;
+
+// Values of the updated tiles are only taken out of the histogram and added
+// back below this many pixels, which is done right away. The histogram of
+// larger updates is binned again in the background.
+const size_t max_histogram_update_pixels = 1 << 20;
+
+
+// Integer textures are normalized by the largest value of their type
+float max_intensity(BufferType type)
+{
+    if (type == BufferType::UnsignedByte) {
+        return 255.0f;
+    } else if (type == BufferType::Short) {
+        return static_cast<float>(std::numeric_limits<short>::max());
+    } else if (type == BufferType::UnsignedShort) {
+        return static_cast<float>(std::numeric_limits<unsigned short>::max());
+    } else if (type == BufferType::Int32) {
+        return static_cast<float>(std::numeric_limits<int>::max());
+    } else if (type == BufferType::Int8) {
+        return static_cast<float>(std::numeric_limits<int8_t>::max());
+    } else if (type == BufferType::UnsignedInt32) {
+        return static_cast<float>(std::numeric_limits<uint32_t>::max());
+    }
+
+    return 1.0f;
+}
+
+
+// Bytes per texel of level 0 of the texture bound to target, as allocated by
+// the driver, or 0 if the context can't be queried (OpenGL ES before 3.1)
+size_t allocated_texel_bytes(GLCanvas* gl_canvas, GLenum target)
+{
+    const QSurfaceFormat format = gl_canvas->context()->format();
+    if (gl_canvas->context()->isOpenGLES() &&
+        (format.majorVersion() < 3 ||
+         (format.majorVersion() == 3 && format.minorVersion() < 1))) {
+        return 0;
+    }
+
+    static const GLenum component_sizes[] = {GL_TEXTURE_RED_SIZE,
+                                             GL_TEXTURE_GREEN_SIZE,
+                                             GL_TEXTURE_BLUE_SIZE,
+                                             GL_TEXTURE_ALPHA_SIZE};
+
+    GLint bits = 0;
+    for (const GLenum component_size : component_sizes) {
+        GLint size = 0;
+        gl_canvas->glGetTexLevelParameteriv(target, 0, component_size, &size);
+        bits += size;
+    }
+
+    return static_cast<size_t>((bits + 7) / 8);
+}
+
+} // namespace
+
+
 const float Buffer::no_ac_params[8] = {1.0, 1.0, 1.0, 1.0, 0, 0, 0, 0};
 
 
 Buffer::Buffer(GameObject* game_object, GLCanvas* gl_canvas)
     : Component(game_object, gl_canvas)
+    , clip_outliers(false)
+    , visible_range_only(false)
     , buff_prog(gl_canvas)
+    , diff_prog(gl_canvas)
+    , vbo(0)
+    , tile_width_(0)
+    , tile_height_(0)
+    , use_texture_array_(false)
+    , texel_reads_failed_(false)
+    , allocated_texel_bytes_(0)
+    , contents_generation_(0)
+    , tile_vbo_(0)
+    , mipmap_state_(MipmapState::Outdated)
+    , mipmap_reduction_(MipReduction::Average)
+    , statistics_state_(StatisticsState::Ready)
+    , reset_lowest_pending_(false)
+    , reset_upper_pending_(false)
+    , has_statistics_(false)
+    , difference_reference_(nullptr)
+    , difference_mode_(DifferenceMode::Absolute)
+    , difference_threshold_(0.f)
+    , difference_state_(StatisticsState::Ready)
+    , difference_generation_(0)
+    , reference_generation_(0)
+    , has_difference_statistics_(false)
+    , has_color_range_hint_(false)
+    , has_visible_region_(false)
+    , histogram_cancelled_(false)
+    , has_histogram_(false)
+    , is_histogram_updated_in_place_(false)
+    , region_table_cancelled_(false)
+    , is_region_table_requested_(false)
+    , has_region_table_(false)
 {
 }
 
 
 Buffer::~Buffer()
 {
-    int num_textures = num_textures_x * num_textures_y;
+    cancel_histogram();
+
+    gl_canvas_->get_gpu_reducer()->cancel(&difference_statistics_);
+
+    release_textures();
 
-    gl_canvas_->glDeleteTextures(num_textures, buff_tex.data());
     gl_canvas_->glDeleteBuffers(1, &vbo);
+    gl_canvas_->glDeleteBuffers(1, &tile_vbo_);
 }
 
 
 bool Buffer::buffer_update()
 {
-    int num_textures = num_textures_x * num_textures_y;
-    glDeleteTextures(num_textures, buff_tex.data());
+    ++contents_generation_;
 
-    create_shader_program();
+    release_textures();
+
+    reset_contrast_brightness_parameters();
+
+    // The program depends on the kind of texture holding the new contents
     setup_gl_buffer();
+    create_shader_program();
     return true;
 }
 
 
 void Buffer::get_pixel_info(stringstream& message, int x, int y)
 {
-    if (x < 0 || x >= buffer_width_f || y < 0 || y >= buffer_height_f) {
+    if (x < 0 || x >= display_width_f || y < 0 || y >= display_height_f) {
         message << "[out of bounds]";
         return;
     }
 
-    int pos = channels * (y * step + x);
+    // Map the scene coordinates into the contents
+    const float content_x = (x - content_x_f) / content_scale_x_f;
+    const float content_y = (y - content_y_f) / content_scale_y_f;
+
+    if (content_x < 0 || content_x >= buffer_width_f || content_y < 0 ||
+        content_y >= buffer_height_f) {
+        message << "[not loaded]";
+        return;
+    }
+
+    x = static_cast<int>(content_x);
+    y = static_cast<int>(content_y);
+
+    // Without the contents, the pixel is read back from the textures
+    const uint8_t* pixels = buffer;
+    int pos               = channels * (y * step + x);
+
+    vector<uint8_t> texels;
+    if (pixels == nullptr) {
+        if (!read_texels(x, y, 1, 1, texels)) {
+            message << "[not loaded]";
+            return;
+        }
+
+        pixels = texels.data();
+        pos    = 0;
+    }
+
+    if (is_preview()) {
+        message << "[preview] ";
+    }
 
     message << "[";
 
     for (int c = 0; c < channels; ++c) {
-        if (type == BufferType::Float32 ||
-            type == BufferType::Float64) {
-            float fpix = reinterpret_cast<const float*>(buffer)[pos + c];
+        if (held_buffer_type(type) == BufferType::Float32) {
+            float fpix = reinterpret_cast<const float*>(pixels)[pos + c];
+            message << fpix;
+        } else if (type == BufferType::Float16) {
+            float fpix = reinterpret_cast<const Half*>(pixels)[pos + c];
             message << fpix;
         } else if (type == BufferType::UnsignedByte) {
-            short fpix = buffer[pos + c];
+            short fpix = pixels[pos + c];
             message << fpix;
         } else if (type == BufferType::Short) {
-            short fpix = reinterpret_cast<const short*>(buffer)[pos + c];
+            short fpix = reinterpret_cast<const short*>(pixels)[pos + c];
             message << fpix;
         } else if (type == BufferType::UnsignedShort) {
             unsigned short fpix =
-                reinterpret_cast<const unsigned short*>(buffer)[pos + c];
+                reinterpret_cast<const unsigned short*>(pixels)[pos + c];
             message << fpix;
         } else if (type == BufferType::Int32) {
-            int fpix = reinterpret_cast<const int*>(buffer)[pos + c];
+            int fpix = reinterpret_cast<const int*>(pixels)[pos + c];
+            message << fpix;
+        } else if (type == BufferType::Int8) {
+            int fpix = reinterpret_cast<const int8_t*>(pixels)[pos + c];
+            message << fpix;
+        } else if (type == BufferType::UnsignedInt32) {
+            uint32_t fpix = reinterpret_cast<const uint32_t*>(pixels)[pos + c];
             message << fpix;
         }
         if (c < channels - 1) {
@@ -111,104 +268,365 @@ void Buffer::rotate(float angle)
 }
 
 
-void Buffer::recompute_min_color_values()
+bool Buffer::has_pending_statistics() const
 {
-    int buffer_width_i  = static_cast<int>(buffer_width_f);
-    int buffer_height_i = static_cast<int>(buffer_height_f);
+    return statistics_state_ != StatisticsState::Ready ||
+           difference_state_ == StatisticsState::Reducing ||
+           histogram_future_.valid() || region_table_future_.valid();
+}
+
+
+bool Buffer::get_statistics(BufferStatistics& statistics) const
+{
+    if (!has_statistics_) {
+        return false;
+    }
+
+    statistics = statistics_;
+    return true;
+}
+
+
+const Histogram* Buffer::get_histogram() const
+{
+    return has_histogram_ ? &histogram_ : nullptr;
+}
+
+
+void Buffer::set_difference_reference(const Buffer* reference,
+                                      DifferenceMode mode,
+                                      float threshold)
+{
+    if (reference == difference_reference_ && mode == difference_mode_ &&
+        threshold == difference_threshold_) {
+        return;
+    }
+
+    gl_canvas_->get_gpu_reducer()->cancel(&difference_statistics_);
+
+    difference_reference_      = reference != this ? reference : nullptr;
+    difference_mode_           = mode;
+    difference_threshold_      = threshold;
+    difference_state_          = StatisticsState::Outdated;
+    has_difference_statistics_ = false;
+}
+
+
+bool Buffer::shows_difference() const
+{
+    const Buffer* reference = difference_reference_;
+    if (reference == nullptr || !has_textures() || has_pending_uploads() ||
+        !reference->has_textures() || reference->has_pending_uploads() ||
+        is_preview() || reference->is_preview()) {
+        return false;
+    }
+
+    // The tiles are compared texel by texel
+    return reference->buffer_width_f == buffer_width_f &&
+           reference->buffer_height_f == buffer_height_f &&
+           reference->channels == channels &&
+           max_intensity(reference->type) == max_intensity(type) &&
+           reference->use_texture_array_ == use_texture_array_ &&
+           reference->tile_width_ == tile_width_ &&
+           reference->tile_height_ == tile_height_ &&
+           reference->num_textures_x == num_textures_x &&
+           reference->num_textures_y == num_textures_y;
+}
+
+
+bool Buffer::get_difference_statistics(DifferenceStatistics& statistics) const
+{
+    if (!has_difference_statistics_ || !shows_difference()) {
+        return false;
+    }
+
+    statistics = difference_statistics_;
+    return true;
+}
 
-    float* lowest = min_buffer_values();
 
-    for (int i = 0; i < 4; ++i)
-        lowest[i] = std::numeric_limits<float>::max();
-
-    for (int y = 0; y < buffer_height_i; ++y) {
-        for (int x = 0; x < buffer_width_i; ++x) {
-            int i = y * step + x;
-            for (int c = 0; c < channels; ++c) {
-                if (type == BufferType::Float32 || type == BufferType::Float64)
-                    lowest[c] = std::min(
-                        lowest[c],
-                        reinterpret_cast<const float*>(buffer)[channels * i + c]);
-                else if (type == BufferType::UnsignedByte)
-                    lowest[c] =
-                        std::min(lowest[c],
-                                 static_cast<float>(buffer[channels * i + c]));
-                else if (type == BufferType::Short)
-                    lowest[c] =
-                        std::min(lowest[c],
-                                 static_cast<float>(reinterpret_cast<const short*>(
-                                     buffer)[channels * i + c]));
-                else if (type == BufferType::UnsignedShort)
-                    lowest[c] = std::min(
-                        lowest[c],
-                        static_cast<float>(reinterpret_cast<const unsigned short*>(
-                            buffer)[channels * i + c]));
-                else if (type == BufferType::Int32)
-                    lowest[c] =
-                        std::min(lowest[c],
-                                 static_cast<float>(reinterpret_cast<const int*>(
-                                     buffer)[channels * i + c]));
+float Buffer::difference_range() const
+{
+    float range = 0.f;
+
+    if (has_difference_statistics_) {
+        for (int c = 0; c < channels; ++c) {
+            const float lowest = abs(difference_statistics_.lowest[c]);
+            const float upper  = abs(difference_statistics_.upper[c]);
+            if (lowest <= numeric_limits<float>::max()) {
+                range = max(range, lowest);
+            }
+            if (upper <= numeric_limits<float>::max()) {
+                range = max(range, upper);
             }
         }
+    } else if (difference_mode_ != DifferenceMode::Relative) {
+        // Until then, differences are shown relative to the value range
+        for (int c = 0; c < channels; ++c) {
+            range = max(range, max_buffer_values_[c] - min_buffer_values_[c]);
+        }
     }
 
-    // For single channel buffers: fill with 0
-    for (int c = channels; c < 4; ++c)
-        lowest[c] = 0.0;
+    return range > 0.f ? range : 1.f;
 }
 
 
-void Buffer::recompute_max_color_values()
+void Buffer::update_difference_statistics()
 {
-    int buffer_width_i  = static_cast<int>(buffer_width_f);
-    int buffer_height_i = static_cast<int>(buffer_height_f);
+    if (difference_reference_ == nullptr) {
+        return;
+    }
+
+    GpuReducer* reducer = gl_canvas_->get_gpu_reducer();
 
-    float* upper = max_buffer_values();
-    for (int i = 0; i < 4; ++i)
-        upper[i] = std::numeric_limits<float>::lowest();
-
-    for (int y = 0; y < buffer_height_i; ++y) {
-        for (int x = 0; x < buffer_width_i; ++x) {
-            int i = y * step + x;
-            for (int c = 0; c < channels; ++c) {
-                if (type == BufferType::Float32 || type == BufferType::Float64)
-                    upper[c] = std::max(
-                        upper[c],
-                        reinterpret_cast<const float*>(buffer)[channels * i + c]);
-                else if (type == BufferType::UnsignedByte)
-                    upper[c] = std::max(
-                        upper[c], static_cast<float>(buffer[channels * i + c]));
-                else if (type == BufferType::Short)
-                    upper[c] =
-                        std::max(upper[c],
-                                 static_cast<float>(reinterpret_cast<const short*>(
-                                     buffer)[channels * i + c]));
-                else if (type == BufferType::UnsignedShort)
-                    upper[c] = std::max(
-                        upper[c],
-                        static_cast<float>(reinterpret_cast<const unsigned short*>(
-                            buffer)[channels * i + c]));
-                else if (type == BufferType::Int32)
-                    upper[c] =
-                        std::max(upper[c],
-                                 static_cast<float>(reinterpret_cast<const int*>(
-                                     buffer)[channels * i + c]));
+    if (difference_state_ == StatisticsState::Reducing) {
+        DifferenceStatistics statistics;
+        if (reducer->poll_difference(&difference_statistics_, statistics)) {
+            for (int c = channels; c < 4; ++c) {
+                statistics.lowest[c] = statistics.upper[c] = 0.f;
+                statistics.sum[c]                          = 0.0;
+                statistics.nan_count[c] = statistics.above_threshold[c] = 0;
             }
+
+            difference_statistics_     = statistics;
+            has_difference_statistics_ = true;
+            difference_state_          = StatisticsState::Ready;
+        } else if (!reducer->is_pending(&difference_statistics_)) {
+            difference_state_ = StatisticsState::Ready;
         }
+        return;
+    }
+
+    if (!shows_difference()) {
+        return;
+    }
+
+    const bool is_outdated =
+        difference_state_ == StatisticsState::Outdated ||
+        difference_generation_ != contents_generation_ ||
+        reference_generation_ != difference_reference_->contents_generation_;
+    if (!is_outdated) {
+        return;
+    }
+
+    difference_generation_     = contents_generation_;
+    reference_generation_      = difference_reference_->contents_generation_;
+    has_difference_statistics_ = false;
+    difference_state_          = StatisticsState::Ready;
+
+    const int num_tiles = num_textures_x * num_textures_y;
+
+    vector<GpuReducer::Tile> tiles;
+    vector<GpuReducer::Tile> reference_tiles;
+    tiles.reserve(num_tiles);
+    reference_tiles.reserve(num_tiles);
+    for (int tile_id = 0; tile_id < num_tiles; ++tile_id) {
+        const GLfloat* attributes =
+            &tile_attributes_[tile_id * tile_attribute_count];
+        const int width  = static_cast<int>(attributes[2]);
+        const int height = static_cast<int>(attributes[3]);
+        const int layer  = use_texture_array_ ? tile_id : 0;
+        const int index  = use_texture_array_ ? 0 : tile_id;
+
+        tiles.push_back(
+            GpuReducer::Tile{buff_tex[index], layer, width, height});
+        reference_tiles.push_back(GpuReducer::Tile{
+            difference_reference_->buff_tex[index], layer, width, height});
+    }
+
+    if (reducer->reduce_difference(&difference_statistics_,
+                                   texture_target(),
+                                   tile_width_,
+                                   tile_height_,
+                                   tiles,
+                                   reference_tiles,
+                                   difference_mode_,
+                                   max_intensity(type),
+                                   difference_threshold_)) {
+        difference_state_ = StatisticsState::Reducing;
+    }
+}
+
+
+void Buffer::cancel_histogram()
+{
+    if (region_table_future_.valid()) {
+        region_table_cancelled_ = true;
+        region_table_future_.wait();
+        region_table_future_ = future<SummedAreaTable>();
+    }
+
+    if (!histogram_future_.valid()) {
+        return;
+    }
+
+    histogram_cancelled_ = true;
+    histogram_future_.wait();
+    histogram_future_ = future<Histogram>();
+}
+
+
+void Buffer::recompute_color_range()
+{
+    request_color_range(true, true);
+}
+
+
+void Buffer::recompute_min_color_values()
+{
+    request_color_range(true, false);
+}
+
+
+void Buffer::recompute_max_color_values()
+{
+    request_color_range(false, true);
+}
+
+
+void Buffer::set_color_range_hint(const float* lowest, const float* upper)
+{
+    has_color_range_hint_ = lowest != nullptr && upper != nullptr;
+    if (!has_color_range_hint_) {
+        return;
     }
 
-    // For single channel buffers: fill with 0
-    for (int c = channels; c < 4; ++c)
-        upper[c] = 0.0;
+    copy(lowest, lowest + 4, color_range_hint_);
+    copy(upper, upper + 4, color_range_hint_ + 4);
 }
 
 
 void Buffer::reset_contrast_brightness_parameters()
 {
-    recompute_min_color_values();
-    recompute_max_color_values();
+    // The contents changed
+    block_ranges_.clear();
+
+    start_histogram();
+
+    if (is_region_table_requested_) {
+        start_region_table();
+    }
+
+    recompute_color_range();
+
+    compute_contrast_brightness_parameters();
+}
+
+
+void Buffer::request_color_range(bool reset_lowest, bool reset_upper)
+{
+    // The hint is only valid for the contents it was computed from
+    const bool use_range_hint =
+        has_color_range_hint_ && reset_lowest && reset_upper;
+    has_color_range_hint_ = false;
+
+    if (clip_outliers) {
+        // The percentiles are found in the histogram, and the statistics
+        // would reset the ranges to the extremes
+        if (statistics_state_ != StatisticsState::Ready) {
+            gl_canvas_->get_gpu_reducer()->cancel(this);
+            statistics_state_ = StatisticsState::Ready;
+        }
+
+        reset_lowest_pending_ = reset_lowest_pending_ || reset_lowest;
+        reset_upper_pending_  = reset_upper_pending_ || reset_upper;
+
+        if (has_histogram_) {
+            set_percentile_range();
+        }
+        return;
+    }
+
+    float lowest[4];
+    float upper[4];
+
+    // The ranges of the blocks follow the updated tiles, and the view
+    const bool use_block_ranges =
+        block_ranges_.is_valid() || (visible_range_only && buffer != nullptr);
+
+    if (!use_block_ranges &&
+        request_gpu_statistics(reset_lowest, reset_upper)) {
+        return;
+    }
+
+    // Without GPU reductions, the contents are never dropped
+    if (!use_block_ranges && !use_range_hint && buffer == nullptr) {
+        return;
+    }
+
+    if (use_range_hint && !use_block_ranges) {
+        copy(color_range_hint_, color_range_hint_ + 4, lowest);
+        copy(color_range_hint_ + 4, color_range_hint_ + 8, upper);
+    } else if (!get_block_range(lowest, upper)) {
+        fill(lowest, lowest + 4, 0.f);
+        fill(upper, upper + 4, 0.f);
+    }
+
+    reset_lowest_pending_ = reset_lowest_pending_ || reset_lowest;
+    reset_upper_pending_  = reset_upper_pending_ || reset_upper;
+    set_color_range(lowest, upper);
+}
 
+
+bool Buffer::set_visible_region(float x0, float y0, float x1, float y1)
+{
+    // Map the scene coordinates into the contents, keeping the pixels the
+    // region partly covers
+    const int region[4] = {
+        static_cast<int>(floor((x0 - content_x_f) / content_scale_x_f)),
+        static_cast<int>(floor((y0 - content_y_f) / content_scale_y_f)),
+        static_cast<int>(ceil((x1 - content_x_f) / content_scale_x_f)),
+        static_cast<int>(ceil((y1 - content_y_f) / content_scale_y_f))};
+
+    // The ranges only change once other blocks come into view
+    const int block_size = BlockRanges::block_size;
+    const bool is_same_region =
+        has_visible_region_ &&
+        region[0] / block_size == visible_region_[0] / block_size &&
+        region[1] / block_size == visible_region_[1] / block_size &&
+        (region[2] - 1) / block_size ==
+            (visible_region_[2] - 1) / block_size &&
+        (region[3] - 1) / block_size == (visible_region_[3] - 1) / block_size;
+
+    copy(region, region + 4, visible_region_);
+    has_visible_region_ = true;
+
+    if (is_same_region || !visible_range_only || clip_outliers) {
+        return false;
+    }
+
+    recompute_color_range();
     compute_contrast_brightness_parameters();
+
+    return true;
+}
+
+
+bool Buffer::get_block_range(float lowest[4], float upper[4])
+{
+    const int width  = static_cast<int>(buffer_width_f);
+    const int height = static_cast<int>(buffer_height_f);
+
+    if (!block_ranges_.is_valid()) {
+        if (buffer == nullptr) {
+            return false;
+        }
+
+        block_ranges_.compute(buffer, width, height, step, channels, type);
+    }
+
+    // A buffer out of view keeps the ranges of all of its values
+    if (visible_range_only && has_visible_region_ &&
+        block_ranges_.get_range(visible_region_[0],
+                                visible_region_[1],
+                                visible_region_[2],
+                                visible_region_[3],
+                                lowest,
+                                upper)) {
+        return true;
+    }
+
+    return block_ranges_.get_range(0, 0, width, height, lowest, upper);
 }
 
 
@@ -220,20 +638,9 @@ void Buffer::compute_contrast_brightness_parameters()
     float* auto_buffer_contrast   = auto_buffer_contrast_brightness_;
     float* auto_buffer_brightness = auto_buffer_contrast_brightness_ + 4;
 
+    const float maxIntensity = max_intensity(type);
+
     for (int c = 0; c < channels; ++c) {
-        float maxIntensity = 1.0f;
-        if (type == BufferType::UnsignedByte) {
-            maxIntensity = 255.0f;
-        } else if (type ==
-                 BufferType::Short) {// All non-real values have max color 255
-            maxIntensity = static_cast<float>(std::numeric_limits<short>::max());
-        } else if (type == BufferType::UnsignedShort) {
-            maxIntensity = static_cast<float>(std::numeric_limits<unsigned short>::max());
-        } else if (type == BufferType::Int32) {
-            maxIntensity = static_cast<float>(std::numeric_limits<int>::max());
-        } else if (type == BufferType::Float32 || type == BufferType::Float64) {
-            maxIntensity = 1.0f;
-        }
         float upp_minus_low = upper[c] - lowest[c];
 
         if (upp_minus_low == 0) {
@@ -251,88 +658,776 @@ void Buffer::compute_contrast_brightness_parameters()
 }
 
 
-int Buffer::sub_texture_id_at_coord(int x, int y)
+float Buffer::sampled_value_at(int x, int y) const
+{
+    return sampled_value(buffer, channels * (y * step + x));
+}
+
+
+float Buffer::sampled_value(const uint8_t* values, int pos) const
+{
+    if (held_buffer_type(type) == BufferType::Float32) {
+        return reinterpret_cast<const float*>(values)[pos];
+    } else if (type == BufferType::Float16) {
+        return reinterpret_cast<const Half*>(values)[pos];
+    } else if (type == BufferType::UnsignedByte) {
+        return values[pos] / max_intensity(type);
+    } else if (type == BufferType::Short) {
+        // Signed normalized values are clamped to -1
+        return std::max(reinterpret_cast<const short*>(values)[pos] /
+                            max_intensity(type),
+                        -1.0f);
+    } else if (type == BufferType::UnsignedShort) {
+        return reinterpret_cast<const unsigned short*>(values)[pos] /
+               max_intensity(type);
+    } else if (type == BufferType::Int32) {
+        return static_cast<float>(reinterpret_cast<const int*>(values)[pos]) /
+               max_intensity(type);
+    } else if (type == BufferType::Int8) {
+        return std::max(reinterpret_cast<const int8_t*>(values)[pos] /
+                            max_intensity(type),
+                        -1.0f);
+    } else if (type == BufferType::UnsignedInt32) {
+        return static_cast<float>(
+                   reinterpret_cast<const uint32_t*>(values)[pos]) /
+               max_intensity(type);
+    }
+
+    return 0.0f;
+}
+
+
+bool Buffer::can_drop_contents()
+{
+    // The ranges are reset from the statistics reduced on the GPU once the
+    // contents are gone
+    if (buffer == nullptr || texel_reads_failed_ || !has_textures() ||
+        has_pending_uploads() || needs_update() ||
+        !gl_canvas_->get_gpu_reducer()->is_available()) {
+        return false;
+    }
+
+    vector<uint8_t> texel;
+    return read_texels(0, 0, 1, 1, texel);
+}
+
+
+void Buffer::drop_contents()
+{
+    buffer = nullptr;
+}
+
+
+bool Buffer::has_contents() const
+{
+    return buffer != nullptr;
+}
+
+
+bool Buffer::read_texels(int x,
+                         int y,
+                         int width,
+                         int height,
+                         vector<uint8_t>& texels)
+{
+    const int buffer_width_i  = static_cast<int>(buffer_width_f);
+    const int buffer_height_i = static_cast<int>(buffer_height_f);
+
+    if (texel_reads_failed_ || !has_textures() || has_pending_uploads() ||
+        x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        x + width > buffer_width_i || y + height > buffer_height_i) {
+        return false;
+    }
+
+    GLuint tex_type;
+    GLuint tex_format;
+    get_texture_format(tex_format, tex_type);
+
+    // 32 bit integer textures hold normalized floats, which are scaled back
+    // below
+    if (type == BufferType::Int32 || type == BufferType::UnsignedInt32) {
+        tex_type = GL_FLOAT;
+    }
+
+    const size_t pixel_size = held_pixel_size(type, channels);
+    texels.resize(pixel_size * static_cast<size_t>(width) *
+                  static_cast<size_t>(height));
+
+    GLint previous_fbo;
+    gl_canvas_->glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_fbo);
+
+    GLuint fbo;
+    gl_canvas_->glGenFramebuffers(1, &fbo);
+    gl_canvas_->glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    gl_canvas_->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    gl_canvas_->glPixelStorei(GL_PACK_ROW_LENGTH, width);
+
+    bool complete = true;
+
+    for (int ty = y / tile_height_;
+         complete && ty <= (y + height - 1) / tile_height_;
+         ++ty) {
+        const int tile_y = ty * tile_height_;
+        const int y0     = std::max(y, tile_y);
+        const int y1     = std::min(y + height, tile_y + tile_height_);
+
+        for (int tx = x / tile_width_; tx <= (x + width - 1) / tile_width_;
+             ++tx) {
+            const int tile_x  = tx * tile_width_;
+            const int x0      = std::max(x, tile_x);
+            const int x1      = std::min(x + width, tile_x + tile_width_);
+            const int tile_id = ty * num_textures_x + tx;
+
+            if (use_texture_array_) {
+                gl_canvas_->glFramebufferTextureLayer(GL_READ_FRAMEBUFFER,
+                                                      GL_COLOR_ATTACHMENT0,
+                                                      buff_tex[0],
+                                                      0,
+                                                      tile_id);
+            } else {
+                gl_canvas_->glFramebufferTexture2D(GL_READ_FRAMEBUFFER,
+                                                   GL_COLOR_ATTACHMENT0,
+                                                   GL_TEXTURE_2D,
+                                                   buff_tex[tile_id],
+                                                   0);
+            }
+
+            if (gl_canvas_->glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) !=
+                GL_FRAMEBUFFER_COMPLETE) {
+                complete = false;
+                break;
+            }
+
+            gl_canvas_->glReadBuffer(GL_COLOR_ATTACHMENT0);
+            gl_canvas_->glReadPixels(
+                x0 - tile_x,
+                y0 - tile_y,
+                x1 - x0,
+                y1 - y0,
+                tex_format,
+                tex_type,
+                texels.data() +
+                    (static_cast<size_t>(y0 - y) * static_cast<size_t>(width) +
+                     static_cast<size_t>(x0 - x)) *
+                        pixel_size);
+        }
+    }
+
+    gl_canvas_->glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    gl_canvas_->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    gl_canvas_->glBindFramebuffer(GL_READ_FRAMEBUFFER,
+                                  static_cast<GLuint>(previous_fbo));
+    gl_canvas_->glDeleteFramebuffers(1, &fbo);
+
+    if (!complete) {
+        texel_reads_failed_ = true;
+        return false;
+    }
+
+    if (type == BufferType::Int32) {
+        const double intensity = max_intensity(type);
+
+        for (size_t offset = 0; offset < texels.size();
+             offset += sizeof(float)) {
+            float sampled;
+            memcpy(&sampled, texels.data() + offset, sizeof(float));
+            const double value =
+                std::min(std::max(std::round(sampled * intensity),
+                                  static_cast<double>(
+                                      std::numeric_limits<int>::min())),
+                         static_cast<double>(std::numeric_limits<int>::max()));
+            const int32_t texel = static_cast<int32_t>(value);
+            memcpy(texels.data() + offset, &texel, sizeof(int32_t));
+        }
+    } else if (type == BufferType::UnsignedInt32) {
+        const double intensity = max_intensity(type);
+
+        for (size_t offset = 0; offset < texels.size();
+             offset += sizeof(float)) {
+            float sampled;
+            memcpy(&sampled, texels.data() + offset, sizeof(float));
+            const double value = std::min(
+                std::max(std::round(sampled * intensity), 0.0),
+                static_cast<double>(std::numeric_limits<uint32_t>::max()));
+            const uint32_t texel = static_cast<uint32_t>(value);
+            memcpy(texels.data() + offset, &texel, sizeof(uint32_t));
+        }
+    }
+
+    return true;
+}
+
+
+void Buffer::set_pixel_layout(const string& pixel_layout)
+{
+    ///
+    // Make sure the provided pixel_layout is valid
+    if (pixel_layout.size() != 4) {
+        return;
+    }
+    const char valid_characters[] = {'r', 'g', 'b', 'a'};
+    const int num_valid_chars =
+        sizeof(valid_characters) / sizeof(valid_characters[0]);
+
+    for (int i = 0; i < static_cast<int>(pixel_layout.size()); ++i) {
+        bool is_character_valid = false;
+        for (int j = 0; j < num_valid_chars; ++j) {
+            if (pixel_layout[i] == valid_characters[j]) {
+                is_character_valid = true;
+                break;
+            }
+        }
+        if (!is_character_valid) {
+            return;
+        }
+    }
+
+    ///
+    // Copy the pixel format
+    for (int i = 0; i < static_cast<int>(pixel_layout.size()); ++i) {
+        pixel_layout_[i] = pixel_layout[i];
+    }
+}
+
+
+bool Buffer::is_preview() const
+{
+    return content_scale_x_f != 1.f || content_scale_y_f != 1.f;
+}
+
+
+unsigned int Buffer::contents_generation() const
+{
+    return contents_generation_;
+}
+
+
+float Buffer::content_offset_x() const
+{
+    return content_x_f + buffer_width_f * content_scale_x_f / 2.f -
+           display_width_f / 2.f;
+}
+
+
+float Buffer::content_offset_y() const
+{
+    return content_y_f + buffer_height_f * content_scale_y_f / 2.f -
+           display_height_f / 2.f;
+}
+
+
+void Buffer::update()
+{
+    update_mipmaps();
+
+    update_statistics();
+
+    update_difference_statistics();
+
+    update_histogram();
+
+    update_region_table();
+
+    update_object_pose();
+}
+
+
+void Buffer::start_histogram()
+{
+    // Dropped contents no longer change, so their histogram is still valid
+    if (buffer == nullptr) {
+        return;
+    }
+
+    cancel_histogram();
+
+    has_histogram_                 = false;
+    histogram_cancelled_           = false;
+    is_histogram_updated_in_place_ = false;
+
+    const uint8_t* histogram_buffer = buffer;
+    const int width                 = static_cast<int>(buffer_width_f);
+    const int height                = static_cast<int>(buffer_height_f);
+    const int histogram_step        = step;
+    const int histogram_channels    = channels;
+    const BufferType histogram_type = type;
+    const atomic<bool>* cancelled   = &histogram_cancelled_;
+
+    histogram_future_ = async(launch::async, [=]() {
+        Histogram histogram;
+        compute_histogram(histogram_buffer,
+                          width,
+                          height,
+                          histogram_step,
+                          histogram_channels,
+                          histogram_type,
+                          *cancelled,
+                          histogram);
+        return histogram;
+    });
+}
+
+
+void Buffer::update_histogram()
+{
+    if (!histogram_future_.valid() ||
+        histogram_future_.wait_for(chrono::seconds(0)) !=
+            future_status::ready) {
+        return;
+    }
+
+    histogram_     = histogram_future_.get();
+    has_histogram_ = true;
+
+    if (clip_outliers && (reset_lowest_pending_ || reset_upper_pending_)) {
+        set_percentile_range();
+    }
+}
+
+
+void Buffer::set_percentile_range()
+{
+    float lowest[4];
+    float upper[4];
+
+    for (int c = 0; c < 4; ++c) {
+        if (c < channels) {
+            histogram_percentile_range(
+                histogram_, c, outlier_fraction, lowest[c], upper[c]);
+        } else {
+            // For single channel buffers: fill with 0
+            lowest[c] = upper[c] = 0.0f;
+        }
+    }
+
+    set_color_range(lowest, upper);
+}
+
+
+Buffer::RegionState Buffer::get_region_statistics(float x0,
+                                                  float y0,
+                                                  float x1,
+                                                  float y1,
+                                                  size_t max_table_bytes,
+                                                  RegionStatistics& statistics)
+{
+    if (!has_region_table_) {
+        const size_t table_bytes =
+            summed_area_table_bytes(static_cast<int>(buffer_width_f),
+                                    static_cast<int>(buffer_height_f),
+                                    channels);
+
+        // Dropped contents can't be tabulated anymore
+        if (table_bytes > max_table_bytes ||
+            (buffer == nullptr && !region_table_future_.valid())) {
+            return RegionState::Unavailable;
+        }
+
+        if (!region_table_future_.valid()) {
+            is_region_table_requested_ = true;
+            start_region_table();
+        }
+
+        return RegionState::Pending;
+    }
+
+    // Map the scene coordinates into the contents, keeping the pixels the
+    // region partly covers
+    const float content_x0 = (x0 - content_x_f) / content_scale_x_f;
+    const float content_y0 = (y0 - content_y_f) / content_scale_y_f;
+    const float content_x1 = (x1 - content_x_f) / content_scale_x_f;
+    const float content_y1 = (y1 - content_y_f) / content_scale_y_f;
+
+    region_statistics(region_table_,
+                      static_cast<int>(floor(content_x0)),
+                      static_cast<int>(floor(content_y0)),
+                      static_cast<int>(ceil(content_x1)),
+                      static_cast<int>(ceil(content_y1)),
+                      statistics);
+
+    return RegionState::Ready;
+}
+
+
+void Buffer::start_region_table()
+{
+    // Dropped contents no longer change, so their tables are still valid
+    if (buffer == nullptr) {
+        return;
+    }
+
+    if (region_table_future_.valid()) {
+        region_table_cancelled_ = true;
+        region_table_future_.wait();
+    }
+
+    has_region_table_       = false;
+    region_table_cancelled_ = false;
+
+    // The tables of the previous contents are freed before the next ones
+    // are allocated
+    region_table_ = SummedAreaTable();
+
+    const uint8_t* table_buffer   = buffer;
+    const int width               = static_cast<int>(buffer_width_f);
+    const int height              = static_cast<int>(buffer_height_f);
+    const int table_step          = step;
+    const int table_channels      = channels;
+    const BufferType table_type   = type;
+    const atomic<bool>* cancelled = &region_table_cancelled_;
+
+    region_table_future_ = async(launch::async, [=]() {
+        SummedAreaTable table;
+        compute_summed_area_table(table_buffer,
+                                  width,
+                                  height,
+                                  table_step,
+                                  table_channels,
+                                  table_type,
+                                  *cancelled,
+                                  table);
+        return table;
+    });
+}
+
+
+void Buffer::update_region_table()
+{
+    if (!region_table_future_.valid() ||
+        region_table_future_.wait_for(chrono::seconds(0)) !=
+            future_status::ready) {
+        return;
+    }
+
+    region_table_     = region_table_future_.get();
+    has_region_table_ = true;
+}
+
+
+bool Buffer::request_gpu_statistics(bool reset_lowest, bool reset_upper)
+{
+    GpuReducer* reducer = gl_canvas_->get_gpu_reducer();
+    if (!reducer->is_available()) {
+        return false;
+    }
+
+    // A reduction in flight may predate the contents
+    reducer->cancel(this);
+
+    reset_lowest_pending_ = reset_lowest_pending_ || reset_lowest;
+    reset_upper_pending_  = reset_upper_pending_ || reset_upper;
+    has_statistics_       = false;
+    statistics_state_     = StatisticsState::Outdated;
+
+    return true;
+}
+
+
+void Buffer::update_statistics()
+{
+    GpuReducer* reducer = gl_canvas_->get_gpu_reducer();
+
+    if (statistics_state_ == StatisticsState::Outdated) {
+        // The statistics are reduced from the uploaded contents
+        if (!has_textures() || has_pending_uploads()) {
+            return;
+        }
+
+        const int num_tiles = num_textures_x * num_textures_y;
+
+        vector<GpuReducer::Tile> tiles;
+        tiles.reserve(num_tiles);
+        for (int tile_id = 0; tile_id < num_tiles; ++tile_id) {
+            const GLfloat* attributes =
+                &tile_attributes_[tile_id * tile_attribute_count];
+
+            tiles.push_back(
+                GpuReducer::Tile{buff_tex[use_texture_array_ ? 0 : tile_id],
+                                 use_texture_array_ ? tile_id : 0,
+                                 static_cast<int>(attributes[2]),
+                                 static_cast<int>(attributes[3])});
+        }
+
+        if (reducer->reduce(
+                this, texture_target(), tile_width_, tile_height_, tiles)) {
+            statistics_state_ = StatisticsState::Reducing;
+            return;
+        }
+    } else if (statistics_state_ == StatisticsState::Reducing) {
+        BufferStatistics statistics;
+        if (reducer->poll(this, statistics)) {
+            set_statistics(statistics);
+            return;
+        }
+
+        if (reducer->is_pending(this)) {
+            return;
+        }
+    } else {
+        return;
+    }
+
+    // The reduction failed, and the ranges are computed on the CPU instead,
+    // unless the contents were dropped
+    if (buffer == nullptr) {
+        reset_lowest_pending_ = false;
+        reset_upper_pending_  = false;
+        statistics_state_     = StatisticsState::Ready;
+        return;
+    }
+
+    float lowest[4];
+    float upper[4];
+    if (!get_block_range(lowest, upper)) {
+        fill(lowest, lowest + 4, 0.f);
+        fill(upper, upper + 4, 0.f);
+    }
+
+    set_color_range(lowest, upper);
+}
+
+
+void Buffer::set_statistics(BufferStatistics statistics)
+{
+    // Integer textures are sampled as normalized values. Signed ones clamp
+    // the lowest value of their type to -1, so it is reported as the value
+    // above it (see the README).
+    const float intensity = max_intensity(type);
+
+    for (int c = 0; c < 4; ++c) {
+        if (c < channels) {
+            statistics.lowest[c] *= intensity;
+            statistics.upper[c] *= intensity;
+            statistics.sum[c] *= intensity;
+        } else {
+            // For single channel buffers: fill with 0
+            statistics.lowest[c] = statistics.upper[c] = 0.0f;
+            statistics.sum[c]                          = 0.0;
+            statistics.nan_count[c] = statistics.inf_count[c] = 0;
+        }
+    }
+
+    statistics_     = statistics;
+    has_statistics_ = true;
+
+    set_color_range(statistics.lowest, statistics.upper);
+}
+
+
+void Buffer::set_color_range(const float* lowest, const float* upper)
 {
-    int tx = x / max_texture_size;
-    int ty = y / max_texture_size;
-    return buff_tex[ty * num_textures_x + tx];
+    for (int c = 0; c < 4; ++c) {
+        if (reset_lowest_pending_) {
+            min_buffer_values_[c] = lowest[c];
+        }
+        if (reset_upper_pending_) {
+            max_buffer_values_[c] = upper[c];
+        }
+    }
+
+    reset_lowest_pending_ = false;
+    reset_upper_pending_  = false;
+    statistics_state_     = StatisticsState::Ready;
+
+    compute_contrast_brightness_parameters();
 }
 
 
-void Buffer::set_pixel_layout(const string& pixel_layout)
+void Buffer::update_mipmaps()
 {
-    ///
-    // Make sure the provided pixel_layout is valid
-    if (pixel_layout.size() != 4) {
+    if (!has_textures()) {
         return;
     }
-    const char valid_characters[] = {'r', 'g', 'b', 'a'};
-    const int num_valid_chars =
-        sizeof(valid_characters) / sizeof(valid_characters[0]);
 
-    for (int i = 0; i < static_cast<int>(pixel_layout.size()); ++i) {
-        bool is_character_valid = false;
-        for (int j = 0; j < num_valid_chars; ++j) {
-            if (pixel_layout[i] == valid_characters[j]) {
-                is_character_valid = true;
-                break;
-            }
+    // The levels of dropped contents can't be reduced again
+    const MipReduction reduction = gl_canvas_->mip_reduction();
+    if (mipmap_state_ != MipmapState::Outdated &&
+        mipmap_reduction_ != reduction && buffer != nullptr) {
+        invalidate_mipmaps();
+    }
+
+    if (mipmap_state_ == MipmapState::Outdated) {
+        // The levels are reduced from the uploaded contents
+        if (mip_level_count(tile_width_, tile_height_) > 1 &&
+            !has_pending_uploads() && buffer != nullptr) {
+            start_mipmap_reduction(reduction);
         }
-        if (!is_character_valid) {
+    } else if (mipmap_state_ == MipmapState::Reducing) {
+        if (mip_levels_future_.wait_for(chrono::seconds(0)) ==
+            future_status::ready) {
+            mip_levels_ = mip_levels_future_.get();
+            upload_mipmaps();
+        }
+    } else if (mipmap_state_ == MipmapState::Uploading) {
+        if (has_pending_uploads()) {
             return;
         }
-    }
 
-    ///
-    // Copy the pixel format
-    for (int i = 0; i < static_cast<int>(pixel_layout.size()); ++i) {
-        pixel_layout_[i] = pixel_layout[i];
+        mip_levels_.clear();
+
+        // Outliers would be blurred away by linear filtering
+        const GLint min_filter = reduction == MipReduction::Average
+                                     ? GL_LINEAR_MIPMAP_LINEAR
+                                     : GL_NEAREST_MIPMAP_NEAREST;
+        const GLenum target = texture_target();
+        const int max_level = mip_level_count(tile_width_, tile_height_) - 1;
+
+        for (const GLuint tex : buff_tex) {
+            gl_canvas_->glBindTexture(target, tex);
+            gl_canvas_->glTexParameteri(
+                target, GL_TEXTURE_MAX_LEVEL, max_level);
+            gl_canvas_->glTexParameteri(
+                target, GL_TEXTURE_MIN_FILTER, min_filter);
+        }
+
+        mipmap_state_ = MipmapState::Ready;
     }
 }
 
 
-const char* Buffer::get_pixel_layout() const
+void Buffer::start_mipmap_reduction(MipReduction reduction)
 {
-    return pixel_layout_;
-}
+    const int num_tiles = num_textures_x * num_textures_y;
+
+    vector<vector<MipLevel>> tile_levels(num_tiles);
+
+    for (int tile_id = 0; tile_id < num_tiles; ++tile_id) {
+        const GLfloat* attributes =
+            &tile_attributes_[tile_id * tile_attribute_count];
+
+        tile_levels[tile_id].push_back(
+            reduce_buffer_region(buffer,
+                                 step,
+                                 channels,
+                                 type,
+                                 (tile_id % num_textures_x) * tile_width_,
+                                 (tile_id / num_textures_x) * tile_height_,
+                                 static_cast<int>(attributes[2]),
+                                 static_cast<int>(attributes[3]),
+                                 tile_width_,
+                                 tile_height_,
+                                 reduction));
+    }
 
+    const int level_channels    = channels;
+    const BufferType level_type = type;
+
+    mip_levels_future_ = async(
+        launch::async,
+        [tile_levels = move(tile_levels),
+         level_channels,
+         level_type,
+         reduction]() mutable {
+            for (auto& levels : tile_levels) {
+                reduce_mip_levels(
+                    levels, level_channels, level_type, reduction);
+            }
+            return move(tile_levels);
+        });
 
-float Buffer::tile_coord_x(int x)
-{
-    int buffer_width_i = static_cast<int>(buffer_width_f);
-    int last_width     = buffer_width_i % max_texture_size;
-    float tile_width =
-        (x > (buffer_width_i - last_width)) ? last_width : max_texture_size;
-    return static_cast<float>(x % max_texture_size) /
-           static_cast<float>(tile_width - 1);
+    mipmap_reduction_ = reduction;
+    mipmap_state_     = MipmapState::Reducing;
 }
 
 
-float Buffer::tile_coord_y(int y)
+void Buffer::upload_mipmaps()
 {
-    int buffer_height_i = static_cast<int>(buffer_height_f);
-    int last_height     = buffer_height_i % max_texture_size;
-    int tile_height =
-        (y > (buffer_height_i - last_height)) ? last_height : max_texture_size;
-    return static_cast<float>(y % max_texture_size) /
-           static_cast<float>(tile_height - 1);
+    GLuint tex_type;
+    GLuint tex_format;
+    get_texture_format(tex_format, tex_type);
+    const GLint internal_format = get_texture_internal_format();
+    const GLenum target         = texture_target();
+
+    const size_t pixel_size = held_pixel_size(type, channels);
+
+    const int num_tiles = static_cast<int>(mip_levels_.size());
+
+    // All tiles have the same size, and so the same levels
+    for (const GLuint tex : buff_tex) {
+        gl_canvas_->glBindTexture(target, tex);
+
+        for (size_t l = 0; l < mip_levels_[0].size(); ++l) {
+            const MipLevel& level = mip_levels_[0][l];
+            const GLint level_id  = static_cast<GLint>(l + 1);
+
+            if (use_texture_array_) {
+                gl_canvas_->glTexImage3D(GL_TEXTURE_2D_ARRAY,
+                                         level_id,
+                                         internal_format,
+                                         level.width,
+                                         level.height,
+                                         num_tiles,
+                                         0,
+                                         tex_format,
+                                         tex_type,
+                                         nullptr);
+            } else {
+                gl_canvas_->glTexImage2D(GL_TEXTURE_2D,
+                                         level_id,
+                                         internal_format,
+                                         level.width,
+                                         level.height,
+                                         0,
+                                         tex_format,
+                                         tex_type,
+                                         nullptr);
+            }
+        }
+    }
+
+    TextureUploader* uploader = gl_canvas_->get_texture_uploader();
+
+    for (int tile_id = 0; tile_id < num_tiles; ++tile_id) {
+        const GLuint tile_tex = buff_tex[use_texture_array_ ? 0 : tile_id];
+
+        for (size_t l = 0; l < mip_levels_[tile_id].size(); ++l) {
+            const MipLevel& level = mip_levels_[tile_id][l];
+
+            uploader->enqueue(
+                TextureUploader::Upload{this,
+                                        tile_tex,
+                                        target,
+                                        static_cast<int>(l + 1),
+                                        0,
+                                        0,
+                                        use_texture_array_ ? tile_id : 0,
+                                        level.pixels.data(),
+                                        0,
+                                        0,
+                                        level.width,
+                                        level.width,
+                                        level.height,
+                                        pixel_size,
+                                        tex_format,
+                                        tex_type});
+        }
+    }
+
+    mipmap_state_ = MipmapState::Uploading;
 }
 
 
-void Buffer::update()
+void Buffer::invalidate_mipmaps()
 {
-    GameObject* cam_obj = game_object_->stage->get_game_object("camera");
-    Camera* camera      = cam_obj->get_component<Camera>("camera_component");
-    float zoom          = camera->compute_zoom();
-
-    buff_prog.use();
-    if (zoom > 40) {
-        buff_prog.uniform1i("enable_borders", 1);
-    } else {
-        buff_prog.uniform1i("enable_borders", 0);
+    if (mipmap_state_ == MipmapState::Reducing) {
+        // The worker only reads its own levels, so it is left to finish
+        mip_levels_future_.wait();
+        mip_levels_future_ = future<vector<vector<MipLevel>>>();
+    } else if (mipmap_state_ == MipmapState::Uploading) {
+        // The contents were all uploaded before the mipmaps
+        gl_canvas_->get_texture_uploader()->cancel(this);
+    } else if (mipmap_state_ == MipmapState::Ready) {
+        const GLenum target = texture_target();
+        for (const GLuint tex : buff_tex) {
+            gl_canvas_->glBindTexture(target, tex);
+            gl_canvas_->glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+            gl_canvas_->glTexParameteri(
+                target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        }
     }
 
-    update_object_pose();
+    mip_levels_.clear();
+    mipmap_state_ = MipmapState::Outdated;
 }
 
 
@@ -381,15 +1476,39 @@ void Buffer::create_shader_program()
                      {"mvp",
                       "sampler",
                       "brightness_contrast",
-                      "buffer_dimension",
-                      "enable_borders"});
+                      "content_transform",
+                      "tile_size",
+                      "enable_borders",
+                      "enable_value_labels",
+                      "glyph_sampler",
+                      "glyph_rects",
+                      "glyph_boxes",
+                      "label_rotation",
+                      "label_offsets",
+                      "label_value_format"},
+                     {"input_position", "tile_rect", "tile_layer"},
+                     use_texture_array_);
+
+    diff_prog.create(shader::buff_vert_shader,
+                     shader::buff_diff_frag_shader,
+                     channel_type,
+                     pixel_layout_,
+                     {"mvp",
+                      "sampler",
+                      "reference_sampler",
+                      "content_transform",
+                      "tile_size",
+                      "enable_borders",
+                      "difference_mode",
+                      "value_scale",
+                      "difference_range"},
+                     {"input_position", "tile_rect", "tile_layer"},
+                     use_texture_array_);
 }
 
 
 bool Buffer::initialize()
 {
-    create_shader_program();
-
     // Buffer VBO
     // clang-format off
     static const GLfloat g_vertex_buffer_data[] = {
@@ -409,8 +1528,14 @@ bool Buffer::initialize()
                              g_vertex_buffer_data,
                              GL_STATIC_DRAW);
 
+    gl_canvas_->glGenBuffers(1, &tile_vbo_);
+
+    reset_contrast_brightness_parameters();
+
     setup_gl_buffer();
 
+    create_shader_program();
+
     update_object_pose();
 
     return true;
@@ -419,75 +1544,265 @@ bool Buffer::initialize()
 
 void Buffer::draw(const mat4& projection, const mat4& viewInv)
 {
-    buff_prog.use();
+    Camera* camera = game_object_->stage->get_camera_component();
+    float zoom          = camera->compute_zoom();
+
+    // The differences with the reference replace the contents, once both
+    // can be compared
+    const bool draw_difference = shows_difference();
+    const ShaderProgram& program = draw_difference ? diff_prog : buff_prog;
+
+    program.use();
+    // Set when drawing, since icons and exports use their own zoom
+    if (zoom > 40) {
+        program.uniform1i("enable_borders", 1);
+    } else {
+        program.uniform1i("enable_borders", 0);
+    }
+
     mat4 model = game_object_->get_pose();
     mat4 mvp   = projection * viewInv * model;
 
     gl_canvas_->glEnableVertexAttribArray(0);
-    gl_canvas_->glActiveTexture(GL_TEXTURE0);
 
-    buff_prog.uniform1i("sampler", 0);
-    if (game_object_->stage->contrast_enabled) {
-        buff_prog.uniform4fv(
-            "brightness_contrast", 2, auto_buffer_contrast_brightness_);
+    if (draw_difference) {
+        program.uniform1i("sampler", 0);
+        program.uniform1i("reference_sampler", 1);
+        program.uniform1i("difference_mode",
+                          static_cast<int>(difference_mode_));
+        program.uniform1f("value_scale", max_intensity(type));
+        program.uniform1f("difference_range", difference_range());
     } else {
-        buff_prog.uniform4fv("brightness_contrast", 2, no_ac_params);
+        // The values of a preview are not the actual buffer values. The
+        // labels can wait until the view stops moving.
+        const bool draw_value_labels =
+            zoom > 40 && gl_canvas_->gpu_value_labels() && !is_preview() &&
+            gl_canvas_->get_frame_scheduler()->allow_deferrable_pass();
+        buff_prog.uniform1i("enable_value_labels",
+                            draw_value_labels ? 1 : 0);
+        if (draw_value_labels) {
+            set_value_label_uniforms(model);
+        }
+
+        gl_canvas_->glActiveTexture(GL_TEXTURE0);
+
+        buff_prog.uniform1i("sampler", 0);
+        if (game_object_->stage->contrast_enabled) {
+            buff_prog.uniform4fv(
+                "brightness_contrast", 2, auto_buffer_contrast_brightness_);
+        } else {
+            buff_prog.uniform4fv("brightness_contrast", 2, no_ac_params);
+        }
     }
 
-    int buffer_width_i  = static_cast<int>(buffer_width_f);
-    int buffer_height_i = static_cast<int>(buffer_height_f);
+    // Previews and regions are placed over their extent in the scene
+    const float content_transform[] = {content_scale_x_f,
+                                       content_scale_y_f,
+                                       content_offset_x(),
+                                       content_offset_y()};
 
-    int remaining_h = buffer_height_i;
+    program.uniform_matrix4fv("mvp", 1, GL_FALSE, mvp.data());
+    program.uniform4fv("content_transform", 1, content_transform);
+    program.uniform2f("tile_size", tile_width_, tile_height_);
 
-    float py = -buffer_height_i / 2;
-    if (buffer_height_i % 2 == 1) {
-        py -= 0.5;
+    gl_canvas_->glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    gl_canvas_->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+    // Evicted textures are restored before their stage is displayed again
+    if (!has_textures()) {
+        return;
     }
 
-    for (int ty = 0; ty < num_textures_y; ++ty) {
-        int buff_h = std::min(remaining_h, max_texture_size);
-        remaining_h -= buff_h;
+    draw_tiles(draw_difference ? difference_reference_ : nullptr,
+               mvp,
+               content_transform);
+}
+
 
-        py += buff_h / 2;
-        if (buff_h % 2 == 1) {
-            py += 0.5;
+bool Buffer::is_tile_visible(int tile_id,
+                             const mat4& mvp,
+                             const float* content_transform) const
+{
+    const GLfloat* attributes =
+        &tile_attributes_[tile_id * tile_attribute_count];
+
+    float lowest[2] = {numeric_limits<float>::max(),
+                       numeric_limits<float>::max()};
+    float upper[2]  = {numeric_limits<float>::lowest(),
+                       numeric_limits<float>::lowest()};
+
+    // Corners of the tile in clip space, as placed by the buffer shader.
+    // The projection is orthographic.
+    for (const float corner_x : {-0.5f, 0.5f}) {
+        for (const float corner_y : {-0.5f, 0.5f}) {
+            const vec4 corner(
+                (corner_x * attributes[2] + attributes[0]) *
+                        content_transform[0] +
+                    content_transform[2],
+                (corner_y * attributes[3] + attributes[1]) *
+                        content_transform[1] +
+                    content_transform[3],
+                0,
+                1);
+            const vec4 clip = mvp * corner;
+
+            lowest[0] = min(lowest[0], clip.x());
+            lowest[1] = min(lowest[1], clip.y());
+            upper[0]  = max(upper[0], clip.x());
+            upper[1]  = max(upper[1], clip.y());
         }
+    }
 
-        int remaining_w = buffer_width_i;
+    return lowest[0] <= 1.f && upper[0] >= -1.f && lowest[1] <= 1.f &&
+           upper[1] >= -1.f;
+}
+
+
+void Buffer::draw_tiles(const Buffer* reference,
+                        const mat4& mvp,
+                        const float* content_transform)
+{
+    const TextureUploader* uploader = gl_canvas_->get_texture_uploader();
+    const int num_tiles             = num_textures_x * num_textures_y;
 
-        float px = -buffer_width_i / 2;
-        if (buffer_width_i % 2 == 1) {
-            px -= 0.5;
+    if (reference != nullptr) {
+        gl_canvas_->glActiveTexture(GL_TEXTURE1);
+        gl_canvas_->glBindTexture(texture_target(), reference->buff_tex[0]);
+        gl_canvas_->glActiveTexture(GL_TEXTURE0);
+    }
+
+    if (use_texture_array_) {
+        // Tiles are only shown once their contents were uploaded. Since they
+        // are uploaded in order, the uploaded tiles come first.
+        int num_uploaded_tiles = 0;
+        while (num_uploaded_tiles < num_tiles &&
+               !uploader->is_texture_pending(buff_tex[0],
+                                             num_uploaded_tiles)) {
+            ++num_uploaded_tiles;
         }
 
-        for (int tx = 0; tx < num_textures_x; ++tx) {
-            int buff_w = std::min(remaining_w, max_texture_size);
-            remaining_w -= buff_w;
+        // Only the range between the first and last tiles in view is
+        // drawn, still in a single call, by starting the instance
+        // attributes at the first one
+        int first_tile = 0;
+        while (first_tile < num_uploaded_tiles &&
+               !is_tile_visible(first_tile, mvp, content_transform)) {
+            ++first_tile;
+        }
 
-            glBindTexture(GL_TEXTURE_2D, buff_tex[ty * num_textures_x + tx]);
+        int end_tile = num_uploaded_tiles;
+        while (end_tile > first_tile &&
+               !is_tile_visible(end_tile - 1, mvp, content_transform)) {
+            --end_tile;
+        }
 
-            mat4 tile_model;
+        if (first_tile == end_tile) {
+            return;
+        }
 
-            px += buff_w / 2;
-            if (buff_w % 2 == 1) {
-                px += 0.5;
+        const GLsizei stride = tile_attribute_count * sizeof(GLfloat);
+        const size_t first_offset =
+            static_cast<size_t>(first_tile) * stride;
+
+        gl_canvas_->glBindTexture(GL_TEXTURE_2D_ARRAY, buff_tex[0]);
+        gl_canvas_->glBindBuffer(GL_ARRAY_BUFFER, tile_vbo_);
+        gl_canvas_->glEnableVertexAttribArray(1);
+        gl_canvas_->glEnableVertexAttribArray(2);
+        gl_canvas_->glVertexAttribPointer(
+            1,
+            4,
+            GL_FLOAT,
+            GL_FALSE,
+            stride,
+            reinterpret_cast<void*>(first_offset));
+        gl_canvas_->glVertexAttribPointer(
+            2,
+            1,
+            GL_FLOAT,
+            GL_FALSE,
+            stride,
+            reinterpret_cast<void*>(first_offset + 4 * sizeof(GLfloat)));
+        gl_canvas_->glVertexAttribDivisor(1, 1);
+        gl_canvas_->glVertexAttribDivisor(2, 1);
+
+        gl_canvas_->glDrawArraysInstanced(
+            GL_TRIANGLES, 0, 6, end_tile - first_tile);
+        gl_canvas_->get_perf_overlay()->count_draw_call();
+
+        gl_canvas_->glVertexAttribDivisor(1, 0);
+        gl_canvas_->glVertexAttribDivisor(2, 0);
+        gl_canvas_->glDisableVertexAttribArray(1);
+        gl_canvas_->glDisableVertexAttribArray(2);
+    } else {
+        // Without instancing, the attributes of each tile are set as
+        // constants before drawing it
+        for (int tile_id = 0; tile_id < num_tiles; ++tile_id) {
+            if (uploader->is_texture_pending(buff_tex[tile_id]) ||
+                !is_tile_visible(tile_id, mvp, content_transform)) {
+                continue;
             }
 
-            tile_model.set_from_st(buff_w, buff_h, 1.0, px, py, 0.0f);
-            buff_prog.uniform_matrix4fv(
-                "mvp", 1, GL_FALSE, (mvp * tile_model).data());
-            buff_prog.uniform2f("buffer_dimension", buff_w, buff_h);
+            const GLfloat* attributes =
+                &tile_attributes_[tile_id * tile_attribute_count];
 
-            px += buff_w / 2;
+            if (reference != nullptr) {
+                gl_canvas_->glActiveTexture(GL_TEXTURE1);
+                gl_canvas_->glBindTexture(GL_TEXTURE_2D,
+                                          reference->buff_tex[tile_id]);
+                gl_canvas_->glActiveTexture(GL_TEXTURE0);
+            }
 
-            gl_canvas_->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-            gl_canvas_->glVertexAttribPointer(
-                0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+            gl_canvas_->glBindTexture(GL_TEXTURE_2D, buff_tex[tile_id]);
+            gl_canvas_->glVertexAttrib4fv(1, attributes);
+            gl_canvas_->glVertexAttrib1f(2, attributes[4]);
             gl_canvas_->glDrawArrays(GL_TRIANGLES, 0, 6);
+            gl_canvas_->get_perf_overlay()->count_draw_call();
         }
+    }
+}
+
 
-        py += buff_h / 2;
+void Buffer::set_value_label_uniforms(const mat4& model)
+{
+    const GLTextRenderer* text_renderer = gl_canvas_->get_text_renderer();
+
+    float glyph_rects[GLTextRenderer::label_glyph_count][4];
+    float glyph_boxes[GLTextRenderer::label_glyph_count][4];
+    text_renderer->get_label_glyphs(glyph_rects, glyph_boxes);
+
+    const float scale = BufferValues::glyph_scale(text_renderer, channels);
+    for (auto& glyph_box : glyph_boxes) {
+        glyph_box[0] *= scale;
+        glyph_box[1] *= scale;
     }
+
+    // First two columns of the rotation and transposition of the buffer,
+    // stored column major
+    const float* pose            = model.data();
+    const float label_rotation[] = {pose[0], pose[1], pose[4], pose[5]};
+
+    const array<float, 4> label_offsets =
+        BufferValues::channel_offsets(channels);
+
+    const bool integer_values = held_buffer_type(type) != BufferType::Float32 &&
+                                type != BufferType::Float16;
+
+    gl_canvas_->glActiveTexture(GL_TEXTURE1);
+    gl_canvas_->glBindTexture(GL_TEXTURE_2D, text_renderer->text_tex);
+    gl_canvas_->glActiveTexture(GL_TEXTURE0);
+
+    buff_prog.uniform1i("glyph_sampler", 1);
+    buff_prog.uniform4fv("glyph_rects",
+                         GLTextRenderer::label_glyph_count,
+                         &glyph_rects[0][0]);
+    buff_prog.uniform4fv("glyph_boxes",
+                         GLTextRenderer::label_glyph_count,
+                         &glyph_boxes[0][0]);
+    buff_prog.uniform4fv("label_rotation", 1, label_rotation);
+    buff_prog.uniform4fv("label_offsets", 1, label_offsets.data());
+    buff_prog.uniform2f("label_value_format",
+                        max_intensity(type),
+                        integer_values ? 1.f : 0.f);
 }
 
 
@@ -503,33 +1818,136 @@ float* Buffer::max_buffer_values()
 }
 
 
-const float* Buffer::auto_buffer_contrast_brightness() const
+void Buffer::prepare_tiles_update(const vector<TileRegion>& tiles)
 {
-    return auto_buffer_contrast_brightness_;
+    const bool is_histogram_complete = has_histogram_;
+
+    cancel_histogram();
+
+    size_t pixels = 0;
+    for (const auto& tile : tiles) {
+        pixels += static_cast<size_t>(tile.width) * tile.height;
+    }
+
+    if (!is_histogram_complete || buffer == nullptr ||
+        pixels > max_histogram_update_pixels) {
+        return;
+    }
+
+    for (const auto& tile : tiles) {
+        update_histogram_region(buffer,
+                                tile.x,
+                                tile.y,
+                                tile.width,
+                                tile.height,
+                                step,
+                                -1,
+                                histogram_);
+    }
+    is_histogram_updated_in_place_ = true;
 }
 
 
-void Buffer::setup_gl_buffer()
+void Buffer::update_tiles_statistics(const vector<TileRegion>& tiles)
 {
-    int buffer_width_i  = static_cast<int>(buffer_width_f);
-    int buffer_height_i = static_cast<int>(buffer_height_f);
+    if (is_histogram_updated_in_place_) {
+        for (const auto& tile : tiles) {
+            update_histogram_region(buffer,
+                                    tile.x,
+                                    tile.y,
+                                    tile.width,
+                                    tile.height,
+                                    step,
+                                    1,
+                                    histogram_);
+        }
+        is_histogram_updated_in_place_ = false;
+    } else {
+        start_histogram();
+    }
 
-    // Initialize contrast parameters
-    reset_contrast_brightness_parameters();
+    if (is_region_table_requested_) {
+        start_region_table();
+    }
 
-    // Buffer texture
-    num_textures_x = ceil(((float)buffer_width_i) / ((float)max_texture_size));
-    num_textures_y = ceil(((float)buffer_height_i) / ((float)max_texture_size));
-    int num_textures = num_textures_x * num_textures_y;
+    block_ranges_.update(buffer, tiles);
+
+    recompute_color_range();
+
+    compute_contrast_brightness_parameters();
+}
+
+
+void Buffer::update_tiles(const vector<TileRegion>& tiles)
+{
+    GLuint tex_type;
+    GLuint tex_format;
+    get_texture_format(tex_format, tex_type);
+
+    const size_t pixel_size = held_pixel_size(type, channels);
+
+    TextureUploader* uploader = gl_canvas_->get_texture_uploader();
+
+    ++contents_generation_;
+    invalidate_mipmaps();
+
+    // Evicted textures are uploaded from the updated buffer when restored
+    if (!has_textures()) {
+        update_tiles_statistics(tiles);
+        return;
+    }
+
+    for (const auto& tile : tiles) {
+        const int last_tx = (tile.x + tile.width - 1) / tile_width_;
+        const int last_ty = (tile.y + tile.height - 1) / tile_height_;
+
+        // A tile may overlap more than one texture tile
+        for (int ty = tile.y / tile_height_; ty <= last_ty; ++ty) {
+            const int y0 = std::max(tile.y, ty * tile_height_);
+            const int y1 =
+                std::min(tile.y + tile.height, (ty + 1) * tile_height_);
+
+            for (int tx = tile.x / tile_width_; tx <= last_tx; ++tx) {
+                const int x0 = std::max(tile.x, tx * tile_width_);
+                const int x1 =
+                    std::min(tile.x + tile.width, (tx + 1) * tile_width_);
+
+                const int tile_id = ty * num_textures_x + tx;
+
+                uploader->upload_directly(TextureUploader::Upload{
+                    this,
+                    buff_tex[use_texture_array_ ? 0 : tile_id],
+                    texture_target(),
+                    0,
+                    x0 - tx * tile_width_,
+                    y0 - ty * tile_height_,
+                    use_texture_array_ ? tile_id : 0,
+                    buffer,
+                    x0,
+                    y0,
+                    step,
+                    x1 - x0,
+                    y1 - y0,
+                    pixel_size,
+                    tex_format,
+                    tex_type});
+            }
+        }
+    }
+
+    update_tiles_statistics(tiles);
+}
 
-    buff_tex.resize(num_textures);
-    glGenTextures(num_textures, buff_tex.data());
 
-    GLuint tex_type   = GL_UNSIGNED_BYTE;
-    GLuint tex_format = GL_RED;
+void Buffer::get_texture_format(GLuint& tex_format, GLuint& tex_type) const
+{
+    tex_type   = GL_UNSIGNED_BYTE;
+    tex_format = GL_RED;
 
-    if (type == BufferType::Float32 || type == BufferType::Float64) {
+    if (held_buffer_type(type) == BufferType::Float32) {
         tex_type = GL_FLOAT;
+    } else if (type == BufferType::Float16) {
+        tex_type = GL_HALF_FLOAT;
     } else if (type == BufferType::UnsignedByte) {
         tex_type = GL_UNSIGNED_BYTE;
     } else if (type == BufferType::Short) {
@@ -538,6 +1956,10 @@ void Buffer::setup_gl_buffer()
         tex_type = GL_UNSIGNED_SHORT;
     } else if (type == BufferType::Int32) {
         tex_type = GL_INT;
+    } else if (type == BufferType::Int8) {
+        tex_type = GL_BYTE;
+    } else if (type == BufferType::UnsignedInt32) {
+        tex_type = GL_UNSIGNED_INT;
     }
 
     if (channels == 1) {
@@ -549,64 +1971,280 @@ void Buffer::setup_gl_buffer()
     } else if (channels == 4) {
         tex_format = GL_RGBA;
     }
+}
+
+
+GLint Buffer::get_texture_internal_format() const
+{
+    // Textures match the type and channels of their buffer. Integer buffers
+    // use normalized formats, which are sampled as the same values the driver
+    // converts them to when uploading them into float textures. 32 bit
+    // integers have no normalized format, and are converted to floats.
+    // clang-format off
+    static const GLint unsigned_byte_formats[]  = {GL_R8, GL_RG8,
+                                                   GL_RGB8, GL_RGBA8};
+    static const GLint byte_formats[]           = {GL_R8_SNORM, GL_RG8_SNORM,
+                                                   GL_RGB8_SNORM,
+                                                   GL_RGBA8_SNORM};
+    static const GLint unsigned_short_formats[] = {GL_R16, GL_RG16,
+                                                   GL_RGB16, GL_RGBA16};
+    static const GLint short_formats[]          = {GL_R16_SNORM, GL_RG16_SNORM,
+                                                   GL_RGB16_SNORM,
+                                                   GL_RGBA16_SNORM};
+    static const GLint half_formats[]           = {GL_R16F, GL_RG16F,
+                                                   GL_RGB16F, GL_RGBA16F};
+    static const GLint float_formats[]          = {GL_R32F, GL_RG32F,
+                                                   GL_RGB32F, GL_RGBA32F};
+    // clang-format on
+
+    const int format_index = std::min(std::max(channels, 1), 4) - 1;
+
+    if (type == BufferType::UnsignedByte) {
+        return unsigned_byte_formats[format_index];
+    } else if (type == BufferType::UnsignedShort) {
+        return unsigned_short_formats[format_index];
+    } else if (type == BufferType::Short) {
+        return short_formats[format_index];
+    } else if (type == BufferType::Int8) {
+        return byte_formats[format_index];
+    } else if (type == BufferType::Float16) {
+        return half_formats[format_index];
+    }
+
+    return float_formats[format_index];
+}
+
+
+GLenum Buffer::texture_target() const
+{
+    return use_texture_array_ ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+}
+
+
+void Buffer::setup_gl_buffer()
+{
+    int buffer_width_i  = static_cast<int>(buffer_width_f);
+    int buffer_height_i = static_cast<int>(buffer_height_f);
+
+    // Split the contents in as few tiles as the driver allows. They are split
+    // evenly, so that the tiles on the edges waste little texture memory.
+    const int max_texture_size = gl_canvas_->max_texture_size();
+    num_textures_x =
+        std::max((buffer_width_i + max_texture_size - 1) / max_texture_size, 1);
+    num_textures_y = std::max(
+        (buffer_height_i + max_texture_size - 1) / max_texture_size, 1);
+    tile_width_ =
+        std::max((buffer_width_i + num_textures_x - 1) / num_textures_x, 1);
+    tile_height_ =
+        std::max((buffer_height_i + num_textures_y - 1) / num_textures_y, 1);
+    const int num_tiles = num_textures_x * num_textures_y;
+
+    use_texture_array_  = num_tiles <= gl_canvas_->max_texture_layers();
+    texel_reads_failed_ = false;
+    const GLenum target = texture_target();
+
+    // Buffer texture
+    buff_tex.resize(use_texture_array_ ? 1 : num_tiles);
+    gl_canvas_->glGenTextures(static_cast<GLsizei>(buff_tex.size()),
+                              buff_tex.data());
+
+    GLuint tex_type;
+    GLuint tex_format;
+    get_texture_format(tex_format, tex_type);
+    const GLint internal_format = get_texture_internal_format();
+
+    if (use_texture_array_) {
+        gl_canvas_->glBindTexture(GL_TEXTURE_2D_ARRAY, buff_tex[0]);
+        gl_canvas_->glTexImage3D(GL_TEXTURE_2D_ARRAY,
+                                 0,
+                                 internal_format,
+                                 tile_width_,
+                                 tile_height_,
+                                 num_tiles,
+                                 0,
+                                 tex_format,
+                                 tex_type,
+                                 nullptr);
+    }
+
+    const size_t pixel_size = held_pixel_size(type, channels);
 
-    int remaining_h = buffer_height_i;
+    TextureUploader* uploader = gl_canvas_->get_texture_uploader();
 
-    glPixelStoref(GL_UNPACK_ALIGNMENT, 1);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, step);
+    tile_attributes_.clear();
+    tile_attributes_.reserve(num_tiles * tile_attribute_count);
 
     for (int ty = 0; ty < num_textures_y; ++ty) {
-        int buff_h = std::min(remaining_h, max_texture_size);
-        remaining_h -= buff_h;
+        const int tile_y = ty * tile_height_;
+        const int buff_h = std::min(tile_height_, buffer_height_i - tile_y);
 
-        int remaining_w = buffer_width_i;
         for (int tx = 0; tx < num_textures_x; ++tx) {
-            int buff_w = std::min(remaining_w, max_texture_size);
-            remaining_w -= buff_w;
-
-            int tex_id = ty * num_textures_x + tx;
-            gl_canvas_->glBindTexture(GL_TEXTURE_2D, buff_tex[tex_id]);
-
-            gl_canvas_->glPixelStorei(GL_UNPACK_SKIP_ROWS,
-                                      ty * max_texture_size);
-            gl_canvas_->glPixelStorei(GL_UNPACK_SKIP_PIXELS,
-                                      tx * max_texture_size);
-
-            gl_canvas_->glTexImage2D(GL_TEXTURE_2D,
-                                     0,
-                                     GL_RGBA32F,
-                                     buff_w,
-                                     buff_h,
-                                     0,
-                                     tex_format,
-                                     tex_type,
-                                     nullptr);
-
-            gl_canvas_->glTexSubImage2D(GL_TEXTURE_2D,
-                                        0,
-                                        0,
-                                        0,
-                                        buff_w,
-                                        buff_h,
-                                        tex_format,
-                                        tex_type,
-                                        reinterpret_cast<const GLvoid*>(buffer));
+            const int tile_x = tx * tile_width_;
+            const int buff_w = std::min(tile_width_, buffer_width_i - tile_x);
+
+            const int tile_id     = ty * num_textures_x + tx;
+            const int tile_layer  = use_texture_array_ ? tile_id : 0;
+            const GLuint tile_tex = buff_tex[use_texture_array_ ? 0 : tile_id];
+
+            // Tiles are placed relative to the center of the contents
+            tile_attributes_.push_back(tile_x + buff_w / 2.f -
+                                       buffer_width_i / 2.f);
+            tile_attributes_.push_back(tile_y + buff_h / 2.f -
+                                       buffer_height_i / 2.f);
+            tile_attributes_.push_back(static_cast<GLfloat>(buff_w));
+            tile_attributes_.push_back(static_cast<GLfloat>(buff_h));
+            tile_attributes_.push_back(static_cast<GLfloat>(tile_layer));
+
+            if (!use_texture_array_) {
+                gl_canvas_->glBindTexture(GL_TEXTURE_2D, tile_tex);
+                gl_canvas_->glTexImage2D(GL_TEXTURE_2D,
+                                         0,
+                                         internal_format,
+                                         tile_width_,
+                                         tile_height_,
+                                         0,
+                                         tex_format,
+                                         tex_type,
+                                         nullptr);
+            }
 
-            gl_canvas_->glTexParameteri(
-                GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            gl_canvas_->glTexParameteri(
-                GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            gl_canvas_->glTexParameteri(
-                GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            gl_canvas_->glTexParameteri(
-                GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            gl_canvas_->glTexParameteri(
-                GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            // The contents are uploaded over the next frames
+            uploader->enqueue(TextureUploader::Upload{this,
+                                                      tile_tex,
+                                                      target,
+                                                      0,
+                                                      0,
+                                                      0,
+                                                      tile_layer,
+                                                      buffer,
+                                                      tile_x,
+                                                      tile_y,
+                                                      step,
+                                                      buff_w,
+                                                      buff_h,
+                                                      pixel_size,
+                                                      tex_format,
+                                                      tex_type});
         }
     }
 
-    gl_canvas_->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    gl_canvas_->glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
-    gl_canvas_->glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    for (const GLuint tex : buff_tex) {
+        gl_canvas_->glBindTexture(target, tex);
+        gl_canvas_->glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        gl_canvas_->glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        gl_canvas_->glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+        gl_canvas_->glTexParameteri(
+            target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        gl_canvas_->glTexParameteri(
+            target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        gl_canvas_->glTexParameteri(
+            target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+
+    // The driver may have picked a larger format than the requested one
+    allocated_texel_bytes_ = allocated_texel_bytes(gl_canvas_, target);
+
+    // Only instanced draws read the tile attributes from a buffer
+    if (use_texture_array_) {
+        gl_canvas_->glBindBuffer(GL_ARRAY_BUFFER, tile_vbo_);
+        gl_canvas_->glBufferData(
+            GL_ARRAY_BUFFER,
+            static_cast<GLsizeiptr>(tile_attributes_.size() * sizeof(GLfloat)),
+            tile_attributes_.data(),
+            GL_STATIC_DRAW);
+    }
+}
+
+
+bool Buffer::has_pending_uploads() const
+{
+    return gl_canvas_->get_texture_uploader()->is_pending(this);
+}
+
+
+bool Buffer::has_textures() const
+{
+    return !buff_tex.empty();
+}
+
+
+int Buffer::texture_tiles() const
+{
+    return has_textures() ? num_textures_x * num_textures_y : 0;
+}
+
+
+GLuint Buffer::program_id() const
+{
+    return buff_prog.program_id();
+}
+
+
+size_t Buffer::texture_bytes() const
+{
+    if (!has_textures()) {
+        return 0;
+    }
+
+    const size_t texel_size = allocated_texel_bytes_ > 0
+                                  ? allocated_texel_bytes_
+                                  : held_pixel_size(type, channels);
+    size_t bytes = texel_size * static_cast<size_t>(tile_width_) *
+                   static_cast<size_t>(tile_height_) *
+                   static_cast<size_t>(num_textures_x * num_textures_y);
+
+    // A mip pyramid adds up to a third
+    if (mipmap_state_ != MipmapState::Outdated) {
+        bytes += bytes / 3;
+    }
+
+    return bytes;
+}
+
+
+bool Buffer::needs_update() const
+{
+    if (histogram_future_.valid() || region_table_future_.valid() ||
+        difference_state_ == StatisticsState::Reducing) {
+        return true;
+    }
+
+    if (!has_textures()) {
+        return false;
+    }
+
+    if (statistics_state_ != StatisticsState::Ready) {
+        return true;
+    }
+
+    if (mipmap_state_ == MipmapState::Outdated) {
+        return mip_level_count(tile_width_, tile_height_) > 1;
+    }
+
+    return mipmap_state_ != MipmapState::Ready;
+}
+
+
+void Buffer::release_textures()
+{
+    invalidate_mipmaps();
+
+    // The statistics are reduced again once the textures were restored
+    if (statistics_state_ == StatisticsState::Reducing) {
+        gl_canvas_->get_gpu_reducer()->cancel(this);
+        statistics_state_ = StatisticsState::Outdated;
+    }
+    gl_canvas_->get_texture_uploader()->cancel(this);
+
+    gl_canvas_->glDeleteTextures(static_cast<GLsizei>(buff_tex.size()),
+                                 buff_tex.data());
+    buff_tex.clear();
+}
+
+
+void Buffer::restore_textures()
+{
+    if (!has_textures() && buffer != nullptr) {
+        setup_gl_buffer();
+    }
 }
@@ -26,12 +26,20 @@
 #ifndef BUFFER_H_
 #define BUFFER_H_
 
+#include <atomic>
+#include <future>
 #include <sstream>
 #include <vector>
 
 #include "component.h"
+#include "ui/gpu_reducer.h"
+#include "visualization/block_ranges.h"
+#include "visualization/histogram.h"
+#include "visualization/mip_pyramid.h"
 #include "visualization/shader.h"
+#include "visualization/summed_area_table.h"
 #include "ipc/message_exchange.h"
+#include "ipc/tile_delta.h"
 
 
 class Buffer : public Component
@@ -39,8 +47,8 @@ class Buffer : public Component
   public:
     Buffer(GameObject* game_object, GLCanvas* gl_canvas);
 
-    const int max_texture_size = 2048;
-
+    // A single array texture, with one layer per tile of the contents. If
+    // array textures are not available, one texture per tile.
     std::vector<GLuint> buff_tex;
 
     static const float no_ac_params[8];
@@ -48,6 +56,19 @@ class Buffer : public Component
     float buffer_width_f;
     float buffer_height_f;
 
+    // Size of the buffer in the scene. Only differs from the size of its
+    // contents while a downsampled preview or a region of the buffer is
+    // displayed.
+    float display_width_f;
+    float display_height_f;
+
+    // Placement of the contents in the scene: position of their top left
+    // corner and size of one of their pixels, in scene pixels
+    float content_x_f;
+    float content_y_f;
+    float content_scale_x_f;
+    float content_scale_y_f;
+
     int channels;
     int step;
 
@@ -57,26 +78,175 @@ class Buffer : public Component
 
     bool transpose;
 
+    // Ranges are reset to the 0.5th and 99.5th percentiles of the values
+    // rather than to their extremes, so that outliers don't flatten the
+    // contrast
+    bool clip_outliers;
+
+    // Ranges are reset to the extremes of the blocks in view, set by
+    // set_visible_region(), rather than to those of the whole buffer. The
+    // percentiles clipping outliers are still those of the whole buffer.
+    bool visible_range_only;
+
     ~Buffer();
 
     bool buffer_update();
 
+    // Stop reading the contents in the background, and take the values of
+    // the given regions out of the histogram, before they are modified.
+    // Their statistics are found again by update_tiles().
+    void prepare_tiles_update(const std::vector<TileRegion>& tiles);
+
+    // Re-upload only the given regions of buffer to the existing textures
+    void update_tiles(const std::vector<TileRegion>& tiles);
+
+    // The textures are uploaded over several frames after buffer_update()
+    bool has_pending_uploads() const;
+
+    // The textures can be released to save GPU memory, and restored from
+    // buffer, which must still be valid
+    bool has_textures() const;
+
+    // GPU memory of the textures, from the size of the internal format the
+    // driver allocated them with where it can be queried
+    std::size_t texture_bytes() const;
+
+    // Number of tiles the contents are split in, if the textures exist
+    int texture_tiles() const;
+
+    // Linked program the buffer is drawn with, or 0
+    GLuint program_id() const;
+
+    // The mipmaps are still being built, which needs more updates
+    bool needs_update() const;
+
+    void release_textures();
+
+    void restore_textures();
+
+    // The statistics or the histogram are still being computed
+    bool has_pending_statistics() const;
+
+    // Statistics of the contents, if they were reduced on the GPU. Without
+    // GPU reductions, only the color ranges are computed, on the CPU.
+    bool get_statistics(BufferStatistics& statistics) const;
+
+    // Histogram of the contents, once it was binned in a worker thread
+    const Histogram* get_histogram() const;
+
+    /**
+     * Draw the differences between the contents and those of reference
+     * instead, whenever both have the same size and tiles, are sampled alike
+     * and were completely uploaded. Their statistics are reduced on the
+     * GPU, counting the differences whose magnitude is above threshold. A
+     * null reference draws the contents again.
+     */
+    void set_difference_reference(const Buffer* reference,
+                                  DifferenceMode mode,
+                                  float threshold);
+
+    bool shows_difference() const;
+
+    // Statistics of the differences drawn, once they were read back
+    bool get_difference_statistics(DifferenceStatistics& statistics) const;
+
+    /**
+     * Region of the scene in view. When only the visible values are
+     * considered, the ranges are reset from the blocks it overlaps, and
+     * again once it overlaps other blocks.
+     *
+     * @return true if the ranges were reset
+     */
+    bool set_visible_region(float x0, float y0, float x1, float y1);
+
+    enum class RegionState { Ready, Pending, Unavailable };
+
+    /**
+     * Statistics of the contents from (x0, y0) to (x1, y1) of the scene,
+     * ends excluded. The first query tabulates the summed areas of the
+     * contents in the background, and from then on whenever they change,
+     * unless the tables would take more than max_table_bytes. The regions
+     * are then queried in constant time.
+     */
+    RegionState get_region_statistics(float x0,
+                                      float y0,
+                                      float x1,
+                                      float y1,
+                                      std::size_t max_table_bytes,
+                                      RegionStatistics& statistics);
+
+    // Stop reading the contents in the background, before they are modified
+    // or freed
+    void cancel_histogram();
+
+    // Lowest and upper values of all channels, found in a single pass. When
+    // they are reduced on the GPU, they are only updated once the contents
+    // were uploaded and the results were read back.
+    void recompute_color_range();
+
     void recompute_min_color_values();
 
     void recompute_max_color_values();
 
+    // Ranges already computed from the current contents, e.g. while they
+    // were decoded, which the next CPU computation of both ranges takes
+    // instead. Null ranges drop them, once the contents changed.
+    void set_color_range_hint(const float* lowest, const float* upper);
+
     void reset_contrast_brightness_parameters();
 
     void compute_contrast_brightness_parameters();
 
-    int sub_texture_id_at_coord(int x, int y);
+    // First channel of the pixel (x, y) of the contents, as it is sampled
+    // from its texture
+    float sampled_value_at(int x, int y) const;
+
+    // First channel of values[pos], laid out like the contents, as it is
+    // sampled from its texture
+    float sampled_value(const uint8_t* values, int pos) const;
+
+    // Once the contents were uploaded, and everything reduced from them was
+    // computed, they can be dropped to save memory. The textures then hold
+    // their only copy, so they must not be released anymore, and pixel
+    // values are read back from them.
+    bool can_drop_contents();
+
+    void drop_contents();
+
+    bool has_contents() const;
+
+    /**
+     * Read the region of width x height pixels at (x, y) of the contents back
+     * from the textures, laid out like buffer with a step of width. It's
+     * rendered into a framebuffer to be read, which not all texture formats
+     * support.
+     *
+     * @return false if the texels couldn't be read
+     */
+    bool read_texels(int x,
+                     int y,
+                     int width,
+                     int height,
+                     std::vector<uint8_t>& texels);
 
     void set_pixel_layout(const std::string& pixel_layout);
 
-    const char* get_pixel_layout() const;
+    // Inline, so that what only reads the contents of buffers (e.g. the
+    // exporters) doesn't depend on their GL resources
+    const char* get_pixel_layout() const
+    {
+        return pixel_layout_;
+    }
+
+    bool is_preview() const;
+
+    // Changes whenever the contents do, so that what is derived from them
+    // can be cached
+    unsigned int contents_generation() const;
 
-    float tile_coord_x(int x);
-    float tile_coord_y(int y);
+    // Offset from the center of the scene to the center of the contents
+    float content_offset_x() const;
+    float content_offset_y() const;
 
     bool initialize();
 
@@ -91,7 +261,10 @@ class Buffer : public Component
 
     float* max_buffer_values();
 
-    const float* auto_buffer_contrast_brightness() const;
+    const float* auto_buffer_contrast_brightness() const
+    {
+        return auto_buffer_contrast_brightness_;
+    }
 
     void set_min_buffer_values();
     void set_max_buffer_values();
@@ -103,10 +276,78 @@ class Buffer : public Component
   private:
     void create_shader_program();
 
+    // Bind the tile textures, and those of the reference if it is set, and
+    // draw the tiles uploaded so far which are in view
+    void draw_tiles(const Buffer* reference,
+                    const mat4& mvp,
+                    const float* content_transform);
+
+    // Some of the tile is within the clip space of mvp
+    bool is_tile_visible(int tile_id,
+                         const mat4& mvp,
+                         const float* content_transform) const;
+
+    // Differences shown at full intensity, from their statistics once they
+    // were reduced
+    float difference_range() const;
+
+    void update_difference_statistics();
+
+    // The buffer shader draws the pixel values from the texels when zoomed
+    // in, if the labels aren't formatted on the CPU
+    void set_value_label_uniforms(const mat4& model);
+
     void setup_gl_buffer();
 
+    GLenum texture_target() const;
+
+    void get_texture_format(GLuint& tex_format, GLuint& tex_type) const;
+
+    GLint get_texture_internal_format() const;
+
+    void update_mipmaps();
+
+    void start_mipmap_reduction(MipReduction reduction);
+
+    void upload_mipmaps();
+
+    // Drop the mipmaps, e.g. once the contents changed
+    void invalidate_mipmaps();
+
     void update_object_pose();
 
+    // Reset the given ranges, from the percentiles, the statistics reduced
+    // on the GPU or the CPU, whichever applies
+    void request_color_range(bool reset_lowest, bool reset_upper);
+
+    // Start reducing the statistics on the GPU, for the ranges to reset.
+    // False if they must be computed on the CPU instead.
+    bool request_gpu_statistics(bool reset_lowest, bool reset_upper);
+
+    void update_statistics();
+
+    void set_statistics(BufferStatistics statistics);
+
+    // Reset the ranges of the pending request
+    void set_color_range(const float* lowest, const float* upper);
+
+    void start_histogram();
+
+    void update_histogram();
+
+    void set_percentile_range();
+
+    // Statistics of the updated tiles, instead of the whole contents
+    void update_tiles_statistics(const std::vector<TileRegion>& tiles);
+
+    // Merge the ranges of the blocks in view, or of all blocks, which are
+    // found first if the contents are held. False if they can't be.
+    bool get_block_range(float lowest[4], float upper[4]);
+
+    void start_region_table();
+
+    void update_region_table();
+
     char pixel_layout_[4] = {'r', 'g', 'b', 'a'};
 
     float min_buffer_values_[4];
@@ -116,7 +357,85 @@ class Buffer : public Component
     float angle_ = 0.f;
 
     ShaderProgram buff_prog;
+    ShaderProgram diff_prog;
     GLuint vbo;
+
+    // Tiles all have the same size, so that they can be layers of an array
+    // texture, and are all drawn at once
+    int tile_width_;
+    int tile_height_;
+    bool use_texture_array_;
+
+    // The format of the textures can't be read through a framebuffer
+    bool texel_reads_failed_;
+
+    // Size of the texels as allocated by the driver, or 0 if unknown
+    std::size_t allocated_texel_bytes_;
+
+    unsigned int contents_generation_;
+
+    // Per tile: center and size in the contents, and layer
+    std::vector<GLfloat> tile_attributes_;
+    GLuint tile_vbo_;
+
+    // The mipmaps are reduced once the contents were uploaded: the first
+    // level right away, since it reads the buffer, and the following ones in
+    // a worker thread. They are then uploaded like the contents.
+    enum class MipmapState { Outdated, Reducing, Uploading, Ready };
+
+    MipmapState mipmap_state_;
+    MipReduction mipmap_reduction_;
+    std::future<std::vector<std::vector<MipLevel>>> mip_levels_future_;
+    // Levels of each tile, from level 1, kept until they were uploaded
+    std::vector<std::vector<MipLevel>> mip_levels_;
+
+    // The statistics are reduced on the GPU from the uploaded contents, and
+    // the ranges they reset are kept until they are read back
+    enum class StatisticsState { Ready, Outdated, Reducing };
+
+    StatisticsState statistics_state_;
+    bool reset_lowest_pending_;
+    bool reset_upper_pending_;
+    bool has_statistics_;
+    BufferStatistics statistics_;
+
+    // The differences with the reference are reduced from the generations
+    // of both contents they were last reduced from, once they change
+    const Buffer* difference_reference_;
+    DifferenceMode difference_mode_;
+    float difference_threshold_;
+    StatisticsState difference_state_;
+    unsigned int difference_generation_;
+    unsigned int reference_generation_;
+    bool has_difference_statistics_;
+    DifferenceStatistics difference_statistics_;
+
+    bool has_color_range_hint_;
+    float color_range_hint_[8];
+
+    // Kept up to date as tiles are updated, once found. The visible region
+    // is in pixels of the contents.
+    BlockRanges block_ranges_;
+    bool has_visible_region_;
+    int visible_region_[4];
+
+    // The worker binning the histogram reads buffer, so it is stopped
+    // before buffer changes
+    std::future<Histogram> histogram_future_;
+    std::atomic<bool> histogram_cancelled_;
+    bool has_histogram_;
+    Histogram histogram_;
+
+    // The values of the tiles being updated were taken out of histogram_
+    bool is_histogram_updated_in_place_;
+
+    // Likewise for the worker tabulating the summed areas, which only runs
+    // once a region was queried
+    std::future<SummedAreaTable> region_table_future_;
+    std::atomic<bool> region_table_cancelled_;
+    bool is_region_table_requested_;
+    bool has_region_table_;
+    SummedAreaTable region_table_;
 };
 
 #endif // BUFFER_H_
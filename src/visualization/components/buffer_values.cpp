@@ -23,7 +23,10 @@
  * IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <vector>
 
 #include <QFontMetrics>
 
@@ -32,8 +35,11 @@
 #include "buffer.h"
 #include "camera.h"
 #include "math/assorted.h"
+#include "ui/frame_scheduler.h"
+#include "ui/perf_overlay.h"
 #include "visualization/game_object.h"
 #include "visualization/stage.h"
+#include "visualization/value_labels.h"
 
 
 using namespace std;
@@ -56,60 +62,83 @@ int BufferValues::render_index() const
 }
 
 
-inline void pix2str(const BufferType& type,
-                    const uint8_t* buffer,
-                    const int& pos,
-                    const int& channel,
-                    const int label_length,
-                    char* pix_label)
+array<float, 4> BufferValues::channel_offsets(int channels)
 {
-    if (type == BufferType::Float32 ||
-        type == BufferType::Float64) {
-        float fpix = reinterpret_cast<const float*>(buffer)[pos + channel];
-        snprintf(pix_label, label_length, "%.3f", fpix);
-        if (strlen(pix_label) > 7)
-            snprintf(pix_label, label_length, "%.3e", fpix);
-    } else if (type == BufferType::UnsignedByte) {
-        snprintf(pix_label, label_length, "%d", buffer[pos + channel]);
-    } else if (type == BufferType::Short) {
-        short fpix = reinterpret_cast<const short*>(buffer)[pos + channel];
-        snprintf(pix_label, label_length, "%d", fpix);
-    } else if (type == BufferType::UnsignedShort) {
-        unsigned short fpix =
-            reinterpret_cast<const unsigned short*>(buffer)[pos + channel];
-        snprintf(pix_label, label_length, "%d", fpix);
-    } else if (type == BufferType::Int32) {
-        int fpix = reinterpret_cast<const int*>(buffer)[pos + channel];
-        snprintf(pix_label, label_length, "%d", fpix);
-        if (strlen(pix_label) > 7)
-            snprintf(pix_label, label_length, "%.3e", static_cast<float>(fpix));
+    // Offset for vertical channel position to account for padding
+    array<float, 4> recenter_factors = {0.f, 0.f, 0.f, 0.f};
+
+    if (channels == 2) {
+        float rfUp       = padding / 3.0 / channels;
+        recenter_factors = {rfUp, -rfUp, 0.f, 0.f};
+    } else if (channels == 3) {
+        float rfUp       = padding / 2.0 / channels;
+        recenter_factors = {rfUp, 0.f, -rfUp, 0.f};
+    } else if (channels == 4) {
+        float rfUp       = 3.f * padding / 5.f / channels;
+        float rfDown     = padding / 5.f / channels;
+        recenter_factors = {rfUp, rfDown, -rfDown, -rfUp};
     }
+
+    array<float, 4> offsets = {0.f, 0.f, 0.f, 0.f};
+    for (int c = 0; c < channels; ++c) {
+        offsets[c] =
+            (0.5f * (channels - 1) - c) / channels - recenter_factors[c];
+    }
+
+    return offsets;
+}
+
+
+float BufferValues::glyph_scale(const GLTextRenderer* text_renderer,
+                                int channels)
+{
+    // The longest labels are in scientific notation
+    const char longest_label[] = "-0.000e+00";
+
+    float boxW = 0, boxH = 0;
+    for (auto p = reinterpret_cast<const unsigned char*>(longest_label); *p;
+         p++) {
+        boxW += text_renderer->text_texture_advances[*p][0];
+        boxH = max(boxH, (float)text_renderer->text_texture_sizes[*p][1]);
+    }
+
+    float paddingScale = 1.f / (1.f - 2.f * padding);
+    return 1.f / (max(boxW, boxH) * paddingScale * channels);
 }
 
 
 void BufferValues::draw(const mat4& projection, const mat4& view_inv)
 {
-    GameObject* cam_obj = game_object_->stage->get_game_object("camera");
-    Camera* camera      = cam_obj->get_component<Camera>("camera_component");
+    Camera* camera = game_object_->stage->get_camera_component();
     float zoom          = camera->compute_zoom();
 
-    if (zoom > 40) {
-        mat4 buffer_pose = game_object_->get_pose();
+    Buffer* buffer_component = game_object_->stage->get_buffer_component();
+
+    // The values of a preview are not the actual buffer values. The buffer
+    // shader may draw them instead. They are left out of the frames drawn
+    // while the view moves, if these take too long.
+    if (zoom > 40 && !buffer_component->is_preview() &&
+        !gl_canvas_->gpu_value_labels() &&
+        gl_canvas_->get_frame_scheduler()->allow_deferrable_pass()) {
+        const mat4& buffer_pose = game_object_->get_pose();
+        const mat4 view_projection = projection * view_inv;
 
-        Buffer* buffer_component =
-            game_object_->get_component<Buffer>("buffer_component");
         float buffer_width_f    = buffer_component->buffer_width_f;
         float buffer_height_f   = buffer_component->buffer_height_f;
-        int step                = buffer_component->step;
         int channels            = buffer_component->channels;
-        BufferType type = buffer_component->type;
-        const uint8_t* buffer         = buffer_component->buffer;
+
+        // Regions of a buffer may not be centered in the scene
+        float offset_x = buffer_component->content_offset_x();
+        float offset_y = buffer_component->content_offset_y();
 
         vec4 tl_ndc(-1, 1, 0, 1);
         vec4 br_ndc(1, -1, 0, 1);
-        mat4 vp_inv = (projection * view_inv * buffer_pose).inv();
+        const mat4 vp_inv = game_object_->get_pose_inverse() *
+                            camera->get_view_projection_inverse();
         vec4 tl     = vp_inv * tl_ndc;
         vec4 br     = vp_inv * br_ndc;
+        tl.x() -= offset_x, tl.y() -= offset_y;
+        br.x() -= offset_x, br.y() -= offset_y;
 
         // Since the clip ROI may be rotated, we need to re-compute TL and BR
         // from their Xs and Ys
@@ -136,104 +165,159 @@ void BufferValues::draw(const mat4& projection, const mat4& view_inv)
         int pos_center_x = -buffer_width_f / 2;
         int pos_center_y = -buffer_height_f / 2;
 
-        const int label_length = 30;
-        char pix_label[label_length];
-
-        int pos;
-        float y_off;
-
-        // Offset for vertical channel position to account for padding
-        array<float, 4> recenter_factors;
-
-        if (channels == 1) {
-            recenter_factors = {0.f, 0.f, 0.f, 0.f};
-        } else if (channels == 2) {
-            float rfUp       = padding / 3.0 / channels;
-            recenter_factors = {rfUp, -rfUp, 0.f, 0.f};
-        } else if (channels == 3) {
-            float rfUp       = padding / 2.0 / channels;
-            recenter_factors = {rfUp, 0.f, -rfUp, 0.f};
-        } else if (channels == 4) {
-            float rfUp       = 3.f * padding / 5.f / channels;
-            float rfDown     = padding / 5.f / channels;
-            recenter_factors = {rfUp, rfDown, -rfDown, -rfUp};
+        const array<float, 4> y_offsets = channel_offsets(channels);
+
+        const int first_x = lower_x - pos_center_x;
+        const int last_x  = upper_x - pos_center_x;
+        const int first_y = lower_y - pos_center_y;
+        const int last_y  = upper_y - pos_center_y;
+
+        if (first_x >= last_x || first_y >= last_y ||
+            !update_label_cache(
+                first_x, first_y, last_x - first_x, last_y - first_y)) {
+            return;
         }
 
-        for (int y = lower_y - pos_center_y; y < upper_y - pos_center_y; ++y) {
-            for (int x = lower_x - pos_center_x; x < upper_x - pos_center_x;
-                 ++x) {
-                pos = (y * step + x) * channels;
+        // The glyphs of all labels are drawn at once
+        glyph_vertices_.clear();
+
+        for (int y = first_y; y < last_y; ++y) {
+            for (int x = first_x; x < last_x; ++x) {
+                const size_t label_pixel =
+                    static_cast<size_t>(y - first_y) *
+                        static_cast<size_t>(last_x - first_x) +
+                    static_cast<size_t>(x - first_x);
+
+                const float buff_value = label_values_[label_pixel];
 
                 for (int c = 0; c < channels; ++c) {
-                    y_off = (0.5f * (channels - 1) - c) / channels -
-                            recenter_factors[c];
-
-                    pix2str(type, buffer, pos, c, label_length, pix_label);
-                    draw_text(projection,
-                              view_inv,
-                              buffer_pose,
-                              pix_label,
-                              x + pos_center_x,
-                              y + pos_center_y,
-                              y_off,
-                              channels);
+                    append_text(buffer_pose,
+                                labels_[label_pixel * channels + c].text,
+                                x + pos_center_x + offset_x,
+                                y + pos_center_y + offset_y,
+                                y_offsets[c],
+                                channels,
+                                buff_value);
                 }
             }
         }
+
+        draw_glyphs(view_projection);
     }
 }
 
 
-void BufferValues::draw_text(const mat4& projection,
-                             const mat4& view_inv,
-                             const mat4& buffer_pose,
-                             const char* text,
-                             float x,
-                             float y,
-                             float y_offset,
-                             float channels)
+bool BufferValues::update_label_cache(int x, int y, int width, int height)
 {
-    const GLTextRenderer* text_renderer = gl_canvas_->get_text_renderer();
+    Buffer* buffer_component = game_object_->stage->get_buffer_component();
 
-    Buffer* buffer_component =
-        game_object_->get_component<Buffer>("buffer_component");
+    const int channels            = buffer_component->channels;
+    const unsigned int generation = buffer_component->contents_generation();
 
-    const float* auto_buffer_contrast_brightness;
+    // Labels formatted from other contents are discarded
+    if (generation != labels_generation_ || channels != labels_channels_) {
+        labels_width_      = 0;
+        labels_height_     = 0;
+        labels_generation_ = generation;
+        labels_channels_   = channels;
+    }
 
-    if (game_object_->stage->contrast_enabled) {
-        auto_buffer_contrast_brightness =
-            buffer_component->auto_buffer_contrast_brightness();
-    } else {
-        auto_buffer_contrast_brightness = Buffer::no_ac_params;
+    if (x == labels_x_ && y == labels_y_ && width == labels_width_ &&
+        height == labels_height_) {
+        return true;
     }
 
-    text_renderer->text_prog.use();
-    gl_canvas_->glEnableVertexAttribArray(0);
-    gl_canvas_->glBindBuffer(GL_ARRAY_BUFFER, text_renderer->text_vbo);
-    gl_canvas_->glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    const auto is_cached = [this](int pixel_x, int pixel_y) {
+        return pixel_x >= labels_x_ && pixel_x < labels_x_ + labels_width_ &&
+               pixel_y >= labels_y_ && pixel_y < labels_y_ + labels_height_;
+    };
+
+    const bool has_new_pixels =
+        !is_cached(x, y) || !is_cached(x + width - 1, y + height - 1);
+
+    // Without the contents, the visible pixels are read back from the
+    // textures
+    const uint8_t* values = buffer_component->buffer;
+    int values_x          = 0;
+    int values_y          = 0;
+    int values_step       = buffer_component->step;
+
+    vector<uint8_t> texels;
+    if (has_new_pixels && values == nullptr) {
+        if (!buffer_component->read_texels(x, y, width, height, texels)) {
+            return false;
+        }
 
-    gl_canvas_->glActiveTexture(GL_TEXTURE0);
-    GLuint buff_tex = buffer_component->sub_texture_id_at_coord(
-        x + buffer_component->buffer_width_f / 2.f,
-        y + buffer_component->buffer_height_f / 2.f);
-    glBindTexture(GL_TEXTURE_2D, buff_tex);
-    text_renderer->text_prog.uniform1i("buff_sampler", 0);
+        values      = texels.data();
+        values_x    = x;
+        values_y    = y;
+        values_step = width;
+    }
 
-    gl_canvas_->glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, text_renderer->text_tex);
-    text_renderer->text_prog.uniform1i("text_sampler", 1);
+    const size_t num_pixels =
+        static_cast<size_t>(width) * static_cast<size_t>(height);
+    next_labels_.resize(num_pixels * channels);
+    next_label_values_.resize(num_pixels);
+
+    for (int pixel_y = y; pixel_y < y + height; ++pixel_y) {
+        for (int pixel_x = x; pixel_x < x + width; ++pixel_x) {
+            const size_t label_pixel =
+                static_cast<size_t>(pixel_y - y) * static_cast<size_t>(width) +
+                static_cast<size_t>(pixel_x - x);
+
+            if (is_cached(pixel_x, pixel_y)) {
+                const size_t cached_pixel =
+                    static_cast<size_t>(pixel_y - labels_y_) *
+                        static_cast<size_t>(labels_width_) +
+                    static_cast<size_t>(pixel_x - labels_x_);
+
+                next_label_values_[label_pixel] = label_values_[cached_pixel];
+                copy_n(&labels_[cached_pixel * channels],
+                       channels,
+                       &next_labels_[label_pixel * channels]);
+                continue;
+            }
 
-    text_renderer->text_prog.uniform_matrix4fv(
-        "mvp", 1, GL_FALSE, (projection * view_inv).data());
-    text_renderer->text_prog.uniform2f(
-        "pix_coord",
-        buffer_component->tile_coord_x(x +
-                                       buffer_component->buffer_width_f / 2.f),
-        buffer_component->tile_coord_y(y + buffer_component->buffer_height_f /
-                                               2.f));
+            const int pos = ((pixel_y - values_y) * values_step + pixel_x -
+                             values_x) *
+                            channels;
 
-    text_renderer->text_prog.uniform4fv(
-        "brightness_contrast", 2, auto_buffer_contrast_brightness);
+            next_label_values_[label_pixel] =
+                buffer_component->sampled_value(values, pos);
+
+            for (int c = 0; c < channels; ++c) {
+                pix2str(buffer_component->type,
+                        values,
+                        pos,
+                        c,
+                        label_length,
+                        next_labels_[label_pixel * channels + c].text);
+            }
+        }
+    }
+
+    labels_.swap(next_labels_);
+    label_values_.swap(next_label_values_);
+    labels_x_      = x;
+    labels_y_      = y;
+    labels_width_  = width;
+    labels_height_ = height;
+
+    return true;
+}
+
+
+void BufferValues::append_text(const mat4& buffer_pose,
+                               const char* text,
+                               float x,
+                               float y,
+                               float y_offset,
+                               float channels,
+                               float buff_value)
+{
+    const GLTextRenderer* text_renderer = gl_canvas_->get_text_renderer();
+
+    Buffer* buffer_component = game_object_->stage->get_buffer_component();
 
     // Compute text box size
     float boxW = 0, boxH = 0;
@@ -287,19 +371,21 @@ void BufferValues::draw_text(const mat4& projection,
             ((float)tex_hei - 1.0f) / text_renderer->text_texture_height;
 
         /*
-         * box format: <pixel coord x, pixel coord y, texture coord x, texture
-         * coord y>
+         * vertex format: <pixel coord x, pixel coord y, texture coord x,
+         * texture coord y, buffer value>, two triangles per glyph
          */
-        GLfloat box[4][4] = {
-            {x2, y2, tex_lower_x, tex_lower_y},
-            {x2 + w, y2, tex_upper_x, tex_lower_y},
-            {x2, y2 + h, tex_lower_x, tex_upper_y},
-            {x2 + w, y2 + h, tex_upper_x, tex_upper_y},
+        const GLfloat quad[6][glyph_vertex_size] = {
+            {x2, y2, tex_lower_x, tex_lower_y, buff_value},
+            {x2 + w, y2, tex_upper_x, tex_lower_y, buff_value},
+            {x2, y2 + h, tex_lower_x, tex_upper_y, buff_value},
+            {x2, y2 + h, tex_lower_x, tex_upper_y, buff_value},
+            {x2 + w, y2, tex_upper_x, tex_lower_y, buff_value},
+            {x2 + w, y2 + h, tex_upper_x, tex_upper_y, buff_value},
         };
 
-        gl_canvas_->glBufferData(
-            GL_ARRAY_BUFFER, sizeof box, box, GL_DYNAMIC_DRAW);
-        gl_canvas_->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glyph_vertices_.insert(glyph_vertices_.end(),
+                               &quad[0][0],
+                               &quad[0][0] + 6 * glyph_vertex_size);
 
         vec4 char_step_direction(
             text_renderer->text_texture_advances[*p][0] * sx,
@@ -311,3 +397,62 @@ void BufferValues::draw_text(const mat4& projection,
         y += char_step_direction.y();
     }
 }
+
+
+void BufferValues::draw_glyphs(const mat4& view_projection)
+{
+    if (glyph_vertices_.empty()) {
+        return;
+    }
+
+    const GLTextRenderer* text_renderer = gl_canvas_->get_text_renderer();
+
+    Buffer* buffer_component = game_object_->stage->get_buffer_component();
+
+    const float* auto_buffer_contrast_brightness;
+
+    if (game_object_->stage->contrast_enabled) {
+        auto_buffer_contrast_brightness =
+            buffer_component->auto_buffer_contrast_brightness();
+    } else {
+        auto_buffer_contrast_brightness = Buffer::no_ac_params;
+    }
+
+    text_renderer->text_prog.use();
+
+    const GLsizei stride = glyph_vertex_size * sizeof(GLfloat);
+
+    gl_canvas_->glBindBuffer(GL_ARRAY_BUFFER, text_renderer->text_vbo);
+    gl_canvas_->glBufferData(GL_ARRAY_BUFFER,
+                             glyph_vertices_.size() * sizeof(GLfloat),
+                             glyph_vertices_.data(),
+                             GL_STREAM_DRAW);
+    gl_canvas_->glEnableVertexAttribArray(0);
+    gl_canvas_->glEnableVertexAttribArray(1);
+    gl_canvas_->glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, 0);
+    gl_canvas_->glVertexAttribPointer(
+        1,
+        1,
+        GL_FLOAT,
+        GL_FALSE,
+        stride,
+        reinterpret_cast<void*>(4 * sizeof(GLfloat)));
+
+    gl_canvas_->glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, text_renderer->text_tex);
+    text_renderer->text_prog.uniform1i("text_sampler", 0);
+
+    text_renderer->text_prog.uniform_matrix4fv(
+        "mvp", 1, GL_FALSE, view_projection.data());
+
+    text_renderer->text_prog.uniform4fv(
+        "brightness_contrast", 2, auto_buffer_contrast_brightness);
+
+    gl_canvas_->glDrawArrays(
+        GL_TRIANGLES,
+        0,
+        static_cast<GLsizei>(glyph_vertices_.size() / glyph_vertex_size));
+    gl_canvas_->get_perf_overlay()->count_draw_call();
+
+    gl_canvas_->glDisableVertexAttribArray(1);
+}
@@ -26,7 +26,9 @@
 #ifndef BUFFER_VALUES_H_
 #define BUFFER_VALUES_H_
 
+#include <array>
 #include <iostream>
+#include <vector>
 
 #include <QFont>
 
@@ -49,20 +51,63 @@ class BufferValues : public Component
 
     virtual void draw(const mat4& projection, const mat4& view_inv);
 
+    // Vertical offset of the label of each channel from the pixel center
+    static std::array<float, 4> channel_offsets(int channels);
+
+    // Scale from font pixels to the scene, which fits the longest labels in
+    // the pixels
+    static float glyph_scale(const GLTextRenderer* text_renderer,
+                             int channels);
+
   private:
     float text_pixel_scale         = 1.0;
     static float constexpr padding = 0.125f; // Must be smaller than 0.5
 
+    // Floats per glyph vertex: position, atlas coordinates and buffer value
+    static constexpr int glyph_vertex_size = 5;
+
+    // Vertices of the glyphs of all visible labels, reused across frames
+    std::vector<GLfloat> glyph_vertices_;
+
+    // Longest formatted label, including its terminator
+    static constexpr int label_length = 16;
+
+    struct Label
+    {
+        char text[label_length];
+    };
+
+    // Labels of the region of the contents drawn last, for each channel,
+    // along with the values setting the color of their text. Only pixels
+    // coming into view, or whose contents changed, are formatted again.
+    unsigned int labels_generation_ = 0;
+    int labels_channels_            = 0;
+    int labels_x_                   = 0;
+    int labels_y_                   = 0;
+    int labels_width_               = 0;
+    int labels_height_              = 0;
+    std::vector<Label> labels_;
+    std::vector<float> label_values_;
+    std::vector<Label> next_labels_;
+    std::vector<float> next_label_values_;
+
     void generate_glyphs_texture();
 
-    void draw_text(const mat4& projection,
-                   const mat4& view_inv,
-                   const mat4& buffer_pose,
-                   const char* text,
-                   float x,
-                   float y,
-                   float y_offset,
-                   float channels);
+    // Format the labels of the width x height pixels at x, y of the contents
+    // which aren't cached yet; false if their values couldn't be read
+    bool update_label_cache(int x, int y, int width, int height);
+
+    // Add the glyphs of text, labelling the pixel at x, y, to the batch
+    void append_text(const mat4& buffer_pose,
+                     const char* text,
+                     float x,
+                     float y,
+                     float y_offset,
+                     float channels,
+                     float buff_value);
+
+    // Draw the batched glyphs in a single draw call
+    void draw_glyphs(const mat4& view_projection);
 };
 
 #endif // BUFFER_VALUES_H_
@@ -69,18 +69,43 @@ Camera& Camera::operator=(const Camera& cam)
 
 void Camera::window_resized(int w, int h)
 {
-    projection.set_ortho_projection(w / 2.0, h / 2.0, -1.0f, 1.0f);
+    set_ortho_projection(w / 2.0, h / 2.0);
     canvas_width_  = w;
     canvas_height_ = h;
 }
 
 
+const mat4& Camera::get_projection() const
+{
+    return projection_;
+}
+
+
+void Camera::set_ortho_projection(float right, float top)
+{
+    projection_.set_ortho_projection(right, top, -1.0f, 1.0f);
+    view_projection_outdated_ = true;
+}
+
+
+const mat4& Camera::get_view_projection_inverse()
+{
+    if (view_projection_outdated_) {
+        view_projection_inverse_ =
+            game_object_->get_pose() * projection_.inv();
+        view_projection_outdated_ = false;
+    }
+
+    return view_projection_inverse_;
+}
+
+
 void Camera::scroll_callback(float delta)
 {
     float mouse_x = gl_canvas_->mouse_x();
     float mouse_y = gl_canvas_->mouse_y();
-    float win_w   = gl_canvas_->width();
-    float win_h   = gl_canvas_->height();
+    float win_w   = gl_canvas_->view_width();
+    float win_h   = gl_canvas_->view_height();
 
     vec4 mouse_pos_ndc(2.0 * (mouse_x - win_w / 2) / win_w,
                        -2.0 * (mouse_y - win_h / 2) / win_h,
@@ -112,13 +137,14 @@ void Camera::update_object_pose()
         // clang-format on
 
         game_object_->set_pose(pose);
+        view_projection_outdated_ = true;
     }
 }
 
 
 bool Camera::post_initialize()
 {
-    window_resized(gl_canvas_->width(), gl_canvas_->height());
+    window_resized(gl_canvas_->view_width(), gl_canvas_->view_height());
     set_initial_zoom();
     update_object_pose();
 
@@ -201,7 +227,7 @@ EventProcessCode Camera::key_press_event(int)
 
 void Camera::scale_at(const vec4& center_ndc, float delta)
 {
-    mat4 vp_inv = game_object_->get_pose() * projection.inv();
+    const mat4 vp_inv = get_view_projection_inverse();
 
     float delta_zoom = std::pow(zoom_factor, -delta);
 
@@ -236,11 +262,11 @@ void Camera::scale_at(const vec4& center_ndc, float delta)
 
 void Camera::set_initial_zoom()
 {
-    GameObject* buffer_obj = game_object_->stage->get_game_object("buffer");
-    Buffer* buff = buffer_obj->get_component<Buffer>("buffer_component");
+    GameObject* buffer_obj = game_object_->stage->get_buffer_object();
+    Buffer* buff           = game_object_->stage->get_buffer_component();
 
     vec4 buf_dim = buffer_obj->get_pose() *
-                   vec4(buff->buffer_width_f, buff->buffer_height_f, 0, 1);
+                   vec4(buff->display_width_f, buff->display_height_f, 0, 1);
 
     buf_dim.x() = std::abs(buf_dim.x());
     buf_dim.y() = std::abs(buf_dim.y());
@@ -286,10 +312,9 @@ float Camera::compute_zoom()
 
 void Camera::move_to(float x, float y)
 {
-    GameObject* buffer_obj = game_object_->stage->get_game_object("buffer");
-
-    Buffer* buff = buffer_obj->get_component<Buffer>("buffer_component");
-    vec4 buf_dim = vec4(buff->buffer_width_f, buff->buffer_height_f, 0, 1);
+    GameObject* buffer_obj = game_object_->stage->get_buffer_object();
+    Buffer* buff           = game_object_->stage->get_buffer_component();
+    vec4 buf_dim = vec4(buff->display_width_f, buff->display_height_f, 0, 1);
     vec4 centered_coord = buf_dim * 0.5f - vec4(x, y, 0, 0);
 
     // Recompute zoom matrix to discard its internal translation
@@ -306,15 +331,27 @@ void Camera::move_to(float x, float y)
 }
 
 
-vec4 Camera::get_position()
+void Camera::set_view(float zoom, float x, float y)
 {
-    GameObject* buffer_obj = game_object_->stage->get_game_object("buffer");
+    zoom_power_ = std::log(zoom) / std::log(zoom_factor);
+    scale_      = mat4::scale(vec4(1.f / zoom, 1.f / zoom, 1.0, 1.0));
+
+    camera_pos_x_ = -zoom * x;
+    camera_pos_y_ = -zoom * y;
 
-    Buffer* buff = buffer_obj->get_component<Buffer>("buffer_component");
-    vec4 buf_dim = vec4(buff->buffer_width_f, buff->buffer_height_f, 0, 1);
+    update_object_pose();
+}
+
+
+vec4 Camera::get_position()
+{
+    GameObject* buffer_obj = game_object_->stage->get_buffer_object();
+    Buffer* buff           = game_object_->stage->get_buffer_component();
+    vec4 buf_dim = vec4(buff->display_width_f, buff->display_height_f, 0, 1);
     vec4 pos_vec(camera_pos_x_, camera_pos_y_, 0, 1);
 
-    return (buf_dim * 0.5f) - buffer_obj->get_pose().inv() * scale_ * pos_vec;
+    return (buf_dim * 0.5f) -
+           buffer_obj->get_pose_inverse() * scale_ * pos_vec;
 }
 
 
@@ -21,7 +21,6 @@ class Camera : public Component
     Camera& operator=(Camera&& cam) = default;
 
     static constexpr float zoom_factor = 1.1;
-    mat4 projection;
 
     vec4 mouse_position = vec4::zero();
 
@@ -39,6 +38,14 @@ class Camera : public Component
 
     void window_resized(int w, int h);
 
+    const mat4& get_projection() const;
+
+    void set_ortho_projection(float right, float top);
+
+    // Maps normalized device coordinates back to the scene. It is only
+    // computed again once the projection or the camera pose changed.
+    const mat4& get_view_projection_inverse();
+
     void scroll_callback(float delta);
 
     void recenter_camera();
@@ -49,6 +56,9 @@ class Camera : public Component
 
     void move_to(float x, float y);
 
+    // Shows the scene magnified by zoom, centered on its point x, y
+    void set_view(float zoom, float x, float y);
+
     vec4 get_position();
 
 private:
@@ -68,6 +78,10 @@ private:
     int canvas_height_;
 
     mat4 scale_;
+
+    mat4 projection_;
+    mat4 view_projection_inverse_;
+    bool view_projection_outdated_ = true;
 };
 
 #endif // CAMERA_H_
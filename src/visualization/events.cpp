@@ -47,6 +47,19 @@ bool KeyboardState::is_key_pressed(Key key)
 }
 
 
+bool KeyboardState::is_any_key_pressed()
+{
+    for (const Key key :
+         {Key::Left, Key::Right, Key::Up, Key::Down, Key::Plus, Key::Minus}) {
+        if (is_key_pressed(key)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
 void KeyboardState::update_keyboard_state(const QEvent* event)
 {
     if (event->type() == QEvent::KeyPress) {
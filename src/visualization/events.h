@@ -45,6 +45,9 @@ class KeyboardState
 
     static bool is_key_pressed(Key key);
 
+    // Held keys keep moving the camera at every update
+    static bool is_any_key_pressed();
+
   private:
     static void update_keyboard_state(const QEvent* event);
 
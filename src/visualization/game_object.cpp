@@ -35,6 +35,8 @@
 
 
 GameObject::GameObject()
+    : stage(nullptr)
+    , pose_inverse_outdated_(true)
 {
     pose_.set_identity();
 }
@@ -73,18 +75,39 @@ void GameObject::add_component(const std::string& component_name,
                                std::shared_ptr<Component> component)
 {
     all_components_[component_name] = component;
+
+    if (stage != nullptr) {
+        stage->invalidate_render_queue();
+    }
 }
 
 
-mat4 GameObject::get_pose()
+const mat4& GameObject::get_pose() const
 {
     return pose_;
 }
 
 
+const mat4& GameObject::get_pose_inverse()
+{
+    if (pose_inverse_outdated_) {
+        pose_inverse_          = pose_.inv();
+        pose_inverse_outdated_ = false;
+    }
+
+    return pose_inverse_;
+}
+
+
 void GameObject::set_pose(const mat4& pose)
 {
-    pose_ = pose;
+    // Most objects set the same pose at every update
+    if (pose == pose_) {
+        return;
+    }
+
+    pose_                  = pose;
+    pose_inverse_outdated_ = true;
 }
 
 
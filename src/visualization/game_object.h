@@ -61,7 +61,10 @@ class GameObject
     void add_component(const std::string& component_name,
                        std::shared_ptr<Component> component);
 
-    mat4 get_pose();
+    const mat4& get_pose() const;
+
+    // The inverse is only computed again once the pose changed
+    const mat4& get_pose_inverse();
 
     void set_pose(const mat4& pose);
 
@@ -78,6 +81,8 @@ class GameObject
   private:
     std::map<std::string, std::shared_ptr<Component>> all_components_;
     mat4 pose_;
+    mat4 pose_inverse_;
+    bool pose_inverse_outdated_;
 };
 
 #endif // GAME_OBJECT_H_
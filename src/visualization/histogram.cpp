@@ -0,0 +1,585 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Below this size, spawning threads costs more than the pass itself
+const size_t parallel_histogram_threshold = 4 << 20;
+
+const unsigned int max_histogram_threads = 8;
+
+
+// Flip the bits of negative floats and the sign of positive ones, so that
+// the keys sort like the values
+uint32_t float_key(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+}
+
+
+float key_value(uint32_t key)
+{
+    const uint32_t bits = (key & 0x80000000u) != 0 ? key & 0x7fffffffu : ~key;
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+
+int float_bin(float value)
+{
+    return static_cast<int>(float_key(value) >> 16);
+}
+
+
+// Same as float_key, for the bits of a half
+int half_key(uint16_t bits)
+{
+    return (bits & 0x8000u) != 0 ? ~bits & 0xffff : bits | 0x8000;
+}
+
+
+uint16_t key_half(int key)
+{
+    return static_cast<uint16_t>((key & 0x8000) != 0 ? key & 0x7fff
+                                                     : ~key & 0xffff);
+}
+
+
+int bin_of(uint8_t value)
+{
+    return value;
+}
+
+
+int bin_of(uint16_t value)
+{
+    return value;
+}
+
+
+int bin_of(int16_t value)
+{
+    return value + 32768;
+}
+
+
+int bin_of(int8_t value)
+{
+    return value + 128;
+}
+
+
+int bin_of(int32_t value)
+{
+    return float_bin(static_cast<float>(value));
+}
+
+
+int bin_of(uint32_t value)
+{
+    return float_bin(static_cast<float>(value));
+}
+
+
+int bin_of(Half value)
+{
+    return half_key(value.bits);
+}
+
+
+int bin_of(float value)
+{
+    return float_bin(value);
+}
+
+
+template <typename T>
+void bin_rows(const T* buffer,
+              int width,
+              int step,
+              int channels,
+              int first_row,
+              int last_row,
+              const atomic<bool>& cancel,
+              vector<uint32_t>* counts)
+{
+    const size_t row_length = static_cast<size_t>(step) * channels;
+
+    for (int y = first_row; y < last_row; ++y) {
+        if (cancel.load(memory_order_relaxed)) {
+            return;
+        }
+
+        const T* row = buffer + static_cast<size_t>(y) * row_length;
+
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                const T value = row[x * channels + c];
+
+                // NaNs are the only values that differ from themselves
+                if (value != value) {
+                    continue;
+                }
+
+                ++counts[c][bin_of(value)];
+            }
+        }
+    }
+}
+
+
+template <typename T>
+bool compute_histogram(const T* buffer,
+                       int width,
+                       int height,
+                       int step,
+                       int channels,
+                       const atomic<bool>& cancel,
+                       Histogram& histogram)
+{
+    const size_t total_length = static_cast<size_t>(width) *
+                                static_cast<size_t>(height) * channels *
+                                sizeof(T);
+
+    unsigned int num_threads = 1;
+    if (total_length >= parallel_histogram_threshold) {
+        num_threads = min(max(thread::hardware_concurrency(), 1u),
+                          max_histogram_threads);
+        num_threads = min(num_threads, static_cast<unsigned int>(height));
+    }
+
+    const int rows_per_thread =
+        (height + static_cast<int>(num_threads) - 1) /
+        static_cast<int>(num_threads);
+
+    // Each thread bins its rows into its own counts, which are merged once
+    // they are all done
+    vector<vector<uint32_t>> thread_counts(
+        static_cast<size_t>(num_threads) * channels,
+        vector<uint32_t>(histogram_bins, 0));
+
+    vector<thread> workers;
+    size_t thread_id = 1;
+    for (int first_row = rows_per_thread; first_row < height;
+         first_row += rows_per_thread) {
+        const int last_row = min(first_row + rows_per_thread, height);
+        workers.emplace_back(bin_rows<T>,
+                             buffer,
+                             width,
+                             step,
+                             channels,
+                             first_row,
+                             last_row,
+                             ref(cancel),
+                             &thread_counts[thread_id++ * channels]);
+    }
+
+    // The first rows are binned by the calling thread
+    bin_rows<T>(buffer,
+                width,
+                step,
+                channels,
+                0,
+                min(rows_per_thread, height),
+                cancel,
+                &thread_counts[0]);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (cancel.load()) {
+        return false;
+    }
+
+    for (int c = 0; c < channels; ++c) {
+        vector<uint32_t>& counts = thread_counts[c];
+
+        for (size_t t = 1; t < thread_id; ++t) {
+            const vector<uint32_t>& other = thread_counts[t * channels + c];
+            for (int bin = 0; bin < histogram_bins; ++bin) {
+                counts[bin] += other[bin];
+            }
+        }
+
+        histogram.total[c] = 0;
+        for (const uint32_t count : counts) {
+            histogram.total[c] += count;
+        }
+
+        histogram.counts[c] = move(counts);
+    }
+
+    return true;
+}
+
+
+template <typename T>
+void update_histogram_region(const T* buffer,
+                             int x,
+                             int y,
+                             int width,
+                             int height,
+                             int step,
+                             int weight,
+                             Histogram& histogram)
+{
+    const int channels      = histogram.channels;
+    const size_t row_length = static_cast<size_t>(step) * channels;
+
+    size_t values[4] = {0, 0, 0, 0};
+
+    for (int row_y = y; row_y < y + height; ++row_y) {
+        const T* row = buffer + static_cast<size_t>(row_y) * row_length +
+                       static_cast<size_t>(x) * channels;
+
+        for (int i = 0; i < width * channels; ++i) {
+            const T value = row[i];
+
+            // NaNs were left out
+            if (value != value) {
+                continue;
+            }
+
+            const int c = i % channels;
+            if (weight < 0) {
+                --histogram.counts[c][bin_of(value)];
+            } else {
+                ++histogram.counts[c][bin_of(value)];
+            }
+            ++values[c];
+        }
+    }
+
+    for (int c = 0; c < channels; ++c) {
+        if (weight < 0) {
+            histogram.total[c] -= values[c];
+        } else {
+            histogram.total[c] += values[c];
+        }
+    }
+}
+
+} // namespace
+
+
+bool compute_histogram(const uint8_t* buffer,
+                       int width,
+                       int height,
+                       int step,
+                       int channels,
+                       BufferType type,
+                       const atomic<bool>& cancel,
+                       Histogram& histogram)
+{
+    histogram.type     = type;
+    histogram.channels = channels;
+
+    for (int c = 0; c < 4; ++c) {
+        histogram.counts[c].clear();
+        histogram.total[c] = 0;
+    }
+
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+        return true;
+    }
+
+    switch (type) {
+    case BufferType::UnsignedByte:
+        return compute_histogram(
+            buffer, width, height, step, channels, cancel, histogram);
+    case BufferType::UnsignedShort:
+        return compute_histogram(reinterpret_cast<const uint16_t*>(buffer),
+                                 width,
+                                 height,
+                                 step,
+                                 channels,
+                                 cancel,
+                                 histogram);
+    case BufferType::Short:
+        return compute_histogram(reinterpret_cast<const int16_t*>(buffer),
+                                 width,
+                                 height,
+                                 step,
+                                 channels,
+                                 cancel,
+                                 histogram);
+    case BufferType::Int32:
+        return compute_histogram(reinterpret_cast<const int32_t*>(buffer),
+                                 width,
+                                 height,
+                                 step,
+                                 channels,
+                                 cancel,
+                                 histogram);
+    case BufferType::Int8:
+        return compute_histogram(reinterpret_cast<const int8_t*>(buffer),
+                                 width,
+                                 height,
+                                 step,
+                                 channels,
+                                 cancel,
+                                 histogram);
+    case BufferType::UnsignedInt32:
+        return compute_histogram(reinterpret_cast<const uint32_t*>(buffer),
+                                 width,
+                                 height,
+                                 step,
+                                 channels,
+                                 cancel,
+                                 histogram);
+    case BufferType::Float16:
+        return compute_histogram(reinterpret_cast<const Half*>(buffer),
+                                 width,
+                                 height,
+                                 step,
+                                 channels,
+                                 cancel,
+                                 histogram);
+    case BufferType::Float32: // fall-through
+    case BufferType::Float64:
+    case BufferType::Int64:
+        return compute_histogram(reinterpret_cast<const float*>(buffer),
+                                 width,
+                                 height,
+                                 step,
+                                 channels,
+                                 cancel,
+                                 histogram);
+    }
+
+    return true;
+}
+
+
+void update_histogram_region(const uint8_t* buffer,
+                             int x,
+                             int y,
+                             int width,
+                             int height,
+                             int step,
+                             int weight,
+                             Histogram& histogram)
+{
+    if (width <= 0 || height <= 0 || histogram.channels < 1 ||
+        histogram.channels > 4) {
+        return;
+    }
+
+    switch (histogram.type) {
+    case BufferType::UnsignedByte:
+        update_histogram_region(
+            buffer, x, y, width, height, step, weight, histogram);
+        return;
+    case BufferType::UnsignedShort:
+        update_histogram_region(reinterpret_cast<const uint16_t*>(buffer),
+                                x,
+                                y,
+                                width,
+                                height,
+                                step,
+                                weight,
+                                histogram);
+        return;
+    case BufferType::Short:
+        update_histogram_region(reinterpret_cast<const int16_t*>(buffer),
+                                x,
+                                y,
+                                width,
+                                height,
+                                step,
+                                weight,
+                                histogram);
+        return;
+    case BufferType::Int32:
+        update_histogram_region(reinterpret_cast<const int32_t*>(buffer),
+                                x,
+                                y,
+                                width,
+                                height,
+                                step,
+                                weight,
+                                histogram);
+        return;
+    case BufferType::Int8:
+        update_histogram_region(reinterpret_cast<const int8_t*>(buffer),
+                                x,
+                                y,
+                                width,
+                                height,
+                                step,
+                                weight,
+                                histogram);
+        return;
+    case BufferType::UnsignedInt32:
+        update_histogram_region(reinterpret_cast<const uint32_t*>(buffer),
+                                x,
+                                y,
+                                width,
+                                height,
+                                step,
+                                weight,
+                                histogram);
+        return;
+    case BufferType::Float16:
+        update_histogram_region(reinterpret_cast<const Half*>(buffer),
+                                x,
+                                y,
+                                width,
+                                height,
+                                step,
+                                weight,
+                                histogram);
+        return;
+    case BufferType::Float32: // fall-through
+    case BufferType::Float64:
+    case BufferType::Int64:
+        update_histogram_region(reinterpret_cast<const float*>(buffer),
+                                x,
+                                y,
+                                width,
+                                height,
+                                step,
+                                weight,
+                                histogram);
+        return;
+    }
+}
+
+
+int histogram_bin(BufferType type, float value)
+{
+    if (value != value) {
+        return 0;
+    }
+
+    switch (type) {
+    case BufferType::UnsignedByte:
+        return static_cast<int>(min(max(round(value), 0.f), 255.f));
+    case BufferType::UnsignedShort:
+        return static_cast<int>(min(max(round(value), 0.f), 65535.f));
+    case BufferType::Short:
+        return static_cast<int>(min(max(round(value), -32768.f), 32767.f)) +
+               32768;
+    case BufferType::Int8:
+        return static_cast<int>(min(max(round(value), -128.f), 127.f)) + 128;
+    case BufferType::Float16:
+        return half_key(float_to_half(value));
+    default:
+        return float_bin(value);
+    }
+}
+
+
+void histogram_bin_range(BufferType type, int bin, float& lowest, float& upper)
+{
+    switch (type) {
+    case BufferType::UnsignedByte: // fall-through
+    case BufferType::UnsignedShort:
+        lowest = upper = static_cast<float>(bin);
+        return;
+    case BufferType::Short:
+        lowest = upper = static_cast<float>(bin - 32768);
+        return;
+    case BufferType::Int8:
+        lowest = upper = static_cast<float>(bin - 128);
+        return;
+    case BufferType::Float16:
+        lowest = upper = half_to_float(key_half(bin));
+        return;
+    default:
+        break;
+    }
+
+    const uint32_t key = static_cast<uint32_t>(bin) << 16;
+    lowest             = key_value(key);
+    upper              = key_value(key | 0xffffu);
+
+    // The bins of infinities also hold NaN representations
+    if (lowest != lowest) {
+        lowest = upper;
+    } else if (upper != upper) {
+        upper = lowest;
+    }
+}
+
+
+void histogram_percentile_range(const Histogram& histogram,
+                                int channel,
+                                float clipped_fraction,
+                                float& lowest,
+                                float& upper)
+{
+    const vector<uint32_t>& counts = histogram.counts[channel];
+
+    if (histogram.total[channel] == 0 || counts.empty()) {
+        lowest = upper = 0.f;
+        return;
+    }
+
+    const double clipped =
+        static_cast<double>(clipped_fraction) * histogram.total[channel];
+
+    float bin_lowest;
+    float bin_upper;
+
+    size_t cumulative = 0;
+    int bin           = 0;
+    for (; bin < histogram_bins - 1; ++bin) {
+        cumulative += counts[bin];
+        if (cumulative > clipped) {
+            break;
+        }
+    }
+    histogram_bin_range(histogram.type, bin, lowest, bin_upper);
+
+    cumulative = 0;
+    bin        = histogram_bins - 1;
+    for (; bin > 0; --bin) {
+        cumulative += counts[bin];
+        if (cumulative > clipped) {
+            break;
+        }
+    }
+    histogram_bin_range(histogram.type, bin, bin_lowest, upper);
+}
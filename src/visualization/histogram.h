@@ -0,0 +1,103 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ipc/raw_data_decode.h"
+
+
+// Bins of each channel. 8 and 16 bit buffers, halves included, have one bin
+// per value. Other types are binned by the upper bits of an order preserving
+// representation of their float values, so that bins have about the same
+// relative width whatever the magnitude of the values.
+const int histogram_bins = 1 << 16;
+
+
+struct Histogram
+{
+    BufferType type;
+    int channels;
+
+    // histogram_bins counts per channel. NaNs are left out.
+    std::vector<std::uint32_t> counts[4];
+    std::size_t total[4];
+};
+
+
+/**
+ * Bin the values of each of the channels of the width x height pixels of
+ * buffer, whose rows are step pixels apart. Doubles and 64 bit integers
+ * must be held as floats. Large buffers are split across several threads,
+ * which all check cancel after each row.
+ *
+ * @return false if cancel was set before the histogram was complete
+ */
+bool compute_histogram(const std::uint8_t* buffer,
+                       int width,
+                       int height,
+                       int step,
+                       int channels,
+                       BufferType type,
+                       const std::atomic<bool>& cancel,
+                       Histogram& histogram);
+
+/**
+ * Add the values of the width x height pixels of a region starting at
+ * (x, y) to the counts of a complete histogram of buffer, or remove them if
+ * weight is negative. The values of a region are removed before they are
+ * modified in place, and added again once they were.
+ */
+void update_histogram_region(const std::uint8_t* buffer,
+                             int x,
+                             int y,
+                             int width,
+                             int height,
+                             int step,
+                             int weight,
+                             Histogram& histogram);
+
+int histogram_bin(BufferType type, float value);
+
+// Range of the values falling in a bin
+void histogram_bin_range(BufferType type, int bin, float& lowest, float& upper);
+
+/**
+ * Bounds of the range of a channel that leaves out the given fraction of
+ * its values on each side, e.g. 0.005 for the 0.5th to 99.5th percentiles.
+ * Without any values, the range is [0, 0].
+ */
+void histogram_percentile_range(const Histogram& histogram,
+                                int channel,
+                                float clipped_fraction,
+                                float& lowest,
+                                float& upper);
+
+#endif // HISTOGRAM_H_
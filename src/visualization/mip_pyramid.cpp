@@ -0,0 +1,345 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "mip_pyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+using namespace std;
+
+
+namespace
+{
+
+template <typename T>
+T from_average(double value)
+{
+    return static_cast<T>(lround(value));
+}
+
+
+template <>
+float from_average<float>(double value)
+{
+    return static_cast<float>(value);
+}
+
+
+template <>
+Half from_average<Half>(double value)
+{
+    return Half{float_to_half(static_cast<float>(value))};
+}
+
+
+MipLevel make_level(int width,
+                    int height,
+                    int valid_width,
+                    int valid_height,
+                    int channels,
+                    BufferType type)
+{
+    MipLevel level;
+    level.width        = width;
+    level.height       = height;
+    level.valid_width  = valid_width;
+    level.valid_height = valid_height;
+    level.pixels.resize(static_cast<size_t>(width) * height *
+                        held_pixel_size(type, channels));
+    return level;
+}
+
+
+// Each texel of dst covers 2x2 texels of the source level, as well as the
+// last row/column of an odd-sized source level on its edges
+template <typename T>
+void reduce_level(const T* src,
+                  int src_step,
+                  int src_width,
+                  int src_height,
+                  int src_valid_width,
+                  int src_valid_height,
+                  int channels,
+                  MipReduction reduction,
+                  MipLevel& dst)
+{
+    T* dst_texels = reinterpret_cast<T*>(dst.pixels.data());
+
+    for (int j = 0; j < dst.height; ++j) {
+        const int y0 = 2 * j;
+        const int y1 = (j == dst.height - 1) ? src_height - 1 : y0 + 1;
+
+        for (int i = 0; i < dst.width; ++i) {
+            const int x0 = 2 * i;
+            const int x1 = (i == dst.width - 1) ? src_width - 1 : x0 + 1;
+
+            for (int c = 0; c < channels; ++c) {
+                double sum = 0.0;
+                int count  = 0;
+                T lowest   = T();
+                T highest  = T();
+
+                for (int y = y0; y <= y1; ++y) {
+                    const int src_y = min(y, src_valid_height - 1);
+
+                    for (int x = x0; x <= x1; ++x) {
+                        const int src_x = min(x, src_valid_width - 1);
+                        const T value =
+                            src[(static_cast<size_t>(src_y) * src_step +
+                                 src_x) *
+                                    channels +
+                                c];
+
+                        if (count == 0 || value < lowest) {
+                            lowest = value;
+                        }
+                        if (count == 0 || value > highest) {
+                            highest = value;
+                        }
+                        sum += value;
+                        ++count;
+                    }
+                }
+
+                T& reduced =
+                    dst_texels[(static_cast<size_t>(j) * dst.width + i) *
+                                   channels +
+                               c];
+                if (reduction == MipReduction::Minimum) {
+                    reduced = lowest;
+                } else if (reduction == MipReduction::Maximum) {
+                    reduced = highest;
+                } else {
+                    reduced = from_average<T>(sum / count);
+                }
+            }
+        }
+    }
+}
+
+
+void reduce_level(const uint8_t* src,
+                  int src_step,
+                  int src_width,
+                  int src_height,
+                  int src_valid_width,
+                  int src_valid_height,
+                  int channels,
+                  BufferType type,
+                  MipReduction reduction,
+                  MipLevel& dst)
+{
+    switch (type) {
+    case BufferType::UnsignedByte:
+        reduce_level(src,
+                     src_step,
+                     src_width,
+                     src_height,
+                     src_valid_width,
+                     src_valid_height,
+                     channels,
+                     reduction,
+                     dst);
+        break;
+    case BufferType::UnsignedShort:
+        reduce_level(reinterpret_cast<const uint16_t*>(src),
+                     src_step,
+                     src_width,
+                     src_height,
+                     src_valid_width,
+                     src_valid_height,
+                     channels,
+                     reduction,
+                     dst);
+        break;
+    case BufferType::Short:
+        reduce_level(reinterpret_cast<const int16_t*>(src),
+                     src_step,
+                     src_width,
+                     src_height,
+                     src_valid_width,
+                     src_valid_height,
+                     channels,
+                     reduction,
+                     dst);
+        break;
+    case BufferType::Int32:
+        reduce_level(reinterpret_cast<const int32_t*>(src),
+                     src_step,
+                     src_width,
+                     src_height,
+                     src_valid_width,
+                     src_valid_height,
+                     channels,
+                     reduction,
+                     dst);
+        break;
+    case BufferType::Int8:
+        reduce_level(reinterpret_cast<const int8_t*>(src),
+                     src_step,
+                     src_width,
+                     src_height,
+                     src_valid_width,
+                     src_valid_height,
+                     channels,
+                     reduction,
+                     dst);
+        break;
+    case BufferType::UnsignedInt32:
+        reduce_level(reinterpret_cast<const uint32_t*>(src),
+                     src_step,
+                     src_width,
+                     src_height,
+                     src_valid_width,
+                     src_valid_height,
+                     channels,
+                     reduction,
+                     dst);
+        break;
+    case BufferType::Float16:
+        reduce_level(reinterpret_cast<const Half*>(src),
+                     src_step,
+                     src_width,
+                     src_height,
+                     src_valid_width,
+                     src_valid_height,
+                     channels,
+                     reduction,
+                     dst);
+        break;
+    case BufferType::Float32: // fall-through
+    case BufferType::Float64:
+    case BufferType::Int64:
+        reduce_level(reinterpret_cast<const float*>(src),
+                     src_step,
+                     src_width,
+                     src_height,
+                     src_valid_width,
+                     src_valid_height,
+                     channels,
+                     reduction,
+                     dst);
+        break;
+    }
+}
+
+
+// Size of the level following one of the given size
+int next_level_size(int size)
+{
+    return max(size / 2, 1);
+}
+
+} // namespace
+
+
+MipLevel reduce_buffer_region(const uint8_t* buffer,
+                              int step,
+                              int channels,
+                              BufferType type,
+                              int x,
+                              int y,
+                              int width,
+                              int height,
+                              int tex_width,
+                              int tex_height,
+                              MipReduction reduction)
+{
+    const int level_width  = next_level_size(tex_width);
+    const int level_height = next_level_size(tex_height);
+
+    MipLevel level = make_level(level_width,
+                                level_height,
+                                min((width + 1) / 2, level_width),
+                                min((height + 1) / 2, level_height),
+                                channels,
+                                type);
+
+    const uint8_t* src =
+        buffer + (static_cast<size_t>(y) * step + x) *
+                     held_pixel_size(type, channels);
+
+    reduce_level(src,
+                 step,
+                 tex_width,
+                 tex_height,
+                 width,
+                 height,
+                 channels,
+                 type,
+                 reduction,
+                 level);
+
+    return level;
+}
+
+
+void reduce_mip_levels(vector<MipLevel>& levels,
+                       int channels,
+                       BufferType type,
+                       MipReduction reduction)
+{
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const MipLevel& src = levels.back();
+
+        const int level_width  = next_level_size(src.width);
+        const int level_height = next_level_size(src.height);
+
+        MipLevel level = make_level(level_width,
+                                    level_height,
+                                    min((src.valid_width + 1) / 2, level_width),
+                                    min((src.valid_height + 1) / 2,
+                                        level_height),
+                                    channels,
+                                    type);
+
+        reduce_level(src.pixels.data(),
+                     src.width,
+                     src.width,
+                     src.height,
+                     src.valid_width,
+                     src.valid_height,
+                     channels,
+                     type,
+                     reduction,
+                     level);
+
+        levels.push_back(move(level));
+    }
+}
+
+
+int mip_level_count(int width, int height)
+{
+    int count = 1;
+    while (width > 1 || height > 1) {
+        width  = next_level_size(width);
+        height = next_level_size(height);
+        ++count;
+    }
+    return count;
+}
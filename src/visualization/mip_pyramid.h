@@ -0,0 +1,85 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MIP_PYRAMID_H_
+#define MIP_PYRAMID_H_
+
+#include <cstdint> // for std::uint8_t
+
+#include <vector>
+
+#include "ipc/raw_data_decode.h"
+
+
+// How the texels of a mipmap level are reduced from the previous level.
+// Minimum and Maximum keep isolated outliers visible when zoomed out.
+enum class MipReduction { Average, Minimum, Maximum };
+
+
+struct MipLevel
+{
+    // Size of the texture level
+    int width;
+    int height;
+
+    // Texels reduced from the contents. The others replicate the last of
+    // them, so that filtering never reads texels outside of the contents.
+    int valid_width;
+    int valid_height;
+
+    // Packed texels, in the buffer format (doubles and 64 bit integers are
+    // held as floats)
+    std::vector<std::uint8_t> pixels;
+};
+
+
+/**
+ * Reduce the width x height pixels at (x, y) of buffer, which has the given
+ * step (in pixels), into level 1 of a texture of tex_width x tex_height.
+ */
+MipLevel reduce_buffer_region(const std::uint8_t* buffer,
+                              int step,
+                              int channels,
+                              BufferType type,
+                              int x,
+                              int y,
+                              int width,
+                              int height,
+                              int tex_width,
+                              int tex_height,
+                              MipReduction reduction);
+
+/**
+ * Append the levels that follow the last of levels, down to 1x1.
+ */
+void reduce_mip_levels(std::vector<MipLevel>& levels,
+                       int channels,
+                       BufferType type,
+                       MipReduction reduction);
+
+// Number of levels of a texture of width x height, level 0 included
+int mip_level_count(int width, int height);
+
+#endif // MIP_PYRAMID_H_
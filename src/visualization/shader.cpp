@@ -24,80 +24,121 @@
  */
 
 #include <cstring>
+#include <tuple>
 
 #include "shader.h"
 
 
-ShaderProgram::ShaderProgram(GLCanvas* gl_canvas)
-    : program_(0)
-    , gl_canvas_(gl_canvas)
+namespace
 {
-}
 
+// The sources are static strings, which are identified by their address
+using ProgramKey = std::tuple<GLCanvas*,
+                              const char*,
+                              const char*,
+                              int,
+                              std::string,
+                              bool,
+                              std::vector<std::string>,
+                              std::vector<std::string>>;
 
-ShaderProgram::~ShaderProgram()
-{
-    gl_canvas_->glDeleteProgram(program_);
-}
+// Number of programs linked so far, which are never deleted
+std::size_t num_linked_programs = 0;
 
+} // namespace
 
-bool ShaderProgram::is_shader_outdated(TexelChannels texel_format,
-                                       const std::vector<std::string>& uniforms,
-                                       const char* pixel_layout)
-{
-    // If the texel format or the uniform container size changed,
-    // the program must be created again
-    if (texel_format != texel_format_ || uniforms.size() != uniforms_.size()) {
-        return true;
-    }
 
-    // The program must also be created again if an uniform name
-    // changed
-    for (const auto& uniform_name : uniforms) {
-        if (uniforms_.find(uniform_name) == uniforms_.end()) {
-            return true;
-        }
-    }
-
-    for (int i = 0; i < 4; ++i) {
-        if (pixel_layout[i] != pixel_layout_[i]) {
-            return true;
-        }
-    }
-
-    // Otherwise, it must not change
-    return false;
+ShaderProgram::ShaderProgram(GLCanvas* gl_canvas)
+    : gl_canvas_(gl_canvas)
+    , texel_format_(FormatRGBA)
+    , texture_array_(false)
+{
 }
 
+
 bool ShaderProgram::create(const char* v_source,
                            const char* f_source,
                            TexelChannels texel_format,
                            const char* pixel_layout,
-                           const std::vector<std::string>& uniforms)
+                           const std::vector<std::string>& uniforms,
+                           const std::vector<std::string>& attributes,
+                           bool texture_array)
 {
-    if (program_ != 0) {
-        // Check if the program needs to be recompiled
-        if (!is_shader_outdated(texel_format, uniforms, pixel_layout)) {
-            return true;
+    // Programs are kept until the GL context is destroyed: there are only a
+    // few combinations of parameters, and buffer updates often alternate
+    // between them
+    static std::map<ProgramKey, std::shared_ptr<const LinkedProgram>>
+        linked_programs;
+
+    const ProgramKey key(gl_canvas_,
+                         v_source,
+                         f_source,
+                         texel_format,
+                         std::string(pixel_layout, 4),
+                         texture_array,
+                         uniforms,
+                         attributes);
+
+    auto linked_program = linked_programs.find(key);
+    if (linked_program == linked_programs.end()) {
+        texel_format_  = texel_format;
+        texture_array_ = texture_array;
+        memcpy(pixel_layout_, pixel_layout, 4);
+        pixel_layout_[4] = '\0';
+
+        std::shared_ptr<const LinkedProgram> program =
+            link(v_source, f_source, uniforms, attributes);
+        if (program == nullptr) {
+            return false;
         }
-        // Delete old program
-        gl_canvas_->glDeleteProgram(program_);
+
+        linked_program = linked_programs.emplace(key, program).first;
+        num_linked_programs = linked_programs.size();
     }
 
-    texel_format_ = texel_format;
-    memcpy(pixel_layout_, pixel_layout, 4);
-    pixel_layout_[4]       = '\0';
+    program_ = linked_program->second;
+
+    return true;
+}
+
+
+GLuint ShaderProgram::program_id() const
+{
+    return program_ != nullptr ? program_->id : 0;
+}
+
+
+std::size_t ShaderProgram::linked_program_count()
+{
+    return num_linked_programs;
+}
+
+
+std::shared_ptr<const ShaderProgram::LinkedProgram>
+ShaderProgram::link(const char* v_source,
+                    const char* f_source,
+                    const std::vector<std::string>& uniforms,
+                    const std::vector<std::string>& attributes)
+{
     GLuint vertex_shader   = compile(GL_VERTEX_SHADER, v_source);
     GLuint fragment_shader = compile(GL_FRAGMENT_SHADER, f_source);
 
     if (vertex_shader == 0 || fragment_shader == 0) {
-        return false;
+        return nullptr;
     }
 
-    program_ = gl_canvas_->glCreateProgram();
-    gl_canvas_->glAttachShader(program_, vertex_shader);
-    gl_canvas_->glAttachShader(program_, fragment_shader);
-    gl_canvas_->glLinkProgram(program_);
+    std::shared_ptr<LinkedProgram> program = std::make_shared<LinkedProgram>();
+
+    program->id = gl_canvas_->glCreateProgram();
+    gl_canvas_->glAttachShader(program->id, vertex_shader);
+    gl_canvas_->glAttachShader(program->id, fragment_shader);
+
+    for (size_t i = 0; i < attributes.size(); ++i) {
+        gl_canvas_->glBindAttribLocation(
+            program->id, static_cast<GLuint>(i), attributes[i].c_str());
+    }
+
+    gl_canvas_->glLinkProgram(program->id);
 
     // Delete shaders. We don't need them anymore.
     gl_canvas_->glDeleteShader(vertex_shader);
@@ -105,23 +146,30 @@ bool ShaderProgram::create(const char* v_source,
 
     // Get uniform locations
     for (const auto& name : uniforms) {
-        GLuint loc = gl_canvas_->glGetUniformLocation(program_, name.c_str());
-        uniforms_[name] = loc;
+        GLuint loc =
+            gl_canvas_->glGetUniformLocation(program->id, name.c_str());
+        program->uniforms[name] = loc;
     }
 
-    return true;
+    return program;
 }
 
 
 void ShaderProgram::uniform1i(const std::string& name, int value) const
 {
-    gl_canvas_->glUniform1i(uniforms_.at(name), value);
+    gl_canvas_->glUniform1i(program_->uniforms.at(name), value);
+}
+
+
+void ShaderProgram::uniform1f(const std::string& name, float value) const
+{
+    gl_canvas_->glUniform1f(program_->uniforms.at(name), value);
 }
 
 
 void ShaderProgram::uniform2f(const std::string& name, float x, float y) const
 {
-    gl_canvas_->glUniform2f(uniforms_.at(name), x, y);
+    gl_canvas_->glUniform2f(program_->uniforms.at(name), x, y);
 }
 
 
@@ -129,7 +177,7 @@ void ShaderProgram::uniform3fv(const std::string& name,
                                int count,
                                const float* data) const
 {
-    gl_canvas_->glUniform3fv(uniforms_.at(name), count, data);
+    gl_canvas_->glUniform3fv(program_->uniforms.at(name), count, data);
 }
 
 
@@ -137,7 +185,7 @@ void ShaderProgram::uniform4fv(const std::string& name,
                                int count,
                                const float* data) const
 {
-    gl_canvas_->glUniform4fv(uniforms_.at(name), count, data);
+    gl_canvas_->glUniform4fv(program_->uniforms.at(name), count, data);
 }
 
 
@@ -146,13 +194,14 @@ void ShaderProgram::uniform_matrix4fv(const std::string& name,
                                       GLboolean transpose,
                                       const float* value) const
 {
-    gl_canvas_->glUniformMatrix4fv(uniforms_.at(name), count, transpose, value);
+    gl_canvas_->glUniformMatrix4fv(
+        program_->uniforms.at(name), count, transpose, value);
 }
 
 
 void ShaderProgram::use() const
 {
-    gl_canvas_->glUseProgram(program_);
+    gl_canvas_->glUseProgram(program_->id);
 }
 
 
@@ -163,6 +212,10 @@ GLuint ShaderProgram::compile(GLuint type, GLchar const* source)
     const char* src[] = {
         "#version 120\n",
 
+        texture_array_ ? "#extension GL_EXT_texture_array : require\n"
+                         "#define TEXTURE_ARRAY\n"
+                       : "",
+
         // clang-format off
         texel_format_ == FormatR ?   "#define FORMAT_R\n" :
         texel_format_ == FormatRG ?  "#define FORMAT_RG\n" :
@@ -175,7 +228,7 @@ GLuint ShaderProgram::compile(GLuint type, GLchar const* source)
 
         source};
 
-    gl_canvas_->glShaderSource(shader, 5, src, NULL);
+    gl_canvas_->glShaderSource(shader, 6, src, NULL);
     gl_canvas_->glCompileShader(shader);
 
     GLint compiled;
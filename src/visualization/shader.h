@@ -28,6 +28,7 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -43,17 +44,28 @@ class ShaderProgram
 
     ShaderProgram(GLCanvas* gl_canvas);
 
-    ~ShaderProgram();
-
+    /**
+     * Compile and link the program, unless it is already up to date or
+     * another shader program was created from the same sources and
+     * parameters. Linked programs are shared by all of them.
+     *
+     * Each of attributes is bound to its index in the list. If
+     * texture_array is set, the shaders are compiled with TEXTURE_ARRAY
+     * defined and sampler2DArray available.
+     */
     bool create(const char* v_source,
                 const char* f_source,
                 TexelChannels texel_format,
                 const char* pixel_layout,
-                const std::vector<std::string>& uniforms);
+                const std::vector<std::string>& uniforms,
+                const std::vector<std::string>& attributes = {},
+                bool texture_array = false);
 
     // Uniform handlers
     void uniform1i(const std::string& name, int value) const;
 
+    void uniform1f(const std::string& name, float value) const;
+
     void uniform2f(const std::string& name, float x, float y) const;
 
     void
@@ -70,14 +82,26 @@ class ShaderProgram
     // Program utility
     void use() const;
 
+    // Linked program, which other shader programs may share; 0 if none
+    GLuint program_id() const;
+
+    // Number of distinct programs linked by all shader programs
+    static std::size_t linked_program_count();
+
   private:
-    GLuint program_;
+    struct LinkedProgram
+    {
+        GLuint id;
+        std::map<std::string, GLuint> uniforms;
+    };
+
+    std::shared_ptr<const LinkedProgram> program_;
 
     GLCanvas* gl_canvas_;
 
     TexelChannels texel_format_;
 
-    std::map<std::string, GLuint> uniforms_;
+    bool texture_array_;
 
     char pixel_layout_[5];
 
@@ -85,9 +109,11 @@ class ShaderProgram
 
     std::string get_shader_type(GLuint type);
 
-    bool is_shader_outdated(TexelChannels texel_format,
-                            const std::vector<std::string>& uniforms,
-                            const char* pixel_layout);
+    std::shared_ptr<const LinkedProgram>
+    link(const char* v_source,
+         const char* f_source,
+         const std::vector<std::string>& uniforms,
+         const std::vector<std::string>& attributes);
 };
 
 #endif // SHADER_H_
@@ -0,0 +1,138 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+namespace shader
+{
+
+const char* buff_diff_frag_shader = R"(
+
+#if defined(TEXTURE_ARRAY)
+uniform sampler2DArray sampler;
+uniform sampler2DArray reference_sampler;
+#else
+uniform sampler2D sampler;
+uniform sampler2D reference_sampler;
+#endif
+uniform int enable_borders;
+
+// Difference of the contents with the reference: absolute (0), signed (1),
+// or relative to the largest magnitude of both (2)
+uniform int difference_mode;
+// Scale from the texels to the buffer values
+uniform float value_scale;
+// Difference shown at full intensity
+uniform float difference_range;
+
+// Ouput data
+varying vec2 uv;
+varying vec2 tex_coord;
+varying vec2 max_tex_coord;
+varying vec2 buffer_dimension;
+varying float layer;
+
+vec4 sample_texture(vec2 coord)
+{
+#if defined(TEXTURE_ARRAY)
+    return texture2DArray(sampler, vec3(coord, layer));
+#else
+    return texture2D(sampler, coord);
+#endif
+}
+
+vec4 sample_reference(vec2 coord)
+{
+#if defined(TEXTURE_ARRAY)
+    return texture2DArray(reference_sampler, vec3(coord, layer));
+#else
+    return texture2D(reference_sampler, coord);
+#endif
+}
+
+vec4 difference()
+{
+    vec2 coord = min(tex_coord, max_tex_coord);
+    vec4 value = sample_texture(coord) * value_scale;
+    vec4 reference = sample_reference(coord) * value_scale;
+
+    vec4 delta = value - reference;
+    if (difference_mode == 0) {
+        return abs(delta);
+    } else if (difference_mode == 1) {
+        return delta;
+    }
+
+    // Equal values are no relative difference, even if both are zero
+    vec4 magnitude = max(abs(value), abs(reference));
+    return abs(delta) / max(magnitude, vec4(1.17549435e-38));
+}
+
+void main()
+{
+    vec4 delta = difference() / difference_range;
+    vec4 color = vec4(0.0, 0.0, 0.0, 1.0);
+
+#if defined(FORMAT_R)
+    if (difference_mode == 1) {
+        // Positive differences in red, negative ones in blue
+        color.rgb = vec3(max(delta.r, 0.0), 0.0, max(-delta.r, 0.0));
+    } else {
+        color.rgb = delta.rrr;
+    }
+#else
+    // Differences of each channel, centered on gray if they are signed
+    if (difference_mode == 1) {
+        delta = delta * 0.5 + vec4(0.5);
+    }
+#if defined(FORMAT_RG)
+    color.rg = delta.rg;
+#else
+    color.rgb = delta.rgb;
+#endif
+#endif
+
+    vec2 buffer_position = uv * buffer_dimension;
+
+    if(enable_borders == 1) {
+        float alpha = max(abs(dFdx(buffer_position.x)),
+                          abs(dFdx(buffer_position.y)));
+
+        float x_ = fract(buffer_position.x);
+        float y_ = fract(buffer_position.y);
+
+        float vertical_border = clamp(abs(-1.0 / alpha * x_ + 0.5 / alpha) -
+                                      (0.5 / alpha - 1.0), 0.0, 1.0);
+
+        float horizontal_border = clamp(abs(-1.0 / alpha * y_ + 0.5 / alpha) -
+                                           (0.5 / alpha - 1.0), 0.0, 1.0);
+
+        color.rgb += vec3(vertical_border +
+                          horizontal_border);
+    }
+
+    gl_FragColor = color.PIXEL_LAYOUT;
+}
+
+)";
+
+} // namespace shader
@@ -28,13 +28,282 @@ namespace shader
 
 const char* buff_frag_shader = R"(
 
+#if defined(TEXTURE_ARRAY)
+uniform sampler2DArray sampler;
+#else
 uniform sampler2D sampler;
+#endif
 uniform vec4 brightness_contrast[2];
-uniform vec2 buffer_dimension;
 uniform int enable_borders;
 
+// Pixel values drawn from the texels, with the glyphs of GLTextRenderer
+uniform int enable_value_labels;
+uniform sampler2D glyph_sampler;
+// Per glyph: rectangle in the glyph texture, and size in the scene
+uniform vec4 glyph_rects[18];
+uniform vec4 glyph_boxes[18];
+// From the contents to the scene, so that the labels stay upright
+uniform vec4 label_rotation;
+// Vertical offset of the label of each channel from the pixel center
+uniform vec4 label_offsets;
+// Scale from the texels to the buffer values, and whether these are integers
+uniform vec2 label_value_format;
+
 // Ouput data
 varying vec2 uv;
+varying vec2 tex_coord;
+varying vec2 max_tex_coord;
+varying vec2 buffer_dimension;
+varying float layer;
+
+vec4 sample_buffer()
+{
+    vec2 coord = min(tex_coord, max_tex_coord);
+#if defined(TEXTURE_ARRAY)
+    return texture2DArray(sampler, vec3(coord, layer));
+#else
+    return texture2D(sampler, coord);
+#endif
+}
+
+
+#if defined(FORMAT_R)
+const int label_channels = 1;
+#elif defined(FORMAT_RG)
+const int label_channels = 2;
+#elif defined(FORMAT_RGB)
+const int label_channels = 3;
+#else
+const int label_channels = 4;
+#endif
+
+// Ids of the glyphs other than digits, as in GLTextRenderer::label_glyphs
+const float glyph_dot   = 10.0;
+const float glyph_minus = 11.0;
+const float glyph_plus  = 12.0;
+const float glyph_e     = 13.0;
+const float glyph_n     = 14.0;
+const float glyph_a     = 15.0;
+const float glyph_i     = 16.0;
+const float glyph_f     = 17.0;
+
+const float powers_of_ten[8] = float[8](
+    1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0, 10000000.0);
+
+// Labels are formatted like "%.3f" (or "%d" for integers), falling back to
+// "%.3e" past 7 characters
+const int label_fixed      = 0;
+const int label_scientific = 1;
+const int label_nan        = 2;
+const int label_inf        = 3;
+
+struct Label {
+    int kind;
+    bool negative;
+    // Digits of the integer part (or of the mantissa) and of the decimals
+    float integer_part;
+    float integer_digits;
+    float decimals;
+    int decimal_digits;
+    float exponent;
+    int length;
+};
+
+
+// Digit of integer, a float holding an integer, at the given power of ten
+float digit_of(float integer, float power)
+{
+    float quotient = floor((integer + 0.5) / power);
+    return quotient - 10.0 * floor((quotient + 0.5) / 10.0);
+}
+
+
+float digit_count(float integer)
+{
+    float count = 1.0;
+    for (int i = 1; i < 8; ++i) {
+        if (integer + 0.5 >= powers_of_ten[i]) {
+            count += 1.0;
+        }
+    }
+    return count;
+}
+
+
+bool label_isnan(float val) {
+    return (val < 0.0 || 0.0 < val || val == 0.0) ? false : true;
+}
+
+
+Label format_label(float value)
+{
+    Label label;
+    label.negative       = value < 0.0;
+    label.kind           = label_fixed;
+    label.integer_part   = 0.0;
+    label.integer_digits = 1.0;
+    label.decimals       = 0.0;
+    label.decimal_digits = 0;
+    label.exponent       = 0.0;
+
+    float magnitude = abs(value);
+
+    if (label_isnan(value)) {
+        label.kind     = label_nan;
+        label.negative = false;
+        label.length   = 3;
+        return label;
+    } else if (magnitude > 3.4028234e38) {
+        label.kind   = label_inf;
+        label.length = label.negative ? 4 : 3;
+        return label;
+    }
+
+    if (label_value_format.y > 0.0) {
+        label.integer_part = floor(magnitude + 0.5);
+    } else {
+        float thousandths    = floor(magnitude * 1000.0 + 0.5);
+        label.integer_part   = floor((thousandths + 0.5) / 1000.0);
+        label.decimals       = thousandths - 1000.0 * label.integer_part;
+        label.decimal_digits = 3;
+    }
+
+    // Unlike "%.3f", "%d" has no negative zero
+    if (label.decimal_digits == 0 && label.integer_part == 0.0) {
+        label.negative = false;
+    }
+
+    if (label.integer_part < 10000000.0) {
+        label.integer_digits = digit_count(label.integer_part);
+        label.length = int(label.integer_digits) +
+                       (label.decimal_digits > 0 ? 4 : 0) +
+                       (label.negative ? 1 : 0);
+        if (label.length <= 7) {
+            return label;
+        }
+    }
+
+    // The mantissa is kept as an integer with 4 digits
+    label.kind     = label_scientific;
+    label.negative = value < 0.0;
+    label.exponent = floor(log(magnitude) / log(10.0));
+
+    float mantissa = floor(magnitude / pow(10.0, label.exponent) * 1000.0 +
+                           0.5);
+    if (mantissa >= 10000.0) {
+        label.exponent += 1.0;
+        mantissa = floor(mantissa / 10.0 + 0.5);
+    } else if (mantissa < 1000.0) {
+        label.exponent -= 1.0;
+        mantissa = floor(magnitude / pow(10.0, label.exponent) * 1000.0 +
+                         0.5);
+    }
+
+    label.integer_part = mantissa;
+    label.length       = label.negative ? 10 : 9;
+
+    return label;
+}
+
+
+float label_glyph(Label label, int index)
+{
+    if (label.negative) {
+        if (index == 0) {
+            return glyph_minus;
+        }
+        index -= 1;
+    }
+
+    if (label.kind == label_nan) {
+        return index == 1 ? glyph_a : glyph_n;
+    } else if (label.kind == label_inf) {
+        return index == 0 ? glyph_i : (index == 1 ? glyph_n : glyph_f);
+    } else if (label.kind == label_scientific) {
+        if (index == 0) {
+            return digit_of(label.integer_part, 1000.0);
+        } else if (index == 1) {
+            return glyph_dot;
+        } else if (index < 5) {
+            return digit_of(label.integer_part, powers_of_ten[4 - index]);
+        } else if (index == 5) {
+            return glyph_e;
+        } else if (index == 6) {
+            return label.exponent < 0.0 ? glyph_minus : glyph_plus;
+        }
+        return digit_of(abs(label.exponent), index == 7 ? 10.0 : 1.0);
+    }
+
+    int integer_digits = int(label.integer_digits);
+    if (index < integer_digits) {
+        return digit_of(label.integer_part,
+                        powers_of_ten[integer_digits - 1 - index]);
+    } else if (index == integer_digits) {
+        return glyph_dot;
+    }
+    return digit_of(label.decimals,
+                    powers_of_ten[2 - (index - integer_digits - 1)]);
+}
+
+
+float channel_value(vec4 texel, int channel)
+{
+    if (channel == 0) {
+        return texel.r;
+    } else if (channel == 1) {
+        return texel.g;
+    } else if (channel == 2) {
+        return texel.b;
+    }
+    return texel.a;
+}
+
+
+// Coverage of the fragment by the label glyphs of the pixel
+float value_label_coverage(vec4 texel, vec2 buffer_position)
+{
+    vec2 position = mat2(label_rotation.xy, label_rotation.zw) *
+                    (fract(buffer_position) - vec2(0.5));
+
+    float glyph_height = glyph_boxes[0].y;
+    vec2 glyph_coord = vec2(-1.0);
+
+    for (int c = 0; c < label_channels; ++c) {
+        float y = position.y + channel_value(label_offsets, c) +
+                  glyph_height / 2.0;
+        if (y < 0.0 || y > glyph_height) {
+            continue;
+        }
+
+        Label label = format_label(channel_value(texel, c) *
+                                   label_value_format.x);
+
+        float width = 0.0;
+        for (int i = 0; i < 10; ++i) {
+            if (i < label.length) {
+                width += glyph_boxes[int(label_glyph(label, i))].x;
+            }
+        }
+
+        float x = position.x + width / 2.0;
+        for (int i = 0; i < 10; ++i) {
+            if (i < label.length) {
+                int glyph         = int(label_glyph(label, i));
+                float glyph_width = glyph_boxes[glyph].x;
+                if (x >= 0.0 && x < glyph_width) {
+                    glyph_coord = glyph_rects[glyph].xy +
+                                  vec2(x / glyph_width, y / glyph_height) *
+                                      glyph_rects[glyph].zw;
+                }
+                x -= glyph_width;
+            }
+        }
+    }
+
+    // Sampled outside of any branch, where derivatives are defined
+    float coverage = texture2D(glyph_sampler, glyph_coord).r;
+    return glyph_coord.x < 0.0 ? 0.0 : coverage;
+}
 
 void main()
 {
@@ -42,23 +311,23 @@ void main()
 
 #if defined(FORMAT_R)
     // Output color = grayscale
-    color = texture2D(sampler, uv).rrra;
+    color = sample_buffer().rrra;
     color.rgb = color.rgb * brightness_contrast[0].xxx +
                             brightness_contrast[1].xxx;
 #elif defined(FORMAT_RG)
     // Output color = two channels
-    color = texture2D(sampler, uv);
+    color = sample_buffer();
     color.rg = color.rg * brightness_contrast[0].xy +
                           brightness_contrast[1].xy;
     color.b = 0.0;
 #elif defined(FORMAT_RGB)
     // Output color = rgb
-    color = texture2D(sampler, uv);
+    color = sample_buffer();
     color.rgb = color.rgb * brightness_contrast[0].xyz +
                             brightness_contrast[1].xyz;
 #else
     // Output color = rgba
-    color = texture2D(sampler, uv);
+    color = sample_buffer();
     color = color * brightness_contrast[0] +
                     brightness_contrast[1];
 #endif
@@ -82,7 +351,24 @@ void main()
                           horizontal_border);
     }
 
-    gl_FragColor = color.PIXEL_LAYOUT;
+    vec4 output_color = color.PIXEL_LAYOUT;
+
+    if (enable_value_labels == 1) {
+        // The text contrasts with the first channel, as with the labels
+        // drawn from the CPU
+        float buff_color = color.r;
+        if (label_isnan(buff_color)) {
+            buff_color = 0.0;
+        }
+        float text_intensity = float(int(1.0 - buff_color + 0.5));
+
+        output_color.rgb =
+            mix(output_color.rgb,
+                vec3(text_intensity),
+                value_label_coverage(sample_buffer(), buffer_position));
+    }
+
+    gl_FragColor = output_color;
 }
 
 )";
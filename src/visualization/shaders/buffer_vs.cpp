@@ -29,13 +29,38 @@ namespace shader
 const char* buff_vert_shader = R"(
 
 attribute vec2 input_position;
+
+// Per tile: center and size in the contents, and layer of its texture
+attribute vec4 tile_rect;
+attribute float tile_layer;
+
 varying vec2 uv;
+varying vec2 tex_coord;
+varying vec2 max_tex_coord;
+varying vec2 buffer_dimension;
+varying float layer;
 
 uniform mat4 mvp;
+// Scale (xy) and offset (zw) from the contents to the scene
+uniform vec4 content_transform;
+// Size of the textures holding the tiles
+uniform vec2 tile_size;
 
 void main(void) {
     uv = input_position + vec2(0.5, 0.5);
-    gl_Position = mvp*vec4(input_position, 0.0, 1.0);
+
+    // Edge tiles may not fill their texture. Their texture coordinates stop
+    // at the center of their last texel, so that its unused neighbours are
+    // never filtered in.
+    tex_coord = uv * tile_rect.zw / tile_size;
+    max_tex_coord = (tile_rect.zw - vec2(0.5, 0.5)) / tile_size;
+
+    buffer_dimension = tile_rect.zw;
+    layer = tile_layer;
+
+    vec2 position = (input_position * tile_rect.zw + tile_rect.xy) *
+                    content_transform.xy + content_transform.zw;
+    gl_Position = mvp*vec4(position, 0.0, 1.0);
 }
 
 )";
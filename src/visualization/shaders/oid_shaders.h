@@ -32,10 +32,14 @@ namespace shader
 
 extern const char* buff_frag_shader;
 extern const char* buff_vert_shader;
+extern const char* buff_diff_frag_shader;
 extern const char* text_frag_shader;
 extern const char* text_vert_shader;
 extern const char* background_vert_shader;
 extern const char* background_frag_shader;
+extern const char* reduce_source_frag_shader;
+extern const char* reduce_combine_frag_shader;
+extern const char* reduce_difference_frag_shader;
 
 } // namespace shader
 
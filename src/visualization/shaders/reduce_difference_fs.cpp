@@ -0,0 +1,131 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+namespace shader
+{
+
+const char* reduce_difference_frag_shader = R"(
+
+#if defined(TEXTURE_ARRAY)
+uniform sampler2DArray sampler;
+uniform sampler2DArray reference_sampler;
+#else
+uniform sampler2D sampler;
+uniform sampler2D reference_sampler;
+#endif
+uniform float layer;
+
+// Texels of the contents of the tile, and size of its texture
+uniform vec2 source_size;
+uniform vec2 texture_size;
+
+// Bottom left corner of the viewport, in window coordinates
+uniform vec2 output_origin;
+
+// As in the buffer difference shader
+uniform int difference_mode;
+uniform float value_scale;
+
+// Differences whose magnitude is above it are counted
+uniform float threshold;
+
+const float block_size = 16.0;
+const float max_float = 3.4028234e38;
+
+vec4 difference(vec2 texel)
+{
+    vec2 coord = (texel + vec2(0.5, 0.5)) / texture_size;
+#if defined(TEXTURE_ARRAY)
+    vec4 value = texture2DArray(sampler, vec3(coord, layer));
+    vec4 reference = texture2DArray(reference_sampler, vec3(coord, layer));
+#else
+    vec4 value = texture2D(sampler, coord);
+    vec4 reference = texture2D(reference_sampler, coord);
+#endif
+    value *= value_scale;
+    reference *= value_scale;
+
+    vec4 delta = value - reference;
+    if (difference_mode == 0) {
+        return abs(delta);
+    } else if (difference_mode == 1) {
+        return delta;
+    }
+
+    vec4 magnitude = max(abs(value), abs(reference));
+    return abs(delta) / max(magnitude, vec4(1.17549435e-38));
+}
+
+void main()
+{
+    vec2 block_origin = floor(gl_FragCoord.xy - output_origin) * block_size;
+
+    vec4 lowest = vec4(max_float);
+    vec4 upper = vec4(-max_float);
+    vec4 sum = vec4(0.0);
+    vec4 nan_count = vec4(0.0);
+    vec4 above_count = vec4(0.0);
+
+    for (float y = 0.0; y < block_size; ++y) {
+        for (float x = 0.0; x < block_size; ++x) {
+            vec2 texel = block_origin + vec2(x, y);
+            if (texel.x >= source_size.x || texel.y >= source_size.y) {
+                continue;
+            }
+
+            vec4 value = difference(texel);
+
+            for (int c = 0; c < 4; ++c) {
+                float v = value[c];
+
+                // GLSL 1.20 has no isnan(), but NaNs differ from themselves
+                if (v != v) {
+                    nan_count[c] += 1.0;
+                    continue;
+                }
+
+                if (abs(v) > threshold) {
+                    above_count[c] += 1.0;
+                }
+
+                if (abs(v) <= max_float) {
+                    sum[c] += v;
+                }
+
+                lowest[c] = min(lowest[c], v);
+                upper[c] = max(upper[c], v);
+            }
+        }
+    }
+
+    gl_FragData[0] = lowest;
+    gl_FragData[1] = upper;
+    gl_FragData[2] = sum;
+    gl_FragData[3] = nan_count;
+    gl_FragData[4] = above_count;
+}
+
+)";
+
+} // namespace shader
@@ -28,14 +28,13 @@ namespace shader
 
 const char* text_frag_shader = R"(
 
-uniform sampler2D buff_sampler;
 uniform sampler2D text_sampler;
-uniform vec2 pix_coord;
 uniform vec4 brightness_contrast[2];
 
 
 // Ouput data
 varying vec2 uv;
+varying float buff_value;
 
 
 float round_float(float f) {
@@ -52,9 +51,8 @@ void main()
 {
     vec4 color;
     // Output color = red
-    float buff_color = texture2D(buff_sampler, pix_coord).r;
-    buff_color = buff_color * brightness_contrast[0].x +
-                              brightness_contrast[1].x;
+    float buff_color = buff_value * brightness_contrast[0].x +
+                                    brightness_contrast[1].x;
 
     if (oid_isnan(buff_color)) {
         buff_color = 0.0;
@@ -29,13 +29,17 @@ namespace shader
 const char* text_vert_shader = R"(
 
 attribute vec4 input_position;
+// First channel of the labelled pixel, as sampled from the buffer texture
+attribute float input_value;
 varying vec2 uv;
+varying float buff_value;
 
 uniform mat4 mvp;
 
 void main(void) {
     gl_Position = mvp * vec4(input_position.xy, 0.0, 1.0);
     uv = input_position.zw;
+    buff_value = input_value;
 }
 
 )";
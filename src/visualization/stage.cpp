@@ -23,7 +23,7 @@
  * IN THE SOFTWARE.
  */
 
-#include <set>
+#include <algorithm>
 
 #include "stage.h"
 
@@ -37,17 +37,14 @@
 using namespace std;
 
 
-struct compareRenderOrder
-{
-    bool operator()(const Component* a, const Component* b) const
-    {
-        return a->render_index() < b->render_index();
-    }
-};
-
-
 Stage::Stage(MainWindow* main_wnd)
     : main_window(main_wnd)
+    , components_initialized_(false)
+    , camera_obj_(nullptr)
+    , camera_component_(nullptr)
+    , buffer_obj_(nullptr)
+    , buffer_component_(nullptr)
+    , render_queue_outdated_(true)
 {
 }
 
@@ -59,7 +56,8 @@ bool Stage::initialize(const uint8_t* buffer,
                        BufferType type,
                        int step,
                        const string& pixel_layout,
-                       bool transpose_buffer)
+                       bool transpose_buffer,
+                       bool defer_components)
 {
     std::shared_ptr<GameObject> camera_obj = std::make_shared<GameObject>();
 
@@ -85,18 +83,44 @@ bool Stage::initialize(const uint8_t* buffer,
     std::shared_ptr<Buffer> buffer_component =
         std::make_shared<Buffer>(buffer_obj.get(), main_window->gl_canvas());
 
-    buffer_component->buffer          = buffer;
-    buffer_component->channels        = channels;
-    buffer_component->type            = type;
-    buffer_component->buffer_width_f  = static_cast<float>(buffer_width_i);
-    buffer_component->buffer_height_f = static_cast<float>(buffer_height_i);
-    buffer_component->step            = step;
-    buffer_component->transpose       = transpose_buffer;
+    buffer_component->buffer            = buffer;
+    buffer_component->channels          = channels;
+    buffer_component->type              = type;
+    buffer_component->buffer_width_f    = static_cast<float>(buffer_width_i);
+    buffer_component->buffer_height_f   = static_cast<float>(buffer_height_i);
+    buffer_component->display_width_f   = static_cast<float>(buffer_width_i);
+    buffer_component->display_height_f  = static_cast<float>(buffer_height_i);
+    buffer_component->content_x_f       = 0.f;
+    buffer_component->content_y_f       = 0.f;
+    buffer_component->content_scale_x_f = 1.f;
+    buffer_component->content_scale_y_f = 1.f;
+    buffer_component->step              = step;
+    buffer_component->transpose         = transpose_buffer;
     buffer_component->set_pixel_layout(pixel_layout);
     buffer_obj->add_component("buffer_component", buffer_component);
 
     all_game_objects["buffer"] = buffer_obj;
 
+    camera_obj_ = camera_obj.get();
+    camera_component_ =
+        camera_obj->get_component<Camera>("camera_component");
+    buffer_obj_       = buffer_obj.get();
+    buffer_component_ = buffer_component.get();
+
+    if (defer_components) {
+        return true;
+    }
+
+    return initialize_components();
+}
+
+
+bool Stage::initialize_components()
+{
+    if (components_initialized_) {
+        return true;
+    }
+
     for (const auto& go : all_game_objects) {
         if (!go.second->initialize()) {
             return false;
@@ -109,10 +133,18 @@ bool Stage::initialize(const uint8_t* buffer,
         }
     }
 
+    components_initialized_ = true;
+
     return true;
 }
 
 
+bool Stage::components_initialized() const
+{
+    return components_initialized_;
+}
+
+
 bool Stage::buffer_update(const uint8_t* buffer,
                           int buffer_width_i,
                           int buffer_height_i,
@@ -122,19 +154,28 @@ bool Stage::buffer_update(const uint8_t* buffer,
                           const string& pixel_layout,
                           bool transpose_buffer)
 {
-    GameObject* buffer_obj = all_game_objects["buffer"].get();
-    Buffer* buffer_component =
-        buffer_obj->get_component<Buffer>("buffer_component");
-
-    buffer_component->buffer          = buffer;
-    buffer_component->channels        = channels;
-    buffer_component->type            = type;
-    buffer_component->buffer_width_f  = static_cast<float>(buffer_width_i);
-    buffer_component->buffer_height_f = static_cast<float>(buffer_height_i);
-    buffer_component->step            = step;
-    buffer_component->transpose       = transpose_buffer;
+    Buffer* buffer_component = buffer_component_;
+
+    buffer_component->buffer            = buffer;
+    buffer_component->channels          = channels;
+    buffer_component->type              = type;
+    buffer_component->buffer_width_f    = static_cast<float>(buffer_width_i);
+    buffer_component->buffer_height_f   = static_cast<float>(buffer_height_i);
+    buffer_component->display_width_f   = static_cast<float>(buffer_width_i);
+    buffer_component->display_height_f  = static_cast<float>(buffer_height_i);
+    buffer_component->content_x_f       = 0.f;
+    buffer_component->content_y_f       = 0.f;
+    buffer_component->content_scale_x_f = 1.f;
+    buffer_component->content_scale_y_f = 1.f;
+    buffer_component->step              = step;
+    buffer_component->transpose         = transpose_buffer;
     buffer_component->set_pixel_layout(pixel_layout);
 
+    // The components will be initialized from the new parameters
+    if (!components_initialized_) {
+        return true;
+    }
+
     for (const auto& game_obj_it : all_game_objects) {
         GameObject* game_obj = game_obj_it.second.get();
         game_obj->stage      = this;
@@ -158,6 +199,151 @@ bool Stage::buffer_update(const uint8_t* buffer,
 }
 
 
+void Stage::buffer_tiles_update(const vector<TileRegion>& tiles)
+{
+    if (!components_initialized_) {
+        // The contents changed since their range could have been computed
+        buffer_component_->set_color_range_hint(nullptr, nullptr);
+        return;
+    }
+
+    buffer_component_->update_tiles(tiles);
+}
+
+
+bool Stage::has_pending_uploads()
+{
+    if (!components_initialized_) {
+        return false;
+    }
+
+    return buffer_component_->has_pending_uploads();
+}
+
+
+bool Stage::has_textures()
+{
+    if (!components_initialized_) {
+        return false;
+    }
+
+    return buffer_component_->has_textures();
+}
+
+
+size_t Stage::texture_bytes()
+{
+    if (!components_initialized_) {
+        return 0;
+    }
+
+    return buffer_component_->texture_bytes();
+}
+
+
+int Stage::texture_tiles()
+{
+    if (!components_initialized_) {
+        return 0;
+    }
+
+    return buffer_component_->texture_tiles();
+}
+
+
+GLuint Stage::buffer_program()
+{
+    if (!components_initialized_) {
+        return 0;
+    }
+
+    return buffer_component_->program_id();
+}
+
+
+void Stage::release_textures()
+{
+    if (!components_initialized_) {
+        return;
+    }
+
+    buffer_component_->release_textures();
+}
+
+
+void Stage::restore_textures()
+{
+    if (!components_initialized_) {
+        return;
+    }
+
+    buffer_component_->restore_textures();
+}
+
+
+bool Stage::needs_update()
+{
+    if (!components_initialized_) {
+        return false;
+    }
+
+    return buffer_component_->needs_update();
+}
+
+
+bool Stage::has_pending_statistics()
+{
+    if (!components_initialized_) {
+        return false;
+    }
+
+    return buffer_component_->has_pending_statistics();
+}
+
+
+void Stage::set_display_size(int display_width_i,
+                             int display_height_i,
+                             bool recenter_camera)
+{
+    Buffer* buffer_component = buffer_component_;
+
+    buffer_component->display_width_f   = static_cast<float>(display_width_i);
+    buffer_component->display_height_f  = static_cast<float>(display_height_i);
+    buffer_component->content_x_f       = 0.f;
+    buffer_component->content_y_f       = 0.f;
+    buffer_component->content_scale_x_f =
+        buffer_component->display_width_f / buffer_component->buffer_width_f;
+    buffer_component->content_scale_y_f =
+        buffer_component->display_height_f / buffer_component->buffer_height_f;
+
+    if (recenter_camera && components_initialized_) {
+        camera_component_->recenter_camera();
+    }
+}
+
+
+void Stage::set_display_region(int display_width_i,
+                               int display_height_i,
+                               int content_x,
+                               int content_y,
+                               int scale,
+                               bool recenter_camera)
+{
+    Buffer* buffer_component = buffer_component_;
+
+    buffer_component->display_width_f   = static_cast<float>(display_width_i);
+    buffer_component->display_height_f  = static_cast<float>(display_height_i);
+    buffer_component->content_x_f       = static_cast<float>(content_x);
+    buffer_component->content_y_f       = static_cast<float>(content_y);
+    buffer_component->content_scale_x_f = static_cast<float>(scale);
+    buffer_component->content_scale_y_f = static_cast<float>(scale);
+
+    if (recenter_camera && components_initialized_) {
+        camera_component_->recenter_camera();
+    }
+}
+
+
 GameObject* Stage::get_game_object(string tag)
 {
     if (all_game_objects.find(tag) == all_game_objects.end()) {
@@ -168,8 +354,42 @@ GameObject* Stage::get_game_object(string tag)
 }
 
 
+GameObject* Stage::get_camera_object()
+{
+    return camera_obj_;
+}
+
+
+Camera* Stage::get_camera_component()
+{
+    return camera_component_;
+}
+
+
+GameObject* Stage::get_buffer_object()
+{
+    return buffer_obj_;
+}
+
+
+Buffer* Stage::get_buffer_component()
+{
+    return buffer_component_;
+}
+
+
+void Stage::invalidate_render_queue()
+{
+    render_queue_outdated_ = true;
+}
+
+
 void Stage::update()
 {
+    if (!components_initialized_) {
+        return;
+    }
+
     for (const auto& game_obj : all_game_objects) {
         game_obj.second->update();
     }
@@ -178,52 +398,75 @@ void Stage::update()
 
 void Stage::draw()
 {
-    set<Component*, compareRenderOrder> ordered_components;
+    if (!components_initialized_) {
+        return;
+    }
 
     // TODO use camera tags so I can have multiple cameras (useful for drawing
     // GUI)
 
-    GameObject* camera_obj = all_game_objects["camera"].get();
-    Camera* camera_component =
-        camera_obj->get_component<Camera>("camera_component");
-
-    if (camera_component == nullptr)
+    if (camera_component_ == nullptr)
         return;
 
-    mat4 view_inv = camera_obj->get_pose().inv();
+    if (render_queue_outdated_) {
+        update_render_queue();
+    }
+
+    const mat4& projection = camera_component_->get_projection();
+    const mat4& view_inv   = camera_obj_->get_pose_inverse();
+
+    for (Component* component : render_queue_) {
+        component->draw(projection, view_inv);
+    }
+}
+
+
+void Stage::update_render_queue()
+{
+    render_queue_.clear();
 
     for (const auto& game_obj : all_game_objects) {
         for (const auto& component : game_obj.second->get_components()) {
-            ordered_components.insert(component.second.get());
+            render_queue_.push_back(component.second.get());
         }
     }
 
-    for (const auto& component : ordered_components) {
-        component->draw(camera_component->projection, view_inv);
-    }
+    stable_sort(render_queue_.begin(),
+                render_queue_.end(),
+                [](const Component* a, const Component* b) {
+                    return a->render_index() < b->render_index();
+                });
+
+    render_queue_outdated_ = false;
 }
 
 
 void Stage::scroll_callback(float delta)
 {
-    GameObject* cam_obj = all_game_objects["camera"].get();
-    Camera* camera_component =
-        cam_obj->get_component<Camera>("camera_component");
-    camera_component->scroll_callback(delta);
+    if (!components_initialized_) {
+        return;
+    }
+
+    camera_component_->scroll_callback(delta);
 }
 
 
 void Stage::resize_callback(int w, int h)
 {
-    GameObject* cam_obj = all_game_objects["camera"].get();
-    Camera* camera_component =
-        cam_obj->get_component<Camera>("camera_component");
-    camera_component->window_resized(w, h);
+    if (!components_initialized_) {
+        return;
+    }
+
+    camera_component_->window_resized(w, h);
 }
 
 
 void Stage::mouse_drag_event(int mouse_x, int mouse_y)
 {
+    if (!components_initialized_) {
+        return;
+    }
+
     for (const auto& game_obj : all_game_objects) {
         game_obj.second->mouse_drag_event(mouse_x, mouse_y);
     }
@@ -232,6 +475,10 @@ void Stage::mouse_drag_event(int mouse_x, int mouse_y)
 
 void Stage::mouse_move_event(int mouse_x, int mouse_y)
 {
+    if (!components_initialized_) {
+        return;
+    }
+
     for (const auto& game_obj : all_game_objects) {
         game_obj.second->mouse_move_event(mouse_x, mouse_y);
     }
@@ -240,6 +487,10 @@ void Stage::mouse_move_event(int mouse_x, int mouse_y)
 
 EventProcessCode Stage::key_press_event(int key_code)
 {
+    if (!components_initialized_) {
+        return EventProcessCode::IGNORED;
+    }
+
     EventProcessCode event_intercepted = EventProcessCode::IGNORED;
 
     for (const auto& game_obj : all_game_objects) {
@@ -257,9 +508,9 @@ EventProcessCode Stage::key_press_event(int key_code)
 
 void Stage::go_to_pixel(float x, float y)
 {
-    GameObject* cam_obj = all_game_objects["camera"].get();
-    Camera* camera_component =
-        cam_obj->get_component<Camera>("camera_component");
+    if (!components_initialized_) {
+        return;
+    }
 
-    camera_component->move_to(x, y);
+    camera_component_->move_to(x, y);
 }
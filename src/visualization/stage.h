@@ -26,12 +26,17 @@
 #ifndef STAGE_H_
 #define STAGE_H_
 
+#include <cstddef> // for std::size_t
+
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "visualization/components/buffer.h"
 
 
+class Camera;
+class Component;
 class GameObject;
 
 
@@ -44,6 +49,9 @@ class Stage
 
     Stage(MainWindow* main_window);
 
+    // A deferred stage only holds the buffer parameters until its components
+    // are initialized, which creates their GL resources, before it is first
+    // displayed
     bool initialize(const uint8_t* buffer,
                     int buffer_width_i,
                     int buffer_height_i,
@@ -51,7 +59,12 @@ class Stage
                     BufferType type,
                     int step,
                     const std::string& pixel_layout,
-                    bool transpose_buffer);
+                    bool transpose_buffer,
+                    bool defer_components);
+
+    bool initialize_components();
+
+    bool components_initialized() const;
 
     bool buffer_update(const uint8_t* buffer,
                        int buffer_width_i,
@@ -62,8 +75,65 @@ class Stage
                        const std::string& pixel_layout,
                        bool transpose_buffer);
 
+    void buffer_tiles_update(const std::vector<TileRegion>& tiles);
+
+    // The buffer textures are still being uploaded
+    bool has_pending_uploads();
+
+    // The buffer textures can be released while the stage isn't displayed
+    bool has_textures();
+
+    std::size_t texture_bytes();
+
+    // Number of tiles of the buffer textures, if they exist
+    int texture_tiles();
+
+    // Linked program the buffer is drawn with, or 0 if none
+    GLuint buffer_program();
+
+    void release_textures();
+
+    void restore_textures();
+
+    // More updates are needed even if nothing happens meanwhile
+    bool needs_update();
+
+    // The buffer statistics, and so its contrast, are still being computed
+    bool has_pending_statistics();
+
+    // Stretch the buffer contents, which are a downsampled preview, over
+    // the given size. The camera must be recentered if it was set up for
+    // the size of the preview itself.
+    void set_display_size(int display_width_i,
+                          int display_height_i,
+                          bool recenter_camera);
+
+    // Place the buffer contents, which are a (possibly downsampled) region
+    // of a larger buffer, in a scene of the given size. The region top left
+    // corner is at (content_x, content_y), and each of its pixels covers
+    // scale x scale scene pixels.
+    void set_display_region(int display_width_i,
+                            int display_height_i,
+                            int content_x,
+                            int content_y,
+                            int scale,
+                            bool recenter_camera);
+
     GameObject* get_game_object(std::string tag);
 
+    // Direct handles to the objects of the stage, which are valid once it
+    // was initialized
+    GameObject* get_camera_object();
+
+    Camera* get_camera_component();
+
+    GameObject* get_buffer_object();
+
+    Buffer* get_buffer_component();
+
+    // Must be called when components are added to one of the game objects
+    void invalidate_render_queue();
+
     void update();
 
     void draw();
@@ -82,6 +152,18 @@ class Stage
 
   private:
     std::map<std::string, std::shared_ptr<GameObject>> all_game_objects;
+    bool components_initialized_;
+
+    GameObject* camera_obj_;
+    Camera* camera_component_;
+    GameObject* buffer_obj_;
+    Buffer* buffer_component_;
+
+    // Components of all game objects, in render order
+    std::vector<Component*> render_queue_;
+    bool render_queue_outdated_;
+
+    void update_render_queue();
 };
 
 #endif // STAGE_H_
@@ -0,0 +1,431 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "summed_area_table.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <type_traits>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Below this size, spawning threads costs more than the pass itself
+const size_t parallel_table_threshold = 4 << 20;
+
+const unsigned int max_table_threads = 8;
+
+
+template <typename T>
+double value_of(T value)
+{
+    return static_cast<double>(value);
+}
+
+
+double value_of(Half value)
+{
+    return static_cast<double>(static_cast<float>(value));
+}
+
+
+template <typename T>
+bool is_finite_value(T value)
+{
+    // NaNs and infinities are the only values whose difference with
+    // themselves is not zero
+    const double converted = value_of(value);
+    return converted - converted == 0.0;
+}
+
+
+template <typename T>
+bool has_non_finite_values(const T* buffer,
+                           int width,
+                           int height,
+                           int step,
+                           int channels,
+                           const atomic<bool>& cancel)
+{
+    if (!is_floating_point<T>::value && !is_same<T, Half>::value) {
+        return false;
+    }
+
+    const size_t row_length = static_cast<size_t>(step) * channels;
+
+    for (int y = 0; y < height; ++y) {
+        if (cancel.load(memory_order_relaxed)) {
+            return false;
+        }
+
+        const T* row = buffer + static_cast<size_t>(y) * row_length;
+        for (int i = 0; i < width * channels; ++i) {
+            if (!is_finite_value(row[i])) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+// Tabulate the rows as if the band started the buffer. The sums of the
+// rows above are added once all bands are done.
+template <typename T>
+void tabulate_rows(const T* buffer,
+                   int step,
+                   int first_row,
+                   int last_row,
+                   const atomic<bool>& cancel,
+                   SummedAreaTable* table)
+{
+    const int width          = table->width;
+    const int channels       = table->channels;
+    const size_t row_length  = static_cast<size_t>(step) * channels;
+    const size_t table_row   = static_cast<size_t>(width + 1) * channels;
+    const bool count_invalid = !table->non_finite_counts.empty();
+
+    for (int y = first_row; y < last_row; ++y) {
+        if (cancel.load(memory_order_relaxed)) {
+            return;
+        }
+
+        const T* row = buffer + static_cast<size_t>(y) * row_length;
+
+        // Entries of the pixels up to x in the row y of the buffer
+        const size_t entry = (static_cast<size_t>(y) + 1) * table_row;
+        double* sums       = &table->sums[entry];
+        double* squares    = &table->squared_sums[entry];
+        uint32_t* counts =
+            count_invalid ? &table->non_finite_counts[entry] : nullptr;
+
+        const bool has_above = y > first_row;
+
+        double row_sums[4]    = {0.0, 0.0, 0.0, 0.0};
+        double row_squares[4] = {0.0, 0.0, 0.0, 0.0};
+        uint32_t row_counts[4] = {0, 0, 0, 0};
+
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                const T value = row[x * channels + c];
+
+                if (is_finite_value(value)) {
+                    const double converted = value_of(value);
+                    row_sums[c] += converted;
+                    row_squares[c] += converted * converted;
+                } else {
+                    ++row_counts[c];
+                }
+
+                const size_t i = static_cast<size_t>(x + 1) * channels + c;
+
+                sums[i]    = row_sums[c] + (has_above ? sums[i - table_row]
+                                                      : 0.0);
+                squares[i] = row_squares[c] +
+                             (has_above ? squares[i - table_row] : 0.0);
+
+                if (counts != nullptr) {
+                    counts[i] = row_counts[c] +
+                                (has_above ? counts[i - table_row] : 0);
+                }
+            }
+        }
+    }
+}
+
+
+// Add the entries of the table row carry_row to the rows from first_row to
+// last_row, the last one excluded
+void add_carry(size_t carry_row,
+               size_t first_row,
+               size_t last_row,
+               const atomic<bool>& cancel,
+               SummedAreaTable* table)
+{
+    const size_t table_row =
+        static_cast<size_t>(table->width + 1) * table->channels;
+    const bool count_invalid = !table->non_finite_counts.empty();
+
+    const size_t carry = carry_row * table_row;
+
+    for (size_t y = first_row; y < last_row; ++y) {
+        if (cancel.load(memory_order_relaxed)) {
+            return;
+        }
+
+        const size_t entry = y * table_row;
+        for (size_t i = 0; i < table_row; ++i) {
+            table->sums[entry + i] += table->sums[carry + i];
+            table->squared_sums[entry + i] += table->squared_sums[carry + i];
+        }
+
+        if (count_invalid) {
+            for (size_t i = 0; i < table_row; ++i) {
+                table->non_finite_counts[entry + i] +=
+                    table->non_finite_counts[carry + i];
+            }
+        }
+    }
+}
+
+
+template <typename T>
+bool compute_summed_area_table(const T* buffer,
+                               int step,
+                               const atomic<bool>& cancel,
+                               SummedAreaTable& table)
+{
+    const int width    = table.width;
+    const int height   = table.height;
+    const int channels = table.channels;
+
+    const size_t entries = static_cast<size_t>(width + 1) *
+                           static_cast<size_t>(height + 1) * channels;
+
+    table.sums.assign(entries, 0.0);
+    table.squared_sums.assign(entries, 0.0);
+    table.non_finite_counts.clear();
+    if (has_non_finite_values(buffer, width, height, step, channels, cancel)) {
+        table.non_finite_counts.assign(entries, 0);
+    }
+
+    const size_t total_length = static_cast<size_t>(width) *
+                                static_cast<size_t>(height) * channels *
+                                sizeof(T);
+
+    unsigned int num_threads = 1;
+    if (total_length >= parallel_table_threshold) {
+        num_threads =
+            min(max(thread::hardware_concurrency(), 1u), max_table_threads);
+        num_threads = min(num_threads, static_cast<unsigned int>(height));
+    }
+
+    const int rows_per_thread =
+        (height + static_cast<int>(num_threads) - 1) /
+        static_cast<int>(num_threads);
+
+    // Each thread tabulates a band of rows on its own
+    vector<int> band_rows;
+    for (int first_row = 0; first_row < height; first_row += rows_per_thread) {
+        band_rows.push_back(first_row);
+    }
+    band_rows.push_back(height);
+
+    const size_t num_bands = band_rows.size() - 1;
+
+    vector<thread> workers;
+    for (size_t band = 1; band < num_bands; ++band) {
+        workers.emplace_back(tabulate_rows<T>,
+                             buffer,
+                             step,
+                             band_rows[band],
+                             band_rows[band + 1],
+                             ref(cancel),
+                             &table);
+    }
+
+    // The first band is tabulated by the calling thread
+    tabulate_rows<T>(buffer, step, 0, band_rows[1], cancel, &table);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    if (cancel.load()) {
+        return false;
+    }
+
+    // The last row of a band only misses the sums above the band, which
+    // are completed in order. The table row of the buffer row y is y + 1.
+    for (size_t band = 1; band < num_bands; ++band) {
+        add_carry(static_cast<size_t>(band_rows[band]),
+                  static_cast<size_t>(band_rows[band + 1]),
+                  static_cast<size_t>(band_rows[band + 1]) + 1,
+                  cancel,
+                  &table);
+    }
+
+    // The other rows then add the completed row above their band
+    for (size_t band = 2; band < num_bands; ++band) {
+        workers.emplace_back(add_carry,
+                             static_cast<size_t>(band_rows[band]),
+                             static_cast<size_t>(band_rows[band]) + 1,
+                             static_cast<size_t>(band_rows[band + 1]),
+                             ref(cancel),
+                             &table);
+    }
+
+    if (num_bands > 1) {
+        add_carry(static_cast<size_t>(band_rows[1]),
+                  static_cast<size_t>(band_rows[1]) + 1,
+                  static_cast<size_t>(band_rows[2]),
+                  cancel,
+                  &table);
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return !cancel.load();
+}
+
+} // namespace
+
+
+size_t summed_area_table_bytes(int width, int height, int channels)
+{
+    return static_cast<size_t>(width + 1) * static_cast<size_t>(height + 1) *
+           channels * 2 * sizeof(double);
+}
+
+
+bool compute_summed_area_table(const uint8_t* buffer,
+                               int width,
+                               int height,
+                               int step,
+                               int channels,
+                               BufferType type,
+                               const atomic<bool>& cancel,
+                               SummedAreaTable& table)
+{
+    table.width    = max(width, 0);
+    table.height   = max(height, 0);
+    table.channels = channels;
+
+    table.sums.clear();
+    table.squared_sums.clear();
+    table.non_finite_counts.clear();
+
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+        table.width = table.height = 0;
+        return true;
+    }
+
+    switch (type) {
+    case BufferType::UnsignedByte:
+        return compute_summed_area_table(buffer, step, cancel, table);
+    case BufferType::UnsignedShort:
+        return compute_summed_area_table(
+            reinterpret_cast<const uint16_t*>(buffer), step, cancel, table);
+    case BufferType::Short:
+        return compute_summed_area_table(
+            reinterpret_cast<const int16_t*>(buffer), step, cancel, table);
+    case BufferType::Int32:
+        return compute_summed_area_table(
+            reinterpret_cast<const int32_t*>(buffer), step, cancel, table);
+    case BufferType::Int8:
+        return compute_summed_area_table(
+            reinterpret_cast<const int8_t*>(buffer), step, cancel, table);
+    case BufferType::UnsignedInt32:
+        return compute_summed_area_table(
+            reinterpret_cast<const uint32_t*>(buffer), step, cancel, table);
+    case BufferType::Float16:
+        return compute_summed_area_table(
+            reinterpret_cast<const Half*>(buffer), step, cancel, table);
+    case BufferType::Float32: // fall-through
+    case BufferType::Float64:
+    case BufferType::Int64:
+        return compute_summed_area_table(
+            reinterpret_cast<const float*>(buffer), step, cancel, table);
+    }
+
+    return true;
+}
+
+
+void region_statistics(const SummedAreaTable& table,
+                       int x0,
+                       int y0,
+                       int x1,
+                       int y1,
+                       RegionStatistics& statistics)
+{
+    for (int c = 0; c < 4; ++c) {
+        statistics.count[c]  = 0;
+        statistics.sum[c]    = 0.0;
+        statistics.mean[c]   = 0.0;
+        statistics.stddev[c] = 0.0;
+    }
+
+    x0 = min(max(x0, 0), table.width);
+    x1 = min(max(x1, 0), table.width);
+    y0 = min(max(y0, 0), table.height);
+    y1 = min(max(y1, 0), table.height);
+
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+
+    const size_t table_row = static_cast<size_t>(table.width + 1);
+    const size_t channels  = static_cast<size_t>(table.channels);
+
+    const size_t top_left     = (y0 * table_row + x0) * channels;
+    const size_t top_right    = (y0 * table_row + x1) * channels;
+    const size_t bottom_left  = (y1 * table_row + x0) * channels;
+    const size_t bottom_right = (y1 * table_row + x1) * channels;
+
+    const size_t area = static_cast<size_t>(x1 - x0) * (y1 - y0);
+
+    for (int c = 0; c < table.channels; ++c) {
+        const double sum =
+            table.sums[bottom_right + c] - table.sums[top_right + c] -
+            table.sums[bottom_left + c] + table.sums[top_left + c];
+        const double squared_sum = table.squared_sums[bottom_right + c] -
+                                   table.squared_sums[top_right + c] -
+                                   table.squared_sums[bottom_left + c] +
+                                   table.squared_sums[top_left + c];
+
+        size_t non_finite = 0;
+        if (!table.non_finite_counts.empty()) {
+            const vector<uint32_t>& counts = table.non_finite_counts;
+            non_finite = counts[bottom_right + c] - counts[top_right + c] -
+                         counts[bottom_left + c] + counts[top_left + c];
+        }
+
+        const size_t count = area - non_finite;
+
+        statistics.count[c] = count;
+        statistics.sum[c]   = sum;
+
+        if (count > 0) {
+            const double mean = sum / count;
+            // The rounding errors of large sums may make it slightly
+            // negative
+            const double variance = max(squared_sum / count - mean * mean,
+                                        0.0);
+
+            statistics.mean[c]   = mean;
+            statistics.stddev[c] = sqrt(variance);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef SUMMED_AREA_TABLE_H_
+#define SUMMED_AREA_TABLE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ipc/raw_data_decode.h"
+
+
+/**
+ * Sums of the values and of their squares over every rectangle starting at
+ * the first pixel, from which the statistics of any region are found with
+ * four reads per channel. The tables have (width + 1) x (height + 1)
+ * entries, whose first row and column are zero, and interleave the
+ * channels like the buffer.
+ */
+struct SummedAreaTable
+{
+    int width;
+    int height;
+    int channels;
+
+    // NaNs and infinities are left out of the sums. Their counts are only
+    // tabulated if the buffer has any.
+    std::vector<double> sums;
+    std::vector<double> squared_sums;
+    std::vector<std::uint32_t> non_finite_counts;
+};
+
+
+struct RegionStatistics
+{
+    // Finite values of each channel in the region
+    std::size_t count[4];
+    double sum[4];
+    double mean[4];
+    double stddev[4];
+};
+
+
+// Memory taken by the tables of a buffer, before the non finite counts
+std::size_t summed_area_table_bytes(int width, int height, int channels);
+
+/**
+ * Tabulate the width x height pixels of buffer, whose rows are step pixels
+ * apart. Doubles and 64 bit integers must be held as floats. Large buffers
+ * are split across several threads, which all check cancel after each row.
+ *
+ * @return false if cancel was set before the tables were complete
+ */
+bool compute_summed_area_table(const std::uint8_t* buffer,
+                               int width,
+                               int height,
+                               int step,
+                               int channels,
+                               BufferType type,
+                               const std::atomic<bool>& cancel,
+                               SummedAreaTable& table);
+
+/**
+ * Statistics of the pixels from (x0, y0) to (x1, y1), ends excluded,
+ * clamped to the tabulated buffer. The standard deviation is that of the
+ * population.
+ */
+void region_statistics(const SummedAreaTable& table,
+                       int x0,
+                       int y0,
+                       int x1,
+                       int y1,
+                       RegionStatistics& statistics);
+
+#endif // SUMMED_AREA_TABLE_H_
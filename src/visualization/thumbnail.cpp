@@ -0,0 +1,222 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "thumbnail.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+using namespace std;
+
+
+namespace
+{
+
+template <typename T>
+float sample_channel(const uint8_t* buffer, int pos)
+{
+    return static_cast<float>(reinterpret_cast<const T*>(buffer)[pos]);
+}
+
+
+float sample_channel(const uint8_t* buffer, BufferType type, int pos)
+{
+    switch (type) {
+    case BufferType::UnsignedByte:
+        return sample_channel<uint8_t>(buffer, pos);
+    case BufferType::UnsignedShort:
+        return sample_channel<uint16_t>(buffer, pos);
+    case BufferType::Short:
+        return sample_channel<int16_t>(buffer, pos);
+    case BufferType::Int32:
+        return sample_channel<int32_t>(buffer, pos);
+    case BufferType::Int8:
+        return sample_channel<int8_t>(buffer, pos);
+    case BufferType::UnsignedInt32:
+        return sample_channel<uint32_t>(buffer, pos);
+    case BufferType::Float16:
+        return sample_channel<Half>(buffer, pos);
+    case BufferType::Float32: // fall-through
+    case BufferType::Float64:
+    case BufferType::Int64:
+        return sample_channel<float>(buffer, pos);
+    }
+
+    return 0.0f;
+}
+
+
+float type_range(BufferType type)
+{
+    if (type == BufferType::UnsignedByte) {
+        return 255.0f;
+    } else if (type == BufferType::Short) {
+        return static_cast<float>(numeric_limits<short>::max());
+    } else if (type == BufferType::UnsignedShort) {
+        return static_cast<float>(numeric_limits<unsigned short>::max());
+    } else if (type == BufferType::Int32) {
+        return static_cast<float>(numeric_limits<int>::max());
+    } else if (type == BufferType::Int8) {
+        return static_cast<float>(numeric_limits<int8_t>::max());
+    } else if (type == BufferType::UnsignedInt32) {
+        return static_cast<float>(numeric_limits<uint32_t>::max());
+    }
+
+    return 1.0f;
+}
+
+
+uint8_t to_intensity(float value)
+{
+    return static_cast<uint8_t>(
+        lround(255.0f * min(max(value, 0.0f), 1.0f)));
+}
+
+
+// Same pattern as the background of the GL canvas
+uint8_t background_intensity(int x, int y)
+{
+    const int tile_size = 10;
+    return ((x / tile_size + y / tile_size) % 2 == 0) ? 102 : 153;
+}
+
+} // namespace
+
+
+void render_buffer_thumbnail(const uint8_t* buffer,
+                             int width,
+                             int height,
+                             int channels,
+                             BufferType type,
+                             int step,
+                             const char* pixel_layout,
+                             bool transpose,
+                             bool auto_contrast,
+                             int icon_width,
+                             int icon_height,
+                             vector<uint8_t>& icon)
+{
+    icon.resize(3 * static_cast<size_t>(icon_width) *
+                static_cast<size_t>(icon_height));
+
+    for (int y = 0; y < icon_height; ++y) {
+        for (int x = 0; x < icon_width; ++x) {
+            uint8_t* pixel = &icon[3 * (y * icon_width + x)];
+            pixel[0] = pixel[1] = pixel[2] = background_intensity(x, y);
+        }
+    }
+
+    if (width <= 0 || height <= 0 || channels <= 0 || channels > 4) {
+        return;
+    }
+
+    // Fit the visualized buffer in the icon, keeping its aspect ratio
+    const int visualized_width  = transpose ? height : width;
+    const int visualized_height = transpose ? width : height;
+
+    const float scale =
+        min(static_cast<float>(icon_width) / visualized_width,
+            static_cast<float>(icon_height) / visualized_height);
+    const int fit_width = max(
+        1, min(icon_width, static_cast<int>(lround(visualized_width * scale))));
+    const int fit_height =
+        max(1,
+            min(icon_height,
+                static_cast<int>(lround(visualized_height * scale))));
+    const int fit_x = (icon_width - fit_width) / 2;
+    const int fit_y = (icon_height - fit_height) / 2;
+
+    // Only the sampled pixels are read, so that the icon costs the same for
+    // any buffer size
+    vector<float> samples(static_cast<size_t>(fit_width) * fit_height *
+                          channels);
+    float lowest[4];
+    float upper[4];
+    for (int c = 0; c < 4; ++c) {
+        lowest[c] = numeric_limits<float>::max();
+        upper[c]  = numeric_limits<float>::lowest();
+    }
+
+    for (int j = 0; j < fit_height; ++j) {
+        const int visualized_y = min(
+            visualized_height - 1,
+            static_cast<int>((j + 0.5f) * visualized_height / fit_height));
+
+        for (int i = 0; i < fit_width; ++i) {
+            const int visualized_x = min(
+                visualized_width - 1,
+                static_cast<int>((i + 0.5f) * visualized_width / fit_width));
+
+            const int buffer_x = transpose ? visualized_y : visualized_x;
+            const int buffer_y = transpose ? visualized_x : visualized_y;
+            const int pos      = channels * (buffer_y * step + buffer_x);
+
+            float* sample = &samples[channels * (j * fit_width + i)];
+            for (int c = 0; c < channels; ++c) {
+                sample[c] = sample_channel(buffer, type, pos + c);
+                lowest[c] = min(lowest[c], sample[c]);
+                upper[c]  = max(upper[c], sample[c]);
+            }
+        }
+    }
+
+    float contrast[4];
+    float brightness[4];
+    for (int c = 0; c < channels; ++c) {
+        if (auto_contrast) {
+            const float upp_minus_low = upper[c] - lowest[c];
+            contrast[c]   = upp_minus_low == 0.0f ? 1.0f : 1.0f / upp_minus_low;
+            brightness[c] = -lowest[c] * contrast[c];
+        } else {
+            contrast[c]   = 1.0f / type_range(type);
+            brightness[c] = 0.0f;
+        }
+    }
+
+    for (int j = 0; j < fit_height; ++j) {
+        for (int i = 0; i < fit_width; ++i) {
+            const float* sample = &samples[channels * (j * fit_width + i)];
+
+            float color[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+            for (int c = 0; c < channels; ++c) {
+                color[c] = sample[c] * contrast[c] + brightness[c];
+            }
+            if (channels == 1) {
+                color[1] = color[2] = color[0];
+            }
+
+            uint8_t* pixel = &icon[3 * ((fit_y + j) * icon_width + fit_x + i)];
+            for (int k = 0; k < 3; ++k) {
+                const char* component = "rgba";
+                const int c = static_cast<int>(
+                    find(component, component + 4, pixel_layout[k]) -
+                    component);
+                pixel[k] = to_intensity(c < 4 ? color[c] : 0.0f);
+            }
+        }
+    }
+}
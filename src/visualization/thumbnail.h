@@ -0,0 +1,55 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef THUMBNAIL_H_
+#define THUMBNAIL_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "ipc/raw_data_decode.h"
+
+
+/**
+ * Render an RGB888 icon of icon_width x icon_height from the buffer contents
+ * on the CPU, for buffers that have no GL resources yet. The buffer is
+ * fitted to the icon like in the GL canvas, with its channels normalized
+ * over their sampled range (or their type range without auto contrast) and
+ * swizzled by pixel_layout.
+ */
+void render_buffer_thumbnail(const std::uint8_t* buffer,
+                             int width,
+                             int height,
+                             int channels,
+                             BufferType type,
+                             int step,
+                             const char* pixel_layout,
+                             bool transpose,
+                             bool auto_contrast,
+                             int icon_width,
+                             int icon_height,
+                             std::vector<std::uint8_t>& icon);
+
+#endif // THUMBNAIL_H_
@@ -0,0 +1,151 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2019 OpenImageDebugger contributors
+ * (https://github.com/OpenImageDebugger/OpenImageDebugger)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "value_labels.h"
+
+#include <cmath>
+#include <cstdio>
+
+
+using namespace std;
+
+
+namespace
+{
+
+// Writes the decimal digits of value, returning their count
+int format_unsigned(unsigned long long value, char* label)
+{
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    for (int i = 0; i < count; ++i) {
+        label[i] = digits[count - 1 - i];
+    }
+
+    return count;
+}
+
+
+int format_integer(long long value, char* label)
+{
+    if (value < 0) {
+        label[0] = '-';
+        return 1 + format_unsigned(
+                       static_cast<unsigned long long>(-(value + 1)) + 1,
+                       label + 1);
+    }
+
+    return format_unsigned(static_cast<unsigned long long>(value), label);
+}
+
+
+// Formats value like "%.3f" does, falling back to "%.3e" for labels longer
+// than 7 characters. Only the fallback goes through snprintf.
+void format_float(float value, const int label_length, char* pix_label)
+{
+    if (std::isfinite(value) && std::fabs(value) < 1e6f) {
+        // The product is exact, and rounded to even like printf does
+        const long long thousandths =
+            std::llrint(std::fabs(static_cast<double>(value)) * 1000.0);
+
+        int length = 0;
+        if (std::signbit(value)) {
+            pix_label[length++] = '-';
+        }
+        length += format_unsigned(thousandths / 1000, pix_label + length);
+
+        if (length <= 3) {
+            const int fraction    = static_cast<int>(thousandths % 1000);
+            pix_label[length]     = '.';
+            pix_label[length + 1] = static_cast<char>('0' + fraction / 100);
+            pix_label[length + 2] =
+                static_cast<char>('0' + fraction / 10 % 10);
+            pix_label[length + 3] = static_cast<char>('0' + fraction % 10);
+            pix_label[length + 4] = '\0';
+            return;
+        }
+    } else if (!std::isfinite(value)) {
+        snprintf(pix_label, label_length, "%.3f", value);
+        return;
+    }
+
+    snprintf(pix_label, label_length, "%.3e", value);
+}
+
+
+void format_int(long long value, const int label_length, char* pix_label)
+{
+    // Past 7 characters, the label wouldn't fit in the pixel
+    if (value > 9999999 || value < -999999) {
+        snprintf(
+            pix_label, label_length, "%.3e", static_cast<float>(value));
+        return;
+    }
+
+    pix_label[format_integer(value, pix_label)] = '\0';
+}
+
+} // namespace
+
+
+void pix2str(const BufferType& type,
+             const uint8_t* buffer,
+             const int& pos,
+             const int& channel,
+             const int label_length,
+             char* pix_label)
+{
+    if (held_buffer_type(type) == BufferType::Float32) {
+        float fpix = reinterpret_cast<const float*>(buffer)[pos + channel];
+        format_float(fpix, label_length, pix_label);
+    } else if (type == BufferType::Float16) {
+        float fpix = reinterpret_cast<const Half*>(buffer)[pos + channel];
+        format_float(fpix, label_length, pix_label);
+    } else if (type == BufferType::UnsignedByte) {
+        format_int(buffer[pos + channel], label_length, pix_label);
+    } else if (type == BufferType::Short) {
+        short fpix = reinterpret_cast<const short*>(buffer)[pos + channel];
+        format_int(fpix, label_length, pix_label);
+    } else if (type == BufferType::UnsignedShort) {
+        unsigned short fpix =
+            reinterpret_cast<const unsigned short*>(buffer)[pos + channel];
+        format_int(fpix, label_length, pix_label);
+    } else if (type == BufferType::Int32) {
+        int fpix = reinterpret_cast<const int*>(buffer)[pos + channel];
+        format_int(fpix, label_length, pix_label);
+    } else if (type == BufferType::Int8) {
+        int8_t fpix = reinterpret_cast<const int8_t*>(buffer)[pos + channel];
+        format_int(fpix, label_length, pix_label);
+    } else if (type == BufferType::UnsignedInt32) {
+        uint32_t fpix =
+            reinterpret_cast<const uint32_t*>(buffer)[pos + channel];
+        format_int(fpix, label_length, pix_label);
+    }
+}
@@ -1,20 +1,57 @@
 /*
  * Minimal OpenCV Mat simulator; for testing purposes only.
+ *
+ * Each scenario, selected from the command line, stops at breakpointHere(),
+ * whose caller has the buffers of the scenario in scope. Run with --help for
+ * the list of scenarios.
  */
 #include <cassert>
 #include <cinttypes>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <string>
 #include <thread>
 #include <type_traits>
 #include <unistd.h>
+#include <vector>
 
 using namespace std;
 
+// Half precision float, as held by CV_16F matrices
+struct float16
+{
+    uint16_t bits;
+
+    float16()
+        : bits(0)
+    {
+    }
+
+    // Truncates the mantissa; subnormals are flushed to zero
+    float16(float value)
+    {
+        uint32_t f;
+        memcpy(&f, &value, sizeof(f));
+
+        const uint32_t sign     = (f >> 16) & 0x8000;
+        const int exponent      = static_cast<int>((f >> 23) & 0xff) - 127 + 15;
+        const uint32_t mantissa = (f >> 13) & 0x3ff;
+
+        if (exponent <= 0) {
+            bits = static_cast<uint16_t>(sign);
+        } else if (exponent >= 31) {
+            bits = static_cast<uint16_t>(sign | 0x7c00);
+        } else {
+            bits = static_cast<uint16_t>(sign | (exponent << 10) | mantissa);
+        }
+    }
+};
+
 namespace cv
 {
 struct Mat
@@ -37,15 +74,25 @@ struct Mat
         : data(nullptr)
         , cols(0)
         , rows(0)
+        , flags(0)
+        , step{{0, 0}}
     {
     }
 
+    Mat(Mat&& o)
+        : Mat()
+    {
+        *this = std::move(o);
+    }
+
     Mat& operator=(Mat&& o)
     {
         data    = o.data;
         dataMgr = std::move(o.dataMgr);
         cols    = o.cols;
         rows    = o.rows;
+        flags   = o.flags;
+        step    = o.step;
 
         return *this;
     }
@@ -58,11 +105,13 @@ struct Mat
         step = {cols_ * channels_ * static_cast<int>(sizeof(T)), channels_};
 
         const int OID_TYPES_UINT8   = 0;
+        const int OID_TYPES_INT8    = 1;
         const int OID_TYPES_UINT16  = 2;
         const int OID_TYPES_INT16   = 3;
         const int OID_TYPES_INT32   = 4;
         const int OID_TYPES_FLOAT32 = 5;
         const int OID_TYPES_FLOAT64 = 6;
+        const int OID_TYPES_FLOAT16 = 7;
 
         const int CV_CN_SHIFT = 3;
 
@@ -70,6 +119,10 @@ struct Mat
 
         if (is_same<T, uint8_t>::value) {
             flags |= OID_TYPES_UINT8;
+        } else if (is_same<T, int8_t>::value) {
+            flags |= OID_TYPES_INT8;
+        } else if (is_same<T, float16>::value) {
+            flags |= OID_TYPES_FLOAT16;
         } else if (is_same<T, uint16_t>::value) {
             flags |= OID_TYPES_UINT16;
         } else if (is_same<T, int16_t>::value) {
@@ -87,6 +140,27 @@ struct Mat
         data    = dataMgr.get();
     }
 
+    /*
+     * Region of interest sharing the data of this matrix, whose rows are
+     * thus padded to the stride of the whole matrix
+     */
+    template <typename T>
+    Mat roi(int x, int y, int width, int height) const
+    {
+        assert(x >= 0 && y >= 0 && x + width <= cols && y + height <= rows);
+
+        Mat region;
+        region.dataMgr = dataMgr;
+        region.data    = static_cast<uint8_t*>(data) + y * step.buf[0] +
+                      x * step.buf[1] * static_cast<int>(sizeof(T));
+        region.cols  = width;
+        region.rows  = height;
+        region.flags = flags;
+        region.step  = step;
+
+        return region;
+    }
+
     void release()
     {
         // Intentionally, "data" is not changed so we are left with an invalid
@@ -112,10 +186,12 @@ struct Mat
 
         T& operator()(int row, int col, int chan)
         {
-            size_t channels = m.step.buf[1];
-            size_t idx      = row * m.cols * channels + col * channels + chan;
-            assert(idx >= 0);
-            assert(idx < m.rows * m.cols * m.step.buf[1]);
+            // Rows of regions of interest are further apart than their width
+            size_t channels   = m.step.buf[1];
+            size_t row_stride = m.step.buf[0] / sizeof(T);
+            size_t idx        = row * row_stride + col * channels + chan;
+            assert(col < m.cols && row < m.rows);
+            assert(idx < m.rows * row_stride);
             return (static_cast<T*>(m.data))[idx];
         }
 
@@ -375,9 +451,213 @@ void bodyCaller()
     t.join();
 }
 
-int main(int, char*[])
+// Stops here once the buffers of a scenario are ready. Set a breakpoint on
+// this function, then step out of it to observe the buffers of its caller.
+__attribute__((noinline)) void breakpointHere(const char* scenario)
+{
+    cout << "Reached the breakpoint of scenario " << scenario << endl;
+}
+
+struct ScenarioSettings
+{
+    int size       = 4096;
+    int iterations = 100;
+};
+
+// Cheap pattern, so that very large buffers are quick to fill
+template <typename T>
+void fillGradient(int W, int H, int C, Mat& matrix)
+{
+    Mat::Iterator<T> i(matrix);
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            for (int c = 0; c < C; ++c) {
+                i(y, x, c) = static_cast<T>(
+                    static_cast<float>((x + y * 3 + c * 43) % 128));
+            }
+        }
+    }
+}
+
+template <typename T>
+Mat makeGradient(int W, int H, int C)
+{
+    Mat matrix;
+    matrix.create<T>(H, W, C);
+    fillGradient<T>(W, H, C, matrix);
+
+    return matrix;
+}
+
+// A very large buffer of each of the types of OpenCV matrices (which can't
+// hold uint32 nor int64 values)
+void largeBuffers(const ScenarioSettings& settings)
+{
+    const int W = settings.size;
+    const int H = settings.size;
+    const int C = 3;
+
+    Mat large_uint8   = makeGradient<uint8_t>(W, H, C);
+    Mat large_int8    = makeGradient<int8_t>(W, H, C);
+    Mat large_uint16  = makeGradient<uint16_t>(W, H, C);
+    Mat large_int16   = makeGradient<int16_t>(W, H, C);
+    Mat large_int32   = makeGradient<int32_t>(W, H, C);
+    Mat large_float16 = makeGradient<float16>(W, H, C);
+    Mat large_float32 = makeGradient<float>(W, H, C);
+    Mat large_float64 = makeGradient<double>(W, H, C);
+
+    breakpointHere("large_buffers");
+}
+
+// Regions of interest, whose rows are padded to the stride of their parent
+void paddedRois(const ScenarioSettings& settings)
 {
-    bodyCaller();
+    const int W = settings.size;
+    const int H = settings.size;
+
+    Mat parent_gray  = makeGradient<uint8_t>(W, H, 1);
+    Mat parent_rgb   = makeGradient<uint8_t>(W, H, 3);
+    Mat parent_float = makeGradient<float>(W, H, 4);
+
+    // Odd offsets and sizes, so that the rows are neither aligned nor
+    // contiguous
+    Mat roi_gray   = parent_gray.roi<uint8_t>(13, 7, W / 2 + 1, H / 2 + 3);
+    Mat roi_rgb    = parent_rgb.roi<uint8_t>(1, 1, W - 3, H - 2);
+    Mat roi_float  = parent_float.roi<float>(W / 4, H / 4, W / 3, H / 5);
+    Mat roi_row    = parent_float.roi<float>(0, H / 2, W, 1);
+    Mat roi_column = parent_gray.roi<uint8_t>(W / 2, 0, 1, H);
+
+    breakpointHere("padded_rois");
+}
+
+#define EIGHT_MATS(X, p) \
+    X(p##0) X(p##1) X(p##2) X(p##3) X(p##4) X(p##5) X(p##6) X(p##7)
+#define SIXTY_FOUR_MATS(X, p)                                           \
+    EIGHT_MATS(X, p##0) EIGHT_MATS(X, p##1) EIGHT_MATS(X, p##2)         \
+    EIGHT_MATS(X, p##3) EIGHT_MATS(X, p##4) EIGHT_MATS(X, p##5)         \
+    EIGHT_MATS(X, p##6) EIGHT_MATS(X, p##7)
+#define MANY_MATS(X)                                                    \
+    SIXTY_FOUR_MATS(X, mat_a) SIXTY_FOUR_MATS(X, mat_b)                 \
+    SIXTY_FOUR_MATS(X, mat_c) SIXTY_FOUR_MATS(X, mat_d)
+
+#define DECLARE_MAT(name) Mat name;
+#define MAT_ADDRESS(name) &name,
+
+// Hundreds of matrices observable at once, as the members of this class
+class ManyMats
+{
+  public:
+    void run()
+    {
+        Mat* mats[] = {MANY_MATS(MAT_ADDRESS)};
+
+        int index = 0;
+        for (Mat* mat : mats) {
+            const int size = (index % 4 + 1) * 64;
+            if (index % 2 == 0) {
+                mat->create<uint8_t>(size, size, 3);
+                fillGradient<uint8_t>(size, size, 3, *mat);
+            } else {
+                mat->create<float>(size, size, 1);
+                fillGradient<float>(size, size, 1, *mat);
+            }
+            ++index;
+        }
+
+        breakpointHere("many_mats");
+    }
+
+  private:
+    MANY_MATS(DECLARE_MAT)
+};
+
+// Tight loop modifying a small patch of the same buffer on each iteration,
+// as when stepping through a filter
+void incrementalUpdates(const ScenarioSettings& settings)
+{
+    const int W     = settings.size;
+    const int H     = settings.size;
+    const int C     = 3;
+    const int patch = 16;
+
+    Mat frame = makeGradient<uint8_t>(W, H, C);
+    Mat::Iterator<uint8_t> i(frame);
+
+    const int patches_per_row = W / patch;
+    const int patches_per_col = H / patch;
+    for (int iteration = 0; iteration < settings.iterations; ++iteration) {
+        const int x0 = (iteration % patches_per_row) * patch;
+        const int y0 = (iteration / patches_per_row % patches_per_col) * patch;
+        for (int y = y0; y < y0 + patch; ++y) {
+            for (int x = x0; x < x0 + patch; ++x) {
+                for (int c = 0; c < C; ++c) {
+                    i(y, x, c) = 255 - i(y, x, c);
+                }
+            }
+        }
+
+        breakpointHere("incremental");
+    }
+}
+
+void printUsage(const char* program)
+{
+    cout << "Usage: " << program
+         << " [scenario] [--size=N] [--iterations=N]" << endl
+         << endl
+         << "Scenarios, which all stop at breakpointHere():" << endl
+         << "  basic          a few small buffers (default)" << endl
+         << "  large_buffers  a size x size buffer of each type" << endl
+         << "  padded_rois    regions of interest of size x size buffers"
+         << endl
+         << "  many_mats      256 small buffers observable at once" << endl
+         << "  incremental    a size x size buffer whose 16x16 patches are"
+            " modified one per"
+         << endl
+         << "                 iteration" << endl
+         << endl
+         << "  --size=N        width and height of the buffers (default 4096)"
+         << endl
+         << "  --iterations=N  iterations of the incremental scenario"
+            " (default 100)"
+         << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    string scenario = "basic";
+    ScenarioSettings settings;
+
+    for (int a = 1; a < argc; ++a) {
+        const string arg = argv[a];
+        if (arg.compare(0, 7, "--size=") == 0) {
+            settings.size = max(atoi(arg.c_str() + 7), 64);
+        } else if (arg.compare(0, 13, "--iterations=") == 0) {
+            settings.iterations = atoi(arg.c_str() + 13);
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            scenario = arg;
+        }
+    }
+
+    if (scenario == "basic") {
+        bodyCaller();
+    } else if (scenario == "large_buffers") {
+        largeBuffers(settings);
+    } else if (scenario == "padded_rois") {
+        paddedRois(settings);
+    } else if (scenario == "many_mats") {
+        ManyMats many_mats;
+        many_mats.run();
+    } else if (scenario == "incremental") {
+        incrementalUpdates(settings);
+    } else {
+        cerr << "Unknown scenario " << scenario << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
 
     return 0;
 }